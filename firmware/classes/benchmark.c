@@ -0,0 +1,296 @@
+/*
+ * This file is part of libgreat
+ *
+ * Benchmark communications class -- times core firmware primitives with the
+ * DWT cycle counter, so host-side CI can compare builds and catch performance
+ * regressions without a lab setup.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <toolchain.h>
+#include <sync.h>
+
+#include <drivers/comms.h>
+#include <drivers/arm_profiling.h>
+#include <drivers/memory/allocator.h>
+#include <drivers/memory/ringbuffer.h>
+
+// Class number reserved for the libgreat benchmark facility.
+#define CLASS_NUMBER_BENCHMARK 0x3
+
+// Size of the static buffers used by the memcpy and ringbuffer benchmarks.
+#define BENCHMARK_BUFFER_SIZE (2048)
+
+// Upper bound on a single verb's iteration count, so a bad argument can't
+// wedge the device inside a timing loop for seconds.
+#define BENCHMARK_MAX_ITERATIONS (65536UL)
+
+
+// Working buffers for the data-movement benchmarks.
+static uint8_t benchmark_source[BENCHMARK_BUFFER_SIZE];
+static uint8_t benchmark_destination[BENCHMARK_BUFFER_SIZE];
+
+// Mutex exercised by the lock/unlock benchmark.
+static mutex_t benchmark_mutex;
+
+
+/**
+ * @return a reference to the DWT registers, with the cycle counter running
+ */
+static arm_dwt_register_block_t *benchmark_cycle_counter(void)
+{
+	profiling_initialize();
+	return arch_get_dwt_registers();
+}
+
+
+/**
+ * Parses and validates the iteration-count argument common to the timing
+ * verbs.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+static int benchmark_parse_iterations(struct command_transaction *trans, uint32_t *iterations)
+{
+	*iterations = comms_argument_parse_uint32_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+	if (!*iterations || (*iterations > BENCHMARK_MAX_ITERATIONS)) {
+		return EINVAL;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Packs the standard response for a timing verb: the total cycles consumed,
+ * and the iteration count they cover.
+ */
+static void benchmark_respond(struct command_transaction *trans, uint32_t total_cycles, uint32_t iterations)
+{
+	comms_response_add_uint32_t(trans, total_cycles);
+	comms_response_add_uint32_t(trans, iterations);
+}
+
+
+/**
+ * Times an empty iteration loop, so the host can subtract the loop's own
+ * overhead from the other measurements.
+ */
+static int verb_time_loop_overhead(struct command_transaction *trans)
+{
+	arm_dwt_register_block_t *dwt = benchmark_cycle_counter();
+	uint32_t iterations, start;
+	int rc;
+
+	rc = benchmark_parse_iterations(trans, &iterations);
+	if (rc) {
+		return rc;
+	}
+
+	start = dwt->cycle_count;
+	for (volatile uint32_t i = 0; i < iterations; ++i);
+	benchmark_respond(trans, dwt->cycle_count - start, iterations);
+
+	return 0;
+}
+
+
+/**
+ * Times memcpy() between two internal buffers at a host-chosen size.
+ */
+static int verb_time_memcpy(struct command_transaction *trans)
+{
+	arm_dwt_register_block_t *dwt = benchmark_cycle_counter();
+	uint32_t size = comms_argument_parse_uint32_t(trans);
+	uint32_t iterations, start;
+	int rc;
+
+	rc = benchmark_parse_iterations(trans, &iterations);
+	if (rc) {
+		return rc;
+	}
+	if (!size || (size > BENCHMARK_BUFFER_SIZE)) {
+		return EINVAL;
+	}
+
+	start = dwt->cycle_count;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		memcpy(benchmark_destination, benchmark_source, size);
+	}
+	benchmark_respond(trans, dwt->cycle_count - start, iterations);
+
+	return 0;
+}
+
+
+/**
+ * Times allocate/free pairs of a host-chosen size through the system
+ * allocator, from a quiesced heap.
+ */
+static int verb_time_alloc_free(struct command_transaction *trans)
+{
+	arm_dwt_register_block_t *dwt = benchmark_cycle_counter();
+	uint32_t size = comms_argument_parse_uint32_t(trans);
+	uint32_t iterations, start;
+	int rc;
+
+	rc = benchmark_parse_iterations(trans, &iterations);
+	if (rc) {
+		return rc;
+	}
+	if (!size) {
+		return EINVAL;
+	}
+
+	// Make sure the heap can satisfy the request at all before we time it,
+	// so a failing allocation doesn't masquerade as a very fast one.
+	void *probe = allocator_malloc(size);
+	if (!probe) {
+		return ENOMEM;
+	}
+	allocator_free(probe);
+
+	start = dwt->cycle_count;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		allocator_free(allocator_malloc(size));
+	}
+	benchmark_respond(trans, dwt->cycle_count - start, iterations);
+
+	return 0;
+}
+
+
+/**
+ * Times ringbuffer enqueue/dequeue pairs.
+ */
+static int verb_time_ringbuffer(struct command_transaction *trans)
+{
+	arm_dwt_register_block_t *dwt = benchmark_cycle_counter();
+	uint32_t iterations, start;
+	ringbuffer_t ring;
+	int rc;
+
+	rc = benchmark_parse_iterations(trans, &iterations);
+	if (rc) {
+		return rc;
+	}
+
+	ringbuffer_init(&ring, benchmark_destination, BENCHMARK_BUFFER_SIZE);
+
+	start = dwt->cycle_count;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		ringbuffer_enqueue(&ring, (uint8_t)i);
+		ringbuffer_dequeue(&ring);
+	}
+	benchmark_respond(trans, dwt->cycle_count - start, iterations);
+
+	return 0;
+}
+
+
+/**
+ * Times uncontended mutex lock/unlock pairs.
+ */
+static int verb_time_mutex(struct command_transaction *trans)
+{
+	arm_dwt_register_block_t *dwt = benchmark_cycle_counter();
+	uint32_t iterations, start;
+	int rc;
+
+	rc = benchmark_parse_iterations(trans, &iterations);
+	if (rc) {
+		return rc;
+	}
+
+	libgreat_mutex_init(&benchmark_mutex);
+
+	start = dwt->cycle_count;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		libgreat_mutex_lock(&benchmark_mutex);
+		libgreat_mutex_unlock(&benchmark_mutex);
+	}
+	benchmark_respond(trans, dwt->cycle_count - start, iterations);
+
+	return 0;
+}
+
+
+/**
+ * Does nothing, successfully. Host-side round-trip timing of this verb
+ * measures the full comms dispatch and transport overhead; combined with the
+ * core class's per-verb dispatch statistics, the device-side share can be
+ * separated out.
+ */
+static int verb_nop(struct command_transaction *trans)
+{
+	(void)trans;
+	return 0;
+}
+
+
+/**
+ * Echoes the received payload back to the host, so host-side timing can
+ * measure transport throughput in both directions at a host-chosen size.
+ */
+static int verb_loopback(struct command_transaction *trans)
+{
+	uint32_t length;
+	uint8_t *data = comms_argument_read_buffer(trans, -1, &length);
+
+	if (!data || !comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	comms_response_add_raw(trans, data, length);
+	return 0;
+}
+
+
+/**
+ * Verbs for the benchmark API.
+ */
+static struct comms_verb benchmark_verbs[] = {
+		{ .verb_number = 0x0, .name = "time_loop_overhead", .handler = verb_time_loop_overhead,
+				.in_signature = "<I", .out_signature = "<II",
+				.in_param_names = COMMS_PARAM_NAMES("iterations"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, iterations"),
+				.doc = COMMS_DOC("Times an empty iteration loop, for subtracting loop overhead from other measurements.") },
+		{ .verb_number = 0x1, .name = "time_memcpy", .handler = verb_time_memcpy,
+				.in_signature = "<II", .out_signature = "<II",
+				.in_param_names = COMMS_PARAM_NAMES("size, iterations"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, iterations"),
+				.doc = COMMS_DOC("Times memcpy() of the given size between internal buffers.") },
+		{ .verb_number = 0x2, .name = "time_alloc_free", .handler = verb_time_alloc_free,
+				.in_signature = "<II", .out_signature = "<II",
+				.in_param_names = COMMS_PARAM_NAMES("size, iterations"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, iterations"),
+				.doc = COMMS_DOC("Times allocate/free pairs of the given size through the system allocator.") },
+		{ .verb_number = 0x3, .name = "time_ringbuffer", .handler = verb_time_ringbuffer,
+				.in_signature = "<I", .out_signature = "<II",
+				.in_param_names = COMMS_PARAM_NAMES("iterations"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, iterations"),
+				.doc = COMMS_DOC("Times ringbuffer enqueue/dequeue pairs.") },
+		{ .verb_number = 0x4, .name = "time_mutex", .handler = verb_time_mutex,
+				.in_signature = "<I", .out_signature = "<II",
+				.in_param_names = COMMS_PARAM_NAMES("iterations"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, iterations"),
+				.doc = COMMS_DOC("Times uncontended mutex lock/unlock pairs.") },
+		{ .verb_number = 0x5, .name = "nop", .handler = verb_nop,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Does nothing; round-trip time this from the host to measure dispatch overhead.") },
+		{ .verb_number = 0x6, .name = "loopback", .handler = verb_loopback,
+				.in_signature = "<*X", .out_signature = "<*X",
+				.in_param_names = COMMS_PARAM_NAMES("data"),
+				.out_param_names = COMMS_PARAM_NAMES("data"),
+				.doc = COMMS_DOC("Echoes the received payload, for host-side transport throughput measurement.") },
+		{} // Sentinel
+};
+COMMS_DEFINE_SIMPLE_CLASS(benchmark_api, CLASS_NUMBER_BENCHMARK, "benchmark", benchmark_verbs,
+        "On-device microbenchmarks of core firmware primitives, for regression tracking.");
@@ -12,6 +12,7 @@
 
 #include <drivers/comms.h>
 #include <drivers/comms_backend.h>
+#include <drivers/memory/allocator.h>
 
 #define CLASS_NUMBER_CORE 0
 
@@ -44,6 +45,220 @@ ATTR_WEAK int core_verb_read_serial_number(struct command_transaction *trans)
 	return ENOSYS;
 }
 
+/**
+ * Introspection verbs for the platform's per-endpoint USB performance
+ * counters; overridden by platforms that collect them.
+ */
+ATTR_WEAK int core_verb_get_usb_endpoint_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_reset_usb_endpoint_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Verbs for reading out cycle-accurate profiling data; overridden by
+ * platforms that build the profiling module.
+ */
+ATTR_WEAK int core_verb_get_profile_summary(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_get_profile_region(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_control_profiling_sampler(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_reset_profiling(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Verbs for the interrupt latency and jitter tracer; overridden by platforms
+ * that build the vector-trace module.
+ */
+ATTR_WEAK int core_verb_trace_interrupt(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_control_latency_reference(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_get_interrupt_latency_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_reset_interrupt_latency_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Verbs for the scheduler's per-task CPU accounting; overridden by builds
+ * that include the scheduler module.
+ */
+ATTR_WEAK int core_verb_get_scheduler_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_reset_scheduler_stats(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Verbs for post-reboot crash telemetry; overridden by platforms that build
+ * the fault-telemetry module.
+ */
+ATTR_WEAK int core_verb_get_fault_snapshot(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+ATTR_WEAK int core_verb_clear_fault_snapshot(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Verb for dumping the active SGPIO configuration to the debug ring;
+ * overridden by platforms that build the SGPIO module's debug support.
+ */
+ATTR_WEAK int core_verb_dump_sgpio_configuration(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENOSYS;
+}
+
+
+/**
+ * Introspection verb for the per-verb dispatch statistics gathered when the
+ * firmware is built with CONFIG_ENABLE_VERB_PROFILING; dumps every in-use
+ * record as a packed run of five uint32s (class number, verb number,
+ * invocations, total cycles, max cycles).
+ */
+static int core_verb_get_verb_statistics(struct command_transaction *trans)
+{
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+	struct comms_verb_statistics *record;
+	uint32_t index = 0;
+
+	// Pack each tracked verb's record into the response.
+	while ((record = comms_get_verb_statistics(index++))) {
+		if (!record->in_use) {
+			continue;
+		}
+
+		comms_response_add_uint32_t(trans, record->class_number);
+		comms_response_add_uint32_t(trans, record->verb_number);
+		comms_response_add_uint32_t(trans, record->invocations);
+		comms_response_add_uint32_t(trans, record->total_cycles);
+		comms_response_add_uint32_t(trans, record->max_cycles);
+	}
+
+	return 0;
+#else
+	(void)trans;
+	return ENOSYS;
+#endif
+}
+
+
+/**
+ * Introspection verb for the heap accounting gathered when the firmware is
+ * built with CONFIG_ENABLE_ALLOC_ACCOUNTING: four uint32s of heap-wide
+ * totals (live bytes, peak live bytes, total allocations, failed
+ * allocations), followed by a run of four uint32s per allocating call site
+ * (call-site address, live bytes, peak live bytes, total allocations).
+ */
+static int core_verb_get_allocator_statistics(struct command_transaction *trans)
+{
+#ifdef CONFIG_ENABLE_ALLOC_ACCOUNTING
+	struct allocator_statistics *stats = allocator_get_statistics();
+	struct allocator_site_statistics *site;
+	uint32_t index = 0;
+
+	comms_response_add_uint32_t(trans, stats->live_bytes);
+	comms_response_add_uint32_t(trans, stats->peak_live_bytes);
+	comms_response_add_uint32_t(trans, stats->total_allocations);
+	comms_response_add_uint32_t(trans, stats->failed_allocations);
+
+	// Pack each allocating call site's record into the response.
+	while ((site = allocator_get_site_statistics(index++))) {
+		if (!site->call_site) {
+			continue;
+		}
+
+		comms_response_add_uint32_t(trans, (uint32_t)(uintptr_t)site->call_site);
+		comms_response_add_uint32_t(trans, site->live_bytes);
+		comms_response_add_uint32_t(trans, site->peak_live_bytes);
+		comms_response_add_uint32_t(trans, site->total_allocations);
+	}
+
+	return 0;
+#else
+	(void)trans;
+	return ENOSYS;
+#endif
+}
+
+
+static int core_verb_reset_verb_statistics(struct command_transaction *trans)
+{
+	(void)trans;
+
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+	comms_reset_verb_statistics();
+	return 0;
+#else
+	return ENOSYS;
+#endif
+}
+
+
 /**
  * TODO: get me out of here!
  */
@@ -60,12 +275,18 @@ ATTR_WEAK int core_verb_request_reset(struct command_transaction *trans)
 static int verb_get_available_classes(struct command_transaction *trans)
 {
 	struct comms_class *cls;
+	const struct comms_class *const *entry;
 
 	// Add each class number to the list.
 	for (cls = class_head; cls; cls = cls->next) {
 		comms_response_add_uint32_t(trans, cls->class_number);
 	}
 
+	// ... including any classes registered via the flash-resident class table.
+	for (entry = __comms_class_table_start; entry < __comms_class_table_end; ++entry) {
+		comms_response_add_uint32_t(trans, (*entry)->class_number);
+	}
+
 	return 0;
 }
 
@@ -113,9 +334,14 @@ enum verb_descriptor_request {
  */
 static int verb_get_verb_descriptor(struct command_transaction *trans)
 {
-	uint32_t class_number = comms_argument_parse_uint32_t(trans);
-	uint32_t verb_number = comms_argument_parse_uint32_t(trans);
-    uint8_t descriptor = comms_argument_parse_uint8_t(trans);
+	// Fixed argument block: bounds-check once, then read unchecked.
+	if (!comms_argument_check_block(trans, (2 * sizeof(uint32_t)) + sizeof(uint8_t))) {
+		return EBADMSG;
+	}
+
+	uint32_t class_number = comms_argument_read_uint32_t(trans);
+	uint32_t verb_number = comms_argument_read_uint32_t(trans);
+	uint8_t descriptor = comms_argument_read_uint8_t(trans);
 
 	// Fetch the relevant class.
 	struct comms_verb *verb = comms_get_object_for_verb(class_number, verb_number);
@@ -153,6 +379,70 @@ static int verb_get_verb_descriptor(struct command_transaction *trans)
 
 
 
+/**
+ * Internal introspection command that returns packed descriptors for all of
+ * a class's verbs in a single transaction, sparing the host a round trip per
+ * name, signature, and docstring.
+ */
+static int verb_get_verb_descriptors(struct command_transaction *trans)
+{
+	uint32_t class_number = comms_argument_parse_uint32_t(trans);
+	uint32_t start_index = comms_argument_parse_uint32_t(trans);
+
+	struct comms_class *relevant_class;
+	struct comms_verb *verb;
+	uint32_t index = 0;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	relevant_class = comms_get_class_by_number(class_number);
+	if (!relevant_class) {
+		return EINVAL;
+	}
+
+	// Pack one record per verb: the verb's number, then its name and each
+	// of its descriptor strings, NUL-terminated, with the same "*"
+	// placeholder for absent strings as get_verb_descriptor.
+	for (verb = relevant_class->command_verbs; verb->handler; ++verb, ++index) {
+
+		const char *const strings[] = {
+			verb->name            ? verb->name            : "",
+			verb->in_signature    ? verb->in_signature    : "*",
+			verb->out_signature   ? verb->out_signature   : "*",
+			verb->doc             ? verb->doc             : "*",
+			verb->in_param_names  ? verb->in_param_names  : "*",
+			verb->out_param_names ? verb->out_param_names : "*",
+		};
+		size_t needed = sizeof(uint32_t);
+		unsigned int i;
+
+		if (index < start_index) {
+			continue;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(strings); ++i) {
+			needed += strlen(strings[i]) + 1;
+		}
+
+		// Only whole records go in a response: if this one won't fit, stop,
+		// and let the host continue from the first verb it hasn't seen. An
+		// empty response means the table has been read completely.
+		if (needed > comms_response_space_available(trans)) {
+			break;
+		}
+
+		comms_response_add_uint32_t(trans, verb->verb_number);
+		for (i = 0; i < ARRAY_SIZE(strings); ++i) {
+			comms_response_add_raw(trans, (void *)strings[i], strlen(strings[i]) + 1);
+		}
+	}
+
+	return 0;
+}
+
+
 /**
  * Internal introspection command that returns the list of verbs for a given class.
  */
@@ -237,9 +527,104 @@ static struct comms_verb core_verbs[] = {
 		{ .verb_number = 0x7, .name = "get_verb_descriptor", .handler = verb_get_verb_descriptor },
 		{ .verb_number = 0x8, .name = "get_class_name", .handler = verb_get_class_name },
 		{ .verb_number = 0x9, .name = "get_class_docs", .handler = verb_get_class_docs },
+		{ .verb_number = 0x10, .name = "get_usb_endpoint_stats", .handler = core_verb_get_usb_endpoint_stats,
+				.in_signature = "<BB", .out_signature = "<IIIIII",
+				.in_param_names = COMMS_PARAM_NAMES("controller, endpoint_address"),
+				.out_param_names = COMMS_PARAM_NAMES("transfers_completed, bytes_transferred, transfer_errors, queue_empty_events, max_prime_wait_spins, pool_exhaustions"),
+				.doc = COMMS_DOC("Reads the performance counters for a USB endpoint.") },
+		{ .verb_number = 0x11, .name = "reset_usb_endpoint_stats", .handler = core_verb_reset_usb_endpoint_stats,
+				.in_signature = "<BB", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("controller, endpoint_address"),
+				.doc = COMMS_DOC("Clears the performance counters for a USB endpoint.") },
+		{ .verb_number = 0x12, .name = "get_profile_summary", .handler = core_verb_get_profile_summary,
+				.in_signature = "", .out_signature = "<II",
+				.out_param_names = COMMS_PARAM_NAMES("region_count, untracked_samples"),
+				.doc = COMMS_DOC("Reports the number of profiled regions, and samples that landed outside any region.") },
+		{ .verb_number = 0x13, .name = "get_profile_region", .handler = core_verb_get_profile_region,
+				.in_signature = "<I", .out_signature = "<IIIS",
+				.in_param_names = COMMS_PARAM_NAMES("index"),
+				.out_param_names = COMMS_PARAM_NAMES("total_cycles, entry_count, sample_count, name"),
+				.doc = COMMS_DOC("Reads the accumulated counters for a single profiled region.") },
+		{ .verb_number = 0x14, .name = "control_profiling_sampler", .handler = core_verb_control_profiling_sampler,
+				.in_signature = "<I", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("frequency"),
+				.doc = COMMS_DOC("Starts the statistical profiling sampler at the given frequency, in Hz; 0 stops it.") },
+		{ .verb_number = 0x15, .name = "reset_profiling", .handler = core_verb_reset_profiling,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Clears all accumulated profiling counters and samples.") },
+
+		{ .verb_number = 0x16, .name = "get_verb_statistics", .handler = core_verb_get_verb_statistics,
+				.in_signature = "", .out_signature = "<*X",
+				.out_param_names = COMMS_PARAM_NAMES("statistics"),
+				.doc = COMMS_DOC("Dumps per-verb dispatch statistics: runs of five uint32s --\n"
+						"class number, verb number, invocations, total cycles, max cycles.") },
+		{ .verb_number = 0x17, .name = "reset_verb_statistics", .handler = core_verb_reset_verb_statistics,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Clears all accumulated per-verb dispatch statistics.") },
+		{ .verb_number = 0x18, .name = "get_allocator_statistics", .handler = core_verb_get_allocator_statistics,
+				.in_signature = "", .out_signature = "<*X",
+				.out_param_names = COMMS_PARAM_NAMES("statistics"),
+				.doc = COMMS_DOC("Dumps heap accounting: four uint32s of heap-wide totals (live bytes,\n"
+						"peak live bytes, total allocations, failed allocations), then runs of\n"
+						"four uint32s per call site (address, live, peak, allocations).") },
+
+		{ .verb_number = 0x19, .name = "get_verb_descriptors", .handler = verb_get_verb_descriptors,
+				.in_signature = "<II", .out_signature = "<*X",
+				.in_param_names = COMMS_PARAM_NAMES("class_number, start_verb_index"),
+				.out_param_names = COMMS_PARAM_NAMES("descriptors"),
+				.doc = COMMS_DOC("Dumps packed descriptors for a class's verbs, starting from the given\n"
+						"index: per verb, a uint32 verb number followed by six NUL-terminated\n"
+						"strings (name, in/out signatures, docs, in/out parameter names).") },
 
 		// TODO: move this out of core!
 		{ .verb_number = 0x20, .handler = core_verb_request_reset },
+
+		{ .verb_number = 0x21, .name = "trace_interrupt", .handler = core_verb_trace_interrupt,
+				.in_signature = "<IB", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("irq, enable"),
+				.doc = COMMS_DOC("Starts (enable=1) or stops (enable=0) tracing the given IRQ's handler.") },
+		{ .verb_number = 0x22, .name = "control_latency_reference", .handler = core_verb_control_latency_reference,
+				.in_signature = "<I", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("period_cycles"),
+				.doc = COMMS_DOC("Starts the SysTick latency reference with the given period, in cycles; 0 stops it.") },
+		{ .verb_number = 0x23, .name = "get_interrupt_latency_stats", .handler = core_verb_get_interrupt_latency_stats,
+				.in_signature = "", .out_signature = "<*X",
+				.out_param_names = COMMS_PARAM_NAMES("statistics"),
+				.doc = COMMS_DOC("Dumps interrupt latency statistics: three uint32s for the latency\n"
+						"reference (samples, total latency cycles, max latency cycles), then\n"
+						"runs of six uint32s per traced vector (irq, invocations, total cycles,\n"
+						"max cycles, min/max inter-arrival cycles).") },
+		{ .verb_number = 0x24, .name = "reset_interrupt_latency_stats", .handler = core_verb_reset_interrupt_latency_stats,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Clears all accumulated interrupt latency statistics.") },
+		{ .verb_number = 0x25, .name = "get_scheduler_stats", .handler = core_verb_get_scheduler_stats,
+				.in_signature = "", .out_signature = "<*X",
+				.out_param_names = COMMS_PARAM_NAMES("statistics"),
+				.doc = COMMS_DOC("Dumps scheduler CPU accounting: three uint32s for the loop (completed\n"
+						"rounds, then the cycles they consumed, lo/hi), then runs of seven\n"
+						"uint32s per task (implementation address, priority, flags -- bit 0 set\n"
+						"for run-every-round tasks -- invocations, total cycles lo/hi, and\n"
+						"worst single-iteration cycles).") },
+		{ .verb_number = 0x26, .name = "reset_scheduler_stats", .handler = core_verb_reset_scheduler_stats,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Clears the scheduler's accumulated CPU accounting.") },
+		{ .verb_number = 0x27, .name = "get_fault_snapshot", .handler = core_verb_get_fault_snapshot,
+				.in_signature = "", .out_signature = "<*X",
+				.out_param_names = COMMS_PARAM_NAMES("snapshot"),
+				.doc = COMMS_DOC("Dumps the crash snapshot preserved across the last fault- or\n"
+						"watchdog-induced reboot, as uint32s: fault count, exception number,\n"
+						"stacked r0-r3, r12, lr, pc, psr, then sp, EXC_RETURN, cfsr, hfsr,\n"
+						"mmfar, bfar, the supervised task address and capture cycle count,\n"
+						"and the backtrace depth followed by that many return addresses.\n"
+						"Fails with EAGAIN if no snapshot is preserved.") },
+		{ .verb_number = 0x28, .name = "clear_fault_snapshot", .handler = core_verb_clear_fault_snapshot,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Marks the preserved crash snapshot as collected.") },
+		{ .verb_number = 0x29, .name = "dump_sgpio_configuration", .handler = core_verb_dump_sgpio_configuration,
+				.in_signature = "<B", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("include_unused"),
+				.doc = COMMS_DOC("Dumps the active SGPIO configuration to the debug ring (read it back\n"
+						"with dmesg). Fails with EAGAIN if no SGPIO function set is configured.") },
 		{} // Sentinel
 };
 COMMS_DEFINE_SIMPLE_CLASS(core_api, CLASS_NUMBER_CORE, "core", core_verbs,
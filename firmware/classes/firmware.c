@@ -6,9 +6,13 @@
  */
 
 #include <drivers/comms.h>
+#include <drivers/crc.h>
+#include <drivers/scheduler.h>
 #include <debug.h>
+#include <toolchain.h>
 
 #include <stddef.h>
+#include <string.h>
 #include <errno.h>
 
 
@@ -83,24 +87,359 @@ ATTR_WEAK int firmware_verb_read_page(struct command_transaction *trans)
 }
 
 
+//
+// Streaming writes.
+//
+// The single-page write verb costs one full command round trip per page, so
+// large images spend most of their update time waiting on USB turnarounds.
+// The streaming verbs below instead stage each incoming page and program it
+// from a scheduler task *after* the handler returns -- so the next page's
+// USB transfer overlaps the previous page's program time.
+//
+
+/** Largest page the streaming write path can stage. */
+#define FIRMWARE_STREAM_MAX_PAGE_SIZE 2048
+
+/** Ping-pong staging buffers for streamed pages; never read before written. */
+static uint8_t firmware_stream_buffers[2][FIRMWARE_STREAM_MAX_PAGE_SIZE] ATTR_NOINIT;
+
+/** State for an in-progress streaming write session. */
+static struct {
+
+	// True while a session is open.
+	bool active;
+
+	// The flash address the next incoming page will be written to.
+	uint32_t address;
+
+	// The staged-but-not-yet-programmed page, if any; staged_length is
+	// zero when nothing is pending.
+	uint8_t staged_buffer;
+	uint32_t staged_address;
+	volatile uint32_t staged_length;
+
+	// The first programming error encountered, reported at session end.
+	int error;
+
+	// Total pages programmed so far.
+	uint32_t pages_written;
+
+} firmware_stream;
+
+/** True once our write-behind task has been registered. */
+static bool firmware_stream_task_registered;
+
+
+/**
+ * Programs a single page of the device's firmware flash; used by the
+ * streaming write verbs. Boards should override this with their actual
+ * flash-programming routine (e.g. via spiflash_target).
+ *
+ * @param address The flash address to program.
+ * @param data The page contents.
+ * @param length The page length, in bytes.
+ * @return 0 on success, or an error code on failure
+ */
+ATTR_WEAK int firmware_platform_program_page(uint32_t address, void *data, uint32_t length)
+{
+	(void)address;
+	(void)data;
+	(void)length;
+	return ENOSYS;
+}
+
+
+/**
+ * Programs any staged page. Runs as a scheduler task once a page has been
+ * staged, which lets the comms backend accept the next page over USB while
+ * we're busy with the flash.
+ */
+static void firmware_stream_program_staged(void)
+{
+	int rc;
+
+	if (!firmware_stream.staged_length) {
+		return;
+	}
+
+	rc = firmware_platform_program_page(firmware_stream.staged_address,
+			firmware_stream_buffers[firmware_stream.staged_buffer], firmware_stream.staged_length);
+	if (rc && !firmware_stream.error) {
+		firmware_stream.error = rc;
+	}
+
+	firmware_stream.pages_written++;
+	firmware_stream.staged_length = 0;
+}
+
+
+/**
+ * Starts a streaming firmware write session.
+ *
+ * Accepts a uint32_t that is the address the stream will begin writing at.
+ */
+static int firmware_verb_write_stream_start(struct command_transaction *trans)
+{
+	uint32_t address = comms_argument_parse_uint32_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	// Register our write-behind task the first time a session opens.
+	if (!firmware_stream_task_registered) {
+		firmware_stream_task_registered = true;
+		scheduler_register_task(firmware_stream_program_staged, SCHEDULER_DEFAULT_PRIORITY);
+	}
+
+	firmware_stream.active = true;
+	firmware_stream.address = address;
+	firmware_stream.staged_length = 0;
+	firmware_stream.error = 0;
+	firmware_stream.pages_written = 0;
+
+	return 0;
+}
+
+
+/**
+ * Accepts one page of streamed firmware data; the page is staged and
+ * programmed after this handler returns, overlapping with the transfer of
+ * the next page.
+ *
+ * Accepts a single page of data.
+ */
+static int firmware_verb_write_stream_data(struct command_transaction *trans)
+{
+	uint32_t length;
+	uint8_t *data = comms_argument_read_buffer(trans, -1, &length);
+
+	if (!comms_transaction_okay(trans) || !data) {
+		return EBADMSG;
+	}
+
+	if (!firmware_stream.active) {
+		pr_error("firmware: error: streamed data without an open write session!\n");
+		return EINVAL;
+	}
+	if (!length || (length > FIRMWARE_STREAM_MAX_PAGE_SIZE)) {
+		return EINVAL;
+	}
+
+	// If the previous page hasn't been programmed yet, catch up before we
+	// overwrite its staging state.
+	firmware_stream_program_staged();
+
+	// Stage the new page in the buffer the previous page didn't use, and
+	// let our task program it once we've returned to the scheduler.
+	firmware_stream.staged_buffer ^= 1;
+	memcpy(firmware_stream_buffers[firmware_stream.staged_buffer], data, length);
+	firmware_stream.staged_address = firmware_stream.address;
+	firmware_stream.staged_length = length;
+	firmware_stream.address += length;
+
+	scheduler_mark_task_ready(firmware_stream_program_staged);
+	return 0;
+}
+
+
+/**
+ * Ends a streaming firmware write session, programming any final staged
+ * page.
+ *
+ * Returns a uint32_t count of the pages written during the session.
+ */
+static int firmware_verb_write_stream_finish(struct command_transaction *trans)
+{
+	if (!firmware_stream.active) {
+		return EINVAL;
+	}
+
+	// Flush the final page, and close out the session.
+	firmware_stream_program_staged();
+	firmware_stream.active = false;
+
+	if (firmware_stream.error) {
+		return firmware_stream.error;
+	}
+
+	comms_response_add_uint32_t(trans, firmware_stream.pages_written);
+	return 0;
+}
+
+
+/**
+ * Reads a chunk of the device's firmware flash for verification; used by the
+ * checksum verb. The default implementation handles memory-mapped regions
+ * (RAM, or XIP-mapped flash) with a plain copy; boards whose firmware flash
+ * isn't memory-mapped should override this with their actual flash-read
+ * routine (e.g. via spiflash_target).
+ *
+ * @param address The address to read from.
+ * @param data Buffer to receive the data.
+ * @param length The amount to read, in bytes.
+ * @return 0 on success, or an error code on failure
+ */
+ATTR_WEAK int firmware_platform_read_region(uint32_t address, void *data, uint32_t length)
+{
+	memcpy(data, (const void *)address, length);
+	return 0;
+}
+
+
+/**
+ * Computes a CRC32 over a flash (or memory) range, streaming it through one
+ * of our staging buffers -- so regions that aren't memory-mapped can be read
+ * chunk-at-a-time by the board's read routine.
+ *
+ * @param address The address of the range.
+ * @param length The length of the range, in bytes.
+ * @param crc_out Receives the range's CRC32.
+ * @return 0 on success, or an error code on failure
+ */
+static int firmware_compute_region_crc(uint32_t address, uint32_t length, uint32_t *crc_out)
+{
+	uint32_t crc = crc32_init();
+	int rc;
+
+	while (length) {
+		uint32_t chunk = (length > FIRMWARE_STREAM_MAX_PAGE_SIZE) ? FIRMWARE_STREAM_MAX_PAGE_SIZE : length;
+
+		rc = firmware_platform_read_region(address, firmware_stream_buffers[0], chunk);
+		if (rc) {
+			return rc;
+		}
+
+		crc = crc32_update(crc, firmware_stream_buffers[0], chunk);
+		address += chunk;
+		length -= chunk;
+	}
+
+	*crc_out = crc32_finalize(crc);
+	return 0;
+}
+
+
+/**
+ * Computes a CRC32 over a flash (or memory) range, so the host can verify
+ * an update without reading every page back over USB.
+ *
+ * Accepts a uint32_t address and a uint32_t length.
+ * Returns the CRC32 of the range.
+ */
+static int firmware_verb_checksum(struct command_transaction *trans)
+{
+	uint32_t address = comms_argument_parse_uint32_t(trans);
+	uint32_t length = comms_argument_parse_uint32_t(trans);
+	uint32_t crc;
+	int rc;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	// We borrow a streaming staging buffer below; make sure it's not
+	// holding a page that hasn't been programmed yet.
+	firmware_stream_program_staged();
+
+	rc = firmware_compute_region_crc(address, length, &crc);
+	if (rc) {
+		return rc;
+	}
+
+	comms_response_add_uint32_t(trans, crc);
+	return 0;
+}
+
+
+/**
+ * Returns a manifest of per-page CRC32s for a flash range, so the host can
+ * diff the device's current firmware against a new image and rewrite only
+ * the pages that actually changed -- turning a full-image flash into a
+ * delta update.
+ *
+ * Accepts a uint32_t address, a uint32_t length, and a uint32_t page size
+ * (the granularity to diff at; typically the erase-page size). The final
+ * page's CRC covers only the bytes inside the range.
+ *
+ * Returns the packed uint32_t CRCs, one per page. Ranges whose manifests
+ * don't fit in one response fail with EINVAL; ask for them in windows.
+ */
+static int firmware_verb_page_crcs(struct command_transaction *trans)
+{
+	uint32_t address = comms_argument_parse_uint32_t(trans);
+	uint32_t length = comms_argument_parse_uint32_t(trans);
+	uint32_t page_size = comms_argument_parse_uint32_t(trans);
+	int rc;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+	if (!page_size) {
+		return EINVAL;
+	}
+
+	// As with the checksum verb: we borrow a staging buffer, so flush any
+	// page that hasn't been programmed yet.
+	firmware_stream_program_staged();
+
+	while (length) {
+		uint32_t page_length = (length > page_size) ? page_size : length;
+		uint32_t crc;
+
+		rc = firmware_compute_region_crc(address, page_length, &crc);
+		if (rc) {
+			return rc;
+		}
+
+		comms_response_add_uint32_t(trans, crc);
+		if (!comms_transaction_okay(trans)) {
+			return EINVAL;
+		}
+
+		address += page_length;
+		length -= page_length;
+	}
+
+	return 0;
+}
+
+
 /**
  * Verbs for the firmware API.
  */
 static struct comms_verb firmware_verbs[] = {
 		{ .verb_number = 0x0, .name = "initialize", .handler = firmware_verb_initialize,
-            .in_signature = "", .out_signature = "<II", .out_param_names = "page_size, total_size",
-            .doc = "Sets up the board to have its firmware programmed." },
+            .in_signature = "", .out_signature = "<II", .out_param_names = COMMS_PARAM_NAMES("page_size, total_size"),
+            .doc = COMMS_DOC("Sets up the board to have its firmware programmed.") },
 		{ .verb_number = 0x1, .name = "full_erase", .handler = firmware_verb_full_erase,
-            .in_signature = "", .out_signature	= "", .doc = "Erases the entire firmware flash chip." },
+            .in_signature = "", .out_signature	= "", .doc = COMMS_DOC("Erases the entire firmware flash chip.") },
 		{ .verb_number = 0x2, .name = "page_erase", .handler = firmware_verb_erase_page,
-            .in_signature = "<I", .out_signature = "", .in_param_names = "address",
-            .doc = "Erases the page with the provided address on the fw flash." },
+            .in_signature = "<I", .out_signature = "", .in_param_names = COMMS_PARAM_NAMES("address"),
+            .doc = COMMS_DOC("Erases the page with the provided address on the fw flash.") },
 		{ .verb_number = 0x3, .name = "write_page", .handler = firmware_verb_write_page,
-            .in_signature = "<I*X", .out_signature = "", .in_param_names = "address, data",
-            .doc = "Writes the provided data to a single firmware flash page." },
+            .in_signature = "<I*X", .out_signature = "", .in_param_names = COMMS_PARAM_NAMES("address, data"),
+            .doc = COMMS_DOC("Writes the provided data to a single firmware flash page.") },
 		{ .verb_number = 0x4, .name = "read_page",	.handler = firmware_verb_read_page,
-            .in_signature = "<I", .out_signature = "<*X", .in_param_names = "address", .out_param_names = "data",
-            .doc = "Returns the contents of the flash page at the given address." },
+            .in_signature = "<I", .out_signature = "<*X", .in_param_names = COMMS_PARAM_NAMES("address"), .out_param_names = COMMS_PARAM_NAMES("data"),
+            .doc = COMMS_DOC("Returns the contents of the flash page at the given address.") },
+		{ .verb_number = 0x5, .name = "write_stream_start", .handler = firmware_verb_write_stream_start,
+            .in_signature = "<I", .out_signature = "", .in_param_names = COMMS_PARAM_NAMES("address"),
+            .doc = COMMS_DOC("Opens a streaming write session starting at the given address.") },
+		{ .verb_number = 0x6, .name = "write_stream_data", .handler = firmware_verb_write_stream_data,
+            .in_signature = "<*X", .out_signature = "", .in_param_names = COMMS_PARAM_NAMES("data"),
+            .doc = COMMS_DOC("Streams one page of data; it programs while the next page transfers.") },
+		{ .verb_number = 0x7, .name = "write_stream_finish", .handler = firmware_verb_write_stream_finish,
+            .in_signature = "", .out_signature = "<I", .out_param_names = COMMS_PARAM_NAMES("pages_written"),
+            .doc = COMMS_DOC("Flushes and closes a streaming write session.") },
+		{ .verb_number = 0x8, .name = "checksum", .handler = firmware_verb_checksum,
+            .in_signature = "<II", .out_signature = "<I", .in_param_names = COMMS_PARAM_NAMES("address, length"),
+            .out_param_names = COMMS_PARAM_NAMES("crc32"),
+            .doc = COMMS_DOC("Computes the CRC32 of a flash range device-side, for fast verification.") },
+		{ .verb_number = 0x9, .name = "page_crcs", .handler = firmware_verb_page_crcs,
+            .in_signature = "<III", .out_signature = "<*I",
+            .in_param_names = COMMS_PARAM_NAMES("address, length, page_size"), .out_param_names = COMMS_PARAM_NAMES("crcs"),
+            .doc = COMMS_DOC("Returns per-page CRC32s for a flash range, for delta updates.") },
 		{} // Sentinel
 };
 COMMS_DEFINE_SIMPLE_CLASS(firmware_api, CLASS_NUMBER_FIRMWARE, "firmware", firmware_verbs,
@@ -0,0 +1,364 @@
+/*
+ * This file is part of libgreat
+ *
+ * Reference streaming pattern source -- generates a deterministic
+ * pseudorandom pattern through the full ring-buffer/pipe/transport path at
+ * a commanded rate, so host-side CI can measure the rate a build honestly
+ * sustains (and catch regressions in the streaming stack) without any
+ * capture hardware attached.
+ *
+ * Each chunk the source emits carries a small header -- sequence number,
+ * generation timestamp, and a cumulative drop count -- followed by a
+ * payload of xorshift32 words keyed by the sequence number. The host
+ * regenerates the expected payloads, validates every chunk, detects drops
+ * from sequence gaps, and derives latency from the timestamps; see
+ * pygreat's pattern_stream module for the consumer.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <toolchain.h>
+#include <debug.h>
+
+#include <drivers/comms.h>
+#include <drivers/comms_backend.h>
+#include <drivers/scheduler.h>
+#include <drivers/timer.h>
+
+// Class number reserved for the libgreat pattern-source facility.
+#define CLASS_NUMBER_PATTERN_SOURCE 0x4
+
+// Marks the start of each chunk; 'PRS1', read as a little-endian uint32.
+#define PATTERN_SOURCE_MAGIC 0x31535250
+
+// Size of each chunk handed to the transport, header included. A multiple
+// of the USB bulk packet size, so chunks map cleanly onto transfers.
+#define PATTERN_SOURCE_CHUNK_SIZE 2048
+
+// Number of chunks that can be in flight on the transport at once.
+#define PATTERN_SOURCE_CHUNK_COUNT 4
+
+// Payloads repeat with this period (in chunks), so the host can precompute
+// one period's worth of expected payloads and validate at full rate with
+// plain comparisons. Must be a power of two.
+#define PATTERN_SOURCE_SEED_PERIOD 8
+
+// Base for the per-chunk generator seeds; always nonzero.
+#define PATTERN_SOURCE_SEED_BASE 0x50524253
+
+// Interval between pacing polls: one timer-wheel tick.
+#define PATTERN_SOURCE_POLL_INTERVAL_US 1024
+
+// Cap on accumulated rate budget, so a transport stall converts promptly
+// into accounted drops instead of an unbounded catch-up burst.
+#define PATTERN_SOURCE_MAX_BUDGET (PATTERN_SOURCE_CHUNK_COUNT * PATTERN_SOURCE_CHUNK_SIZE)
+
+
+/**
+ * The header leading each emitted chunk; all fields little-endian.
+ */
+struct ATTR_PACKED pattern_source_chunk_header {
+
+	/** Always PATTERN_SOURCE_MAGIC. */
+	uint32_t magic;
+
+	/** The chunk's sequence number. Advances for dropped chunks too, so
+	 * the host sees drops as gaps it can cross-check against the drop
+	 * counter below. Also keys the payload generator. */
+	uint32_t sequence;
+
+	/** The device's microsecond clock at generation time. */
+	uint32_t timestamp;
+
+	/** Cumulative count of chunks dropped so far; see the statistics. */
+	uint32_t chunks_dropped;
+};
+
+
+/**
+ * State for the active pattern stream. Single-instance, like the other
+ * engines built on the pipe layer's context-free callbacks.
+ */
+static struct {
+	struct comms_pipe *pipe;
+
+	// Periodic poll that keeps pacing ticking while the pipe idles.
+	software_timer_t poll_timer;
+
+	// Staging chunks, on loan to the transport zero-copy between each
+	// send and its completion callback; sends complete in submission
+	// order, so a produced/completed counter pair tracks the loans.
+	uint8_t chunks[PATTERN_SOURCE_CHUNK_COUNT][PATTERN_SOURCE_CHUNK_SIZE] ATTR_ALIGNED(4);
+	unsigned int chunks_produced;
+	volatile unsigned int chunks_completed;
+
+	// The commanded rate, in bytes per second; 0 streams as fast as the
+	// transport drains.
+	uint32_t rate;
+
+	// Rate accounting: bytes we're currently allowed to emit, and the
+	// last time the allowance was refilled.
+	uint32_t budget;
+	uint32_t budget_refilled;
+
+	// The running sequence number, and our statistics.
+	uint32_t sequence;
+	uint32_t chunks_sent;
+	uint32_t chunks_dropped;
+
+	bool active;
+} pattern_source;
+
+
+/**
+ * Fills a buffer with the deterministic payload for a given sequence
+ * number: xorshift32 words from a seed the host can reproduce.
+ */
+static void pattern_source_fill_payload(uint32_t *payload, uint32_t words, uint32_t sequence)
+{
+	uint32_t state = PATTERN_SOURCE_SEED_BASE + (sequence & (PATTERN_SOURCE_SEED_PERIOD - 1));
+	uint32_t i;
+
+	for (i = 0; i < words; ++i) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		payload[i] = state;
+	}
+}
+
+
+/**
+ * Refreshes the rate budget from the time elapsed since the last refill;
+ * budget beyond our cap is converted into accounted drops.
+ */
+static void pattern_source_refill_budget(void)
+{
+	uint32_t now = get_time();
+	uint32_t elapsed = now - pattern_source.budget_refilled;
+	uint64_t earned;
+
+	// Unpaced streams always have a chunk's worth of budget.
+	if (!pattern_source.rate) {
+		pattern_source.budget = PATTERN_SOURCE_CHUNK_SIZE;
+		return;
+	}
+
+	earned = ((uint64_t)elapsed * pattern_source.rate) / 1000000UL;
+	if (!earned) {
+		return;
+	}
+
+	pattern_source.budget_refilled = now;
+	earned += pattern_source.budget;
+
+	// If the budget has outgrown its cap, the transport has fallen behind
+	// the commanded rate: every excess chunk's worth is a chunk that
+	// should already have been sent, and is now a drop.
+	if (earned > PATTERN_SOURCE_MAX_BUDGET) {
+		uint32_t missed =
+				(earned - PATTERN_SOURCE_MAX_BUDGET) / PATTERN_SOURCE_CHUNK_SIZE;
+
+		pattern_source.chunks_dropped += missed;
+		pattern_source.sequence += missed;
+		earned -= (uint64_t)missed * PATTERN_SOURCE_CHUNK_SIZE;
+	}
+
+	pattern_source.budget = earned;
+}
+
+
+/**
+ * Scheduler task: generates and sends chunks while the transport has room
+ * and the commanded rate allows.
+ */
+static void pattern_source_task(void)
+{
+	if (!pattern_source.active) {
+		return;
+	}
+
+	pattern_source_refill_budget();
+
+	while ((pattern_source.chunks_produced - pattern_source.chunks_completed)
+			< PATTERN_SOURCE_CHUNK_COUNT) {
+
+		uint8_t *chunk = pattern_source.chunks[
+				pattern_source.chunks_produced % PATTERN_SOURCE_CHUNK_COUNT];
+		struct pattern_source_chunk_header *header = (void *)chunk;
+		int rc;
+
+		if (pattern_source.budget < PATTERN_SOURCE_CHUNK_SIZE) {
+			break;
+		}
+		if (!comms_pipe_ready(pattern_source.pipe)) {
+			break;
+		}
+
+		header->magic          = PATTERN_SOURCE_MAGIC;
+		header->sequence       = pattern_source.sequence;
+		header->timestamp      = get_time();
+		header->chunks_dropped = pattern_source.chunks_dropped;
+
+		pattern_source_fill_payload((uint32_t *)(chunk + sizeof(*header)),
+				(PATTERN_SOURCE_CHUNK_SIZE - sizeof(*header)) / sizeof(uint32_t),
+				pattern_source.sequence);
+
+		rc = comms_send_on_pipe(pattern_source.pipe, chunk, PATTERN_SOURCE_CHUNK_SIZE);
+		if (rc) {
+			// We checked readiness just above, so this should never happen;
+			// if it somehow does, account the chunk as dropped.
+			pattern_source.chunks_dropped++;
+			pattern_source.sequence++;
+			break;
+		}
+
+		pattern_source.chunks_produced++;
+		pattern_source.chunks_sent++;
+		pattern_source.sequence++;
+
+		if (pattern_source.rate) {
+			pattern_source.budget -= PATTERN_SOURCE_CHUNK_SIZE;
+		}
+	}
+}
+
+
+/**
+ * Periodic poll: kicks the generator, so pacing progresses even while no
+ * send completions are arriving.
+ */
+static void pattern_source_poll(void *argument)
+{
+	(void)argument;
+	scheduler_mark_task_ready(pattern_source_task);
+}
+
+
+/**
+ * Pipe callback: a chunk's send has completed, so its staging buffer --
+ * and a flow-control credit -- are ours again.
+ */
+static int pattern_source_handle_send_complete(void *data, uint32_t length)
+{
+	(void)data;
+	(void)length;
+
+	pattern_source.chunks_completed++;
+	scheduler_mark_task_ready(pattern_source_task);
+	return 0;
+}
+
+
+/**
+ * Verb: starts the pattern stream at the given rate, in bytes per second
+ * (0 streams as fast as the transport drains). The stream flows over the
+ * class's pipe, which the host should have opened first.
+ */
+static int pattern_source_verb_start(struct command_transaction *trans)
+{
+	uint32_t rate = comms_argument_parse_uint32_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	if (pattern_source.active) {
+		return EBUSY;
+	}
+
+	// On first use, register our pipe and generator with the streaming
+	// machinery; both registrations persist across stop/start cycles.
+	if (!pattern_source.pipe) {
+		struct comms_pipe_ops ops = {
+			.handle_data_out_complete = pattern_source_handle_send_complete,
+		};
+		int rc;
+
+		pattern_source.pipe = comms_register_pipe(
+				comms_get_class_by_number(CLASS_NUMBER_PATTERN_SOURCE), 0, ops);
+		if (!pattern_source.pipe) {
+			return EBUSY;
+		}
+
+		rc = scheduler_register_task(pattern_source_task, SCHEDULER_DEFAULT_PRIORITY);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	pattern_source.rate = rate;
+	pattern_source.budget = PATTERN_SOURCE_CHUNK_SIZE;
+	pattern_source.budget_refilled = get_time();
+
+	pattern_source.sequence = 0;
+	pattern_source.chunks_sent = 0;
+	pattern_source.chunks_dropped = 0;
+	pattern_source.chunks_produced = 0;
+	pattern_source.chunks_completed = 0;
+
+	pattern_source.active = true;
+
+	return software_timer_start(&pattern_source.poll_timer,
+			PATTERN_SOURCE_POLL_INTERVAL_US, true, pattern_source_poll, NULL);
+}
+
+
+/**
+ * Verb: stops an active pattern stream. Chunks already handed to the
+ * transport drain in the background.
+ */
+static int pattern_source_verb_stop(struct command_transaction *trans)
+{
+	(void)trans;
+
+	if (!pattern_source.active) {
+		return EINVAL;
+	}
+
+	software_timer_cancel(&pattern_source.poll_timer);
+	pattern_source.active = false;
+
+	return 0;
+}
+
+
+/**
+ * Verb: reports the stream's progress -- chunks sent, chunks dropped
+ * because the transport fell behind the commanded rate, and the rate
+ * itself -- so the host can reconcile its view against the device's.
+ */
+static int pattern_source_verb_get_statistics(struct command_transaction *trans)
+{
+	comms_response_add_uint32_t(trans, pattern_source.chunks_sent);
+	comms_response_add_uint32_t(trans, pattern_source.chunks_dropped);
+	comms_response_add_uint32_t(trans, pattern_source.rate);
+
+	return 0;
+}
+
+
+/**
+ * Verbs for the pattern-source API.
+ */
+static struct comms_verb pattern_source_verbs[] = {
+		{ .verb_number = 0x0, .name = "start", .handler = pattern_source_verb_start,
+				.in_signature = "<I", .out_signature = "",
+				.in_param_names = COMMS_PARAM_NAMES("rate"),
+				.doc = COMMS_DOC("Starts the pattern stream at the given rate, in bytes per\n"
+						"second; 0 streams as fast as the transport drains.") },
+		{ .verb_number = 0x1, .name = "stop", .handler = pattern_source_verb_stop,
+				.in_signature = "", .out_signature = "",
+				.doc = COMMS_DOC("Stops an active pattern stream.") },
+		{ .verb_number = 0x2, .name = "get_statistics", .handler = pattern_source_verb_get_statistics,
+				.in_signature = "", .out_signature = "<III",
+				.out_param_names = COMMS_PARAM_NAMES("chunks_sent, chunks_dropped, rate"),
+				.doc = COMMS_DOC("Reports chunks sent, chunks dropped behind the commanded\n"
+						"rate, and the rate itself.") },
+		{} // Sentinel
+};
+COMMS_DEFINE_SIMPLE_CLASS(pattern_source_api, CLASS_NUMBER_PATTERN_SOURCE, "pattern_source",
+		pattern_source_verbs,
+		"Reference streaming pattern source, for end-to-end throughput regression testing.");
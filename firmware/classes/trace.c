@@ -0,0 +1,125 @@
+/*
+ * This file is part of libgreat
+ *
+ * Trace communications class -- lets the host drain and decode the binary
+ * trace ring with zero device-side formatting cost.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <toolchain.h>
+
+#include <drivers/comms.h>
+#include <drivers/trace.h>
+
+// Class number reserved for the libgreat trace facility.
+#define CLASS_NUMBER_TRACE 0x2
+
+// Longest format string we'll return from describe_format.
+#define TRACE_FORMAT_STRING_MAX 256
+
+
+/**
+ * Drains binary trace records into the response. Each record is returned
+ * raw -- format-string address, timestamp, argument count, and argument
+ * words -- for the host to decode offline.
+ */
+static int verb_read_records(struct command_transaction *trans)
+{
+	uint32_t max_records = comms_argument_parse_uint32_t(trans);
+	trace_record_t *response_records;
+	unsigned records_read;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	// Bound the drain by the response space we can actually reserve.
+	uint32_t space_limit = trans->data_out_max_length / sizeof(trace_record_t);
+	if (max_records > space_limit) {
+		max_records = space_limit;
+	}
+
+	// Reserve room for a full drain, read directly into the response, and
+	// return any unused reservation.
+	response_records = comms_response_reserve_space(trans, max_records * sizeof(trace_record_t));
+	if (!response_records) {
+		return ENOSPC;
+	}
+
+	records_read = trace_read_records(response_records, max_records);
+
+	// Return the unused portion of our reservation.
+	uint32_t unused = (max_records - records_read) * sizeof(trace_record_t);
+	trans->data_out_length -= unused;
+	trans->data_out_position = ((uint8_t *)trans->data_out_position) - unused;
+
+	return 0;
+}
+
+
+/**
+ * Reports the ring's bookkeeping: how many records were dropped because the
+ * ring was full, and the size of each record, so hosts can parse responses.
+ */
+static int verb_get_statistics(struct command_transaction *trans)
+{
+	comms_response_add_uint32_t(trans, trace_records_dropped());
+	comms_response_add_uint32_t(trans, sizeof(trace_record_t));
+	comms_response_add_uint32_t(trans, TRACE_RECORD_MAX_ARGS);
+
+	return 0;
+}
+
+
+/**
+ * Resolves a record's format-string address to its text, so the host can
+ * render records without a copy of the firmware image. Trusted-host debug
+ * functionality: the address is only sanity-checked, not validated.
+ */
+static int verb_describe_format(struct command_transaction *trans)
+{
+	uint32_t address = comms_argument_parse_uint32_t(trans);
+	const char *format = (const char *)address;
+	char bounded_format[TRACE_FORMAT_STRING_MAX];
+	unsigned length = 0;
+
+	if (!comms_transaction_okay(trans) || !address) {
+		return EINVAL;
+	}
+
+	// Copy up to our maximum length, so an unterminated or bogus pointer
+	// can't walk the response off the end of memory.
+	while ((length < (TRACE_FORMAT_STRING_MAX - 1)) && format[length]) {
+		bounded_format[length] = format[length];
+		++length;
+	}
+	bounded_format[length] = 0;
+
+	comms_response_add_string(trans, bounded_format);
+	return 0;
+}
+
+
+/**
+ * Verbs for the trace API.
+ */
+static struct comms_verb trace_verbs[] = {
+		{ .verb_number = 0x0, .name = "read_records", .handler = verb_read_records,
+				.in_signature = "<I", .out_signature = "<*X",
+				.in_param_names = COMMS_PARAM_NAMES("max_records"), .out_param_names = COMMS_PARAM_NAMES("records"),
+				.doc = COMMS_DOC("Drains raw binary trace records from the device's trace ring.") },
+		{ .verb_number = 0x1, .name = "get_statistics", .handler = verb_get_statistics,
+				.in_signature = "", .out_signature = "<III",
+				.out_param_names = COMMS_PARAM_NAMES("records_dropped, record_size, max_args"),
+				.doc = COMMS_DOC("Reports trace-ring bookkeeping and record geometry.") },
+		{ .verb_number = 0x2, .name = "describe_format", .handler = verb_describe_format,
+				.in_signature = "<I", .out_signature = "<S",
+				.in_param_names = COMMS_PARAM_NAMES("address"), .out_param_names = COMMS_PARAM_NAMES("format_string"),
+				.doc = COMMS_DOC("Resolves a trace record's format-string address to its text.") },
+		{} // Sentinel
+};
+COMMS_DEFINE_SIMPLE_CLASS(trace_api, CLASS_NUMBER_TRACE, "trace", trace_verbs,
+		"API for draining the device's deferred binary trace log.");
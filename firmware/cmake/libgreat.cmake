@@ -5,6 +5,25 @@
 include_guard()
 
 include(CMakeDependentOption)
+include(CMakeParseArguments)
+
+#
+# Per-module code-generation control; see libgreat_module_optimize().
+#
+option(LIBGREAT_PER_MODULE_OPTIMIZATION
+	"Honor the per-module optimization levels requested with libgreat_module_optimize()." ON)
+option(LIBGREAT_ENABLE_LTO
+	"Compile modules flagged for it with link-time optimization." OFF)
+option(LIBGREAT_MODULE_RAM_TEXT
+	"Place the text of modules flagged for it in zero-wait-state RAM, alongside ATTR_HOT_RAM functions." OFF)
+option(LIBGREAT_STRIP_VERB_DOCUMENTATION
+	"Strip verb documentation and parameter-name strings from the comms tables, reclaiming flash; hosts fall back to their bundled documentation." OFF)
+
+# Stripped metadata is a whole-image property: every module's verb tables
+# must agree, so this rides in the common defines rather than per-target.
+if (LIBGREAT_STRIP_VERB_DOCUMENTATION)
+	list(APPEND DEFINES_COMMON -DLIBGREAT_STRIP_VERB_DOCUMENTATION)
+endif()
 
 # Horrible hack: use libopencm3, for now.
 include ("${PATH_LIBGREAT_FIRMWARE}/cmake/libopencm3.cmake")
@@ -53,6 +72,11 @@ function(add_flash_executable EXECUTABLE_NAME)
 
 	target_link_libraries(${EXECUTABLE_NAME}.elf PRIVATE c nosys ${LINK_LIBRARIES_BOARD} m)
 
+	# If any modules were built with LTO, the link is where their optimization happens.
+	if (LIBGREAT_ENABLE_LTO)
+		target_link_options(${EXECUTABLE_NAME}.elf PRIVATE -flto)
+	endif()
+
 	# Add a target that creates the final binary.
 	add_custom_target(${EXECUTABLE_NAME} ALL DEPENDS ${EXECUTABLE_NAME}.elf COMMAND ${CMAKE_OBJCOPY} -Obinary ${EXECUTABLE_NAME}.elf ${EXECUTABLE_NAME})
 
@@ -169,6 +193,80 @@ function(define_libgreat_module MODULE_NAME)
 endfunction(define_libgreat_module)
 
 
+#
+# Adjusts the code generation used for a given libgreat module -- e.g. to build hot-path
+# modules for speed while the rest of the image stays optimized for size.
+#
+# Because use_libgreat_modules() re-adds a module's sources to each consumer, the options
+# selected here are recorded on the module target and re-applied to those sources as
+# source-file properties when the module is consumed.
+#
+# Arguments: <module_name>
+#     [LEVEL <flag>] -- an optimization-level flag (e.g. -O3) to build this module with
+#     [LTO]          -- build this module with link-time optimization, if LIBGREAT_ENABLE_LTO is set
+#     [RAM_TEXT]     -- place this module's program text in zero-wait-state RAM, if
+#                       LIBGREAT_MODULE_RAM_TEXT is set; the module is then collected into a
+#                       "libgreat_hotram" archive, which our linker scripts divert into .ram_text
+#
+function(libgreat_module_optimize MODULE_NAME)
+	cmake_parse_arguments(OPTIMIZE "LTO;RAM_TEXT" "LEVEL" "" ${ARGN})
+	set(MODULE_OBJECT libgreat_module_${MODULE_NAME})
+
+	# Ensure the relevant module has been defined before we try to flag it.
+	if (NOT TARGET ${MODULE_OBJECT})
+		message(FATAL_ERROR "Cannot adjust code generation for unknown libgreat module '${MODULE_NAME}'--"
+			" flag modules only after their define_libgreat_module().")
+	endif()
+
+	# Collect the code-generation options this module should carry...
+	set(CODEGEN_OPTIONS "")
+	if (OPTIMIZE_LEVEL AND LIBGREAT_PER_MODULE_OPTIMIZATION)
+		list(APPEND CODEGEN_OPTIONS ${OPTIMIZE_LEVEL})
+	endif()
+	if (OPTIMIZE_LTO AND LIBGREAT_ENABLE_LTO)
+		list(APPEND CODEGEN_OPTIONS -flto)
+	endif()
+
+	# ... record them on the module, and apply them to its standalone objects.
+	if (CODEGEN_OPTIONS)
+		set_target_properties(${MODULE_OBJECT} PROPERTIES LIBGREAT_CODEGEN_OPTIONS "${CODEGEN_OPTIONS}")
+		target_compile_options(${MODULE_OBJECT} PRIVATE ${CODEGEN_OPTIONS})
+	endif()
+
+	# If this module's text should run from RAM, collect the module into a static archive
+	# whose name ("libgreat_hotram*") our flash linker scripts recognize; their .ram_text
+	# output section claims those archives' text, and crt0 copies it up at start of day.
+	if (OPTIMIZE_RAM_TEXT AND LIBGREAT_MODULE_RAM_TEXT)
+		get_target_property(MODULE_SOURCES ${MODULE_OBJECT} SOURCES)
+
+		add_library(libgreat_hotram_${MODULE_NAME} STATIC ${MODULE_SOURCES})
+		set_target_properties(libgreat_hotram_${MODULE_NAME} PROPERTIES
+			OUTPUT_NAME great_hotram_${MODULE_NAME})
+
+		# Build the archive with the same environment as any other libgreat library,
+		# plus this module's code-generation options.
+		target_include_directories(libgreat_hotram_${MODULE_NAME} PRIVATE
+			${BOARD_INCLUDE_DIRECTORIES}
+			${BUILD_INCLUDE_DIRECTORIES}
+			${PATH_LIBOPENCM3}/include
+			${PATH_GREATFET_FIRMWARE_COMMON} #XXX: remove this!
+			${PATH_LIBGREAT_FIRMWARE}/include
+			${PATH_LIBGREAT_FIRMWARE_PLATFORM}/include
+		)
+		target_compile_options(libgreat_hotram_${MODULE_NAME} PRIVATE
+			${FLAGS_COMPILE_COMMON} ${FLAGS_PLATFORM} ${FLAGS_ARCHITECTURE} ${FLAGS_MAIN_CPU}
+			${CODEGEN_OPTIONS})
+		target_compile_definitions(libgreat_hotram_${MODULE_NAME} PRIVATE ${DEFINES_COMMON} ${DEFINES_BOARD})
+		add_dependencies(libgreat_hotram_${MODULE_NAME} libopencm3)
+
+		# Mark the module, so use_libgreat_modules() links the archive in place of the sources.
+		set_target_properties(${MODULE_OBJECT} PROPERTIES
+			LIBGREAT_RAM_TEXT_ARCHIVE libgreat_hotram_${MODULE_NAME})
+	endif()
+
+endfunction(libgreat_module_optimize)
+
+
 #
 # Provides the include paths necessary to use a given libgreat module. Will automatically be added to the include path
 # for the relevant libgreat module.
@@ -206,9 +304,29 @@ function(use_libgreat_modules TARGET_NAME)
 		# Ensure that the relevant target depends on the given module...
 		add_dependencies(${TARGET_NAME} libgreat_module_${MODULE})
 
-		# ... and include the module's sources in the target.
-		get_target_property(MODULE_SOURCES libgreat_module_${MODULE} SOURCES)
-		target_sources(${TARGET_NAME} PRIVATE ${MODULE_SOURCES})
+		# If this module's text is collected into a RAM-placed archive, link that archive
+		# into executable consumers rather than re-compiling the module's sources into them;
+		# it's wrapped in --whole-archive so nothing in it is dropped for lack of references.
+		get_target_property(RAM_TEXT_ARCHIVE ${MODULE_OBJECT} LIBGREAT_RAM_TEXT_ARCHIVE)
+		get_target_property(CONSUMER_TYPE ${TARGET_NAME} TYPE)
+		if (RAM_TEXT_ARCHIVE AND (CONSUMER_TYPE STREQUAL "EXECUTABLE"))
+			target_link_libraries(${TARGET_NAME} PRIVATE
+				-Wl,--whole-archive ${RAM_TEXT_ARCHIVE} -Wl,--no-whole-archive)
+		else()
+
+			# ... and include the module's sources in the target.
+			get_target_property(MODULE_SOURCES libgreat_module_${MODULE} SOURCES)
+			target_sources(${TARGET_NAME} PRIVATE ${MODULE_SOURCES})
+
+			# Carry any code-generation options requested for this module onto its sources
+			# within this consumer; these have to be source-file properties, as the sources
+			# are compiled here rather than in the module's own object library.
+			get_target_property(CODEGEN_OPTIONS ${MODULE_OBJECT} LIBGREAT_CODEGEN_OPTIONS)
+			if (CODEGEN_OPTIONS)
+				string(REPLACE ";" " " CODEGEN_FLAGS "${CODEGEN_OPTIONS}")
+				set_source_files_properties(${MODULE_SOURCES} PROPERTIES COMPILE_FLAGS "${CODEGEN_FLAGS}")
+			endif()
+		endif()
 
 		# Set a definition that marks that we have the relevant module.
 		string(TOUPPER "${MODULE}" MODULE_UPPERCASE)
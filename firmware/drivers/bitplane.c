@@ -0,0 +1,81 @@
+/*
+ * This file is part of libgreat
+ *
+ * Bit-plane transposition kernels; see <drivers/bitplane.h> for an overview
+ * of the layouts involved.
+ */
+
+#include <toolchain.h>
+#include <drivers/bitplane.h>
+
+
+/**
+ * Transposes a 32x32 bit matrix in place; see <drivers/bitplane.h>.
+ *
+ * This is the classic recursive-halving network: each stage treats the
+ * matrix as 2x2 blocks of half-size sub-matrices and swaps the two
+ * off-diagonal sub-matrices, using a shift and mask to move all of a word's
+ * relevant bits at once. Five stages of 16 word-pair swaps each fully
+ * transpose the matrix.
+ */
+void bitplane_transpose_32x32(uint32_t block[32])
+{
+	// Mask selecting, for each stage, the bits destined for the lower word
+	// of each pair: bits whose index has the stage's stride bit clear.
+	uint32_t mask = 0x0000FFFFUL;
+
+	for (unsigned stride = 16; stride; stride >>= 1, mask ^= mask << stride) {
+		for (unsigned i = 0; i < 32; i = (i + stride + 1) & ~stride) {
+
+			// Compute the difference between the two off-diagonal sub-blocks,
+			// aligned to the lower word -- and then apply it to both, which
+			// swaps their contents.
+			uint32_t delta = ((block[i] >> stride) ^ block[i + stride]) & mask;
+			block[i]          ^= delta << stride;
+			block[i + stride] ^= delta;
+		}
+	}
+}
+
+
+/**
+ * Converts one 32-sample block from bit-plane to sample-major layout, for
+ * buses of up to eight channels; see <drivers/bitplane.h>.
+ */
+void bitplane_to_samples_u8(const uint32_t *planes, unsigned channel_count, uint8_t samples[32])
+{
+	uint32_t block[32] = {0};
+
+	// Place each channel's plane in the matrix row matching its bit position;
+	// the unused rows stay zero, so the unused sample bits come out zero.
+	for (unsigned channel = 0; channel < channel_count; ++channel) {
+		block[channel] = planes[channel];
+	}
+
+	bitplane_transpose_32x32(block);
+
+	// Each transposed word now holds one sample in its low bits.
+	for (unsigned sample = 0; sample < 32; ++sample) {
+		samples[sample] = block[sample];
+	}
+}
+
+
+/**
+ * Converts one 32-sample block from sample-major back to bit-plane layout,
+ * for buses of up to eight channels; see <drivers/bitplane.h>.
+ */
+void bitplane_from_samples_u8(const uint8_t samples[32], unsigned channel_count, uint32_t *planes)
+{
+	uint32_t block[32];
+
+	for (unsigned sample = 0; sample < 32; ++sample) {
+		block[sample] = samples[sample];
+	}
+
+	bitplane_transpose_32x32(block);
+
+	for (unsigned channel = 0; channel < channel_count; ++channel) {
+		planes[channel] = block[channel];
+	}
+}
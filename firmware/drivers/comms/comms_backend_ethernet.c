@@ -0,0 +1,378 @@
+/*
+ * This file is part of libgreat
+ *
+ * Ethernet (UDP) backend to the libgreat communications API.
+ *
+ * Carries the same prelude-plus-arguments command framing as the USB
+ * backend, but over UDP datagrams -- command latency over a switched LAN
+ * beats USB control transfers, and using the network for commands frees
+ * the USB port entirely for streaming. The device has no general-purpose
+ * IP stack; this file implements just enough ARP and IPv4/UDP to answer
+ * queries for its address and exchange single-datagram requests.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <drivers/comms.h>
+#include <drivers/comms_backend.h>
+#include <drivers/comms_backend_ethernet.h>
+
+// Request flags, matching the values the USB backend accepts in wIndex.
+#define LIBGREAT_REQUEST_FLAG_SKIP_RESPONSE (1 << 0)
+#define LIBGREAT_REQUEST_FLAG_BATCH         (1 << 2)
+
+// Ethertypes and protocol numbers we care about.
+#define ETHERTYPE_IPV4        0x0800
+#define ETHERTYPE_ARP         0x0806
+#define IP_PROTOCOL_UDP       17
+
+// ARP opcodes.
+#define ARP_OPCODE_REQUEST    1
+#define ARP_OPCODE_REPLY      2
+
+// The largest response payload a single non-fragmented datagram can carry:
+// a 1500-byte MTU, less the IPv4 and UDP headers and our transport header.
+#define LIBGREAT_ETHERNET_MAX_RESPONSE \
+	(1500 - sizeof(ipv4_header_t) - sizeof(udp_header_t) - sizeof(struct libgreat_ethernet_header))
+
+
+/** Layer-2 ethernet frame header. */
+typedef struct ATTR_PACKED {
+	uint8_t destination[6];
+	uint8_t source[6];
+	uint16_t ethertype;
+} ethernet_header_t;
+
+
+/** ARP packet, as used for IPv4-over-ethernet resolution. */
+typedef struct ATTR_PACKED {
+	uint16_t hardware_type;
+	uint16_t protocol_type;
+	uint8_t hardware_length;
+	uint8_t protocol_length;
+	uint16_t opcode;
+	uint8_t sender_hardware_address[6];
+	uint8_t sender_protocol_address[4];
+	uint8_t target_hardware_address[6];
+	uint8_t target_protocol_address[4];
+} arp_packet_t;
+
+
+/** IPv4 header, without options. */
+typedef struct ATTR_PACKED {
+	uint8_t version_and_header_length;
+	uint8_t type_of_service;
+	uint16_t total_length;
+	uint16_t identification;
+	uint16_t flags_and_fragment_offset;
+	uint8_t time_to_live;
+	uint8_t protocol;
+	uint16_t header_checksum;
+	uint8_t source[4];
+	uint8_t destination[4];
+} ipv4_header_t;
+
+
+/** UDP header. */
+typedef struct ATTR_PACKED {
+	uint16_t source_port;
+	uint16_t destination_port;
+	uint16_t length;
+	uint16_t checksum;
+} udp_header_t;
+
+
+/** All of the headers that precede a response's payload, contiguously. */
+typedef struct ATTR_PACKED {
+	ethernet_header_t ethernet;
+	ipv4_header_t ip;
+	udp_header_t udp;
+	struct libgreat_ethernet_header libgreat;
+} response_headers_t;
+
+
+struct comm_backend_driver ethernet_backend_driver = {
+	.name = "Ethernet",
+};
+
+// The controller carrying command traffic, and our IPv4 address.
+static ethernet_controller_t *comms_ethernet_device;
+static uint8_t comms_ethernet_ip[4];
+
+// The active transaction, mirroring the USB backend's bookkeeping.
+static struct command_transaction active_transaction;
+
+// Staging for outgoing frames: headers and response payload are transmitted
+// as two chained segments, so the payload never needs a gather copy.
+static response_headers_t response_headers;
+static uint8_t ethernet_data_out_buffer[LIBGREAT_ETHERNET_MAX_RESPONSE] ATTR_ALIGNED(4);
+
+// Staging for ARP replies, which are small enough to build whole.
+static struct ATTR_PACKED {
+	ethernet_header_t ethernet;
+	arp_packet_t arp;
+} arp_reply;
+
+
+/** Byte-order helper; the wire is big-endian, the processor is not. */
+static uint16_t comms_ethernet_htons(uint16_t value)
+{
+	return (value >> 8) | (value << 8);
+}
+
+
+/** Computes the ones'-complement checksum IPv4 requires of its header. */
+static uint16_t comms_ethernet_ip_checksum(const void *data, size_t length)
+{
+	const uint8_t *bytes = data;
+	uint32_t sum = 0;
+
+	for (size_t i = 0; i < length; i += 2) {
+		sum += (bytes[i] << 8) | bytes[i + 1];
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return comms_ethernet_htons(~sum);
+}
+
+
+/** Resets our positions in the active transaction, per the USB backend. */
+static void comms_ethernet_clear_position_in_active_transaction(void)
+{
+	active_transaction.data_out_length = 0;
+	active_transaction.data_in_position = active_transaction.data_in;
+	active_transaction.data_out_position = active_transaction.data_out;
+	active_transaction.data_in_remaining = active_transaction.data_in_length;
+	active_transaction.data_in_status = COMMS_PARSE_OKAY;
+	active_transaction.data_out_status = COMMS_PARSE_OKAY;
+	active_transaction.last_error_number = 0;
+}
+
+
+/**
+ * Answers an ARP query for our address, so hosts can find us without
+ * static neighbor entries.
+ */
+static void comms_ethernet_handle_arp(const ethernet_header_t *frame_header, const arp_packet_t *request)
+{
+	if ((comms_ethernet_htons(request->opcode) != ARP_OPCODE_REQUEST) ||
+			memcmp(request->target_protocol_address, comms_ethernet_ip, 4)) {
+		return;
+	}
+
+	// Frames share a single staging buffer; wait out any transmit in flight.
+	while (!ethernet_transmit_complete(comms_ethernet_device));
+
+	memcpy(arp_reply.ethernet.destination, frame_header->source, 6);
+	memcpy(arp_reply.ethernet.source, comms_ethernet_device->mac_address, 6);
+	arp_reply.ethernet.ethertype = comms_ethernet_htons(ETHERTYPE_ARP);
+
+	arp_reply.arp = *request;
+	arp_reply.arp.opcode = comms_ethernet_htons(ARP_OPCODE_REPLY);
+	memcpy(arp_reply.arp.sender_hardware_address, comms_ethernet_device->mac_address, 6);
+	memcpy(arp_reply.arp.sender_protocol_address, comms_ethernet_ip, 4);
+	memcpy(arp_reply.arp.target_hardware_address, request->sender_hardware_address, 6);
+	memcpy(arp_reply.arp.target_protocol_address, request->sender_protocol_address, 4);
+
+	ethernet_transmit_frame(comms_ethernet_device, &arp_reply, sizeof(arp_reply));
+}
+
+
+/**
+ * Builds and queues the response datagram for a completed command, echoing
+ * the request's addressing and sequence number back at the sender.
+ */
+static void comms_ethernet_send_response(const ethernet_header_t *request_ethernet,
+		const ipv4_header_t *request_ip, const udp_header_t *request_udp, uint32_t sequence)
+{
+	uint32_t payload_length = active_transaction.data_out_length;
+	const void *segments[2];
+	uint32_t lengths[2];
+
+	if (payload_length > sizeof(ethernet_data_out_buffer)) {
+		payload_length = sizeof(ethernet_data_out_buffer);
+	}
+
+	// The previous response shares our header staging; wait it out.
+	while (!ethernet_transmit_complete(comms_ethernet_device));
+
+	// Layer 2: straight back at the requester.
+	memcpy(response_headers.ethernet.destination, request_ethernet->source, 6);
+	memcpy(response_headers.ethernet.source, comms_ethernet_device->mac_address, 6);
+	response_headers.ethernet.ethertype = comms_ethernet_htons(ETHERTYPE_IPV4);
+
+	// Layer 3: a minimal, unfragmented IPv4 header.
+	response_headers.ip.version_and_header_length = 0x45;
+	response_headers.ip.type_of_service = 0;
+	response_headers.ip.total_length = comms_ethernet_htons(sizeof(ipv4_header_t) +
+			sizeof(udp_header_t) + sizeof(struct libgreat_ethernet_header) + payload_length);
+	response_headers.ip.identification = 0;
+	response_headers.ip.flags_and_fragment_offset = comms_ethernet_htons(0x4000);
+	response_headers.ip.time_to_live = 64;
+	response_headers.ip.protocol = IP_PROTOCOL_UDP;
+	response_headers.ip.header_checksum = 0;
+	memcpy(response_headers.ip.source, comms_ethernet_ip, 4);
+	memcpy(response_headers.ip.destination, request_ip->source, 4);
+	response_headers.ip.header_checksum =
+			comms_ethernet_ip_checksum(&response_headers.ip, sizeof(ipv4_header_t));
+
+	// Layer 4: swap the ports; a zero UDP checksum is valid for IPv4.
+	response_headers.udp.source_port = comms_ethernet_htons(LIBGREAT_ETHERNET_PORT);
+	response_headers.udp.destination_port = request_udp->source_port;
+	response_headers.udp.length = comms_ethernet_htons(sizeof(udp_header_t) +
+			sizeof(struct libgreat_ethernet_header) + payload_length);
+	response_headers.udp.checksum = 0;
+
+	// Transport header: echo the sequence; report the command's status.
+	response_headers.libgreat.sequence = sequence;
+	response_headers.libgreat.flags = active_transaction.last_error_number;
+
+	// Send the headers and the payload as two chained segments.
+	segments[0] = &response_headers;
+	lengths[0] = sizeof(response_headers);
+	segments[1] = ethernet_data_out_buffer;
+	lengths[1] = payload_length;
+
+	ethernet_transmit_chained(comms_ethernet_device, segments, lengths, payload_length ? 2 : 1);
+}
+
+
+/**
+ * Executes a libgreat command carried in a UDP datagram, and responds.
+ */
+static void comms_ethernet_handle_command(const ethernet_header_t *frame_header,
+		const ipv4_header_t *ip, const udp_header_t *udp, uint8_t *payload, uint32_t payload_length)
+{
+	struct libgreat_ethernet_header *transport = (void *)payload;
+	struct libgreat_command_prelude *prelude = (void *)(payload + sizeof(*transport));
+
+	// Runt datagrams can't carry a command; ignore them.
+	if (payload_length < (sizeof(*transport) + sizeof(*prelude))) {
+		return;
+	}
+
+	bool skip_response = (transport->flags & LIBGREAT_REQUEST_FLAG_SKIP_RESPONSE);
+	bool is_batch = (transport->flags & LIBGREAT_REQUEST_FLAG_BATCH);
+
+	// Populate the transaction: arguments are parsed in place from the
+	// received frame, and the response is built in our staging buffer.
+	active_transaction.class_number = prelude->class_number;
+	active_transaction.verb = prelude->verb;
+	active_transaction.data_in = (uint8_t *)prelude + sizeof(*prelude);
+	active_transaction.data_in_length = payload_length - sizeof(*transport) - sizeof(*prelude);
+	active_transaction.data_out = ethernet_data_out_buffer;
+	active_transaction.data_out_max_length = sizeof(ethernet_data_out_buffer);
+	active_transaction.buffers_are_transfer_memory = false;
+	comms_ethernet_clear_position_in_active_transaction();
+
+	if (is_batch) {
+		active_transaction.last_error_number =
+				comms_backend_submit_batch(&ethernet_backend_driver, &active_transaction);
+	} else {
+		active_transaction.last_error_number =
+				comms_backend_submit_command(&ethernet_backend_driver, &active_transaction);
+	}
+
+	// Failed commands respond with their status and no payload, standing in
+	// for the stall the USB backend would issue.
+	if (active_transaction.last_error_number) {
+		active_transaction.data_out_length = 0;
+	}
+
+	if (!skip_response) {
+		comms_ethernet_send_response(frame_header, ip, udp, transport->sequence);
+	}
+}
+
+
+/**
+ * Classifies a received frame, and routes it to the ARP or command path.
+ */
+static void comms_ethernet_handle_frame(uint8_t *frame, uint32_t length)
+{
+	ethernet_header_t *frame_header = (void *)frame;
+
+	if (length < sizeof(*frame_header)) {
+		return;
+	}
+
+	switch (comms_ethernet_htons(frame_header->ethertype)) {
+
+		case ETHERTYPE_ARP:
+			if (length >= (sizeof(*frame_header) + sizeof(arp_packet_t))) {
+				comms_ethernet_handle_arp(frame_header, (void *)(frame + sizeof(*frame_header)));
+			}
+			break;
+
+		case ETHERTYPE_IPV4: {
+			ipv4_header_t *ip = (void *)(frame + sizeof(*frame_header));
+			udp_header_t *udp;
+			uint32_t udp_length;
+
+			if (length < (sizeof(*frame_header) + sizeof(*ip) + sizeof(*udp))) {
+				break;
+			}
+
+			// Only unfragmented, option-less UDP addressed to us and to our
+			// port is of interest; everything else is quietly ignored.
+			if ((ip->version_and_header_length != 0x45) || (ip->protocol != IP_PROTOCOL_UDP) ||
+					memcmp(ip->destination, comms_ethernet_ip, 4)) {
+				break;
+			}
+
+			udp = (void *)((uint8_t *)ip + sizeof(*ip));
+			if (udp->destination_port != comms_ethernet_htons(LIBGREAT_ETHERNET_PORT)) {
+				break;
+			}
+
+			udp_length = comms_ethernet_htons(udp->length);
+			if ((udp_length < sizeof(*udp)) ||
+					(length < (sizeof(*frame_header) + sizeof(*ip) + udp_length))) {
+				break;
+			}
+
+			comms_ethernet_handle_command(frame_header, ip, udp,
+					(uint8_t *)udp + sizeof(*udp), udp_length - sizeof(*udp));
+			break;
+		}
+	}
+}
+
+
+/**
+ * Frame-received callback: drains and dispatches every pending frame.
+ */
+static void comms_ethernet_frames_ready(ethernet_controller_t *device)
+{
+	uint8_t *frame;
+	uint32_t length;
+
+	while ((frame = ethernet_read_frame(device, &length))) {
+		comms_ethernet_handle_frame(frame, length);
+		ethernet_release_frame(device, frame);
+	}
+}
+
+
+/**
+ * Attaches the libgreat command protocol to an ethernet controller.
+ * Should be called after ethernet_init(), but before ethernet_start().
+ */
+int comms_backend_ethernet_init(ethernet_controller_t *device, const uint8_t *ip_address)
+{
+	if (!device || !ip_address) {
+		return EINVAL;
+	}
+
+	comms_ethernet_device = device;
+	memcpy(comms_ethernet_ip, ip_address, 4);
+
+	device->frame_received_callback = comms_ethernet_frames_ready;
+	return 0;
+}
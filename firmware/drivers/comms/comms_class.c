@@ -10,12 +10,94 @@
 #include <errno.h>
 #include <stdbool.h>
 
+#include <toolchain.h>
+
 #include <drivers/comms.h>
 #include <drivers/comms_backend.h>
 
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+#include <string.h>
+#include <drivers/arm_profiling.h>
+#endif
+
 /** Head for the comms-class linked list. */
 struct comms_class *class_head = NULL;
 
+/**
+ * Open-addressing hash index over registered classes, so the command hot path
+ * doesn't have to chase the linked list for every transaction. Built
+ * incrementally at registration time; must be a power of two in size.
+ * If the table ever fills up, lookups gracefully fall back to the list walk.
+ */
+#define COMMS_CLASS_INDEX_SIZE 64
+static struct comms_class *class_index[COMMS_CLASS_INDEX_SIZE];
+
+/** Simple multiplicative hash; class numbers are sparse but well-distributed. */
+static inline uint32_t comms_class_index_slot(uint32_t class_number)
+{
+	return (class_number * 2654435761u) & (COMMS_CLASS_INDEX_SIZE - 1);
+}
+
+
+/**
+ * Adds a class to the dispatch index. Quietly does nothing if the index is
+ * full; lookups will still find the class via the linked list.
+ */
+static void comms_class_index_insert(struct comms_class *comms_class)
+{
+	uint32_t slot = comms_class_index_slot(comms_class->class_number);
+	uint32_t probes;
+
+	for (probes = 0; probes < COMMS_CLASS_INDEX_SIZE; ++probes) {
+		if (!class_index[slot]) {
+			class_index[slot] = comms_class;
+			return;
+		}
+
+		// Re-registration of the same class number replaces the index entry,
+		// mirroring the behavior of the linked list (newest first).
+		if (class_index[slot]->class_number == comms_class->class_number) {
+			class_index[slot] = comms_class;
+			return;
+		}
+
+		slot = (slot + 1) & (COMMS_CLASS_INDEX_SIZE - 1);
+	}
+
+	pr_warning("comms: class dispatch index is full; class %" PRIu32 " will dispatch slowly\n",
+			comms_class->class_number);
+}
+
+
+/**
+ * Populates a class's dispatch metadata: its verb count, and whether its verb
+ * numbers are dense (0 .. n-1 in array order), which allows dispatch to index
+ * the verb array directly.
+ */
+static void comms_class_compute_verb_metadata(struct comms_class *comms_class)
+{
+	struct comms_verb *verb;
+	uint32_t count = 0;
+	bool dense = true;
+
+	comms_class->verb_count = 0;
+	comms_class->verbs_are_dense = false;
+
+	if (!comms_class->command_verbs) {
+		return;
+	}
+
+	for (verb = comms_class->command_verbs; verb->handler; ++verb) {
+		if (verb->verb_number != count) {
+			dense = false;
+		}
+		++count;
+	}
+
+	comms_class->verb_count = count;
+	comms_class->verbs_are_dense = dense;
+}
+
 
 /**
  * Determines whether a provided comms class requires verb-number auto-assignments.
@@ -75,9 +157,53 @@ void comms_register_class(struct comms_class *comms_class)
 		comms_auto_assign_verb_numbers(comms_class);
 	}
 
+	// Populate the class's dispatch metadata, so verb lookup can avoid
+	// scanning the verb array where possible.
+	comms_class_compute_verb_metadata(comms_class);
+
 	// Link the comms class into our linked list.
 	comms_class->next = class_head;
 	class_head = comms_class;
+
+	// And add it to the dispatch index, so class lookup is O(1) on the
+	// command hot path.
+	comms_class_index_insert(comms_class);
+}
+
+
+/**
+ * Indexes every class registered via the flash-resident class table
+ * (see COMMS_DEFINE_SIMPLE_CONST_CLASS). These classes carry their dispatch
+ * metadata from compile time, so the only startup work is an index insert --
+ * no verb assignment, no metadata scan, and no RAM-resident class structure.
+ */
+static void comms_index_rom_classes(void)
+{
+	const struct comms_class *const *entry;
+
+	for (entry = __comms_class_table_start; entry < __comms_class_table_end; ++entry) {
+		// Safe cast: the dispatch path only ever reads table-registered classes.
+		comms_class_index_insert((struct comms_class *)*entry);
+	}
+}
+CALL_ON_INIT(comms_index_rom_classes)
+
+
+/**
+ * Searches the flash-resident class table for a class with the given number.
+ * Only needed if the dispatch index has overflowed.
+ */
+static struct comms_class *comms_find_rom_class(uint32_t class_number)
+{
+	const struct comms_class *const *entry;
+
+	for (entry = __comms_class_table_start; entry < __comms_class_table_end; ++entry) {
+		if ((*entry)->class_number == class_number) {
+			return (struct comms_class *)*entry;
+		}
+	}
+
+	return NULL;
 }
 
 
@@ -88,15 +214,35 @@ void comms_register_class(struct comms_class *comms_class)
 struct comms_class *comms_get_class_by_number(uint32_t class_number)
 {
 	struct comms_class *cls;
+	uint32_t slot = comms_class_index_slot(class_number);
+	uint32_t probes;
+
+	// Fast path: probe the dispatch index.
+	for (probes = 0; probes < COMMS_CLASS_INDEX_SIZE; ++probes) {
+		cls = class_index[slot];
+
+		// An empty slot terminates the probe sequence; the class isn't
+		// in the index.
+		if (!cls) {
+			break;
+		}
+
+		if (cls->class_number == class_number) {
+			return cls;
+		}
+
+		slot = (slot + 1) & (COMMS_CLASS_INDEX_SIZE - 1);
+	}
 
-	// Search the linked list for a class with the given number.
+	// Slow path: search the linked list and the flash-resident class table,
+	// in case the index overflowed.
 	for (cls = class_head; cls; cls = cls->next) {
 		if (cls->class_number == class_number) {
 			return cls;
 		}
 	}
 
-	return NULL;
+	return comms_find_rom_class(class_number);
 }
 
 
@@ -118,6 +264,183 @@ const char *comms_get_class_name(uint32_t class_number, const char *default_stri
 
 
 
+/**
+ * Finds a given verb within a class's verb array, or NULL if none exists.
+ * Uses the dispatch metadata computed at registration to index the array
+ * directly when verb numbers are dense.
+ */
+static struct comms_verb *comms_find_verb_in_class(struct comms_class *handling_class,
+	uint32_t verb_number)
+{
+	struct comms_verb *verb;
+
+	if (!handling_class->command_verbs) {
+		return NULL;
+	}
+
+	// Fast path: densely-numbered verbs are located at their own index.
+	if (handling_class->verbs_are_dense) {
+		if (verb_number >= handling_class->verb_count) {
+			return NULL;
+		}
+		return &handling_class->command_verbs[verb_number];
+	}
+
+	// Slow path: scan the verb array.
+	for (verb = handling_class->command_verbs; verb->handler; ++verb) {
+		if (verb->verb_number == verb_number) {
+			return verb;
+		}
+	}
+
+	return NULL;
+}
+
+
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+
+/**
+ * Open-addressing table of per-verb execution statistics, keyed on
+ * (class number, verb number) and populated on first dispatch. Must be a
+ * power of two in size; if it ever fills up, the overflowing verbs simply
+ * aren't tracked.
+ */
+#define COMMS_VERB_STATISTICS_SIZE 64
+static struct comms_verb_statistics verb_statistics[COMMS_VERB_STATISTICS_SIZE];
+
+static inline uint32_t comms_verb_statistics_slot(uint32_t class_number, uint32_t verb_number)
+{
+	return (((class_number << 8) ^ verb_number) * 2654435761u) & (COMMS_VERB_STATISTICS_SIZE - 1);
+}
+
+
+/** Enables the cycle counter our dispatch timing reads. */
+static void comms_verb_profiling_initialize(void)
+{
+	profiling_initialize();
+}
+CALL_ON_INIT(comms_verb_profiling_initialize)
+
+
+/**
+ * Finds (or claims) the statistics record for the given verb, or NULL if
+ * the table is full.
+ */
+static struct comms_verb_statistics *comms_find_verb_statistics(uint32_t class_number,
+	uint32_t verb_number)
+{
+	uint32_t slot = comms_verb_statistics_slot(class_number, verb_number);
+	uint32_t probes;
+
+	for (probes = 0; probes < COMMS_VERB_STATISTICS_SIZE; ++probes) {
+		struct comms_verb_statistics *record = &verb_statistics[slot];
+
+		// An unclaimed slot means this verb has never been dispatched;
+		// claim it.
+		if (!record->in_use) {
+			record->in_use = true;
+			record->class_number = class_number;
+			record->verb_number = verb_number;
+			return record;
+		}
+
+		if ((record->class_number == class_number) && (record->verb_number == verb_number)) {
+			return record;
+		}
+
+		slot = (slot + 1) & (COMMS_VERB_STATISTICS_SIZE - 1);
+	}
+
+	return NULL;
+}
+
+
+/** Folds one handler invocation's cycle cost into the verb's record. */
+static void comms_record_verb_timing(uint32_t class_number, uint32_t verb_number, uint32_t cycles)
+{
+	struct comms_verb_statistics *record = comms_find_verb_statistics(class_number, verb_number);
+
+	if (!record) {
+		return;
+	}
+
+	record->invocations++;
+	record->total_cycles += cycles;
+	if (cycles > record->max_cycles) {
+		record->max_cycles = cycles;
+	}
+}
+
+
+/**
+ * @param index The record index, 0 up to the (fixed) table size.
+ * @return the given verb-statistics record, or NULL past the end of the table
+ */
+struct comms_verb_statistics *comms_get_verb_statistics(uint32_t index)
+{
+	if (index >= COMMS_VERB_STATISTICS_SIZE) {
+		return NULL;
+	}
+
+	return &verb_statistics[index];
+}
+
+
+/** Clears all accumulated per-verb statistics. */
+void comms_reset_verb_statistics(void)
+{
+	memset(verb_statistics, 0, sizeof(verb_statistics));
+}
+
+#endif
+
+
+/** The shared scratch arena, and the high-water mark of the current
+ * command's allocations within it; see comms_scratch_alloc(). */
+static uint8_t comms_scratch_arena[COMMS_SCRATCH_ARENA_SIZE] ATTR_ALIGNED(4);
+static uint32_t comms_scratch_used;
+
+
+/**
+ * Allocates transaction-scoped temporary workspace; see <drivers/comms.h>.
+ */
+void *comms_scratch_alloc(struct command_transaction *trans, uint32_t size)
+{
+	void *allocation;
+
+	// Keep every allocation word-aligned, so handlers can place structs
+	// and uint32_t workspaces without thinking about it.
+	size = (size + 3) & ~3u;
+
+	if (size > (COMMS_SCRATCH_ARENA_SIZE - comms_scratch_used)) {
+		pr_comms_warning(trans, "scratch arena exhausted (%" PRIu32 " requested, %" PRIu32 " free)\n",
+				size, (uint32_t)(COMMS_SCRATCH_ARENA_SIZE - comms_scratch_used));
+
+		// Mark the transaction as failed, so handlers that only check
+		// comms_transaction_okay() still bail out cleanly.
+		trans->data_out_status |= COMMS_PARSE_OVERRUN;
+		return NULL;
+	}
+
+	allocation = &comms_scratch_arena[comms_scratch_used];
+	comms_scratch_used += size;
+
+	return allocation;
+}
+
+
+/**
+ * Hands a command to the offload coprocessor; see <drivers/comms_backend.h>.
+ * A weak stub, so dispatch links without any inter-core transport; the
+ * platform's transport overrides it.
+ */
+ATTR_WEAK int comms_submit_command_to_coprocessor(struct command_transaction *trans)
+{
+	(void)trans;
+	return ENODEV;
+}
+
+
 /**
  * Submits a command for execution. Used by command backends.
  *
@@ -131,6 +454,10 @@ int comms_backend_submit_command(struct comm_backend_driver *backend,
 	int rc = 0;
 	bool found_handler = false;
 
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+	uint32_t start_cycles;
+#endif
+
 	struct comms_verb *verb;
 	struct comms_class *handling_class = comms_get_class_by_number(trans->class_number);
 
@@ -152,16 +479,33 @@ int comms_backend_submit_command(struct comm_backend_driver *backend,
 		return EINVAL;
 	}
 
-	// Iterate through the array of command verbs until we find a verb that handles
-	// our command.
-	for (verb = handling_class->command_verbs; verb->handler; ++verb) {
-		if (verb->verb_number == trans->verb) {
-			found_handler = true;
-			rc = verb->handler(trans);
-			break;
+	// If the class's verbs live on the offload coprocessor, try to hand the
+	// command across; ENODEV means no transport claimed it (none built in,
+	// or no coprocessor running), and we execute the handler locally.
+	if (handling_class->coprocessor_resident) {
+		rc = comms_submit_command_to_coprocessor(trans);
+		if (rc != ENODEV) {
+			return rc;
 		}
 	}
 
+	// Each command starts with the whole scratch arena available; anything
+	// a previous handler allocated is implicitly freed here, wholesale.
+	comms_scratch_used = 0;
+
+	// Find the verb that handles our command; for densely-numbered classes
+	// this is a direct index into the verb array.
+	verb = comms_find_verb_in_class(handling_class, trans->verb);
+
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+	start_cycles = arch_get_dwt_registers()->cycle_count;
+#endif
+
+	if (verb) {
+		found_handler = true;
+		rc = verb->handler(trans);
+	}
+
 	// If we haven't found a handler, but we have a class command handler, delegate
 	// back to the overall class handler.
 	if (!found_handler && handling_class->command_handler) {
@@ -169,6 +513,15 @@ int comms_backend_submit_command(struct comm_backend_driver *backend,
 		rc = handling_class->command_handler(trans);
 	}
 
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+	// Two counter reads per dispatch; the table update happens only after
+	// the handler's time has already been captured.
+	if (found_handler) {
+		comms_record_verb_timing(trans->class_number, trans->verb,
+				arch_get_dwt_registers()->cycle_count - start_cycles);
+	}
+#endif
+
 	// If we couldn't find any handler, abort.
 	if (!found_handler) {
 		pr_warning("comms: backend %s submttied a command class %s with an unhandled verb %" PRIu32 " / %" PRIx32 "\n",
@@ -186,12 +539,105 @@ int comms_backend_submit_command(struct comm_backend_driver *backend,
 }
 
 
+/** Rounds a batch-container offset up to the next 4-byte boundary. */
+static inline uint32_t comms_batch_align(uint32_t offset)
+{
+	return (offset + 3) & ~3u;
+}
+
+
+/**
+ * Submits a batch of commands for in-order execution. Used by command
+ * backends. The transaction's data_in carries a sequence of batch command
+ * headers and their arguments; its data_out receives a matching sequence of
+ * batch response headers and response data.
+ *
+ * @param backend The command backend driver submitting the given batch.
+ * @param trans An object whose buffers carry the batch container; its
+ *		class_number and verb are ignored.
+ *
+ * @return 0 if the batch container was well-formed (individual command
+ *		failures are reported in-band, in each response header), or an
+ *		error code if the container itself was malformed.
+ */
+int comms_backend_submit_batch(struct comm_backend_driver *backend,
+	struct command_transaction *trans)
+{
+	uint8_t *in_buffer = trans->data_in;
+	uint8_t *out_buffer = trans->data_out;
+	uint32_t in_offset = 0;
+	uint32_t out_offset = 0;
+
+	// Walk each command in the batch container, executing it and packing
+	// its response directly after the previous one.
+	while (in_offset < trans->data_in_length) {
+
+		struct libgreat_batch_command_header *command_header;
+		struct libgreat_batch_response_header *response_header;
+		struct command_transaction subcommand;
+
+		// Validate that a full command header fits in the remaining input.
+		if ((trans->data_in_length - in_offset) < sizeof(*command_header)) {
+			pr_warning("comms: backend %s submitted a truncated batch header\n", backend->name);
+			return EINVAL;
+		}
+		command_header = (void *)&in_buffer[in_offset];
+		in_offset += sizeof(*command_header);
+
+		// ... and that its argument data does, too.
+		if ((trans->data_in_length - in_offset) < command_header->data_length) {
+			pr_warning("comms: backend %s submitted a batch command with truncated data\n", backend->name);
+			return EINVAL;
+		}
+
+		// Reserve space for this command's response header.
+		if ((trans->data_out_max_length - out_offset) < sizeof(*response_header)) {
+			pr_warning("comms: batch response overflowed the transaction's output buffer\n");
+			return ENOSPC;
+		}
+		response_header = (void *)&out_buffer[out_offset];
+		out_offset += sizeof(*response_header);
+
+		// Build a sub-transaction around this command's slice of our
+		// buffers, so its response lands in place in the batch response.
+		subcommand = *trans;
+		subcommand.class_number = command_header->class_number;
+		subcommand.verb = command_header->verb;
+		subcommand.data_in = &in_buffer[in_offset];
+		subcommand.data_in_length = command_header->data_length;
+		subcommand.data_out = &out_buffer[out_offset];
+		subcommand.data_out_max_length = trans->data_out_max_length - out_offset;
+		subcommand.data_out_length = 0;
+		subcommand.data_in_position = subcommand.data_in;
+		subcommand.data_out_position = subcommand.data_out;
+		subcommand.data_in_remaining = subcommand.data_in_length;
+		subcommand.data_in_status = COMMS_PARSE_OKAY;
+		subcommand.data_out_status = COMMS_PARSE_OKAY;
+		subcommand.last_error_number = 0;
+
+		// Execute the command, and record its status and response length.
+		response_header->status = comms_backend_submit_command(backend, &subcommand);
+		response_header->data_length = subcommand.data_out_length;
+
+		// Advance past this command's arguments and response, keeping each
+		// header 4-byte aligned.
+		in_offset = comms_batch_align(in_offset + command_header->data_length);
+		out_offset = comms_batch_align(out_offset + subcommand.data_out_length);
+		if (out_offset > trans->data_out_max_length) {
+			out_offset = trans->data_out_max_length;
+		}
+	}
+
+	trans->data_out_length = out_offset;
+	return 0;
+}
+
+
 /**
  * @returns the verb description for the given class and verb number
  */
 struct comms_verb *comms_get_object_for_verb(uint32_t class_number, uint32_t verb_number)
 {
-	struct comms_verb *verb;
 	struct comms_class *handling_class = comms_get_class_by_number(class_number);
 
 	// If we couldn't find a handling class, return NULL.
@@ -199,21 +645,7 @@ struct comms_verb *comms_get_object_for_verb(uint32_t class_number, uint32_t ver
 		return NULL;
 	}
 
-	// If the class has no verb descriptors, return NULL.
-	if (!handling_class->command_verbs) {
-		return NULL;
-	}
-
-	// Iterate through the array of command verbs until we find a verb
-	// with a NULL handler.
-	for (verb = handling_class->command_verbs; verb->handler; ++verb) {
-		if (verb->verb_number == verb_number) {
-			return verb;
-		}
-	}
-
-	// If we couldn't find the relevant verb, return NULL.
-	return NULL;
+	return comms_find_verb_in_class(handling_class, verb_number);
 }
 
 
@@ -0,0 +1,164 @@
+/*
+ * This file is part of libgreat
+ *
+ * High-level communications API -- pipe objects, which provide
+ * high-throughput bulk streams alongside the command transport.
+ */
+
+#include <debug.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <drivers/comms.h>
+
+/** Total number of pipes supported; raise if a board runs out. */
+#define COMMS_MAX_PIPES 4
+
+/** Default number of sends we allow in flight before a pipe reports busy. */
+#define COMMS_PIPE_DEFAULT_CREDITS 2
+
+/** Static pool of pipe objects, handed out at registration time. */
+static struct comms_pipe pipe_pool[COMMS_MAX_PIPES];
+
+
+/**
+ * Registers a pipe to be provided for a given class, which allows
+ * bulk bidirectional communications.
+ *
+ * @param owning_class -- The class with which the pipe is to be associated.
+ *      This must have already been registered with comms_register_class.
+ * @param flags -- Flags describing how this pipe is to operate. TBD.
+ * @param ops -- A structure defining the operations this pipe supports.
+ *
+ * @returns a comms_pipe object on success; or NULL on failure
+ */
+struct comms_pipe *comms_register_pipe(struct comms_class *owning_class,
+		uint32_t flags, struct comms_pipe_ops ops)
+{
+	unsigned int i;
+
+	if (!owning_class) {
+		pr_error("ERROR: tried to register a pipe with a NULL owning class\n");
+		return NULL;
+	}
+
+	// Find a free slot in our pipe pool.
+	for (i = 0; i < COMMS_MAX_PIPES; ++i) {
+		struct comms_pipe *pipe = &pipe_pool[i];
+
+		if (pipe->in_use) {
+			continue;
+		}
+
+		pipe->in_use = true;
+		pipe->owning_class = owning_class;
+		pipe->flags = flags;
+		pipe->ops = ops;
+
+		// The pipe isn't usable until a transport binds it to a channel.
+		pipe->backend_send = NULL;
+		pipe->backend_ready = NULL;
+		pipe->backend_data = NULL;
+
+		pipe->sends_in_flight = 0;
+		pipe->max_sends_in_flight = COMMS_PIPE_DEFAULT_CREDITS;
+
+		return pipe;
+	}
+
+	pr_error("comms: out of pipe objects; class %s could not register a pipe\n",
+			owning_class->name);
+	return NULL;
+}
+
+
+/**
+ * Transmits data on a given communications pipe. The buffer is handed to the
+ * transport zero-copy: it must remain valid and untouched until the pipe's
+ * handle_data_out_complete callback is invoked for it.
+ *
+ * @param pipe The pipe on which to transmit.
+ * @param data Buffer storing the data to be transmitted.
+ * @param length The length of the data to be transmitted.
+ *
+ * @return 0 on success; EAGAIN if the pipe is out of flow-control credits.
+ */
+int comms_send_on_pipe(struct comms_pipe *pipe, void *data, uint32_t length)
+{
+	int rc;
+
+	if (!pipe || !pipe->backend_send) {
+		return EINVAL;
+	}
+
+	// Enforce our credit limit; callers should wait for completion
+	// callbacks (or poll comms_pipe_ready) and retry.
+	if (pipe->sends_in_flight >= pipe->max_sends_in_flight) {
+		return EAGAIN;
+	}
+
+	++pipe->sends_in_flight;
+
+	rc = pipe->backend_send(pipe, data, length);
+	if (rc) {
+		--pipe->sends_in_flight;
+	}
+
+	return rc;
+}
+
+
+/**
+ * @return True iff the given comms pipe is ready for data transmission.
+ */
+bool comms_pipe_ready(struct comms_pipe *pipe)
+{
+	if (!pipe || !pipe->backend_send) {
+		return false;
+	}
+
+	if (pipe->sends_in_flight >= pipe->max_sends_in_flight) {
+		return false;
+	}
+
+	if (pipe->backend_ready && !pipe->backend_ready(pipe)) {
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Notifies the pipe layer that a send issued via comms_send_on_pipe() has
+ * completed on the wire; releases its flow-control credit and invokes the
+ * owner's completion callbacks.
+ */
+void comms_pipe_handle_send_complete(struct comms_pipe *pipe, void *data, uint32_t length)
+{
+	if (pipe->sends_in_flight) {
+		--pipe->sends_in_flight;
+	}
+
+	// Give the owner a chance to free or recycle the buffer...
+	if (pipe->ops.handle_data_out_complete) {
+		pipe->ops.handle_data_out_complete(data, length);
+	}
+
+	// ... and let it know it can queue more data, if it was waiting.
+	if (pipe->ops.handle_host_ready_for_data) {
+		pipe->ops.handle_host_ready_for_data(0);
+	}
+}
+
+
+/**
+ * Delivers a block of host-to-device data to the pipe's owner.
+ */
+void comms_pipe_handle_data_received(struct comms_pipe *pipe, void *data, uint32_t length)
+{
+	if (pipe->ops.handle_data_in) {
+		pipe->ops.handle_data_in(0, data, length);
+	}
+}
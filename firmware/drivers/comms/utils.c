@@ -160,6 +160,62 @@ void *comms_response_reserve_space(struct command_transaction *trans, uint32_t s
 }
 
 
+/**
+ * Reserves a uint32_t length slot in the response, for building
+ * length-prefixed variable records in place: reserve the slot, append the
+ * record's data by any means, then patch the slot with
+ * comms_response_patch_length_field() once the length is known.
+ *
+ * @param trans The associated transaction.
+ * @return a handle for the reserved slot, to be passed to
+ *		comms_response_patch_length_field(); or NULL if there was no room
+ */
+uint32_t *comms_response_reserve_length_field(struct command_transaction *trans)
+{
+	return comms_response_reserve_space(trans, sizeof(uint32_t));
+}
+
+
+/**
+ * Patches a length slot from comms_response_reserve_length_field() with the
+ * number of bytes appended to the response since the slot was reserved.
+ *
+ * @param trans The associated transaction.
+ * @param length_field The handle returned at reservation; NULL is tolerated
+ *		(and ignored), so the reservation's failure handling can be deferred
+ *		to the transaction's overrun status.
+ */
+void comms_response_patch_length_field(struct command_transaction *trans, uint32_t *length_field)
+{
+	uint8_t *record_start;
+
+	if (!length_field) {
+		return;
+	}
+
+	// The record's data begins immediately after the reserved slot; its
+	// length is however far the response has advanced since then.
+	record_start = (uint8_t *)(length_field + 1);
+	*length_field = (uint8_t *)trans->data_out_position - record_start;
+}
+
+
+/**
+ * Accounts for response data written in place -- e.g. DMAed directly into
+ * the response buffer at its current position -- advancing the response
+ * past it.
+ *
+ * @param trans The associated transaction.
+ * @param length The number of bytes written at the response's current position.
+ * @return a pointer to the start of the committed data, or NULL if the data
+ *		would not have fit (in which case the transaction is marked overrun)
+ */
+void *comms_response_commit_space(struct command_transaction *trans, uint32_t length)
+{
+	return comms_response_reserve_space(trans, length);
+}
+
+
 /**
  * Adds a collection of raw bytes to the response.
  *
@@ -181,7 +237,43 @@ void *comms_response_add_raw(struct command_transaction *trans, void *data, uint
 		return buffer;
 	}
 
+	// If the handler built its data in place -- typically by writing directly
+	// into transfer memory it obtained from a previous reserve -- the data is
+	// already exactly where it needs to be, and we can skip the copy.
+	if (data == buffer) {
+		return buffer;
+	}
+
 	// Copy the provided data into the reserved buffer.
 	memcpy(buffer, data, length);
 	return buffer;
 }
+
+
+/**
+ * Dark metaprogramming magic, part two: typed bulk-array response builders.
+ *
+ * Appending a large homogeneous result element-by-element costs a bounds
+ * check and a position update per element; these validate once and move the
+ * whole array in bulk -- or not at all, when the caller built it in place
+ * in space from comms_response_reserve_space(). The elements land in device
+ * (little-endian) byte order, matching the host's "<*T" format decodes.
+ */
+#define COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(type) \
+	void *comms_response_add_##type##_array(struct command_transaction *trans, \
+			const type *values, uint32_t count) \
+	{ \
+		if (count > (UINT32_MAX / sizeof(type))) { \
+			pr_comms_error(trans, "impossibly large %s array response\n", #type); \
+			trans->data_out_status |= COMMS_PARSE_OVERRUN; \
+			return NULL; \
+		} \
+		return comms_response_add_raw(trans, (void *)values, count * sizeof(type)); \
+	}
+
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(uint8_t);
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(uint16_t);
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(uint32_t);
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(int8_t);
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(int16_t);
+COMMS_DEFINE_ARRAY_RESPONSE_HANDLER(int32_t);
@@ -0,0 +1,110 @@
+/*
+ * This file is part of libgreat
+ *
+ * CRC32 computation, for fast device-side verification of large regions.
+ */
+
+#include <stdbool.h>
+
+#include <drivers/crc.h>
+
+// The reflected IEEE 802.3 / zlib polynomial.
+#define CRC32_POLYNOMIAL 0xEDB88320UL
+
+/**
+ * Slicing tables for word-at-a-time computation: table[0] is the classic
+ * byte-at-a-time table, and table[n] advances a byte's contribution n
+ * further bytes through the register, letting us fold in a whole aligned
+ * word per iteration. Generated on first use, so they cost flash nothing.
+ */
+static uint32_t crc32_tables[4][256];
+static bool crc32_tables_generated;
+
+
+/** Generates the slicing tables above. */
+static void crc32_generate_tables(void)
+{
+	for (unsigned i = 0; i < 256; ++i) {
+		uint32_t entry = i;
+
+		for (unsigned bit = 0; bit < 8; ++bit) {
+			entry = (entry >> 1) ^ ((entry & 1) ? CRC32_POLYNOMIAL : 0);
+		}
+		crc32_tables[0][i] = entry;
+	}
+
+	for (unsigned i = 0; i < 256; ++i) {
+		for (unsigned slice = 1; slice < 4; ++slice) {
+			crc32_tables[slice][i] =
+				(crc32_tables[slice - 1][i] >> 8) ^ crc32_tables[0][crc32_tables[slice - 1][i] & 0xFF];
+		}
+	}
+
+	crc32_tables_generated = true;
+}
+
+
+/**
+ * Starts an incremental CRC32 computation.
+ */
+uint32_t crc32_init(void)
+{
+	if (!crc32_tables_generated) {
+		crc32_generate_tables();
+	}
+
+	return 0xFFFFFFFFUL;
+}
+
+
+/**
+ * Folds a buffer into an in-progress CRC32 computation.
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, uint32_t length)
+{
+	const uint8_t *bytes = data;
+
+	// Consume leading bytes until we're word-aligned.
+	while (length && ((uintptr_t)bytes & 3)) {
+		crc = (crc >> 8) ^ crc32_tables[0][(crc ^ *bytes++) & 0xFF];
+		--length;
+	}
+
+	// Consume a word at a time, slicing each word across the four tables.
+	while (length >= 4) {
+		uint32_t word = crc ^ *(const uint32_t *)bytes;
+
+		crc = crc32_tables[3][word & 0xFF] ^
+		      crc32_tables[2][(word >> 8) & 0xFF] ^
+		      crc32_tables[1][(word >> 16) & 0xFF] ^
+		      crc32_tables[0][(word >> 24) & 0xFF];
+
+		bytes += 4;
+		length -= 4;
+	}
+
+	// Consume any trailing bytes.
+	while (length--) {
+		crc = (crc >> 8) ^ crc32_tables[0][(crc ^ *bytes++) & 0xFF];
+	}
+
+	return crc;
+}
+
+
+/**
+ * Completes an incremental CRC32 computation.
+ */
+uint32_t crc32_finalize(uint32_t crc)
+{
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+
+/**
+ * Convenience function that computes the CRC32 of a single buffer.
+ */
+uint32_t crc32_compute(const void *data, uint32_t length)
+{
+	return crc32_finalize(crc32_update(crc32_init(), data, length));
+}
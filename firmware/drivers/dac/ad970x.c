@@ -47,12 +47,24 @@ int ad970x_initialize(ad970x_t *dac, uint32_t clock_period)
 		return EINVAL;
 	}
 
-	// Set the SCK and CS pins to output only, as we'll maintain control over these.
-	gpio_set_pin_direction(dac->gpio_cs,  true);
-	gpio_set_pin_direction(dac->gpio_sck, true);
+	// The SSP transport needs a controller to drive the bus with; the caller
+	// should have set one up before handing it to us.
+	if ((dac->transport == AD970X_TRANSPORT_SSP) && !dac->ssp) {
+		pr_error("error: tried to use the DAC's SSP transport without an SSP!\n");
+		return EINVAL;
+	}
 
-	// We'll start by driving the data line; and release it when we need to.
-	gpio_set_pin_direction(dac->gpio_data, true);
+	// We always drive CS ourselves, whichever transport moves the data.
+	gpio_set_pin_direction(dac->gpio_cs, true);
+	gpio_set_pin(dac->gpio_cs);
+
+	// With the GPIO transport, take over the clock and data lines, too.
+	if (dac->transport == AD970X_TRANSPORT_GPIO) {
+		gpio_set_pin_direction(dac->gpio_sck, true);
+
+		// We'll start by driving the data line; and release it when we need to.
+		gpio_set_pin_direction(dac->gpio_data, true);
+	}
 
 	// Keep the DAC in SPI mode, for now.
 	gpio_set_pin_direction(dac->gpio_mode, true);
@@ -232,6 +244,20 @@ static uint8_t dac_receive_byte(ad970x_t *dac)
 	return byte;
 }
 
+/**
+ * Writes a single register over the SSP transport: one CS assertion around a
+ * FIFO-fed command/value pair.
+ */
+static void dac_ssp_register_write(ad970x_t *dac, uint8_t address, uint8_t value)
+{
+	uint8_t frames[] = { DAC_DIRECTION_WRITE | DAC_WIDTH_BYTE | address, value };
+
+	gpio_clear_pin(dac->gpio_cs);
+	ssp_send_sync(dac->ssp, frames, sizeof(frames));
+	gpio_set_pin(dac->gpio_cs);
+}
+
+
 /**
  * Reads a DAC configuration register.
  *
@@ -243,6 +269,18 @@ uint8_t ad970x_register_read(ad970x_t *dac, uint8_t address)
 	uint8_t command = DAC_DIRECTION_READ | DAC_WIDTH_BYTE | address;
 	uint8_t response;
 
+	// Over the SSP transport, clock out the command and then exchange a
+	// dummy frame to clock the response back in. This requires the DAC's
+	// data-out to reach the SSP's MISO; see ad970x_transport_t.
+	if (dac->transport == AD970X_TRANSPORT_SSP) {
+		gpio_clear_pin(dac->gpio_cs);
+		ssp_transfer(dac->ssp, command);
+		response = ssp_transfer(dac->ssp, 0);
+		gpio_set_pin(dac->gpio_cs);
+
+		return response;
+	}
+
 	dac_start_config_transaction(dac);
 
 	// Scan out the command, and then read back the response.
@@ -263,6 +301,11 @@ void ad970x_register_write(ad970x_t *dac, uint8_t address, uint8_t value)
 {
 	uint8_t command = DAC_DIRECTION_WRITE | DAC_WIDTH_BYTE | address;
 
+	if (dac->transport == AD970X_TRANSPORT_SSP) {
+		dac_ssp_register_write(dac, address, value);
+		return;
+	}
+
 	dac_start_config_transaction(dac);
 
 	// Scan out the command, and then scan out the argument.
@@ -271,3 +314,20 @@ void ad970x_register_write(ad970x_t *dac, uint8_t address, uint8_t value)
 
 	dac_end_config_transaction(dac);
 }
+
+
+/**
+ * Writes a batch of DAC configuration registers back-to-back; see
+ * <drivers/dac/ad970x.h>.
+ *
+ * Each register is its own CS-framed transaction, as the configuration
+ * protocol requires -- but over the SSP transport the transactions follow
+ * each other with no dead time beyond the FIFO refill, so a full register
+ * snapshot applies in tens of microseconds.
+ */
+void ad970x_register_write_batch(ad970x_t *dac, const ad970x_register_value_t *registers, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		ad970x_register_write(dac, registers[i].address, registers[i].value);
+	}
+}
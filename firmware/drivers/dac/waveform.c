@@ -0,0 +1,246 @@
+/*
+ * This file is part of libgreat
+ *
+ * Arbitrary waveform playback engine: feeds a DAC from a circulating ring
+ * buffer using sample-rate-paced DMA, with host refill through a comms pipe.
+ * Sample pacing, and the playback itself, happen entirely in hardware; the
+ * processor's only involvement is copying refill data into the ring.
+ */
+
+#include <debug.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <drivers/comms.h>
+#include <drivers/dac.h>
+#include <drivers/dac/waveform.h>
+#include <drivers/platform_dac.h>
+#include <drivers/platform_dma.h>
+#include <drivers/timer.h>
+
+/** Number of samples in the playback ring. */
+#define DAC_WAVEFORM_RING_SAMPLES 2048
+
+/** Number of DMA descriptors the ring is divided across. */
+#define DAC_WAVEFORM_BLOCK_COUNT 8
+#define DAC_WAVEFORM_BLOCK_SAMPLES (DAC_WAVEFORM_RING_SAMPLES / DAC_WAVEFORM_BLOCK_COUNT)
+
+/** Samples of margin kept between the host's writes and the DMA's reads,
+ *  so refill data never lands in the block currently being converted. */
+#define DAC_WAVEFORM_WRITE_MARGIN DAC_WAVEFORM_BLOCK_SAMPLES
+
+/** Interval between consumption-accounting polls: one timer-wheel tick. */
+#define DAC_WAVEFORM_POLL_INTERVAL_US 1024
+
+
+/**
+ * State for the active engine. The pipe layer's callbacks don't carry a
+ * context argument, so -- as with the UART bridge -- we support a single
+ * active engine.
+ */
+static struct {
+	dac_t *dac;
+	struct comms_pipe *pipe;
+
+	// Periodic poll that tracks the DMA channel's progress through the ring.
+	software_timer_t poll_timer;
+
+	// The sample ring the DMA channel circulates into the DAC, as
+	// conversion-register words, and the descriptor ring that describes it.
+	uint32_t ring[DAC_WAVEFORM_RING_SAMPLES];
+	gpdma_linked_list_item_t llis[DAC_WAVEFORM_BLOCK_COUNT];
+
+	// Monotonic sample counts written into (and consumed from) the ring.
+	// Each is written from only one context; wrap-safe modular arithmetic
+	// recovers the in-flight distance between them.
+	volatile uint32_t samples_written;
+	volatile uint32_t samples_consumed;
+
+	// The ring offset the DMA channel had reached at the last poll.
+	uint32_t last_consumed_offset;
+
+	dac_waveform_statistics_t statistics;
+	bool active;
+} dac_waveform;
+
+
+/**
+ * Periodic poll: advances our consumption accounting to match the DMA
+ * channel's progress through the ring.
+ *
+ * The channel's source address tells us exactly where it's reading; as long
+ * as polls arrive less than a full ring apart -- a 2048-sample ring outlasts
+ * a poll interval even at the DAC's maximum rate -- the offset delta since
+ * the last poll is exactly the number of samples converted.
+ */
+static void dac_waveform_poll(void *argument)
+{
+	uint32_t position, offset, delta;
+
+	(void)argument;
+
+	position = platform_dac_get_playback_position();
+	if (!position) {
+		return;
+	}
+
+	offset = ((position - (uint32_t)dac_waveform.ring) / sizeof(uint32_t)) % DAC_WAVEFORM_RING_SAMPLES;
+	delta = (offset - dac_waveform.last_consumed_offset) % DAC_WAVEFORM_RING_SAMPLES;
+
+	dac_waveform.last_consumed_offset = offset;
+	dac_waveform.samples_consumed += delta;
+	dac_waveform.statistics.samples_played += delta;
+}
+
+
+/**
+ * Pipe callback: sample data has arrived from the host; copy it into the
+ * ring ahead of the DMA channel's read position.
+ */
+static int dac_waveform_handle_data_in(uint32_t verb, void *data, uint32_t length)
+{
+	uint8_t *bytes = data;
+	uint32_t count = length / sizeof(uint16_t);
+	uint32_t writable, accepted;
+	int32_t in_flight;
+
+	(void)verb;
+
+	if (!dac_waveform.active) {
+		return EINVAL;
+	}
+
+	// Figure out how far the host's writes are ahead of the DAC's reads; if
+	// the ring has looped past the host's last write -- the host paused, or
+	// fell behind -- resume writing just ahead of the current read point.
+	in_flight = (int32_t)(dac_waveform.samples_written - dac_waveform.samples_consumed);
+	if (in_flight < 0) {
+		dac_waveform.samples_written = dac_waveform.samples_consumed;
+		in_flight = 0;
+	}
+
+	writable = DAC_WAVEFORM_RING_SAMPLES - DAC_WAVEFORM_WRITE_MARGIN - in_flight;
+	accepted = (count < writable) ? count : writable;
+
+	for (uint32_t i = 0; i < accepted; ++i) {
+
+		// Samples arrive as little-endian 16-bit values; store each in
+		// ready-to-convert form, so playback costs no per-sample processing.
+		uint16_t sample = bytes[i * 2] | (bytes[(i * 2) + 1] << 8);
+		dac_waveform.ring[dac_waveform.samples_written % DAC_WAVEFORM_RING_SAMPLES] =
+				platform_dac_sample_to_word(sample);
+
+		dac_waveform.samples_written++;
+	}
+
+	dac_waveform.statistics.samples_received += accepted;
+	dac_waveform.statistics.samples_dropped += count - accepted;
+
+	return 0;
+}
+
+
+/**
+ * Builds the descriptor ring that circulates the sample ring into the DAC's
+ * conversion register.
+ */
+static void dac_waveform_build_descriptor_ring(dac_t *dac)
+{
+	for (unsigned i = 0; i < DAC_WAVEFORM_BLOCK_COUNT; ++i) {
+		unsigned next = (i + 1) % DAC_WAVEFORM_BLOCK_COUNT;
+
+		dac_waveform.llis[i] = (gpdma_linked_list_item_t) {
+			.source_address      = (uint32_t)&dac_waveform.ring[i * DAC_WAVEFORM_BLOCK_SAMPLES],
+			.destination_address = (uint32_t)&dac->reg->conversion_register,
+			.next_lli            = (uint32_t)&dac_waveform.llis[next],
+			.control = {
+				.transfer_size              = DAC_WAVEFORM_BLOCK_SAMPLES,
+				.source_burst_size          = GPDMA_BURST_1,
+				.destination_burst_size     = GPDMA_BURST_1,
+				.source_transfer_width      = GPDMA_WIDTH_WORD,
+				.destination_transfer_width = GPDMA_WIDTH_WORD,
+				.source_increment           = 1,
+			},
+		};
+	}
+}
+
+
+/**
+ * Starts waveform playback on the given DAC; see <drivers/dac/waveform.h>.
+ */
+int dac_waveform_start(dac_t *dac, struct comms_class *owning_class, uint32_t sample_rate)
+{
+	struct comms_pipe_ops ops = {
+		.handle_data_in = dac_waveform_handle_data_in,
+	};
+	int rc;
+
+	if (!dac || !owning_class) {
+		return EINVAL;
+	}
+	if (dac_waveform.active) {
+		return EBUSY;
+	}
+
+	dac_waveform.pipe = comms_register_pipe(owning_class, 0, ops);
+	if (!dac_waveform.pipe) {
+		return EBUSY;
+	}
+
+	dac_waveform.dac = dac;
+	dac_waveform.samples_written = 0;
+	dac_waveform.samples_consumed = 0;
+	dac_waveform.last_consumed_offset = 0;
+	dac_waveform.statistics = (dac_waveform_statistics_t){0};
+
+	// Start playback from a silent ring; the host's first refill data plays
+	// as soon as the DMA channel reaches it.
+	for (unsigned i = 0; i < DAC_WAVEFORM_RING_SAMPLES; ++i) {
+		dac_waveform.ring[i] = platform_dac_sample_to_word(0);
+	}
+
+	dac_waveform_build_descriptor_ring(dac);
+
+	rc = platform_dac_start_paced_dma(dac, &dac_waveform.llis[0], sample_rate);
+	if (rc) {
+		return rc;
+	}
+
+	rc = software_timer_start(&dac_waveform.poll_timer, DAC_WAVEFORM_POLL_INTERVAL_US,
+			true, dac_waveform_poll, NULL);
+	if (rc) {
+		pr_error("dac_waveform: couldn't start the accounting timer (%d)!\n", rc);
+		platform_dac_stop_paced_dma(dac);
+		return rc;
+	}
+
+	dac_waveform.active = true;
+	return 0;
+}
+
+
+/**
+ * Stops an active playback engine; the DAC holds its last converted value.
+ */
+void dac_waveform_stop(void)
+{
+	if (!dac_waveform.active) {
+		return;
+	}
+
+	software_timer_cancel(&dac_waveform.poll_timer);
+	platform_dac_stop_paced_dma(dac_waveform.dac);
+	dac_waveform.active = false;
+}
+
+
+/**
+ * Copies out the active engine's playback and overrun counters.
+ */
+void dac_waveform_get_statistics(dac_waveform_statistics_t *statistics)
+{
+	*statistics = dac_waveform.statistics;
+}
@@ -18,3 +18,73 @@ void ethernet_init(ethernet_controller_t *device)
 	// Perform the core low-level initialization for the ethernet controller.
 	platform_ethernet_init(device);
 }
+
+
+/**
+ * Starts the controller's receive and transmit paths. The MAC address and
+ * any frame_received callback should be populated before this is called.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int ethernet_start(ethernet_controller_t *device)
+{
+	int rc = platform_ethernet_start(device);
+	if (rc) {
+		return rc;
+	}
+
+	// If the consumer wants interrupt-driven receive, hook things up;
+	// otherwise, the device can be polled with ethernet_read_frame().
+	if (device->frame_received_callback) {
+		platform_ethernet_set_up_interrupt(device);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Fetches the oldest pending received frame, zero-copy. The returned buffer
+ * belongs to the caller until it's handed back via ethernet_release_frame().
+ */
+uint8_t *ethernet_read_frame(ethernet_controller_t *device, uint32_t *length)
+{
+	return platform_ethernet_read_frame(device, length);
+}
+
+
+/**
+ * Returns a buffer fetched with ethernet_read_frame() to the receive pool.
+ */
+void ethernet_release_frame(ethernet_controller_t *device, void *buffer)
+{
+	platform_ethernet_release_frame(device, buffer);
+}
+
+
+/**
+ * Queues a single-segment frame for transmit.
+ */
+int ethernet_transmit_frame(ethernet_controller_t *device, const void *data, uint32_t length)
+{
+	return platform_ethernet_transmit_frame(device, &data, &length, 1);
+}
+
+
+/**
+ * Queues a multi-segment frame for transmit, one chained descriptor per segment.
+ */
+int ethernet_transmit_chained(ethernet_controller_t *device,
+		const void *const *segments, const uint32_t *lengths, unsigned segment_count)
+{
+	return platform_ethernet_transmit_frame(device, segments, lengths, segment_count);
+}
+
+
+/**
+ * @return true iff all queued transmit frames have left the controller
+ */
+bool ethernet_transmit_complete(ethernet_controller_t *device)
+{
+	return platform_ethernet_transmit_complete(device);
+}
@@ -0,0 +1,212 @@
+/*
+ * This file is part of libgreat
+ *
+ * Streaming LZ decompression; see <drivers/lz.h> for the format.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <drivers/lz.h>
+
+/**
+ * Where in a sequence the parse currently stands. Only states that need
+ * input bytes appear here; the match copy itself runs to completion as soon
+ * as its offset (and any length extension) is in hand.
+ */
+typedef enum {
+	LZ_STATE_TOKEN = 0,
+	LZ_STATE_LITERAL_EXTEND,
+	LZ_STATE_LITERALS,
+	LZ_STATE_OFFSET_LOW,
+	LZ_STATE_OFFSET_HIGH,
+	LZ_STATE_MATCH_EXTEND,
+	LZ_STATE_ERROR,
+} lz_decoder_state_t;
+
+
+/**
+ * Fails the stream; errors are sticky until the decoder is reset.
+ */
+static int lz_fail(lz_decoder_t *decoder, int error)
+{
+	decoder->state = LZ_STATE_ERROR;
+	decoder->match_offset = error;
+	return error;
+}
+
+
+/**
+ * Executes the pending match copy, now that its offset and length are known.
+ */
+static int lz_copy_match(lz_decoder_t *decoder)
+{
+	uint32_t offset = decoder->match_offset;
+	uint32_t length = decoder->match_length;
+
+	// The match must reach back into bytes we've actually produced...
+	if (!offset || (offset > decoder->produced)) {
+		return lz_fail(decoder, EBADMSG);
+	}
+
+	// ... and its output must fit in the destination.
+	if (length > (decoder->capacity - decoder->produced)) {
+		return lz_fail(decoder, EOVERFLOW);
+	}
+
+	// Copy bytewise, in order: overlapping matches are legal, and rely on
+	// each byte being in place before the copy reaches it again.
+	uint8_t *out = &decoder->destination[decoder->produced];
+	const uint8_t *from = out - offset;
+
+	decoder->produced += length;
+	while (length--) {
+		*out++ = *from++;
+	}
+
+	decoder->state = LZ_STATE_TOKEN;
+	return 0;
+}
+
+
+/**
+ * Initializes (or resets) a streaming decoder; see <drivers/lz.h>.
+ */
+void lz_decoder_init(lz_decoder_t *decoder, void *destination, size_t capacity)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->destination = destination;
+	decoder->capacity = capacity;
+}
+
+
+/**
+ * Decodes a chunk of the compressed stream; see <drivers/lz.h>.
+ */
+int lz_decode(lz_decoder_t *decoder, const void *in, size_t length)
+{
+	const uint8_t *position = in;
+	const uint8_t *end = position + length;
+	int rc;
+
+	while (position < end) {
+		switch (decoder->state) {
+
+			// A fresh sequence: split the token into its two counts.
+			case LZ_STATE_TOKEN: {
+				uint8_t token = *position++;
+
+				decoder->literal_remaining = token >> 4;
+				decoder->match_length = token & 0xf;
+
+				// A match field of 1-15 encodes (length - 3); 0 means the
+				// sequence carries no match at all.
+				if (decoder->match_length) {
+					decoder->match_length += LZ_MINIMUM_MATCH - 1;
+				}
+
+				if (decoder->literal_remaining == 15) {
+					decoder->state = LZ_STATE_LITERAL_EXTEND;
+				} else if (decoder->literal_remaining) {
+					decoder->state = LZ_STATE_LITERALS;
+				} else {
+					decoder->state = decoder->match_length
+						? LZ_STATE_OFFSET_LOW : LZ_STATE_TOKEN;
+				}
+				break;
+			}
+
+			// Extension bytes each add their value to a count of 15; a byte
+			// below 255 ends the extension.
+			case LZ_STATE_LITERAL_EXTEND: {
+				uint8_t extension = *position++;
+
+				decoder->literal_remaining += extension;
+				if (extension != 255) {
+					decoder->state = LZ_STATE_LITERALS;
+				}
+				break;
+			}
+
+			// The literal bytes themselves: copy as many as this chunk holds.
+			case LZ_STATE_LITERALS: {
+				size_t available = end - position;
+				size_t to_copy = decoder->literal_remaining;
+
+				if (to_copy > available) {
+					to_copy = available;
+				}
+				if (to_copy > (decoder->capacity - decoder->produced)) {
+					return lz_fail(decoder, EOVERFLOW);
+				}
+
+				memcpy(&decoder->destination[decoder->produced], position, to_copy);
+				decoder->produced += to_copy;
+				position += to_copy;
+				decoder->literal_remaining -= to_copy;
+
+				if (decoder->literal_remaining == 0) {
+					// No match in this sequence means it's a final/flush
+					// sequence; otherwise, the offset comes next.
+					decoder->state = decoder->match_length
+						? LZ_STATE_OFFSET_LOW : LZ_STATE_TOKEN;
+				}
+				break;
+			}
+
+			// The two offset bytes, little-endian.
+			case LZ_STATE_OFFSET_LOW:
+				decoder->match_offset = *position++;
+				decoder->state = LZ_STATE_OFFSET_HIGH;
+				break;
+
+			case LZ_STATE_OFFSET_HIGH:
+				decoder->match_offset |= (uint32_t)(*position++) << 8;
+
+				// A maximal match field extends just as literal counts do;
+				// otherwise the match is fully described, so run it.
+				if (decoder->match_length == (15 + LZ_MINIMUM_MATCH - 1)) {
+					decoder->state = LZ_STATE_MATCH_EXTEND;
+				} else if ((rc = lz_copy_match(decoder))) {
+					return rc;
+				}
+				break;
+
+			case LZ_STATE_MATCH_EXTEND: {
+				uint8_t extension = *position++;
+
+				decoder->match_length += extension;
+				if ((extension != 255) && (rc = lz_copy_match(decoder))) {
+					return rc;
+				}
+				break;
+			}
+
+			// A failed stream stays failed; re-report the original error.
+			case LZ_STATE_ERROR:
+			default:
+				return decoder->match_offset;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * @returns true iff the stream seen so far ends on a sequence boundary;
+ *		see <drivers/lz.h>.
+ */
+bool lz_decoder_complete(const lz_decoder_t *decoder)
+{
+	return decoder->state == LZ_STATE_TOKEN;
+}
+
+
+/**
+ * @returns the number of decompressed bytes produced so far; see <drivers/lz.h>.
+ */
+size_t lz_decoder_bytes_produced(const lz_decoder_t *decoder)
+{
+	return decoder->produced;
+}
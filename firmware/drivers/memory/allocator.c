@@ -33,3 +33,282 @@ void initialize_heap_allocator()
 	umm_init();
 }
 CALL_ON_PREINIT(initialize_heap_allocator);
+
+
+//
+// Per-bank allocation arenas; see <drivers/memory/allocator.h>.
+//
+
+// Bounds of each bank's unplaced remainder, from the linker script. Weak, so
+// images whose scripts don't carry bank arenas (e.g. l0adables) still link;
+// there, the symbols resolve to NULL and the arenas report themselves empty.
+extern uint8_t _ahb_bank0[] ATTR_WEAK, _eahb_bank0[] ATTR_WEAK;
+extern uint8_t _ahb_bank1[] ATTR_WEAK, _eahb_bank1[] ATTR_WEAK;
+
+/** Bump-allocation state for a single bank's arena. */
+struct bank_arena {
+	uint8_t *next;
+	uint8_t *end;
+};
+static struct bank_arena bank_arenas[SRAM_BANK_COUNT];
+
+
+/**
+ * Captures each bank's linker-provided bounds into its arena.
+ */
+static void initialize_bank_arenas(void)
+{
+	bank_arenas[SRAM_BANK_AHB0] = (struct bank_arena){ .next = _ahb_bank0, .end = _eahb_bank0 };
+	bank_arenas[SRAM_BANK_AHB1] = (struct bank_arena){ .next = _ahb_bank1, .end = _eahb_bank1 };
+}
+CALL_ON_PREINIT(initialize_bank_arenas);
+
+
+/**
+ * Allocates a buffer from the given bank's arena; see
+ * <drivers/memory/allocator.h>.
+ */
+void *allocator_allocate_in_bank(sram_bank_t bank, size_t size, size_t alignment)
+{
+	struct bank_arena *arena;
+	uintptr_t aligned;
+
+	if ((bank >= SRAM_BANK_COUNT) || (alignment & (alignment - 1))) {
+		return NULL;
+	}
+	if (!alignment) {
+		alignment = sizeof(uint32_t);
+	}
+
+	arena = &bank_arenas[bank];
+	if (!arena->next) {
+		return NULL;
+	}
+
+	aligned = ((uintptr_t)arena->next + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+	if ((aligned + size) > (uintptr_t)arena->end) {
+		pr_error("allocator: bank %d can't fit a %u-byte buffer (%u bytes free)\n",
+				bank, (unsigned)size, (unsigned)allocator_bank_bytes_remaining(bank));
+		return NULL;
+	}
+
+	arena->next = (uint8_t *)(aligned + size);
+	return (void *)aligned;
+}
+
+
+/**
+ * @return the bytes remaining in a bank's arena; see
+ *     <drivers/memory/allocator.h>
+ */
+size_t allocator_bank_bytes_remaining(sram_bank_t bank)
+{
+	if ((bank >= SRAM_BANK_COUNT) || !bank_arenas[bank].next) {
+		return 0;
+	}
+
+	return bank_arenas[bank].end - bank_arenas[bank].next;
+}
+
+
+//
+// Optional allocation accounting (CONFIG_ENABLE_ALLOC_ACCOUNTING); see
+// the discussion in <drivers/memory/allocator.h>.
+//
+#ifdef CONFIG_ENABLE_ALLOC_ACCOUNTING
+
+/**
+ * Header prepended to every accounted allocation; records what we need to
+ * credit the right call site when the allocation is freed. Eight bytes, so
+ * the pointer we hand back keeps umm_malloc's alignment.
+ */
+struct allocator_accounting_header {
+	void *call_site;
+	uint32_t size;
+};
+
+/**
+ * Open-addressing table of per-call-site statistics, keyed on the call-site
+ * address and claimed on a site's first allocation. Must be a power of two
+ * in size; if it ever fills up, the overflowing sites simply aren't tracked.
+ */
+#define ALLOCATOR_SITE_TABLE_SIZE 32
+static struct allocator_site_statistics site_statistics[ALLOCATOR_SITE_TABLE_SIZE];
+
+/** Heap-wide accounting totals. */
+static struct allocator_statistics heap_statistics;
+
+
+/**
+ * Finds (or claims) the statistics record for the given call site, or NULL
+ * if the table is full.
+ */
+static struct allocator_site_statistics *allocator_find_site(void *call_site)
+{
+	uint32_t slot = (((uintptr_t)call_site >> 2) * 2654435761u) & (ALLOCATOR_SITE_TABLE_SIZE - 1);
+	uint32_t probes;
+
+	for (probes = 0; probes < ALLOCATOR_SITE_TABLE_SIZE; ++probes) {
+		struct allocator_site_statistics *record = &site_statistics[slot];
+
+		// An unclaimed record means this site has never allocated; claim it.
+		if (!record->call_site) {
+			record->call_site = call_site;
+			return record;
+		}
+
+		if (record->call_site == call_site) {
+			return record;
+		}
+
+		slot = (slot + 1) & (ALLOCATOR_SITE_TABLE_SIZE - 1);
+	}
+
+	return NULL;
+}
+
+
+/** Charges a new allocation to the heap-wide and per-site totals. */
+static void allocator_account_allocation(struct allocator_accounting_header *header)
+{
+	struct allocator_site_statistics *site = allocator_find_site(header->call_site);
+
+	heap_statistics.total_allocations++;
+	heap_statistics.live_bytes += header->size;
+	if (heap_statistics.live_bytes > heap_statistics.peak_live_bytes) {
+		heap_statistics.peak_live_bytes = heap_statistics.live_bytes;
+	}
+
+	if (!site) {
+		return;
+	}
+
+	site->total_allocations++;
+	site->live_bytes += header->size;
+	if (site->live_bytes > site->peak_live_bytes) {
+		site->peak_live_bytes = site->live_bytes;
+	}
+}
+
+
+/** Credits a freed allocation back to the heap-wide and per-site totals. */
+static void allocator_account_free(struct allocator_accounting_header *header)
+{
+	struct allocator_site_statistics *site = allocator_find_site(header->call_site);
+
+	heap_statistics.live_bytes -= header->size;
+
+	if (site) {
+		site->live_bytes -= header->size;
+	}
+}
+
+
+/** Core allocation path; tags the allocation with the provided call site. */
+static void *allocator_malloc_with_site(size_t size, void *call_site)
+{
+	struct allocator_accounting_header *header = umm_malloc(size + sizeof(*header));
+
+	if (!header) {
+		heap_statistics.failed_allocations++;
+		return NULL;
+	}
+
+	header->call_site = call_site;
+	header->size = size;
+	allocator_account_allocation(header);
+
+	return header + 1;
+}
+
+
+void *allocator_malloc(size_t size)
+{
+	return allocator_malloc_with_site(size, __builtin_return_address(0));
+}
+
+
+void *allocator_calloc(size_t num, size_t size)
+{
+	void *ptr = allocator_malloc_with_site(num * size, __builtin_return_address(0));
+
+	if (ptr) {
+		memset(ptr, 0, num * size);
+	}
+
+	return ptr;
+}
+
+
+void *allocator_realloc(void *ptr, size_t size)
+{
+	struct allocator_accounting_header *header;
+
+	// With no existing allocation, this is just a malloc.
+	if (!ptr) {
+		return allocator_malloc_with_site(size, __builtin_return_address(0));
+	}
+
+	// ... and with no new size, it's just a free.
+	header = ((struct allocator_accounting_header *)ptr) - 1;
+	if (!size) {
+		allocator_account_free(header);
+		umm_free(header);
+		return NULL;
+	}
+
+	// Otherwise, move the allocation, header and all; on failure, the old
+	// block (and its accounting) are left untouched.
+	allocator_account_free(header);
+	header = umm_realloc(header, size + sizeof(*header));
+	if (!header) {
+		header = ((struct allocator_accounting_header *)ptr) - 1;
+		allocator_account_allocation(header);
+		heap_statistics.failed_allocations++;
+		return NULL;
+	}
+
+	// Re-tag the block: from here on, this call site owns it.
+	header->call_site = __builtin_return_address(0);
+	header->size = size;
+	allocator_account_allocation(header);
+
+	return header + 1;
+}
+
+
+void allocator_free(void *ptr)
+{
+	struct allocator_accounting_header *header;
+
+	if (!ptr) {
+		return;
+	}
+
+	header = ((struct allocator_accounting_header *)ptr) - 1;
+	allocator_account_free(header);
+	umm_free(header);
+}
+
+
+/** @return the heap-wide allocation statistics */
+struct allocator_statistics *allocator_get_statistics(void)
+{
+	return &heap_statistics;
+}
+
+
+/**
+ * @param index The record index, 0 up to the (fixed) table size.
+ * @return the given call-site record, or NULL past the end of the table
+ */
+struct allocator_site_statistics *allocator_get_site_statistics(uint32_t index)
+{
+	if (index >= ALLOCATOR_SITE_TABLE_SIZE) {
+		return NULL;
+	}
+
+	return &site_statistics[index];
+}
+
+#endif
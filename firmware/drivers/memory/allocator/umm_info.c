@@ -123,6 +123,27 @@ void *umm_info( void *ptr, int force ) {
 
   DBGLOG_FORCE( force, "+----------+-------+--------+--------+-------+--------+--------+\n" );
 
+  /*
+   * Walk the quick-fit bins, so blocks parked there can be reported
+   * separately from genuinely in-use blocks. (The block walk above counts
+   * them as used, since their free bit is clear.)
+   */
+
+  {
+    unsigned short int bin;
+
+    for( bin = 1; bin <= UMM_BIN_MAX_BLOCKS; ++bin ) {
+      unsigned short int c = umm_bins[bin];
+
+      while( c ) {
+        ++ummHeapInfo.binnedEntries;
+        ummHeapInfo.binnedBlocks += bin;
+
+        c = UMM_NFREE(c);
+      }
+    }
+  }
+
   DBGLOG_FORCE( force, "Total Entries %5i    Used Entries %5i    Free Entries %5i\n",
       ummHeapInfo.totalEntries,
       ummHeapInfo.usedEntries,
@@ -133,6 +154,10 @@ void *umm_info( void *ptr, int force ) {
       ummHeapInfo.usedBlocks,
       ummHeapInfo.freeBlocks  );
 
+  DBGLOG_FORCE( force, "Binned Entries %4i   Binned Blocks %4i\n",
+      ummHeapInfo.binnedEntries,
+      ummHeapInfo.binnedBlocks );
+
   DBGLOG_FORCE( force, "+--------------------------------------------------------------+\n" );
 
   /* Release the critical section... */
@@ -145,7 +170,9 @@ void *umm_info( void *ptr, int force ) {
 
 size_t umm_free_heap_size( void ) {
   umm_info(NULL, 0);
-  return (size_t)ummHeapInfo.freeBlocks * sizeof(umm_block);
+
+  /* Binned blocks are allocatable too; count them as free capacity. */
+  return (size_t)(ummHeapInfo.freeBlocks + ummHeapInfo.binnedBlocks) * sizeof(umm_block);
 }
 
 /* ------------------------------------------------------------------------ */
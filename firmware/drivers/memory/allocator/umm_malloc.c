@@ -76,6 +76,31 @@ unsigned short int umm_numblocks = 0;
 #define UMM_PFREE(b)  (UMM_BLOCK(b).body.free.prev)
 #define UMM_DATA(b)   (UMM_BLOCK(b).body.data)
 
+/* -------------------------------------------------------------------------
+ * Quick-fit bins: segregated free lists for small allocations.
+ *
+ * Freed blocks of up to UMM_BIN_MAX_BLOCKS blocks (i.e. allocations of up
+ * to UMM_BIN_MAX_SIZE bytes) are parked on a per-size singly-linked list
+ * instead of being coalesced back into the general free list; a later
+ * allocation of the same block count pops the list head in O(1). This keeps
+ * the small, frequent allocations on hot paths from paying a best-fit scan
+ * whose length grows with heap fragmentation.
+ *
+ * Binned blocks keep their free bit CLEAR, so they look "used" to the rest
+ * of the allocator and are never assimilated; their next-bin link is stored
+ * in the (otherwise unused) free-pointer area of the block body. When the
+ * general free-list scan comes up empty, the bins are flushed back through
+ * the normal free path and the scan is retried once, so parked memory can
+ * still satisfy large allocations.
+ * -------------------------------------------------------------------------
+ */
+
+#define UMM_BIN_MAX_SIZE   (256)
+#define UMM_BIN_MAX_BLOCKS (2 + (UMM_BIN_MAX_SIZE - 1 - sizeof(((umm_block *)0)->body)) / sizeof(umm_block))
+
+/* Heads of the per-block-count bin lists; 0 means the bin is empty. */
+static unsigned short int umm_bins[UMM_BIN_MAX_BLOCKS + 1];
+
 /* -------------------------------------------------------------------------
  * There are additional files that may be included here - normally it's
  * not a good idea to include .c files but in this case it keeps the
@@ -194,6 +219,9 @@ void umm_init( void ) {
   umm_numblocks = (UMM_MALLOC_CFG_HEAP_SIZE / sizeof(umm_block));
   memset(umm_heap, 0x00, UMM_MALLOC_CFG_HEAP_SIZE);
 
+  /* and empty out the quick-fit bins */
+  memset(umm_bins, 0x00, sizeof(umm_bins));
+
   /* setup initial blank heap structure */
   {
     /* index of the 0th `umm_block` */
@@ -246,9 +274,76 @@ void umm_init( void ) {
 
 /* ------------------------------------------------------------------------ */
 
+/*
+ * Returns block `c` to the general heap, assimilating it with its neighbors
+ * where possible. This is the coalescing core of umm_free(); callers must
+ * already hold the critical section.
+ */
+
+static void umm_release_block( unsigned short int c ) {
+
+  pr_debug( "Freeing block %6i\n", c );
+
+  /* Now let's assimilate this block with the next one if possible. */
+
+  umm_assimilate_up( c );
+
+  /* Then assimilate with the previous block if possible */
+
+  if( UMM_NBLOCK(UMM_PBLOCK(c)) & UMM_FREELIST_MASK ) {
+
+    pr_debug( "Assimilate down to next block, which is FREE\n" );
+
+    c = umm_assimilate_down(c, UMM_FREELIST_MASK);
+  } else {
+    /*
+     * The previous block is not a free block, so add this one to the head
+     * of the free list
+     */
+
+    pr_debug( "Just add to head of free list\n" );
+
+    UMM_PFREE(UMM_NFREE(0)) = c;
+    UMM_NFREE(c)            = UMM_NFREE(0);
+    UMM_PFREE(c)            = 0;
+    UMM_NFREE(0)            = c;
+
+    UMM_NBLOCK(c)          |= UMM_FREELIST_MASK;
+  }
+}
+
+/* ------------------------------------------------------------------------
+ * Empties every quick-fit bin back into the general heap, so the parked
+ * blocks can coalesce and satisfy a large allocation. Callers must already
+ * hold the critical section.
+ *
+ * Returns non-zero iff any blocks were released.
+ */
+
+static int umm_bins_flush( void ) {
+
+  unsigned short int bin;
+  int released = 0;
+
+  for( bin = 1; bin <= UMM_BIN_MAX_BLOCKS; ++bin ) {
+    while( umm_bins[bin] ) {
+      unsigned short int c = umm_bins[bin];
+
+      umm_bins[bin] = UMM_NFREE(c);
+      umm_release_block( c );
+      released = 1;
+    }
+  }
+
+  return( released );
+}
+
+/* ------------------------------------------------------------------------ */
+
 void umm_free( void *ptr ) {
 
   unsigned short int c;
+  unsigned short int blockSize;
 
   /* If we're being asked to free a NULL pointer, well that's just silly! */
 
@@ -274,37 +369,83 @@ void umm_free( void *ptr ) {
 
   c = (((char *)ptr)-(char *)(&(umm_heap[0])))/sizeof(umm_block);
 
-  pr_debug( "Freeing block %6i\n", c );
+  /*
+   * If this is a small block, park it in its quick-fit bin instead of
+   * coalescing it: the next same-sized allocation will pop it in O(1).
+   * The block stays marked "used", with its bin link stored in its
+   * free-pointer area.
+   */
 
-  /* Now let's assimilate this block with the next one if possible. */
+  blockSize = (UMM_NBLOCK(c) & UMM_BLOCKNO_MASK) - c;
 
-  umm_assimilate_up( c );
+  if( blockSize <= UMM_BIN_MAX_BLOCKS ) {
+    pr_debug( "Binning block %6i size %6i\n", c, blockSize );
 
-  /* Then assimilate with the previous block if possible */
+    UMM_NFREE(c)        = umm_bins[blockSize];
+    umm_bins[blockSize] = c;
 
-  if( UMM_NBLOCK(UMM_PBLOCK(c)) & UMM_FREELIST_MASK ) {
+    /* Release the critical section... */
+    UMM_CRITICAL_EXIT();
 
-    pr_debug( "Assimilate down to next block, which is FREE\n" );
+    return;
+  }
 
-    c = umm_assimilate_down(c, UMM_FREELIST_MASK);
-  } else {
-    /*
-     * The previous block is not a free block, so add this one to the head
-     * of the free list
-     */
+  umm_release_block( c );
 
-    pr_debug( "Just add to head of free list\n" );
+  /* Release the critical section... */
+  UMM_CRITICAL_EXIT();
+}
 
-    UMM_PFREE(UMM_NFREE(0)) = c;
-    UMM_NFREE(c)            = UMM_NFREE(0);
-    UMM_PFREE(c)            = 0;
-    UMM_NFREE(0)            = c;
+/* ------------------------------------------------------------------------ */
 
-    UMM_NBLOCK(c)          |= UMM_FREELIST_MASK;
+/*
+ * Scans the general free list for a span of at least `blocks` blocks, using
+ * the configured fit strategy. Returns the found block (with its size in
+ * `*found_size`), or 0 if no block on the free list is large enough.
+ */
+
+static unsigned short int umm_scan_free_list( unsigned short int blocks,
+    unsigned short int *found_size ) {
+
+  unsigned short int blockSize = 0;
+
+  unsigned short int bestSize  = 0x7FFF;
+  unsigned short int bestBlock = UMM_NFREE(0);
+
+  unsigned short int cf = UMM_NFREE(0);
+
+  while( cf ) {
+    blockSize = (UMM_NBLOCK(cf) & UMM_BLOCKNO_MASK) - cf;
+
+    pr_trace( "Looking at block %6i size %6i\n", cf, blockSize );
+
+#if defined UMM_BEST_FIT
+    if( (blockSize >= blocks) && (blockSize < bestSize) ) {
+      bestBlock = cf;
+      bestSize  = blockSize;
+    }
+#elif defined UMM_FIRST_FIT
+    /* This is the first block that fits! */
+    if( (blockSize >= blocks) )
+      break;
+#else
+#  error "No UMM_*_FIT is defined - check umm_malloc_cfg.h"
+#endif
+
+    cf = UMM_NFREE(cf);
   }
 
-  /* Release the critical section... */
-  UMM_CRITICAL_EXIT();
+  if( 0x7FFF != bestSize ) {
+    cf        = bestBlock;
+    blockSize = bestSize;
+  }
+
+  if( (UMM_NBLOCK(cf) & UMM_BLOCKNO_MASK) && (blockSize >= blocks) ) {
+    *found_size = blockSize;
+    return( cf );
+  }
+
+  return( 0 );
 }
 
 /* ------------------------------------------------------------------------ */
@@ -313,9 +454,6 @@ void *umm_malloc( size_t size ) {
   unsigned short int blocks;
   unsigned short int blockSize = 0;
 
-  unsigned short int bestSize;
-  unsigned short int bestBlock;
-
   unsigned short int cf;
 
   if (umm_heap == NULL) {
@@ -340,6 +478,24 @@ void *umm_malloc( size_t size ) {
 
   blocks = umm_blocks( size );
 
+  /*
+   * Fast path: if this is a small allocation and its quick-fit bin has a
+   * parked block, pop the bin head -- it's an exact fit, so there's no
+   * free-list scan and no split.
+   */
+
+  if( (blocks <= UMM_BIN_MAX_BLOCKS) && umm_bins[blocks] ) {
+    cf               = umm_bins[blocks];
+    umm_bins[blocks] = UMM_NFREE(cf);
+
+    pr_debug( "Allocating %6i blocks starting at %6i - from bin\n", blocks, cf );
+
+    /* Release the critical section... */
+    UMM_CRITICAL_EXIT();
+
+    return( (void *)&UMM_DATA(cf) );
+  }
+
   /*
    * Now we can scan through the free list until we find a space that's big
    * enough to hold the number of blocks we need.
@@ -348,38 +504,19 @@ void *umm_malloc( size_t size ) {
    * algorithm
    */
 
-  cf = UMM_NFREE(0);
-
-  bestBlock = UMM_NFREE(0);
-  bestSize  = 0x7FFF;
-
-  while( cf ) {
-    blockSize = (UMM_NBLOCK(cf) & UMM_BLOCKNO_MASK) - cf;
+  cf = umm_scan_free_list( blocks, &blockSize );
 
-    pr_trace( "Looking at block %6i size %6i\n", cf, blockSize );
-
-#if defined UMM_BEST_FIT
-    if( (blockSize >= blocks) && (blockSize < bestSize) ) {
-      bestBlock = cf;
-      bestSize  = blockSize;
-    }
-#elif defined UMM_FIRST_FIT
-    /* This is the first block that fits! */
-    if( (blockSize >= blocks) )
-      break;
-#else
-#  error "No UMM_*_FIT is defined - check umm_malloc_cfg.h"
-#endif
-
-    cf = UMM_NFREE(cf);
-  }
+  /*
+   * If the scan came up empty, memory parked in the quick-fit bins is our
+   * last resort: release it back into the heap, where it can coalesce, and
+   * retry the scan once.
+   */
 
-  if( 0x7FFF != bestSize ) {
-    cf        = bestBlock;
-    blockSize = bestSize;
+  if( !cf && umm_bins_flush() ) {
+    cf = umm_scan_free_list( blocks, &blockSize );
   }
 
-  if( UMM_NBLOCK(cf) & UMM_BLOCKNO_MASK && blockSize >= blocks ) {
+  if( cf ) {
     /*
      * This is an existing block in the memory heap, we just need to split off
      * what we need, unlink it from the free list and mark it as in use, and
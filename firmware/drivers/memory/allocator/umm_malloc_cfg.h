@@ -78,6 +78,14 @@ extern uint8_t libgreat_heap[CONFIG_LIBGREAT_HEAP_SIZE];
     unsigned short int usedBlocks;
     unsigned short int freeBlocks;
 
+    /*
+     * Blocks parked in the quick-fit bins; these are counted as "used" in
+     * the walk above (their free bit is clear), but are available to
+     * same-sized allocations -- and to everyone else after a bin flush.
+     */
+    unsigned short int binnedEntries;
+    unsigned short int binnedBlocks;
+
     unsigned short int maxFreeContiguousBlocks;
   }
   UMM_HEAP_INFO;
@@ -0,0 +1,187 @@
+/*
+ * This file is part of libgreat
+ *
+ * Lock-free single-producer/single-consumer block ring buffer.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <debug.h>
+
+#include <drivers/memory/blockring.h>
+
+/** Data memory barrier: orders a region's contents before the index store
+ * that publishes it to the other side. */
+#define blockring_publish_barrier() __asm__ volatile("dmb" ::: "memory")
+
+
+int blockring_init(blockring_t *ring, void *buffer, size_t size)
+{
+	// Require a power-of-two size, so offset arithmetic stays cheap and
+	// our invariants stay simple.
+	if (!size || (size & (size - 1))) {
+		pr_error("blockring: buffer size %u is not a power of two!\n", (unsigned)size);
+		return EINVAL;
+	}
+
+	ring->buffer = buffer;
+	ring->size = size;
+
+	ring->read_index = 0;
+	ring->write_index = 0;
+	ring->wrap_point = size;
+
+	ring->reserve_start = 0;
+	ring->reserve_length = 0;
+	ring->reserve_wraps = false;
+
+	return 0;
+}
+
+
+void *blockring_reserve(blockring_t *ring, size_t size)
+{
+	// Sample the consumer's position once; it can only move away from us,
+	// so a stale value is merely conservative.
+	uint32_t read = ring->read_index;
+	uint32_t write = ring->write_index;
+
+	if (!size || (size > ring->size)) {
+		return NULL;
+	}
+
+	// Unwrapped state: free space runs from the write offset to the end of
+	// the buffer, and then from the buffer's start up to the read offset.
+	if (write >= read) {
+
+		// We can't let a commit make write equal to read -- that's
+		// indistinguishable from empty -- so if the consumer sits at
+		// offset zero, we must leave the final byte unused.
+		size_t space_at_end = ring->size - write;
+		if ((read == 0) && space_at_end) {
+			space_at_end -= 1;
+		}
+
+		if (size <= space_at_end) {
+			ring->reserve_start = write;
+			ring->reserve_length = size;
+			ring->reserve_wraps = false;
+			return &ring->buffer[write];
+		}
+
+		// The region at the end is too small; try wrapping early and
+		// reserving at the buffer's start instead. (Strictly less than the
+		// read offset, again to avoid the full/empty ambiguity.)
+		if (size < read) {
+			ring->reserve_start = 0;
+			ring->reserve_length = size;
+			ring->reserve_wraps = true;
+			return ring->buffer;
+		}
+
+		return NULL;
+	}
+
+	// Wrapped state: free space is the gap between the write and read
+	// offsets, less the ambiguity byte.
+	if (size < (read - write)) {
+		ring->reserve_start = write;
+		ring->reserve_length = size;
+		ring->reserve_wraps = false;
+		return &ring->buffer[write];
+	}
+
+	return NULL;
+}
+
+
+void blockring_commit(blockring_t *ring)
+{
+	uint32_t new_write;
+
+	if (!ring->reserve_length) {
+		return;
+	}
+
+	if (ring->reserve_wraps) {
+		// We skipped the tail of the buffer: record where valid data stops,
+		// then publish the reservation at the buffer's start. The barrier
+		// between the two stores ensures the consumer never sees the new
+		// write offset without the new wrap point.
+		ring->wrap_point = ring->write_index;
+		blockring_publish_barrier();
+		ring->write_index = ring->reserve_length;
+	} else {
+		new_write = ring->reserve_start + ring->reserve_length;
+
+		// If the reservation exactly reaches the end of the buffer, the
+		// committed data wraps at the buffer's natural boundary.
+		if (new_write == ring->size) {
+			ring->wrap_point = ring->size;
+			new_write = 0;
+		}
+
+		blockring_publish_barrier();
+		ring->write_index = new_write;
+	}
+
+	ring->reserve_length = 0;
+	ring->reserve_wraps = false;
+}
+
+
+void *blockring_peek(blockring_t *ring, size_t *out_length)
+{
+	uint32_t write = ring->write_index;
+	uint32_t read = ring->read_index;
+
+	// If we've consumed up to the wrap point while the producer is wrapped
+	// behind us, jump our position back to the buffer's start.
+	if ((write < read) && (read == ring->wrap_point)) {
+		ring->read_index = 0;
+		read = 0;
+	}
+
+	if (write >= read) {
+		*out_length = write - read;
+	} else {
+		*out_length = ring->wrap_point - read;
+	}
+
+	return &ring->buffer[read];
+}
+
+
+void blockring_release(blockring_t *ring, size_t size)
+{
+	uint32_t read = ring->read_index + size;
+
+	// If we've consumed exactly up to the wrap point while the producer is
+	// wrapped behind us, continue from the buffer's start.
+	if ((read == ring->wrap_point) && (ring->write_index < read)) {
+		read = 0;
+	}
+
+	blockring_publish_barrier();
+	ring->read_index = read;
+}
+
+
+size_t blockring_data_available(blockring_t *ring)
+{
+	uint32_t write = ring->write_index;
+	uint32_t read = ring->read_index;
+
+	if (write >= read) {
+		return write - read;
+	}
+
+	return (ring->wrap_point - read) + write;
+}
+
+
+bool blockring_empty(blockring_t *ring)
+{
+	return blockring_data_available(ring) == 0;
+}
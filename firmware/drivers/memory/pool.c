@@ -0,0 +1,93 @@
+/*
+ * This file is part of libgreat
+ *
+ * Fixed-size block pool allocator -- O(1), lock-free get/put, usable from
+ * interrupt context. Complements the umm_malloc heap for interrupt-adjacent
+ * allocations (USB transfer bookkeeping, comms scratch buffers) where the
+ * heap's best-fit search is too slow and too jitter-prone.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <debug.h>
+#include <toolchain.h>
+
+#include <drivers/memory/allocator.h>
+
+// Exclusive-access primitives, per the usb_queue free-list idiom.
+#include <libopencm3/cm3/sync.h>
+
+
+/**
+ * Initializes a block pool over a caller-provided backing store.
+ */
+int pool_init(memory_pool_t *pool, void *backing_store, size_t block_size, size_t block_count)
+{
+	uint8_t *block = backing_store;
+	struct pool_free_block *previous = NULL;
+
+	// Each block must at least hold our free-list link, and should be
+	// word-aligned so the blocks it hands out are, too.
+	if (!backing_store || (block_size < sizeof(struct pool_free_block)) || (block_size % 4)) {
+		return EINVAL;
+	}
+
+	pool->block_size = block_size;
+	pool->block_count = block_count;
+
+	// Thread every block onto the free list.
+	for (size_t i = 0; i < block_count; ++i, block += block_size) {
+		struct pool_free_block *free_block = (void *)block;
+		free_block->next = previous;
+		previous = free_block;
+	}
+	pool->free_list = previous;
+
+	return 0;
+}
+
+
+/**
+ * Grabs a block from the pool. O(1); safe from interrupt context.
+ *
+ * @return a block of the pool's block size, or NULL if the pool is exhausted
+ */
+void *pool_get(memory_pool_t *pool)
+{
+	struct pool_free_block *block;
+	bool aborted;
+
+	do {
+		block = (void *)__ldrex((uint32_t *)&pool->free_list);
+
+		// If the pool is exhausted, give up. (An abandoned exclusive
+		// monitor is harmless; any later STREX simply fails and retries.)
+		if (!block) {
+			return NULL;
+		}
+
+		aborted = __strex((uint32_t)block->next, (uint32_t *)&pool->free_list);
+	} while (aborted);
+
+	return block;
+}
+
+
+/**
+ * Returns a block to the pool. O(1); safe from interrupt context.
+ */
+void pool_put(memory_pool_t *pool, void *block)
+{
+	struct pool_free_block *free_block = block;
+	bool aborted;
+
+	if (!block) {
+		return;
+	}
+
+	do {
+		free_block->next = (void *)__ldrex((uint32_t *)&pool->free_list);
+		aborted = __strex((uint32_t)free_block, (uint32_t *)&pool->free_list);
+	} while (aborted);
+}
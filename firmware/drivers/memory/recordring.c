@@ -0,0 +1,140 @@
+/*
+ * This file is part of libgreat
+ *
+ * Lock-free multi-producer/single-consumer record ring buffer;
+ * see <drivers/memory/recordring.h> for the design rationale.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include <debug.h>
+
+#include <drivers/memory/recordring.h>
+
+// Exclusive-access primitives, per the usb_queue free-list idiom.
+#include <libopencm3/cm3/sync.h>
+
+/** Data memory barrier: orders a record's contents before the publish-word
+ * store that makes it visible to the consumer. */
+#define recordring_publish_barrier() __asm__ volatile("dmb" ::: "memory")
+
+
+/** A slot's publish word: zero while the slot is free or being filled,
+ * nonzero once its record is complete and visible to the consumer. */
+static inline volatile uint32_t *recordring_slot_published(recordring_t *ring, uint32_t index)
+{
+	uint32_t slot = index & (ring->depth - 1);
+	return (volatile uint32_t *)&ring->storage[slot * RECORDRING_SLOT_SIZE(ring->record_size)];
+}
+
+
+/** @return the record that follows the given slot's publish word */
+static inline void *recordring_slot_record(volatile uint32_t *published)
+{
+	return (void *)(published + 1);
+}
+
+
+int recordring_init(recordring_t *ring, void *storage, size_t record_size, size_t depth)
+{
+	// Require word-multiple records and a power-of-two depth, so slots stay
+	// aligned and index arithmetic stays cheap.
+	if (!record_size || (record_size & 3)) {
+		pr_error("recordring: record size %u is not a multiple of four!\n", (unsigned)record_size);
+		return EINVAL;
+	}
+	if (!depth || (depth & (depth - 1))) {
+		pr_error("recordring: depth %u is not a power of two!\n", (unsigned)depth);
+		return EINVAL;
+	}
+
+	ring->storage = storage;
+	ring->record_size = record_size;
+	ring->depth = depth;
+
+	ring->write_index = 0;
+	ring->read_index = 0;
+	ring->dropped = 0;
+
+	memset(storage, 0, RECORDRING_STORAGE_SIZE(record_size, depth));
+	return 0;
+}
+
+
+void *recordring_claim(recordring_t *ring)
+{
+	uint32_t index;
+	bool aborted;
+
+	// Claim a slot by atomically advancing the write index; the exclusive
+	// reservation makes the check-and-increment safe against any mix of
+	// racing producers, without masking interrupts. If the ring is full,
+	// count the drop and bail -- producers never block.
+	do {
+		index = __ldrex((uint32_t *)&ring->write_index);
+
+		if ((index - ring->read_index) >= ring->depth) {
+			// Abandoning the exclusive monitor without a store is harmless.
+			ring->dropped++;
+			return NULL;
+		}
+
+		aborted = __strex(index + 1, (uint32_t *)&ring->write_index);
+	} while (aborted);
+
+	return recordring_slot_record(recordring_slot_published(ring, index));
+}
+
+
+void recordring_publish(recordring_t *ring, void *record)
+{
+	volatile uint32_t *published = ((volatile uint32_t *)record) - 1;
+
+	(void)ring;
+
+	// Publish the record by setting its slot's publish word last, so the
+	// consumer never observes a half-written record.
+	recordring_publish_barrier();
+	*published = 1;
+}
+
+
+unsigned recordring_read(recordring_t *ring, void *buffer, unsigned max_records)
+{
+	uint8_t *out = buffer;
+	unsigned records_read = 0;
+
+	while ((records_read < max_records) && (ring->read_index != ring->write_index)) {
+		volatile uint32_t *published = recordring_slot_published(ring, ring->read_index);
+
+		// If the next slot has been claimed but not yet published, stop
+		// here; we'll pick it up on a later drain, preserving emission order.
+		if (!*published) {
+			break;
+		}
+
+		memcpy(out, recordring_slot_record(published), ring->record_size);
+		out += ring->record_size;
+		records_read++;
+
+		// Release the slot before advancing past it.
+		*published = 0;
+		recordring_publish_barrier();
+		ring->read_index++;
+	}
+
+	return records_read;
+}
+
+
+uint32_t recordring_dropped(recordring_t *ring)
+{
+	return ring->dropped;
+}
+
+
+bool recordring_empty(recordring_t *ring)
+{
+	return ring->read_index == ring->write_index;
+}
@@ -0,0 +1,175 @@
+/*
+ * This file is part of libgreat
+ *
+ * Word-level run-length coding for capture streams; see <drivers/rle.h>
+ * for the format and the intended staging.
+ */
+
+#include <string.h>
+
+#include <toolchain.h>
+#include <drivers/rle.h>
+
+/**
+ * Tracks the literal block currently being assembled within one encode
+ * call: the position of its header word, whose count is patched as words
+ * are appended. Literal blocks never span calls -- the header lives in the
+ * caller's output buffer -- so this state stays on the stack.
+ */
+typedef struct {
+	uint32_t *header;
+} literal_block_t;
+
+
+/**
+ * Appends a pending run to the output: as a run token if it's long enough
+ * to pay for one, or folded into the current literal block otherwise.
+ *
+ * @return the updated output position
+ */
+static uint32_t *rle_emit_run(uint32_t value, uint32_t length,
+		uint32_t *out, literal_block_t *literal)
+{
+	// Long enough for a run token: close any open literal block and emit
+	// the two-word token.
+	if (length >= RLE_MINIMUM_RUN) {
+		literal->header = NULL;
+
+		*out++ = RLE_TOKEN_RUN_FLAG | length;
+		*out++ = value;
+		return out;
+	}
+
+	// Too short to pay for a token: append the words to the open literal
+	// block, starting one if necessary.
+	if (!literal->header) {
+		literal->header = out;
+		*out++ = 0;
+	}
+
+	*literal->header += length;
+	while (length--) {
+		*out++ = value;
+	}
+
+	return out;
+}
+
+
+/**
+ * Initializes (or resets) a streaming run-length encoder.
+ */
+void rle_encoder_init(rle_encoder_t *encoder)
+{
+	encoder->run_length = 0;
+}
+
+
+/**
+ * Encodes a chunk of words; see <drivers/rle.h>.
+ */
+size_t rle_encode(rle_encoder_t *encoder, const uint32_t *in, size_t in_words, uint32_t *out)
+{
+	literal_block_t literal = { .header = NULL };
+	uint32_t *out_position  = out;
+
+	uint32_t run_value  = encoder->run_value;
+	uint32_t run_length = encoder->run_length;
+
+	for (size_t i = 0; i < in_words; ++i) {
+		uint32_t word = in[i];
+
+		// The common case -- another word of the current run -- is a single
+		// compare; this is the whole per-word cost on idle bus.
+		if (run_length && (word == run_value)) {
+
+			// Emit a full token early in the (pathological) case of a run
+			// too long for a token's count field.
+			if (++run_length == RLE_TOKEN_COUNT_MASK) {
+				out_position = rle_emit_run(run_value, run_length, out_position, &literal);
+				run_length = 0;
+			}
+			continue;
+		}
+
+		// The run has ended; emit it and start a new one with this word.
+		if (run_length) {
+			out_position = rle_emit_run(run_value, run_length, out_position, &literal);
+		}
+		run_value = word;
+		run_length = 1;
+	}
+
+	// Keep the trailing run pending, so it can merge with the next chunk's
+	// leading words; literal blocks close with the call.
+	encoder->run_value = run_value;
+	encoder->run_length = run_length;
+
+	return out_position - out;
+}
+
+
+/**
+ * Emits any pending run, ending the encoded stream; see <drivers/rle.h>.
+ */
+size_t rle_encoder_flush(rle_encoder_t *encoder, uint32_t *out)
+{
+	literal_block_t literal = { .header = NULL };
+	uint32_t *out_position  = out;
+
+	if (encoder->run_length) {
+		out_position = rle_emit_run(encoder->run_value, encoder->run_length,
+				out_position, &literal);
+		encoder->run_length = 0;
+	}
+
+	return out_position - out;
+}
+
+
+/**
+ * Decodes a complete token stream; see <drivers/rle.h>.
+ */
+size_t rle_decode(const uint32_t *in, size_t in_words, uint32_t *out, size_t out_words)
+{
+	size_t produced = 0;
+
+	while (in_words) {
+		uint32_t header = *in++;
+		uint32_t count  = header & RLE_TOKEN_COUNT_MASK;
+		--in_words;
+
+		if ((count > (out_words - produced)) || !count) {
+			return 0;
+		}
+
+		if (header & RLE_TOKEN_RUN_FLAG) {
+
+			// Run token: one value word, repeated.
+			if (in_words < 1) {
+				return 0;
+			}
+
+			uint32_t value = *in++;
+			--in_words;
+
+			for (uint32_t i = 0; i < count; ++i) {
+				out[produced++] = value;
+			}
+
+		} else {
+
+			// Literal block: the next `count` words, verbatim.
+			if (in_words < count) {
+				return 0;
+			}
+
+			memcpy(&out[produced], in, count * sizeof(uint32_t));
+			in += count;
+			in_words -= count;
+			produced += count;
+		}
+	}
+
+	return produced;
+}
@@ -1,38 +1,513 @@
 /**
- * Simple co-operative round-robin scheduler functionality for GreatFET.
+ * Simple co-operative scheduler functionality for GreatFET.
  * This file is part of libgreat
  */
 
 #include <toolchain.h>
+#include <debug.h>
+#include <errno.h>
 
-// TODO: implement task state, yielding, and magic?
+#include <drivers/comms.h>
+#include <drivers/scheduler.h>
+#include <drivers/arm_profiling.h>
+#include <drivers/platform_reset.h>
 
-// Definitions that let us get at our list of tasks.
-typedef void (*task_implementation_t) (void);
+// Definitions that let us get at our linker-provided list of tasks.
 extern task_implementation_t __task_array_start, __task_array_end;
 
+/** Maximum number of tasks the scheduler can track, including both
+ * linker-registered and runtime-registered ones. */
+#define SCHEDULER_MAX_TASKS 32
+
+/**
+ * Bookkeeping for a single schedulable task.
+ */
+struct scheduler_task {
+
+	/** The task's implementation function. */
+	task_implementation_t implementation;
+
+	/** The task's priority; lower numbers run first. */
+	uint8_t priority;
+
+	/** True for legacy polling tasks, which run every round. */
+	bool always_ready;
+
+	/** For event-driven tasks: set (typically from an ISR) when the task
+	 * has work to do; cleared by the scheduler before running it. */
+	volatile bool ready;
+
+	/** CPU accounting: how many times the task has run, the cycles it has
+	 * consumed in total, and its worst single iteration -- so when the
+	 * device falls behind, we can tell which task is hogging the loop. */
+	uint32_t invocations;
+	uint64_t total_cycles;
+	uint32_t max_cycles;
+
+	/** Deadline supervision: the task's declared per-iteration budget, in
+	 * cycles (0 for unsupervised tasks), and how often it's been blown. */
+	uint32_t deadline_cycles;
+	uint32_t deadline_overruns;
+};
+
+/** Our task table, kept sorted by ascending priority. */
+static struct scheduler_task task_table[SCHEDULER_MAX_TASKS];
+static unsigned int task_count;
+
+/** True once we've pulled the linker-registered tasks into our table. */
+static bool legacy_tasks_collected;
+
+/** The DWT cycle counter used for task accounting; NULL until the first
+ * scheduler round brings it up. */
+static arm_dwt_register_block_t *scheduler_cycle_counter;
+
+/** Loop-frequency accounting: completed rounds, and the cycles they took
+ * -- accumulated per round into 64 bits, so the 32-bit counter's wrap
+ * (about 21 seconds at full clock) can't fold the totals. */
+static uint32_t scheduler_rounds;
+static uint64_t scheduler_round_cycles;
+
+/** The task currently executing, for the watchdog's expiry snapshot; NULL
+ * whenever control is back in the scheduler itself. */
+static struct scheduler_task * volatile scheduler_current_task;
+
+/** True once the loop has armed the hardware watchdog, and should feed it
+ * each time it regains control. */
+static bool scheduler_watchdog_armed;
+
+/** The idle protocol's shared ready word: set by anything that queues work
+ * (task markings, DPC pushes, or scheduler_signal_work() directly), and
+ * consumed by the idle loop before it allows itself to sleep. */
+static volatile uint32_t scheduler_work_pending;
 
 
 /**
- * Runs a single iteration of each defined task (a single scheduler "round")
- * For an variant that runs indefinitely, use scheduler_run().
+ * Signals the scheduler loop that work is pending; see <drivers/scheduler.h>.
  */
-void scheduler_run_tasks(void)
+void scheduler_signal_work(void)
+{
+	// Publish the work before the event, so a loop the SEV wakes is
+	// guaranteed to observe the set word when it re-checks.
+	__atomic_store_n(&scheduler_work_pending, 1, __ATOMIC_RELEASE);
+
+	// Latch a wakeup event: if the idle loop is between its check and its
+	// WFE, the event register holds this until the WFE consumes it, so the
+	// signal can't slip through that gap.
+	__asm__ volatile("sev");
+}
+
+
+//
+// Deferred procedure calls.
+//
+// ISRs that do their heavy lifting at interrupt priority stretch worst-case
+// interrupt latency for everything else (including timing-critical paths
+// like the SGPIO copy ISR); ISRs that instead set a flag for a polling task
+// wait up to a full scheduler round for service. A DPC splits the
+// difference: the ISR pushes a work item onto a lock-free queue -- a few
+// cycles, no interrupt masking -- and the scheduler drains the queue at
+// task priority, ahead of the regular task table, on the very next round.
+//
+// The pending queue is a multi-producer/single-consumer stack: producers
+// (ISRs at any priority, or tasks) push with an atomic compare-and-swap,
+// and the scheduler detaches the whole chain at once, reversing it so calls
+// run in the order they were queued. The GCC atomic builtins compile to
+// LDREX/STREX pairs on our Cortex-M parts, so a push can't lose against a
+// preempting push and never needs interrupts disabled.
+//
+
+/** Head of the pending-DPC stack; newest entry first, NULL when empty. */
+static scheduler_dpc_t * volatile dpc_pending_head;
+
+
+/**
+ * Queues a deferred procedure call; see <drivers/scheduler.h>.
+ */
+void scheduler_queue_dpc(scheduler_dpc_t *dpc)
+{
+	scheduler_dpc_t *head;
+
+	// If this call is already pending, coalesce with the pending instance;
+	// the test-and-set makes sure exactly one contender enqueues it.
+	if (__atomic_test_and_set(&dpc->queued, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	// Push the call onto the pending stack...
+	do {
+		head = dpc_pending_head;
+		dpc->next = head;
+	} while (!__atomic_compare_exchange_n(&dpc_pending_head, &head, dpc,
+			false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	// ... and wake the loop, in case it was (or was about to start) idling.
+	scheduler_signal_work();
+}
+
+
+/**
+ * Drains and runs every pending deferred procedure call, oldest first.
+ *
+ * @return true iff any call ran
+ */
+static bool scheduler_run_pending_dpcs(void)
+{
+	scheduler_dpc_t *chain, *reversed = NULL;
+
+	// Detach the whole pending chain in one exchange; pushes that race this
+	// land on the fresh, empty stack and are picked up next round.
+	chain = __atomic_exchange_n(&dpc_pending_head, NULL, __ATOMIC_ACQUIRE);
+	if (!chain) {
+		return false;
+	}
+
+	// The stack yields newest-first; reverse it so calls run in queue order.
+	while (chain) {
+		scheduler_dpc_t *next = chain->next;
+		chain->next = reversed;
+		reversed = chain;
+		chain = next;
+	}
+
+	while (reversed) {
+		scheduler_dpc_t *dpc = reversed;
+		reversed = dpc->next;
+
+		// Clear the pending mark before running, so the handler -- or an
+		// ISR that fires mid-handler -- can queue the call again without
+		// that queueing being lost.
+		__atomic_clear(&dpc->queued, __ATOMIC_RELEASE);
+		dpc->handler(dpc->context);
+	}
+
+	return true;
+}
+
+
+/**
+ * Inserts a task into the table, keeping it sorted by ascending priority.
+ * Tasks of equal priority retain their registration order.
+ */
+static int scheduler_insert_task(task_implementation_t implementation,
+		uint8_t priority, bool always_ready)
+{
+	unsigned int position, i;
+
+	if (task_count >= SCHEDULER_MAX_TASKS) {
+		pr_error("scheduler: task table is full; cannot register task!\n");
+		return ENOMEM;
+	}
+
+	// Find the insertion point for the new task...
+	for (position = 0; position < task_count; ++position) {
+		if (task_table[position].priority > priority) {
+			break;
+		}
+	}
+
+	// ... shift any lower-priority tasks down...
+	for (i = task_count; i > position; --i) {
+		task_table[i] = task_table[i - 1];
+	}
+
+	// ... and populate the new entry.
+	task_table[position].implementation = implementation;
+	task_table[position].priority = priority;
+	task_table[position].always_ready = always_ready;
+	task_table[position].ready = false;
+	++task_count;
+
+	return 0;
+}
+
+
+/**
+ * Pulls any tasks registered via DEFINE_TASK's linker section into our task
+ * table. These keep their historical behavior: they run every round, at the
+ * default priority.
+ */
+static void scheduler_collect_legacy_tasks(void)
 {
 	task_implementation_t *task;
 
-	// Execute each task in our list, once.
+	// Bring up the cycle counter backing task accounting, if it isn't already.
+	if (!scheduler_cycle_counter) {
+		profiling_initialize();
+		scheduler_cycle_counter = arch_get_dwt_registers();
+	}
+
+	if (legacy_tasks_collected) {
+		return;
+	}
+	legacy_tasks_collected = true;
+
 	for (task = &__task_array_start; task < &__task_array_end; task++) {
-		(*task)();
+		scheduler_insert_task(*task, SCHEDULER_DEFAULT_PRIORITY, true);
 	}
 }
 
+
 /**
- * Runs our round-robin scheduler for as long as the device is alive; never returns.
+ * Registers an event-driven task with the scheduler. Unlike tasks defined
+ * with DEFINE_TASK -- which are run every round -- an event-driven task runs
+ * only after scheduler_mark_task_ready() has been called for it, typically
+ * from an ISR.
+ */
+int scheduler_register_task(task_implementation_t implementation, uint8_t priority)
+{
+	scheduler_collect_legacy_tasks();
+	return scheduler_insert_task(implementation, priority, false);
+}
+
+
+/**
+ * Marks an event-driven task as ready to run. Safe to call from interrupt
+ * context; the next scheduler round will run the task, and an idle scheduler
+ * loop is woken to start that round immediately.
+ */
+void scheduler_mark_task_ready(task_implementation_t implementation)
+{
+	unsigned int i;
+
+	for (i = 0; i < task_count; ++i) {
+		if (task_table[i].implementation == implementation) {
+			task_table[i].ready = true;
+			scheduler_signal_work();
+			return;
+		}
+	}
+}
+
+
+/**
+ * Declares a per-iteration cycle budget for a task; see <drivers/scheduler.h>.
+ */
+int scheduler_set_task_deadline(task_implementation_t implementation, uint32_t cycles)
+{
+	unsigned int i;
+
+	for (i = 0; i < task_count; ++i) {
+		if (task_table[i].implementation == implementation) {
+			task_table[i].deadline_cycles = cycles;
+			task_table[i].deadline_overruns = 0;
+			return 0;
+		}
+	}
+
+	return EINVAL;
+}
+
+
+/**
+ * Arms watchdog supervision of the scheduler loop; see <drivers/scheduler.h>.
+ */
+int scheduler_enable_watchdog(uint32_t timeout)
+{
+	int rc = platform_watchdog_start(timeout);
+
+	if (rc) {
+		return rc;
+	}
+
+	scheduler_watchdog_armed = true;
+	return 0;
+}
+
+
+/**
+ * Runs one iteration of the given task, charging the cycles it consumes to
+ * its accounting record. The overhead is two counter reads per call.
+ */
+static void scheduler_run_task_accounted(struct scheduler_task *task)
+{
+	uint32_t start = scheduler_cycle_counter->cycle_count;
+	uint32_t delta;
+
+	scheduler_current_task = task;
+	task->implementation();
+	scheduler_current_task = NULL;
+
+	// Unsigned subtraction stays correct across a counter wrap.
+	delta = scheduler_cycle_counter->cycle_count - start;
+
+	task->invocations++;
+	task->total_cycles += delta;
+	if (delta > task->max_cycles) {
+		task->max_cycles = delta;
+	}
+
+	// If the task has declared a budget and blew it, note the overrun --
+	// loudly the first time, quietly (but countably) thereafter.
+	if (task->deadline_cycles && (delta > task->deadline_cycles)) {
+		if (task->deadline_overruns++ == 0) {
+			pr_warning("scheduler: task %p overran its deadline (%" PRIu32
+					" of %" PRIu32 " cycles)!\n",
+					task->implementation, delta, task->deadline_cycles);
+		}
+	}
+}
+
+
+/**
+ * Reports the address of the task currently executing, or 0 if control is
+ * in the scheduler itself. Overrides the weak stub in the crash-telemetry
+ * driver, which records this in watchdog-expiry snapshots.
+ */
+uint32_t scheduler_running_task_address(void)
+{
+	struct scheduler_task *task = scheduler_current_task;
+	return task ? (uint32_t)(uintptr_t)task->implementation : 0;
+}
+
+
+/**
+ * Runs a single scheduler round, in priority order.
+ *
+ * @return true iff any task ran during this round
+ */
+static bool scheduler_run_single_round(void)
+{
+	uint32_t round_start = scheduler_cycle_counter->cycle_count;
+	unsigned int i;
+	bool ran_any_task;
+
+	// Deferred procedure calls run first: they're the latency-sensitive
+	// half of work an ISR has already declined to do at interrupt priority.
+	ran_any_task = scheduler_run_pending_dpcs();
+
+	for (i = 0; i < task_count; ++i) {
+		struct scheduler_task *task = &task_table[i];
+
+		if (task->always_ready) {
+			scheduler_run_task_accounted(task);
+			ran_any_task = true;
+			continue;
+		}
+
+		if (task->ready) {
+			// Clear the flag before running, so a ready-marking that
+			// arrives mid-run isn't lost.
+			task->ready = false;
+			scheduler_run_task_accounted(task);
+			ran_any_task = true;
+		}
+	}
+
+	scheduler_rounds++;
+	scheduler_round_cycles += scheduler_cycle_counter->cycle_count - round_start;
+
+	// The completed round is our proof of liveness: a task wedged in an
+	// infinite loop never lets us reach this feed, so the watchdog expires
+	// -- capturing the wedged context -- and the unit reboots on its own.
+	if (scheduler_watchdog_armed) {
+		platform_watchdog_feed();
+	}
+
+	return ran_any_task;
+}
+
+
+/**
+ * Runs a single iteration of each runnable task (a single scheduler "round").
+ * For a variant that runs indefinitely, use scheduler_run().
+ */
+void scheduler_run_tasks(void)
+{
+	scheduler_collect_legacy_tasks();
+	scheduler_run_single_round();
+}
+
+
+/**
+ * Core-class introspection verb: dumps the scheduler's CPU accounting --
+ * three uint32s for the loop itself (completed rounds, then the cycles they
+ * consumed as a lo/hi pair), followed by a run of seven uint32s per task:
+ * implementation address, priority, flags (bit 0 set for tasks that run
+ * every round), invocations, total cycles (lo, hi), and the worst single
+ * iteration, in cycles. Together these tell us both how fast the loop is
+ * spinning and exactly where its time is going.
+ *
+ * Overrides the weak stub in classes/core.c when this module is present.
+ */
+int core_verb_get_scheduler_stats(struct command_transaction *trans)
+{
+	unsigned int i;
+
+	comms_response_add_uint32_t(trans, scheduler_rounds);
+	comms_response_add_uint32_t(trans, (uint32_t)scheduler_round_cycles);
+	comms_response_add_uint32_t(trans, (uint32_t)(scheduler_round_cycles >> 32));
+
+	for (i = 0; i < task_count; ++i) {
+		struct scheduler_task *task = &task_table[i];
+
+		comms_response_add_uint32_t(trans, (uint32_t)(uintptr_t)task->implementation);
+		comms_response_add_uint32_t(trans, task->priority);
+		comms_response_add_uint32_t(trans, task->always_ready ? 1 : 0);
+		comms_response_add_uint32_t(trans, task->invocations);
+		comms_response_add_uint32_t(trans, (uint32_t)task->total_cycles);
+		comms_response_add_uint32_t(trans, (uint32_t)(task->total_cycles >> 32));
+		comms_response_add_uint32_t(trans, task->max_cycles);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Core-class verb: clears the scheduler's accumulated CPU accounting, so a
+ * fresh measurement window can be taken while the device runs.
+ */
+int core_verb_reset_scheduler_stats(struct command_transaction *trans)
+{
+	unsigned int i;
+
+	(void)trans;
+
+	scheduler_rounds = 0;
+	scheduler_round_cycles = 0;
+
+	for (i = 0; i < task_count; ++i) {
+		task_table[i].invocations = 0;
+		task_table[i].total_cycles = 0;
+		task_table[i].max_cycles = 0;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Runs our scheduler for as long as the device is alive; never returns.
+ * Sleeps the core whenever no work is pending, waking at interrupt latency
+ * when an ISR signals more.
  */
 ATTR_NORETURN void scheduler_run(void)
 {
-	while(1) {
-		scheduler_run_tasks();
+	scheduler_collect_legacy_tasks();
+
+	while (1) {
+		bool ran_any_task = scheduler_run_single_round();
+
+		if (ran_any_task) {
+			continue;
+		}
+
+		// No task had work: sleep until someone signals more. Consuming the
+		// ready word and sleeping aren't atomic, but the protocol closes the
+		// classic race anyway: a signal landing between our check and the
+		// WFE latches a wakeup event, so that WFE falls straight through and
+		// we check again. Enabled interrupts wake WFE just as they would
+		// WFI, so wakeup latency stays at interrupt latency -- the core just
+		// stops burning (and dissipating) cycles while there's nothing to do.
+		while (!__atomic_exchange_n(&scheduler_work_pending, 0, __ATOMIC_ACQUIRE)) {
+
+			// An idle loop is a live loop: keep feeding across wakeups that
+			// bring no work, so supervision doesn't mistake quiet for wedged.
+			if (scheduler_watchdog_armed) {
+				platform_watchdog_feed();
+			}
+
+			__asm__ volatile("wfe");
+		}
 	}
 }
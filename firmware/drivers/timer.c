@@ -9,6 +9,7 @@
 
 #include <debug.h>
 #include <drivers/timer.h>
+#include <drivers/scheduler.h>
 
 
 /**
@@ -120,6 +121,27 @@ uint32_t get_time_since(uint32_t base)
 }
 
 
+/**
+ * @returns the total number of microseconds since this timer was initialized,
+ *		as a 64-bit value -- monotonic across 32-bit counter wraps, and good
+ *		for half a million years. Cheap enough to call from ISRs.
+ */
+uint64_t get_time_64(void)
+{
+	return platform_get_platform_timer_value_64();
+}
+
+
+/**
+ * @returns The total number of microseconds that have passed since a reference call to get_time_64().
+ *		Unlike get_time_since(), spans longer than ~71 minutes are measured correctly.
+ */
+uint64_t get_time_since_64(uint64_t base)
+{
+	return get_time_64() - base;
+}
+
+
 /**
  * Function that should be called whenever the platform timer's basis changes.
  * // FIXME: remove this!
@@ -180,6 +202,251 @@ uint32_t cancel_periodic_function_calls(hw_timer_t *timer)
 }
 
 
+//
+// Software timers: a timing wheel multiplexing any number of timed callbacks
+// onto a single hardware timer. See the discussion in <drivers/timer.h>.
+//
+
+// The wheel's geometry: a power-of-two number of slots, and a power-of-two
+// tick so slot computation is shift-and-mask rather than a 64-bit divide.
+// A 1024-microsecond tick gives callbacks ~1 ms resolution.
+#define SOFTWARE_TIMER_WHEEL_SLOTS 32
+#define SOFTWARE_TIMER_TICK_SHIFT  10
+#define SOFTWARE_TIMER_TICK_US     (1UL << SOFTWARE_TIMER_TICK_SHIFT)
+
+/** The wheel itself: one doubly-linked list of timers per slot. */
+static software_timer_t *software_timer_wheel[SOFTWARE_TIMER_WHEEL_SLOTS];
+
+/** Timers that have expired, awaiting their callbacks' turn on the scheduler. */
+static software_timer_t *software_timer_expired;
+
+/** The hardware timer that drives the wheel, and our bring-up state. */
+static hw_timer_t software_timer_hw;
+static bool software_timer_initialized;
+
+/** The last wheel tick we've processed. */
+static uint64_t software_timer_last_tick;
+
+
+/** Masks interrupts around wheel-list surgery; returns the state to restore. */
+static inline uint32_t software_timer_enter_critical(void)
+{
+	uint32_t primask;
+	__asm__ volatile ("mrs %0, PRIMASK\n\tcpsid i" : "=r"(primask) :: "memory");
+	return primask;
+}
+
+static inline void software_timer_exit_critical(uint32_t primask)
+{
+	__asm__ volatile ("msr PRIMASK, %0" :: "r"(primask) : "memory");
+}
+
+
+/**
+ * Links a timer into the wheel slot its expiry falls in. The caller must
+ * hold the wheel critical section.
+ */
+static void software_timer_insert(software_timer_t *timer)
+{
+	uint32_t slot = (timer->expiry >> SOFTWARE_TIMER_TICK_SHIFT) & (SOFTWARE_TIMER_WHEEL_SLOTS - 1);
+
+	timer->previous = NULL;
+	timer->next = software_timer_wheel[slot];
+	if (timer->next) {
+		timer->next->previous = timer;
+	}
+	software_timer_wheel[slot] = timer;
+}
+
+
+/**
+ * Unlinks a timer from whichever list it's currently on. The caller must
+ * hold the wheel critical section.
+ */
+static void software_timer_unlink(software_timer_t *timer)
+{
+	uint32_t slot;
+
+	if (timer->previous) {
+		timer->previous->next = timer->next;
+	} else if (software_timer_expired == timer) {
+		software_timer_expired = timer->next;
+	} else {
+		slot = (timer->expiry >> SOFTWARE_TIMER_TICK_SHIFT) & (SOFTWARE_TIMER_WHEEL_SLOTS - 1);
+		software_timer_wheel[slot] = timer->next;
+	}
+
+	if (timer->next) {
+		timer->next->previous = timer->previous;
+	}
+
+	timer->next = NULL;
+	timer->previous = NULL;
+}
+
+
+// Hands expired-timer dispatch off to task priority; defined just below.
+static void software_timer_dispatch(void *context);
+static scheduler_dpc_t software_timer_dispatch_dpc = {
+	.handler = software_timer_dispatch,
+};
+
+
+/**
+ * Deferred procedure call that runs expired timers' callbacks -- so user
+ * callbacks execute at task priority (ahead of regular tasks, keeping
+ * timer jitter low), and the wheel's ISR stays short.
+ */
+static void software_timer_dispatch(void *context)
+{
+	(void)context;
+
+	while (1) {
+		uint32_t flags = software_timer_enter_critical();
+		software_timer_t *timer = software_timer_expired;
+
+		if (timer) {
+			software_timer_unlink(timer);
+
+			// Re-arm periodic timers before their callback runs, so the
+			// callback can software_timer_cancel() to stop the series.
+			if (timer->interval) {
+				timer->expiry += timer->interval;
+				software_timer_insert(timer);
+			} else {
+				timer->active = false;
+			}
+		}
+		software_timer_exit_critical(flags);
+
+		if (!timer) {
+			break;
+		}
+
+		timer->callback(timer->argument);
+	}
+}
+
+
+/**
+ * The wheel's tick: runs from the backing hardware timer's interrupt,
+ * sweeps each slot we've advanced past, and moves due timers onto the
+ * expired list for the dispatch task. Batches naturally if tick interrupts
+ * are delayed.
+ */
+static void software_timer_tick(void *argument)
+{
+	uint64_t now_tick = get_time_64() >> SOFTWARE_TIMER_TICK_SHIFT;
+	bool any_expired = false;
+
+	(void)argument;
+
+	while (software_timer_last_tick < now_tick) {
+		uint32_t slot = ++software_timer_last_tick & (SOFTWARE_TIMER_WHEEL_SLOTS - 1);
+		software_timer_t *timer = software_timer_wheel[slot];
+
+		// Move each timer in this slot that's actually due -- and not just
+		// here for a later trip around the wheel -- to the expired list.
+		while (timer) {
+			software_timer_t *next = timer->next;
+
+			if ((timer->expiry >> SOFTWARE_TIMER_TICK_SHIFT) <= software_timer_last_tick) {
+				software_timer_unlink(timer);
+
+				timer->next = software_timer_expired;
+				if (timer->next) {
+					timer->next->previous = timer;
+				}
+				software_timer_expired = timer;
+
+				any_expired = true;
+			}
+
+			timer = next;
+		}
+	}
+
+	if (any_expired) {
+		scheduler_queue_dpc(&software_timer_dispatch_dpc);
+	}
+}
+
+
+/**
+ * Brings up the wheel's backing hardware timer and dispatch task; called
+ * automatically when the first software timer starts.
+ */
+static int software_timer_initialize(void)
+{
+	// One wheel tick per interrupt: 10^6 / 1024 microseconds, rounded.
+	const uint32_t tick_frequency = 977;
+
+	uint32_t rc = acquire_timer(&software_timer_hw);
+	if (rc) {
+		pr_error("timer: couldn't acquire a hardware timer for software timers!\n");
+		return rc;
+	}
+
+	software_timer_last_tick = get_time_64() >> SOFTWARE_TIMER_TICK_SHIFT;
+	call_function_periodically(&software_timer_hw, tick_frequency, software_timer_tick, NULL);
+
+	software_timer_initialized = true;
+	return 0;
+}
+
+
+/**
+ * Starts (or restarts) a software timer. O(1); safe to call from interrupt
+ * context, and from a timer's own callback. See <drivers/timer.h>.
+ */
+int software_timer_start(software_timer_t *timer, uint32_t interval_us,
+		bool periodic, timer_callback_t callback, void *argument)
+{
+	uint32_t flags;
+
+	if (!software_timer_initialized) {
+		int rc = software_timer_initialize();
+		if (rc) {
+			return rc;
+		}
+	}
+
+	flags = software_timer_enter_critical();
+
+	// Restarting an already-scheduled timer implicitly cancels it.
+	if (timer->active) {
+		software_timer_unlink(timer);
+	}
+
+	timer->expiry = get_time_64() + interval_us;
+	timer->interval = periodic ? interval_us : 0;
+	timer->callback = callback;
+	timer->argument = argument;
+	timer->active = true;
+	software_timer_insert(timer);
+
+	software_timer_exit_critical(flags);
+	return 0;
+}
+
+
+/**
+ * Cancels a software timer. O(1); safe to call from interrupt context, and
+ * on a timer that isn't running.
+ */
+void software_timer_cancel(software_timer_t *timer)
+{
+	uint32_t flags = software_timer_enter_critical();
+
+	if (timer->active) {
+		software_timer_unlink(timer);
+		timer->active = false;
+	}
+
+	software_timer_exit_critical(flags);
+}
+
+
 
 /**
  * Releases a timer reserved with acquire_timer.
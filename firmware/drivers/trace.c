@@ -0,0 +1,69 @@
+/*
+ * This file is part of libgreat
+ *
+ * Deferred binary trace facility -- see trace.h for the design rationale.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <toolchain.h>
+
+#include <drivers/timer.h>
+#include <drivers/trace.h>
+#include <drivers/memory/recordring.h>
+
+// Number of records in the trace ring; must be a power of two.
+#define TRACE_RING_DEPTH 32
+
+/**
+ * The trace ring: a multi-producer/single-consumer record ring, so trace
+ * points in any context -- ISRs included -- can interleave safely without
+ * masking interrupts. Statically defined, so tracing needs no init ordering.
+ */
+RECORDRING_DEFINE(trace_ring, sizeof(trace_record_t), TRACE_RING_DEPTH);
+
+
+void trace_emit(const char *format, uint32_t arg_count, ...)
+{
+	trace_record_t *record;
+	va_list args;
+
+	if (arg_count > TRACE_RECORD_MAX_ARGS) {
+		arg_count = TRACE_RECORD_MAX_ARGS;
+	}
+
+	// Claim a slot; if the ring is full, the drop has already been counted,
+	// and trace points never block.
+	record = recordring_claim(&trace_ring);
+	if (!record) {
+		return;
+	}
+
+	// Populate the claimed record...
+	record->format = (uint32_t)format;
+	record->timestamp = get_time();
+	record->arg_count = arg_count;
+
+	va_start(args, arg_count);
+	for (uint32_t i = 0; i < arg_count; ++i) {
+		record->args[i] = va_arg(args, uint32_t);
+	}
+	va_end(args);
+
+	// ... and publish it, so the consumer never sees it half-written.
+	recordring_publish(&trace_ring, record);
+}
+
+
+unsigned trace_read_records(trace_record_t *buffer, unsigned max_records)
+{
+	return recordring_read(&trace_ring, buffer, max_records);
+}
+
+
+uint32_t trace_records_dropped(void)
+{
+	return recordring_dropped(&trace_ring);
+}
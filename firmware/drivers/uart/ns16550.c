@@ -16,6 +16,7 @@
 
 typedef enum {
 	IRQ_RECEIVE_DATA_AVAILABLE = 0x2,
+	IRQ_CHARACTER_TIMEOUT      = 0x6,
 } pending_interrupt_t;
 
 
@@ -294,6 +295,17 @@ void uart_interrupt(uart_t *uart)
 	if(uart->reg->pending_interrupt == IRQ_RECEIVE_DATA_AVAILABLE) {
 		uart_data_ready_interrupt(uart);
 	}
+
+	// If the line has gone idle with data still waiting below the FIFO's
+	// trigger level, flush it -- in DMA mode, this is what bounds our
+	// receive latency.
+	if(uart->reg->pending_interrupt == IRQ_CHARACTER_TIMEOUT) {
+		if (uart->dma_enabled) {
+			platform_uart_dma_flush_rx(uart);
+		} else {
+			uart_data_ready_interrupt(uart);
+		}
+	}
 }
 
 
@@ -312,6 +324,12 @@ size_t uart_read(uart_t *uart, void *buffer, size_t count)
 	uint8_t *byte_buffer = buffer;
 	size_t data_read = 0;
 
+	// In block-transfer mode, the receive buffer is filled by DMA; hand off
+	// to the platform, which knows where the DMA engine has written to.
+	if (uart->dma_enabled) {
+		return platform_uart_dma_read(uart, buffer, count);
+	}
+
 	// Special case: if we're in synchronous mode, read and return
 	// a single byte -- this handles the case where this is called after
 	// an allocation fail-out.
@@ -344,3 +362,40 @@ void uart_transmit_synchronous(uart_t *uart, uint8_t byte)
 	while(!uart->reg->transmit_holding_register_empty);
 	uart->reg->transmit_buffer = byte;
 }
+
+
+/**
+ * Places the UART into block-transfer (DMA) mode; see uart.h.
+ */
+int uart_enable_dma(uart_t *uart)
+{
+	// DMA mode moves data through the asynchronous buffers; we can't
+	// operate without them.
+	if (uart->buffer_size == 0) {
+		return EINVAL;
+	}
+
+	return platform_uart_enable_dma(uart);
+}
+
+
+/**
+ * Writes a block of data to the UART; see uart.h.
+ */
+size_t uart_write(uart_t *uart, const void *buffer, size_t count)
+{
+	const uint8_t *byte_buffer = buffer;
+
+	// In block-transfer mode, enqueue into the transmit ring and let the
+	// DMA engine drain it.
+	if (uart->dma_enabled) {
+		return platform_uart_dma_write(uart, buffer, count);
+	}
+
+	// Otherwise, fall back to transmitting each byte synchronously.
+	for (size_t i = 0; i < count; ++i) {
+		uart_transmit_synchronous(uart, byte_buffer[i]);
+	}
+
+	return count;
+}
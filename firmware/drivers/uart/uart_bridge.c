@@ -0,0 +1,236 @@
+/*
+ * This file is part of libgreat
+ *
+ * UART-to-host bridge engine: streams a UART to a comms pipe, so host
+ * software gets a continuous byte stream instead of polling a read verb.
+ */
+
+#include <debug.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <drivers/comms.h>
+#include <drivers/scheduler.h>
+#include <drivers/timer.h>
+#include <drivers/uart.h>
+#include <drivers/uart_bridge.h>
+
+/** Size of each chunk handed to the transport; this is also the watermark
+ * at which we forward without waiting for the line to go idle. */
+#define UART_BRIDGE_CHUNK_SIZE 2048
+
+/** Number of chunks that can be in flight on the transport at once. */
+#define UART_BRIDGE_CHUNK_COUNT 4
+
+/** Interval between idle-flush polls: one timer-wheel tick. */
+#define UART_BRIDGE_POLL_INTERVAL_US 1024
+
+
+/**
+ * State for the active bridge. The pipe layer's callbacks don't carry a
+ * context argument, so -- like the ethernet driver's active controller --
+ * we support a single active bridge.
+ */
+static struct {
+	uart_t *uart;
+	struct comms_pipe *pipe;
+
+	// Periodic poll that flushes sub-watermark data once the line idles.
+	software_timer_t poll_timer;
+
+	// Staging chunks for UART-to-host data. The transport holds each chunk
+	// zero-copy until its send completes; sends complete in submission
+	// order, so a produced/completed counter pair tracks which chunks are
+	// still on loan. Each counter is written from only one context.
+	uint8_t chunks[UART_BRIDGE_CHUNK_COUNT][UART_BRIDGE_CHUNK_SIZE];
+	unsigned int chunks_produced;
+	volatile unsigned int chunks_completed;
+
+	uart_bridge_statistics_t statistics;
+	bool active;
+} uart_bridge;
+
+
+/**
+ * Scheduler task for the UART-to-host direction: drains the UART's receive
+ * buffer into staging chunks, and hands each to the transport.
+ */
+static void uart_bridge_rx_task(void)
+{
+	if (!uart_bridge.active) {
+		return;
+	}
+
+	while ((uart_bridge.chunks_produced - uart_bridge.chunks_completed) < UART_BRIDGE_CHUNK_COUNT) {
+		uint8_t *chunk = uart_bridge.chunks[uart_bridge.chunks_produced % UART_BRIDGE_CHUNK_COUNT];
+		size_t length;
+		int rc;
+
+		// Don't pull data out of the UART's buffer until the transport can
+		// actually take it; data is safe from overrun there as long as the
+		// UART's own ring has room.
+		if (!comms_pipe_ready(uart_bridge.pipe)) {
+			break;
+		}
+
+		length = uart_read(uart_bridge.uart, chunk, UART_BRIDGE_CHUNK_SIZE);
+		if (!length) {
+			break;
+		}
+
+		rc = comms_send_on_pipe(uart_bridge.pipe, chunk, length);
+		if (rc) {
+			// We checked readiness just above, so this should never happen;
+			// if it somehow does, the bytes we pulled are gone. Account for
+			// them, so the host can tell the stream has a gap.
+			uart_bridge.statistics.rx_discarded_bytes += length;
+			break;
+		}
+
+		++uart_bridge.chunks_produced;
+		uart_bridge.statistics.bytes_to_host += length;
+
+		// A short read means we've drained the line below our watermark;
+		// let the idle poll pick up whatever trickles in next.
+		if (length < UART_BRIDGE_CHUNK_SIZE) {
+			break;
+		}
+	}
+}
+
+
+/**
+ * Periodic poll: kicks the forwarding task, so data below the watermark
+ * still reaches the host within one poll interval of arriving.
+ */
+static void uart_bridge_poll(void *argument)
+{
+	(void)argument;
+	scheduler_mark_task_ready(uart_bridge_rx_task);
+}
+
+
+/**
+ * Pipe callback: a chunk's send has completed, so its staging buffer --
+ * and a flow-control credit -- are ours again.
+ */
+static int uart_bridge_handle_send_complete(void *data, uint32_t length)
+{
+	(void)data;
+	(void)length;
+
+	++uart_bridge.chunks_completed;
+	scheduler_mark_task_ready(uart_bridge_rx_task);
+	return 0;
+}
+
+
+/**
+ * Pipe callback: data has arrived from the host; transmit it out the UART.
+ */
+static int uart_bridge_handle_data_in(uint32_t verb, void *data, uint32_t length)
+{
+	size_t accepted;
+
+	(void)verb;
+
+	if (!uart_bridge.active) {
+		return EINVAL;
+	}
+
+	accepted = uart_write(uart_bridge.uart, data, length);
+	uart_bridge.statistics.bytes_from_host += accepted;
+
+	// The pipe's reception buffer is recycled as soon as we return, so any
+	// bytes the transmit ring couldn't take are lost; report them, so the
+	// host can back off (or slow its writes).
+	if (accepted < length) {
+		uart_bridge.statistics.tx_overrun_bytes += length - accepted;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Starts bridging the given UART to a comms pipe on the given class.
+ * See <drivers/uart_bridge.h>.
+ */
+int uart_bridge_initialize(uart_t *uart, struct comms_class *owning_class)
+{
+	struct comms_pipe_ops ops = {
+		.handle_data_in = uart_bridge_handle_data_in,
+		.handle_data_out_complete = uart_bridge_handle_send_complete,
+	};
+	int rc;
+
+	if (!uart || !owning_class) {
+		return EINVAL;
+	}
+	if (uart_bridge.active) {
+		return EBUSY;
+	}
+
+	// The bridge is built around the UART's buffered I/O; a UART without
+	// buffers can only do synchronous transfers.
+	if (!uart->buffer_size) {
+		return EINVAL;
+	}
+
+	// Prefer block-transfer (DMA) mode, so high baud rates don't cost an
+	// interrupt per byte; fall back to interrupt-driven buffering if the
+	// platform can't provide it.
+	rc = uart_enable_dma(uart);
+	if (rc) {
+		pr_warning("uart_bridge: DMA unavailable (%d); bridging with per-byte interrupts\n", rc);
+	}
+
+	uart_bridge.pipe = comms_register_pipe(owning_class, 0, ops);
+	if (!uart_bridge.pipe) {
+		return EBUSY;
+	}
+
+	uart_bridge.uart = uart;
+	uart_bridge.chunks_produced = 0;
+	uart_bridge.chunks_completed = 0;
+	uart_bridge.statistics = (uart_bridge_statistics_t){0};
+
+	scheduler_register_task(uart_bridge_rx_task, SCHEDULER_DEFAULT_PRIORITY);
+
+	rc = software_timer_start(&uart_bridge.poll_timer, UART_BRIDGE_POLL_INTERVAL_US,
+			true, uart_bridge_poll, NULL);
+	if (rc) {
+		pr_error("uart_bridge: couldn't start the idle-flush timer (%d)!\n", rc);
+		return rc;
+	}
+
+	uart_bridge.active = true;
+	return 0;
+}
+
+
+/**
+ * Stops an active bridge. Buffers already handed to the transport drain in
+ * the background; their completions are still accounted for.
+ */
+void uart_bridge_stop(void)
+{
+	if (!uart_bridge.active) {
+		return;
+	}
+
+	software_timer_cancel(&uart_bridge.poll_timer);
+	uart_bridge.active = false;
+}
+
+
+/**
+ * Copies out the active bridge's transfer and overrun counters.
+ */
+void uart_bridge_get_statistics(uart_bridge_statistics_t *statistics)
+{
+	*statistics = uart_bridge.statistics;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of libgreat
+ *
+ * Bit-plane transposition kernels.
+ *
+ * Multi-slice SGPIO captures land one channel per slice word: each 32-bit
+ * word holds 32 consecutive samples of a single channel, with the oldest
+ * sample in bit 0 ("bit-plane" layout). Analyzers and most host software
+ * instead want "sample-major" layout -- one word per sample, with bit c
+ * carrying channel c. These kernels convert between the two layouts a
+ * 32-sample block at a time, using word-level shift/mask networks rather
+ * than per-bit loops.
+ */
+
+#ifndef __LIBGREAT_BITPLANE_H__
+#define __LIBGREAT_BITPLANE_H__
+
+#include <toolchain.h>
+
+/**
+ * Transposes a 32x32 bit matrix in place: after the call, bit c of block[s]
+ * holds what bit s of block[c] held before it.
+ *
+ * This is the core kernel: with block[c] holding 32 samples of channel c
+ * (oldest sample in bit 0), the result holds one sample per word, with
+ * channel c in bit c. It runs in five shift/mask stages -- a few ALU
+ * operations per word -- rather than the thousand single-bit moves of a
+ * naive transpose.
+ *
+ * @param block The 32-word block to be transposed, in place.
+ */
+void bitplane_transpose_32x32(uint32_t block[32]);
+
+
+/**
+ * Converts one 32-sample block from bit-plane to sample-major layout, for
+ * buses of up to eight channels.
+ *
+ * @param planes An array of channel_count words; word c holds 32 samples of
+ *     channel c, oldest sample in bit 0.
+ * @param channel_count The number of channels on the bus; must be 1-8.
+ * @param samples Receives 32 bytes, one per sample; bit c of each byte
+ *     carries channel c, and bits above channel_count are zero.
+ */
+void bitplane_to_samples_u8(const uint32_t *planes, unsigned channel_count, uint8_t samples[32]);
+
+
+/**
+ * Converts one 32-sample block from sample-major back to bit-plane layout,
+ * for buses of up to eight channels; the inverse of bitplane_to_samples_u8.
+ *
+ * @param samples An array of 32 bytes, one per sample; bit c of each byte
+ *     carries channel c.
+ * @param channel_count The number of channels on the bus; must be 1-8.
+ * @param planes Receives channel_count words; word c holds 32 samples of
+ *     channel c, oldest sample in bit 0.
+ */
+void bitplane_from_samples_u8(const uint8_t samples[32], unsigned channel_count, uint32_t *planes);
+
+#endif
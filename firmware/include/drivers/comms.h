@@ -91,6 +91,15 @@ struct command_transaction {
 	 * Mostly an internal field\.
 	 */
 	uint32_t last_error_number;
+
+	/**
+	 * True iff data_in/data_out point directly into the backend's transfer
+	 * memory (e.g. DMA-visible USB endpoint buffers), rather than into a
+	 * staging copy. When set, handlers can parse arguments and build
+	 * responses in place -- via comms_response_reserve_space() and friends --
+	 * and no copy occurs between command handling and the wire.
+	 */
+	bool buffers_are_transfer_memory;
 };
 
 
@@ -216,6 +225,15 @@ struct comms_class {
 	 */
 	struct comms_verb *command_verbs;
 
+	/**
+	 * True for classes whose verb handlers should execute on the offload
+	 * coprocessor, when one is running: dispatch hands their commands to
+	 * comms_submit_command_to_coprocessor(), and only runs them locally
+	 * when no coprocessor transport claims them. Suitable for
+	 * latency-insensitive verbs, which then stop consuming main-core time.
+	 */
+	bool coprocessor_resident;
+
 
 	/**
 	 *  Forms a singly-linked list of comm classes.
@@ -225,6 +243,17 @@ struct comms_class {
 	 */
 	struct comms_class *next;
 
+	/**
+	 * Dispatch metadata, populated at registration time; essentially private.
+	 *
+	 * verb_count holds the number of non-sentinel verbs in command_verbs;
+	 * verbs_are_dense indicates that verb numbers are exactly 0 .. verb_count-1
+	 * in array order, which lets dispatch index the array directly instead of
+	 * scanning it.
+	 */
+	uint32_t verb_count;
+	bool verbs_are_dense;
+
 	/** TODO: pipe objects */
 };
 
@@ -234,6 +263,34 @@ struct comms_class {
  */
 struct comms_pipe {
 
+	/** The class that owns this pipe. */
+	struct comms_class *owning_class;
+
+	/** Flags describing how this pipe operates. TBD. */
+	uint32_t flags;
+
+	/** The operations provided by the pipe's owner. */
+	struct comms_pipe_ops ops;
+
+	/**
+	 * Transport binding, installed by the backend when the pipe is bound
+	 * to a physical channel (e.g. a pair of bulk endpoints). A pipe with
+	 * a NULL send operation is registered, but not yet usable.
+	 */
+	int (*backend_send)(struct comms_pipe *pipe, void *data, uint32_t length);
+	bool (*backend_ready)(struct comms_pipe *pipe);
+	void *backend_data;
+
+	/**
+	 * Credit-based flow control: the number of sends currently in flight
+	 * on the transport, and the maximum we'll allow before reporting
+	 * not-ready. Maintained by the core pipe layer.
+	 */
+	volatile uint32_t sends_in_flight;
+	uint32_t max_sends_in_flight;
+
+	/** True iff this pipe slot is in use. */
+	bool in_use;
 };
 
 
@@ -301,6 +358,97 @@ int comms_send_on_pipe(struct comms_pipe *pipe, void *data, uint32_t length);
 bool comms_pipe_ready(struct comms_pipe *pipe);
 
 
+/**
+ * Transport-facing pipe API -- used by backends (e.g. the USB bulk
+ * transport) to deliver pipe events into the core pipe layer.
+ */
+
+/**
+ * Notifies the pipe layer that a send issued via comms_send_on_pipe() has
+ * completed on the wire; releases its flow-control credit and invokes the
+ * owner's completion callbacks.
+ */
+void comms_pipe_handle_send_complete(struct comms_pipe *pipe, void *data, uint32_t length);
+
+/**
+ * Delivers a block of host-to-device data to the pipe's owner.
+ */
+void comms_pipe_handle_data_received(struct comms_pipe *pipe, void *data, uint32_t length);
+
+
+/**
+ * Per-verb execution statistics, gathered by the dispatch path when
+ * CONFIG_ENABLE_VERB_PROFILING is defined. Cycle counts come from the
+ * platform's cycle counter (the DWT, on Cortex-M parts); the dispatch-time
+ * cost is two counter reads plus a hashed table lookup per command.
+ */
+struct comms_verb_statistics {
+
+	// The verb this record tracks.
+	uint32_t class_number;
+	uint32_t verb_number;
+
+	// Times the verb has been dispatched.
+	uint32_t invocations;
+
+	// Total cycles spent in the verb's handler, and the handler's
+	// high-water-mark (slowest single invocation), in cycles.
+	uint32_t total_cycles;
+	uint32_t max_cycles;
+
+	// True iff this record is tracking a verb.
+	bool in_use;
+};
+
+#ifdef CONFIG_ENABLE_VERB_PROFILING
+
+/**
+ * @param index The record index, 0 up to the (fixed) table size.
+ * @return the given verb-statistics record, or NULL past the end of the table;
+ *		records with in_use unset have never been dispatched
+ */
+struct comms_verb_statistics *comms_get_verb_statistics(uint32_t index);
+
+/** Clears all accumulated per-verb statistics. */
+void comms_reset_verb_statistics(void);
+
+#endif
+
+
+/**
+ * Transaction-scoped scratch arena.
+ *
+ * Verb handlers that need temporary workspace have historically either
+ * heap-allocated it (and had to remember to free it on every exit path) or
+ * carved out a static buffer (spending SRAM permanently on memory that's
+ * live for microseconds). Instead, handlers can bump-allocate from a shared
+ * scratch arena whose contents are valid only for the current command: the
+ * dispatch path resets the whole arena before each handler runs, so there
+ * is nothing to free, and transient comms allocations never touch -- or
+ * fragment -- the main heap.
+ */
+
+// The size of the shared scratch arena, in bytes.
+// Boards with unusually hungry verb handlers can override this.
+#ifndef COMMS_SCRATCH_ARENA_SIZE
+#define COMMS_SCRATCH_ARENA_SIZE (1024)
+#endif
+
+/**
+ * Allocates temporary workspace valid for the duration of the current
+ * command; the allocation is a pointer bump, and is freed automatically
+ * when the transaction completes.
+ *
+ * @param trans The transaction the workspace belongs to.
+ * @param size The amount of workspace desired, in bytes; the returned
+ *		block is word-aligned.
+ * @return the workspace, or NULL if the arena is exhausted -- in which
+ *		case the transaction is also marked as failed, so handlers that
+ *		bail via comms_transaction_okay() need no separate check
+ */
+void *comms_scratch_alloc(struct command_transaction *trans, uint32_t size);
+
+
 /**
  * Macros that allow us to easily annotate comms prints.
  */
@@ -325,6 +473,26 @@ bool comms_pipe_ready(struct comms_pipe *pipe);
  */
 
 
+/*
+ * Wrappers for the human-readable metadata in verb tables: documentation
+ * strings and parameter-name lists. Normally these pass their argument
+ * through untouched; when the build sets LIBGREAT_STRIP_VERB_DOCUMENTATION
+ * (see the option of the same name in libgreat.cmake), they compile to the
+ * empty string instead, reclaiming the flash the strings would occupy and
+ * shrinking the introspection responses sent on every first connect. The
+ * numeric in/out signatures are never stripped, so hosts can still build
+ * RPC stubs; pygreat fills in documentation from its host-side bundle when
+ * a device hands it empty strings.
+ */
+#if defined(LIBGREAT_STRIP_VERB_DOCUMENTATION)
+	#define COMMS_DOC(string) ""
+	#define COMMS_PARAM_NAMES(string) ""
+#else
+	#define COMMS_DOC(string) string
+	#define COMMS_PARAM_NAMES(string) string
+#endif
+
+
 /* Registers a given comms_class_t for use. */
 #define COMMS_PROVIDE_CLASS(defined_name) \
 	void defined_name##__auto_initializer(void) { comms_register_class(&defined_name); }; \
@@ -334,12 +502,44 @@ bool comms_pipe_ready(struct comms_pipe *pipe);
 #define COMMS_DEFINE_SIMPLE_CLASS(defined_name, number, string, verbs, documentation) \
 	struct comms_class defined_name##__object_ = { \
 		.name = string, \
-        .doc = documentation, \
+		.doc = COMMS_DOC(documentation), \
 		.class_number = number, \
 		.command_verbs = verbs, \
 	}; \
 	COMMS_PROVIDE_CLASS(defined_name##__object_)
 
+/*
+ * Registers a fully-const comms class by placing a pointer to it in the
+ * flash-resident class table, which the dispatcher consults alongside the
+ * linked list. No registration code runs for these classes; they merely get
+ * indexed at startup, and all of their metadata stays in flash.
+ */
+#define COMMS_PROVIDE_CLASS_IN_ROM(defined_name) \
+	__attribute__((section(".comms_class_table"), used)) \
+	static const struct comms_class *const defined_name##__table_entry_p = &defined_name;
+
+/*
+ * Defines a comms class entirely in flash, and registers it via the class
+ * table. Unlike COMMS_DEFINE_SIMPLE_CLASS, the class and its verb array must
+ * be const, and every verb must carry an explicit verb number -- verb
+ * auto-assignment would require mutating the array at boot.
+ */
+#define COMMS_DEFINE_SIMPLE_CONST_CLASS(defined_name, number, string, verbs, documentation) \
+	const struct comms_class defined_name##__object_ = { \
+		.name = string, \
+		.doc = COMMS_DOC(documentation), \
+		.class_number = number, \
+		/* Safe cast: the dispatch path never mutates table-registered
+		 * classes, as their metadata is computed here, at compile time. */ \
+		.command_verbs = (struct comms_verb *)verbs, \
+		.verb_count = (sizeof(verbs) / sizeof(verbs[0])) - 1, \
+	}; \
+	COMMS_PROVIDE_CLASS_IN_ROM(defined_name##__object_)
+
+/* Bounds of the flash-resident class table; provided by the linker script. */
+extern const struct comms_class *const __comms_class_table_start[];
+extern const struct comms_class *const __comms_class_table_end[];
+
 
 /**
  * Simple functions that help us to parse arguments and respond with data.
@@ -363,6 +563,25 @@ COMMS_DECLARE_HELPERS(int16_t);
 COMMS_DECLARE_HELPERS(int32_t);
 COMMS_DECLARE_HELPERS(_Bool);
 
+/**
+ * Typed bulk-array response builders: append count elements of the named
+ * type in one call, with a single validation and a bulk copy (skipped
+ * entirely when the array was built in place in reserved response space).
+ * Elements land in device byte order, matching the host's "<*T" decodes.
+ * Returns a pointer to the array within the response, or NULL (with the
+ * transaction marked overrun) if it wouldn't fit.
+ */
+#define COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(type) \
+	void *comms_response_add_##type##_array(struct command_transaction *trans, \
+			const type *values, uint32_t count)
+
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(uint8_t);
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(uint16_t);
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(uint32_t);
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(int8_t);
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(int16_t);
+COMMS_DECLARE_ARRAY_RESPONSE_HANDLER(int32_t);
+
 /** Alias for _Bool, per the C standard. */
 static inline void *comms_response_add_bool(struct command_transaction *trans, bool response)
 {
@@ -406,6 +625,45 @@ void *comms_response_reserve_space(struct command_transaction *trans, uint32_t s
 void *comms_response_add_raw(struct command_transaction *trans, void *data, uint32_t length);
 
 
+/**
+ * Reserves a uint32_t length slot in the response, for building
+ * length-prefixed variable records in place: reserve the slot, append the
+ * record's data by any means (the usual response helpers, or writing -- even
+ * DMAing -- into space from comms_response_reserve_space()), then patch the
+ * slot with comms_response_patch_length_field() once the length is known.
+ *
+ * @param trans The associated transaction.
+ * @return a handle for the reserved slot, to be passed to
+ *      comms_response_patch_length_field(); or NULL if there was no room
+ */
+uint32_t *comms_response_reserve_length_field(struct command_transaction *trans);
+
+
+/**
+ * Patches a length slot from comms_response_reserve_length_field() with the
+ * number of bytes appended to the response since the slot was reserved.
+ *
+ * @param trans The associated transaction.
+ * @param length_field The handle returned at reservation; NULL is tolerated
+ *      (and ignored), so the reservation's failure handling can be deferred
+ *      to the transaction's overrun status.
+ */
+void comms_response_patch_length_field(struct command_transaction *trans, uint32_t *length_field);
+
+
+/**
+ * Accounts for response data written in place -- e.g. DMAed directly into
+ * the response buffer -- advancing the response past it. The caller must
+ * have checked comms_response_space_available() first.
+ *
+ * @param trans The associated transaction.
+ * @param length The number of bytes written at the response's current
+ *      position.
+ * @return a pointer to the start of the committed data
+ */
+void *comms_response_commit_space(struct command_transaction *trans, uint32_t length);
+
+
 /**
  * @return the total amount of space remaining for response arguments
  */
@@ -444,6 +702,70 @@ static inline bool comms_argument_parse_okay(struct command_transaction *trans)
 }
 
 
+//
+// Fast-path argument parsing.
+//
+// The comms_argument_parse_* functions above are out-of-line calls that each
+// re-check bounds; for argument-heavy verbs, that overhead dominates handler
+// execution. A handler with a fixed argument block can instead perform one
+// bounds check up front with comms_argument_check_block(), and then pull each
+// argument with the inline, unchecked comms_argument_read_* readers:
+//
+//     if (!comms_argument_check_block(trans, 2 * sizeof(uint32_t) + sizeof(uint8_t))) {
+//         return EBADMSG;
+//     }
+//     uint32_t port  = comms_argument_read_uint32_t(trans);
+//     uint32_t pin   = comms_argument_read_uint32_t(trans);
+//     uint8_t  value = comms_argument_read_uint8_t(trans);
+//
+// The readers must only be used inside a successfully-checked block; anything
+// variable-length or conditional should stay on the checked path.
+//
+
+/**
+ * Checks, once, that the argument buffer still holds at least @p block_size
+ * bytes -- the combined size of a fast-path block's arguments. On failure,
+ * flags the transaction exactly as an underrunning checked parse would.
+ *
+ * @return true iff the block's arguments may be read unchecked
+ */
+static inline bool comms_argument_check_block(struct command_transaction *trans, uint32_t block_size)
+{
+	if (block_size > trans->data_in_remaining) {
+		trans->data_in_status |= COMMS_PARSE_UNDERRUN;
+		return false;
+	}
+
+	return true;
+}
+
+/** Unchecked typed argument readers; see comms_argument_check_block(). */
+#define COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(type) \
+	static inline type comms_argument_read_##type(struct command_transaction *trans) \
+	{ \
+		type *target = (type *)trans->data_in_position; \
+		type value = *target; \
+		\
+		trans->data_in_position = target + 1; \
+		trans->data_in_remaining -= sizeof(type); \
+		\
+		return value; \
+	}
+
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(uint8_t)
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(uint16_t)
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(uint32_t)
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(int8_t)
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(int16_t)
+COMMS_DEFINE_UNCHECKED_ARGUMENT_READER(int32_t)
+
+/** Alias for _Bool, matching the checked parser's bool alias. */
+static inline bool comms_argument_read_bool(struct command_transaction *trans)
+{
+	return comms_argument_read_uint8_t(trans) ? true : false;
+}
+
+
 /**
  * @return True iff argument parsing has completely succesfully thus far.
  */
@@ -28,6 +28,29 @@ struct ATTR_PACKED libgreat_command_prelude {
 };
 
 
+/**
+ * Header for a single command within a batch submission. Each command is
+ * a prelude plus a length, followed by data_length bytes of arguments;
+ * the next command's header follows at the next 4-byte boundary.
+ */
+struct ATTR_PACKED libgreat_batch_command_header {
+	uint32_t class_number;
+	uint32_t verb;
+	uint32_t data_length;
+};
+
+/**
+ * Header for a single response within a batch response. Each response
+ * carries the status of its command and the length of the response data
+ * that follows; the next response's header follows at the next 4-byte
+ * boundary.
+ */
+struct ATTR_PACKED libgreat_batch_response_header {
+	uint32_t status;
+	uint32_t data_length;
+};
+
+
 /**
  * Submits a command for execution. Used by command backends.
  *
@@ -39,6 +62,40 @@ int comms_backend_submit_command(struct comm_backend_driver *backend,
 	struct command_transaction *trans);
 
 
+/**
+ * Submits a batch of commands for in-order execution. Used by command
+ * backends. The transaction's data_in carries a sequence of batch command
+ * headers and their arguments; its data_out receives a matching sequence of
+ * batch response headers and response data.
+ *
+ * @param backend The command backend driver submitting the given batch.
+ * @param trans An object whose buffers carry the batch container; its
+ *		class_number and verb are ignored.
+ *
+ * @return 0 if the batch container was well-formed (individual command
+ *		failures are reported in-band, in each response header), or an
+ *		error code if the container itself was malformed.
+ */
+int comms_backend_submit_batch(struct comm_backend_driver *backend,
+	struct command_transaction *trans);
+
+
+/**
+ * Hands a command for a coprocessor-resident class (see the
+ * coprocessor_resident flag in struct comms_class) to the offload
+ * coprocessor for execution, blocking until it completes.
+ *
+ * The weak stub always returns ENODEV; the platform's inter-core comms
+ * transport overrides it when present. Dispatch treats ENODEV -- no
+ * transport built in, no coprocessor running, or its request ring
+ * unavailable -- as its cue to run the handler locally instead.
+ *
+ * @param trans The command to be executed, and its response.
+ * @return the handler's return code; ENODEV to decline the command.
+ */
+int comms_submit_command_to_coprocessor(struct command_transaction *trans);
+
+
 /**
  * @returns The comms_class object with the given number, or
  *		NULL if none exists.
@@ -0,0 +1,45 @@
+/*
+ * This file is part of libgreat
+ *
+ * Ethernet (UDP) backend to the libgreat communications API.
+ */
+
+#ifndef __LIBGREAT_COMMS_BACKEND_ETHERNET_H__
+#define __LIBGREAT_COMMS_BACKEND_ETHERNET_H__
+
+#include <stdint.h>
+#include <toolchain.h>
+
+#include <drivers/ethernet.h>
+
+// The UDP port on which the device listens for libgreat commands.
+#define LIBGREAT_ETHERNET_PORT 0x4747
+
+
+/**
+ * Transport header that precedes the standard command prelude in each
+ * datagram. The sequence number is echoed in the response, so the host can
+ * match responses to requests (and detect loss) over an unreliable
+ * transport; flags carry the same LIBGREAT_REQUEST_FLAG_* values the USB
+ * backend accepts in wIndex. In responses, flags instead carries the
+ * command's status: 0, or the errno with which the command failed.
+ */
+struct ATTR_PACKED libgreat_ethernet_header {
+	uint32_t sequence;
+	uint32_t flags;
+};
+
+
+/**
+ * Attaches the libgreat command protocol to an ethernet controller: the
+ * device will answer ARP queries for the given address, and execute libgreat
+ * commands sent to it over UDP. Should be called after ethernet_init(), but
+ * before ethernet_start().
+ *
+ * @param device The controller that will carry command traffic.
+ * @param ip_address The device's IPv4 address, in network byte order.
+ * @return 0 on success, or an error code on failure
+ */
+int comms_backend_ethernet_init(ethernet_controller_t *device, const uint8_t *ip_address);
+
+#endif
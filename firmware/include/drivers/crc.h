@@ -0,0 +1,42 @@
+/*
+ * This file is part of libgreat
+ *
+ * CRC32 computation, for fast device-side verification of large regions.
+ */
+
+#ifndef __LIBGREAT_CRC_H__
+#define __LIBGREAT_CRC_H__
+
+#include <stdint.h>
+
+/**
+ * Starts an incremental CRC32 (IEEE 802.3 / zlib polynomial) computation.
+ *
+ * @return the initial CRC state, to be passed to crc32_update()
+ */
+uint32_t crc32_init(void);
+
+/**
+ * Folds a buffer into an in-progress CRC32 computation.
+ *
+ * @param crc The CRC state from crc32_init() or a previous update.
+ * @param data The data to be folded in.
+ * @param length The length of the data, in bytes.
+ * @return the updated CRC state
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, uint32_t length);
+
+/**
+ * Completes an incremental CRC32 computation.
+ *
+ * @param crc The CRC state from the final crc32_update() call.
+ * @return the finished CRC32 value
+ */
+uint32_t crc32_finalize(uint32_t crc);
+
+/**
+ * Convenience function that computes the CRC32 of a single buffer.
+ */
+uint32_t crc32_compute(const void *data, uint32_t length);
+
+#endif
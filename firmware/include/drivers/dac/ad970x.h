@@ -9,13 +9,42 @@
 
 #include <toolchain.h>
 #include <drivers/gpio.h>
+#include <drivers/platform_ssp.h>
+
+/**
+ * The transports available for the DAC's configuration interface.
+ */
+typedef enum {
+
+	// Bit-bang the configuration protocol pin by pin; works on any four
+	// GPIOs, but takes milliseconds per register write.
+	AD970X_TRANSPORT_GPIO = 0,
+
+	// Drive the configuration bus with a hardware SSP controller; register
+	// writes become a few-microsecond FIFO operation. The board must route
+	// SCK and the DAC's data-in through the SSP's pins; CS and MODE remain
+	// GPIOs. Register reads require the DAC's data-out routed to the SSP's
+	// MISO -- on boards that share a single bidirectional data line, reads
+	// aren't available over this transport.
+	AD970X_TRANSPORT_SSP,
+
+} ad970x_transport_t;
+
 
 /**
  * Structure representing an AD970X DAC.
  */
 typedef struct {
 
+	// The transport used for register access.
+	ad970x_transport_t transport;
+
+	// For the SSP transport: the controller driving the bus, which must be
+	// initialized (8-bit frames, SPI mode 0) before ad970x_initialize().
+	ssp_t *ssp;
+
 	// GPIO locations for each of the GPIO pins in our DAC interface.
+	// With the SSP transport, only the CS and MODE pins are used.
 	gpio_pin_t gpio_cs;
 	gpio_pin_t gpio_sck;
 	gpio_pin_t gpio_data;
@@ -31,6 +60,15 @@ typedef struct {
 } ad970x_t;
 
 
+/**
+ * An (address, value) pair for batched register writes.
+ */
+typedef struct {
+	uint8_t address;
+	uint8_t value;
+} ad970x_register_value_t;
+
+
 /**
  * Sets up a new connection to an AD970x DAC.
  *
@@ -59,4 +97,15 @@ uint8_t ad970x_register_read(ad970x_t *dac, uint8_t address);
  */
 void ad970x_register_write(ad970x_t *dac, uint8_t address, uint8_t value);
 
+
+/**
+ * Writes a batch of DAC configuration registers back-to-back -- e.g. a full
+ * register snapshot, or the register set for a gain ramp step. Over the SSP
+ * transport, the whole batch is applied in one FIFO-fed burst.
+ *
+ * @param registers The (address, value) pairs to be written, in order.
+ * @param count The number of registers to write.
+ */
+void ad970x_register_write_batch(ad970x_t *dac, const ad970x_register_value_t *registers, size_t count);
+
 #endif
@@ -0,0 +1,70 @@
+/*
+ * This file is part of libgreat
+ *
+ * Arbitrary waveform playback engine: feeds a DAC from a circulating ring
+ * buffer using sample-rate-paced DMA, with host refill through a comms pipe.
+ */
+
+#ifndef __LIBGREAT_DAC_WAVEFORM_H__
+#define __LIBGREAT_DAC_WAVEFORM_H__
+
+#include <stdint.h>
+
+#include <drivers/comms.h>
+#include <drivers/dac.h>
+
+/**
+ * Statistics for an active playback engine; all counters reset on start.
+ */
+typedef struct {
+
+	/** Total samples accepted from the host. */
+	uint64_t samples_received;
+
+	/** Total samples converted by the DAC. */
+	uint64_t samples_played;
+
+	/** Samples from the host that didn't fit in the ring, and were dropped. */
+	uint32_t samples_dropped;
+
+} dac_waveform_statistics_t;
+
+
+/**
+ * Starts waveform playback on the given DAC.
+ *
+ * Playback is fed from an internal ring of samples, which DMA circulates
+ * into the DAC at the given sample rate with no processor involvement; the
+ * host streams little-endian 16-bit samples (of which the DAC's significant
+ * bits are used) into the ring through a comms pipe on the given class.
+ *
+ * The ring's contents loop: if the host stops refilling -- deliberately or
+ * otherwise -- the most recent ring's worth of samples repeats. A host can
+ * exploit this by preloading a whole number of waveform periods and sending
+ * nothing further, generating a continuous tone with no streaming cost.
+ *
+ * Only one playback engine can be active at a time, as the pipe layer's
+ * callbacks don't carry a context argument.
+ *
+ * @param dac The DAC to play out of; must already be initialized.
+ * @param owning_class The comms class that will carry the engine's data pipe.
+ * @param sample_rate The playback rate, in samples per second.
+ * @return 0 on success, or an error code on failure -- EINVAL for an
+ *     unachievable sample rate, or EBUSY if the engine, a DMA channel, or
+ *     the class's pipe is already in use.
+ */
+int dac_waveform_start(dac_t *dac, struct comms_class *owning_class, uint32_t sample_rate);
+
+
+/**
+ * Stops an active playback engine; the DAC holds its last converted value.
+ */
+void dac_waveform_stop(void);
+
+
+/**
+ * Copies out the active engine's playback and overrun counters.
+ */
+void dac_waveform_get_statistics(dac_waveform_statistics_t *statistics);
+
+#endif
@@ -10,6 +10,10 @@
 #include <toolchain.h>
 #include <drivers/ethernet/platform.h>
 
+// Callback type invoked when received frames are ready to harvest.
+typedef void (*ethernet_frame_callback_t)(struct ethernet_controller *device);
+
+
 /**
  * Data structure storing state for an ethernet controller.
  */
@@ -19,6 +23,13 @@ typedef struct ethernet_controller {
 	// system's ethernet controller.
 	ethernet_register_block_t *reg;
 
+	// The station's MAC address; should be populated before ethernet_start().
+	uint8_t mac_address[6];
+
+	// Optional callback invoked (from interrupt context) when one or more
+	// received frames are ready; NULL to poll with ethernet_read_frame().
+	ethernet_frame_callback_t frame_received_callback;
+
 	// Platform-specific data.
 	ethernet_platform_data_t platform;
 
@@ -32,6 +43,55 @@ typedef struct ethernet_controller {
 void ethernet_init(ethernet_controller_t *device);
 
 
+/**
+ * Starts the controller's receive and transmit paths. The MAC address and
+ * any frame_received callback should be populated before this is called.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int ethernet_start(ethernet_controller_t *device);
+
+
+/**
+ * Fetches the oldest pending received frame, zero-copy. The returned buffer
+ * belongs to the caller until it's handed back via ethernet_release_frame().
+ *
+ * @param length Out argument; receives the frame's length, in bytes.
+ * @return the frame's buffer, or NULL if no frame is pending
+ */
+uint8_t *ethernet_read_frame(ethernet_controller_t *device, uint32_t *length);
+
+
+/**
+ * Returns a buffer fetched with ethernet_read_frame() to the receive pool.
+ */
+void ethernet_release_frame(ethernet_controller_t *device, void *buffer);
+
+
+/**
+ * Queues a single-segment frame for transmit. The buffer must remain valid
+ * until ethernet_transmit_complete() reports the ring drained.
+ *
+ * @return 0 on success, or EBUSY if the transmit ring is full
+ */
+int ethernet_transmit_frame(ethernet_controller_t *device, const void *data, uint32_t length);
+
+
+/**
+ * Queues a multi-segment frame for transmit, using one chained descriptor
+ * per segment -- e.g. a protocol header and a payload that live in different
+ * buffers -- without a gather copy.
+ *
+ * @return 0 on success, or EBUSY if the transmit ring lacks room
+ */
+int ethernet_transmit_chained(ethernet_controller_t *device,
+		const void *const *segments, const uint32_t *lengths, unsigned segment_count);
+
+
+/**
+ * @return true iff all queued transmit frames have left the controller
+ */
+bool ethernet_transmit_complete(ethernet_controller_t *device);
 
 
 #endif
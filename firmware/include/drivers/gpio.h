@@ -9,6 +9,8 @@
 #ifndef __LIBGREAT_GPIO_H__
 #define __LIBGREAT_GPIO_H__
 
+#include <stddef.h>
+
 #include <drivers/platform_gpio.h>
 
 
@@ -90,6 +92,40 @@ uint32_t gpio_get_pin_direction(gpio_pin_t pin);
 int gpio_set_port_value(uint8_t port, uint32_t mask, uint32_t value);
 
 
+/**
+ * Configures which of a port's pins subsequent masked-port accesses touch,
+ * using the hardware's pin masking. Pays the mask configuration once, so
+ * each following gpio_write_masked_port() is a single register store --
+ * the fast path for bit-banged protocols that repeatedly update the same
+ * pin subset. gpio_set_port_value()/gpio_get_port_value() reprogram the
+ * same hardware mask; re-configure after calling them.
+ *
+ * @param port The number of the port to be configured.
+ * @param mask A bit-mask with a 1 for each pin masked accesses should affect.
+ */
+int gpio_configure_port_mask(uint8_t port, uint32_t mask);
+
+
+/**
+ * Writes the pins selected by gpio_configure_port_mask(), leaving the
+ * port's other pins untouched. For the unvalidated, guaranteed-inline
+ * variant, see platform_gpio_write_masked_port() in the platform header.
+ *
+ * @param port The number of the port to be written.
+ * @param value The value to write; only masked-in bits take effect.
+ */
+int gpio_write_masked_port(uint8_t port, uint32_t value);
+
+
+/**
+ * Reads the pins selected by gpio_configure_port_mask(); pins outside the
+ * mask read as zero.
+ *
+ * @param port The number of the port to be read.
+ */
+uint32_t gpio_read_masked_port(uint8_t port);
+
+
 /**
  * Sets a collection of bits in a GPIO port.
  *
@@ -171,4 +207,70 @@ uint8_t gpio_get_pin_value(gpio_pin_t pin);
  */
 inline uint32_t gpio_fast_get_pin_value(gpio_pin_t pin);
 
+
+/** Maximum number of ports a single gpio_capture_ports() pass can sample. */
+#define GPIO_CAPTURE_MAX_PORTS 4
+
+
+/**
+ * Captures the values of one or more GPIO ports at a fixed sample rate --
+ * software logic capture for modest (~1-5 MHz) rates, so the system's
+ * dedicated capture hardware stays free for the fast channels. Blocks for
+ * the duration of the capture, and is sensitive to interrupt load; callers
+ * wanting deterministic cadence should capture with interrupts quiesced.
+ *
+ * @param ports The numbers of the ports to sample, each sample reading every
+ *		listed port in order; at most GPIO_CAPTURE_MAX_PORTS.
+ * @param port_count The number of ports in the list.
+ * @param sample_rate The capture rate, in Hz; bounded above by the time it
+ *		takes to read the listed ports.
+ * @param buffer The caller's capture buffer, which receives port_count words
+ *		per sample, interleaved in list order.
+ * @param sample_count The number of multi-port samples to capture.
+ * @return 0 on success, or an error code on failure
+ */
+int gpio_capture_ports(const uint8_t *ports, unsigned port_count,
+		uint32_t sample_rate, uint32_t *buffer, size_t sample_count);
+
+
+/** Callback type for GPIO pin interrupts. */
+typedef void (*gpio_interrupt_callback_t)(gpio_pin_t pin, void *user_data);
+
+
+/** Edge sensitivities available for GPIO pin interrupts. */
+typedef enum {
+	GPIO_INTERRUPT_RISING_EDGE,
+	GPIO_INTERRUPT_FALLING_EDGE,
+	GPIO_INTERRUPT_BOTH_EDGES,
+} gpio_interrupt_sensitivity_t;
+
+
+/**
+ * Registers an edge-triggered interrupt callback for a GPIO pin, claiming
+ * one of the platform's pin-interrupt channels. Dispatch is vectored -- the
+ * handler jumps directly to pending channels rather than scanning -- so
+ * registering additional pins doesn't add latency to the others.
+ *
+ * @param pin The pin to watch.
+ * @param sensitivity The edge (or edges) that should trigger the callback.
+ * @param callback The function to invoke when the pin's edge is seen.
+ * @param user_data Opaque argument passed through to the callback.
+ * @param defer_to_scheduler If true, the callback runs from the scheduler's
+ *		next round instead of interrupt context -- for handlers too slow or
+ *		too stateful to run from an ISR. Deferred callbacks may coalesce:
+ *		several edges before the scheduler runs produce a single call.
+ * @return 0 on success, EBUSY if no pin-interrupt channel is free, or
+ *		another error code on failure
+ */
+int gpio_interrupt_register(gpio_pin_t pin, gpio_interrupt_sensitivity_t sensitivity,
+		gpio_interrupt_callback_t callback, void *user_data, bool defer_to_scheduler);
+
+
+/**
+ * Unregisters a pin's interrupt callback, releasing its channel.
+ *
+ * @return 0 on success, or EINVAL if the pin has no registered interrupt
+ */
+int gpio_interrupt_unregister(gpio_pin_t pin);
+
 #endif // __LIBGREAT_GPIO_H__
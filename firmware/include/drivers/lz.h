@@ -0,0 +1,117 @@
+/*
+ * This file is part of libgreat
+ *
+ * Streaming LZ decompression, for compressed image uploads.
+ */
+
+#ifndef __LIBGREAT_LZ_H__
+#define __LIBGREAT_LZ_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * RAM-loadable programs (see LPC43xx_l0adable.ld) are re-uploaded constantly
+ * during development, and the transfer dominates that loop. Code and initialized
+ * data compress well -- typically 3-4x -- so the host compresses the image and
+ * the device runs this decoder over each chunk as it arrives, landing the image
+ * at its load address faster than the raw bytes could cross the transport. The
+ * decompressed output doubles as the match window, so decoding into RAM needs
+ * no memory beyond the decoder state below.
+ *
+ * Typical staging, from whatever handler receives the upload:
+ *
+ *     lz_decoder_init(&decoder, (void *)load_address, maximum_size);
+ *     ... for each arriving chunk:
+ *     rc = lz_decode(&decoder, chunk, chunk_length);
+ *     ... once the host signals the end of the stream:
+ *     if (!lz_decoder_complete(&decoder)) { the stream was truncated }
+ *
+ * The host-side compressor lives in pygreat (pygreat.lz.compress).
+ *
+ * Encoded format -- a byte stream of sequences, each a block of literals
+ * followed by a back-reference into the bytes already produced:
+ *
+ *   - A token byte: the literal count in the high nibble, and the match
+ *     field in the low nibble.
+ *
+ *   - If the literal count is 15, extension bytes follow, each adding its
+ *     value; a byte below 255 ends the extension. The literal bytes
+ *     themselves come next, copied verbatim.
+ *
+ *   - A match field of 0 means no match -- used for the stream's final
+ *     sequence. Otherwise the match length is the field plus 3 (the
+ *     shortest match is 4 bytes), a two-byte little-endian offset follows
+ *     the literals, and a match field of 15 is extended exactly as the
+ *     literal count is. The match copies length bytes from offset bytes
+ *     back in the output; offsets may overlap the bytes being written,
+ *     so a one-byte offset repeats a byte, run-length style.
+ */
+
+// The shortest match the format can express; field value + 3.
+#define LZ_MINIMUM_MATCH (4)
+
+// The furthest back a match can reach: offsets are two bytes.
+#define LZ_MAXIMUM_OFFSET (65535)
+
+
+/**
+ * Streaming decoder state; a sequence can straddle any chunk boundary, so
+ * this carries the parse mid-sequence from one lz_decode() call to the next.
+ */
+typedef struct {
+
+	// The output image: its base, its capacity, and how much of it we've
+	// produced so far. Doubles as the match window.
+	uint8_t *destination;
+	size_t capacity;
+	size_t produced;
+
+	// Where in a sequence the parse currently stands (lz_decoder_state_t).
+	uint32_t state;
+
+	// Parse state for the sequence in progress.
+	uint32_t literal_remaining;
+	uint32_t match_length;
+	uint32_t match_offset;
+
+} lz_decoder_t;
+
+
+/**
+ * Initializes (or resets) a streaming decoder, directing its output to the
+ * given buffer -- typically an image's final load address.
+ *
+ * @param destination Receives the decompressed bytes.
+ * @param capacity The most bytes the destination can accept.
+ */
+void lz_decoder_init(lz_decoder_t *decoder, void *destination, size_t capacity);
+
+
+/**
+ * Decodes a chunk of the compressed stream, appending its output to the
+ * decoder's destination. Chunks may split the stream at any byte.
+ *
+ * @param in The next chunk of compressed bytes.
+ * @param length The length of the chunk.
+ * @return 0 on success; EBADMSG if the stream is malformed, or EOVERFLOW if
+ *		it would overrun the destination. Errors are sticky: once a stream has
+ *		failed, further chunks fail the same way until the decoder is reset.
+ */
+int lz_decode(lz_decoder_t *decoder, const void *in, size_t length);
+
+
+/**
+ * @returns true iff the decoder stands at a sequence boundary -- i.e. the
+ *		stream seen so far is complete, not cut off mid-sequence
+ */
+bool lz_decoder_complete(const lz_decoder_t *decoder);
+
+
+/**
+ * @returns the number of decompressed bytes produced so far
+ */
+size_t lz_decoder_bytes_produced(const lz_decoder_t *decoder);
+
+#endif
@@ -22,12 +22,165 @@ void *umm_calloc(size_t num, size_t size);
 void *umm_realloc(void *ptr, size_t size);
 void umm_free(void *ptr);
 
+
+//
+// Optional allocation accounting -- enabled with CONFIG_ENABLE_ALLOC_ACCOUNTING.
+//
+// When enabled, every allocation routed through the malloc()/free() shims
+// below carries a small header that records its size and the address of the
+// call that made it, letting us track live and high-water heap usage both
+// globally and per call site. This is how we right-size static buffers
+// against real usage, instead of guessing.
+//
+
+/** Heap-wide allocation accounting. All byte counts are of user-requested bytes. */
+struct allocator_statistics {
+
+	// Bytes currently allocated, and the most that have ever been
+	// allocated at once.
+	uint32_t live_bytes;
+	uint32_t peak_live_bytes;
+
+	// Total allocations made, and allocations that returned NULL.
+	uint32_t total_allocations;
+	uint32_t failed_allocations;
+};
+
+/** Per-call-site allocation accounting. */
+struct allocator_site_statistics {
+
+	// The address of the call that allocates here; NULL if this record
+	// is unclaimed.
+	void *call_site;
+
+	// Bytes this site currently has allocated, and its high-water mark.
+	uint32_t live_bytes;
+	uint32_t peak_live_bytes;
+
+	// Total allocations this site has made.
+	uint32_t total_allocations;
+};
+
+#ifdef CONFIG_ENABLE_ALLOC_ACCOUNTING
+
+/** Accounting-wrapped equivalents of the umm_* allocation functions. */
+void *allocator_malloc(size_t size);
+void *allocator_calloc(size_t num, size_t size);
+void *allocator_realloc(void *ptr, size_t size);
+void allocator_free(void *ptr);
+
+/** @return the heap-wide allocation statistics */
+struct allocator_statistics *allocator_get_statistics(void);
+
+/**
+ * @param index The record index, 0 up to the (fixed) table size.
+ * @return the given call-site record, or NULL past the end of the table;
+ *		records with a NULL call_site have never allocated
+ */
+struct allocator_site_statistics *allocator_get_site_statistics(uint32_t index);
+
+#endif
+
+//
+// Per-bank allocation arenas.
+//
+// Each AHB SRAM bank has its own slave port on the AHB multilayer matrix, so
+// buffers touched by different masters (USB DMA, GPDMA, the M4 itself) only
+// contend for bus arbitration when they share a bank. These arenas hand out
+// runtime-sized buffers from a specific bank's unplaced remainder, so e.g.
+// USB transfer buffers and SGPIO rings can be spread across banks; for
+// statically-sized buffers, the ATTR_AHB_BANKn attributes do the same job
+// at link time.
+//
+// Arena allocations are long-lived placement decisions: there's no free.
+//
+
+/** The SRAM banks that provide allocation arenas. */
+typedef enum {
+	SRAM_BANK_AHB0 = 0,
+	SRAM_BANK_AHB1 = 1,
+
+	SRAM_BANK_COUNT
+} sram_bank_t;
+
+/**
+ * Allocates a buffer from the given bank's arena.
+ *
+ * @param bank The bank to allocate from.
+ * @param size The size of the buffer, in bytes.
+ * @param alignment The required alignment, in bytes; must be a power of two,
+ *     or 0 for word alignment.
+ *
+ * @return the buffer, which is not zeroed; or NULL if the bank doesn't have
+ *     the space (or this image's linker script doesn't carry bank arenas)
+ */
+void *allocator_allocate_in_bank(sram_bank_t bank, size_t size, size_t alignment);
+
+/**
+ * @return the number of un-handed-out bytes remaining in the given bank's
+ *     arena
+ */
+size_t allocator_bank_bytes_remaining(sram_bank_t bank);
+
+
+//
+// Fixed-size block pool allocator -- O(1), lock-free get/put, usable from
+// interrupt context. See drivers/memory/pool.c.
+//
+
+/** Link used to thread free blocks together; overlays unallocated blocks. */
+struct pool_free_block {
+	struct pool_free_block *next;
+};
+
+/** A fixed-size block pool over a caller-provided backing store. */
+typedef struct {
+	size_t block_size;
+	size_t block_count;
+	struct pool_free_block *volatile free_list;
+} memory_pool_t;
+
+/**
+ * Initializes a block pool over a caller-provided backing store.
+ *
+ * @param backing_store A buffer of at least block_size * block_count bytes.
+ * @param block_size The size of each block; must be word-aligned, and at
+ *     least the size of a pointer.
+ * @param block_count The number of blocks in the backing store.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int pool_init(memory_pool_t *pool, void *backing_store, size_t block_size, size_t block_count);
+
+/**
+ * Grabs a block from the pool. O(1); safe from interrupt context.
+ *
+ * @return a block of the pool's block size, or NULL if the pool is exhausted
+ */
+void *pool_get(memory_pool_t *pool);
+
+/**
+ * Returns a block to the pool. O(1); safe from interrupt context.
+ */
+void pool_put(memory_pool_t *pool, void *block);
+
+
 // If we're providing system alloc, create simple wrappers for the umm_* functions.
+// With accounting enabled, route through the accounting layer instead; these
+// wrappers inline into the caller, so the accounting layer's captured return
+// address is the actual malloc() call site.
 #ifndef LIBGREAT_DONT_DEFINE_ALLOC
+#ifdef CONFIG_ENABLE_ALLOC_ACCOUNTING
+	static inline void *malloc(size_t size) { return allocator_malloc(size); }
+	static inline void *calloc(size_t num, size_t size) { return allocator_calloc(num, size); }
+	static inline void *realloc(void *ptr, size_t size) { return allocator_realloc(ptr, size); }
+	static inline void free(void *ptr) { allocator_free(ptr); }
+#else
 	static inline void *malloc(size_t size) { return umm_malloc(size); }
 	static inline void *calloc(size_t num, size_t size) { return umm_calloc(num, size); }
 	static inline void *realloc(void *ptr, size_t size) { return umm_realloc(ptr, size); }
 	static inline void free(void *ptr) { umm_free(ptr); }
 #endif
+#endif
 
 #endif /* __LIBGREAT_ALLOCATOR_H __ */
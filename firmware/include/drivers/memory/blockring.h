@@ -0,0 +1,98 @@
+/*
+ * This file is part of libgreat
+ *
+ * Lock-free single-producer/single-consumer block ring buffer.
+ *
+ * Unlike the byte-at-a-time ringbuffer, this ring hands out contiguous
+ * regions: the producer reserves N bytes, fills them in place, and commits
+ * them with a single release store; the consumer peeks at the filled
+ * region, processes it in place, and releases it the same way. With
+ * exactly one producer and one consumer (e.g. an ISR and a main loop),
+ * no interrupt masking or atomics are required: each 32-bit index is
+ * written by only one side.
+ */
+
+#ifndef __LIBGREAT_BLOCKRING_H__
+#define __LIBGREAT_BLOCKRING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct blockring_t {
+
+	uint8_t *buffer;
+
+	/** The size of the buffer; must be a power of two. */
+	size_t size;
+
+	/** Offset of the next byte the consumer will read. Written only by the consumer. */
+	volatile uint32_t read_index;
+
+	/** Offset one past the last committed byte. Written only by the producer. */
+	volatile uint32_t write_index;
+
+	/** Offset at which committed data stops and wraps back to the buffer's
+	 * start; equal to size unless the producer wrapped early to keep a
+	 * reservation contiguous. Written only by the producer; meaningful only
+	 * while the ring is in a wrapped state. */
+	volatile uint32_t wrap_point;
+
+	/** Producer-private: the outstanding reservation. */
+	uint32_t reserve_start;
+	uint32_t reserve_length;
+	bool reserve_wraps;
+
+} blockring_t;
+
+
+/**
+ * Initializes a block ring over the provided buffer.
+ *
+ * @param size The buffer's size; must be a power of two.
+ * @return 0 on success, or EINVAL if the size isn't a power of two.
+ */
+int blockring_init(blockring_t *ring, void *buffer, size_t size);
+
+/**
+ * Reserves a contiguous region of the given size for the producer to fill
+ * in place. The region isn't visible to the consumer until committed.
+ *
+ * @return a pointer to the reserved region, or NULL if the ring doesn't
+ *     currently have a contiguous region of the given size free
+ */
+void *blockring_reserve(blockring_t *ring, size_t size);
+
+/**
+ * Publishes the most recent reservation to the consumer, with a single
+ * release store. Call once the reserved region has been filled.
+ */
+void blockring_commit(blockring_t *ring);
+
+/**
+ * Grabs a reference to the largest contiguous committed region, without
+ * consuming it.
+ *
+ * @param out_length Out argument; receives the region's length, which may
+ *     be zero if no data is committed.
+ * @return a pointer to the committed data
+ */
+void *blockring_peek(blockring_t *ring, size_t *out_length);
+
+/**
+ * Releases the oldest `size` committed bytes back to the producer; `size`
+ * must not exceed the length most recently reported by blockring_peek.
+ */
+void blockring_release(blockring_t *ring, size_t size);
+
+/**
+ * @return the total number of committed, unconsumed bytes in the ring
+ */
+size_t blockring_data_available(blockring_t *ring);
+
+/**
+ * @return true iff the ring contains no committed data
+ */
+bool blockring_empty(blockring_t *ring);
+
+#endif
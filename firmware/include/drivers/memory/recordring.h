@@ -0,0 +1,125 @@
+/*
+ * This file is part of libgreat
+ *
+ * Lock-free multi-producer/single-consumer record ring buffer.
+ *
+ * Where the blockring moves byte streams between exactly one producer and
+ * one consumer, this ring carries fixed-size records from many producers --
+ * USB ISRs, SGPIO ISRs, timer callbacks, scheduler tasks -- to a single
+ * consumer, without masking interrupts. A producer claims a slot with a
+ * single LDREX/STREX reservation of the write index, fills the record in
+ * place, and publishes it with one release store; records a producer was
+ * preempted inside of simply aren't visible to the consumer yet, so
+ * interleaved producers can never tear each other's records.
+ */
+
+#ifndef __LIBGREAT_RECORDRING_H__
+#define __LIBGREAT_RECORDRING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <toolchain.h>
+
+/** The storage a slot occupies: a publish word, then the record itself.
+ * Record sizes must be a multiple of four, so slots stay word-aligned. */
+#define RECORDRING_SLOT_SIZE(record_size) ((record_size) + sizeof(uint32_t))
+
+/** The storage required for a ring of `depth` records; `depth` must be a
+ * power of two. */
+#define RECORDRING_STORAGE_SIZE(record_size, depth) \
+	(RECORDRING_SLOT_SIZE(record_size) * (depth))
+
+typedef struct recordring_t {
+
+	/** The slot storage; see RECORDRING_STORAGE_SIZE. */
+	uint8_t *storage;
+
+	/** The size of one record, in bytes; must be a multiple of four. */
+	size_t record_size;
+
+	/** The number of slots; must be a power of two. */
+	size_t depth;
+
+	/** Index of the next slot a producer will claim. Advanced atomically;
+	 * written by any producer. */
+	volatile uint32_t write_index;
+
+	/** Index of the next slot the consumer will read. Written only by the
+	 * consumer. */
+	volatile uint32_t read_index;
+
+	/** Records abandoned because the ring was full; producers never block. */
+	volatile uint32_t dropped;
+
+} recordring_t;
+
+
+/**
+ * Statically defines a record ring and its storage; the ring is usable
+ * immediately, with no runtime initialization -- so trace points and other
+ * early or interrupt-context producers need no init ordering.
+ *
+ * @param name The name of the recordring_t variable to define.
+ * @param record_size_ The size of one record; must be a multiple of four.
+ * @param depth_ The number of slots; must be a power of two.
+ */
+#define RECORDRING_DEFINE(name, record_size_, depth_) \
+	static uint8_t name##_storage[RECORDRING_STORAGE_SIZE(record_size_, depth_)] ATTR_ALIGNED(4); \
+	static recordring_t name = { \
+		.storage = name##_storage, \
+		.record_size = (record_size_), \
+		.depth = (depth_), \
+	}
+
+
+/**
+ * Initializes a record ring over the provided storage, for rings that can't
+ * be defined statically.
+ *
+ * @param storage A buffer of RECORDRING_STORAGE_SIZE(record_size, depth) bytes.
+ * @param record_size The size of one record; must be a multiple of four.
+ * @param depth The number of slots; must be a power of two.
+ * @return 0 on success, or EINVAL if the geometry is invalid.
+ */
+int recordring_init(recordring_t *ring, void *storage, size_t record_size, size_t depth);
+
+/**
+ * Claims a slot for the producer to fill in place. Safe from any context;
+ * if the ring is full, the drop is counted and NULL is returned -- producers
+ * never block and never overwrite unread records.
+ *
+ * @return a pointer to the claimed record, or NULL if the ring is full
+ */
+void *recordring_claim(recordring_t *ring);
+
+/**
+ * Publishes a claimed record to the consumer, with a single release store.
+ * Call once the record has been filled.
+ *
+ * @param record The pointer returned by the matching recordring_claim().
+ */
+void recordring_publish(recordring_t *ring, void *record);
+
+/**
+ * Copies up to max_records published records out of the ring, oldest first,
+ * releasing their slots. Single-consumer; stops early at a slot that has
+ * been claimed but not yet published, preserving emission order.
+ *
+ * @param buffer Receives the records, back to back.
+ * @return the number of records actually read
+ */
+unsigned recordring_read(recordring_t *ring, void *buffer, unsigned max_records);
+
+/**
+ * @return the number of records dropped because the ring was full
+ */
+uint32_t recordring_dropped(recordring_t *ring);
+
+/**
+ * @return true iff the ring contains no published records
+ */
+bool recordring_empty(recordring_t *ring);
+
+#endif
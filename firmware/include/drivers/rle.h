@@ -0,0 +1,124 @@
+/*
+ * This file is part of libgreat
+ *
+ * Word-level run-length coding for capture streams.
+ */
+
+#ifndef __LIBGREAT_RLE_H__
+#define __LIBGREAT_RLE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Most logic captures are idle bus most of the time -- long stretches of
+ * identical samples -- yet a raw stream ships every word over the comms
+ * transport. Placing this encoder between a capture ring and a comms pipe
+ * collapses those stretches to a couple of words each, multiplying the
+ * effective capture rate at typical bus duty cycles without touching the
+ * transport itself. Incompressible data costs almost nothing: one header
+ * word per literal block.
+ *
+ * Typical staging, e.g. from an SGPIO watermark callback:
+ *
+ *     words = rle_encode(&enc, ring_chunk, chunk_words, scratch, scratch_words);
+ *     comms_send_on_pipe(pipe, scratch, words * sizeof(uint32_t));
+ *
+ * with rle_encoder_flush() called once at end-of-capture so the final run
+ * isn't left pending. Runs spanning chunk boundaries merge automatically;
+ * only literal blocks split at them, costing one word per split.
+ *
+ * Encoded format -- a stream of 32-bit tokens:
+ *
+ *   - Run token: a header word with bit 31 set and the repeat count in
+ *     bits 30:0, followed by one value word. Expands to `count` copies of
+ *     the value. The encoder only emits runs of three or more, since a
+ *     run token is two words long.
+ *
+ *   - Literal block: a header word with bit 31 clear and the word count in
+ *     bits 30:0, followed by that many raw words, copied verbatim.
+ */
+
+// Distinguishes run tokens from literal-block headers.
+#define RLE_TOKEN_RUN_FLAG   0x80000000UL
+#define RLE_TOKEN_COUNT_MASK 0x7FFFFFFFUL
+
+// Shortest repeat worth a run token; anything shorter joins a literal block.
+#define RLE_MINIMUM_RUN 3
+
+/*
+ * Worst-case output size, in words, for a single rle_encode() call over n
+ * input words: fully-incompressible input becomes one literal block (n + 1
+ * words), plus up to two words if a run pending from the previous call has
+ * to be emitted first. Size encode buffers with this; rle_encode() does not
+ * bounds-check its output.
+ */
+#define RLE_ENCODE_BOUND(n) ((n) + 3)
+
+// Worst-case output, in words, of rle_encoder_flush().
+#define RLE_FLUSH_BOUND 3
+
+/**
+ * Streaming encoder state: the run currently being accumulated, which may
+ * yet be extended by the next chunk's leading words.
+ */
+typedef struct {
+
+	// The value being repeated, and how many times we've seen it so far;
+	// a length of zero means no run is open (a fresh or flushed encoder).
+	uint32_t run_value;
+	uint32_t run_length;
+
+} rle_encoder_t;
+
+
+/**
+ * Initializes (or resets) a streaming run-length encoder.
+ */
+void rle_encoder_init(rle_encoder_t *encoder);
+
+
+/**
+ * Encodes a chunk of words, appending tokens to the provided output buffer.
+ *
+ * The trailing run of the chunk stays pending in the encoder, so a run that
+ * continues into the next chunk is encoded as one token; call
+ * rle_encoder_flush() once the stream ends.
+ *
+ * The output buffer must hold at least RLE_ENCODE_BOUND(in_words) words;
+ * this is not checked.
+ *
+ * @param in The words to encode.
+ * @param in_words The number of input words.
+ * @param out Receives the encoded tokens.
+ * @return the number of output words produced
+ */
+size_t rle_encode(rle_encoder_t *encoder, const uint32_t *in, size_t in_words, uint32_t *out);
+
+
+/**
+ * Emits any run still pending in the encoder, ending the encoded stream.
+ * The encoder is left reset, ready for a new stream.
+ *
+ * The output buffer must hold at least RLE_FLUSH_BOUND words.
+ *
+ * @param out Receives the final tokens, if any.
+ * @return the number of output words produced
+ */
+size_t rle_encoder_flush(rle_encoder_t *encoder, uint32_t *out);
+
+
+/**
+ * Decodes a complete token stream back into raw words -- the inverse of
+ * rle_encode(); useful for e.g. expanding stored patterns for scan-out.
+ *
+ * @param in The encoded tokens.
+ * @param in_words The number of encoded words.
+ * @param out Receives the decoded words.
+ * @param out_words The capacity of the output buffer, in words.
+ * @return the number of words decoded; or 0 if the stream is malformed or
+ *     would overflow the output buffer
+ */
+size_t rle_decode(const uint32_t *in, size_t in_words, uint32_t *out, size_t out_words);
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Simple co-operative scheduler functionality for GreatFET.
+ * This file is part of libgreat
+ */
+
+#ifndef __LIBGREAT_SCHEDULER_H__
+#define __LIBGREAT_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Type for a task's implementation: a function run once per invocation. */
+typedef void (*task_implementation_t)(void);
+
+/** Default priority assigned to tasks; lower numbers run first. */
+#define SCHEDULER_DEFAULT_PRIORITY 128
+
+/** Type for a deferred procedure call's handler. */
+typedef void (*scheduler_dpc_handler_t)(void *context);
+
+/**
+ * A deferred procedure call: a unit of work an ISR hands off to be run at
+ * task priority, ahead of regular tasks, on the next scheduler round.
+ *
+ * Storage is caller-owned (typically static, one per deferral source) and
+ * must outlive the call's execution. Initialize handler and context once;
+ * the remaining fields belong to the scheduler.
+ */
+typedef struct scheduler_dpc {
+
+	/** The work to run, and its opaque argument. */
+	scheduler_dpc_handler_t handler;
+	void *context;
+
+	/** Internal: pending-queue linkage and double-queue guard. */
+	struct scheduler_dpc * volatile next;
+	volatile uint8_t queued;
+
+} scheduler_dpc_t;
+
+/**
+ * Queues a deferred procedure call, to run at task priority before regular
+ * tasks on the next scheduler round. Lock-free and safe from any interrupt
+ * priority; never disables interrupts.
+ *
+ * Queueing an already-pending call coalesces with the pending one -- the
+ * handler runs once for any number of queueings before it's drained, so
+ * handlers should consume all available work, not one item's worth. A call
+ * may re-queue itself from its own handler (or from an ISR racing it).
+ */
+void scheduler_queue_dpc(scheduler_dpc_t *dpc);
+
+/**
+ * Registers an event-driven task with the scheduler. Unlike tasks defined
+ * with DEFINE_TASK -- which are run every round -- an event-driven task runs
+ * only after scheduler_mark_task_ready() has been called for it, typically
+ * from an ISR.
+ *
+ * @param implementation The task's implementation function.
+ * @param priority The task's priority; lower numbers run first.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int scheduler_register_task(task_implementation_t implementation, uint8_t priority);
+
+/**
+ * Marks an event-driven task as ready to run. Safe to call from interrupt
+ * context; the next scheduler round will run the task, and an idle scheduler
+ * loop is woken to start that round immediately.
+ */
+void scheduler_mark_task_ready(task_implementation_t implementation);
+
+/**
+ * Signals the scheduler loop that work is pending, waking it if it's idling.
+ * Called automatically by scheduler_mark_task_ready() and
+ * scheduler_queue_dpc(); ISRs that hand work to a task by other means --
+ * say, by writing into a ring buffer the task consumes -- should call this
+ * after doing so, so the loop doesn't sleep on the work. Safe to call from
+ * any interrupt priority.
+ */
+void scheduler_signal_work(void);
+
+/**
+ * Declares a per-iteration cycle budget for a registered task. Iterations
+ * that run longer are counted (and the first is logged), so a task that's
+ * creeping toward wedging the loop is visible before it does. A budget of
+ * 0 -- the default -- leaves the task unsupervised.
+ *
+ * @param implementation The task to supervise.
+ * @param cycles The task's per-iteration budget, in CPU cycles.
+ * @return 0 on success, or EINVAL if the task isn't registered.
+ */
+int scheduler_set_task_deadline(task_implementation_t implementation, uint32_t cycles);
+
+/**
+ * Arms hardware watchdog supervision of the scheduler loop: the watchdog is
+ * fed only as each round completes, so a task that wedges -- never returning
+ * control -- expires it, which snapshots the wedged context through the
+ * crash telemetry (when present) and reboots the unit. Once armed, the
+ * watchdog cannot be disarmed.
+ *
+ * Pick a timeout comfortably longer than the loop's worst-case round -- and
+ * than the longest interrupt-free idle period, since an idle loop only wakes
+ * (and feeds) when an interrupt or wakeup event arrives.
+ *
+ * @param timeout The maximum allowed interval between rounds, in
+ *		microseconds; at most ~5.5 seconds.
+ * @return 0 on success, or an error code on failure.
+ */
+int scheduler_enable_watchdog(uint32_t timeout);
+
+/**
+ * @return the address of the task currently executing, or 0 if control is
+ *		in the scheduler itself (or no scheduler is running)
+ */
+uint32_t scheduler_running_task_address(void);
+
+/**
+ * Runs a single iteration of each runnable task (a single scheduler "round").
+ * For a variant that runs indefinitely, use scheduler_run().
+ */
+void scheduler_run_tasks(void);
+
+/**
+ * Runs our scheduler for as long as the device is alive; never returns.
+ * Sleeps the core whenever no work is pending, waking at interrupt latency
+ * when an ISR signals more; see scheduler_signal_work().
+ */
+void scheduler_run(void) __attribute__((noreturn));
+
+#endif
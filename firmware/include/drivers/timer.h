@@ -84,8 +84,8 @@ void delay_us(uint32_t duration);
 /**
  * @returns the total number of microseconds since this timer was initialized.
  *
- * Overflows roughly once per hour. For tracking longer spans; use the RTC
- * functions, which are currently not synchronized to this one.
+ * Overflows roughly once per hour; spans that might exceed that should use
+ * get_time_64() instead.
  */
 uint32_t get_time(void);
 
@@ -97,6 +97,21 @@ uint32_t get_time(void);
 uint32_t get_time_since(uint32_t base);
 
 
+/**
+ * @returns the total number of microseconds since this timer was initialized,
+ *		as a 64-bit value -- monotonic across 32-bit counter wraps, and cheap
+ *		enough to call from ISRs
+ */
+uint64_t get_time_64(void);
+
+
+/**
+ * @returns The total number of microseconds that have passed since a reference call to get_time_64().
+ *		Unlike get_time_since(), spans longer than ~71 minutes are measured correctly.
+ */
+uint64_t get_time_since_64(uint64_t base);
+
+
 /**
  * Schedules a given function to execute periodically.
  *
@@ -107,6 +122,69 @@ uint32_t get_time_since(uint32_t base);
 uint32_t call_function_periodically(hw_timer_t *timer, uint32_t frequency, timer_callback_t function, void *argument);
 
 
+//
+// Software timers.
+//
+// call_function_periodically() burns a whole (scarce) hardware timer per
+// periodic function; software timers instead multiplex any number of timed
+// callbacks onto a single hardware timer, using a timing wheel with O(1)
+// start and cancel. Expired callbacks run from a scheduler task, not from
+// the timer's ISR.
+//
+
+/**
+ * A software timer. Allocate one (statically, typically) per timed callback;
+ * all fields are managed by the software_timer_* functions.
+ */
+typedef struct software_timer {
+
+	// Links within the wheel slot (or expiry list) this timer is on.
+	struct software_timer *next;
+	struct software_timer *previous;
+
+	// The absolute time at which this timer next fires, in microseconds.
+	uint64_t expiry;
+
+	// The repeat interval, in microseconds; 0 for one-shot timers.
+	uint32_t interval;
+
+	// The callback to run on expiry, and its argument.
+	timer_callback_t callback;
+	void *argument;
+
+	// True while the timer is scheduled.
+	bool active;
+
+} software_timer_t;
+
+
+/**
+ * Starts (or restarts) a software timer. O(1); safe to call from interrupt
+ * context, and from a timer's own callback.
+ *
+ * @param timer The software timer to be started.
+ * @param interval_us The time until the timer fires, in microseconds; the
+ *		effective resolution is the wheel's tick (~1 ms).
+ * @param periodic If true, the timer re-arms itself every interval_us until
+ *		cancelled; if false, it fires once.
+ * @param callback The function to call on expiry; runs from a scheduler
+ *		task, not from interrupt context.
+ * @param argument The argument to be provided to the given function.
+ *
+ * @return 0 on success, or an error code if the backing hardware timer
+ *		could not be acquired
+ */
+int software_timer_start(software_timer_t *timer, uint32_t interval_us,
+		bool periodic, timer_callback_t callback, void *argument);
+
+
+/**
+ * Cancels a software timer. O(1); safe to call from interrupt context, and
+ * on a timer that isn't running.
+ */
+void software_timer_cancel(software_timer_t *timer);
+
+
 /**
  * Cancels all periodic function calls associated with a given timer.
  */
@@ -168,6 +246,13 @@ uint32_t platform_timer_get_value(hw_timer_t *timer);
 hw_timer_t *platform_get_platform_timer(void);
 
 
+/**
+ * @returns the 64-bit microseconds count for the platform timer; coherent
+ *		and monotonic across counter wraps
+ */
+uint64_t platform_get_platform_timer_value_64(void);
+
+
 /**
  * Sets up the system's platform timer.
  *
@@ -0,0 +1,78 @@
+/*
+ * This file is part of libgreat
+ *
+ * Deferred binary trace facility.
+ *
+ * The pr_* logging macros format their arguments at the call site, which is
+ * far too slow for interrupt handlers and streaming hot paths. Trace points
+ * instead store a pointer to the (flash-resident) format string plus the raw
+ * argument words into a lock-free ring -- a few cycles each -- and leave all
+ * formatting to idle time, or to the host, which can drain the ring over
+ * comms and render records offline.
+ */
+
+#ifndef __LIBGREAT_TRACE_H__
+#define __LIBGREAT_TRACE_H__
+
+#include <stdint.h>
+
+/** Maximum number of argument words a single trace record can carry. */
+#define TRACE_RECORD_MAX_ARGS 4
+
+/**
+ * A single binary trace record. The format field carries the address of the
+ * record's printf-style format string; consumers resolve it to text lazily
+ * (e.g. via the trace class's describe_format verb).
+ */
+typedef struct {
+
+	// Address of the format string.
+	uint32_t format;
+
+	// Microsecond timestamp at which the record was emitted.
+	uint32_t timestamp;
+
+	// The number of argument words actually populated.
+	uint32_t arg_count;
+
+	// The raw argument words.
+	uint32_t args[TRACE_RECORD_MAX_ARGS];
+
+} trace_record_t;
+
+
+/**
+ * Emits a binary trace record. Safe from any context, including interrupt
+ * handlers; if the ring is full, the record is counted as dropped rather
+ * than blocking. Usually invoked via the trace() macro, below.
+ *
+ * @param format A printf-style format string, which must be permanently
+ *     allocated (e.g. a string literal); only its address is stored.
+ * @param arg_count The number of argument words that follow; capped at
+ *     TRACE_RECORD_MAX_ARGS.
+ */
+void trace_emit(const char *format, uint32_t arg_count, ...);
+
+
+/**
+ * Records a trace point. Arguments must be representable as 32-bit words.
+ */
+#define trace(format, ...) \
+	trace_emit(format, (sizeof((uint32_t[]){0, ##__VA_ARGS__}) / sizeof(uint32_t)) - 1, ##__VA_ARGS__)
+
+
+/**
+ * Drains up to max_records records from the trace ring, in emission order.
+ * Single-consumer; intended to be called from idle time or a comms verb.
+ *
+ * @return the number of records actually read
+ */
+unsigned trace_read_records(trace_record_t *buffer, unsigned max_records);
+
+
+/**
+ * @return the number of records dropped because the ring was full
+ */
+uint32_t trace_records_dropped(void);
+
+#endif
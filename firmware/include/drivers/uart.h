@@ -74,6 +74,11 @@ typedef struct uart {
 	ringbuffer_t rx_buffer;
 	ringbuffer_t tx_buffer;
 
+	// True iff the UART has been placed into block-transfer (DMA) mode,
+	// in which the buffers above are filled and drained by DMA rather
+	// than per-byte interrupts. See uart_enable_dma().
+	bool dma_enabled;
+
 } uart_t;
 
 /**
@@ -110,6 +115,43 @@ uint32_t platform_uart_get_parent_clock_frequency(uart_t *uart);
 int platform_uart_set_up_interrupt(uart_t *uart);
 
 
+/**
+ * Places the UART into block-transfer (DMA) mode, if the platform supports it.
+ *
+ * In this mode, received data is circulated into the receive buffer by DMA
+ * rather than a per-byte interrupt, and writes are drained from the transmit
+ * buffer in DMA bursts -- so high baud rates no longer cost an interrupt per
+ * byte. An idle-line (character timeout) interrupt flushes any bytes waiting
+ * below the FIFO's DMA trigger level, bounding receive latency.
+ *
+ * Requires the UART to have been initialized with a nonzero buffer_size.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int uart_enable_dma(uart_t *uart);
+
+
+/**
+ * Writes a block of data to the UART.
+ *
+ * In block-transfer mode, this enqueues into the transmit ring and starts a
+ * DMA drain; otherwise, it transmits synchronously.
+ *
+ * @return the number of bytes accepted, which may be less than count if the
+ *     transmit ring filled up
+ */
+size_t uart_write(uart_t *uart, const void *buffer, size_t count);
+
+
+/**
+ * Platform implementations of block-transfer mode; see uart_enable_dma().
+ */
+int platform_uart_enable_dma(uart_t *uart);
+size_t platform_uart_dma_read(uart_t *uart, void *buffer, size_t count);
+size_t platform_uart_dma_write(uart_t *uart, const void *buffer, size_t count);
+void platform_uart_dma_flush_rx(uart_t *uart);
+
+
 /**
  * Perform a UART transmit, but block until the transmission is accepted.
  */
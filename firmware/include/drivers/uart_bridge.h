@@ -0,0 +1,65 @@
+/*
+ * This file is part of libgreat
+ *
+ * UART-to-host bridge engine: streams a UART to a comms pipe.
+ */
+
+#ifndef __LIBGREAT_UART_BRIDGE_H__
+#define __LIBGREAT_UART_BRIDGE_H__
+
+#include <stdint.h>
+
+#include <drivers/comms.h>
+#include <drivers/uart.h>
+
+/**
+ * Counters describing the bridge's progress and flow-control health.
+ */
+typedef struct uart_bridge_statistics {
+
+	// Total payload bytes moved in each direction.
+	uint64_t bytes_to_host;
+	uint64_t bytes_from_host;
+
+	// Host-to-UART bytes dropped because the UART's transmit buffer was
+	// full; nonzero values mean the host is writing faster than the wire.
+	uint32_t tx_overrun_bytes;
+
+	// UART-to-host bytes dropped because the pipe was out of flow-control
+	// credits; nonzero values mean the host isn't draining the pipe.
+	uint32_t rx_discarded_bytes;
+
+} uart_bridge_statistics_t;
+
+
+/**
+ * Starts bridging the given UART to a comms pipe on the given class.
+ *
+ * Received UART data accumulates in the UART's (DMA-filled) receive buffer
+ * and is forwarded to the host in chunks -- immediately once a full chunk is
+ * waiting, or within one poll tick (~1 ms) of the line going idle. Data
+ * arriving from the host on the same pipe is transmitted out the UART.
+ *
+ * The UART must have been initialized with a nonzero buffer_size. Only a
+ * single bridge can be active at a time.
+ *
+ * @param uart The UART to be bridged; the bridge takes over its buffered I/O.
+ * @param owning_class The comms class the bridge's pipe is registered under.
+ * @return 0 on success, or an error code on failure
+ */
+int uart_bridge_initialize(uart_t *uart, struct comms_class *owning_class);
+
+
+/**
+ * Stops an active bridge, releasing its pipe's poll timer. Buffers already
+ * handed to the transport drain in the background.
+ */
+void uart_bridge_stop(void);
+
+
+/**
+ * Copies out the active bridge's transfer and overrun counters.
+ */
+void uart_bridge_get_statistics(uart_bridge_statistics_t *statistics);
+
+#endif
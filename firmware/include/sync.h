@@ -8,6 +8,8 @@
 #ifndef __LIBGREAT_SYNC_H__
 #define __LIBGREAT_SYNC_H__
 
+#include <stdint.h>
+
 #include <platform_sync.h>
 
 // TODO: create normal mutex_lock / mutex_unlock names
@@ -17,5 +19,170 @@ void libgreat_mutex_lock(mutex_t *mutex);
 void libgreat_mutex_unlock(mutex_t *mutex);
 
 
+/**
+ * A waitable event: a set of flags that interrupt handlers can signal, and
+ * that thread-mode code can sleep on -- replacing `while (!flag);` hot spins
+ * with an interrupt-woken wait that parks the core in the meantime.
+ */
+typedef struct event {
+	volatile uint32_t flags;
+} event_t;
+
+
+/**
+ * Initializes a new event, with no flags signaled. Statically-allocated
+ * events are already initialized, and don't need this call.
+ */
+void libgreat_event_init(event_t *event);
+
+
+/**
+ * Signals the given flags on an event, waking any waiter. Safe to call from
+ * interrupt context; signaled flags persist until a waiter consumes them, so
+ * signals delivered before the wait begins aren't lost.
+ */
+void libgreat_event_signal(event_t *event, uint32_t flags);
+
+
+/**
+ * Waits until any of the given flags are signaled on an event, sleeping the
+ * core between wake-ups. Consumes and returns the flags that were signaled.
+ *
+ * Blocks the current context outright -- as the hot spin it replaces did --
+ * so this must not be called from interrupt context.
+ */
+uint32_t libgreat_event_wait(event_t *event, uint32_t flags);
+
+
+/**
+ * As libgreat_event_wait, but gives up after the provided number of
+ * microseconds. Returns the consumed flags, or 0 on timeout.
+ */
+uint32_t libgreat_event_wait_timeout(event_t *event, uint32_t flags, uint32_t timeout_us);
+
+
+/**
+ * A reader-writer lock: any number of readers may hold the lock at once,
+ * while writers hold it exclusively. Suits our dominant sharing pattern --
+ * frequently-read, rarely-reconfigured state (stats verbs, state queries) --
+ * where a mutex would needlessly serialize the readers against each other.
+ *
+ * A waiting writer blocks new readers, so rare writers aren't starved by a
+ * steady stream of reads. Contended acquisitions back off exponentially
+ * rather than hammering the exclusive monitor.
+ *
+ * Single-core only: the exclusive accesses these are built on don't
+ * arbitrate against the M0, which has no exclusive-access instructions at
+ * all. For state shared across the core pair, use the intercore primitives
+ * below.
+ */
+typedef struct rwlock {
+	volatile uint32_t state;
+} rwlock_t;
+
+
+/**
+ * Initializes a new reader-writer lock. Statically-allocated locks are
+ * already initialized, and don't need this call.
+ */
+void libgreat_rwlock_init(rwlock_t *lock);
+
+/** Acquires the lock for reading; blocks while a writer holds or awaits it. */
+void libgreat_rwlock_read_lock(rwlock_t *lock);
+
+/** Releases a read hold on the lock. */
+void libgreat_rwlock_read_unlock(rwlock_t *lock);
+
+/** Acquires the lock exclusively; blocks until all readers have drained. */
+void libgreat_rwlock_write_lock(rwlock_t *lock);
+
+/** Releases exclusive ownership of the lock. */
+void libgreat_rwlock_write_unlock(rwlock_t *lock);
+
+
+//
+// Inter-core synchronization.
+//
+// The LPC43xx's Cortex-M0 companion core has no exclusive-access
+// instructions, so neither the mutex above nor LDREX/STREX-based locks can
+// arbitrate between the core pair. These primitives use only plain loads,
+// stores, and barriers (Peterson's algorithm for two contenders), which
+// both cores implement -- making them the one safe way to guard state in
+// shared memory that either core may touch. Both cores access LPC43xx SRAM
+// uncached, so barriers alone are sufficient; no cache maintenance applies.
+//
+
+/** The two contenders for an inter-core lock. */
+#define INTERCORE_CORE_M4 (0)
+#define INTERCORE_CORE_M0 (1)
+
+/**
+ * A mutex usable from both cores of the M4/M0 pair. Must live in memory
+ * visible to both cores (e.g. alongside the M0 control block).
+ */
+typedef struct intercore_mutex {
+
+	/** Per-core "I want the lock" flags. */
+	volatile uint32_t interested[2];
+
+	/** Whose turn it is to yield when both cores want the lock. */
+	volatile uint32_t turn;
+
+} intercore_mutex_t;
+
+
+/**
+ * Initializes a new inter-core mutex. Statically-allocated mutexes are
+ * already initialized, and don't need this call.
+ */
+void libgreat_intercore_mutex_init(intercore_mutex_t *mutex);
+
+/**
+ * Ensures ownership of the provided mutex against the other core.
+ * Blocks until the mutex can be locked.
+ *
+ * @param core The calling core: INTERCORE_CORE_M4 or INTERCORE_CORE_M0.
+ */
+void libgreat_intercore_mutex_lock(intercore_mutex_t *mutex, uint32_t core);
+
+/** Releases ownership of the provided mutex. */
+void libgreat_intercore_mutex_unlock(intercore_mutex_t *mutex, uint32_t core);
+
+
+/**
+ * A reader-writer lock usable from both cores; as the inter-core mutex, but
+ * readers on either core proceed concurrently. Reader entry and exit each
+ * briefly take the embedded mutex, so reads are cheap but not free; state
+ * read only ever by one core wants the single-core rwlock instead.
+ */
+typedef struct intercore_rwlock {
+
+	/** Arbitrates reader-count updates and writer entry. */
+	intercore_mutex_t mutex;
+
+	/** The number of readers currently holding the lock, on both cores. */
+	volatile uint32_t readers;
+
+} intercore_rwlock_t;
+
+
+/**
+ * Initializes a new inter-core reader-writer lock. Statically-allocated
+ * locks are already initialized, and don't need this call.
+ */
+void libgreat_intercore_rwlock_init(intercore_rwlock_t *lock);
+
+/** Acquires the lock for reading, against writers on either core. */
+void libgreat_intercore_read_lock(intercore_rwlock_t *lock, uint32_t core);
+
+/** Releases a read hold on the lock. */
+void libgreat_intercore_read_unlock(intercore_rwlock_t *lock, uint32_t core);
+
+/** Acquires the lock exclusively; blocks until readers on both cores drain. */
+void libgreat_intercore_write_lock(intercore_rwlock_t *lock, uint32_t core);
+
+/** Releases exclusive ownership of the lock. */
+void libgreat_intercore_write_unlock(intercore_rwlock_t *lock, uint32_t core);
+
 
 #endif // __LIBGREAT_SYNC_H__
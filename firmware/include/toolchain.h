@@ -33,6 +33,36 @@
  */
 #define ATTR_PERSISTENT ATTR_SECTION(".bss.persistent")
 
+/**
+ * Attribute helper for variables that don't need a defined initial value --
+ * typically large buffers that are fully written before first use. These are
+ * excluded from the crt0's .bss-zeroing loop, shortening boot.
+ */
+#define ATTR_NOINIT ATTR_SECTION(".noinit")
+
+/**
+ * Attribute helper for hot-path functions that should execute from
+ * zero-wait-state SRAM rather than XIP flash, so their timing isn't at the
+ * mercy of SPI-flash fetch stalls. Tagged functions are copied into RAM by
+ * the crt0, alongside .data; calls are forced to their long form, as the
+ * SRAM copy is far from the flash text segment.
+ */
+#define ATTR_HOT_RAM __attribute__((section(".ram_text"), long_call))
+
+/**
+ * Attribute helpers for bank-aware buffer placement. The LPC43xx's AHB SRAM
+ * banks sit on separate slave ports of the AHB multilayer matrix, so buffers
+ * touched by different masters (USB DMA, GPDMA, the M4 itself) only contend
+ * for arbitration when they share a bank. Tagging a buffer with one of these
+ * pins it to a specific bank, letting concurrent streams be spread across
+ * banks; see also allocator_allocate_in_bank() for runtime-sized buffers.
+ *
+ * Placed buffers are neither zeroed nor loaded (like ATTR_NOINIT); they must
+ * be fully initialized before first use.
+ */
+#define ATTR_AHB_BANK0 ATTR_SECTION(".ahb_bank0")
+#define ATTR_AHB_BANK1 ATTR_SECTION(".ahb_bank1")
+
 
 /**
  * Optimization helpers for critical sections.
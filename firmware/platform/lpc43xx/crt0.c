@@ -11,6 +11,7 @@
 #include <drivers/platform_config.h>
 
 #include <drivers/arm_system_control.h>
+#include <drivers/arm_vectors.h>
 
 /* This special variable is preserved across soft resets by a little bit of
  * reset handler magic. It allows us to pass a Reason across resets. */
@@ -38,6 +39,7 @@ extern funcp_t __fini_array_start, __fini_array_end;
  * Provided by the linker.
  */
 extern unsigned _data_loadaddr, _data, _edata, _bss, _ebss, _stack;
+extern unsigned _ram_text_loadaddr, _ram_text, _eram_text;
 extern unsigned _text_segment_ram, _text_segment_rom;
 extern unsigned _text_segment_end, _text_segment_rom_end, _text_segment_ram_end;
 
@@ -108,19 +110,53 @@ void set_up_cpu(void)
  */
 void ATTR_NORETURN reset_handler(void)
 {
-	volatile unsigned *src, *dest;
+	unsigned *src, *dest;
 	funcp_t *fp;
 
-	// Initialize the systems's data segment.
-	for (src = &_data_loadaddr, dest = &_data; dest < &_edata; src++, dest++) {
-		*dest = *src;
+	// Start the slow pieces of clock bring-up -- most notably the crystal
+	// oscillator's settle time -- before we spend time initializing memory,
+	// so the two overlap instead of running back-to-back. This touches only
+	// hardware registers, as .data and .bss don't exist yet.
+	platform_begin_clock_bringup();
+
+	// Initialize the systems's data segment. The linker keeps these section
+	// boundaries word-aligned, so we can copy four words per iteration --
+	// which the compiler can turn into load/store-multiple bursts.
+	src = &_data_loadaddr;
+	for (dest = &_data; dest + 4 <= &_edata; src += 4, dest += 4) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest[3] = src[3];
+	}
+	while (dest < &_edata) {
+		*dest++ = *src++;
 	}
 
-	// Clear the system's BSS.
-	for (dest = &_bss; dest < &_ebss; ) {
+	// Clear the system's BSS. Sections that don't need zeroing (.noinit,
+	// the heap, persistent state) live outside these bounds, so we never
+	// spend boot time clearing them.
+	for (dest = &_bss; dest + 4 <= &_ebss; dest += 4) {
+		dest[0] = 0;
+		dest[1] = 0;
+		dest[2] = 0;
+		dest[3] = 0;
+	}
+	while (dest < &_ebss) {
 		*dest++ = 0;
 	}
 
+	// Copy any ATTR_HOT_RAM functions into zero-wait-state SRAM, so our
+	// hot paths don't stall on SPI-flash XIP fetches. On targets that
+	// already execute from RAM, the linker collapses this to a no-op.
+	for (src = &_ram_text_loadaddr, dest = &_ram_text; dest < &_eram_text; src++, dest++) {
+		*dest = *src;
+	}
+
+	// With memory initialized, move the vector table into SRAM, so runtime
+	// handler installation is a single store from here on out.
+	vectors_relocate_to_ram();
+
 	// Configure the CPU into its full running state.
 	set_up_cpu();
 
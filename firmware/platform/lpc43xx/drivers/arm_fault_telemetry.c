@@ -0,0 +1,272 @@
+/*
+ * This file is part of libgreat
+ *
+ * Crash telemetry: fault snapshots to persistent RAM, read out after
+ * reboot; see <drivers/arm_fault_telemetry.h> for an overview.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <toolchain.h>
+#include <debug.h>
+
+#include <backtrace.h>
+
+#include <drivers/comms.h>
+#include <drivers/reset.h>
+#include <drivers/arm_vectors.h>
+#include <drivers/platform_vectors.h>
+#include <drivers/arm_system_control.h>
+#include <drivers/arm_profiling.h>
+#include <drivers/arm_fault_telemetry.h>
+
+// Marks a snapshot the host has already collected: invalid, but with a
+// fault count that should keep accumulating.
+#define FAULT_TELEMETRY_MAGIC_CLEARED 0xAA55FA18
+
+/** The one preserved snapshot; lives in .bss.persistent, which startup
+ * neither zeroes nor loads, so it survives the post-fault soft reset. */
+static fault_telemetry_record_t fault_telemetry_record ATTR_PERSISTENT;
+
+/** Set while a capture is running, so a second fault taken mid-capture
+ * (e.g. while unwinding a corrupt stack) resets instead of recursing. */
+static volatile bool fault_telemetry_capturing;
+
+// Referenced from the assembly entry shim, below.
+void fault_telemetry_capture(uint32_t *stacked_frame, uint32_t exception_return);
+
+
+/**
+ * Reports the address of the task the scheduler is currently running, or 0
+ * if none is. A weak stub, so this module links without the scheduler; the
+ * scheduler's definition overrides it.
+ */
+ATTR_WEAK uint32_t scheduler_running_task_address(void)
+{
+	return 0;
+}
+
+
+/**
+ * Fault entry shim: recovers the faulting context's stacked register frame
+ * -- from whichever stack the hardware pushed it onto -- and hands it, with
+ * the EXC_RETURN value, to the capture routine.
+ */
+static void ATTR_NAKED fault_telemetry_entry(void)
+{
+	__asm__ volatile(
+		"tst lr, #4      \n"
+		"ite eq          \n"
+		"mrseq r0, msp   \n"
+		"mrsne r0, psp   \n"
+		"mov r1, lr      \n"
+		"b fault_telemetry_capture \n"
+	);
+}
+
+
+/**
+ * Snapshots the faulting context into persistent RAM, then resets. The
+ * whole capture is register and RAM traffic -- no I/O, no waiting -- so a
+ * crashed field unit is back up in milliseconds rather than hanging in a
+ * dump loop.
+ */
+void ATTR_USED fault_telemetry_capture(uint32_t *stacked_frame, uint32_t exception_return)
+{
+	arm_system_control_register_block_t *scb = arch_get_system_control_registers();
+	fault_telemetry_record_t *record = &fault_telemetry_record;
+	backtrace_t backtrace[FAULT_TELEMETRY_MAX_BACKTRACE];
+	backtrace_frame_t frame;
+	uint32_t frame_size, ipsr;
+	bool watchdog_expiry;
+	int depth;
+
+	// If a fault struck while we were already capturing -- most plausibly
+	// the unwinder tripping over a corrupt stack -- keep the partial
+	// snapshot and get out immediately.
+	if (fault_telemetry_capturing) {
+		record->backtrace_depth = 0;
+		record->magic = FAULT_TELEMETRY_MAGIC;
+		system_reset(RESET_REASON_FAULT, false);
+	}
+	fault_telemetry_capturing = true;
+
+	// Carry the running fault count across captures and clears, but not
+	// across power loss (where the region is noise).
+	if ((record->magic != FAULT_TELEMETRY_MAGIC) &&
+			(record->magic != FAULT_TELEMETRY_MAGIC_CLEARED)) {
+		record->fault_count = 0;
+	}
+	record->fault_count++;
+	record->magic = 0;
+
+	__asm__ volatile("mrs %0, ipsr" : "=r"(ipsr));
+	record->exception_number = ipsr & 0x1ff;
+
+	// We arrive here two ways: through the fault vectors, or through the
+	// watchdog's warning interrupt when a supervised task has wedged.
+	watchdog_expiry = (record->exception_number == (16 + WWDT_IRQ));
+
+	// The register frame the hardware stacked at fault entry...
+	record->r0  = stacked_frame[0];
+	record->r1  = stacked_frame[1];
+	record->r2  = stacked_frame[2];
+	record->r3  = stacked_frame[3];
+	record->r12 = stacked_frame[4];
+	record->lr  = stacked_frame[5];
+	record->pc  = stacked_frame[6];
+	record->psr = stacked_frame[7];
+
+	// ... the faulting context's stack pointer, undoing the hardware's
+	// stacking: basic frames are eight words, extended (FPU) frames are
+	// twenty-six, and bit 9 of the stacked PSR records an extra alignment
+	// word...
+	frame_size = (exception_return & (1 << 4)) ? 0x20 : 0x68;
+	record->sp = (uint32_t)stacked_frame + frame_size;
+	if (record->psr & (1 << 9)) {
+		record->sp += 4;
+	}
+	record->exception_return = exception_return;
+
+	// ... and the fault status registers, which say what went wrong (and,
+	// when CFSR flags them valid, the faulting address).
+	record->cfsr  = scb->cfsr;
+	record->hfsr  = scb->hfsr;
+	record->mmfar = scb->mmfar;
+	record->bfar  = scb->bfar;
+
+	// For watchdog expiries, record what the scheduler was running; the
+	// stacked pc above already shows where it was wedged.
+	record->supervised_task     = watchdog_expiry ? scheduler_running_task_address() : 0;
+	record->capture_cycle_count = arch_get_dwt_registers()->cycle_count;
+
+	// Unwind a compact backtrace from the faulting context.
+	frame.fp = record->sp;
+	frame.sp = record->sp;
+	frame.lr = record->lr;
+	frame.pc = record->pc;
+	depth = _backtrace_unwind(backtrace, FAULT_TELEMETRY_MAX_BACKTRACE, &frame);
+
+	record->backtrace_depth = 0;
+	for (int i = 0; i < depth; ++i) {
+		record->backtrace[record->backtrace_depth++] = (uint32_t)backtrace[i].address;
+	}
+
+	// Mark the snapshot valid only once it's complete, so a capture torn
+	// by a second fault or power loss can't read back as a good record.
+	record->magic = FAULT_TELEMETRY_MAGIC;
+
+	system_reset(watchdog_expiry ? RESET_REASON_WATCHDOG_TIMEOUT : RESET_REASON_FAULT, false);
+}
+
+
+/**
+ * Hooks the watchdog's warning interrupt; see <drivers/arm_fault_telemetry.h>.
+ * Overrides the weak stub in the watchdog bring-up path.
+ */
+void fault_telemetry_watch_watchdog(void)
+{
+	vector_set_handler(WWDT_IRQ, fault_telemetry_entry);
+	platform_enable_interrupt(WWDT_IRQ);
+}
+
+
+/**
+ * Installs the snapshot-and-reset handler; see <drivers/arm_fault_telemetry.h>.
+ */
+void fault_telemetry_initialize(void)
+{
+	arm_system_control_register_block_t *scb = arch_get_system_control_registers();
+
+	vector_set_fault_handlers(fault_telemetry_entry);
+
+	// Enable the separable fault exceptions, so bus, usage, and memory
+	// management faults report their specific status instead of escalating
+	// to an undifferentiated hard fault.
+	scb->memory_managemnt_faults_enabled = 1;
+	scb->bus_faults_enabled = 1;
+	scb->usage_faults_enabled = 1;
+}
+
+
+/**
+ * @return the preserved crash snapshot, or NULL if none is valid
+ */
+const fault_telemetry_record_t *fault_telemetry_get_record(void)
+{
+	if (fault_telemetry_record.magic != FAULT_TELEMETRY_MAGIC) {
+		return NULL;
+	}
+
+	return &fault_telemetry_record;
+}
+
+
+/**
+ * Invalidates any preserved crash snapshot, keeping the fault count.
+ */
+void fault_telemetry_clear(void)
+{
+	if (fault_telemetry_record.magic == FAULT_TELEMETRY_MAGIC) {
+		fault_telemetry_record.magic = FAULT_TELEMETRY_MAGIC_CLEARED;
+	}
+}
+
+
+/**
+ * Core-class verb: dumps the preserved crash snapshot as uint32s -- fault
+ * count, exception number, the stacked frame (r0-r3, r12, lr, pc, psr),
+ * sp, EXC_RETURN, the fault status registers (cfsr, hfsr, mmfar, bfar),
+ * the supervised task address and capture cycle count, and finally the
+ * backtrace depth followed by that many return addresses.
+ * Overrides the weak stub in classes/core.c when this module is present.
+ */
+int core_verb_get_fault_snapshot(struct command_transaction *trans)
+{
+	const fault_telemetry_record_t *record = fault_telemetry_get_record();
+
+	if (!record) {
+		return EAGAIN;
+	}
+
+	comms_response_add_uint32_t(trans, record->fault_count);
+	comms_response_add_uint32_t(trans, record->exception_number);
+
+	comms_response_add_uint32_t(trans, record->r0);
+	comms_response_add_uint32_t(trans, record->r1);
+	comms_response_add_uint32_t(trans, record->r2);
+	comms_response_add_uint32_t(trans, record->r3);
+	comms_response_add_uint32_t(trans, record->r12);
+	comms_response_add_uint32_t(trans, record->lr);
+	comms_response_add_uint32_t(trans, record->pc);
+	comms_response_add_uint32_t(trans, record->psr);
+
+	comms_response_add_uint32_t(trans, record->sp);
+	comms_response_add_uint32_t(trans, record->exception_return);
+
+	comms_response_add_uint32_t(trans, record->cfsr);
+	comms_response_add_uint32_t(trans, record->hfsr);
+	comms_response_add_uint32_t(trans, record->mmfar);
+	comms_response_add_uint32_t(trans, record->bfar);
+
+	comms_response_add_uint32_t(trans, record->supervised_task);
+	comms_response_add_uint32_t(trans, record->capture_cycle_count);
+
+	comms_response_add_uint32_t(trans, record->backtrace_depth);
+	comms_response_add_uint32_t_array(trans, record->backtrace, record->backtrace_depth);
+
+	return 0;
+}
+
+
+/**
+ * Core-class verb: marks the preserved crash snapshot as collected.
+ */
+int core_verb_clear_fault_snapshot(struct command_transaction *trans)
+{
+	(void)trans;
+
+	fault_telemetry_clear();
+	return 0;
+}
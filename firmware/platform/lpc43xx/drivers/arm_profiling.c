@@ -0,0 +1,267 @@
+/*
+ * This file is part of libgreat.
+ *
+ * Cycle-accurate profiling instrumentation -- see arm_profiling.h for the
+ * design rationale.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <toolchain.h>
+
+#include <drivers/comms.h>
+#include <drivers/timer.h>
+#include <drivers/arm_profiling.h>
+
+// Exclusive-access primitives, per the trace-ring idiom.
+#include <libopencm3/cm3/sync.h>
+
+
+/**
+ * The ARM Debug Exception and Monitor Control Register (DEMCR); its
+ * trace_enable (TRCENA) bit gates the entire DWT, cycle counter included.
+ */
+typedef volatile struct ATTR_PACKED {
+	uint32_t              : 24;
+	uint32_t trace_enable :  1;
+	uint32_t              :  7;
+} arm_debug_exception_monitor_control_register_t;
+
+
+// The registered profile regions, in registration order.
+static profile_region_t *profile_regions[PROFILE_MAX_REGIONS];
+static volatile uint32_t profile_region_count;
+
+// The innermost region currently live; what the statistical sampler hits.
+static profile_region_t *volatile current_region;
+
+// Samples that landed outside any profiled region.
+static volatile uint32_t untracked_samples;
+
+// The timer driving the statistical sampler, while one is running.
+static hw_timer_t sampling_timer;
+static bool sampling_active;
+
+// True once the cycle counter has been switched on.
+static bool profiling_ready;
+
+
+/**
+ * @return a reference to the ARM DWT's cycle-counting registers
+ */
+arm_dwt_register_block_t *arch_get_dwt_registers(void)
+{
+	return (arm_dwt_register_block_t *)0xE0001000;
+}
+
+
+/**
+ * @return a reference to the ARM DEMCR
+ */
+static arm_debug_exception_monitor_control_register_t *arch_get_debug_monitor_control_register(void)
+{
+	return (arm_debug_exception_monitor_control_register_t *)0xE000EDFC;
+}
+
+
+/**
+ * Enables the DWT cycle counter. Called automatically on first region entry;
+ * safe to call repeatedly.
+ */
+void profiling_initialize(void)
+{
+	if (profiling_ready) {
+		return;
+	}
+
+	// The DWT doesn't count at all until trace is enabled as a whole.
+	arch_get_debug_monitor_control_register()->trace_enable = 1;
+	arch_get_dwt_registers()->cycle_counter_enabled = 1;
+
+	profiling_ready = true;
+}
+
+
+/**
+ * Adds a region to the global region table, claiming its slot atomically so
+ * first entries from concurrent contexts can't collide.
+ */
+static void profile_register_region(profile_region_t *region)
+{
+	uint32_t index;
+	bool aborted;
+
+	do {
+		index = __ldrex((uint32_t *)&profile_region_count);
+
+		if (index >= PROFILE_MAX_REGIONS) {
+			// Abandoning the exclusive monitor without a store is harmless;
+			// the region still profiles, it just isn't visible to the host.
+			return;
+		}
+
+		aborted = __strex(index + 1, (uint32_t *)&profile_region_count);
+	} while (aborted);
+
+	profile_regions[index] = region;
+	region->registered = true;
+}
+
+
+void profile_region_enter(profile_region_t *region)
+{
+	profiling_initialize();
+
+	if (!region->registered) {
+		profile_register_region(region);
+	}
+
+	region->parent = current_region;
+	current_region = region;
+
+	// Capture the entry time last, so our bookkeeping isn't charged to the region.
+	region->entry_cycle_count = arch_get_dwt_registers()->cycle_count;
+}
+
+
+void profile_region_exit(profile_region_t *region)
+{
+	uint32_t now = arch_get_dwt_registers()->cycle_count;
+
+	// Unsigned subtraction keeps the delta correct across counter wrap.
+	region->total_cycles += now - region->entry_cycle_count;
+	region->entry_count++;
+
+	current_region = region->parent;
+}
+
+
+/**
+ * Periodic timer callback that attributes each sample to whichever region is
+ * live, building a statistical picture of where wall time goes.
+ */
+static void profiling_sample(void *argument)
+{
+	profile_region_t *region = current_region;
+	(void)argument;
+
+	if (region) {
+		region->sample_count++;
+	} else {
+		untracked_samples++;
+	}
+}
+
+
+int profiling_start_sampling(uint32_t frequency)
+{
+	uint32_t rc;
+
+	if (!frequency) {
+		return EINVAL;
+	}
+	if (sampling_active) {
+		return EBUSY;
+	}
+
+	rc = acquire_timer(&sampling_timer);
+	if (rc) {
+		return rc;
+	}
+
+	rc = call_function_periodically(&sampling_timer, frequency, profiling_sample, NULL);
+	if (rc) {
+		release_timer(&sampling_timer);
+		return rc;
+	}
+
+	sampling_active = true;
+	return 0;
+}
+
+
+void profiling_stop_sampling(void)
+{
+	if (!sampling_active) {
+		return;
+	}
+
+	cancel_periodic_function_calls(&sampling_timer);
+	release_timer(&sampling_timer);
+	sampling_active = false;
+}
+
+
+void profiling_reset(void)
+{
+	for (uint32_t i = 0; i < profile_region_count; ++i) {
+		profile_regions[i]->total_cycles = 0;
+		profile_regions[i]->entry_count = 0;
+		profile_regions[i]->sample_count = 0;
+	}
+
+	untracked_samples = 0;
+}
+
+
+/**
+ * Core-class profiling verbs; these strong definitions override the weak
+ * ENOSYS stubs in classes/core.c when this module is linked in.
+ */
+int core_verb_get_profile_summary(struct command_transaction *trans)
+{
+	comms_response_add_uint32_t(trans, profile_region_count);
+	comms_response_add_uint32_t(trans, untracked_samples);
+
+	return 0;
+}
+
+
+int core_verb_get_profile_region(struct command_transaction *trans)
+{
+	uint32_t index = comms_argument_parse_uint32_t(trans);
+	profile_region_t *region;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+	if (index >= profile_region_count) {
+		return EINVAL;
+	}
+
+	region = profile_regions[index];
+	comms_response_add_uint32_t(trans, region->total_cycles);
+	comms_response_add_uint32_t(trans, region->entry_count);
+	comms_response_add_uint32_t(trans, region->sample_count);
+	comms_response_add_string(trans, region->name);
+
+	return 0;
+}
+
+
+int core_verb_control_profiling_sampler(struct command_transaction *trans)
+{
+	uint32_t frequency = comms_argument_parse_uint32_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	if (!frequency) {
+		profiling_stop_sampling();
+		return 0;
+	}
+
+	return profiling_start_sampling(frequency);
+}
+
+
+int core_verb_reset_profiling(struct command_transaction *trans)
+{
+	(void)trans;
+
+	profiling_reset();
+	return 0;
+}
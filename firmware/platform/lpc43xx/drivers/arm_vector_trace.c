@@ -0,0 +1,354 @@
+/*
+ * This file is part of libgreat
+ *
+ * Interrupt latency and jitter instrumentation for the vector dispatch path;
+ * see <drivers/arm_vector_trace.h> for the measurement model.
+ */
+
+#include <debug.h>
+#include <errno.h>
+
+#include <toolchain.h>
+
+#include <drivers/comms.h>
+#include <drivers/arm_vectors.h>
+#include <drivers/arm_profiling.h>
+#include <drivers/arm_vector_trace.h>
+
+
+/**
+ * Register block for the ARM SysTick timer.
+ */
+typedef volatile struct ATTR_PACKED {
+
+	// Control and status register.
+	struct {
+		uint32_t enabled                :  1;
+		uint32_t interrupt_enabled      :  1;
+		uint32_t clock_source_processor :  1;
+		uint32_t                        : 13;
+		uint32_t counted_to_zero        :  1;
+		uint32_t                        : 15;
+	};
+
+	// The value the counter reloads on underflow, and its current value.
+	uint32_t reload_value;
+	uint32_t current_value;
+
+	// Implementation-defined calibration value.
+	const uint32_t calibration;
+
+} arm_systick_register_block_t;
+
+
+/**
+ * @return a reference to the SysTick registers
+ */
+static arm_systick_register_block_t *get_systick_registers(void)
+{
+	return (arm_systick_register_block_t *)0xE000E010UL;
+}
+
+
+// Records for each traced vector.
+static vector_trace_record_t trace_records[VECTOR_TRACE_MAX_VECTORS];
+
+// Statistics for the SysTick latency reference.
+static vector_trace_reference_statistics_t reference_statistics;
+
+// True iff the latency reference currently owns SysTick.
+static bool reference_running;
+
+
+/**
+ * Common bookkeeping for every traced-vector entry: timestamps the entry,
+ * runs the wrapped handler, and accumulates the record's statistics.
+ */
+static void vector_trace_dispatch(unsigned slot)
+{
+	arm_dwt_register_block_t *dwt = arch_get_dwt_registers();
+	vector_trace_record_t *record = &trace_records[slot];
+
+	uint32_t entry = dwt->cycle_count;
+	uint32_t cycles, interarrival;
+
+	// Track the spread of inter-arrival times, once we have two entries
+	// to difference.
+	if (record->invocations) {
+		interarrival = entry - record->last_entry_cycle_count;
+
+		if (!record->min_interarrival_cycles || (interarrival < record->min_interarrival_cycles)) {
+			record->min_interarrival_cycles = interarrival;
+		}
+		if (interarrival > record->max_interarrival_cycles) {
+			record->max_interarrival_cycles = interarrival;
+		}
+	}
+	record->last_entry_cycle_count = entry;
+
+	// Run the real handler, timing its execution.
+	record->wrapped_handler();
+	cycles = dwt->cycle_count - entry;
+
+	record->invocations++;
+	record->total_cycles += cycles;
+	if (cycles > record->max_cycles) {
+		record->max_cycles = cycles;
+	}
+}
+
+
+/**
+ * Per-slot thunks, so each traced vector dispatches with its slot number.
+ */
+#define VECTOR_TRACE_THUNK(n) \
+	static void vector_trace_thunk_##n(void) { vector_trace_dispatch(n); }
+
+VECTOR_TRACE_THUNK(0)
+VECTOR_TRACE_THUNK(1)
+VECTOR_TRACE_THUNK(2)
+VECTOR_TRACE_THUNK(3)
+VECTOR_TRACE_THUNK(4)
+VECTOR_TRACE_THUNK(5)
+VECTOR_TRACE_THUNK(6)
+VECTOR_TRACE_THUNK(7)
+
+static const interrupt_service_routine_t trace_thunks[VECTOR_TRACE_MAX_VECTORS] = {
+	vector_trace_thunk_0, vector_trace_thunk_1, vector_trace_thunk_2, vector_trace_thunk_3,
+	vector_trace_thunk_4, vector_trace_thunk_5, vector_trace_thunk_6, vector_trace_thunk_7,
+};
+
+
+/**
+ * Begins tracing the given IRQ; see <drivers/arm_vector_trace.h>.
+ */
+int vector_trace_attach(platform_irq_t irq)
+{
+	int slot = -1;
+
+	if (irq >= PLATFORM_TOTAL_IRQS) {
+		return EINVAL;
+	}
+
+	// Find a free slot, rejecting a second trace of the same IRQ.
+	for (unsigned i = 0; i < VECTOR_TRACE_MAX_VECTORS; ++i) {
+		if (trace_records[i].in_use) {
+			if (trace_records[i].irq == irq) {
+				return EEXIST;
+			}
+		} else if (slot < 0) {
+			slot = i;
+		}
+	}
+	if (slot < 0) {
+		pr_warning("vector_trace: all %d trace slots are in use\n", VECTOR_TRACE_MAX_VECTORS);
+		return EBUSY;
+	}
+
+	// Make sure the cycle counter our timestamps come from is running.
+	profiling_initialize();
+
+	// Populate the record, and swap the thunk in for the real handler.
+	vector_trace_record_t *record = &trace_records[slot];
+	*record = (vector_trace_record_t){
+		.irq = irq,
+		.in_use = true,
+		.wrapped_handler = vector_get_handler(irq),
+	};
+	vector_set_handler(irq, trace_thunks[slot]);
+
+	return 0;
+}
+
+
+/**
+ * Stops tracing the given IRQ; see <drivers/arm_vector_trace.h>.
+ */
+int vector_trace_detach(platform_irq_t irq)
+{
+	for (unsigned i = 0; i < VECTOR_TRACE_MAX_VECTORS; ++i) {
+		if (trace_records[i].in_use && (trace_records[i].irq == irq)) {
+			vector_set_handler(irq, trace_records[i].wrapped_handler);
+			trace_records[i].in_use = false;
+			return 0;
+		}
+	}
+
+	return EINVAL;
+}
+
+
+/**
+ * The latency reference's SysTick handler. SysTick pends exactly when the
+ * down-counter wraps, and keeps counting from the reload value -- so
+ * (reload - current) at entry is the hardware-measured pend-to-entry
+ * latency, in processor cycles.
+ */
+static void vector_trace_systick_handler(void)
+{
+	arm_systick_register_block_t *systick = get_systick_registers();
+	uint32_t latency = systick->reload_value - systick->current_value;
+
+	reference_statistics.samples++;
+	reference_statistics.total_latency_cycles += latency;
+	if (latency > reference_statistics.max_latency_cycles) {
+		reference_statistics.max_latency_cycles = latency;
+	}
+}
+
+
+/**
+ * Starts the SysTick latency reference; see <drivers/arm_vector_trace.h>.
+ */
+int vector_trace_start_reference(uint32_t period_cycles)
+{
+	arm_systick_register_block_t *systick = get_systick_registers();
+
+	// The reload register is 24 bits wide; and very short periods would
+	// spend most of the CPU measuring itself.
+	if ((period_cycles < 1000) || (period_cycles > 0x01000000)) {
+		return EINVAL;
+	}
+	if (reference_running) {
+		return EBUSY;
+	}
+
+	profiling_initialize();
+	vector_set_systick_handler(vector_trace_systick_handler);
+
+	systick->reload_value = period_cycles - 1;
+	systick->current_value = 0;
+	systick->clock_source_processor = 1;
+	systick->interrupt_enabled = 1;
+	systick->enabled = 1;
+
+	reference_running = true;
+	return 0;
+}
+
+
+/**
+ * Stops the SysTick latency reference; see <drivers/arm_vector_trace.h>.
+ */
+void vector_trace_stop_reference(void)
+{
+	arm_systick_register_block_t *systick = get_systick_registers();
+
+	systick->enabled = 0;
+	systick->interrupt_enabled = 0;
+	reference_running = false;
+}
+
+
+/**
+ * @return the trace record at the given index; see <drivers/arm_vector_trace.h>
+ */
+vector_trace_record_t *vector_trace_get_record(unsigned index)
+{
+	if (index >= VECTOR_TRACE_MAX_VECTORS) {
+		return NULL;
+	}
+
+	return &trace_records[index];
+}
+
+
+/**
+ * @return the latency reference's statistics; see <drivers/arm_vector_trace.h>
+ */
+vector_trace_reference_statistics_t *vector_trace_get_reference_statistics(void)
+{
+	return &reference_statistics;
+}
+
+
+/**
+ * Clears all accumulated statistics; see <drivers/arm_vector_trace.h>.
+ */
+void vector_trace_reset(void)
+{
+	reference_statistics = (vector_trace_reference_statistics_t){0};
+
+	for (unsigned i = 0; i < VECTOR_TRACE_MAX_VECTORS; ++i) {
+		vector_trace_record_t *record = &trace_records[i];
+
+		record->invocations = 0;
+		record->total_cycles = 0;
+		record->max_cycles = 0;
+		record->min_interarrival_cycles = 0;
+		record->max_interarrival_cycles = 0;
+	}
+}
+
+
+//
+// Core-class verbs for host readout; these override the weak stubs in
+// classes/core.c when this driver is built in.
+//
+
+int core_verb_trace_interrupt(struct command_transaction *trans)
+{
+	uint32_t irq = comms_argument_parse_uint32_t(trans);
+	uint8_t enable = comms_argument_parse_uint8_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	return enable ? vector_trace_attach(irq) : vector_trace_detach(irq);
+}
+
+
+int core_verb_control_latency_reference(struct command_transaction *trans)
+{
+	uint32_t period_cycles = comms_argument_parse_uint32_t(trans);
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	if (!period_cycles) {
+		vector_trace_stop_reference();
+		return 0;
+	}
+
+	return vector_trace_start_reference(period_cycles);
+}
+
+
+int core_verb_get_interrupt_latency_stats(struct command_transaction *trans)
+{
+	vector_trace_reference_statistics_t *reference = vector_trace_get_reference_statistics();
+	vector_trace_record_t *record;
+	unsigned index = 0;
+
+	// Lead with the latency reference's totals...
+	comms_response_add_uint32_t(trans, reference->samples);
+	comms_response_add_uint32_t(trans, reference->total_latency_cycles);
+	comms_response_add_uint32_t(trans, reference->max_latency_cycles);
+
+	// ... and follow with a record per traced vector.
+	while ((record = vector_trace_get_record(index++))) {
+		if (!record->in_use) {
+			continue;
+		}
+
+		comms_response_add_uint32_t(trans, record->irq);
+		comms_response_add_uint32_t(trans, record->invocations);
+		comms_response_add_uint32_t(trans, record->total_cycles);
+		comms_response_add_uint32_t(trans, record->max_cycles);
+		comms_response_add_uint32_t(trans, record->min_interarrival_cycles);
+		comms_response_add_uint32_t(trans, record->max_interarrival_cycles);
+	}
+
+	return 0;
+}
+
+
+int core_verb_reset_interrupt_latency_stats(struct command_transaction *trans)
+{
+	(void)trans;
+
+	vector_trace_reset();
+	return 0;
+}
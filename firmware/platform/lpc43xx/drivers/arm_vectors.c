@@ -5,8 +5,11 @@
  */
 
 
+#include <string.h>
+
 #include <toolchain.h>
 #include <drivers/arm_vectors.h>
+#include <drivers/arm_system_control.h>
 
 /**
  * Definition for the ARM Nested Vectored Interrupt Controller (NVIC) register set.
@@ -158,12 +161,105 @@ void platform_set_interrupt_priority(platform_irq_t irq, platform_interrupt_prio
 }
 
 
+//
+// RAM-resident vector table.
+//
+// The boot vector table lives in flash (or wherever the image was loaded),
+// which makes runtime handler swaps -- like sgpio_data.c switching generated
+// ISR variants between capture modes -- either impossible on XIP builds or a
+// relocation exercise. Instead, we keep the live table in zero-wait-state
+// SRAM: it's populated from the boot table early in startup, VTOR is pointed
+// at it, and from then on installing a handler is a single word store.
+//
+
+/**
+ * The RAM copy of the vector table. VTOR requires the table to be aligned
+ * to a power of two at least as large as the table itself; ours is 69 words,
+ * so 512 bytes.
+ */
+static vector_table_t ram_vector_table ATTR_ALIGNED(512);
+
+/** The table the NVIC is currently fetching vectors from. */
+static vector_table_t *active_vector_table = &vector_table;
+
+
+/**
+ * Moves the active vector table into SRAM, so handlers can be swapped with a
+ * single store. Called early in startup; safe to call repeatedly.
+ */
+void vectors_relocate_to_ram(void)
+{
+	arm_system_control_register_block_t *scb = arch_get_system_control_registers();
+
+	// If we've already relocated, there's nothing to do.
+	if (scb->vtor == (uint32_t)&ram_vector_table) {
+		return;
+	}
+
+	// Populate our RAM table from whichever table is currently active...
+	memcpy(&ram_vector_table, (void *)scb->vtor, sizeof(ram_vector_table));
+	active_vector_table = &ram_vector_table;
+
+	// ... and point the NVIC at it. The barriers ensure the new table is
+	// in place before any subsequent exception fetches a vector.
+	scb->vtor = (uint32_t)&ram_vector_table;
+	__asm__ volatile ("dsb\n\tisb" ::: "memory");
+}
+CALL_ON_PREINIT(vectors_relocate_to_ram);
+
+
+/**
+ * Installs an interrupt handler routine for a given IRQ: a single store into
+ * the active (RAM-resident) vector table. Safe to call with the interrupt
+ * enabled -- the Cortex-M4 vector fetch observes the store immediately, and
+ * SRAM vector fetches aren't cached -- though swapping handlers for an
+ * interrupt that may be mid-dispatch is the caller's race to reason about.
+ */
+void vector_set_handler(platform_irq_t irq, interrupt_service_routine_t isr)
+{
+	active_vector_table->irqs[irq] = isr;
+}
+
+
+/**
+ * @return the interrupt handler currently installed for the given IRQ
+ */
+interrupt_service_routine_t vector_get_handler(platform_irq_t irq)
+{
+	return active_vector_table->irqs[irq];
+}
+
+
+/**
+ * Installs a handler for the SysTick exception, which lives outside the IRQ
+ * portion of the vector table. Same swap semantics as vector_set_handler.
+ */
+void vector_set_systick_handler(vector_table_entry_t handler)
+{
+	active_vector_table->systick = handler;
+}
+
+
+/**
+ * Points all four fault exceptions (hard fault, memory management, bus
+ * fault, usage fault) at the given handler, which can distinguish them by
+ * reading IPSR. Same swap semantics as vector_set_handler.
+ */
+void vector_set_fault_handlers(vector_table_entry_t handler)
+{
+	active_vector_table->hard_fault = handler;
+	active_vector_table->memory_management_fault = handler;
+	active_vector_table->bus_fault = handler;
+	active_vector_table->usage_fault = handler;
+}
+
+
 /**
  * Installs an interrupt handler routine for a given IRQ. Should only be called while a given interrupt is disabled.
  */
 void platform_set_interrupt_handler(platform_irq_t irq, interrupt_service_routine_t isr)
 {
-	vector_table.irqs[irq] = isr;
+	vector_set_handler(irq, isr);
 }
 
 
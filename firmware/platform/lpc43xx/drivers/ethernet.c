@@ -5,8 +5,12 @@
  */
 
 
+#include <errno.h>
+#include <string.h>
+
 #include <drivers/ethernet.h>
 
+#include <drivers/arm_vectors.h>
 #include <drivers/platform_reset.h>
 #include <drivers/platform_clock.h>
 
@@ -177,3 +181,324 @@ uint16_t platform_ethernet_mii_read(ethernet_controller_t *device, uint8_t regis
 	// ... and wait for it to complete, and then return the result.
 	return platform_ethernet_mii_complete_transaction(device);
 }
+
+
+/**
+ * The controller whose interrupt is currently connected; used to find the
+ * device object from the (argumentless) interrupt handler.
+ */
+static ethernet_controller_t *active_ethernet_controller;
+
+
+/**
+ * Builds the receive ring: each descriptor takes a pool buffer and is handed
+ * to the DMA engine, with interrupts suppressed on all but every Nth
+ * descriptor so bursts of traffic coalesce into fewer interrupts.
+ */
+static int ethernet_set_up_rx_ring(ethernet_controller_t *device)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+
+	for (unsigned i = 0; i < ETHERNET_RX_RING_ENTRIES; ++i) {
+		ethernet_dma_descriptor_t *descriptor = &platform->rx_ring[i];
+		void *buffer = pool_get(&platform->frame_pool);
+
+		if (!buffer) {
+			return ENOMEM;
+		}
+
+		descriptor->buffer_address = (uint32_t)buffer;
+		descriptor->next_descriptor = (uint32_t)&platform->rx_ring[(i + 1) % ETHERNET_RX_RING_ENTRIES];
+
+		descriptor->control = ETHERNET_RDES_CONTROL_CHAINED |
+				ETHERNET_RDES_CONTROL_BUFFER_SIZE(ETHERNET_FRAME_BUFFER_SIZE);
+		if ((i + 1) % ETHERNET_RX_COALESCE_INTERVAL) {
+			descriptor->control |= ETHERNET_RDES_CONTROL_DISABLE_INTERRUPT;
+		}
+
+		// Hand the descriptor to the DMA engine last, once it's fully formed.
+		descriptor->status = ETHERNET_DESC_STATUS_OWNED_BY_DMA;
+	}
+
+	platform->rx_index = 0;
+	return 0;
+}
+
+
+/**
+ * Builds the transmit ring: every descriptor is pre-linked into the chain,
+ * owned by the processor, and otherwise empty until a frame is queued.
+ */
+static void ethernet_set_up_tx_ring(ethernet_controller_t *device)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+
+	for (unsigned i = 0; i < ETHERNET_TX_RING_ENTRIES; ++i) {
+		ethernet_dma_descriptor_t *descriptor = &platform->tx_ring[i];
+
+		descriptor->status = ETHERNET_TDES_STATUS_CHAINED;
+		descriptor->control = 0;
+		descriptor->buffer_address = 0;
+		descriptor->next_descriptor = (uint32_t)&platform->tx_ring[(i + 1) % ETHERNET_TX_RING_ENTRIES];
+	}
+
+	platform->tx_produce_index = 0;
+	platform->tx_reclaim_index = 0;
+}
+
+
+/**
+ * Builds the controller's descriptor rings and starts the DMA engine, after
+ * which frames flow without further processor involvement.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int platform_ethernet_start(ethernet_controller_t *device)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+	ethernet_register_block_t *reg = device->reg;
+	int rc;
+
+	// Reset the DMA engine, so we configure it from a known state.
+	reg->dma.bus_mode |= ETHERNET_BUS_MODE_SOFTWARE_RESET;
+	while (reg->dma.bus_mode & ETHERNET_BUS_MODE_SOFTWARE_RESET);
+
+	// Set up the frame pool, and build both descriptor rings from it.
+	rc = pool_init(&platform->frame_pool, platform->frame_buffers,
+			ETHERNET_FRAME_BUFFER_SIZE, ETHERNET_FRAME_BUFFER_COUNT);
+	if (rc) {
+		return rc;
+	}
+
+	rc = ethernet_set_up_rx_ring(device);
+	if (rc) {
+		return rc;
+	}
+	ethernet_set_up_tx_ring(device);
+
+	// Program the station address, so the MAC can perfect-filter for us.
+	reg->mac.addr0_high =
+			((uint32_t)device->mac_address[5] <<  8) |  (uint32_t)device->mac_address[4];
+	reg->mac.addr0_low =
+			((uint32_t)device->mac_address[3] << 24) | ((uint32_t)device->mac_address[2] << 16) |
+			((uint32_t)device->mac_address[1] <<  8) |  (uint32_t)device->mac_address[0];
+
+	// Point the DMA engine at our rings, and let it burst descriptor and
+	// buffer accesses.
+	reg->dma.rec_des_addr = (uint32_t)platform->rx_ring;
+	reg->dma.trans_des_addr = (uint32_t)platform->tx_ring;
+	reg->dma.bus_mode = ETHERNET_BUS_MODE_BURST_LENGTH(4);
+
+	// Arm the receive interrupt watchdog, so frames received on descriptors
+	// with interrupts suppressed still surface promptly once traffic idles.
+	reg->dma.rec_int_wdt = 0xff;
+
+	// Enable coalesced receive and transmit-complete interrupts...
+	reg->dma.int_en = ETHERNET_INTERRUPT_NORMAL_SUMMARY |
+			ETHERNET_INTERRUPT_RECEIVE_COMPLETE | ETHERNET_INTERRUPT_TRANSMIT_COMPLETE;
+
+	// ... start both DMA paths, in store-and-forward mode so bad frames
+	// never reach the wire...
+	reg->dma.op_mode = ETHERNET_OP_MODE_STORE_AND_FORWARD |
+			ETHERNET_OP_MODE_START_RECEIVE | ETHERNET_OP_MODE_START_TRANSMIT;
+
+	// ... and finally bring up the MAC itself.
+	reg->mac.config |= ETHERNET_MAC_CONFIG_RECEIVER_ENABLE | ETHERNET_MAC_CONFIG_TRANSMITTER_ENABLE |
+			ETHERNET_MAC_CONFIG_FULL_DUPLEX | ETHERNET_MAC_CONFIG_100MBPS;
+
+	return 0;
+}
+
+
+/**
+ * Harvests the oldest received frame, if one is pending, handing its buffer
+ * to the caller zero-copy; the descriptor is refilled from the frame pool.
+ *
+ * @param length Out argument; receives the frame's length, in bytes.
+ * @return the frame buffer, or NULL if no complete frame is pending
+ */
+uint8_t *platform_ethernet_read_frame(ethernet_controller_t *device, uint32_t *length)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+
+	while (1) {
+		ethernet_dma_descriptor_t *descriptor = &platform->rx_ring[platform->rx_index];
+		uint32_t status = descriptor->status;
+		uint8_t *frame;
+		void *replacement;
+
+		// If the DMA engine still owns the head descriptor, nothing's pending.
+		if (status & ETHERNET_DESC_STATUS_OWNED_BY_DMA) {
+			return NULL;
+		}
+
+		// Errored frames -- and frames too large for a single buffer -- are
+		// recycled in place rather than delivered.
+		bool intact = (status & ETHERNET_RDES_STATUS_FIRST_DESCRIPTOR) &&
+				(status & ETHERNET_RDES_STATUS_LAST_DESCRIPTOR) &&
+				!(status & ETHERNET_DESC_STATUS_ERROR_SUMMARY);
+
+		// Zero-copy delivery needs a replacement buffer for the descriptor; if
+		// the pool is dry, drop this frame and recycle its buffer instead.
+		replacement = intact ? pool_get(&platform->frame_pool) : NULL;
+
+		if (!replacement) {
+			platform->rx_dropped++;
+			descriptor->status = ETHERNET_DESC_STATUS_OWNED_BY_DMA;
+			platform->rx_index = (platform->rx_index + 1) % ETHERNET_RX_RING_ENTRIES;
+			continue;
+		}
+
+		// Take the frame's buffer, refill the descriptor, and return it to
+		// the DMA engine.
+		frame = (uint8_t *)descriptor->buffer_address;
+		*length = ETHERNET_RDES_STATUS_FRAME_LENGTH(status);
+
+		descriptor->buffer_address = (uint32_t)replacement;
+		descriptor->status = ETHERNET_DESC_STATUS_OWNED_BY_DMA;
+		platform->rx_index = (platform->rx_index + 1) % ETHERNET_RX_RING_ENTRIES;
+
+		// If the receiver suspended on a full ring, poke it back into motion.
+		device->reg->dma.rec_poll_demand = 1;
+
+		return frame;
+	}
+}
+
+
+/**
+ * Returns a harvested frame buffer to the receive pool.
+ */
+void platform_ethernet_release_frame(ethernet_controller_t *device, void *buffer)
+{
+	pool_put(&device->platform.frame_pool, buffer);
+}
+
+
+/**
+ * Returns transmit descriptors the DMA engine has finished with to the
+ * processor's ownership, making room for new frames.
+ */
+static void ethernet_reclaim_tx_descriptors(ethernet_controller_t *device)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+
+	while (platform->tx_reclaim_index != platform->tx_produce_index) {
+		ethernet_dma_descriptor_t *descriptor = &platform->tx_ring[platform->tx_reclaim_index];
+
+		if (descriptor->status & ETHERNET_DESC_STATUS_OWNED_BY_DMA) {
+			break;
+		}
+
+		descriptor->buffer_address = 0;
+		platform->tx_reclaim_index = (platform->tx_reclaim_index + 1) % ETHERNET_TX_RING_ENTRIES;
+	}
+}
+
+
+/** @return the number of transmit descriptors not currently in flight */
+static unsigned ethernet_tx_descriptors_free(ethernet_controller_t *device)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+	unsigned in_flight = (platform->tx_produce_index - platform->tx_reclaim_index +
+			ETHERNET_TX_RING_ENTRIES) % ETHERNET_TX_RING_ENTRIES;
+
+	// One slot always stays unused, so a full ring and an empty ring aren't
+	// the same cursor state.
+	return (ETHERNET_TX_RING_ENTRIES - 1) - in_flight;
+}
+
+
+/**
+ * Queues a frame for transmit, one chained descriptor per segment, so
+ * scattered headers and payloads are sent without a gather copy. Segment
+ * buffers remain owned by the DMA engine until the transmit completes.
+ *
+ * @return 0 on success, or EBUSY if the ring lacks room for the frame
+ */
+int platform_ethernet_transmit_frame(ethernet_controller_t *device,
+		const void *const *segments, const uint32_t *lengths, unsigned segment_count)
+{
+	ethernet_platform_data_t *platform = &device->platform;
+	unsigned index = platform->tx_produce_index;
+
+	if (!segment_count) {
+		return EINVAL;
+	}
+
+	// Free up anything the DMA engine has finished with, and make sure the
+	// whole frame fits -- a partially-queued frame would wedge the ring.
+	ethernet_reclaim_tx_descriptors(device);
+	if (ethernet_tx_descriptors_free(device) < segment_count) {
+		return EBUSY;
+	}
+
+	// Populate one descriptor per segment. Ownership is granted in reverse,
+	// first segment last, so the DMA engine can't race our ring-building.
+	for (unsigned i = 0; i < segment_count; ++i) {
+		ethernet_dma_descriptor_t *descriptor = &platform->tx_ring[index];
+		uint32_t status = ETHERNET_TDES_STATUS_CHAINED;
+
+		if (i == 0) {
+			status |= ETHERNET_TDES_STATUS_FIRST_SEGMENT;
+		}
+		if (i == (segment_count - 1)) {
+			status |= ETHERNET_TDES_STATUS_LAST_SEGMENT | ETHERNET_TDES_STATUS_INTERRUPT_ON_COMPLETE;
+		}
+
+		descriptor->buffer_address = (uint32_t)segments[i];
+		descriptor->control = ETHERNET_TDES_CONTROL_BUFFER_SIZE(lengths[i]);
+		descriptor->status = status | ((i == 0) ? 0 : ETHERNET_DESC_STATUS_OWNED_BY_DMA);
+
+		index = (index + 1) % ETHERNET_TX_RING_ENTRIES;
+	}
+
+	// Hand the first segment -- and with it, the whole chain -- to the DMA
+	// engine, and poke the (likely suspended) transmitter into motion.
+	platform->tx_ring[platform->tx_produce_index].status |= ETHERNET_DESC_STATUS_OWNED_BY_DMA;
+	platform->tx_produce_index = index;
+	device->reg->dma.trans_poll_demand = 1;
+
+	return 0;
+}
+
+
+/**
+ * @return true iff all queued transmit frames have left the controller
+ */
+bool platform_ethernet_transmit_complete(ethernet_controller_t *device)
+{
+	ethernet_reclaim_tx_descriptors(device);
+	return device->platform.tx_reclaim_index == device->platform.tx_produce_index;
+}
+
+
+/**
+ * Core ethernet interrupt handler: acknowledges the DMA engine's events, and
+ * lets the frame-received callback drain any pending frames.
+ */
+static void platform_ethernet_interrupt(void)
+{
+	ethernet_controller_t *device = active_ethernet_controller;
+	uint32_t status = device->reg->dma.stat;
+
+	// Acknowledge everything we've observed; the status bits are write-1-to-clear.
+	device->reg->dma.stat = status;
+
+	if ((status & ETHERNET_INTERRUPT_RECEIVE_COMPLETE) && device->frame_received_callback) {
+		device->frame_received_callback(device);
+	}
+}
+
+
+/**
+ * Connects the controller's interrupt, which fires on coalesced receive
+ * events and invokes the controller's frame_received callback.
+ */
+void platform_ethernet_set_up_interrupt(ethernet_controller_t *device)
+{
+	active_ethernet_controller = device;
+
+	vector_set_handler(ETHERNET_IRQ, platform_ethernet_interrupt);
+	platform_enable_interrupt(ETHERNET_IRQ);
+}
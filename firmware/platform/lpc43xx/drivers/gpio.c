@@ -12,13 +12,16 @@
 
 #include <drivers/scu.h>
 #include <drivers/gpio.h>
+#include <drivers/timer.h>
+#include <drivers/scheduler.h>
+#include <drivers/arm_vectors.h>
 
+// Exclusive-access primitives, for handing deferred work to the scheduler.
+#include <libopencm3/cm3/sync.h>
 
-/* Physical locations of the GPIO parameters. */
-#define GPIO_LPC_BASE			 (0x400f4000)
-#define GPIO_LPC_PIN_WORD_OFFSET (0x1000)
-#define GPIO_LPC_PORT_OFFSET	 (0x2000)
-#define GPIO_LPC_PIN_WORD_SIZE	 (32 * sizeof(uint32_t))
+
+// The peripheral's physical register locations come from <drivers/platform_gpio.h>,
+// which shares them with the inline masked-access helpers.
 
 /**
  * Structure representing the in-memory layout of a GPIO peripheral.
@@ -622,13 +625,83 @@ int gpio_set_port_value(uint8_t port, uint32_t mask, uint32_t value)
 		return EINVAL;
 	}
 
-	// Use the hardware pin-masking feature to write the given values.
-	reg->mask = mask;
+	// Use the hardware pin-masking feature to write the given values. The
+	// MASK register's sense is inverted from our argument's: a _set_ bit
+	// there excludes the pin from masked accesses.
+	//
+	// Note that this clobbers any mask set up with gpio_configure_port_mask();
+	// re-configure before the next gpio_write_masked_port().
+	reg->mask = ~mask;
+	reg->masked_pins = value;
+	return 0;
+}
+
+
+/**
+ * Configures which of a port's pins subsequent masked-port accesses will
+ * touch, using the GPIO block's hardware pin masking. Pays the mask-register
+ * store once, so each gpio_write_masked_port() afterwards is a single store
+ * -- the fast path for bit-banged protocols that repeatedly update the same
+ * pin subset.
+ *
+ * @param port The number of the port to be configured.
+ * @param mask A bit-mask with a 1 for each pin masked accesses should affect.
+ */
+int gpio_configure_port_mask(uint8_t port, uint32_t mask)
+{
+	struct gpio_registers *reg = gpio_get_registers(port);
+
+	if (validate_port(port) != 0) {
+		return EINVAL;
+	}
+
+	// The MASK register's sense is inverted from our argument's: a _set_
+	// bit there excludes the pin from masked accesses.
+	reg->mask = ~mask;
+	return 0;
+}
+
+
+/**
+ * Writes the pins selected by gpio_configure_port_mask(), leaving the
+ * port's other pins untouched. One store, after validation; callers that
+ * can't afford even the validation should use the inline
+ * platform_gpio_write_masked_port() from <drivers/platform_gpio.h>.
+ *
+ * @param port The number of the port to be written.
+ * @param value The value to write; only masked-in bits take effect.
+ */
+int gpio_write_masked_port(uint8_t port, uint32_t value)
+{
+	struct gpio_registers *reg = gpio_get_registers(port);
+
+	if (validate_port(port) != 0) {
+		return EINVAL;
+	}
+
 	reg->masked_pins = value;
 	return 0;
 }
 
 
+/**
+ * Reads the pins selected by gpio_configure_port_mask(); pins outside the
+ * mask read as zero.
+ *
+ * @param port The number of the port to be read.
+ */
+uint32_t gpio_read_masked_port(uint8_t port)
+{
+	struct gpio_registers *reg = gpio_get_registers(port);
+
+	if (validate_port(port) != 0) {
+		return 0;
+	}
+
+	return reg->masked_pins;
+}
+
+
 /**
  * Sets a collection of bits in a GPIO port.
  *
@@ -704,8 +777,10 @@ uint32_t gpio_get_port_value(uint8_t port, uint32_t mask)
 		return EINVAL;
 	}
 
-	// Use the hardware pin-masking feature to write the given values.
-	reg->mask = mask;
+	// Use the hardware pin-masking feature to read the given pins; as with
+	// gpio_set_port_value(), the MASK register's sense is inverted, and this
+	// clobbers any mask set up with gpio_configure_port_mask().
+	reg->mask = ~mask;
 	return reg->masked_pins;
 }
 
@@ -824,3 +899,338 @@ uint32_t *platform_gpio_get_pin_register(gpio_pin_t pin)
 {
 	return gpio_get_pin_register(pin);
 }
+
+
+/**
+ * Performs the paced sampling loop for gpio_capture_ports(). The port reads
+ * for each sample are expanded at compile time, so every iteration executes
+ * the same straight-line sequence and the cadence stays deterministic.
+ */
+#define GPIO_CAPTURE_LOOP(port_reads) \
+	for (size_t sample = 0; sample < sample_count; ++sample) { \
+		uint32_t tick; \
+		\
+		/* Wait for the next edge of our pacing timer. */ \
+		while ((tick = timer_get_value(&pacing_timer)) == last_tick); \
+		last_tick = tick; \
+		\
+		port_reads \
+	}
+
+
+/**
+ * Captures the values of one or more GPIO ports at a fixed sample rate --
+ * software logic capture for modest (~1-5 MHz) rates, so the system's
+ * dedicated capture hardware stays free for the fast channels.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int gpio_capture_ports(const uint8_t *ports, unsigned port_count,
+		uint32_t sample_rate, uint32_t *buffer, size_t sample_count)
+{
+	volatile uint32_t *pin_values[GPIO_CAPTURE_MAX_PORTS];
+	hw_timer_t pacing_timer;
+	uint32_t last_tick;
+	uint32_t rc;
+
+	if (!ports || !buffer || !sample_rate || !port_count || (port_count > GPIO_CAPTURE_MAX_PORTS)) {
+		return EINVAL;
+	}
+
+	// Resolve each port's pin-value register up front, so the sampling loop
+	// itself is nothing but loads and stores.
+	for (unsigned i = 0; i < port_count; ++i) {
+		if (validate_port(ports[i]) != 0) {
+			return EINVAL;
+		}
+		pin_values[i] = &gpio_get_registers(ports[i])->pins;
+	}
+
+	// Pace the capture on a hardware timer ticking at the sample rate; each
+	// counter increment marks one sample point.
+	rc = acquire_timer(&pacing_timer);
+	if (rc) {
+		return rc;
+	}
+	timer_enable(&pacing_timer, sample_rate);
+	last_tick = timer_get_value(&pacing_timer);
+
+	// Select the capture loop for our port count outside the loop itself, so
+	// each sample costs exactly the reads it needs -- no inner-loop branching.
+	switch (port_count) {
+		case 1:
+			GPIO_CAPTURE_LOOP(
+				*buffer++ = *pin_values[0];
+			)
+			break;
+
+		case 2:
+			GPIO_CAPTURE_LOOP(
+				*buffer++ = *pin_values[0];
+				*buffer++ = *pin_values[1];
+			)
+			break;
+
+		case 3:
+			GPIO_CAPTURE_LOOP(
+				*buffer++ = *pin_values[0];
+				*buffer++ = *pin_values[1];
+				*buffer++ = *pin_values[2];
+			)
+			break;
+
+		case 4:
+			GPIO_CAPTURE_LOOP(
+				*buffer++ = *pin_values[0];
+				*buffer++ = *pin_values[1];
+				*buffer++ = *pin_values[2];
+				*buffer++ = *pin_values[3];
+			)
+			break;
+	}
+
+	release_timer(&pacing_timer);
+	return 0;
+}
+
+
+/* Physical locations of the pin-interrupt hardware. */
+#define GPIO_PIN_INTERRUPT_BASE      (0x40087000)
+#define GPIO_PIN_INTERRUPT_SELECT    (0x40086e00)
+#define GPIO_PIN_INTERRUPT_CHANNELS  (8)
+
+/**
+ * Structure representing the in-memory layout of the pin-interrupt block.
+ */
+struct ATTR_PACKED gpio_pin_interrupt_registers {
+
+	/** Per-channel mode; 0 = edge sensitive, 1 = level sensitive. */
+	volatile uint32_t mode;
+
+	/** Rising-edge enables, with atomic set/clear views. */
+	volatile uint32_t enable_rising;
+	volatile uint32_t set_enable_rising;
+	volatile uint32_t clear_enable_rising;
+
+	/** Falling-edge enables, with atomic set/clear views. */
+	volatile uint32_t enable_falling;
+	volatile uint32_t set_enable_falling;
+	volatile uint32_t clear_enable_falling;
+
+	/** Latched edge detections; write 1 to clear. */
+	volatile uint32_t rising_detected;
+	volatile uint32_t falling_detected;
+
+	/** Pending-interrupt status; write 1 to clear (in edge mode). */
+	volatile uint32_t status;
+};
+
+
+/**
+ * Per-channel interrupt registrations; a channel is in use iff its
+ * callback is populated.
+ */
+static struct {
+	gpio_pin_t pin;
+	gpio_interrupt_callback_t callback;
+	void *user_data;
+	bool deferred;
+} gpio_interrupt_handlers[GPIO_PIN_INTERRUPT_CHANNELS];
+
+// Channels with deferred work awaiting the scheduler, and whether our
+// deferred-dispatch task has been registered with it.
+static volatile uint32_t gpio_interrupt_deferred_pending;
+static bool gpio_interrupt_task_registered;
+
+
+/**
+ * Gets a reference to the pin-interrupt register block.
+ */
+static struct gpio_pin_interrupt_registers *gpio_get_pin_interrupt_registers(void)
+{
+	return (struct gpio_pin_interrupt_registers *)GPIO_PIN_INTERRUPT_BASE;
+}
+
+
+/**
+ * Routes a GPIO pin to a pin-interrupt channel, via the system's
+ * interrupt-select registers.
+ */
+static void gpio_route_pin_interrupt(unsigned channel, gpio_pin_t pin)
+{
+	volatile uint32_t *select = (volatile uint32_t *)GPIO_PIN_INTERRUPT_SELECT;
+	unsigned shift = (channel % 4) * 8;
+
+	select[channel / 4] &= ~(0xffUL << shift);
+	select[channel / 4] |= ((uint32_t)((pin.port << 5) | pin.pin)) << shift;
+}
+
+
+/**
+ * Invokes the callback registered for a single pin-interrupt channel.
+ */
+static void gpio_interrupt_invoke(unsigned channel)
+{
+	if (gpio_interrupt_handlers[channel].callback) {
+		gpio_interrupt_handlers[channel].callback(
+				gpio_interrupt_handlers[channel].pin,
+				gpio_interrupt_handlers[channel].user_data);
+	}
+}
+
+
+/**
+ * Scheduler task that runs deferred pin-interrupt callbacks in thread
+ * context; marked ready by the dispatch routine below.
+ */
+static void gpio_interrupt_deferred_task(void)
+{
+	uint32_t pending;
+	bool aborted;
+
+	// Atomically take the deferred set, so edges that arrive while we're
+	// dispatching are kept for the next round rather than lost.
+	do {
+		pending = __ldrex((uint32_t *)&gpio_interrupt_deferred_pending);
+		aborted = __strex(0, (uint32_t *)&gpio_interrupt_deferred_pending);
+	} while (aborted);
+
+	while (pending) {
+		unsigned channel = 31 - __builtin_clz(pending);
+		pending &= ~(1UL << channel);
+
+		gpio_interrupt_invoke(channel);
+	}
+}
+
+
+/**
+ * Core pin-interrupt dispatch: jumps directly to each pending channel via
+ * count-leading-zeros over the status mask, rather than scanning every
+ * channel -- the difference matters for time-critical trigger responses.
+ */
+static void gpio_interrupt_dispatch(void)
+{
+	struct gpio_pin_interrupt_registers *pint = gpio_get_pin_interrupt_registers();
+	uint32_t pending = pint->status & ((1UL << GPIO_PIN_INTERRUPT_CHANNELS) - 1);
+
+	// Acknowledge everything we're about to dispatch.
+	pint->status = pending;
+
+	while (pending) {
+		unsigned channel = 31 - __builtin_clz(pending);
+		pending &= ~(1UL << channel);
+
+		// Deferred channels are batched for the scheduler; the rest are
+		// dispatched immediately, from interrupt context.
+		if (gpio_interrupt_handlers[channel].deferred) {
+			gpio_interrupt_deferred_pending |= (1UL << channel);
+			scheduler_mark_task_ready(gpio_interrupt_deferred_task);
+		} else {
+			gpio_interrupt_invoke(channel);
+		}
+	}
+}
+
+
+/**
+ * Registers an edge-triggered interrupt callback for a GPIO pin, claiming
+ * one of the platform's pin-interrupt channels.
+ *
+ * @return 0 on success, EBUSY if no pin-interrupt channel is free, or
+ *		another error code on failure
+ */
+int gpio_interrupt_register(gpio_pin_t pin, gpio_interrupt_sensitivity_t sensitivity,
+		gpio_interrupt_callback_t callback, void *user_data, bool defer_to_scheduler)
+{
+	struct gpio_pin_interrupt_registers *pint = gpio_get_pin_interrupt_registers();
+	unsigned channel;
+	uint32_t channel_mask;
+
+	if (validate_port_and_pin(pin) != 0) {
+		return EINVAL;
+	}
+	if (!callback) {
+		return EINVAL;
+	}
+
+	// Claim the first free channel.
+	for (channel = 0; channel < GPIO_PIN_INTERRUPT_CHANNELS; ++channel) {
+		if (!gpio_interrupt_handlers[channel].callback) {
+			break;
+		}
+	}
+	if (channel == GPIO_PIN_INTERRUPT_CHANNELS) {
+		pr_warning("gpio: no free pin-interrupt channels for port %u, pin %u\n", pin.port, pin.pin);
+		return EBUSY;
+	}
+	channel_mask = (1UL << channel);
+
+	// Deferred dispatch rides on the scheduler; make sure our task is known to it.
+	if (defer_to_scheduler && !gpio_interrupt_task_registered) {
+		int rc = scheduler_register_task(gpio_interrupt_deferred_task, SCHEDULER_DEFAULT_PRIORITY);
+		if (rc) {
+			return rc;
+		}
+		gpio_interrupt_task_registered = true;
+	}
+
+	// Populate the handler before any hardware can fire it.
+	gpio_interrupt_handlers[channel].pin = pin;
+	gpio_interrupt_handlers[channel].user_data = user_data;
+	gpio_interrupt_handlers[channel].deferred = defer_to_scheduler;
+	gpio_interrupt_handlers[channel].callback = callback;
+
+	// Route the pin to the channel, select edge sensitivity, and discard any
+	// stale detections from before we were watching.
+	gpio_route_pin_interrupt(channel, pin);
+	pint->mode &= ~channel_mask;
+	pint->rising_detected = channel_mask;
+	pint->falling_detected = channel_mask;
+	pint->status = channel_mask;
+
+	if (sensitivity != GPIO_INTERRUPT_FALLING_EDGE) {
+		pint->set_enable_rising = channel_mask;
+	}
+	if (sensitivity != GPIO_INTERRUPT_RISING_EDGE) {
+		pint->set_enable_falling = channel_mask;
+	}
+
+	// Finally, connect the channel's vector.
+	vector_set_handler(PIN_INT0_IRQ + channel, gpio_interrupt_dispatch);
+	platform_enable_interrupt(PIN_INT0_IRQ + channel);
+
+	return 0;
+}
+
+
+/**
+ * Unregisters a pin's interrupt callback, releasing its channel.
+ *
+ * @return 0 on success, or EINVAL if the pin has no registered interrupt
+ */
+int gpio_interrupt_unregister(gpio_pin_t pin)
+{
+	struct gpio_pin_interrupt_registers *pint = gpio_get_pin_interrupt_registers();
+
+	for (unsigned channel = 0; channel < GPIO_PIN_INTERRUPT_CHANNELS; ++channel) {
+		gpio_pin_t candidate = gpio_interrupt_handlers[channel].pin;
+
+		if (!gpio_interrupt_handlers[channel].callback ||
+				(candidate.port != pin.port) || (candidate.pin != pin.pin)) {
+			continue;
+		}
+
+		// Quiesce the channel before dropping its handler.
+		platform_disable_interrupt(PIN_INT0_IRQ + channel);
+		pint->clear_enable_rising = (1UL << channel);
+		pint->clear_enable_falling = (1UL << channel);
+
+		gpio_interrupt_handlers[channel].callback = NULL;
+		gpio_interrupt_deferred_pending &= ~(1UL << channel);
+
+		return 0;
+	}
+
+	return EINVAL;
+}
@@ -0,0 +1,109 @@
+/**
+ * This file is part of libgreat
+ *
+ * LPC43xx inter-core comms transport: executes the verbs of
+ * coprocessor-resident comms classes on the Cortex-M0, over the
+ * shared-memory request ring in the M0 control block.
+ *
+ * The submitting M4 context fills a ring slot with the transaction's
+ * class, verb, and buffer addresses, then raises its inter-core event --
+ * the M4's TXEV output is cross-wired to the M0, waking a WFE-idle M0
+ * loop. While the M0 runs the handler, the M4 sleeps in WFE rather than
+ * spinning, so its interrupt-driven work (notably the SGPIO capture path)
+ * proceeds undisturbed; the M0's completion event wakes it to harvest the
+ * result. Latency-insensitive verbs thus cost the M4 only the handoff.
+ */
+
+#include <debug.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include <drivers/comms.h>
+#include <drivers/comms_backend.h>
+#include <drivers/m0_offload.h>
+#include <drivers/timer.h>
+
+/** How long to wait for the M0 to complete a request, in microseconds.
+ * Generous: offloaded verbs are expected to run in microseconds. */
+#define M0_COMMS_TIMEOUT 100000
+
+/** True once we've warned that the M0 has stopped answering, so a wedged
+ * image doesn't flood the log with one warning per command. */
+static bool m0_comms_unresponsive_reported;
+
+
+/**
+ * Hands a command for a coprocessor-resident class to the M0; see
+ * <drivers/comms_backend.h>. Overrides the weak stub in comms_class.c
+ * when this module is present.
+ *
+ * Declining with ENODEV -- no M0 image running, or no free ring slot --
+ * makes dispatch run the handler locally, so M0-resident classes keep
+ * working (just on the M4) when the coprocessor isn't available. Slots
+ * whose requests time out are never reclaimed, as a wedged M0 could
+ * complete them arbitrarily late, into buffers since reused; once a
+ * wedged image has pinned every slot, commands simply degrade to local
+ * execution.
+ */
+int comms_submit_command_to_coprocessor(struct command_transaction *trans)
+{
+	struct m0_control_block *control = m0_offload_control_block();
+	struct m0_comms_ring *ring;
+	struct m0_comms_request *request;
+	uint32_t head, next_head, wait_base;
+	int rc;
+
+	if (!control || (control->magic != M0_CONTROL_BLOCK_MAGIC)) {
+		return ENODEV;
+	}
+	ring = &control->comms;
+
+	// If advancing the head would collide with the tail, every slot is in
+	// flight (or pinned by a timed-out request); decline, and let the
+	// command run locally.
+	head = ring->head;
+	next_head = (head + 1) & (M0_COMMS_RING_DEPTH - 1);
+	if (next_head == ring->tail) {
+		return ENODEV;
+	}
+
+	// Populate the slot with the command and its buffers...
+	request = &ring->requests[head];
+	request->class_number        = trans->class_number;
+	request->verb                = trans->verb;
+	request->data_in_address     = (uint32_t)(uintptr_t)trans->data_in;
+	request->data_in_length      = trans->data_in_length;
+	request->data_out_address    = (uint32_t)(uintptr_t)trans->data_out;
+	request->data_out_max_length = trans->data_out_max_length;
+	request->state               = M0_COMMS_SLOT_PENDING;
+
+	// ... publish it -- the head advance is the M0's signal that the slot's
+	// contents are valid, so it must come last -- and wake the M0.
+	__asm__ volatile("dmb" ::: "memory");
+	ring->head = next_head;
+	__asm__ volatile("sev");
+
+	// Sleep until the M0's completion event (or any interrupt) wakes us;
+	// ISRs -- including the capture pipeline's -- run normally throughout.
+	wait_base = get_time();
+	while (request->state != M0_COMMS_SLOT_COMPLETE) {
+		if (get_time_since(wait_base) > M0_COMMS_TIMEOUT) {
+			if (!m0_comms_unresponsive_reported) {
+				m0_comms_unresponsive_reported = true;
+				pr_warning("m0: coprocessor stopped answering comms requests;"
+						" abandoning its slots\n");
+			}
+			return ETIMEDOUT;
+		}
+		__asm__ volatile("wfe");
+	}
+	__asm__ volatile("dmb" ::: "memory");
+
+	// Harvest the result, then hand the slot back to the ring.
+	trans->data_out_length = request->data_out_length;
+	rc = request->return_code;
+	request->state = M0_COMMS_SLOT_FREE;
+
+	m0_comms_unresponsive_reported = false;
+	return rc;
+}
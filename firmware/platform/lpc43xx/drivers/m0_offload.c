@@ -0,0 +1,164 @@
+/**
+ * This file is part of libgreat
+ *
+ * LPC43xx M0 coprocessor offload framework -- image loading, shared-memory
+ * mailboxes, and task pinning for the Cortex-M0 companion core.
+ *
+ * The M0 runs a small program image loaded into its dedicated RAM region;
+ * the M4 coordinates with it through a control block placed at the top of
+ * that region. Pinning a polling-heavy task (SGPIO exchange servicing,
+ * buffer compaction) to the M0 leaves the M4 free for USB and comms work.
+ */
+
+#include <string.h>
+#include <debug.h>
+#include <errno.h>
+#include <stddef.h>
+
+#include <drivers/m0_offload.h>
+#include <drivers/platform_reset.h>
+
+/** The M0's RAM region, as laid out in LPC43xx_M0_memory.ld. */
+#define M0_RAM_BASE (0x10090000UL)
+#define M0_RAM_SIZE (8 * 1024UL)
+
+/** The shared control block lives at the top of the M0's RAM region;
+ * the loaded image must leave this much room free. */
+#define M0_CONTROL_BLOCK_ADDRESS \
+	(M0_RAM_BASE + M0_RAM_SIZE - sizeof(struct m0_control_block))
+
+/** True iff we've loaded an image and released the M0 from reset. */
+static bool m0_image_loaded;
+
+
+/**
+ * @return a reference to the shared control block, or NULL if no M0 image
+ *     has been loaded
+ */
+struct m0_control_block *m0_offload_control_block(void)
+{
+	if (!m0_image_loaded) {
+		return NULL;
+	}
+
+	return (struct m0_control_block *)M0_CONTROL_BLOCK_ADDRESS;
+}
+
+
+/**
+ * Loads an M0 program image into the M0's RAM region, initializes the
+ * shared control block, and brings the M0 core out of reset.
+ */
+int m0_offload_load_image(const void *image, uint32_t size)
+{
+	struct m0_control_block *control = (struct m0_control_block *)M0_CONTROL_BLOCK_ADDRESS;
+
+	if (!image || !size) {
+		return EINVAL;
+	}
+
+	// The image must leave room for the control block at the top of the
+	// M0's RAM region.
+	if (size > (M0_RAM_SIZE - sizeof(*control))) {
+		pr_error("m0: image of %" PRIu32 " bytes doesn't fit in the M0 RAM region!\n", size);
+		return ENOMEM;
+	}
+
+	// Ensure the M0 is halted while we replace its memory contents.
+	platform_halt_m0_core();
+	m0_image_loaded = false;
+
+	// Copy the image into place...
+	memcpy((void *)M0_RAM_BASE, image, size);
+
+	// ... set up a clean control block...
+	memset(control, 0, sizeof(*control));
+	control->requested_task = M0_TASK_NONE;
+	control->active_task = M0_TASK_NONE;
+	control->magic = M0_CONTROL_BLOCK_MAGIC;
+
+	// ... and point the M0's shadow region at its new image and start it.
+	platform_start_m0_core((void *)M0_RAM_BASE);
+	m0_image_loaded = true;
+
+	pr_info("m0: loaded a %" PRIu32 "-byte image; coprocessor running\n", size);
+	return 0;
+}
+
+
+/**
+ * Halts the M0 core and invalidates the shared control block.
+ */
+void m0_offload_halt(void)
+{
+	struct m0_control_block *control = m0_offload_control_block();
+
+	platform_halt_m0_core();
+
+	if (control) {
+		control->magic = 0;
+	}
+	m0_image_loaded = false;
+}
+
+
+/**
+ * Asks the M0 to run a given task -- e.g. SGPIO polling or buffer
+ * compaction. Task numbers are defined by the loaded image.
+ */
+int m0_offload_pin_task(uint32_t task)
+{
+	struct m0_control_block *control = m0_offload_control_block();
+
+	if (!control || (control->magic != M0_CONTROL_BLOCK_MAGIC)) {
+		return ENODEV;
+	}
+
+	control->requested_task = task;
+	return 0;
+}
+
+
+/**
+ * Posts a message to a mailbox. Safe only from the producing core.
+ */
+int m0_mailbox_post(struct m0_mailbox *mailbox, uint32_t command, uint32_t argument)
+{
+	uint32_t head = mailbox->head;
+	uint32_t next_head = (head + 1) & (M0_MAILBOX_DEPTH - 1);
+
+	// If advancing the head would collide with the tail, the mailbox is full.
+	if (next_head == mailbox->tail) {
+		return EAGAIN;
+	}
+
+	mailbox->messages[head].command = command;
+	mailbox->messages[head].argument = argument;
+
+	// Publish the message: the head advance is the consumer's signal that
+	// the slot's contents are valid, so it must come last.
+	__asm__ volatile("dmb" ::: "memory");
+	mailbox->head = next_head;
+
+	return 0;
+}
+
+
+/**
+ * Retrieves a message from a mailbox. Safe only from the consuming core.
+ */
+bool m0_mailbox_retrieve(struct m0_mailbox *mailbox, struct m0_mailbox_message *message)
+{
+	uint32_t tail = mailbox->tail;
+
+	if (tail == mailbox->head) {
+		return false;
+	}
+
+	*message = mailbox->messages[tail];
+
+	__asm__ volatile("dmb" ::: "memory");
+	mailbox->tail = (tail + 1) & (M0_MAILBOX_DEPTH - 1);
+
+	return true;
+}
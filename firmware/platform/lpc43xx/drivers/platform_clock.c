@@ -264,6 +264,89 @@ static const char *branch_clock_names[] = {
 		"usb0",        "usb1",      "spi",       "adchs",     "audio",     "usart3",     "usart2",      "uart1",
 		"usart0",      "ssp1",      "ssp0",      "sdio"};
 
+/**
+ * Memoized frequency caches for the base and branch clocks, so hot-path
+ * frequency queries (baud setup, timer reconfiguration, delay calibration)
+ * are a table read rather than a walk up the clock tree. Indexes match
+ * all_base_clocks / all_branch_clocks; a cached value of zero means "not
+ * yet computed". Entries are invalidated by the frequency-change handlers,
+ * which every reconfiguration path already notifies.
+ */
+static uint32_t base_clock_frequency_cache[ARRAY_SIZE(all_base_clocks)];
+static uint32_t branch_clock_frequency_cache[ARRAY_SIZE(all_branch_clocks)];
+
+
+/**
+ * @returns the cache index for the given base clock, or -1 if it has none
+ */
+static int platform_base_clock_cache_index(platform_base_clock_t *clock)
+{
+	for (unsigned i = 0; i < ARRAY_SIZE(all_base_clocks); ++i) {
+		if (all_base_clocks[i] == clock) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/**
+ * @returns the cache index for the given branch clock, or -1 if it has none
+ */
+static int platform_branch_clock_cache_index(platform_branch_clock_t *clock)
+{
+	for (unsigned i = 0; i < ARRAY_SIZE(all_branch_clocks); ++i) {
+		if (all_branch_clocks[i] == clock) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/**
+ * Drops any cached frequency for the given base clock.
+ */
+static void platform_invalidate_base_clock_frequency(platform_base_clock_t *clock)
+{
+	int index = platform_base_clock_cache_index(clock);
+
+	if (index >= 0) {
+		base_clock_frequency_cache[index] = 0;
+	}
+}
+
+
+/**
+ * Drops any cached frequency for the given branch clock.
+ */
+static void platform_invalidate_branch_clock_frequency(platform_branch_clock_t *clock)
+{
+	int index = platform_branch_clock_cache_index(clock);
+
+	if (index >= 0) {
+		branch_clock_frequency_cache[index] = 0;
+	}
+}
+
+
+/**
+ * Drops every cached clock frequency. Used when a clock source changes, as
+ * that can ripple to any clock in the tree -- including ones the
+ * change-notification walk skips because they're currently powered down.
+ */
+static void platform_invalidate_all_clock_frequencies(void)
+{
+	for (unsigned i = 0; i < ARRAY_SIZE(base_clock_frequency_cache); ++i) {
+		base_clock_frequency_cache[i] = 0;
+	}
+	for (unsigned i = 0; i < ARRAY_SIZE(branch_clock_frequency_cache); ++i) {
+		branch_clock_frequency_cache[i] = 0;
+	}
+}
+
 /**
  * Return a reference to the LPC43xx's CCU block.
  */
@@ -1212,6 +1295,21 @@ static int platform_ensure_main_xtal_is_up(void)
 		return 0;
 	}
 
+	// If the crt0 already started the oscillator (platform_begin_clock_bringup),
+	// its settle time has been elapsing while memory initialization and early
+	// setup ran. The microsecond timer came up strictly after the oscillator
+	// was enabled, so get_time() is a lower bound on the time it's had to
+	// settle -- wait only for whatever remains of the required 250us.
+	if (!cgu->xtal_control.disabled && !cgu->xtal_control.bypass) {
+		uint32_t elapsed = get_time();
+
+		if (elapsed < 250UL) {
+			delay_us(250UL - elapsed);
+		}
+
+		return platform_verify_source_frequency(CLOCK_SOURCE_XTAL_OSCILLATOR);
+	}
+
 	// Ensure we're not in bypass.
 	cgu->xtal_control.bypass = 0;
 
@@ -1230,6 +1328,29 @@ static int platform_ensure_main_xtal_is_up(void)
 	return platform_verify_source_frequency(CLOCK_SOURCE_XTAL_OSCILLATOR);
 }
 
+
+/**
+ * Kicks off the slow pieces of clock bring-up -- currently, starting the
+ * crystal oscillator's settle timer -- without waiting on any of them.
+ *
+ * Touches only hardware registers, so the crt0 can call this before .data
+ * and .bss exist; platform_ensure_main_xtal_is_up() later notices the
+ * oscillator is already running and waits only for the settle time that
+ * hasn't already overlapped with memory initialization.
+ */
+void platform_begin_clock_bringup(void)
+{
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+
+	// Ensure we're not in bypass; the barrier keeps this write separate from
+	// the enable, as the datasheet requires.
+	cgu->xtal_control.bypass = 0;
+	__sync_synchronize();
+
+	// Start the crystal oscillator; it settles while the crt0 works.
+	cgu->xtal_control.disabled = 0;
+}
+
 static int platform_ensure_rtc_xtal_is_up(void)
 {
 	// FIXME: Implement bringing up the RTC clock input.
@@ -1360,12 +1481,33 @@ static uint32_t set_source_for_generated_clock(clock_source_t source)
 }
 
 /**
- *
+ * A divider solution for the main PLL, as programmed into its registers.
+ * Solutions can be precomputed and cached (see the preset functions below),
+ * so retunes to known frequencies skip the solver and cost only the
+ * hardware's lock time.
  */
-static int platform_configure_main_pll_parameters(uint32_t target_frequency, uint32_t input_frequency)
-{
-	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+typedef struct {
+
+	// The output and input frequencies this solution is valid for, in Hz.
+	uint32_t target_frequency;
+	uint32_t input_frequency;
+
+	// Encoded (value - 1) divider settings.
+	uint32_t feedback_divisor_M;
+	uint32_t input_divisor_N;
+	uint32_t output_divisor_P;
+	bool bypass_output_divider;
+
+} platform_main_pll_parameters_t;
+
 
+/**
+ * Computes a main-PLL divider solution for the given target and input
+ * frequencies. Pure computation; doesn't touch the hardware.
+ */
+static int platform_compute_main_pll_parameters(uint32_t target_frequency, uint32_t input_frequency,
+	platform_main_pll_parameters_t *parameters)
+{
 	const uint32_t input_divisor_max = 3;
 	const uint32_t input_high_bound  = 25 * MHZ;
 	const uint32_t cco_low_bound     = 156 * MHZ;
@@ -1374,6 +1516,11 @@ static int platform_configure_main_pll_parameters(uint32_t target_frequency, uin
 	uint32_t output_divisor = 0;
 	uint32_t multiplier, rounding_offset;
 
+	// Record the frequencies this solution is being computed for, so cached
+	// solutions can be matched against future requests.
+	parameters->target_frequency = target_frequency;
+	parameters->input_frequency  = input_frequency;
+
 	// If the input frequency is too high, try to divide it down to something
 	// acceptable.
 	while (input_frequency > input_high_bound) {
@@ -1401,16 +1548,6 @@ static int platform_configure_main_pll_parameters(uint32_t target_frequency, uin
 		target_frequency *= 2;
 	}
 
-	// We can configure the PLL in either integer or non-integer mode by
-	// determining whether we use the output or oscillator clock to drive the PLL
-	// feedback. Using the output clock ("integer mode") gives us a more stable
-	// (lower jitter) clock, but using the output clock ("non-integer") gives us
-	// more granularity in frequency selection.
-	//
-	// For now, we'll allow non-integr modes, but we'll want to reconsider this to
-	// save power? TODO: do so!
-	cgu->pll1.use_pll_feedback = 0;
-
 	// Determine the multiplier for the PLL.
 	// We offset the target frequency first by half of the input frequency to
 	// round nicely.
@@ -1426,24 +1563,62 @@ static int platform_configure_main_pll_parameters(uint32_t target_frequency, uin
 			 input_divisor - 1, multiplier - 1, input_frequency);
 	}
 
-	// Program the PLL's various dividers, including the M-divider, which divides
-	// the PLL feedback path. (Dividing the feedback path means the PLL will need
-	// to push the CCO higher to compensate, so it effectively acts as a
-	// multiplier. See the LPC datasheet and any PLL documentation for theory
-	// info. W2AEW has a nice video.)
-	cgu->pll1.feedback_divisor_M = multiplier - 1;
-	cgu->pll1.input_divisor_N    = input_divisor - 1;
+	// Record the computed divider solution, including the M-divider, which
+	// divides the PLL feedback path. (Dividing the feedback path means the PLL
+	// will need to push the CCO higher to compensate, so it effectively acts
+	// as a multiplier. See the LPC datasheet and any PLL documentation for
+	// theory info. W2AEW has a nice video.)
+	parameters->feedback_divisor_M = multiplier - 1;
+	parameters->input_divisor_N    = input_divisor - 1;
 
-	// If we have an output divisor, use and program the output divisor.
-	if (output_divisor) {
-		cgu->pll1.output_divisor_P      = output_divisor - 1;
-		cgu->pll1.bypass_output_divider = 0;
+	// If we have an output divisor, record it; otherwise, it'll be bypassed,
+	// and we'll output the CCO frequency directly.
+	parameters->output_divisor_P      = output_divisor ? (output_divisor - 1) : 0;
+	parameters->bypass_output_divider = (output_divisor == 0);
+
+	return 0;
+}
+
+
+/**
+ * Programs a computed divider solution into the main PLL's registers.
+ */
+static void platform_apply_main_pll_parameters(const platform_main_pll_parameters_t *parameters)
+{
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+
+	// We can configure the PLL in either integer or non-integer mode by
+	// determining whether we use the output or oscillator clock to drive the PLL
+	// feedback. Using the output clock ("integer mode") gives us a more stable
+	// (lower jitter) clock, but using the output clock ("non-integer") gives us
+	// more granularity in frequency selection.
+	//
+	// For now, we'll allow non-integr modes, but we'll want to reconsider this to
+	// save power? TODO: do so!
+	cgu->pll1.use_pll_feedback = 0;
+
+	cgu->pll1.feedback_divisor_M    = parameters->feedback_divisor_M;
+	cgu->pll1.input_divisor_N       = parameters->input_divisor_N;
+	cgu->pll1.bypass_output_divider = parameters->bypass_output_divider;
+	if (!parameters->bypass_output_divider) {
+		cgu->pll1.output_divisor_P = parameters->output_divisor_P;
 	}
-	// Otherwise, bypass the output divisor and output the CCO frequency directly.
-	else {
-		cgu->pll1.bypass_output_divider = 1;
+}
+
+
+/**
+ * Computes and applies main-PLL parameters for the given frequencies.
+ */
+static int platform_configure_main_pll_parameters(uint32_t target_frequency, uint32_t input_frequency)
+{
+	platform_main_pll_parameters_t parameters;
+
+	int rc = platform_compute_main_pll_parameters(target_frequency, input_frequency, &parameters);
+	if (rc) {
+		return rc;
 	}
 
+	platform_apply_main_pll_parameters(&parameters);
 	return 0;
 }
 /**
@@ -1633,6 +1808,242 @@ static int platform_bring_up_main_pll(uint32_t frequency)
 	return 0;
 }
 
+
+/**
+ * Target frequencies to precompute main-PLL divider solutions for, in Hz,
+ * terminated by a zero. Boards that repeatedly switch between other sample
+ * clocks can override this list with their own favorites.
+ */
+ATTR_WEAK const uint32_t platform_main_pll_preset_frequencies[] = {
+	204 * MHZ, 102 * MHZ, 0
+};
+
+/** Cache of solved main-PLL configurations; see platform_main_pll_fast_switch. */
+#define MAIN_PLL_MAX_PRESETS 8
+static platform_main_pll_parameters_t main_pll_presets[MAIN_PLL_MAX_PRESETS];
+static unsigned main_pll_preset_count;
+
+
+/**
+ * Returns the cached divider solution for the given frequencies, solving and
+ * caching one if it's not yet known. Returns NULL if no solution exists, or
+ * if the preset cache is full.
+ */
+static platform_main_pll_parameters_t *platform_get_main_pll_preset(uint32_t target_frequency,
+	uint32_t input_frequency)
+{
+	platform_main_pll_parameters_t *preset;
+
+	// If we've already solved for these frequencies, use the cached solution.
+	for (unsigned i = 0; i < main_pll_preset_count; ++i) {
+		preset = &main_pll_presets[i];
+
+		if ((preset->target_frequency == target_frequency) &&
+				(preset->input_frequency == input_frequency)) {
+			return preset;
+		}
+	}
+
+	if (main_pll_preset_count == MAIN_PLL_MAX_PRESETS) {
+		pr_warning("clock: PLL preset cache is full; not caching %" PRIu32 " Hz\n", target_frequency);
+		return NULL;
+	}
+
+	// Otherwise, solve for the requested frequencies and cache the result.
+	preset = &main_pll_presets[main_pll_preset_count];
+	if (platform_compute_main_pll_parameters(target_frequency, input_frequency, preset)) {
+		return NULL;
+	}
+
+	main_pll_preset_count++;
+	return preset;
+}
+
+
+/**
+ * Solves and caches main-PLL configurations for each frequency listed in
+ * platform_main_pll_preset_frequencies, so later calls to
+ * platform_main_pll_fast_switch() pay only the hardware's lock time.
+ * Intended to be called once at startup, after the PLL's source is selected.
+ */
+void platform_main_pll_precompute_presets(void)
+{
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+	uint32_t input_frequency = platform_get_clock_source_frequency(cgu->pll1.source);
+
+	if (!input_frequency) {
+		pr_warning("clock: cannot precompute PLL presets; input frequency unknown\n");
+		return;
+	}
+
+	for (unsigned i = 0; platform_main_pll_preset_frequencies[i]; ++i) {
+		platform_get_main_pll_preset(platform_main_pll_preset_frequencies[i], input_frequency);
+	}
+}
+
+
+/**
+ * Retunes the main PLL to the given frequency using a precomputed divider
+ * solution, so the switch costs only the hardware's lock time -- no solver
+ * run, and no frequency-monitor verification. The PLL must have been brought
+ * up (and its source selected) via the standard path first.
+ *
+ * @param frequency The desired output frequency, in Hz.
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_main_pll_fast_switch(uint32_t frequency)
+{
+	const uint32_t pll_lock_timeout = 1000000;
+
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+	platform_clock_source_configuration_t *config   = &platform_clock_source_configurations[CLOCK_SOURCE_PLL1];
+
+	platform_main_pll_parameters_t *preset;
+	uint32_t input_frequency, time_base;
+
+	// If the PLL is already configured, we're done!
+	if (platform_clock_source_is_configured_at_frequency(CLOCK_SOURCE_PLL1, frequency)) {
+		return 0;
+	}
+
+	input_frequency = platform_get_clock_source_frequency(cgu->pll1.source);
+	preset = platform_get_main_pll_preset(frequency, input_frequency);
+	if (!preset) {
+		return EINVAL;
+	}
+
+	// Apply the cached solution, and wait for the PLL to re-lock.
+	config->up_and_okay = false;
+	config->frequency   = frequency;
+
+	cgu->pll1.block_during_frequency_changes = 1;
+	platform_apply_main_pll_parameters(preset);
+
+	time_base = get_time();
+	while (!cgu->pll1.locked) {
+		if (get_time_since(time_base) > pll_lock_timeout) {
+			pr_error("error: PLL lock timed out during fast switch!\n");
+			return ETIMEDOUT;
+		}
+	}
+
+	// Trust the precomputed solution rather than re-measuring; skipping the
+	// frequency monitor is part of what makes this path fast.
+	config->frequency_actual = frequency;
+	config->up_and_okay      = true;
+
+	platform_handle_clock_source_frequency_change(CLOCK_SOURCE_PLL1);
+	return 0;
+}
+
+
+//
+// Clock governor.
+//
+// Battery-powered deployments idle the M4 at tens of MHz and ramp to full
+// speed only while something -- a capture, a USB burst -- needs it. The
+// governor pairs one idle and one full-speed operating point, both validated
+// against the precomputed PLL preset table up front, so each transition is a
+// fast switch: no solver run, no frequency monitor, just the PLL's lock time.
+// Boost requests are counted, so independent drivers can hold the clock up
+// without coordinating with one another.
+//
+
+// The governor's two operating points; zero until the governor is configured.
+static uint32_t governor_idle_frequency;
+static uint32_t governor_full_frequency;
+
+// The number of outstanding boost requests.
+static volatile uint32_t governor_boost_count;
+
+
+/**
+ * Configures the clock governor; see <drivers/platform_clock.h>.
+ */
+int platform_clock_governor_configure(uint32_t idle_frequency, uint32_t full_frequency)
+{
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+	uint32_t input_frequency = platform_get_clock_source_frequency(cgu->pll1.source);
+
+	if (!idle_frequency || !full_frequency || (idle_frequency > full_frequency)) {
+		return EINVAL;
+	}
+
+	// Validate -- and cache, if they're not already in the preset table --
+	// divider solutions for both operating points, so neither transition
+	// can fail into the slow solver path later.
+	if (!platform_get_main_pll_preset(idle_frequency, input_frequency)) {
+		pr_error("error: clock: no PLL solution for %" PRIu32 " Hz idle point!\n", idle_frequency);
+		return EINVAL;
+	}
+	if (!platform_get_main_pll_preset(full_frequency, input_frequency)) {
+		pr_error("error: clock: no PLL solution for %" PRIu32 " Hz full-speed point!\n", full_frequency);
+		return EINVAL;
+	}
+
+	governor_idle_frequency = idle_frequency;
+	governor_full_frequency = full_frequency;
+	governor_boost_count    = 0;
+
+	// Start out idle; the first boost request ramps us up.
+	return platform_main_pll_fast_switch(idle_frequency);
+}
+
+
+/**
+ * Requests full-speed operation; see <drivers/platform_clock.h>.
+ */
+int platform_clock_governor_request_boost(void)
+{
+	if (!governor_full_frequency) {
+		return 0;
+	}
+
+	// The first outstanding request performs the ramp; the atomic increment
+	// decides who that is, so requests can arrive from interrupt context.
+	if (__atomic_add_fetch(&governor_boost_count, 1, __ATOMIC_ACQUIRE) == 1) {
+		return platform_main_pll_fast_switch(governor_full_frequency);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Releases a boost request; see <drivers/platform_clock.h>.
+ */
+int platform_clock_governor_release_boost(void)
+{
+	uint32_t remaining;
+	int rc;
+
+	if (!governor_full_frequency) {
+		return 0;
+	}
+
+	remaining = __atomic_sub_fetch(&governor_boost_count, 1, __ATOMIC_RELEASE);
+	if (remaining == UINT32_MAX) {
+		pr_warning("warning: clock: boost released more times than requested!\n");
+		governor_boost_count = 0;
+		return EINVAL;
+	}
+
+	if (remaining) {
+		return 0;
+	}
+
+	rc = platform_main_pll_fast_switch(governor_idle_frequency);
+
+	// If an interrupt requested a boost while we were ramping down, it lost
+	// the transition to us; honor its request now.
+	if (governor_boost_count) {
+		return platform_main_pll_fast_switch(governor_full_frequency);
+	}
+
+	return rc;
+}
+
+
 /**
  * @return an integer representing the likely-intended clock frequency for the
  * primary input source, in MHz.
@@ -1650,10 +2061,11 @@ static unsigned platform_identify_clock_frequency_mhz(clock_source_t source)
 }
 
 /**
- * Configure the USB PLL to produce the frequencies necessary to drive the
- * platform's various USB controllers.
+ * Configures the audio PLL and powers it on, without waiting for it to
+ * lock -- lock completion is handled by platform_finish_audio_pll_bringup(),
+ * so callers can overlap the lock time with other bring-up work.
  */
-static int platform_bring_up_audio_pll(void)
+static int platform_start_audio_pll(void)
 {
 	const uint32_t audio_pll_target = 26 * MHZ;
 
@@ -1662,12 +2074,7 @@ static int platform_bring_up_audio_pll(void)
 	const uint32_t n_divider_constant = 0;
 	const uint32_t p_divider_constant = 10;
 
-
-	// Time to wait for the  PLL to lock up.
-	const uint32_t pll_lock_timeout = 1000000; // 1 second; this should probably be made tweakable
-
 	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
-	uint32_t time_base;
 
 	// Get the clock that should be the basis for our frequency.
 	platform_clock_source_configuration_t *config = &platform_clock_source_configurations[CLOCK_SOURCE_PLL0_AUDIO];
@@ -1711,10 +2118,27 @@ static int platform_bring_up_audio_pll(void)
 	cgu->pll_audio.core.audio_use_fractional_divider = 1;
 	cgu->pll_audio.core.audio_power_down_delta_sigma= 1;
 
-	// Turn the PLL on...
+	// Turn the PLL on; it locks in the background, so the caller can do
+	// other work before waiting on it in platform_finish_audio_pll_bringup().
 	cgu->pll_audio.core.powered_down = 0;
+	return 0;
+}
 
-	// ... and wait for it to lock.
+
+/**
+ * Completes audio-PLL bring-up started by platform_start_audio_pll(),
+ * waiting for the PLL to lock and verifying its output.
+ */
+static int platform_finish_audio_pll_bringup(void)
+{
+	// Time to wait for the  PLL to lock up.
+	const uint32_t pll_lock_timeout = 1000000; // 1 second; this should probably be made tweakable
+
+	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+	platform_clock_source_configuration_t *config = &platform_clock_source_configurations[CLOCK_SOURCE_PLL0_AUDIO];
+	uint32_t time_base;
+
+	// Wait for the PLL to lock.
 	time_base = get_time();
 	while (!cgu->pll_audio.core.locked) {
 		if (get_time_since(time_base) > pll_lock_timeout) {
@@ -1731,6 +2155,20 @@ static int platform_bring_up_audio_pll(void)
 	return platform_verify_source_frequency(CLOCK_SOURCE_PLL0_AUDIO);
 }
 
+
+/**
+ * Configure the audio PLL, blocking until it's locked and verified.
+ */
+static int platform_bring_up_audio_pll(void)
+{
+	int rc = platform_start_audio_pll();
+	if (rc) {
+		return rc;
+	}
+
+	return platform_finish_audio_pll_bringup();
+}
+
 /**
  * Configure the USB PLL to produce the frequencies necessary to drive the platform's
  * various USB controllers.
@@ -1897,6 +2335,10 @@ static int platform_handle_dependencies_for_clock_source(clock_source_t source)
 static void platform_handle_clock_source_frequency_change(clock_source_t source)
 {
 	platform_clock_generation_register_block_t *cgu = get_platform_clock_generation_registers();
+
+	// A source change can ripple to any clock in the tree; drop every cached
+	// frequency, including those of clocks the walk below would skip.
+	platform_invalidate_all_clock_frequencies();
 	const clock_source_t dividers[] = {CLOCK_SOURCE_DIVIDER_A_OUT, CLOCK_SOURCE_DIVIDER_B_OUT, CLOCK_SOURCE_DIVIDER_C_OUT,
 						 CLOCK_SOURCE_DIVIDER_D_OUT, CLOCK_SOURCE_DIVIDER_E_OUT};
 
@@ -1933,20 +2375,71 @@ static void platform_handle_clock_source_frequency_change(clock_source_t source)
 	// which should be notified, here!
 }
 
+//
+// Frequency-change monitors.
+//
+// Drivers whose timing derives from a branch clock -- timers, baud-rate
+// generators, and the like -- register here, and are called back whenever
+// that clock's frequency may have changed, so they can recompute their
+// derived values instead of silently drifting.
+//
+
+// The most monitors that can be registered at once.
+#define CLOCK_FREQUENCY_MONITORS_MAX 8
+
+typedef struct {
+	platform_branch_clock_t *clock;
+	clock_frequency_callback_t callback;
+	void *context;
+} clock_frequency_monitor_t;
+
+static clock_frequency_monitor_t clock_frequency_monitors[CLOCK_FREQUENCY_MONITORS_MAX];
+static unsigned clock_frequency_monitor_count;
+
+
+/**
+ * Registers a frequency-change monitor; see <drivers/platform_clock.h>.
+ */
+int platform_register_clock_frequency_callback(platform_branch_clock_t *clock,
+		clock_frequency_callback_t callback, void *context)
+{
+	clock_frequency_monitor_t *monitor;
+
+	if (!clock || !callback) {
+		return EINVAL;
+	}
+	if (clock_frequency_monitor_count == CLOCK_FREQUENCY_MONITORS_MAX) {
+		pr_error("error: clock: out of frequency-monitor slots!\n");
+		return ENOMEM;
+	}
+
+	monitor = &clock_frequency_monitors[clock_frequency_monitor_count];
+	monitor->clock    = clock;
+	monitor->callback = callback;
+	monitor->context  = context;
+
+	// Publish the entry only once it's fully populated, in case a frequency
+	// change is being delivered concurrently.
+	++clock_frequency_monitor_count;
+	return 0;
+}
+
+
 /**
  * Handles any changes to a provided clock.
  */
 void platform_handle_branch_clock_frequency_change(platform_branch_clock_t *clock)
 {
-	platform_clock_control_register_block_t *ccu = get_platform_clock_control_registers();
+	// Drop the clock's cached frequency; it'll be recomputed on next query.
+	platform_invalidate_branch_clock_frequency(clock);
 
-	// TODO: allow downstream components to register monitors for base clock
-	// changes which should be notified, here!
+	// Notify any monitors watching this clock.
+	for (unsigned i = 0; i < clock_frequency_monitor_count; ++i) {
+		clock_frequency_monitor_t *monitor = &clock_frequency_monitors[i];
 
-	// FIXME: Don't hardcode this! This is just a shim until we have a proper
-	// callback system.
-	if (clock == &ccu->m4.timer3) {
-		handle_platform_timer_frequency_change();
+		if (monitor->clock == clock) {
+			monitor->callback(monitor->context);
+		}
 	}
 }
 
@@ -1955,6 +2448,8 @@ void platform_handle_branch_clock_frequency_change(platform_branch_clock_t *cloc
  */
 void platform_handle_base_clock_frequency_change(platform_base_clock_t *clock)
 {
+	// Drop the clock's cached frequency; it'll be recomputed on next query.
+	platform_invalidate_base_clock_frequency(clock);
 
 	// Notify any branch clocks that depend on us.
 	for (unsigned i = 0; i < ARRAY_SIZE(all_branch_clocks); ++i) {
@@ -2074,9 +2569,11 @@ void platform_enable_branch_clock(platform_branch_clock_register_t *clock, bool
 	clock->control.disable_when_bus_transactions_complete = 0;
 	clock->control.wake_after_powerdown                   = 0;
 
-	// If we're dividing by two, mark the divisor.
+	// If we're dividing by two, mark the divisor -- and drop any frequency
+	// we'd memoized with the old divisor.
 	if (platform_branch_clock_is_divideable(clock)) {
 		clock->control.divisor = divide_by_two ? 1 : 0;
+		platform_invalidate_branch_clock_frequency(clock);
 	}
 
 	// Finally, enable the given clock.
@@ -2137,6 +2634,94 @@ void platform_disable_branch_clock(platform_branch_clock_register_t *clock)
 	}
 }
 
+
+//
+// Reference-counted clock acquisition.
+//
+// Eagerly enabling branch clocks at board init -- and never gating them off
+// -- costs boot time and, on battery-powered units, standby power. Drivers
+// should instead acquire their branch at first use and release it on
+// teardown: the clock turns on at the first acquisition, stays on while
+// anyone holds it, and gates off (dropping its cached frequency, since a
+// re-enable may pick a different divisor) when the last holder releases.
+//
+
+/** Outstanding acquisitions per branch clock, parallel to all_branch_clocks. */
+static uint8_t branch_clock_acquisitions[ARRAY_SIZE(all_branch_clocks)];
+
+
+/**
+ * Acquires a branch clock, enabling it if this is the first outstanding
+ * acquisition. Each successful acquisition must eventually be balanced by a
+ * platform_release_branch_clock().
+ *
+ * @param clock The clock to acquire.
+ * @param divide_by_two True iff the clock should be divided by two, for clocks
+ *    that support division; ignored (with a warning) while other holders exist.
+ */
+void platform_acquire_branch_clock(platform_branch_clock_register_t *clock, bool divide_by_two)
+{
+	int index = platform_branch_clock_cache_index(clock);
+
+	// If we don't know this clock, we can't track it; fall back to plain
+	// enablement rather than losing the caller's intent.
+	if (index < 0) {
+		pr_warning("clock: acquiring unknown branch clock %p; cannot track it\n", clock);
+		platform_enable_branch_clock(clock, divide_by_two);
+		return;
+	}
+
+	if (branch_clock_acquisitions[index] == 0) {
+		platform_enable_branch_clock(clock, divide_by_two);
+	} else if (platform_branch_clock_is_divideable(clock) &&
+			(clock->control.divisor != (divide_by_two ? 1U : 0U))) {
+		pr_warning("clock: branch %s already held with a different divisor; keeping it\n",
+				platform_get_branch_clock_name(clock));
+	}
+
+	// Saturate rather than wrap, so a leak can't gate a clock that's in use.
+	if (branch_clock_acquisitions[index] < UINT8_MAX) {
+		branch_clock_acquisitions[index]++;
+	} else {
+		pr_warning("clock: branch %s acquisition count saturated; is someone leaking?\n",
+				platform_get_branch_clock_name(clock));
+	}
+}
+
+
+/**
+ * Releases a branch clock acquired with platform_acquire_branch_clock(),
+ * gating it off -- and dropping its cached frequency -- once the last
+ * outstanding acquisition is released.
+ *
+ * @param clock The clock to release.
+ */
+void platform_release_branch_clock(platform_branch_clock_register_t *clock)
+{
+	int index = platform_branch_clock_cache_index(clock);
+
+	// Clocks we couldn't track on acquisition we can't balance, either;
+	// mirror the acquire fallback with a plain disable.
+	if (index < 0) {
+		platform_disable_branch_clock(clock);
+		return;
+	}
+
+	if (branch_clock_acquisitions[index] == 0) {
+		pr_warning("clock: unbalanced release of branch %s; ignoring\n",
+				platform_get_branch_clock_name(clock));
+		return;
+	}
+
+	if (--branch_clock_acquisitions[index] == 0) {
+		platform_disable_branch_clock(clock);
+
+		// Drop the memoized frequency: by the time someone re-acquires us,
+		// the divisor -- or the base clock's setup -- may well differ.
+		platform_invalidate_branch_clock_frequency(clock);
+	}
+}
+
 /**
  * Default function that determines the primary clock source, which will drive
  * most of the major clocking sections of the device.
@@ -2241,12 +2826,25 @@ static uint32_t platform_base_clock_get_divisor(platform_base_clock_t *clock)
  */
 uint32_t platform_get_base_clock_frequency(platform_base_clock_t *clock)
 {
+	uint32_t source_frequency, divisor, frequency;
+
+	// If we have a memoized frequency for this clock, use it directly.
+	int cache_index = platform_base_clock_cache_index(clock);
+	if ((cache_index >= 0) && base_clock_frequency_cache[cache_index]) {
+		return base_clock_frequency_cache[cache_index];
+	}
+
 	// Find the frequency of the clock source, and our local divisor.
-	uint32_t source_frequency = platform_get_clock_source_frequency(clock->source);
-	uint32_t divisor          = platform_base_clock_get_divisor(clock);
+	source_frequency = platform_get_clock_source_frequency(clock->source);
+	divisor          = platform_base_clock_get_divisor(clock);
+	frequency        = source_frequency / divisor;
 
-	// Return the relevant clock frequency.
-	return source_frequency / divisor;
+	// Memoize the result, so subsequent queries are a table read.
+	if (cache_index >= 0) {
+		base_clock_frequency_cache[cache_index] = frequency;
+	}
+
+	return frequency;
 }
 
 /**
@@ -2254,8 +2852,9 @@ uint32_t platform_get_base_clock_frequency(platform_base_clock_t *clock)
  */
 uint32_t platform_get_branch_clock_frequency(platform_branch_clock_t *clock)
 {
-	uint32_t base_frequency;
+	uint32_t base_frequency, frequency;
 	uint32_t divisor = 1;
+	int cache_index;
 
 	// Find the base clock off of which the given clock is based.
 	platform_base_clock_register_t *base = platform_get_clock_base(clock);
@@ -2265,6 +2864,12 @@ uint32_t platform_get_branch_clock_frequency(platform_branch_clock_t *clock)
 		return 0;
 	}
 
+	// If we have a memoized frequency for this clock, use it directly.
+	cache_index = platform_branch_clock_cache_index(clock);
+	if ((cache_index >= 0) && branch_clock_frequency_cache[cache_index]) {
+		return branch_clock_frequency_cache[cache_index];
+	}
+
 	if (platform_branch_clock_is_divideable(clock)) {
 		divisor = clock->control.current_divisor + 1;
 	}
@@ -2273,7 +2878,14 @@ uint32_t platform_get_branch_clock_frequency(platform_branch_clock_t *clock)
 	base_frequency = platform_get_base_clock_frequency(base);
 
 	// Finally, return our base frequency, factoring in our clock's divisor.
-	return base_frequency / divisor;
+	frequency = base_frequency / divisor;
+
+	// Memoize the result, so subsequent queries are a table read.
+	if (cache_index >= 0) {
+		branch_clock_frequency_cache[cache_index] = frequency;
+	}
+
+	return frequency;
 }
 
 /**
@@ -2330,9 +2942,18 @@ void platform_initialize_early_clocks(void)
  */
 void platform_initialize_clocks(void)
 {
+	int audio_pll_started;
+
 	// Soft start the CPU clock.
 	platform_soft_start_cpu_clock();
 
+	// For now, set up PLL0AUDIO to generate 26MHz (a standard ULPI reference clock).
+	// We should really make this configurable.
+	//
+	// Start it before the branch-clock loop, so the PLL locks while we're
+	// busy enabling branch clocks, rather than while we spin idly.
+	audio_pll_started = platform_start_audio_pll();
+
 	// For now, enable all branch clocks. This also inherently configures the
 	// hardware necessary to generate the relevant clock. TODO: disable branch
 	// clocks here, instead, and let the downstream library users
@@ -2340,9 +2961,10 @@ void platform_initialize_clocks(void)
 		platform_enable_branch_clock(all_branch_clocks[i], false);
 	}
 
-	// For now, set up PLL0AUDIO to generate 26MHz (a standard ULPI reference clock).
-	// We should really make this configurable.
-	platform_bring_up_audio_pll();
+	// Collect the audio PLL, which should have locked (or come close) by now.
+	if (!audio_pll_started) {
+		platform_finish_audio_pll_bringup();
+	}
 
 	pr_info("System clock bringup complete.\n");
 }
@@ -6,8 +6,25 @@
 
 #include <toolchain.h>
 
+#include <debug.h>
+#include <errno.h>
+
 #include <drivers/dac.h>
 #include <drivers/platform_dac.h>
+#include <drivers/platform_clock.h>
+#include <drivers/platform_dma.h>
+
+/**
+ * The GPDMA request line that carries the DAC's conversion requests, and the
+ * DMA mux selection that routes the DAC onto it; see the DMAMUX table in the
+ * LPC43xx user manual.
+ */
+#define DAC_DMA_REQUEST_LINE   15
+#define DAC_DMA_MUX_SELECTION  3
+
+/** The GPDMA channel circulating playback data, or -1 when playback is idle. */
+static int dac_dma_channel = -1;
+
 
 platform_dac_registers_t *platform_get_dac_registers()
 {
@@ -27,3 +44,93 @@ void dac_set_value(dac_t *dac, uint32_t value)
 {
 	dac->reg->conversion_value = value;
 }
+
+
+/**
+ * Starts sample-rate-paced DMA into the DAC's conversion register; see
+ * <drivers/platform_dac.h>.
+ */
+int platform_dac_start_paced_dma(dac_t *dac, gpdma_linked_list_item_t *first_lli, uint32_t sample_rate)
+{
+	platform_clock_control_register_block_t *ccu = get_platform_clock_control_registers();
+	uint32_t dac_clock, divisor;
+	int channel, rc;
+
+	if (!sample_rate || (sample_rate > DAC_MAXIMUM_SAMPLE_RATE)) {
+		return EINVAL;
+	}
+	if (dac_dma_channel >= 0) {
+		return EBUSY;
+	}
+
+	// The DAC's timeout counter runs at its branch clock; figure out how many
+	// of its ticks make up one sample period.
+	dac_clock = platform_get_branch_clock_frequency(&ccu->apb3.dac);
+	divisor = (dac_clock + (sample_rate / 2)) / sample_rate;
+	if (!divisor || (divisor > 0xFFFF)) {
+		pr_error("dac: can't divide a %" PRIu32 " Hz clock down to %" PRIu32 " S/s!\n",
+				dac_clock, sample_rate);
+		return EINVAL;
+	}
+
+	gpdma_controller_enable();
+
+	channel = gpdma_claim_channel();
+	if (channel < 0) {
+		return EBUSY;
+	}
+
+	// Route the DAC's conversion requests onto its DMA request line.
+	gpdma_select_request_peripheral(DAC_DMA_REQUEST_LINE, DAC_DMA_MUX_SELECTION);
+
+	// Program the sample period, and switch the DAC into counter-paced DMA
+	// mode: each counter timeout requests the transfer of one sample.
+	dac->reg->counter_value = divisor - 1;
+	dac->reg->control_register = 0;
+	dac->reg->dma_timeout = 1;
+	dac->reg->dma_and_dac_enable = 1;
+
+	rc = gpdma_start_transfer(channel, first_lli,
+			0, DAC_DMA_REQUEST_LINE, GPDMA_FLOW_MEMORY_TO_PERIPHERAL);
+	if (rc) {
+		gpdma_release_channel(channel);
+		return rc;
+	}
+
+	dac_dma_channel = channel;
+	return 0;
+}
+
+
+/**
+ * Halts paced DMA playback, releasing its DMA channel; see
+ * <drivers/platform_dac.h>.
+ */
+void platform_dac_stop_paced_dma(dac_t *dac)
+{
+	if (dac_dma_channel < 0) {
+		return;
+	}
+
+	gpdma_release_channel(dac_dma_channel);
+	dac_dma_channel = -1;
+
+	// Take the DAC back out of counter-paced mode, leaving it set up for
+	// immediate conversions, as after platform_dac_init().
+	dac->reg->control_register = 0;
+	dac->reg->dma_and_dac_enable = 1;
+}
+
+
+/**
+ * @return the source address the playback DMA channel is currently reading
+ *     from, or 0 if playback isn't active
+ */
+uint32_t platform_dac_get_playback_position(void)
+{
+	if (dac_dma_channel < 0) {
+		return 0;
+	}
+
+	return platform_get_dma_registers()->channels[dac_dma_channel].source_address;
+}
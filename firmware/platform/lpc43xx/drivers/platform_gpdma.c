@@ -0,0 +1,346 @@
+/**
+ * Drivers for the LPC43xx third-party ("general purpose") DMA controller.
+ *
+ * This file is part of libgreat.
+ */
+
+#include <debug.h>
+#include <errno.h>
+#include <stddef.h>
+
+#include <drivers/platform_dma.h>
+#include <drivers/arm_vectors.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+/** Base address for the GPDMA controller's register bank. */
+#define GPDMA_REGISTER_BASE (0x40002000UL)
+
+/** Base address and offset for the CREG DMA mux register. */
+#define CREG_REGISTER_BASE  (0x40043000UL)
+#define CREG_DMAMUX_OFFSET  (0x11CUL)
+
+/** Maximum descriptors a single asynchronous copy may chain together. */
+#define GPDMA_COPY_MAX_LLIS 4
+
+/** Maximum transfers a single descriptor can carry (12-bit field). */
+#define GPDMA_MAX_TRANSFERS_PER_LLI 4095
+
+/** Bitmask of channels currently claimed by drivers. */
+static uint32_t claimed_channels;
+
+/** Completion callbacks for transfers started by gpdma_copy_async(). */
+static gpdma_completion_cb copy_callbacks[GPDMA_CHANNEL_COUNT];
+static void *copy_user_data[GPDMA_CHANNEL_COUNT];
+
+/** Descriptor chains for asynchronous copies, one chain per channel. */
+static gpdma_linked_list_item_t copy_llis[GPDMA_CHANNEL_COUNT][GPDMA_COPY_MAX_LLIS];
+
+/** True once our interrupt handler has been installed. */
+static bool gpdma_isr_installed;
+
+
+/**
+ * @return a reference to the GPDMA controller's registers
+ */
+platform_dma_registers_t *platform_get_dma_registers(void)
+{
+	return (platform_dma_registers_t *)GPDMA_REGISTER_BASE;
+}
+
+
+/**
+ * Enables the GPDMA controller's clock and the controller itself.
+ * Safe to call repeatedly.
+ */
+void gpdma_controller_enable(void)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+
+	reg->dma_controller_enabled = 1;
+
+	// Clear any stale interrupt state, so new transfers start clean.
+	reg->terminal_count_interrupt_clear = 0xFF;
+	reg->error_interrupt_clear = 0xFF;
+}
+
+
+/**
+ * Claims an unused GPDMA channel for the caller's exclusive use.
+ *
+ * @return the claimed channel number, or -1 if no channel was available
+ */
+int gpdma_claim_channel(void)
+{
+	// Lower-numbered channels have higher priority; hand out the highest
+	// free channel so latency-critical users can claim low ones explicitly
+	// in the future, and so default users don't hog priority.
+	//
+	// Claims race against releases from the DMA interrupt handler, so the
+	// scan-and-set must be atomic with respect to interrupts.
+	cm_disable_interrupts();
+	for (int channel = GPDMA_CHANNEL_COUNT - 1; channel >= 0; --channel) {
+		if (!(claimed_channels & (1 << channel))) {
+			claimed_channels |= (1 << channel);
+			cm_enable_interrupts();
+			return channel;
+		}
+	}
+	cm_enable_interrupts();
+
+	pr_warning("gpdma: no free DMA channels available!\n");
+	return -1;
+}
+
+
+/**
+ * Releases a channel claimed with gpdma_claim_channel(), halting it first
+ * if it's still active.
+ */
+void gpdma_release_channel(int channel)
+{
+	if ((channel < 0) || (channel >= GPDMA_CHANNEL_COUNT)) {
+		return;
+	}
+
+	gpdma_stop_transfer(channel);
+	claimed_channels &= ~(1 << channel);
+}
+
+
+/**
+ * Selects the peripheral routed to a given GPDMA request line, via the
+ * CREG DMA mux.
+ */
+void gpdma_select_request_peripheral(uint8_t request_line, uint8_t selection)
+{
+	volatile uint32_t *dmamux = (volatile uint32_t *)(CREG_REGISTER_BASE + CREG_DMAMUX_OFFSET);
+	uint32_t shift = request_line * 2;
+
+	*dmamux = (*dmamux & ~(0x3UL << shift)) | ((uint32_t)(selection & 0x3) << shift);
+}
+
+
+/**
+ * Starts a transfer described by a chain (or ring) of linked-list items on
+ * the given channel.
+ */
+int gpdma_start_transfer(int channel, gpdma_linked_list_item_t *first_lli,
+		uint8_t source_peripheral, uint8_t destination_peripheral, uint8_t flow_control)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+	gpdma_channel_registers_t *chan;
+
+	if ((channel < 0) || (channel >= GPDMA_CHANNEL_COUNT) || !first_lli) {
+		return EINVAL;
+	}
+
+	chan = &reg->channels[channel];
+
+	if (chan->enable) {
+		pr_warning("gpdma: tried to start a transfer on busy channel %d!\n", channel);
+		return EBUSY;
+	}
+
+	// Clear any pending interrupt state for this channel.
+	reg->terminal_count_interrupt_clear = (1 << channel);
+	reg->error_interrupt_clear = (1 << channel);
+
+	// Load the first descriptor into the channel registers; the controller
+	// follows next_lli for each subsequent descriptor on its own.
+	chan->source_address = first_lli->source_address;
+	chan->destination_address = first_lli->destination_address;
+	chan->linked_list_item = first_lli->next_lli;
+	chan->control = first_lli->control.all;
+
+	// Configure flow control and pacing, and fire off the transfer.
+	chan->config_all = 0;
+	chan->source_peripheral = source_peripheral;
+	chan->destination_peripheral = destination_peripheral;
+	chan->flow_control = flow_control;
+	chan->enable = 1;
+
+	return 0;
+}
+
+
+/**
+ * Halts any transfer active on the given channel.
+ */
+void gpdma_stop_transfer(int channel)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+	gpdma_channel_registers_t *chan;
+
+	if ((channel < 0) || (channel >= GPDMA_CHANNEL_COUNT)) {
+		return;
+	}
+	chan = &reg->channels[channel];
+
+	if (!chan->enable) {
+		return;
+	}
+
+	// Request a graceful halt -- the channel finishes any data in its
+	// FIFO -- and then disable it once it goes inactive.
+	chan->halt = 1;
+	while (chan->active);
+	chan->enable = 0;
+}
+
+
+/**
+ * @return true iff the given channel is currently transferring data
+ */
+bool gpdma_transfer_active(int channel)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+
+	if ((channel < 0) || (channel >= GPDMA_CHANNEL_COUNT)) {
+		return false;
+	}
+
+	return reg->channels[channel].enable;
+}
+
+
+/**
+ * Interrupt handler for the GPDMA controller: retires any channels that have
+ * finished (or failed) an asynchronous copy, releasing each channel before
+ * delivering its completion callback so the callback can start a new copy.
+ */
+static void gpdma_isr(void)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+
+	uint32_t completed = reg->terminal_count_interrupt_status;
+	uint32_t errored = reg->error_interrupt_status;
+
+	reg->terminal_count_interrupt_clear = completed;
+	reg->error_interrupt_clear = errored;
+
+	for (int channel = 0; channel < GPDMA_CHANNEL_COUNT; ++channel) {
+		gpdma_completion_cb callback;
+		void *user_data;
+		int status;
+
+		if (!((completed | errored) & (1 << channel))) {
+			continue;
+		}
+
+		callback = copy_callbacks[channel];
+		user_data = copy_user_data[channel];
+		status = (errored & (1 << channel)) ? EIO : 0;
+
+		// Only transfers started by gpdma_copy_async() register callbacks;
+		// channels driven directly (e.g. continuous capture rings) retain
+		// their claims and handle their own state.
+		if (!callback) {
+			continue;
+		}
+
+		copy_callbacks[channel] = NULL;
+		reg->channels[channel].enable = 0;
+		gpdma_release_channel(channel);
+
+		callback(user_data, status);
+	}
+}
+
+
+/**
+ * Starts an asynchronous memory-to-memory copy, claiming a free channel for
+ * its duration; the callback fires (from interrupt context) once the copy
+ * completes, and the channel is released automatically.
+ *
+ * @return 0 if the copy was started (or was trivially empty), EBUSY if no
+ *     channel was free, or EINVAL if the copy is too large to describe
+ */
+int gpdma_copy_async(void *destination, const void *source, uint32_t length,
+		gpdma_completion_cb completion_cb, void *user_data)
+{
+	gpdma_linked_list_item_t *llis;
+	uint32_t width, transfer_size;
+	uint32_t units, units_per_lli, lli_count;
+	int channel, rc;
+
+	if (!length) {
+		if (completion_cb) {
+			completion_cb(user_data, 0);
+		}
+		return 0;
+	}
+
+	// Copy a word at a time when everything's word-aligned; otherwise fall
+	// back to byte transfers.
+	if ((((uint32_t)destination | (uint32_t)source | length) & 3) == 0) {
+		width = GPDMA_WIDTH_WORD;
+		units = length / 4;
+	} else {
+		width = GPDMA_WIDTH_BYTE;
+		units = length;
+	}
+
+	// Refuse copies too large for our descriptor chains; the caller should
+	// fall back to memcpy().
+	if (units > (uint32_t)GPDMA_MAX_TRANSFERS_PER_LLI * GPDMA_COPY_MAX_LLIS) {
+		return EINVAL;
+	}
+
+	channel = gpdma_claim_channel();
+	if (channel < 0) {
+		return EBUSY;
+	}
+
+	// Lazily take over the DMA interrupt the first time we're used.
+	if (!gpdma_isr_installed) {
+		gpdma_isr_installed = true;
+		platform_set_interrupt_handler(DMA_IRQ, gpdma_isr);
+		platform_enable_interrupt(DMA_IRQ);
+	}
+
+	gpdma_controller_enable();
+
+	// Build the descriptor chain, splitting the copy into as few descriptors
+	// as possible; only the final descriptor interrupts.
+	llis = copy_llis[channel];
+	lli_count = (units + GPDMA_MAX_TRANSFERS_PER_LLI - 1) / GPDMA_MAX_TRANSFERS_PER_LLI;
+	units_per_lli = (units + lli_count - 1) / lli_count;
+
+	for (uint32_t i = 0; i < lli_count; ++i) {
+		uint32_t offset = i * units_per_lli * ((width == GPDMA_WIDTH_WORD) ? 4 : 1);
+		bool last = (i == lli_count - 1);
+
+		transfer_size = last ? (units - (i * units_per_lli)) : units_per_lli;
+
+		llis[i].source_address = (uint32_t)source + offset;
+		llis[i].destination_address = (uint32_t)destination + offset;
+		llis[i].next_lli = last ? 0 : (uint32_t)&llis[i + 1];
+		llis[i].control.all = 0;
+		llis[i].control.transfer_size = transfer_size;
+		llis[i].control.source_burst_size = GPDMA_BURST_4;
+		llis[i].control.destination_burst_size = GPDMA_BURST_4;
+		llis[i].control.source_transfer_width = width;
+		llis[i].control.destination_transfer_width = width;
+		llis[i].control.source_increment = 1;
+		llis[i].control.destination_increment = 1;
+		llis[i].control.terminal_count_interrupt = last;
+	}
+
+	copy_callbacks[channel] = completion_cb;
+	copy_user_data[channel] = user_data;
+
+	rc = gpdma_start_transfer(channel, llis, 0, 0, GPDMA_FLOW_MEMORY_TO_MEMORY);
+	if (rc) {
+		copy_callbacks[channel] = NULL;
+		gpdma_release_channel(channel);
+		return rc;
+	}
+
+	// Memory-to-memory transfers need terminal-count interrupts enabled at
+	// the channel level as well as in the final descriptor.
+	platform_get_dma_registers()->channels[channel].terminal_count_interrupt_enabled = 1;
+	platform_get_dma_registers()->channels[channel].error_interrupt_enabled = 1;
+
+	return 0;
+}
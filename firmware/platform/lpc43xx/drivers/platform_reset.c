@@ -4,6 +4,8 @@
  * LPC43xx reset generation/control driver
  */
 
+#include <errno.h>
+
 #include <drivers/reset.h>
 #include <drivers/platform_reset.h>
 #include <drivers/platform_config.h>
@@ -51,6 +53,51 @@ void platform_watchdog_feed(void)
 }
 
 
+/**
+ * Weak stub for the crash-telemetry hook; the fault_telemetry module's
+ * definition overrides it, so a watchdog expiry preserves a diagnosable
+ * snapshot from the warning interrupt before the reset lands. Without that
+ * module, supervision still resets -- just without the record.
+ */
+ATTR_WEAK void fault_telemetry_watch_watchdog(void)
+{
+}
+
+
+/**
+ * Arms the watchdog for liveness supervision; see <drivers/platform_reset.h>.
+ */
+int platform_watchdog_start(uint32_t timeout)
+{
+	// The watchdog counts at a quarter of the 12 MHz IRC -- three ticks
+	// per microsecond -- with a 24-bit timeout, capping us at ~5.5 seconds.
+	const uint32_t ticks_per_microsecond = 3;
+	const uint32_t maximum_timeout_ticks = (1 << 24) - 1;
+
+	platform_watchdog_register_block_t *wwdt = get_platform_watchdog_registers();
+	uint64_t timeout_ticks = (uint64_t)timeout * ticks_per_microsecond;
+
+	if (!timeout || (timeout_ticks > maximum_timeout_ticks)) {
+		return EINVAL;
+	}
+
+	// Fire the warning interrupt as early as the hardware allows (~340 us
+	// before the reset), and let crash telemetry -- if it's linked in --
+	// snapshot the wedged context from it.
+	wwdt->warning_threshold = 0x3ff;
+	fault_telemetry_watch_watchdog();
+
+	// Arm the watchdog proper. Once enabled, the hardware never allows it
+	// to be disabled again -- only fed.
+	wwdt->timeout = timeout_ticks;
+	wwdt->enable = 1;
+	wwdt->reset_enable = 1;
+	platform_watchdog_feed();
+
+	return 0;
+}
+
+
 /**
  * Reset everything including the always-on / RTC power domain.
  */
@@ -0,0 +1,393 @@
+/*
+ * This file is part of libgreat
+ *
+ * LPC43xx State Configurable Timer engine: table-driven pattern and PWM
+ * generation that runs with zero CPU involvement. See <drivers/sct.h>.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <debug.h>
+#include <drivers/sct.h>
+#include <drivers/platform_clock.h>
+
+// The tick frequency the counter was initialized to, or 0 when the engine
+// is shut down.
+static uint32_t sct_tick_frequency;
+
+// The PWM period, in ticks; 0 unless the engine is in PWM mode.
+static uint32_t sct_pwm_period_ticks;
+
+// Which events (and, pairwise, match registers) are claimed; event 0 is the
+// PWM period event, and channel events are handed out from the rest.
+static uint32_t sct_events_allocated;
+
+// The event claimed for each output's PWM channel, or 0 for none. (Event 0
+// is the period event, so it can double as the "none" sentinel.)
+static uint8_t sct_pwm_event_for_output[SCT_NUM_OUTPUTS];
+
+
+/**
+ * @returns a reference to the SCT's register block
+ */
+platform_sct_register_block_t *platform_get_sct_registers(void)
+{
+	// SCT base address.
+	return (platform_sct_register_block_t *)0x40000000;
+}
+
+
+/**
+ * Sets up the SCT, leaving it halted with empty tables; see <drivers/sct.h>.
+ */
+int platform_sct_initialize(uint32_t tick_frequency)
+{
+	platform_clock_control_register_block_t *ccu = get_platform_clock_control_registers();
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+	uint32_t base_frequency, divider;
+
+	if (!tick_frequency) {
+		return EINVAL;
+	}
+
+	// Bring up the SCT's clock, and see how far we need to divide it down.
+	platform_acquire_branch_clock(&ccu->m4.sct, false);
+	base_frequency = platform_get_branch_clock_frequency(&ccu->m4.sct);
+
+	divider = (base_frequency + (tick_frequency / 2)) / tick_frequency;
+	if (!divider || (divider > 256)) {
+		pr_error("sct: can't prescale a %" PRIu32 " Hz clock to %" PRIu32 " Hz ticks!\n",
+				base_frequency, tick_frequency);
+		platform_release_branch_clock(&ccu->m4.sct);
+		return EINVAL;
+	}
+
+	// Halt the counter, set its prescaler, and run the two halves as one
+	// 32-bit counter clocked from the bus.
+	sct->control = SCT_CONTROL_HALT | SCT_CONTROL_CLEAR_COUNT | SCT_CONTROL_PRESCALE(divider - 1);
+	sct->configuration = 0;
+	sct->use_both_halves_as_one = 1;
+
+	sct_tick_frequency = tick_frequency;
+	platform_sct_clear_tables();
+
+	return 0;
+}
+
+
+/**
+ * Halts the SCT and releases its clock; see <drivers/sct.h>.
+ */
+void platform_sct_shutdown(void)
+{
+	platform_clock_control_register_block_t *ccu = get_platform_clock_control_registers();
+
+	if (!sct_tick_frequency) {
+		return;
+	}
+
+	platform_sct_halt();
+	platform_sct_clear_tables();
+
+	platform_release_branch_clock(&ccu->m4.sct);
+	sct_tick_frequency = 0;
+}
+
+
+/**
+ * Clears the event, state, and output tables; see <drivers/sct.h>.
+ */
+void platform_sct_clear_tables(void)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+
+	platform_sct_halt();
+
+	for (unsigned i = 0; i < SCT_NUM_EVENTS; ++i) {
+		sct->event[i].state_mask = 0;
+		sct->event[i].control = 0;
+	}
+	for (unsigned i = 0; i < SCT_NUM_OUTPUTS; ++i) {
+		sct->output[i].set = 0;
+		sct->output[i].clear = 0;
+	}
+	for (unsigned i = 0; i < SCT_NUM_MATCHES; ++i) {
+		sct->match[i] = 0;
+		sct->match_reload[i] = 0;
+	}
+
+	// All registers operate as match registers; no events limit, stop, or
+	// start the counter until a configuration says so.
+	sct->register_modes = 0;
+	sct->limit = 0;
+	sct->stop = 0;
+	sct->start = 0;
+	sct->state = 0;
+	sct->raw_output = 0;
+
+	sct_pwm_period_ticks = 0;
+	sct_events_allocated = 0;
+	memset(sct_pwm_event_for_output, 0, sizeof(sct_pwm_event_for_output));
+}
+
+
+/**
+ * Programs one entry of the event table; see <drivers/sct.h>.
+ */
+int platform_sct_configure_event(unsigned event, const sct_event_config_t *config)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+	sct_event_control_t control = { .all = 0 };
+
+	if ((event >= SCT_NUM_EVENTS) || (config->match >= SCT_NUM_MATCHES)) {
+		return EINVAL;
+	}
+	if (config->next_state >= SCT_NUM_STATES) {
+		return EINVAL;
+	}
+
+	// Program the match value -- both the live register (writable while
+	// halted) and its reload, so the value survives the next limit.
+	sct->match[config->match] = config->match_value;
+	sct->match_reload[config->match] = config->match_value;
+
+	// Fire on the match alone, in the masked states...
+	control.match_number = config->match;
+	control.combine_mode = 1;
+
+	// ... moving to the next state, if the event changes it.
+	if (config->next_state >= 0) {
+		control.load_state = 1;
+		control.state_value = config->next_state;
+	}
+
+	sct->event[event].control = control.all;
+	sct->event[event].state_mask = config->state_mask;
+
+	// Wire the event into each output it drives...
+	for (unsigned output = 0; output < SCT_NUM_OUTPUTS; ++output) {
+		uint32_t bit = (1UL << output);
+
+		if (config->set_outputs & bit) {
+			sct->output[output].set |= (1UL << event);
+		}
+		if (config->clear_outputs & bit) {
+			sct->output[output].clear |= (1UL << event);
+		}
+	}
+
+	// ... and into the counter's limit set, if it ends a period.
+	if (config->limits_counter) {
+		sct->limit |= (1UL << event);
+	}
+
+	sct_events_allocated |= (1UL << event);
+	return 0;
+}
+
+
+/**
+ * Starts the counter from zero; see <drivers/sct.h>.
+ */
+void platform_sct_run(void)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+	uint32_t control = sct->control;
+
+	control |= SCT_CONTROL_CLEAR_COUNT;
+	control &= ~(SCT_CONTROL_HALT | SCT_CONTROL_STOP);
+	sct->control = control;
+}
+
+
+/**
+ * Halts the counter, freezing outputs; see <drivers/sct.h>.
+ */
+void platform_sct_halt(void)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+
+	sct->control |= SCT_CONTROL_HALT;
+}
+
+
+//
+// Multi-channel PWM.
+//
+// One match register (and event 0) defines the shared period: it fires in
+// every state, raises every active channel, and limits the counter. Each
+// channel then claims an event/match pair of its own, which lowers its
+// output when the counter reaches the channel's on-time. Duty updates go
+// through the reload registers, so they take effect at a period boundary.
+//
+
+/**
+ * Configures the engine for multi-channel PWM; see <drivers/sct.h>.
+ */
+int platform_sct_set_up_pwm(uint32_t pwm_frequency)
+{
+	uint32_t period_ticks;
+	sct_event_config_t period_event = {};
+
+	if (!sct_tick_frequency || !pwm_frequency) {
+		return EINVAL;
+	}
+
+	period_ticks = (sct_tick_frequency + (pwm_frequency / 2)) / pwm_frequency;
+	if (period_ticks < 2) {
+		pr_error("sct: a %" PRIu32 " Hz period doesn't fit %" PRIu32 " Hz ticks!\n",
+				pwm_frequency, sct_tick_frequency);
+		return EINVAL;
+	}
+
+	platform_sct_clear_tables();
+
+	// Event 0: the shared period. Channels add themselves to its set mask as
+	// their duty is first programmed.
+	period_event.match = 0;
+	period_event.match_value = period_ticks - 1;
+	period_event.state_mask = (1 << 0);
+	period_event.next_state = -1;
+	period_event.limits_counter = true;
+
+	sct_pwm_period_ticks = period_ticks;
+	return platform_sct_configure_event(0, &period_event);
+}
+
+
+/**
+ * Sets a PWM channel's on-time; see <drivers/sct.h>.
+ */
+int platform_sct_set_pwm_duty(unsigned output, uint32_t on_ticks)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+	unsigned event;
+
+	if ((output >= SCT_NUM_OUTPUTS) || !sct_pwm_period_ticks) {
+		return EINVAL;
+	}
+
+	// On the channel's first use, claim an event (and its match register) for it.
+	event = sct_pwm_event_for_output[output];
+	if (!event) {
+		sct_event_config_t duty_event = {};
+
+		for (event = 1; event < SCT_NUM_EVENTS; ++event) {
+			if (!(sct_events_allocated & (1UL << event))) {
+				break;
+			}
+		}
+		if (event == SCT_NUM_EVENTS) {
+			return EBUSY;
+		}
+
+		duty_event.match = event;
+		duty_event.match_value = on_ticks;
+		duty_event.state_mask = (1 << 0);
+		duty_event.next_state = -1;
+		duty_event.clear_outputs = (1 << output);
+
+		platform_sct_configure_event(event, &duty_event);
+		sct_pwm_event_for_output[output] = event;
+	}
+
+	// Degenerate duties can't be expressed as a set/clear pair -- the two
+	// matches would collide -- so pin the output instead: only the period
+	// event touches it, in the wanted direction.
+	if (on_ticks == 0) {
+		sct->output[output].set = 0;
+		sct->output[output].clear = (1UL << 0);
+	} else if (on_ticks >= sct_pwm_period_ticks) {
+		sct->output[output].set = (1UL << 0);
+		sct->output[output].clear = 0;
+	} else {
+		sct->output[output].set = (1UL << 0);
+		sct->output[output].clear = (1UL << event);
+	}
+
+	// Stage the new on-time; it loads when the period next limits the
+	// counter. If we're halted, load the live register too, so the first
+	// period doesn't run with a stale compare.
+	sct->match_reload[event] = on_ticks;
+	if (sct->control & SCT_CONTROL_HALT) {
+		sct->match[event] = on_ticks;
+	}
+
+	return 0;
+}
+
+
+//
+// Pattern sequencing.
+//
+// Step i of the pattern is state i: its event fires when the counter
+// reaches the step's duration, drives the step's outputs, resets the
+// counter, and moves to the next state -- so the whole sequence walks
+// itself with no CPU involvement. A non-repeating pattern's final event
+// also stops the counter.
+//
+
+/**
+ * Configures the engine as a pattern sequencer; see <drivers/sct.h>.
+ */
+int platform_sct_set_up_pattern(const sct_pattern_step_t *steps, unsigned count, bool repeat)
+{
+	platform_sct_register_block_t *sct = platform_get_sct_registers();
+	int rc;
+
+	if (!sct_tick_frequency || !count || (count > SCT_NUM_EVENTS)) {
+		return EINVAL;
+	}
+
+	platform_sct_clear_tables();
+
+	for (unsigned i = 0; i < count; ++i) {
+		sct_event_config_t event = {};
+		bool last = (i == (count - 1));
+
+		// Each step's outputs are driven as the step begins -- that is, by
+		// the previous step's event; the first step's levels are driven by
+		// the event that wraps (or would wrap) the sequence.
+		unsigned driven_by = (i == 0) ? (count - 1) : (i - 1);
+
+		event.match = i;
+		event.match_value = steps[i].duration ? (steps[i].duration - 1) : 0;
+		event.state_mask = (1 << i);
+		event.next_state = (i + 1) % count;
+		event.limits_counter = true;
+
+		rc = platform_sct_configure_event(i, &event);
+		if (rc) {
+			return rc;
+		}
+
+		// Retrofit the step's output drives onto the event that enters it.
+		// A one-shot pattern's first step has no entering event -- its levels
+		// come only from the preload below -- and its final event stops the
+		// counter with the last step's levels still driven.
+		if ((i > 0) || repeat) {
+			for (unsigned output = 0; output < SCT_NUM_OUTPUTS; ++output) {
+				uint32_t bit = (1UL << output);
+
+				if (steps[i].set_outputs & bit) {
+					sct->output[output].set |= (1UL << driven_by);
+				}
+				if (steps[i].clear_outputs & bit) {
+					sct->output[output].clear |= (1UL << driven_by);
+				}
+			}
+		}
+
+		// A one-shot pattern stops with its final event.
+		if (last && !repeat) {
+			sct->stop |= (1UL << i);
+		}
+	}
+
+	// The first step's levels have no prior event to drive them at startup,
+	// so preload them as the outputs' initial state.
+	sct->raw_output = steps[0].set_outputs & ~(uint32_t)steps[0].clear_outputs;
+
+	return 0;
+}
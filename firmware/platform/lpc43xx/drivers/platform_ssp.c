@@ -0,0 +1,131 @@
+/*
+ * This file is part of libgreat
+ *
+ * LPC43xx SSP (synchronous serial port) driver -- a simple, synchronous
+ * SPI-master interface.
+ */
+
+#include <debug.h>
+#include <errno.h>
+
+#include <drivers/platform_ssp.h>
+#include <drivers/platform_clock.h>
+
+// Frame format value selecting Motorola SPI framing.
+#define SSP_FRAME_FORMAT_SPI 0
+
+
+/**
+ * @return a reference to the given SSP controller's registers, or NULL for
+ *     an invalid controller number
+ */
+static platform_ssp_registers_t *get_ssp_registers(ssp_number_t number)
+{
+	switch (number) {
+		case SSP0: return (platform_ssp_registers_t *)0x40083000;
+		case SSP1: return (platform_ssp_registers_t *)0x400C5000;
+	}
+
+	pr_error("ssp: tried to set up a non-existant SSP %d!\n", number);
+	return NULL;
+}
+
+
+/**
+ * @return the branch clock that feeds the given SSP controller
+ */
+static platform_branch_clock_t *get_clock_for_ssp(ssp_number_t number)
+{
+	platform_clock_control_register_block_t *ccu = get_platform_clock_control_registers();
+
+	switch (number) {
+		case SSP0: return &ccu->ssp0;
+		case SSP1: return &ccu->ssp1;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Sets up an SSP controller as an SPI master; see <drivers/platform_ssp.h>.
+ */
+int ssp_init(ssp_t *ssp, ssp_number_t number, uint32_t clock_frequency, uint8_t data_bits)
+{
+	platform_branch_clock_t *clock;
+	uint32_t clock_input, prescale, rate;
+
+	if ((data_bits < 4) || (data_bits > 16) || !clock_frequency) {
+		return EINVAL;
+	}
+
+	ssp->number = number;
+	ssp->reg = get_ssp_registers(number);
+	if (!ssp->reg) {
+		return EINVAL;
+	}
+
+	clock = get_clock_for_ssp(number);
+	platform_acquire_branch_clock(clock, false);
+	clock_input = platform_get_branch_clock_frequency(clock);
+
+	// The serial clock is the branch clock divided by an even prescaler
+	// (2-254) and then by the rate field (1-256); find the smallest divisor
+	// pair that doesn't exceed the requested frequency.
+	for (prescale = 2; prescale <= 254; prescale += 2) {
+		rate = (clock_input + (prescale * clock_frequency) - 1) / (prescale * clock_frequency);
+		if (rate <= 256) {
+			break;
+		}
+	}
+	if ((prescale > 254) || !rate) {
+		pr_error("ssp: can't divide a %" PRIu32 " Hz clock down to %" PRIu32 " Hz!\n",
+				clock_input, clock_frequency);
+		return EINVAL;
+	}
+
+	// Configure and enable the controller: SPI mode 0, master.
+	ssp->reg->control1 = 0;
+	ssp->reg->clock_prescale_divisor = prescale;
+	ssp->reg->control0 = 0;
+	ssp->reg->data_size_minus_one = data_bits - 1;
+	ssp->reg->frame_format = SSP_FRAME_FORMAT_SPI;
+	ssp->reg->serial_clock_rate = rate - 1;
+	ssp->reg->enabled = 1;
+
+	return 0;
+}
+
+
+/**
+ * Performs a single full-duplex frame exchange, blocking until complete;
+ * see <drivers/platform_ssp.h>.
+ */
+uint16_t ssp_transfer(ssp_t *ssp, uint16_t value)
+{
+	while (!ssp->reg->transmit_fifo_not_full);
+	ssp->reg->data = value;
+
+	while (!ssp->reg->receive_fifo_not_empty);
+	return ssp->reg->data;
+}
+
+
+/**
+ * Transmits a sequence of frames back-to-back through the transmit FIFO,
+ * discarding anything received; see <drivers/platform_ssp.h>.
+ */
+void ssp_send_sync(ssp_t *ssp, const uint8_t *data, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		while (!ssp->reg->transmit_fifo_not_full);
+		ssp->reg->data = data[i];
+	}
+
+	// Wait for the final frame to finish shifting, and then discard whatever
+	// accumulated in the receive FIFO.
+	while (ssp->reg->busy);
+	while (ssp->reg->receive_fifo_not_empty) {
+		(void)ssp->reg->data;
+	}
+}
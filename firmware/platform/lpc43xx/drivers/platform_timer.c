@@ -5,12 +5,20 @@
  */
 
 
+#include <errno.h>
+#include <string.h>
+
 #include <debug.h>
 #include <drivers/timer.h>
 
 #include <drivers/arm_vectors.h>
 #include <drivers/platform_vectors.h>
 
+// Interrupt-pending/acknowledge bit positions: match channel n is bit n;
+// capture channel n is bit (4 + n).
+#define TIMER_PENDING_MATCH(n)   (1UL << (n))
+#define TIMER_PENDING_CAPTURE(n) (1UL << (4 + (n)))
+
 /**
  * Platform specific data for the LPC43xx timer.
  */
@@ -149,7 +157,7 @@ void platform_timer_initialize(hw_timer_t *timer, timer_index_t index)
 	timer->platform_data.irq = platform_get_irq_for_timer(index);
 
 	// ... and ensure the relevant clock is enabled.
-	platform_enable_branch_clock(timer->platform_data.clock, false);
+	platform_acquire_branch_clock(timer->platform_data.clock, false);
 
 	// Disable all match functionality by default.
 	timer->reg->match_control.all = 0;
@@ -259,6 +267,74 @@ uint32_t platform_timer_get_value(hw_timer_t *timer)
 
 
 
+//
+// 64-bit platform time.
+//
+// The platform timer's counter is 32 bits, so at a microsecond per tick it
+// wraps after ~71 minutes. We extend it by counting wraps: a match interrupt
+// at zero fires once per wrap and maintains the high word, and the 64-bit
+// read below stitches the two together without ever locking out interrupts.
+//
+
+/** High word of the 64-bit platform time: the number of 32-bit counter wraps. */
+static volatile uint32_t platform_timer_overflow_count;
+
+
+/**
+ * Frequency-change monitor for the platform timer's branch clock: when the
+ * clock tree retunes under us, recompute our prescaler so a tick stays a
+ * microsecond.
+ */
+static void platform_timer_clock_changed(void *context)
+{
+	(void)context;
+	handle_platform_timer_frequency_change();
+}
+
+
+/**
+ * Interrupt handler for the platform timer's wrap interrupt.
+ */
+static void platform_timer_overflow_isr(void)
+{
+	// Acknowledge the match...
+	platform_timer.reg->interrupt_pending.all = TIMER_PENDING_MATCH(3);
+
+	// ... and count the wrap it signals.
+	++platform_timer_overflow_count;
+}
+
+
+/**
+ * @returns the 64-bit microseconds count for the platform timer; coherent
+ *		and monotonic across counter wraps, and cheap enough to call from ISRs
+ */
+uint64_t platform_get_platform_timer_value_64(void)
+{
+	uint32_t high, low;
+	bool overflow_pending;
+
+	// Read the high word, the counter, and the wrap-pending flag; if the
+	// wrap interrupt ran mid-sequence, the high word changed under us, and
+	// we simply try again. (A retry can happen at most once per ~71 minutes.)
+	do {
+		high = platform_timer_overflow_count;
+		low = platform_timer.reg->value;
+		overflow_pending = platform_timer.reg->interrupt_pending.match3;
+	} while (high != platform_timer_overflow_count);
+
+	// If the counter has wrapped but the wrap interrupt hasn't been serviced
+	// yet -- say, we're in an ISR at or above the timer's priority -- account
+	// for the wrap ourselves. The low-half check keeps us from double-counting
+	// when the wrap instead happened just after we sampled the counter.
+	if (overflow_pending && (low < 0x80000000UL)) {
+		++high;
+	}
+
+	return (((uint64_t)high) << 32) | low;
+}
+
+
 /**
  * Sets up the system's platform timer.
  *
@@ -266,9 +342,29 @@ uint32_t platform_timer_get_value(hw_timer_t *timer)
  */
 hw_timer_t *platform_set_up_platform_timer(void)
 {
+	match_control_register_t match_control;
+
 	timer_in_use[platform_timer.number] = true;
 
 	timer_initialize(&platform_timer, platform_timer.number);
+
+	// Arm the match that maintains our 64-bit time's high word: matching at
+	// zero fires exactly once per counter wrap, and doesn't disturb the
+	// counter itself (no reset, no stop).
+	platform_timer.reg->match_value[3] = 0;
+	match_control = platform_timer.reg->match_control;
+	match_control.interrupt_on_match3 = true;
+	platform_timer.reg->match_control = match_control;
+
+	// Clear any stale match, and start taking wrap interrupts.
+	platform_timer.reg->interrupt_pending.all = TIMER_PENDING_MATCH(3);
+	vector_set_handler(platform_timer.platform_data.irq, platform_timer_overflow_isr);
+	platform_enable_interrupt(platform_timer.platform_data.irq);
+
+	// Track our driving clock, so our tick rate survives frequency changes.
+	platform_register_clock_frequency_callback(platform_timer.platform_data.clock,
+			platform_timer_clock_changed, NULL);
+
 	return &platform_timer;
 }
 
@@ -287,13 +383,21 @@ hw_timer_t *platform_get_platform_timer(void)
 }
 
 
+// Forward declaration: services any capture engine sharing the timer's interrupt.
+static void platform_timer_capture_service(hw_timer_t *timer);
+
+
 /**
  * Core timer interrupt handler.
  */
 static void timer_interrupt_handler(hw_timer_t *timer)
 {
+	// Drain the capture hardware first, so its timestamp isn't held hostage
+	// by however long the interval callback below takes.
+	platform_timer_capture_service(timer);
+
 	// Mark the relevant interrupt as serviced...
-	timer->reg->interrupt_pending.match0 = 1;
+	timer->reg->interrupt_pending.all = TIMER_PENDING_MATCH(0);
 
 	// ... and if we have an interval callback, call it.
 	if(timer->interval_callback) {
@@ -311,6 +415,9 @@ static void timer1_isr(void) { timer_interrupt_handler(timer_for_irq[1]); }
 static void timer2_isr(void) { timer_interrupt_handler(timer_for_irq[2]); }
 static void timer3_isr(void) { timer_interrupt_handler(timer_for_irq[3]); }
 
+// The trampoline to install for each timer's interrupt.
+static const interrupt_service_routine_t timer_isrs[] = {timer0_isr, timer1_isr, timer2_isr, timer3_isr};
+
 
 /**
  * Sets up a timer to handle any periodic callbacks associated with it.
@@ -318,14 +425,12 @@ static void timer3_isr(void) { timer_interrupt_handler(timer_for_irq[3]); }
  */
 uint32_t platform_schedule_periodic_callbacks(hw_timer_t *timer)
 {
-	interrupt_service_routine_t isrs[] = {timer0_isr, timer1_isr, timer2_isr, timer3_isr};
-
 	// Ensure our interrupt isn't active during our configuration.
 	platform_disable_interrupt(timer->platform_data.irq);
 
 	// ... set up the interrupt timing and handler...
 	platform_timer_set_interrupt_frequency(timer, timer->callback_frequency);
-	platform_set_interrupt_handler(timer->platform_data.irq, isrs[timer->number]);
+	platform_set_interrupt_handler(timer->platform_data.irq, timer_isrs[timer->number]);
 
 	// ... associate the timer with the IRQ...
 	timer_for_irq[timer->number] = timer;
@@ -346,3 +451,240 @@ uint32_t platform_cancel_periodic_callbacks(hw_timer_t *timer)
 {
 	platform_timer_disable(timer);
 }
+
+
+//
+// Hardware input capture.
+//
+// The capture interrupt timestamps each edge into a small per-timer ring;
+// everything interesting -- intervals, extrema, duty buckets -- is folded in
+// later, in batches, from thread mode. That keeps the per-edge cost to a
+// register read and a ring store, so fast signals can be measured without
+// saturating the CPU. The ring is strictly single-producer/single-consumer:
+// the ISR only ever advances the write side, the batch pass only the read
+// side, so no locking is needed between them.
+//
+
+// Capture control register layout: three bits per channel -- capture on
+// rising edge, capture on falling edge, and interrupt on capture.
+#define TIMER_CAPTURE_CHANNELS                (4)
+#define TIMER_CAPTURE_CONTROL_SHIFT(channel)  ((channel) * 3)
+#define TIMER_CAPTURE_CONTROL_MASK(channel)   (0x7UL << TIMER_CAPTURE_CONTROL_SHIFT(channel))
+#define TIMER_CAPTURE_CONTROL_INTERRUPT       (0x4UL)
+
+// Number of edge timestamps buffered between statistics batches.
+// Must be a power of two.
+#define TIMER_CAPTURE_RING_DEPTH              (128)
+
+
+/**
+ * Per-timer state for the capture engine.
+ */
+typedef struct {
+
+	// True while the engine is capturing; gates the shared timer ISR.
+	volatile bool active;
+
+	// The capture channel in use, and the edges it timestamps.
+	uint32_t channel;
+	timer_capture_edge_t edges;
+
+	// The timestamp ring itself: the capture ISR produces, the batch pass consumes.
+	uint32_t ring[TIMER_CAPTURE_RING_DEPTH];
+	volatile uint32_t write_index;
+	volatile uint32_t read_index;
+
+	// Interval state carried from one batch to the next.
+	bool have_previous;
+	uint32_t previous_timestamp;
+	uint32_t interval_parity;
+
+	// The statistics accumulated so far.
+	timer_capture_statistics_t statistics;
+
+} timer_capture_state_t;
+
+static timer_capture_state_t capture_state[SUPPORTED_TIMERS];
+
+
+/**
+ * Services a pending capture event on the given timer, if its engine is
+ * running. Called from the shared timer interrupt handler.
+ */
+static void platform_timer_capture_service(hw_timer_t *timer)
+{
+	timer_capture_state_t *state = &capture_state[timer->number];
+	uint32_t pending_bit = TIMER_PENDING_CAPTURE(state->channel);
+	uint32_t timestamp;
+
+	if (!state->active || !(timer->reg->interrupt_pending.all & pending_bit)) {
+		return;
+	}
+
+	// Latch the edge's timestamp, and acknowledge it.
+	timestamp = timer->reg->captured_value[state->channel];
+	timer->reg->interrupt_pending.all = pending_bit;
+
+	// Queue the timestamp for the next batch, if there's room -- and if there
+	// isn't, count the drop rather than stalling in interrupt context.
+	if ((state->write_index - state->read_index) < TIMER_CAPTURE_RING_DEPTH) {
+		state->ring[state->write_index % TIMER_CAPTURE_RING_DEPTH] = timestamp;
+		state->write_index++;
+	} else {
+		state->statistics.dropped_edges++;
+	}
+
+	state->statistics.total_edges++;
+}
+
+
+/**
+ * Starts a capture engine on the given timer; see <drivers/platform_timer.h>.
+ */
+int platform_timer_capture_start(hw_timer_t *timer, uint32_t channel, timer_capture_edge_t edges)
+{
+	timer_capture_state_t *state = &capture_state[timer->number];
+	uint32_t capture_control;
+
+	if (channel >= TIMER_CAPTURE_CHANNELS) {
+		pr_error("error: timer%d: no such capture channel %" PRIu32 "\n", timer->number, channel);
+		return EINVAL;
+	}
+	if (!(edges & TIMER_CAPTURE_EDGE_BOTH) || (edges & ~(uint32_t)TIMER_CAPTURE_EDGE_BOTH)) {
+		return EINVAL;
+	}
+
+	// The platform timer's interrupt belongs to the 64-bit time machinery;
+	// captures belong on a timer acquired from the pool.
+	if (timer == &platform_timer) {
+		return EBUSY;
+	}
+	if (state->active) {
+		return EBUSY;
+	}
+
+	// Start from a clean measurement.
+	memset(state, 0, sizeof(*state));
+	state->channel = channel;
+	state->edges = edges;
+
+	// Ensure our interrupt isn't active during our configuration.
+	platform_disable_interrupt(timer->platform_data.irq);
+
+	// Program the channel to capture the requested edge(s), interrupting on each...
+	capture_control = timer->reg->capture_control;
+	capture_control &= ~TIMER_CAPTURE_CONTROL_MASK(channel);
+	capture_control |= (edges | TIMER_CAPTURE_CONTROL_INTERRUPT) << TIMER_CAPTURE_CONTROL_SHIFT(channel);
+	timer->reg->capture_control = capture_control;
+
+	// ... discard any stale capture event...
+	timer->reg->interrupt_pending.all = TIMER_PENDING_CAPTURE(channel);
+
+	// ... and route the timer's interrupt to the shared handler. This is the
+	// same handler periodic callbacks use, so the two can share a timer.
+	platform_set_interrupt_handler(timer->platform_data.irq, timer_isrs[timer->number]);
+	timer_for_irq[timer->number] = timer;
+
+	state->active = true;
+
+	// Finally, start capturing.
+	platform_enable_interrupt(timer->platform_data.irq);
+	timer->reg->enabled = 1;
+
+	return 0;
+}
+
+
+/**
+ * Stops the capture engine on the given timer; see <drivers/platform_timer.h>.
+ */
+void platform_timer_capture_stop(hw_timer_t *timer)
+{
+	timer_capture_state_t *state = &capture_state[timer->number];
+
+	if (!state->active) {
+		return;
+	}
+
+	// Stop the channel from capturing or interrupting...
+	timer->reg->capture_control &= ~TIMER_CAPTURE_CONTROL_MASK(state->channel);
+	state->active = false;
+
+	// ... and if nothing else is using the timer's interrupt, quiesce it.
+	if (!timer->interval_callback) {
+		platform_disable_interrupt(timer->platform_data.irq);
+	}
+
+	// Fold in anything still waiting in the ring.
+	platform_timer_capture_update_statistics(timer);
+}
+
+
+/**
+ * Folds freshly-captured edges into the timer's statistics; see <drivers/platform_timer.h>.
+ */
+void platform_timer_capture_update_statistics(hw_timer_t *timer)
+{
+	timer_capture_state_t *state = &capture_state[timer->number];
+	timer_capture_statistics_t *statistics = &state->statistics;
+
+	// Drain every timestamp published so far. The ISR can keep producing
+	// behind us; it only ever touches the write side of the ring.
+	while (state->read_index != state->write_index) {
+		uint32_t timestamp = state->ring[state->read_index % TIMER_CAPTURE_RING_DEPTH];
+		state->read_index++;
+
+		if (state->have_previous) {
+
+			// Unsigned subtraction measures correctly across counter wraps.
+			uint32_t interval = timestamp - state->previous_timestamp;
+
+			if ((statistics->intervals_measured == 0) || (interval < statistics->min_interval_ticks)) {
+				statistics->min_interval_ticks = interval;
+			}
+			if (interval > statistics->max_interval_ticks) {
+				statistics->max_interval_ticks = interval;
+			}
+
+			statistics->total_interval_ticks += interval;
+			statistics->last_interval_ticks = interval;
+			statistics->intervals_measured++;
+
+			// Alternate buckets, so both-edge captures can recover duty cycle.
+			if (state->interval_parity) {
+				statistics->odd_interval_ticks += interval;
+			} else {
+				statistics->even_interval_ticks += interval;
+			}
+			state->interval_parity ^= 1;
+		}
+
+		state->previous_timestamp = timestamp;
+		state->have_previous = true;
+	}
+}
+
+
+/**
+ * @returns the capture statistics for the given timer; see <drivers/platform_timer.h>.
+ */
+timer_capture_statistics_t *platform_timer_capture_get_statistics(hw_timer_t *timer)
+{
+	return &capture_state[timer->number].statistics;
+}
+
+
+/**
+ * Resets the given timer's capture statistics; see <drivers/platform_timer.h>.
+ */
+void platform_timer_capture_reset_statistics(hw_timer_t *timer)
+{
+	timer_capture_state_t *state = &capture_state[timer->number];
+
+	memset(&state->statistics, 0, sizeof(state->statistics));
+
+	// Start interval measurement afresh: pairing the next edge with one from
+	// before the reset would produce a meaningless first interval.
+	state->have_previous = false;
+	state->interval_parity = 0;
+}
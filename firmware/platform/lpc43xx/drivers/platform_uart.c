@@ -138,7 +138,7 @@ int platform_uart_init(uart_t *uart)
 	}
 
 	// ... and ensure that it's on.
-	platform_enable_branch_clock(uart->platform_data.clock, false);
+	platform_acquire_branch_clock(uart->platform_data.clock, false);
 
 	// Connect our UART pins to the UART hardware.
 	platform_scu_configure_pin_uart(pins.tx.group, pins.tx.pin, pins.tx.function);
@@ -198,7 +198,7 @@ int platform_uart_set_up_interrupt(uart_t *uart)
 
 	// Enable the relevant interrupt in the NVIC.
 	irq_number = irq_numbers[uart->number];
-	vector_table.irqs[irq_number] = irq_handlers[uart->number];
+	vector_set_handler(irq_number, irq_handlers[uart->number]);
 	platform_enable_interrupt(irq_number);
 
 	return 0;
@@ -0,0 +1,231 @@
+/*
+ * This file is part of libgreat
+ *
+ * LPC43xx block-transfer (DMA) mode for the platform UART driver.
+ *
+ * In this mode, a GPDMA channel circulates received bytes directly into the
+ * UART's receive ring via a self-referencing descriptor, and a second channel
+ * drains the transmit ring in contiguous chunks -- so moving data costs a DMA
+ * burst rather than an interrupt per byte. Bytes that arrive and then sit
+ * below the receive FIFO's DMA trigger level are flushed by the character
+ * timeout ("idle line") interrupt, which bounds receive latency.
+ */
+
+#include <errno.h>
+#include <debug.h>
+
+#include <drivers/uart.h>
+#include <drivers/platform_dma.h>
+
+/**
+ * GPDMA request lines carrying each UART's transmit and receive requests.
+ * Each of these lines carries its UART request when its DMA mux selection is
+ * set to 1; see the DMAMUX table in the LPC43xx user manual.
+ */
+#define UART_DMA_MUX_SELECTION 1
+static const uint8_t uart_tx_request_lines[] = { 1, 3, 5, 7 };
+static const uint8_t uart_rx_request_lines[] = { 2, 4, 6, 8 };
+
+// Receive FIFO trigger level used in DMA mode: trigger level 2 requests a
+// DMA burst once eight characters have accumulated.
+#define UART_DMA_RX_TRIGGER_LEVEL 2
+#define UART_DMA_RX_BURST_SIZE    GPDMA_BURST_8
+
+
+/**
+ * Places the given UART into block-transfer (DMA) mode.
+ * Called through uart_enable_dma(); see uart.h.
+ */
+int platform_uart_enable_dma(uart_t *uart)
+{
+	platform_uart_t *dma = &uart->platform_data;
+
+	if (uart->dma_enabled) {
+		return 0;
+	}
+
+	// The DMA controller's transfer-size field is twelve bits wide; a larger
+	// receive buffer couldn't be covered by our circulating descriptor.
+	if (uart->buffer_size > 4095) {
+		return EINVAL;
+	}
+
+	gpdma_controller_enable();
+
+	// Claim a channel for each direction.
+	dma->rx_dma_channel = gpdma_claim_channel();
+	dma->tx_dma_channel = gpdma_claim_channel();
+	if ((dma->rx_dma_channel < 0) || (dma->tx_dma_channel < 0)) {
+		gpdma_release_channel(dma->rx_dma_channel);
+		gpdma_release_channel(dma->tx_dma_channel);
+		return EBUSY;
+	}
+
+	// Route this UART's requests onto its DMA request lines.
+	dma->rx_dma_request = uart_rx_request_lines[uart->number];
+	dma->tx_dma_request = uart_tx_request_lines[uart->number];
+	gpdma_select_request_peripheral(dma->rx_dma_request, UART_DMA_MUX_SELECTION);
+	gpdma_select_request_peripheral(dma->tx_dma_request, UART_DMA_MUX_SELECTION);
+
+	// Build the descriptor that circulates received data into the receive
+	// buffer; it points back to itself, so reception continues indefinitely
+	// with no processor involvement.
+	dma->rx_dma_lli = (gpdma_linked_list_item_t) {
+		.source_address      = (uint32_t)&uart->reg->receive_buffer,
+		.destination_address = (uint32_t)uart->rx_buffer.buffer,
+		.next_lli            = (uint32_t)&dma->rx_dma_lli,
+		.control = {
+			.transfer_size              = uart->buffer_size,
+			.source_burst_size          = UART_DMA_RX_BURST_SIZE,
+			.destination_burst_size     = UART_DMA_RX_BURST_SIZE,
+			.source_transfer_width      = GPDMA_WIDTH_BYTE,
+			.destination_transfer_width = GPDMA_WIDTH_BYTE,
+			.destination_increment      = 1,
+		},
+	};
+	dma->rx_dma_read_offset = 0;
+	dma->tx_dma_in_flight   = 0;
+
+	// Place the UART's FIFOs into DMA mode. The receive-data interrupt
+	// enable remains set from uart_init; in DMA mode, received data raises
+	// DMA requests instead, and that enable gates only the character
+	// timeout interrupt we use for idle-line flushes.
+	uart->reg->fifo_enabled              = 1;
+	uart->reg->rx_fifo_reset_in_progress = 1;
+	uart->reg->tx_fifo_reset_in_progress = 1;
+	uart->reg->use_dma                   = 1;
+	uart->reg->receive_trigger_level     = UART_DMA_RX_TRIGGER_LEVEL;
+
+	// Finally, start circulating received data.
+	int rc = gpdma_start_transfer(dma->rx_dma_channel, &dma->rx_dma_lli,
+			dma->rx_dma_request, 0, GPDMA_FLOW_PERIPHERAL_TO_MEMORY);
+	if (rc) {
+		gpdma_release_channel(dma->rx_dma_channel);
+		gpdma_release_channel(dma->tx_dma_channel);
+		return rc;
+	}
+
+	uart->dma_enabled = true;
+	return 0;
+}
+
+
+/**
+ * Flushes any received bytes waiting below the FIFO's DMA trigger level.
+ * Called from the UART's character timeout ("idle line") interrupt.
+ *
+ * Each software single request moves exactly one byte through the DMA
+ * channel, so the channel's destination pointer stays consistent with the
+ * data actually placed in the receive buffer.
+ */
+void platform_uart_dma_flush_rx(uart_t *uart)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+	uint32_t request_mask = (1 << uart->platform_data.rx_dma_request);
+
+	while (uart->reg->rx_data_ready) {
+		reg->software_single_request_bitmask = request_mask;
+		while (reg->software_single_request_bitmask & request_mask);
+	}
+}
+
+
+/**
+ * Reads received data out of the DMA-circulated receive buffer.
+ * Called through uart_read(); see uart.h.
+ *
+ * Note that, as with the interrupt-driven path, data is silently lost if the
+ * reader falls a full buffer behind the line.
+ */
+size_t platform_uart_dma_read(uart_t *uart, void *buffer, size_t count)
+{
+	platform_uart_t *dma = &uart->platform_data;
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+
+	uint8_t *byte_buffer = buffer;
+	size_t data_read = 0;
+
+	// The channel's destination pointer tells us exactly how far the DMA
+	// engine has written into our buffer.
+	uint32_t base = (uint32_t)uart->rx_buffer.buffer;
+	uint32_t write_offset =
+		(reg->channels[dma->rx_dma_channel].destination_address - base) % uart->buffer_size;
+
+	while ((data_read < count) && (dma->rx_dma_read_offset != write_offset)) {
+		byte_buffer[data_read++] = uart->rx_buffer.buffer[dma->rx_dma_read_offset];
+		dma->rx_dma_read_offset = (dma->rx_dma_read_offset + 1) % uart->buffer_size;
+	}
+
+	return data_read;
+}
+
+
+/**
+ * Starts a DMA drain of the next contiguous chunk of the transmit ring, if
+ * one isn't already running.
+ */
+static void uart_dma_kick_tx(uart_t *uart)
+{
+	platform_uart_t *dma = &uart->platform_data;
+	ringbuffer_t *ring = &uart->tx_buffer;
+	uint32_t offset, available, contiguous;
+
+	// If the previous chunk is still draining, the next write will retire
+	// it and pick up where it left off.
+	if (gpdma_transfer_active(dma->tx_dma_channel)) {
+		return;
+	}
+
+	// Retire any chunk that has finished draining.
+	ring->read_index += dma->tx_dma_in_flight;
+	dma->tx_dma_in_flight = 0;
+
+	available = ringbuffer_data_available(ring);
+	if (!available) {
+		return;
+	}
+
+	// Drain up to the end of the ring's backing store; if the data wraps,
+	// the wrapped portion will be picked up by the next kick.
+	offset = ring->read_index % ring->size;
+	contiguous = ring->size - offset;
+	if (contiguous > available) {
+		contiguous = available;
+	}
+
+	dma->tx_dma_lli = (gpdma_linked_list_item_t) {
+		.source_address      = (uint32_t)&ring->buffer[offset],
+		.destination_address = (uint32_t)&uart->reg->transmit_buffer,
+		.next_lli            = 0,
+		.control = {
+			.transfer_size              = contiguous,
+			.source_burst_size          = GPDMA_BURST_1,
+			.destination_burst_size     = GPDMA_BURST_1,
+			.source_transfer_width      = GPDMA_WIDTH_BYTE,
+			.destination_transfer_width = GPDMA_WIDTH_BYTE,
+			.source_increment           = 1,
+		},
+	};
+
+	dma->tx_dma_in_flight = contiguous;
+	gpdma_start_transfer(dma->tx_dma_channel, &dma->tx_dma_lli,
+			0, dma->tx_dma_request, GPDMA_FLOW_MEMORY_TO_PERIPHERAL);
+}
+
+
+/**
+ * Enqueues data into the transmit ring, and starts draining it via DMA.
+ * Called through uart_write(); see uart.h.
+ */
+size_t platform_uart_dma_write(uart_t *uart, const void *buffer, size_t count)
+{
+	const uint8_t *byte_buffer = buffer;
+	size_t written = 0;
+
+	while ((written < count) && !ringbuffer_full(&uart->tx_buffer)) {
+		ringbuffer_enqueue(&uart->tx_buffer, byte_buffer[written++]);
+	}
+
+	uart_dma_kick_tx(uart);
+	return written;
+}
@@ -99,6 +99,29 @@ void platform_scu_configure_pin_fast_io(uint8_t group, uint8_t pin, uint8_t func
 }
 
 
+/**
+ * Applies a table of pin configurations in a single pass.
+ *
+ * The SCU register bank is resolved once, and each entry then costs a single
+ * register write; this lets boards describe their full pin muxing in a const
+ * table in flash and apply it in microseconds at boot, and lets drivers
+ * re-mux whole buses (e.g. for SGPIO reconfiguration) without a function
+ * call per pin.
+ *
+ * @param table An array of pin-table entries; see SCU_PIN_TABLE_ENTRY and friends.
+ * @param count The number of entries in the table.
+ */
+void platform_scu_apply_pin_table(const platform_scu_pin_table_entry_t *table, size_t count)
+{
+	platform_scu_registers_t *scu = platform_get_scu_registers();
+
+	// Apply each entry's configuration to its pin.
+	for (size_t i = 0; i < count; ++i) {
+		scu->group[table[i].group].pin[table[i].pin] = table[i].configuration;
+	}
+}
+
+
 /**
  * Configures a given pin, applying the options that make the most sense for a common UART>
  *
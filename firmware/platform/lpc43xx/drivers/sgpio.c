@@ -1294,6 +1294,136 @@ int sgpio_enforce_all_shift_limits(sgpio_t *sgpio)
 
 
 
+// The SGPIO instance most recently configured; see sgpio_most_recently_configured().
+static sgpio_t *sgpio_last_configured;
+
+
+/**
+ * Dry-runs the validation checks for a single SGPIO function, without
+ * touching the hardware; mirrors the checks sgpio_set_up_function() and its
+ * helpers make while configuring.
+ *
+ * @param slices_in_use In/out: the mask of slices claimed by the functions
+ *     validated so far; this function adds the slices it would claim.
+ * @return 0 if the function is configurable, or an error code on failure
+ */
+static int sgpio_validate_function(sgpio_function_t *function, uint32_t *slices_in_use)
+{
+	uint8_t first_pin_number = function->pin_configurations[0].sgpio_pin;
+	int io_slice, direction_slice;
+
+	// Validate the bus width: widths of 3 and 5-7 are coerced upward (with
+	// a warning) at setup time, but anything beyond 8 bits is unmappable.
+	if (!function->bus_width || (function->bus_width > 8)) {
+		pr_error("sgpio: error: cannot create a %" PRIu8 "-bit bus!\n", function->bus_width);
+		return EINVAL;
+	}
+
+	// Validate that each of the function's pins can be routed to SGPIO.
+	for (unsigned i = 0; i < function->bus_width; ++i) {
+		sgpio_pin_configuration_t *pin_config = &function->pin_configurations[i];
+
+		if (pin_config->sgpio_pin >= SGPIO_NUM_PINS) {
+			pr_error("sgpio: error: SGPIO%u does not exist!\n", pin_config->sgpio_pin);
+			return EINVAL;
+		}
+		if (sgpio_get_scu_function_for_pin_config(pin_config) == 0xFF) {
+			pr_error("error: sgpio: couldn't figure out how to map SGPIO%u to P%u_%u\n",
+				pin_config->sgpio_pin, pin_config->scu_group, pin_config->scu_pin);
+			return EINVAL;
+		}
+	}
+
+	// Validate the slice the function's mode would claim.
+	switch (function->mode) {
+
+		case SGPIO_MODE_STREAM_BIDIRECTIONAL:
+			direction_slice = sgpio_slice_for_direction(first_pin_number, function->bus_width);
+			if (direction_slice < 0) {
+				return EINVAL;
+			}
+			if (*slices_in_use & (1 << direction_slice)) {
+				pr_error("sgpio: cannot configure SGPIO%d as bidirectional; the necessary"
+						" direction slice (slice %c) is in use!\n",
+						first_pin_number, direction_slice + 'A');
+				return EBUSY;
+			}
+			*slices_in_use |= (1 << direction_slice);
+
+			// falls through
+
+		case SGPIO_MODE_STREAM_DATA_IN:
+		case SGPIO_MODE_STREAM_DATA_OUT:
+		case SGPIO_MODE_FIXED_DATA_OUT:
+			io_slice = sgpio_slice_for_io(first_pin_number);
+			break;
+
+		case SGPIO_MODE_CLOCK_GENERATION:
+			io_slice = sgpio_slice_for_clockgen(first_pin_number);
+			break;
+
+		default:
+			pr_error("sgpio: error: SGPIO mode %d not yet implemented!\n", function->mode);
+			return ENOSYS;
+	}
+
+	if (io_slice < 0) {
+		return EINVAL;
+	}
+	if (*slices_in_use & (1 << io_slice)) {
+		pr_error("sgpio: cannot configure SGPIO%d; its I/O slice (slice %c) is in use!\n",
+				first_pin_number, io_slice + 'A');
+		return EBUSY;
+	}
+	*slices_in_use |= (1 << io_slice);
+
+	// Validate that externally-sourced clocks and qualifiers come with the
+	// pin configurations they require.
+	if (((function->shift_clock_source & SGPIO_CLOCK_SOURCE_TYPE_MASK) == SGPIO_CLOCK_SOURCE_TYPE_PIN)
+			&& !function->shift_clock_input) {
+		pr_error("error: sgpio configuration specifies an external clock; but does not define its pin!\n");
+		return EINVAL;
+	}
+	if (((function->shift_clock_qualifier & SGPIO_QUALIFIER_TYPE_MASK) == SGPIO_QUALIFIER_TYPE_PIN)
+			&& !function->shift_clock_qualifier_input) {
+		pr_error("error: sgpio configuration specifies an external clock qualifier; but does not define its pin!\n");
+		return EINVAL;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Dry-runs the validation checks for an SGPIO instance's whole function set;
+ * see <drivers/sgpio.h>.
+ */
+int sgpio_validate_functions(sgpio_t *sgpio)
+{
+	uint32_t slices_in_use = 0;
+	int rc;
+
+	sgpio->functions_validated = false;
+
+	for (unsigned i = 0; i < sgpio->function_count; ++i) {
+		sgpio_function_t *function = &sgpio->functions[i];
+
+		if (!function->enabled) {
+			continue;
+		}
+
+		rc = sgpio_validate_function(function, &slices_in_use);
+		if (rc) {
+			pr_error("error: sgpio: function %u failed validation (%d)!\n", i, rc);
+			return rc;
+		}
+	}
+
+	sgpio->functions_validated = true;
+	return 0;
+}
+
+
 /**
  * Sets up an SGPIO instance to run a provided set of functions.
  *
@@ -1310,6 +1440,16 @@ int sgpio_set_up_functions(sgpio_t *sgpio)
 	reset_select_t reset_select = { .sgpio_reset = 1};
 	int rc;
 
+	// Validate the function set up front, unless a previous pass has already
+	// vouched for it -- so repeated reconfiguration of a known-good set
+	// (e.g. re-arming a capture in production) skips the checking entirely.
+	if (!sgpio->functions_validated) {
+		rc = sgpio_validate_functions(sgpio);
+		if (rc) {
+			return rc;
+		}
+	}
+
 	// Bring the SGPIO peripheral back to its clean state.
 	reset->reset_control = reset_select;
 
@@ -1379,9 +1519,21 @@ int sgpio_set_up_functions(sgpio_t *sgpio)
 	}
 	pr_debug("sgpio: ISR generation complete.\n");
 
+	// Remember the instance, for the host-triggered configuration dump.
+	sgpio_last_configured = sgpio;
+
 	return 0;
 }
 
+
+/**
+ * @return the SGPIO instance most recently configured, or NULL; see <drivers/sgpio.h>
+ */
+sgpio_t *sgpio_most_recently_configured(void)
+{
+	return sgpio_last_configured;
+}
+
 // TODO: implement these!
 
 
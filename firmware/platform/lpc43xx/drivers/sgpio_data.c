@@ -11,8 +11,11 @@
 #include <debug.h>
 #include <errno.h>
 
+#include <drivers/scu.h>
 #include <drivers/sgpio.h>
+#include <drivers/timer.h>
 #include <drivers/arm_vectors.h>
+#include <drivers/platform_reset.h>
 
 // FIXME: this currently sets up a single ISR, but that's not appropriate for any setup where different slices
 // can update at different rates. We should assume the template is _copied_ each time, so we can set up multiple
@@ -29,6 +32,9 @@
 int sgpio_slice_for_io(uint8_t pin);
 int sgpio_io_pin_for_slice(uint8_t slice);
 
+// Installs a generated data ISR, applying the buffer-watermark shim if needed; defined below.
+static void sgpio_install_data_isr(sgpio_t *sgpio, interrupt_service_routine_t isr);
+
 /**
  * Bitfield structure that describes an THUMB load/store with immediate offset.
  * Used to generate machine code.
@@ -606,9 +612,444 @@ int sgpio_generate_data_shuttle_isr(sgpio_t *sgpio)
 	// If we have a data ISR, install it as our interrupt handler.
 	if(master_isr) {
 		pr_debug("sgpio: installing interrupt handler at %p\n", master_isr);
-		platform_set_interrupt_handler(SGPIO_IRQ, master_isr);
+		sgpio_install_data_isr(sgpio, master_isr);
+	}
+
+	return 0;
+}
+
+
+//
+// Buffer watermark / timestamping layer.
+//
+// The generated ISR above still services every shadow-register exchange --
+// the hardware demands it -- but consumers usually don't want to: at high
+// shift rates, doing downstream work (USB submissions, processing) per
+// exchange drops samples. When any function carries a watermark, we wrap the
+// generated ISR in a thin shim that watches each function's fill count and
+// only notifies the consumer when its configured level is crossed, so the
+// expensive work happens in fewer, larger batches.
+//
+// The same shim carries the optional timestamp stream: pairing each serviced
+// exchange with a reading of the free-running platform timer here, right in
+// the copy path, costs a couple of loads per exchange -- where reconstructing
+// timing from host-side arrival times is hopeless.
+//
+// Finally, the shim hosts the capture trigger engine: while a function's
+// trigger is armed, the shim scans the bytes each exchange just committed
+// for the configured condition, and -- once the post-trigger fill is in --
+// halts capture, leaving the ring holding a frozen window around the event.
+// Checking in the copy path, rather than via a separate pin interrupt,
+// means the trigger sees exactly the sampled data stream: no clock-domain
+// skew between what fired the trigger and what lands in the window.
+//
+
+// The generated data ISR currently installed, and the SGPIO object it
+// services; used by the data shim.
+static interrupt_service_routine_t sgpio_active_data_isr;
+static sgpio_t *sgpio_active_object;
+
+
+/**
+ * @return true iff any of the object's enabled functions needs the data shim
+ *    -- that is, has a watermark, a timestamp stream, or a live trigger
+ */
+static bool sgpio_data_shim_in_use(sgpio_t *sgpio)
+{
+	for (unsigned i = 0; i < sgpio->function_count; ++i) {
+		sgpio_function_t *function = &sgpio->functions[i];
+
+		if (!function->enabled) {
+			continue;
+		}
+		if (function->watermark_level || function->timestamp_buffer) {
+			return true;
+		}
+		if ((function->trigger_state == SGPIO_TRIGGER_ARMED) ||
+				(function->trigger_state == SGPIO_TRIGGER_FIRED)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/**
+ * Scans the bytes the current exchange added to the given function's ring
+ * for its trigger condition, and tracks the post-trigger fill once it fires.
+ *
+ * Runs per exchange, so the unscanned span is at most one exchange's worth
+ * of data -- far smaller than the ring, which keeps the wrapped-delta
+ * position arithmetic unambiguous.
+ *
+ * @return true iff the capture window has just completed
+ */
+static bool ATTR_HOT_RAM sgpio_trigger_scan(sgpio_function_t *function)
+{
+	uint8_t *data             = function->buffer;
+	uint32_t buffer_mask      = (1UL << function->buffer_order) - 1;
+	uint32_t scan_position    = function->trigger_scan_position;
+	uint32_t new_bytes        = (function->position_in_buffer - scan_position) & buffer_mask;
+	uint8_t previous          = function->trigger_previous_byte;
+	bool have_previous        = function->trigger_have_previous;
+
+	while (new_bytes--) {
+		uint8_t sample = data[scan_position];
+		scan_position = (scan_position + 1) & buffer_mask;
+
+		// While armed, check this byte against the configured condition.
+		if (function->trigger_state == SGPIO_TRIGGER_ARMED) {
+			bool fired = false;
+
+			switch (function->trigger_mode) {
+				case SGPIO_TRIGGER_RISING_EDGE:
+					fired = have_previous && ((~previous & sample) & function->trigger_mask);
+					break;
+				case SGPIO_TRIGGER_FALLING_EDGE:
+					fired = have_previous && ((previous & ~sample) & function->trigger_mask);
+					break;
+				case SGPIO_TRIGGER_PATTERN:
+					fired = ((sample & function->trigger_mask) == function->trigger_value);
+					break;
+				default:
+					break;
+			}
+
+			previous = sample;
+			have_previous = true;
+
+			if (fired) {
+				function->trigger_fire_total = function->trigger_bytes_seen;
+				function->trigger_state = SGPIO_TRIGGER_FIRED;
+			}
+		}
+
+		function->trigger_bytes_seen++;
+
+		// Once the trigger has fired, we're just counting down the
+		// post-trigger fill; stop as soon as it's complete, so any bytes
+		// beyond it can't wrap around and clobber the pre-trigger data.
+		if ((function->trigger_state == SGPIO_TRIGGER_FIRED) &&
+				((function->trigger_bytes_seen - function->trigger_fire_total) >
+				 function->trigger_post_bytes)) {
+
+			function->trigger_scan_position = scan_position;
+			function->trigger_previous_byte = previous;
+			function->trigger_have_previous = have_previous;
+			function->trigger_state = SGPIO_TRIGGER_COMPLETE;
+			return true;
+		}
+	}
+
+	function->trigger_scan_position = scan_position;
+	function->trigger_previous_byte = previous;
+	function->trigger_have_previous = have_previous;
+	return false;
+}
+
+
+/**
+ * Data shim: runs the generated copy code, then records timestamps, advances
+ * any live capture triggers, and fires the watermark callback for any
+ * function whose fill count just crossed its level.
+ */
+static void ATTR_HOT_RAM sgpio_data_shim_isr(void)
+{
+	sgpio_t *sgpio = sgpio_active_object;
+
+	// Shuttle this exchange's data, exactly as without the shim.
+	sgpio_active_data_isr();
+
+	// Capture the exchange's timestamp once, outside the per-function loop.
+	uint32_t time = get_time();
+
+	for (unsigned i = 0; i < sgpio->function_count; ++i) {
+		sgpio_function_t *function = &sgpio->functions[i];
+		bool above;
+
+		if (!function->enabled) {
+			continue;
+		}
+
+		// If this function carries a timestamp stream, record when this chunk
+		// of the data stream was committed.
+		if (function->timestamp_buffer) {
+			sgpio_timestamp_entry_t *entry = &function->timestamp_buffer[
+					function->timestamp_write_index % function->timestamp_buffer_entries];
+
+			entry->fill_count = function->data_in_buffer;
+			entry->time = time;
+			function->timestamp_write_index++;
+		}
+
+		// If this function carries a live capture trigger, scan the bytes
+		// this exchange committed; once the window completes, freeze it by
+		// halting capture and hand it to the consumer.
+		if ((function->trigger_state == SGPIO_TRIGGER_ARMED) ||
+				(function->trigger_state == SGPIO_TRIGGER_FIRED)) {
+			if (sgpio_trigger_scan(function)) {
+				sgpio_halt(sgpio);
+				if (function->trigger_callback) {
+					function->trigger_callback(function->trigger_user_data);
+				}
+			}
+		}
+
+		if (!function->watermark_level) {
+			continue;
+		}
+
+		// Notify only on the upward crossing; the consumer re-arms us by
+		// decrementing data_in_buffer as it drains the ring.
+		above = (function->data_in_buffer >= function->watermark_level);
+		if (above && !function->watermark_above && function->watermark_callback) {
+			function->watermark_callback(function->watermark_user_data);
+		}
+		function->watermark_above = above;
+	}
+}
+
+
+/**
+ * Installs the given generated ISR -- directly, or behind the data shim if
+ * any of the object's functions wants watermark notifications or timestamps.
+ */
+static void sgpio_install_data_isr(sgpio_t *sgpio, interrupt_service_routine_t isr)
+{
+	sgpio_active_data_isr = isr;
+	sgpio_active_object = sgpio;
+
+	platform_set_interrupt_handler(SGPIO_IRQ,
+			sgpio_data_shim_in_use(sgpio) ? sgpio_data_shim_isr : isr);
+}
+
+
+/**
+ * Re-evaluates whether a live generated ISR needs the data shim, swapping it
+ * in or out to match the object's current configuration.
+ */
+static void sgpio_update_data_shim(sgpio_t *sgpio)
+{
+	if ((sgpio_active_object == sgpio) && sgpio_active_data_isr) {
+		platform_set_interrupt_handler(SGPIO_IRQ,
+				sgpio_data_shim_in_use(sgpio) ? sgpio_data_shim_isr : sgpio_active_data_isr);
+	}
+}
+
+
+/**
+ * Sets (or, with a level of zero, clears) a buffer watermark for one of the
+ * object's functions; see sgpio.h for the semantics.
+ *
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_set_buffer_watermark(sgpio_t *sgpio, unsigned function_index,
+		uint32_t watermark_bytes, void (*callback)(void *user_data), void *user_data)
+{
+	sgpio_function_t *function;
+
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
+	}
+
+	function = &sgpio->functions[function_index];
+	function->watermark_callback = callback;
+	function->watermark_user_data = user_data;
+	function->watermark_above = false;
+	function->watermark_level = watermark_bytes;
+
+	// If this object's generated ISR is already live, swap the data shim
+	// in (or out) to match the new configuration.
+	sgpio_update_data_shim(sgpio);
+
+	return 0;
+}
+
+
+/**
+ * Enables timestamping for one of the object's functions; see sgpio.h for
+ * the semantics.
+ *
+ * @return 0 on success, or EINVAL for a bad function index or empty buffer
+ */
+int sgpio_enable_timestamping(sgpio_t *sgpio, unsigned function_index,
+		sgpio_timestamp_entry_t *buffer, uint32_t buffer_entries)
+{
+	sgpio_function_t *function;
+
+	if ((function_index >= sgpio->function_count) || !buffer || !buffer_entries) {
+		return EINVAL;
+	}
+
+	function = &sgpio->functions[function_index];
+	function->timestamp_write_index = 0;
+	function->timestamp_buffer_entries = buffer_entries;
+	function->timestamp_buffer = buffer;
+
+	sgpio_update_data_shim(sgpio);
+	return 0;
+}
+
+
+/**
+ * Disables timestamping for one of the object's functions.
+ *
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_disable_timestamping(sgpio_t *sgpio, unsigned function_index)
+{
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
+	}
+
+	sgpio->functions[function_index].timestamp_buffer = NULL;
+	sgpio_update_data_shim(sgpio);
+	return 0;
+}
+
+
+/**
+ * Configures (or, with SGPIO_TRIGGER_NONE, clears) the capture trigger for
+ * one of the object's functions; see sgpio.h for the semantics.
+ *
+ * @return 0 on success; EINVAL for a bad function index or an oversized
+ *     window; EBUSY if the trigger is currently armed
+ */
+int sgpio_configure_capture_trigger(sgpio_t *sgpio, unsigned function_index,
+		sgpio_trigger_mode_t mode, uint8_t mask, uint8_t value,
+		uint32_t pretrigger_bytes, uint32_t posttrigger_bytes,
+		void (*completion_callback)(void *user_data), void *user_data)
+{
+	sgpio_function_t *function;
+
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
+	}
+
+	function = &sgpio->functions[function_index];
+	if ((function->trigger_state == SGPIO_TRIGGER_ARMED) ||
+			(function->trigger_state == SGPIO_TRIGGER_FIRED)) {
+		return EBUSY;
+	}
+
+	// The frozen window -- pre-trigger fill, the trigger byte, and the
+	// post-trigger fill -- has to fit in the ring with an exchange's worth
+	// of slack left over, since capture only halts after the exchange that
+	// completes the window has already landed.
+	if (function->buffer_order &&
+			((pretrigger_bytes + 1 + posttrigger_bytes + SGPIO_EXCHANGE_MAX_BYTES) >
+			 (1UL << function->buffer_order))) {
+		return EINVAL;
+	}
+
+	function->trigger_mode       = mode;
+	function->trigger_mask       = mask;
+	function->trigger_value      = value;
+	function->trigger_pre_bytes  = pretrigger_bytes;
+	function->trigger_post_bytes = posttrigger_bytes;
+	function->trigger_callback   = completion_callback;
+	function->trigger_user_data  = user_data;
+	function->trigger_state      = SGPIO_TRIGGER_IDLE;
+
+	return 0;
+}
+
+
+/**
+ * Arms a configured capture trigger; see sgpio.h for the semantics.
+ *
+ * @return 0 on success; EINVAL for a bad function index or no configured
+ *     trigger; EBUSY if already armed
+ */
+int sgpio_arm_capture_trigger(sgpio_t *sgpio, unsigned function_index)
+{
+	sgpio_function_t *function;
+
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
 	}
 
+	function = &sgpio->functions[function_index];
+	if (function->trigger_mode == SGPIO_TRIGGER_NONE) {
+		return EINVAL;
+	}
+	if ((function->trigger_state == SGPIO_TRIGGER_ARMED) ||
+			(function->trigger_state == SGPIO_TRIGGER_FIRED)) {
+		return EBUSY;
+	}
+
+	// Start the scan from the ring's current write position, so stale data
+	// from a previous run can't satisfy the condition.
+	function->trigger_scan_position = function->position_in_buffer;
+	function->trigger_bytes_seen    = 0;
+	function->trigger_fire_total    = 0;
+	function->trigger_have_previous = false;
+	function->trigger_state         = SGPIO_TRIGGER_ARMED;
+
+	// If this object's generated ISR is already live, make sure the data
+	// shim is in place to drive the scan.
+	sgpio_update_data_shim(sgpio);
+
+	return 0;
+}
+
+
+/**
+ * Disarms a function's capture trigger, abandoning any collected window.
+ *
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_disarm_capture_trigger(sgpio_t *sgpio, unsigned function_index)
+{
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
+	}
+
+	sgpio->functions[function_index].trigger_state = SGPIO_TRIGGER_IDLE;
+	sgpio_update_data_shim(sgpio);
+	return 0;
+}
+
+
+/**
+ * Retrieves the frozen capture window after a trigger completes; see
+ * sgpio.h for the semantics.
+ *
+ * @return 0 on success; EINVAL for a bad function index; EAGAIN if no
+ *     completed window is available
+ */
+int sgpio_get_capture_window(sgpio_t *sgpio, unsigned function_index,
+		uint32_t *window_start, uint32_t *window_length)
+{
+	sgpio_function_t *function;
+	uint32_t buffer_mask, pre_bytes, length;
+
+	if (function_index >= sgpio->function_count) {
+		return EINVAL;
+	}
+
+	function = &sgpio->functions[function_index];
+	if (function->trigger_state != SGPIO_TRIGGER_COMPLETE) {
+		return EAGAIN;
+	}
+
+	// If the trigger fired before a full pre-trigger span had been
+	// captured, the window starts at the beginning of the capture instead.
+	pre_bytes = function->trigger_pre_bytes;
+	if (pre_bytes > function->trigger_fire_total) {
+		pre_bytes = function->trigger_fire_total;
+	}
+
+	// The scan stopped immediately after the final post-trigger byte, so
+	// the window ends at the scan position and extends backwards over the
+	// post-trigger fill, the trigger byte, and the pre-trigger fill.
+	buffer_mask = (1UL << function->buffer_order) - 1;
+	length = pre_bytes + 1 + function->trigger_post_bytes;
+
+	*window_start = (function->trigger_scan_position - length) & buffer_mask;
+	*window_length = length;
+
 	return 0;
 }
 
@@ -844,3 +1285,175 @@ void sgpio_handle_remaining_data(sgpio_t *sgpio)
 		}
 	}
 }
+
+
+//
+// Configuration snapshots.
+//
+// Everything sgpio_set_up_functions() computes -- slice allocation, the
+// multiplexing registers, SCU pin settings, and the machine code generated
+// above -- is captured into an sgpio_snapshot_t, so alternating between
+// configurations costs a register restore instead of a recompilation.
+//
+
+// The generated argument pool must fit in the snapshot's storage for it.
+static_assert(sizeof(sgpio_isr_arguments_t) <= (SGPIO_SNAPSHOT_MAX_ARG_WORDS * sizeof(uint32_t)),
+		"sgpio_snapshot_t cannot hold the generated ISR's argument pool");
+
+
+/**
+ * Records the SCU configuration for a single pin into a snapshot, skipping
+ * pins already captured.
+ */
+static void sgpio_snapshot_scu_pin(sgpio_snapshot_t *snapshot, sgpio_pin_configuration_t *pin)
+{
+	platform_scu_registers_t *scu = platform_get_scu_registers();
+
+	if (!pin || (snapshot->scu_pin_count >= SGPIO_SNAPSHOT_MAX_PINS)) {
+		return;
+	}
+
+	for (unsigned i = 0; i < snapshot->scu_pin_count; ++i) {
+		if ((snapshot->scu_pins[i].group == pin->scu_group) &&
+				(snapshot->scu_pins[i].pin == pin->scu_pin)) {
+			return;
+		}
+	}
+
+	snapshot->scu_pins[snapshot->scu_pin_count].group = pin->scu_group;
+	snapshot->scu_pins[snapshot->scu_pin_count].pin = pin->scu_pin;
+	snapshot->scu_pins[snapshot->scu_pin_count].value =
+			*(volatile uint32_t *)&scu->group[pin->scu_group].pin[pin->scu_pin];
+	snapshot->scu_pin_count++;
+}
+
+
+/**
+ * Captures the object's current, fully-compiled configuration into a
+ * snapshot; see sgpio.h for the constraints.
+ *
+ * @return 0 on success, or EINVAL on failure
+ */
+int sgpio_snapshot_configuration(sgpio_t *sgpio, sgpio_snapshot_t *snapshot)
+{
+	unsigned isr_words = sgpio_get_maximum_generable_instructions();
+
+	if (!sgpio->reg || (sgpio->function_count > SGPIO_SNAPSHOT_MAX_FUNCTIONS)) {
+		return EINVAL;
+	}
+	if (isr_words > SGPIO_SNAPSHOT_MAX_ISR_WORDS) {
+		isr_words = SGPIO_SNAPSHOT_MAX_ISR_WORDS;
+	}
+
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	// Derived object state.
+	snapshot->slices_in_use = sgpio->slices_in_use;
+	snapshot->pins_in_use = sgpio->pins_in_use;
+	snapshot->swap_irqs_required = sgpio->swap_irqs_required;
+	snapshot->function_count = sgpio->function_count;
+
+	for (unsigned i = 0; i < sgpio->function_count; ++i) {
+		sgpio_function_t *function = &sgpio->functions[i];
+
+		snapshot->function_state[i].io_slice = function->io_slice;
+		snapshot->function_state[i].buffer_depth_order = function->buffer_depth_order;
+		snapshot->function_state[i].direction_slice = function->direction_slice;
+		snapshot->function_state[i].direction_buffer_depth_order = function->direction_buffer_depth_order;
+
+		// Record the SCU state of each pin this function touches.
+		for (unsigned pin = 0; pin < function->bus_width; ++pin) {
+			sgpio_snapshot_scu_pin(snapshot, &function->pin_configurations[pin]);
+		}
+		sgpio_snapshot_scu_pin(snapshot, function->shift_clock_input);
+		sgpio_snapshot_scu_pin(snapshot, function->shift_clock_qualifier_input);
+		sgpio_snapshot_scu_pin(snapshot, function->shift_clock_output);
+	}
+
+	// The SGPIO configuration registers, as raw words.
+	for (unsigned i = 0; i < SGPIO_NUM_SLICES; ++i) {
+		snapshot->output_configuration[i] = ((volatile uint32_t *)sgpio->reg->output_configuration)[i];
+		snapshot->shift_configuration[i] = ((volatile uint32_t *)sgpio->reg->shift_configuration)[i];
+		snapshot->feature_control[i] = ((volatile uint32_t *)sgpio->reg->feature_control)[i];
+		snapshot->cycles_per_shift_clock[i] = sgpio->reg->sgpio_cycles_per_shift_clock[i];
+		snapshot->cycle_count[i] = sgpio->reg->cycle_count[i];
+		snapshot->data_buffer_swap_control[i] = ((volatile uint32_t *)sgpio->reg->data_buffer_swap_control)[i];
+	}
+	snapshot->pin_out = sgpio->reg->sgpio_pin_out;
+	snapshot->pin_direction = sgpio->reg->sgpio_pin_direction;
+	snapshot->stop_on_next_buffer_swap = sgpio->reg->stop_on_next_buffer_swap;
+
+	// The generated ISR: machine code, argument pool, and installed vector.
+	memcpy(snapshot->isr_body, sgpio_dynamic_isr_body, isr_words * sizeof(uint16_t));
+	snapshot->isr_body_words = isr_words;
+	memcpy(snapshot->isr_arguments, &sgpio_dynamic_isr_args, sizeof(sgpio_isr_arguments_t));
+	snapshot->isr_vector = vector_get_handler(SGPIO_IRQ);
+
+	snapshot->valid = true;
+	return 0;
+}
+
+
+/**
+ * Restores a previously-captured configuration without recomputation; see
+ * sgpio.h for the constraints. The restored configuration is left halted.
+ *
+ * @return 0 on success, or EINVAL for an invalid or mismatched snapshot
+ */
+int sgpio_restore_snapshot(sgpio_t *sgpio, const sgpio_snapshot_t *snapshot)
+{
+	platform_reset_register_block_t *reset = get_platform_reset_registers();
+	platform_scu_registers_t *scu = platform_get_scu_registers();
+	reset_select_t reset_select = { .sgpio_reset = 1 };
+
+	if (!snapshot->valid || (snapshot->function_count != sgpio->function_count)) {
+		return EINVAL;
+	}
+
+	// Bring the SGPIO peripheral back to its clean state, exactly as a full
+	// set-up would, and halt all shifting while we rebuild it.
+	reset->reset_control = reset_select;
+	sgpio->reg = platform_get_sgpio_registers();
+	sgpio->reg->shift_clock_enable = 0UL;
+
+	// Restore the SCU state of every captured pin.
+	for (unsigned i = 0; i < snapshot->scu_pin_count; ++i) {
+		*(volatile uint32_t *)&scu->group[snapshot->scu_pins[i].group].pin[snapshot->scu_pins[i].pin] =
+				snapshot->scu_pins[i].value;
+	}
+
+	// Restore the SGPIO configuration registers.
+	for (unsigned i = 0; i < SGPIO_NUM_SLICES; ++i) {
+		((volatile uint32_t *)sgpio->reg->output_configuration)[i] = snapshot->output_configuration[i];
+		((volatile uint32_t *)sgpio->reg->shift_configuration)[i] = snapshot->shift_configuration[i];
+		((volatile uint32_t *)sgpio->reg->feature_control)[i] = snapshot->feature_control[i];
+		sgpio->reg->sgpio_cycles_per_shift_clock[i] = snapshot->cycles_per_shift_clock[i];
+		sgpio->reg->cycle_count[i] = snapshot->cycle_count[i];
+		((volatile uint32_t *)sgpio->reg->data_buffer_swap_control)[i] = snapshot->data_buffer_swap_control[i];
+	}
+	sgpio->reg->sgpio_pin_out = snapshot->pin_out;
+	sgpio->reg->sgpio_pin_direction = snapshot->pin_direction;
+	sgpio->reg->stop_on_next_buffer_swap = snapshot->stop_on_next_buffer_swap;
+
+	// Restore the derived object state.
+	sgpio->slices_in_use = snapshot->slices_in_use;
+	sgpio->pins_in_use = snapshot->pins_in_use;
+	sgpio->swap_irqs_required = snapshot->swap_irqs_required;
+
+	for (unsigned i = 0; i < sgpio->function_count; ++i) {
+		sgpio_function_t *function = &sgpio->functions[i];
+
+		function->io_slice = snapshot->function_state[i].io_slice;
+		function->buffer_depth_order = snapshot->function_state[i].buffer_depth_order;
+		function->direction_slice = snapshot->function_state[i].direction_slice;
+		function->direction_buffer_depth_order = snapshot->function_state[i].direction_buffer_depth_order;
+	}
+
+	// Restore the generated ISR image, and re-install its vector.
+	memcpy(sgpio_dynamic_isr_body, snapshot->isr_body, snapshot->isr_body_words * sizeof(uint16_t));
+	memcpy(&sgpio_dynamic_isr_args, snapshot->isr_arguments, sizeof(sgpio_isr_arguments_t));
+	platform_set_interrupt_handler(SGPIO_IRQ, snapshot->isr_vector);
+
+	sgpio->running = false;
+	return 0;
+}
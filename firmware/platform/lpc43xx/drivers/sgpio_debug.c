@@ -10,6 +10,7 @@
 #include <errno.h>
 
 #include <drivers/scu.h>
+#include <drivers/comms.h>
 #include <drivers/sgpio.h>
 #include <drivers/platform_clock.h>
 
@@ -441,3 +442,27 @@ void sgpio_dump_registers(loglevel_t loglevel, sgpio_t *sgpio)
 	DUMP_REGISTER(shift_configuration[8]);
 
 }
+
+
+/**
+ * Core-class verb: dumps the most recently configured SGPIO instance's
+ * state to the debug ring, on the host's request -- so the disassembly
+ * above is diagnostic work done on demand, never on the boot path.
+ * Overrides the weak stub in classes/core.c when this module is present.
+ */
+int core_verb_dump_sgpio_configuration(struct command_transaction *trans)
+{
+	bool include_unused = comms_argument_parse_bool(trans);
+	sgpio_t *sgpio = sgpio_most_recently_configured();
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	if (!sgpio) {
+		return EAGAIN;
+	}
+
+	sgpio_dump_configuration(LOGLEVEL_INFO, sgpio, include_unused);
+	return 0;
+}
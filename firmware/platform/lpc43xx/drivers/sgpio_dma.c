@@ -0,0 +1,197 @@
+/*
+ * SGPIO DMA capture engine
+ *
+ * This file is part of libgreat.
+ *
+ * Alternative to the generated-ISR data path in sgpio_data.c: instead of
+ * copying shadow registers with processor cycles on every exchange
+ * interrupt, we program the GPDMA controller with a ring of linked-list
+ * descriptors that drain the I/O slice's shadow register into the user
+ * buffer, paced by the SGPIO exchange DMA request. The M4 is left entirely
+ * free, which raises the sustainable capture ceiling considerably.
+ */
+
+#include <toolchain.h>
+#include <string.h>
+
+#include <debug.h>
+#include <errno.h>
+
+#include <drivers/sgpio.h>
+#include <drivers/platform_dma.h>
+
+// From the main body of the SGPIO driver -- expose some of its internal API
+// we want to keep out of the header.
+int sgpio_slice_for_io(uint8_t pin);
+int sgpio_io_pin_for_slice(uint8_t slice);
+
+/** Maximum number of descriptors in our capture ring; each can cover up to
+ * 4095 words, so this comfortably covers any power-of-two user buffer. */
+#define SGPIO_DMA_MAX_DESCRIPTORS 8
+
+/** Maximum number of word transfers a single GPDMA descriptor can carry. */
+#define SGPIO_DMA_MAX_TRANSFER_WORDS 4095
+
+/**
+ * DMA request line routing for the SGPIO exchange request: the CREG DMA mux
+ * routes SGPIO14 onto GPDMA request line 0 with selection 2.
+ */
+#define SGPIO_DMA_REQUEST_LINE      0
+#define SGPIO_DMA_REQUEST_SELECTION 2
+
+/**
+ * State for an active DMA capture. Like the generated ISR, we currently
+ * support a single DMA-driven function at a time.
+ */
+static struct {
+	sgpio_function_t *function;
+	int channel;
+	gpdma_linked_list_item_t descriptors[SGPIO_DMA_MAX_DESCRIPTORS] ATTR_WORD_ALIGNED;
+	bool active;
+} sgpio_dma_state;
+
+
+/**
+ * @return true iff the given function can be serviced by the DMA engine
+ */
+bool sgpio_dma_capture_possible(sgpio_function_t *function)
+{
+	// We currently only support pure-input streaming...
+	if (function->mode != SGPIO_MODE_STREAM_DATA_IN) {
+		return false;
+	}
+
+	// ... from single-slice chains: each exchange produces exactly one word,
+	// which a no-increment source read can drain. Deeper chains produce
+	// words from non-contiguous shadow registers, which the GPDMA's address
+	// generator can't walk.
+	if (function->buffer_depth_order != 0) {
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Sets up a continuous DMA capture for the given function: builds a
+ * descriptor ring over the function's user buffer, routes the SGPIO
+ * exchange request to a DMA channel, and starts the channel. Should be
+ * called after sgpio_set_up_functions(), but before sgpio_run().
+ *
+ * The function should carry the SGPIO_FUNCTION_OVERRIDE_NEVER_USE_ISR
+ * override, so the driver doesn't also generate a copy ISR.
+ *
+ * @return 0 on success; ENOSYS if the function can't be serviced by DMA.
+ */
+int sgpio_dma_prepare_capture(sgpio_t *sgpio, sgpio_function_t *function)
+{
+	uint32_t buffer_words, words_per_descriptor, descriptor_count;
+	uint32_t shadow_register_address;
+	uint8_t slice;
+	int rc;
+
+	if (sgpio_dma_state.active) {
+		pr_error("sgpio: only one DMA capture is supported at a time!\n");
+		return EBUSY;
+	}
+
+	if (!sgpio_dma_capture_possible(function)) {
+		return ENOSYS;
+	}
+
+	// Figure out the shape of the user buffer, and how to split it across
+	// our descriptor ring.
+	buffer_words = (1UL << function->buffer_order) / sizeof(uint32_t);
+	words_per_descriptor = buffer_words;
+	descriptor_count = 1;
+
+	while ((words_per_descriptor > SGPIO_DMA_MAX_TRANSFER_WORDS) &&
+			(descriptor_count < SGPIO_DMA_MAX_DESCRIPTORS)) {
+		words_per_descriptor /= 2;
+		descriptor_count *= 2;
+	}
+	if (words_per_descriptor > SGPIO_DMA_MAX_TRANSFER_WORDS) {
+		pr_error("sgpio: capture buffer too large for the DMA descriptor ring!\n");
+		return EINVAL;
+	}
+
+	// Captured data lands in the I/O slice's shadow register on each exchange.
+	slice = sgpio_slice_for_io(sgpio_io_pin_for_slice(function->io_slice));
+	shadow_register_address = (uint32_t)&sgpio->reg->data_shadow[slice];
+
+	// Build the descriptor ring over the user buffer.
+	for (uint32_t i = 0; i < descriptor_count; ++i) {
+		gpdma_linked_list_item_t *lli = &sgpio_dma_state.descriptors[i];
+		gpdma_linked_list_item_t *next = &sgpio_dma_state.descriptors[(i + 1) % descriptor_count];
+
+		lli->source_address = shadow_register_address;
+		lli->destination_address = (uint32_t)function->buffer + (i * words_per_descriptor * sizeof(uint32_t));
+		lli->next_lli = (uint32_t)next;
+
+		lli->control.all = 0;
+		lli->control.transfer_size = words_per_descriptor;
+		lli->control.source_burst_size = GPDMA_BURST_1;
+		lli->control.destination_burst_size = GPDMA_BURST_1;
+		lli->control.source_transfer_width = GPDMA_WIDTH_WORD;
+		lli->control.destination_transfer_width = GPDMA_WIDTH_WORD;
+		lli->control.source_increment = 0;
+		lli->control.destination_increment = 1;
+	}
+
+	// Route the SGPIO exchange request onto our DMA request line...
+	gpdma_controller_enable();
+	gpdma_select_request_peripheral(SGPIO_DMA_REQUEST_LINE, SGPIO_DMA_REQUEST_SELECTION);
+
+	// ... grab a channel...
+	sgpio_dma_state.channel = gpdma_claim_channel();
+	if (sgpio_dma_state.channel < 0) {
+		return EBUSY;
+	}
+
+	// ... and start the ring; it'll pace itself off the exchange requests.
+	rc = gpdma_start_transfer(sgpio_dma_state.channel, &sgpio_dma_state.descriptors[0],
+			SGPIO_DMA_REQUEST_LINE, 0, GPDMA_FLOW_PERIPHERAL_TO_MEMORY);
+	if (rc) {
+		gpdma_release_channel(sgpio_dma_state.channel);
+		return rc;
+	}
+
+	sgpio_dma_state.function = function;
+	sgpio_dma_state.active = true;
+	return 0;
+}
+
+
+/**
+ * @return the current capture position, as a byte offset into the
+ *     function's user buffer -- i.e. where the DMA engine will write next
+ */
+uint32_t sgpio_dma_capture_position(sgpio_function_t *function)
+{
+	platform_dma_registers_t *reg = platform_get_dma_registers();
+	uint32_t destination;
+
+	if (!sgpio_dma_state.active || (sgpio_dma_state.function != function)) {
+		return 0;
+	}
+
+	destination = reg->channels[sgpio_dma_state.channel].destination_address;
+	return (destination - (uint32_t)function->buffer) & ((1UL << function->buffer_order) - 1);
+}
+
+
+/**
+ * Terminates an active DMA capture, halting the channel and releasing it.
+ */
+void sgpio_dma_terminate_capture(sgpio_function_t *function)
+{
+	if (!sgpio_dma_state.active || (sgpio_dma_state.function != function)) {
+		return;
+	}
+
+	gpdma_release_channel(sgpio_dma_state.channel);
+
+	sgpio_dma_state.function = NULL;
+	sgpio_dma_state.active = false;
+}
@@ -6,6 +6,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include <debug.h>
 
 #include <drivers/comms.h>
@@ -26,6 +28,11 @@
  *  Currently only valid when performing a follow-up IN request. */
 #define LIBGREAT_REQUEST_FLAG_REPEAT_LAST (1 << 1)
 
+/** Flag indicating that the payload is a batch container: several
+ *  class/verb/argument tuples to be executed in order, with their responses
+ *  packed into a single response. The prelude's class/verb are ignored. */
+#define LIBGREAT_REQUEST_FLAG_BATCH (1 << 2)
+
 
 struct comm_backend_driver usb_backend_driver = {
 	.name = "USB",
@@ -104,6 +111,9 @@ static usb_request_status_t libgreat_comms_vendor_request_out_handler(
 		// Determine if the host is opting to skip reading a response.
 		bool skip_response = (endpoint->setup.index & LIBGREAT_REQUEST_FLAG_SKIP_RESPONSE);
 
+		// Determine if the host has packed multiple commands into this submission.
+		bool is_batch = (endpoint->setup.index & LIBGREAT_REQUEST_FLAG_BATCH);
+
 		// Populate the transaction details.
 		active_transaction.class_number = prelude->class_number;
 		active_transaction.verb = prelude->verb;
@@ -111,13 +121,21 @@ static usb_request_status_t libgreat_comms_vendor_request_out_handler(
 		active_transaction.data_in_length = data_length;
 		active_transaction.data_out = usb_data_out_buffer;
 		active_transaction.data_out_max_length = sizeof(usb_data_out_buffer);
+
+		// Our buffers are handed directly to the USB engine; handlers can
+		// build their responses in place without a staging copy.
+		active_transaction.buffers_are_transfer_memory = true;
 		libgreat_clear_position_in_active_transaction();
 		transaction_underway = true;
 
-		// Submit the command to the backend for execution.
+		// Submit the command (or batch of commands) to the backend for execution.
 		// TODO: do we want to set up a back/front to handle these outside
 		// of the interrupt context? or perhaps check for an early-ack for the given class/verb?
-		active_transaction.last_error_number = comms_backend_submit_command(&usb_backend_driver, &active_transaction);
+		if (is_batch) {
+			active_transaction.last_error_number = comms_backend_submit_batch(&usb_backend_driver, &active_transaction);
+		} else {
+			active_transaction.last_error_number = comms_backend_submit_command(&usb_backend_driver, &active_transaction);
+		}
 
 		// If the host is opting to skip reading a response, the transaction is compelte, here.
 		if (skip_response) {
@@ -280,3 +298,56 @@ usb_request_status_t libgreat_comms_vendor_request_handler(
 	}
 
 }
+
+
+/**
+ * Platform implementations of the core class's USB endpoint statistics
+ * verbs; these override the weak ENOSYS stubs in classes/core.c, since on
+ * this platform the USB queue layer maintains per-endpoint counters.
+ */
+int core_verb_get_usb_endpoint_stats(struct command_transaction *trans)
+{
+	uint8_t controller = comms_argument_parse_uint8_t(trans);
+	uint8_t endpoint_address = comms_argument_parse_uint8_t(trans);
+
+	usb_endpoint_stats_t *stats;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	stats = usb_endpoint_stats_for_address(controller, endpoint_address);
+	if (!stats) {
+		return EINVAL;
+	}
+
+	comms_response_add_uint32_t(trans, stats->transfers_completed);
+	comms_response_add_uint32_t(trans, stats->bytes_transferred);
+	comms_response_add_uint32_t(trans, stats->transfer_errors);
+	comms_response_add_uint32_t(trans, stats->queue_empty_events);
+	comms_response_add_uint32_t(trans, stats->max_prime_wait_spins);
+	comms_response_add_uint32_t(trans, stats->pool_exhaustions);
+
+	return 0;
+}
+
+
+int core_verb_reset_usb_endpoint_stats(struct command_transaction *trans)
+{
+	uint8_t controller = comms_argument_parse_uint8_t(trans);
+	uint8_t endpoint_address = comms_argument_parse_uint8_t(trans);
+
+	usb_endpoint_stats_t *stats;
+
+	if (!comms_transaction_okay(trans)) {
+		return EBADMSG;
+	}
+
+	stats = usb_endpoint_stats_for_address(controller, endpoint_address);
+	if (!stats) {
+		return EINVAL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	return 0;
+}
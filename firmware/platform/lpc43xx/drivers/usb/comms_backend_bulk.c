@@ -0,0 +1,185 @@
+/*
+ * This file is part of libgreat
+ *
+ * Bulk-endpoint backend to the libgreat communications API.
+ *
+ * This transport speaks the same command_transaction protocol as the EP0
+ * vendor-request backend, but carries commands over a bulk OUT endpoint and
+ * responses over a bulk IN endpoint. Avoiding the SETUP/STATUS overhead of
+ * control transfers -- and allowing the host to pipeline command submissions
+ * via the endpoint queues -- lets us service small verbs at bulk-transfer
+ * rates rather than EP0 rates.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <debug.h>
+#include <errno.h>
+
+#include <drivers/comms.h>
+#include <drivers/comms_backend.h>
+#include <drivers/usb/comms_backend.h>
+
+#include <drivers/usb/usb_queue.h>
+
+/** Number of in-flight command slots; two slots let us receive the next
+ * command while the previous response is still being transmitted. */
+#define LIBGREAT_BULK_COMMAND_SLOTS 2
+
+// FIXME: abstract the maximum size, here (shared with the EP0 backend)
+#define LIBGREAT_BULK_BUFFER_SIZE 4096
+
+struct comm_backend_driver usb_bulk_backend_driver = {
+	.name = "USB bulk",
+};
+
+/**
+ * State for a single in-flight bulk command: the buffers that carry its
+ * command and response data, and the transaction built around them.
+ */
+struct bulk_command_slot {
+	uint8_t command_buffer[LIBGREAT_BULK_BUFFER_SIZE] ATTR_ALIGNED(4);
+	uint8_t response_buffer[LIBGREAT_BULK_BUFFER_SIZE] ATTR_ALIGNED(4);
+	struct command_transaction transaction;
+};
+
+/** Our collection of command slots, cycled through in submission order. */
+static struct bulk_command_slot bulk_slots[LIBGREAT_BULK_COMMAND_SLOTS];
+
+/** The endpoints we're using for command reception and response transmission. */
+static usb_endpoint_t *bulk_out_endpoint;
+static usb_endpoint_t *bulk_in_endpoint;
+
+/**
+ * Response prelude for the bulk transport. Unlike the EP0 transport, which
+ * can convey command failure by stalling the status stage, bulk responses
+ * carry their status in-band.
+ */
+struct ATTR_PACKED libgreat_bulk_response_prelude {
+	uint32_t status;
+};
+
+
+static void libgreat_comms_bulk_command_complete(void *user_data, unsigned int transferred);
+
+/**
+ * (Re-)arms reception of a command into the given slot.
+ */
+static int libgreat_comms_bulk_arm_reception(struct bulk_command_slot *slot)
+{
+	int rc;
+
+	rc = usb_transfer_schedule(bulk_out_endpoint, slot->command_buffer,
+			sizeof(slot->command_buffer), libgreat_comms_bulk_command_complete, slot);
+	if (rc) {
+		pr_warning("warning: comms: could not arm bulk command reception (%d)\n", rc);
+	}
+
+	return rc;
+}
+
+
+/**
+ * Completion handler for response transmissions; re-arms the slot's command
+ * buffer so that it can accept a new command.
+ */
+static void libgreat_comms_bulk_response_complete(void *user_data, unsigned int transferred)
+{
+	(void)transferred;
+	libgreat_comms_bulk_arm_reception(user_data);
+}
+
+
+/**
+ * Completion handler for command reception: parses the command prelude,
+ * executes the relevant verb, and queues the response for transmission.
+ */
+static void libgreat_comms_bulk_command_complete(void *user_data, unsigned int transferred)
+{
+	int rc;
+
+	struct bulk_command_slot *slot = user_data;
+	struct command_transaction *trans = &slot->transaction;
+
+	// Get a reference to the command prelude, and to the data that follows
+	// directly after.
+	struct libgreat_command_prelude *prelude = (void *)slot->command_buffer;
+	uint8_t *post_prelude_buffer = &slot->command_buffer[sizeof(*prelude)];
+
+	// The response always begins with our in-band status word.
+	struct libgreat_bulk_response_prelude *response_prelude = (void *)slot->response_buffer;
+	uint8_t *post_prelude_response = &slot->response_buffer[sizeof(*response_prelude)];
+
+	// If this transfer couldn't even contain a command prelude, it's not a
+	// valid command; drop it and re-arm reception.
+	if (transferred < sizeof(*prelude)) {
+		pr_warning("warning: comms: dropping a runt bulk command (%u bytes)\n", transferred);
+		libgreat_comms_bulk_arm_reception(slot);
+		return;
+	}
+
+	// Populate the transaction details.
+	trans->class_number = prelude->class_number;
+	trans->verb = prelude->verb;
+	trans->data_in = post_prelude_buffer;
+	trans->data_in_length = transferred - sizeof(*prelude);
+	trans->data_out = post_prelude_response;
+	trans->data_out_max_length = sizeof(slot->response_buffer) - sizeof(*response_prelude);
+	trans->buffers_are_transfer_memory = true;
+	trans->data_out_length = 0;
+	trans->data_in_position = trans->data_in;
+	trans->data_out_position = trans->data_out;
+	trans->data_in_remaining = trans->data_in_length;
+	trans->data_in_status = COMMS_PARSE_OKAY;
+	trans->data_out_status = COMMS_PARSE_OKAY;
+	trans->last_error_number = 0;
+
+	// Submit the command to the backend for execution.
+	trans->last_error_number = comms_backend_submit_command(&usb_bulk_backend_driver, trans);
+	response_prelude->status = trans->last_error_number;
+
+	// Queue the response -- status word plus any response data -- and hand
+	// the slot back to reception once it completes.
+	rc = usb_transfer_schedule(bulk_in_endpoint, slot->response_buffer,
+			sizeof(*response_prelude) + trans->data_out_length,
+			libgreat_comms_bulk_response_complete, slot);
+	if (rc) {
+		pr_warning("warning: comms: could not queue a bulk command response (%d)\n", rc);
+		libgreat_comms_bulk_arm_reception(slot);
+	}
+}
+
+
+/**
+ * Sets up the bulk comms transport on a pair of (already-initialized) bulk
+ * endpoints, and begins accepting commands on the OUT endpoint.
+ *
+ * @param out_endpoint The bulk OUT endpoint on which commands will be received.
+ * @param in_endpoint The bulk IN endpoint on which responses will be sent.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int libgreat_comms_bulk_initialize(usb_endpoint_t *out_endpoint, usb_endpoint_t *in_endpoint)
+{
+	int rc;
+	unsigned int i;
+
+	if (!out_endpoint || !in_endpoint) {
+		return EINVAL;
+	}
+
+	bulk_out_endpoint = out_endpoint;
+	bulk_in_endpoint = in_endpoint;
+
+	// Arm each of our command slots; the endpoint queue keeps them in
+	// submission order, so responses always match command order.
+	for (i = 0; i < LIBGREAT_BULK_COMMAND_SLOTS; ++i) {
+		rc = libgreat_comms_bulk_arm_reception(&bulk_slots[i]);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * This file is part of libgreat
+ *
+ * USB transport for libgreat communications pipes: binds a comms_pipe to a
+ * pair of bulk endpoints, with zero-copy sends and pipelined reception.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <debug.h>
+#include <errno.h>
+
+#include <drivers/comms.h>
+#include <drivers/usb/comms_backend.h>
+
+#include <drivers/usb/usb_queue.h>
+
+/** Maximum number of pipes we can bind to USB endpoints. */
+#define LIBGREAT_USB_PIPE_COUNT 4
+
+/** Number of reception buffers kept queued per pipe, so the host can keep
+ * streaming while we process a completed block. */
+#define LIBGREAT_USB_PIPE_RX_BUFFERS 2
+
+/** Size of each reception buffer. */
+// FIXME: abstract the maximum size, here
+#define LIBGREAT_USB_PIPE_RX_BUFFER_SIZE 4096
+
+/**
+ * Transport state for a pipe bound to USB endpoints.
+ */
+struct usb_pipe_binding {
+	struct comms_pipe *pipe;
+	usb_endpoint_t *in_endpoint;
+	usb_endpoint_t *out_endpoint;
+	uint8_t rx_buffers[LIBGREAT_USB_PIPE_RX_BUFFERS][LIBGREAT_USB_PIPE_RX_BUFFER_SIZE] ATTR_ALIGNED(4);
+
+	/** Index of the oldest outstanding reception buffer; the endpoint queue
+	 * completes transfers in submission order, so this identifies which
+	 * buffer each completion belongs to. */
+	unsigned int rx_complete_index;
+
+	bool in_use;
+};
+
+static struct usb_pipe_binding pipe_bindings[LIBGREAT_USB_PIPE_COUNT];
+
+
+/**
+ * Completion handler for pipe sends; hands the credit and buffer back to
+ * the core pipe layer.
+ */
+static void usb_pipe_send_complete(void *user_data, unsigned int transferred)
+{
+	struct usb_pipe_binding *binding = user_data;
+	(void)transferred;
+
+	// Note: the transfer's original buffer pointer isn't surfaced by the
+	// queue's completion callback; the owner is expected to track its
+	// in-flight buffers in submission order, which the endpoint queue
+	// preserves.
+	comms_pipe_handle_send_complete(binding->pipe, NULL, transferred);
+}
+
+
+static int usb_pipe_arm_reception(struct usb_pipe_binding *binding, void *buffer);
+
+/**
+ * Completion handler for pipe reception: delivers the block to the pipe's
+ * owner, and immediately re-arms the buffer.
+ */
+static void usb_pipe_receive_complete(void *user_data, unsigned int transferred)
+{
+	struct usb_pipe_binding *binding = user_data;
+
+	// Identify which buffer completed: the endpoint queue completes transfers
+	// in submission order, so the oldest outstanding buffer is always the one
+	// completing.
+	void *buffer = binding->rx_buffers[binding->rx_complete_index];
+	binding->rx_complete_index = (binding->rx_complete_index + 1) % LIBGREAT_USB_PIPE_RX_BUFFERS;
+
+	comms_pipe_handle_data_received(binding->pipe, buffer, transferred);
+	usb_pipe_arm_reception(binding, buffer);
+}
+
+
+/**
+ * Queues a buffer to receive host-to-device pipe data.
+ */
+static int usb_pipe_arm_reception(struct usb_pipe_binding *binding, void *buffer)
+{
+	int rc;
+
+	rc = usb_transfer_schedule(binding->out_endpoint, buffer,
+			LIBGREAT_USB_PIPE_RX_BUFFER_SIZE, usb_pipe_receive_complete, binding);
+	if (rc) {
+		pr_warning("warning: comms: could not arm pipe reception (%d)\n", rc);
+	}
+
+	return rc;
+}
+
+
+/**
+ * Backend send operation: queues the caller's buffer directly on the IN
+ * endpoint, without a staging copy.
+ */
+static int usb_pipe_backend_send(struct comms_pipe *pipe, void *data, uint32_t length)
+{
+	struct usb_pipe_binding *binding = pipe->backend_data;
+
+	if (!binding->in_endpoint) {
+		return EINVAL;
+	}
+
+	return usb_transfer_schedule(binding->in_endpoint, data, length,
+			usb_pipe_send_complete, binding);
+}
+
+
+/**
+ * Binds a registered comms pipe to a pair of (already-initialized) bulk
+ * endpoints, making it usable for transmission, and arming reception if
+ * an OUT endpoint is provided. Either endpoint may be NULL for a
+ * unidirectional pipe.
+ *
+ * @param pipe The pipe to be bound.
+ * @param in_endpoint The bulk IN endpoint for device-to-host pipe data.
+ * @param out_endpoint The bulk OUT endpoint for host-to-device pipe data.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int libgreat_comms_bind_pipe_to_endpoints(struct comms_pipe *pipe,
+		usb_endpoint_t *in_endpoint, usb_endpoint_t *out_endpoint)
+{
+	unsigned int i;
+	struct usb_pipe_binding *binding = NULL;
+
+	if (!pipe || (!in_endpoint && !out_endpoint)) {
+		return EINVAL;
+	}
+
+	// Find a free binding slot.
+	for (i = 0; i < LIBGREAT_USB_PIPE_COUNT; ++i) {
+		if (!pipe_bindings[i].in_use) {
+			binding = &pipe_bindings[i];
+			break;
+		}
+	}
+	if (!binding) {
+		pr_error("comms: out of USB pipe bindings!\n");
+		return ENOMEM;
+	}
+
+	binding->in_use = true;
+	binding->pipe = pipe;
+	binding->in_endpoint = in_endpoint;
+	binding->out_endpoint = out_endpoint;
+	binding->rx_complete_index = 0;
+
+	// Install our transport operations into the pipe.
+	pipe->backend_data = binding;
+	pipe->backend_send = usb_pipe_backend_send;
+	pipe->backend_ready = NULL;
+
+	// If this pipe accepts host-to-device data, start listening.
+	if (out_endpoint) {
+		for (i = 0; i < LIBGREAT_USB_PIPE_RX_BUFFERS; ++i) {
+			int rc = usb_pipe_arm_reception(binding, binding->rx_buffers[i]);
+			if (rc) {
+				return rc;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -24,6 +24,11 @@
 #include <libopencm3/lpc43xx/scu.h>
 
 #include <drivers/platform_clock.h>
+#include <drivers/platform_vectors.h>
+
+// From <drivers/arm_vectors.h> -- which we can't include here, as its
+// vector-table definitions clash with the libopencm3 ones above.
+void vector_set_handler(platform_irq_t irq, interrupt_service_routine_t isr);
 
 // FIXME: Clean me up to use the USB_REG macro from usb_registers.h to reduce duplication!
 
@@ -353,7 +358,11 @@ void usb_endpoint_schedule_wait(
 	// Ensure that endpoint is ready to be primed.
 	// It may have been flushed due to an aborted transaction.
 	// TODO: This should be preceded by a flush?
-	while( usb_endpoint_is_ready(endpoint) );
+	uint32_t prime_wait_spins = 0;
+	while( usb_endpoint_is_ready(endpoint) ) {
+		++prime_wait_spins;
+	}
+	usb_stats_note_prime_wait(endpoint, prime_wait_spins);
 
 	td->next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
 
@@ -746,10 +755,10 @@ void usb_set_irq_handler(
 	vector_table_entry_t isr
 ) {
 	if( device->controller == 0 ) {
-		vector_table.irq[NVIC_USB0_IRQ] = isr;
+		vector_set_handler(USB0_IRQ, isr);
 	}
 	if( device->controller == 1 ) {
-		vector_table.irq[NVIC_USB1_IRQ] = isr;
+		vector_set_handler(USB1_IRQ, isr);
 	}
 }
 
@@ -768,6 +777,10 @@ static void usb_interrupt_enable(
 void usb_device_init(
 	usb_peripheral_t* const device
 ) {
+	// Resolve the device's descriptors into the GET_DESCRIPTOR lookup cache
+	// now, so enumeration never pays for a descriptor-table walk.
+	usb_standard_request_prepare_descriptors(device);
+
 	if( device->controller == 0 ) {
 		//usb_peripherals[0] = device;
 
@@ -860,11 +873,22 @@ void usb_endpoint_init_without_descriptor(
 
 	usb_endpoint_flush(endpoint);
 
+	// For isochronous endpoints, wMaxPacketSize carries the per-microframe
+	// transaction count in bits 12:11 (high-bandwidth endpoints run up to
+	// three transactions per microframe); the actual packet size lives in
+	// bits 10:0. The transaction count programs the queue head's MULT field,
+	// which reserves the endpoint's per-microframe bus time.
+	uint_fast8_t transactions_per_microframe = 0;
+	if (transfer_type == USB_TRANSFER_TYPE_ISOCHRONOUS) {
+		transactions_per_microframe = ((max_packet_size >> 11) & 0x3) + 1;
+		max_packet_size &= 0x7FF;
+	}
+
 	// TODO: There are more capabilities to adjust based on the endpoint
 	// descriptor.
 	usb_queue_head_t* const qh = usb_queue_head(endpoint->address, endpoint->device);
 	qh->capabilities
-		= USB_QH_CAPABILITIES_MULT(0)
+		= USB_QH_CAPABILITIES_MULT(transactions_per_microframe)
 		| USB_QH_CAPABILITIES_MPL(max_packet_size)
 		| ((transfer_type == USB_TRANSFER_TYPE_CONTROL) ? USB_QH_CAPABILITIES_IOS : 0)
 		| ((zero_length_terminate) ? 0 : USB_QH_CAPABILITIES_ZLT);
@@ -973,43 +997,37 @@ static void usb_check_for_setup_events(usb_peripheral_t* const device) {
 }
 
 static void usb_check_for_transfer_events(usb_peripheral_t* const device) {
-	const uint32_t endptcomplete = usb_get_endpoint_complete(device);
-	uint32_t endptcomplete_out_bit = 0;
-	uint32_t endptcomplete_in_bit = 0;
-	if( endptcomplete ) {
-		for( uint_fast8_t i=0; i<6; i++ ) {
-			if(device->controller == 0) {
-				endptcomplete_out_bit = USB0_ENDPTCOMPLETE_ERCE(1 << i);
-			}
-			if(device->controller == 1) {
-				endptcomplete_out_bit = USB1_ENDPTCOMPLETE_ERCE(1 << i);
-			}
-			if( endptcomplete & endptcomplete_out_bit ) {
-				usb_clear_endpoint_complete(endptcomplete_out_bit, device);
-				usb_endpoint_t* const endpoint =
-					usb_endpoint_from_address(
-						usb_endpoint_address(USB_TRANSFER_DIRECTION_OUT, i),
-						device);
-				if( endpoint && endpoint->transfer_complete ) {
-					endpoint->transfer_complete(endpoint);
-				}
-			}
-
-			if(device->controller == 0) {
-				endptcomplete_in_bit = USB0_ENDPTCOMPLETE_ETCE(1 << i);
-			}
-			if(device->controller == 1) {
-				endptcomplete_in_bit = USB1_ENDPTCOMPLETE_ETCE(1 << i);
-			}
-			if( endptcomplete & endptcomplete_in_bit ) {
-				usb_clear_endpoint_complete(endptcomplete_in_bit, device);
-				usb_endpoint_t* const endpoint =
-					usb_endpoint_from_address(
-						usb_endpoint_address(USB_TRANSFER_DIRECTION_IN, i),
-						device);
-				if( endpoint && endpoint->transfer_complete ) {
-					endpoint->transfer_complete(endpoint);
-				}
+	// OUT (receive) completions occupy ENDPTCOMPLETE bits 5:0; IN (transmit)
+	// completions bits 21:16. Identical on both controllers.
+	const uint32_t valid_completion_bits = 0x003F003F;
+	uint32_t endptcomplete;
+
+	// Harvest until the controller has no freshly-retired descriptors left:
+	// completions that land while we dispatch callbacks are handled in this
+	// same pass, instead of raising another interrupt.
+	while( (endptcomplete = usb_get_endpoint_complete(device) & valid_completion_bits) ) {
+
+		// Acknowledge the whole snapshot with a single W1C write; per-endpoint
+		// completion handlers drain every retired descriptor behind each bit.
+		usb_clear_endpoint_complete(endptcomplete, device);
+
+		// Visit only the set bits, count-trailing-zeros style, rather than
+		// scanning every endpoint slot.
+		while( endptcomplete ) {
+			uint_fast8_t bit = __builtin_ctz(endptcomplete);
+			endptcomplete &= endptcomplete - 1;
+
+			bool is_in = (bit >= 16);
+			uint_fast8_t number = is_in ? (bit - 16) : bit;
+
+			usb_endpoint_t* const endpoint =
+				usb_endpoint_from_address(
+					usb_endpoint_address(
+						is_in ? USB_TRANSFER_DIRECTION_IN : USB_TRANSFER_DIRECTION_OUT,
+						number),
+					device);
+			if( endpoint && endpoint->transfer_complete ) {
+				endpoint->transfer_complete(endpoint);
 			}
 		}
 	}
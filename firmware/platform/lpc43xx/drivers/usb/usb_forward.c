@@ -0,0 +1,217 @@
+/*
+ * This file is part of GreatFET
+ *
+ * On-device USB forwarding between the device- and host-mode controllers;
+ * see <drivers/usb/usb_forward.h> for the model.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include <debug.h>
+
+#include <drivers/usb/usb_queue.h>
+#include <drivers/usb/usb_queue_host.h>
+#include <drivers/usb/usb_forward.h>
+
+// Forward declarations for the completion handlers, which chain into one
+// another as each buffer crosses the channel.
+static void usb_forward_device_received(void *user_data, unsigned int transferred);
+static void usb_forward_device_sent(void *user_data, unsigned int transferred);
+static void usb_forward_host_received(void *user_data, unsigned int transferred,
+		bool stalled, bool error);
+static void usb_forward_host_sent(void *user_data, unsigned int transferred,
+		bool stalled, bool error);
+
+
+/**
+ * Arms a buffer on the channel's receiving side: a device OUT transfer for
+ * a to-host-side channel, or a host IN transfer for a to-device-side one.
+ */
+static void usb_forward_arm_receive(usb_forward_buffer_t *buffer)
+{
+	usb_forward_channel_t *channel = buffer->channel;
+	int rc;
+
+	if (!channel->active) {
+		return;
+	}
+
+	if (channel->direction == USB_FORWARD_TO_HOST_SIDE) {
+		rc = usb_transfer_schedule(channel->device_endpoint, buffer->data,
+				channel->buffer_size, usb_forward_device_received, buffer);
+	} else {
+		rc = usb_host_transfer_schedule(channel->host, channel->host_qh,
+				USB_PID_TOKEN_IN, 0, buffer->data, channel->buffer_size,
+				usb_forward_host_received, buffer);
+	}
+
+	// If the receive couldn't be armed, the buffer falls out of circulation;
+	// count it, so a starving channel is diagnosable.
+	if (rc) {
+		++channel->errors;
+	}
+}
+
+
+/**
+ * Runs a received packet through the channel's filter and onto the sending
+ * side; a drop (from the filter or a scheduling failure) re-arms the
+ * receive instead, keeping the buffer in circulation.
+ */
+static void usb_forward_dispatch(usb_forward_buffer_t *buffer, uint32_t length)
+{
+	usb_forward_channel_t *channel = buffer->channel;
+	int rc;
+
+	if (!channel->active) {
+		return;
+	}
+
+	// Give the filter its look at the packet -- it may rewrite the data or
+	// adjust the length -- and honor a drop verdict.
+	if (channel->filter) {
+		usb_forward_action_t action = channel->filter(channel, buffer->data, &length);
+
+		if ((action == USB_FORWARD_ACTION_DROP) || (length > channel->buffer_size)) {
+			++channel->packets_dropped;
+			usb_forward_arm_receive(buffer);
+			return;
+		}
+	}
+
+	// Re-queue the same buffer on the sending side: no copy, no task.
+	if (channel->direction == USB_FORWARD_TO_HOST_SIDE) {
+		rc = usb_host_transfer_schedule(channel->host, channel->host_qh,
+				USB_PID_TOKEN_OUT, 0, buffer->data, length,
+				usb_forward_host_sent, buffer);
+	} else {
+		rc = usb_transfer_schedule(channel->device_endpoint, buffer->data,
+				length, usb_forward_device_sent, buffer);
+	}
+
+	if (rc) {
+		++channel->errors;
+		usb_forward_arm_receive(buffer);
+		return;
+	}
+
+	++channel->packets_forwarded;
+	channel->bytes_forwarded += length;
+}
+
+
+/**
+ * Completion handler for the device-side receive of a to-host-side channel.
+ */
+static void usb_forward_device_received(void *user_data, unsigned int transferred)
+{
+	usb_forward_dispatch(user_data, transferred);
+}
+
+
+/**
+ * Completion handler for the host-side receive of a to-device-side channel.
+ */
+static void usb_forward_host_received(void *user_data, unsigned int transferred,
+		bool stalled, bool error)
+{
+	usb_forward_buffer_t *buffer = user_data;
+
+	// A failed poll carries no data; count it and keep polling. (A stalled
+	// proxied endpoint will keep counting until the caller notices and
+	// clears the halt, mirroring what the upstream host would see.)
+	if (stalled || error) {
+		++buffer->channel->errors;
+		usb_forward_arm_receive(buffer);
+		return;
+	}
+
+	usb_forward_dispatch(buffer, transferred);
+}
+
+
+/**
+ * Completion handler for the device-side send: the buffer has crossed the
+ * channel, and goes back to receiving.
+ */
+static void usb_forward_device_sent(void *user_data, unsigned int transferred)
+{
+	(void)transferred;
+	usb_forward_arm_receive(user_data);
+}
+
+
+/**
+ * Completion handler for the host-side send; as above, plus error
+ * accounting only the host side reports.
+ */
+static void usb_forward_host_sent(void *user_data, unsigned int transferred,
+		bool stalled, bool error)
+{
+	usb_forward_buffer_t *buffer = user_data;
+	(void)transferred;
+
+	if (stalled || error) {
+		++buffer->channel->errors;
+	}
+
+	usb_forward_arm_receive(buffer);
+}
+
+
+/**
+ * Starts a forwarding channel; see <drivers/usb/usb_forward.h>.
+ */
+int usb_forward_start(usb_forward_channel_t *channel,
+		usb_forward_direction_t direction, usb_endpoint_t *device_endpoint,
+		usb_peripheral_t *host, ehci_queue_head_t *host_qh,
+		void *const *buffers, unsigned buffer_count, uint32_t buffer_size,
+		usb_forward_filter_t filter)
+{
+	if (!device_endpoint || !host || !host_qh || !buffers || !buffer_size) {
+		return EINVAL;
+	}
+	if (!buffer_count || (buffer_count > USB_FORWARD_MAX_BUFFERS)) {
+		return EINVAL;
+	}
+	if (channel->active) {
+		return EBUSY;
+	}
+
+	channel->device_endpoint = device_endpoint;
+	channel->host = host;
+	channel->host_qh = host_qh;
+	channel->direction = direction;
+	channel->filter = filter;
+	channel->buffer_size = buffer_size;
+	channel->buffer_count = buffer_count;
+
+	channel->packets_forwarded = 0;
+	channel->bytes_forwarded = 0;
+	channel->packets_dropped = 0;
+	channel->errors = 0;
+
+	channel->active = true;
+
+	// Put every buffer into circulation on the receiving side; from here,
+	// the completion handlers keep them cycling.
+	for (unsigned i = 0; i < buffer_count; ++i) {
+		channel->buffers[i].channel = channel;
+		channel->buffers[i].data = buffers[i];
+		usb_forward_arm_receive(&channel->buffers[i]);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Stops a forwarding channel; see <drivers/usb/usb_forward.h>.
+ */
+void usb_forward_stop(usb_forward_channel_t *channel)
+{
+	channel->active = false;
+}
@@ -224,9 +224,35 @@ static void usb_controller_set_up_periodic_list(usb_peripheral_t *host)
 	host->periodic_queue_head.overlay.alternate_next_dtd_pointer = TERMINATING_LINK;
 	host->periodic_queue_head.overlay.halted = 1;
 
-	// Set up the periodic list.
+	// Set up our interval anchors: one inactive queue head per power-of-two
+	// polling interval, each linking to the next-smaller interval's anchor,
+	// with the every-frame anchor linking to the terminal node above.
+	// Endpoint queue heads get inserted just after their interval's anchor.
+	for(int level = 0; level < USB_HOST_PERIODIC_INTERVAL_LEVELS; ++level) {
+		ehci_queue_head_t *anchor = &host->periodic_interval_anchors[level];
+		ehci_queue_head_t *next = (level == 0)
+			? &host->periodic_queue_head
+			: &host->periodic_interval_anchors[level - 1];
+
+		memset(anchor, 0, sizeof(*anchor));
+		anchor->horizontal.link = (uint32_t)next;
+		anchor->horizontal.type = DESCRIPTOR_QH;
+		anchor->overlay.next_dtd_pointer = TERMINATING_LINK;
+		anchor->overlay.alternate_next_dtd_pointer = TERMINATING_LINK;
+		anchor->overlay.halted = 1;
+	}
+
+	// Set up the periodic list: each frame starts at the largest-interval
+	// anchor scheduled for that frame, so an interval-2^n endpoint is
+	// visited by the hardware exactly every 2^n frames.
 	for(int i = 0; i < USB_PERIODIC_LIST_SIZE; ++i) {
-		host->periodic_list[i].link = (uint32_t)&host->periodic_queue_head;
+		int level = USB_HOST_PERIODIC_INTERVAL_LEVELS - 1;
+
+		if (i && (__builtin_ctz(i) < level)) {
+			level = __builtin_ctz(i);
+		}
+
+		host->periodic_list[i].link = (uint32_t)&host->periodic_interval_anchors[level];
 		host->periodic_list[i].type = DESCRIPTOR_QH;
 		host->periodic_list[i].terminate = 0;
 	}
@@ -262,6 +288,32 @@ void usb_host_enable_asynchronous_schedule(usb_peripheral_t *host)
 }
 
 
+/**
+ * Disables the periodic schedule, blocking until it's fully down.
+ */
+void usb_host_disable_periodic_schedule(usb_peripheral_t *host)
+{
+	// Clear the periodic schedule enabled bit..
+	USB_REG(host->controller)->USBCMD &= ~USB0_USBCMD_H_PSE;
+
+	// ... and wait for the host to report that the schedule has been disabled.
+	while(USB_REG(host->controller)->USBSTS & USB0_USBSTS_H_PS);
+}
+
+
+/**
+ * Enables the periodic schedule, blocking until it fully comes up.
+ */
+void usb_host_enable_periodic_schedule(usb_peripheral_t *host)
+{
+	// Set the periodic schedule enabled bit..
+	USB_REG(host->controller)->USBCMD |= USB0_USBCMD_H_PSE;
+
+	// ... and wait for the host to report that the schedule has been enabled.
+	while(!(USB_REG(host->controller)->USBSTS & USB0_USBSTS_H_PS));
+}
+
+
 
 
 /**
@@ -382,6 +434,13 @@ static void usb_host_isr(usb_peripheral_t *host) {
 		usb_host_handle_asynchronous_transfer_complete(host);
 	}
 
+	// If we've just finished a transaction on the periodic schedule, retire
+	// any completed transfers; transfer retirement works from the host's
+	// pending-transfer list, so the same handler serves both schedules.
+	if (status & USB0_USBSTS_H_UPI) {
+		usb_host_handle_asynchronous_transfer_complete(host);
+	}
+
 	if (status & USB0_USBSTS_H_UEI) {
 		usb_host_handle_error(host);
 	}
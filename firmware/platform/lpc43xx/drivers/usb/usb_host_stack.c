@@ -3,6 +3,8 @@
  */
 
 #include <stddef.h>
+#include <string.h>
+#include <errno.h>
 
 #include <greatfet_core.h>
 #include <usb_type.h>
@@ -14,6 +16,11 @@
 
 #include <usb_host_stack.h>
 
+#include <drivers/scheduler.h>
+#include <drivers/memory/allocator.h>
+
+#include <libopencm3/cm3/cortex.h>
+
 
 /**
  * Issues a control request to the device.
@@ -263,3 +270,617 @@ int usb_host_set_address(usb_peripheral_t *host,
 		NULL
 	);
 }
+
+
+//
+// Enumeration caching.
+//
+// Descriptor records are walked by their wire layout (bLength at offset 0,
+// bDescriptorType at offset 1), so the cache doesn't depend on having typed
+// descriptor structures for every record it might encounter.
+//
+
+// Byte offsets into the raw configuration descriptor.
+#define USB_CONFIGURATION_DESCRIPTOR_LENGTH               9
+#define USB_CONFIGURATION_DESCRIPTOR_OFFSET_TOTAL_LENGTH  2
+#define USB_CONFIGURATION_DESCRIPTOR_OFFSET_CONFIG_VALUE  5
+
+// Byte offsets into a raw interface descriptor.
+#define USB_INTERFACE_DESCRIPTOR_OFFSET_NUMBER            2
+#define USB_INTERFACE_DESCRIPTOR_OFFSET_ALTERNATE         3
+#define USB_INTERFACE_DESCRIPTOR_OFFSET_CLASS             5
+#define USB_INTERFACE_DESCRIPTOR_OFFSET_SUBCLASS          6
+#define USB_INTERFACE_DESCRIPTOR_OFFSET_PROTOCOL          7
+
+// Byte offsets into a raw endpoint descriptor.
+#define USB_ENDPOINT_DESCRIPTOR_OFFSET_ADDRESS            2
+#define USB_ENDPOINT_DESCRIPTOR_OFFSET_ATTRIBUTES         3
+#define USB_ENDPOINT_DESCRIPTOR_OFFSET_MAX_PACKET_SIZE    4
+#define USB_ENDPOINT_DESCRIPTOR_OFFSET_INTERVAL           6
+
+
+/**
+ * Parses a cache's raw configuration blob into its interface and endpoint
+ * indexes. Unknown descriptor types (e.g. class-specific records) are
+ * skipped; interfaces and endpoints beyond the cache's capacity are counted
+ * in the blob but not indexed.
+ */
+static void usb_host_index_cached_configuration(usb_host_configuration_cache_t *cache)
+{
+	uint16_t offset = 0;
+
+	// Index of the interface currently accumulating endpoints, or -1 before
+	// we've seen an interface descriptor (or after one we couldn't index).
+	int current_interface = -1;
+
+	cache->interface_count = 0;
+	cache->endpoint_count = 0;
+
+	while (offset + 2 <= cache->raw_length) {
+		uint8_t *descriptor = &cache->raw[offset];
+		uint8_t descriptor_length = descriptor[0];
+		uint8_t descriptor_type = descriptor[1];
+
+		// A zero-length record would never let us make progress; treat it
+		// (and any record that overruns the blob) as the end of the walk.
+		if ((descriptor_length < 2) || (offset + descriptor_length > cache->raw_length)) {
+			break;
+		}
+
+		switch (descriptor_type) {
+
+			case USB_DESCRIPTOR_TYPE_CONFIGURATION:
+				if (descriptor_length > USB_CONFIGURATION_DESCRIPTOR_OFFSET_CONFIG_VALUE) {
+					cache->configuration_value =
+						descriptor[USB_CONFIGURATION_DESCRIPTOR_OFFSET_CONFIG_VALUE];
+				}
+				break;
+
+			case USB_DESCRIPTOR_TYPE_INTERFACE:
+				if (cache->interface_count < USB_HOST_MAX_CACHED_INTERFACES) {
+					usb_host_cached_interface_t *interface =
+						&cache->interfaces[cache->interface_count];
+
+					interface->interface_number    = descriptor[USB_INTERFACE_DESCRIPTOR_OFFSET_NUMBER];
+					interface->alternate_setting   = descriptor[USB_INTERFACE_DESCRIPTOR_OFFSET_ALTERNATE];
+					interface->interface_class     = descriptor[USB_INTERFACE_DESCRIPTOR_OFFSET_CLASS];
+					interface->interface_subclass  = descriptor[USB_INTERFACE_DESCRIPTOR_OFFSET_SUBCLASS];
+					interface->interface_protocol  = descriptor[USB_INTERFACE_DESCRIPTOR_OFFSET_PROTOCOL];
+					interface->endpoint_count      = 0;
+					interface->first_endpoint_index = cache->endpoint_count;
+
+					current_interface = cache->interface_count;
+					cache->interface_count++;
+				} else {
+					current_interface = -1;
+				}
+				break;
+
+			case USB_DESCRIPTOR_TYPE_ENDPOINT:
+				if ((current_interface >= 0) &&
+						(cache->endpoint_count < USB_HOST_MAX_CACHED_ENDPOINTS)) {
+					usb_host_cached_endpoint_t *endpoint =
+						&cache->endpoints[cache->endpoint_count];
+
+					endpoint->address         = descriptor[USB_ENDPOINT_DESCRIPTOR_OFFSET_ADDRESS];
+					endpoint->attributes      = descriptor[USB_ENDPOINT_DESCRIPTOR_OFFSET_ATTRIBUTES];
+					endpoint->max_packet_size =
+						descriptor[USB_ENDPOINT_DESCRIPTOR_OFFSET_MAX_PACKET_SIZE] |
+						(descriptor[USB_ENDPOINT_DESCRIPTOR_OFFSET_MAX_PACKET_SIZE + 1] << 8);
+					endpoint->interval        = descriptor[USB_ENDPOINT_DESCRIPTOR_OFFSET_INTERVAL];
+					endpoint->interface_index = current_interface;
+
+					cache->interfaces[current_interface].endpoint_count++;
+					cache->endpoint_count++;
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		offset += descriptor_length;
+	}
+}
+
+
+/**
+ * Populates an enumeration cache for the attached device: fetches the full
+ * configuration blob in a single control transfer (after one short read for
+ * its total length), and parses its interfaces and endpoints into the
+ * cache's indexes.
+ *
+ * @param host The USB peripheral to work with.
+ * @param qh The endpoint object for the device's control endpoint.
+ * @param cache The cache to populate; any previous contents are freed.
+ * @return 0 on success, -ENOMEM if the blob couldn't be allocated, or
+ *		another negative error code if the bus reads failed
+ */
+int usb_host_cache_configuration(usb_peripheral_t *host,
+	ehci_queue_head_t *qh, usb_host_configuration_cache_t *cache)
+{
+	uint8_t header[USB_CONFIGURATION_DESCRIPTOR_LENGTH];
+	uint16_t total_length;
+	int rc;
+
+	// Discard any previous contents, so a failed refresh can't leave a
+	// stale index pointing into a freed blob.
+	usb_host_free_configuration_cache(cache);
+
+	// First, read just the configuration descriptor itself, to learn the
+	// total length of it and its subordinates.
+	rc = usb_host_read_configuration_desriptors(host, qh, header, sizeof(header));
+	if (rc < 0) {
+		return rc;
+	}
+	if (rc < USB_CONFIGURATION_DESCRIPTOR_LENGTH) {
+		return -EIO;
+	}
+
+	total_length = header[USB_CONFIGURATION_DESCRIPTOR_OFFSET_TOTAL_LENGTH] |
+		(header[USB_CONFIGURATION_DESCRIPTOR_OFFSET_TOTAL_LENGTH + 1] << 8);
+	if (total_length < USB_CONFIGURATION_DESCRIPTOR_LENGTH) {
+		return -EIO;
+	}
+
+	cache->raw = malloc(total_length);
+	if (!cache->raw) {
+		return -ENOMEM;
+	}
+
+	// Fetch the full blob -- the single bus read this cache will ever make
+	// for descriptor data -- and index it.
+	rc = usb_host_read_configuration_desriptors(host, qh, cache->raw, total_length);
+	if (rc < 0) {
+		usb_host_free_configuration_cache(cache);
+		return rc;
+	}
+
+	// Tolerate devices that return less than they advertised; we index only
+	// what we actually received.
+	cache->raw_length = rc;
+	usb_host_index_cached_configuration(cache);
+
+	return 0;
+}
+
+
+/**
+ * Releases an enumeration cache's backing allocation, returning it to the
+ * unpopulated state.
+ */
+void usb_host_free_configuration_cache(usb_host_configuration_cache_t *cache)
+{
+	if (cache->raw) {
+		free(cache->raw);
+	}
+	memset(cache, 0, sizeof(*cache));
+}
+
+
+/**
+ * Finds an interface in an enumeration cache without touching the bus.
+ *
+ * @return the cached interface, or NULL if the cache holds no such interface
+ */
+usb_host_cached_interface_t *usb_host_find_cached_interface(
+	usb_host_configuration_cache_t *cache, uint8_t interface_number,
+	uint8_t alternate_setting)
+{
+	for (unsigned i = 0; i < cache->interface_count; ++i) {
+		usb_host_cached_interface_t *interface = &cache->interfaces[i];
+
+		if ((interface->interface_number == interface_number) &&
+				(interface->alternate_setting == alternate_setting)) {
+			return interface;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Finds an endpoint in an enumeration cache by address (including its
+ * direction bit) without touching the bus.
+ *
+ * @return the cached endpoint, or NULL if the cache holds no such endpoint
+ */
+usb_host_cached_endpoint_t *usb_host_find_cached_endpoint(
+	usb_host_configuration_cache_t *cache, uint8_t address)
+{
+	for (unsigned i = 0; i < cache->endpoint_count; ++i) {
+		if (cache->endpoints[i].address == address) {
+			return &cache->endpoints[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Finds the first endpoint of the given transfer type and direction --
+ * optionally restricted to a single cached interface -- without touching
+ * the bus.
+ *
+ * @return the cached endpoint, or NULL if no endpoint matches
+ */
+usb_host_cached_endpoint_t *usb_host_find_cached_endpoint_by_type(
+	usb_host_configuration_cache_t *cache, uint8_t transfer_type, bool is_in,
+	const usb_host_cached_interface_t *interface)
+{
+	unsigned first = 0;
+	unsigned count = cache->endpoint_count;
+
+	// If we're restricted to a single interface, its endpoints are
+	// contiguous in the endpoint table.
+	if (interface) {
+		first = interface->first_endpoint_index;
+		count = interface->endpoint_count;
+	}
+
+	for (unsigned i = first; i < first + count; ++i) {
+		usb_host_cached_endpoint_t *endpoint = &cache->endpoints[i];
+		bool endpoint_is_in = (endpoint->address & 0x80);
+
+		if (((endpoint->attributes & 0x03) == transfer_type) &&
+				(endpoint_is_in == is_in)) {
+			return endpoint;
+		}
+	}
+
+	return NULL;
+}
+
+
+//
+// Asynchronous operations.
+//
+// The transfer layer below us (usb_queue_host.c) already completes individual
+// qTDs via interrupt-driven callbacks; the functions here build on that to
+// provide non-blocking versions of the stack's operations, so host-mode
+// proxying can overlap upstream and downstream transfers instead of spinning
+// on each one. Control requests chain their SETUP/DATA/ACK stages from each
+// stage's completion interrupt; completions can optionally be deferred to the
+// scheduler for handlers too heavy to run from an ISR.
+//
+
+/** Total number of asynchronous operations that can be in flight at once. */
+#define USB_HOST_MAX_ASYNC_OPERATIONS 8
+
+/** Depth of the ring carrying scheduler-deferred completions. */
+#define USB_HOST_DEFERRED_COMPLETION_RING_SIZE 16
+
+/** Stages of an asynchronous control request. */
+enum usb_host_async_stage {
+	USB_HOST_ASYNC_STAGE_SETUP,
+	USB_HOST_ASYNC_STAGE_DATA,
+	USB_HOST_ASYNC_STAGE_ACK,
+};
+
+/**
+ * Internal state for a single in-flight asynchronous operation.
+ */
+struct usb_host_async_operation {
+	volatile bool in_use;
+
+	usb_peripheral_t *host;
+	ehci_queue_head_t *qh;
+
+	// The caller's completion callback, and how to deliver it.
+	usb_host_async_completion_cb callback;
+	void *user_data;
+	bool defer_completion;
+
+	// Control-request state machine; unused for plain endpoint transfers.
+	bool is_control;
+	enum usb_host_async_stage stage;
+	usb_setup_t setup_packet;
+	void *buffer;
+	uint16_t length;
+	usb_token_t data_token;
+	usb_token_t ack_token;
+	uint32_t data_transferred;
+};
+
+/** A single completion waiting to be delivered from the scheduler. */
+struct usb_host_deferred_completion {
+	usb_host_async_completion_cb callback;
+	void *user_data;
+	int status;
+	uint32_t length_transferred;
+};
+
+// Pool of asynchronous operation state, claimed at submission time.
+static struct usb_host_async_operation async_operation_pool[USB_HOST_MAX_ASYNC_OPERATIONS];
+
+// Single-producer (ISR), single-consumer (scheduler task) completion ring.
+static struct usb_host_deferred_completion deferred_completion_ring[USB_HOST_DEFERRED_COMPLETION_RING_SIZE];
+static volatile uint32_t deferred_completion_write_index;
+static volatile uint32_t deferred_completion_read_index;
+
+// True once our deferred-completion task has been registered.
+static bool deferred_completion_task_registered;
+
+
+/**
+ * Scheduler task that delivers any completions deferred out of ISR context.
+ */
+static void usb_host_deferred_completion_task(void)
+{
+	while (deferred_completion_read_index != deferred_completion_write_index) {
+		struct usb_host_deferred_completion *completion =
+			&deferred_completion_ring[deferred_completion_read_index % USB_HOST_DEFERRED_COMPLETION_RING_SIZE];
+
+		completion->callback(completion->user_data, completion->status,
+				completion->length_transferred);
+		++deferred_completion_read_index;
+	}
+}
+
+
+/**
+ * Claims an asynchronous operation slot from the pool, if one is free.
+ */
+static struct usb_host_async_operation *usb_host_allocate_async_operation(void)
+{
+	struct usb_host_async_operation *operation = NULL;
+
+	cm_disable_interrupts();
+	for (unsigned i = 0; i < USB_HOST_MAX_ASYNC_OPERATIONS; ++i) {
+		if (!async_operation_pool[i].in_use) {
+			async_operation_pool[i].in_use = true;
+			operation = &async_operation_pool[i];
+			break;
+		}
+	}
+	cm_enable_interrupts();
+
+	return operation;
+}
+
+
+/**
+ * Finishes an asynchronous operation: releases its slot and delivers its
+ * completion, either immediately or from the scheduler's next round.
+ */
+static void usb_host_finish_async_operation(struct usb_host_async_operation *operation,
+	int status, uint32_t length_transferred)
+{
+	usb_host_async_completion_cb callback = operation->callback;
+	void *user_data = operation->user_data;
+	bool defer = operation->defer_completion;
+
+	// Release the operation before delivering its completion, so the
+	// callback can immediately submit a follow-up operation.
+	operation->in_use = false;
+
+	if (!callback) {
+		return;
+	}
+
+	if (defer) {
+		struct usb_host_deferred_completion *completion =
+			&deferred_completion_ring[deferred_completion_write_index % USB_HOST_DEFERRED_COMPLETION_RING_SIZE];
+
+		completion->callback = callback;
+		completion->user_data = user_data;
+		completion->status = status;
+		completion->length_transferred = length_transferred;
+		++deferred_completion_write_index;
+
+		scheduler_mark_task_ready(usb_host_deferred_completion_task);
+	} else {
+		callback(user_data, status, length_transferred);
+	}
+}
+
+
+/**
+ * Transfer-layer completion handler for asynchronous operations: advances
+ * control requests to their next stage, and finishes everything else.
+ * Runs from interrupt context.
+ */
+static void usb_host_async_stage_complete(void *user_data, unsigned int transferred,
+	bool stalled, bool error)
+{
+	struct usb_host_async_operation *operation = user_data;
+	int rc;
+
+	// Any wire-level failure ends the operation immediately.
+	if (error || stalled) {
+		usb_host_finish_async_operation(operation, error ? EIO : EPIPE,
+				operation->data_transferred);
+		return;
+	}
+
+	// Plain endpoint transfers are single-stage; we're done.
+	if (!operation->is_control) {
+		usb_host_finish_async_operation(operation, 0, transferred);
+		return;
+	}
+
+	switch (operation->stage) {
+
+		// Our SETUP packet has been accepted; issue the data stage if the
+		// request carries one, or skip straight to the acknowledgement.
+		case USB_HOST_ASYNC_STAGE_SETUP:
+			if (operation->length) {
+				operation->stage = USB_HOST_ASYNC_STAGE_DATA;
+				rc = usb_host_transfer_schedule(operation->host, operation->qh,
+						operation->data_token, 1, operation->buffer, operation->length,
+						usb_host_async_stage_complete, operation);
+			} else {
+				operation->stage = USB_HOST_ASYNC_STAGE_ACK;
+				rc = usb_host_transfer_schedule(operation->host, operation->qh,
+						USB_PID_TOKEN_IN, 1, NULL, 0,
+						usb_host_async_stage_complete, operation);
+			}
+			break;
+
+		// Our data stage is complete; issue the acknowledgement stage.
+		case USB_HOST_ASYNC_STAGE_DATA:
+			operation->data_transferred = transferred;
+			operation->stage = USB_HOST_ASYNC_STAGE_ACK;
+			rc = usb_host_transfer_schedule(operation->host, operation->qh,
+					operation->ack_token, 1, NULL, 0,
+					usb_host_async_stage_complete, operation);
+			break;
+
+		// The acknowledgement is complete; the whole request succeeded.
+		case USB_HOST_ASYNC_STAGE_ACK:
+		default:
+			usb_host_finish_async_operation(operation, 0, operation->data_transferred);
+			return;
+	}
+
+	// If we couldn't schedule the next stage, report the failure.
+	if (rc) {
+		usb_host_finish_async_operation(operation, rc, operation->data_transferred);
+	}
+}
+
+
+/**
+ * Sets up the common fields of an asynchronous operation, registering our
+ * deferred-completion task on first use.
+ */
+static struct usb_host_async_operation *usb_host_begin_async_operation(
+	usb_peripheral_t *host, ehci_queue_head_t *qh, bool defer_completion,
+	usb_host_async_completion_cb callback, void *user_data)
+{
+	struct usb_host_async_operation *operation;
+
+	// Lazily register the task that delivers deferred completions.
+	if (defer_completion && !deferred_completion_task_registered) {
+		scheduler_register_task(usb_host_deferred_completion_task, SCHEDULER_DEFAULT_PRIORITY);
+		deferred_completion_task_registered = true;
+	}
+
+	operation = usb_host_allocate_async_operation();
+	if (!operation) {
+		return NULL;
+	}
+
+	operation->host = host;
+	operation->qh = qh;
+	operation->callback = callback;
+	operation->user_data = user_data;
+	operation->defer_completion = defer_completion;
+	operation->data_transferred = 0;
+
+	return operation;
+}
+
+
+/**
+ * Issues a control request to the device without blocking; see the header
+ * for the semantics.
+ *
+ * @return 0 if the request was submitted, or an error code on failure
+ */
+int usb_host_control_request_async(usb_peripheral_t *host,
+	ehci_queue_head_t *qh, usb_setup_request_type_t request_type, uint8_t request,
+	uint16_t value, uint16_t index, uint16_t length, void *buffer,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data)
+{
+	struct usb_host_async_operation *operation;
+	int rc;
+
+	operation = usb_host_begin_async_operation(host, qh, defer_completion, callback, user_data);
+	if (!operation) {
+		return EBUSY;
+	}
+
+	// Compose the setup packet in the operation itself, so it outlives
+	// this call for the duration of the DMA transfer.
+	operation->setup_packet = (usb_setup_t) {
+		.request_type = request_type,
+		.request = request,
+		.value = value,
+		.index = index,
+		.length = length
+	};
+
+	operation->is_control = true;
+	operation->stage = USB_HOST_ASYNC_STAGE_SETUP;
+	operation->buffer = buffer;
+	operation->length = length;
+
+	// If this is a DEVICE_TO_HOST, our data stage should be an IN.
+	if (request_type & USB_SETUP_REQUEST_TYPE_DATA_TRANSFER_DIRECTION_DEVICE_TO_HOST) {
+		operation->data_token = USB_PID_TOKEN_IN;
+		operation->ack_token  = USB_PID_TOKEN_OUT;
+	} else {
+		operation->data_token = USB_PID_TOKEN_OUT;
+		operation->ack_token  = USB_PID_TOKEN_IN;
+	}
+
+	// Kick the state machine off with the setup stage; each following stage
+	// is chained from its predecessor's completion interrupt.
+	rc = usb_host_transfer_schedule(host, qh, USB_PID_TOKEN_SETUP, 0,
+			&operation->setup_packet, sizeof(operation->setup_packet),
+			usb_host_async_stage_complete, operation);
+	if (rc) {
+		operation->in_use = false;
+	}
+
+	return rc;
+}
+
+
+/**
+ * Schedules a transfer on the given endpoint without blocking; see the
+ * header for the semantics.
+ *
+ * @return 0 if the transfer was submitted, or an error code on failure
+ */
+int usb_host_transfer_async(usb_peripheral_t *host, ehci_queue_head_t *endpoint,
+	usb_token_t pid_code, int data_toggle, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data)
+{
+	struct usb_host_async_operation *operation;
+	int rc;
+
+	operation = usb_host_begin_async_operation(host, endpoint, defer_completion, callback, user_data);
+	if (!operation) {
+		return EBUSY;
+	}
+
+	operation->is_control = false;
+
+	rc = usb_host_transfer_schedule(host, endpoint, pid_code, data_toggle,
+			data, length, usb_host_async_stage_complete, operation);
+	if (rc) {
+		operation->in_use = false;
+	}
+
+	return rc;
+}
+
+
+/**
+ * Convenience function that receives data on a given endpoint without
+ * blocking; see usb_host_transfer_async.
+ */
+int usb_host_read_from_endpoint_async(usb_peripheral_t *host,
+	ehci_queue_head_t *endpoint, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data)
+{
+	return usb_host_transfer_async(host, endpoint, USB_PID_TOKEN_IN, 0,
+			data, length, defer_completion, callback, user_data);
+}
+
+
+/**
+ * Convenience function that sends data on a given endpoint without
+ * blocking; see usb_host_transfer_async.
+ */
+int usb_host_send_on_endpoint_async(usb_peripheral_t *host,
+	ehci_queue_head_t *endpoint, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data)
+{
+	return usb_host_transfer_async(host, endpoint, USB_PID_TOKEN_OUT, 0,
+			data, length, defer_completion, callback, user_data);
+}
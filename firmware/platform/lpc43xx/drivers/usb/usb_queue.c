@@ -23,8 +23,45 @@
 
 usb_queue_t* endpoint_queues[NUM_USB_CONTROLLERS][12] = {};
 
+// Per-endpoint performance counters; see usb_endpoint_stats_t.
+static usb_endpoint_stats_t endpoint_stats[NUM_USB_CONTROLLERS][12];
+
 #define USB_ENDPOINT_INDEX(endpoint_address) (((endpoint_address & 0xF) * 2) + ((endpoint_address >> 7) & 1))
 
+usb_endpoint_stats_t* usb_endpoint_stats_for_address(
+		uint8_t controller, uint8_t endpoint_address)
+{
+		uint32_t index = USB_ENDPOINT_INDEX(endpoint_address);
+
+		if ((controller >= NUM_USB_CONTROLLERS) || (index >= 12))
+			return NULL;
+
+		return &endpoint_stats[controller][index];
+}
+
+
+/* Returns the counters for a live endpoint object. */
+static usb_endpoint_stats_t* endpoint_stats_for(const usb_endpoint_t* const endpoint)
+{
+		return &endpoint_stats[endpoint->device->controller][USB_ENDPOINT_INDEX(endpoint->address)];
+}
+
+
+void usb_stats_note_prime_wait(const usb_endpoint_t* const endpoint, uint32_t spins)
+{
+		usb_endpoint_stats_t* stats = endpoint_stats_for(endpoint);
+
+		if (spins > stats->max_prime_wait_spins)
+			stats->max_prime_wait_spins = spins;
+}
+
+
+/* Charges a failed schedule attempt to the endpoint's exhaustion counter. */
+static void note_pool_exhaustion(const usb_endpoint_t* const endpoint)
+{
+		endpoint_stats_for(endpoint)->pool_exhaustions++;
+}
+
 static usb_queue_t* endpoint_queue(
 		const usb_endpoint_t* const endpoint
 ) {
@@ -55,17 +92,27 @@ void usb_queue_init(
 		t->queue = queue;
 }
 
-/* Allocate a transfer */
+/* Allocate a transfer. Non-blocking: returns NULL immediately on an empty
+ * pool. Lock-free, so ISR completion and task-level submission can race this
+ * without masking interrupts.
+ */
 static usb_transfer_t* allocate_transfer(
 		usb_queue_t* const queue
 ) {
 		bool aborted;
 		usb_transfer_t* transfer;
-		if (queue->free_transfers == NULL)
-				return NULL;
 
 		do {
 				transfer = (void *) __ldrex((uint32_t *) &queue->free_transfers);
+
+				// The emptiness check must happen inside the exclusive pair:
+				// a competing context can drain the pool between a plain read
+				// and our LDREX, and we'd chase a stale head.
+				if (transfer == NULL) {
+						__asm__ volatile ("clrex");
+						return NULL;
+				}
+
 				aborted = __strex((uint32_t) transfer->next, (uint32_t *) &queue->free_transfers);
 		} while (aborted);
 
@@ -103,26 +150,26 @@ static usb_transfer_t* endpoint_queue_transfer(
 		}
 }
 
-int usb_transfer_schedule(
-	const usb_endpoint_t* const endpoint,
-	void* const data,
-	const uint32_t maximum_length,
+/* Populates a transfer's descriptor and bookkeeping for a single buffer. */
+static void configure_transfer(
+		usb_transfer_t* const transfer,
+		void* const data,
+		const uint32_t maximum_length,
+		const bool interrupt_on_complete,
+		const uint_fast8_t iso_transactions,
 		const transfer_completion_cb completion_cb,
 		void* const user_data
 ) {
-		usb_queue_t* const queue = endpoint_queue(endpoint);
-		usb_transfer_t* const transfer = allocate_transfer(queue);
-		if (transfer == NULL)
-			return ENOSPC;
-
 		usb_transfer_descriptor_t* const td = &transfer->td;
 
-	// Configure the transfer descriptor
+	// Configure the transfer descriptor. The MULTO field must be zero for
+	// non-isochronous endpoints; for isochronous ones, it carries the number
+	// of transactions to execute per microframe for this descriptor.
 		td->next_dtd_pointer = USB_TD_NEXT_DTD_POINTER_TERMINATE;
 	td->total_bytes =
 		  USB_TD_DTD_TOKEN_TOTAL_BYTES(maximum_length)
-		| USB_TD_DTD_TOKEN_IOC
-		| USB_TD_DTD_TOKEN_MULTO(0)
+		| (interrupt_on_complete ? USB_TD_DTD_TOKEN_IOC : 0)
+		| USB_TD_DTD_TOKEN_MULTO(iso_transactions)
 		| USB_TD_DTD_TOKEN_STATUS_ACTIVE ;
 	td->buffer_pointer_page[0] =  (uint32_t)data;
 	td->buffer_pointer_page[1] = ((uint32_t)data + 0x1000) & 0xfffff000;
@@ -134,8 +181,13 @@ int usb_transfer_schedule(
 		transfer->maximum_length = maximum_length;
 		transfer->completion_cb = completion_cb;
 		transfer->user_data = user_data;
+}
 
-		cm_disable_interrupts();
+
+/* Links a configured transfer onto the endpoint's hardware queue. Must be
+ * called with interrupts disabled. */
+static void enqueue_configured_transfer(usb_queue_t* const queue, usb_transfer_t* const transfer)
+{
 		usb_transfer_t* tail = endpoint_queue_transfer(transfer);
 		if (tail == NULL) {
 				// The queue is currently empty, we need to re-prime
@@ -144,10 +196,106 @@ int usb_transfer_schedule(
 				// The queue is currently running, try to append
 				usb_endpoint_schedule_append(queue->endpoint, &tail->td, &transfer->td);
 		}
+}
+
+
+int usb_transfer_schedule(
+	const usb_endpoint_t* const endpoint,
+	void* const data,
+	const uint32_t maximum_length,
+		const transfer_completion_cb completion_cb,
+		void* const user_data
+) {
+		usb_queue_t* const queue = endpoint_queue(endpoint);
+		usb_transfer_t* const transfer = allocate_transfer(queue);
+		if (transfer == NULL) {
+			note_pool_exhaustion(endpoint);
+			return ENOSPC;
+		}
+
+		configure_transfer(transfer, data, maximum_length, true, 0, completion_cb, user_data);
+
+		cm_disable_interrupts();
+		enqueue_configured_transfer(queue, transfer);
+		cm_enable_interrupts();
+		return 0;
+}
+
+
+int usb_transfer_schedule_vector(
+	const usb_endpoint_t* const endpoint,
+	const usb_transfer_segment_t* const segments,
+	const unsigned int segment_count,
+		const transfer_completion_cb completion_cb,
+		void* const user_data
+) {
+		usb_queue_t* const queue = endpoint_queue(endpoint);
+		usb_transfer_t* transfers[USB_TRANSFER_MAX_SEGMENTS];
+
+		if ((segment_count == 0) || (segment_count > USB_TRANSFER_MAX_SEGMENTS))
+			return EINVAL;
+
+		// Allocate every descriptor up front, so a mid-chain exhaustion
+		// can't leave a partial transfer on the wire.
+		for (unsigned int i = 0; i < segment_count; i++) {
+				transfers[i] = allocate_transfer(queue);
+				if (transfers[i] == NULL) {
+						while (i--)
+								free_transfer(transfers[i]);
+						note_pool_exhaustion(endpoint);
+						return ENOSPC;
+				}
+		}
+
+		// Configure one descriptor per segment. Only the final segment
+		// interrupts and carries the completion callback; intermediate
+		// segments complete silently as the controller chains through them.
+		for (unsigned int i = 0; i < segment_count; i++) {
+				bool is_last = (i == (segment_count - 1));
+				configure_transfer(transfers[i], segments[i].data, segments[i].length,
+						is_last, 0, is_last ? completion_cb : NULL, is_last ? user_data : NULL);
+		}
+
+		// Queue the whole chain atomically, so the controller sees it as one
+		// contiguous run of descriptors.
+		cm_disable_interrupts();
+		for (unsigned int i = 0; i < segment_count; i++) {
+				enqueue_configured_transfer(queue, transfers[i]);
+		}
 		cm_enable_interrupts();
 		return 0;
 }
 
+int usb_transfer_schedule_isochronous(
+	const usb_endpoint_t* const endpoint,
+	void* const data,
+	const uint32_t maximum_length,
+	const uint_fast8_t transactions_per_microframe,
+	const transfer_completion_cb completion_cb,
+	void* const user_data
+) {
+		usb_queue_t* const queue = endpoint_queue(endpoint);
+		usb_transfer_t* transfer;
+
+		if ((transactions_per_microframe == 0) || (transactions_per_microframe > 3))
+			return EINVAL;
+
+		transfer = allocate_transfer(queue);
+		if (transfer == NULL) {
+			note_pool_exhaustion(endpoint);
+			return ENOSPC;
+		}
+
+		configure_transfer(transfer, data, maximum_length, true,
+				transactions_per_microframe, completion_cb, user_data);
+
+		cm_disable_interrupts();
+		enqueue_configured_transfer(queue, transfer);
+		cm_enable_interrupts();
+		return 0;
+}
+
+
 int usb_transfer_schedule_wait(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
@@ -195,10 +343,91 @@ int usb_transfer_schedule_ack(
 
 
 
+/*
+ * Completion trampoline for double-buffered mode: hands the completed buffer
+ * to the user's callback, then immediately re-arms it. Runs in the
+ * transfer-complete ISR, so the endpoint is re-primed before the host's next
+ * transaction rather than on the next main-loop pass.
+ */
+static void usb_queue_pingpong_completion(void* user_data, unsigned int transferred)
+{
+		struct _usb_pingpong_slot_t* slot = user_data;
+		usb_queue_t* const queue = slot->queue;
+		int rc;
+
+		if (queue->pingpong_completion_cb) {
+				queue->pingpong_completion_cb(slot->buffer, transferred);
+		}
+
+		// If ping-pong mode has been stopped, don't re-arm.
+		if (!queue->pingpong_active) {
+				return;
+		}
+
+		rc = usb_transfer_schedule(queue->endpoint, slot->buffer,
+				queue->pingpong_buffer_size, usb_queue_pingpong_completion, slot);
+		if (rc) {
+				pr_error("usb error: could not re-arm ping-pong buffer (%d)!\n", rc);
+		}
+}
+
+
+int usb_queue_start_pingpong(
+	usb_endpoint_t* const endpoint,
+	void* const buffer_a,
+	void* const buffer_b,
+	const uint32_t buffer_size,
+	const transfer_completion_cb completion_cb
+) {
+		usb_queue_t* const queue = endpoint_queue(endpoint);
+		int rc;
+
+		if (queue == NULL)
+				return EINVAL;
+		if (queue->pingpong_active)
+				return EBUSY;
+
+		queue->pingpong_slots[0].queue = queue;
+		queue->pingpong_slots[0].buffer = buffer_a;
+		queue->pingpong_slots[1].queue = queue;
+		queue->pingpong_slots[1].buffer = buffer_b;
+		queue->pingpong_buffer_size = buffer_size;
+		queue->pingpong_completion_cb = completion_cb;
+		queue->pingpong_active = true;
+
+		// Prime both buffers; from here on, each re-arms itself on completion.
+		for (unsigned int i = 0; i < 2; i++) {
+				rc = usb_transfer_schedule(endpoint, queue->pingpong_slots[i].buffer,
+						buffer_size, usb_queue_pingpong_completion, &queue->pingpong_slots[i]);
+				if (rc) {
+						queue->pingpong_active = false;
+						return rc;
+				}
+		}
+
+		return 0;
+}
+
+
+void usb_queue_stop_pingpong(
+	usb_endpoint_t* const endpoint
+) {
+		usb_queue_t* const queue = endpoint_queue(endpoint);
+
+		if (queue == NULL)
+				return;
+
+		queue->pingpong_active = false;
+}
+
+
 /* Called when an endpoint might have completed a transfer */
-static void usb_queue_clean_up_transfers(usb_endpoint_t const * endpoint, bool include_active)
+static void ATTR_HOT_RAM usb_queue_clean_up_transfers(usb_endpoint_t const * endpoint, bool include_active)
 {
 		usb_queue_t* const queue = endpoint_queue(endpoint);
+		usb_endpoint_stats_t* const stats = endpoint_stats_for(endpoint);
+		bool completed_any = false;
+
 		if (queue == NULL) {
 			pr_error("usb error: tried to clean up an endpoint (%d) with no queue!\n", endpoint->address);
 		}
@@ -260,6 +489,16 @@ static void usb_queue_clean_up_transfers(usb_endpoint_t const * endpoint, bool i
 				// Invoke completion callback
 				unsigned int total_bytes = (transfer->td.total_bytes & USB_TD_DTD_TOKEN_TOTAL_BYTES_MASK) >> USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT;
 				unsigned int transferred = transfer->maximum_length - total_bytes;
+
+				// Account for the retired transfer.
+				completed_any = true;
+				if (aborting) {
+						stats->transfer_errors++;
+				} else {
+						stats->transfers_completed++;
+						stats->bytes_transferred += transferred;
+				}
+
 				if (transfer->completion_cb)
 						transfer->completion_cb(transfer->user_data, transferred);
 
@@ -267,10 +506,16 @@ static void usb_queue_clean_up_transfers(usb_endpoint_t const * endpoint, bool i
 				free_transfer(transfer);
 				transfer = next;
 		}
+
+		// If retiring transfers left the endpoint with nothing queued, note the
+		// underrun; a climbing count here means software isn't keeping the
+		// endpoint fed.
+		if (completed_any && (queue->active == NULL))
+				stats->queue_empty_events++;
 }
 
 
-void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
+void ATTR_HOT_RAM usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
 {
 	usb_queue_clean_up_transfers(endpoint, false);
 }
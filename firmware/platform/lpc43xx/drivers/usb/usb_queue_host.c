@@ -22,6 +22,8 @@
 #include <libopencm3/cm3/cortex.h>
 #include <libopencm3/cm3/sync.h>
 
+#include <sync.h>
+
 /**
  *  Internal data structure describing the state of an blocking transfer.
  */
@@ -32,6 +34,10 @@ struct usb_host_blocking_transfer_state {
 	volatile bool error;
 };
 
+/** Event signaled by the completion ISR to wake a blocking transfer's waiter. */
+static event_t usb_host_blocking_transfer_event;
+#define USB_HOST_TRANSFER_COMPLETE_FLAG (1 << 0)
+
 // Storage pools for re-usable USB objects.
 static ehci_link_t queue_head_freelist;
 static ehci_link_t transfer_freelist;
@@ -508,10 +514,12 @@ static void usb_host_handle_blocking_transfer_complete(void *const user_data,
 {
 	volatile struct usb_host_blocking_transfer_state *state = user_data;
 
-	state->in_progress = false;
 	state->transferred = transferred;
 	state->stalled = stalled;
 	state->error = error;
+	state->in_progress = false;
+
+	libgreat_event_signal(&usb_host_blocking_transfer_event, USB_HOST_TRANSFER_COMPLETE_FLAG);
 }
 
 
@@ -544,6 +552,10 @@ int usb_host_transfer(usb_peripheral_t *host, ehci_queue_head_t *qh, const usb_t
 	int rc;
 	uint32_t time_base = get_time();
 
+	// Discard any completion signal left over from a transfer that outlived
+	// its waiter's timeout.
+	libgreat_event_init(&usb_host_blocking_transfer_event);
+
 	// Call the non-blocking variant of our function with a call-back that captures state.
 	// TODO: possibly encode the timeout into the USB transaction?
 	transfer_state.in_progress = true;
@@ -555,11 +567,21 @@ int usb_host_transfer(usb_peripheral_t *host, ehci_queue_head_t *qh, const usb_t
 		return rc;
 	}
 
-	// Loop until we complete or an error occurs.
+	// Sleep until the completion interrupt signals us, rather than spinning;
+	// re-check the actual transfer state on each wake-up.
 	while (transfer_state.in_progress) {
-		// If the timeout is set, and we've exceeded the timeout, abort with ETIMEDOUT.
-		if (timeout && (get_time_since(time_base) > timeout)) {
-			return ETIMEDOUT;
+		if (timeout) {
+			// If the timeout is set, and we've exceeded the timeout, abort with ETIMEDOUT.
+			uint32_t elapsed = get_time_since(time_base);
+			if (elapsed > timeout) {
+				return ETIMEDOUT;
+			}
+
+			libgreat_event_wait_timeout(&usb_host_blocking_transfer_event,
+					USB_HOST_TRANSFER_COMPLETE_FLAG, timeout - elapsed);
+		} else {
+			libgreat_event_wait(&usb_host_blocking_transfer_event,
+					USB_HOST_TRANSFER_COMPLETE_FLAG);
 		}
 	}
 
@@ -641,3 +663,202 @@ void usb_host_handle_asynchronous_transfer_complete(usb_peripheral_t *host)
 
 	}
 }
+
+
+/**
+ * Sets up an endpoint for hardware-scheduled polling on the periodic
+ * schedule (e.g. an interrupt endpoint).
+ *
+ * The polling interval is rounded down to a power of two of frames, and the
+ * queue head is inserted after the matching interval anchor, so the hardware
+ * visits the endpoint at the device-specified rate without any software
+ * timing. The periodic schedule is enabled as a side effect.
+ *
+ * @param host The host this endpoint queue is associated with.
+ * @param qh If provided, the endpoint QH object to set up. If NULL, one will
+ *		be automatically allocated and returned.
+ * @param device_address The address of the downstream device.
+ * @param endpoint_number The endpoint number of the endpoint being configured,
+ *		_not_ including the direction bit.
+ * @param endpoint_speed The speed of the endpoint. Should match the speed of
+ *		the attached device.
+ * @param handle_data_toggle If set, the endpoint should handle data toggling
+ *		automatically; recommended for interrupt endpoints.
+ * @param max_packet_size The maximum packet size transmissable on the endpoint.
+ * @param interval_frames The endpoint's polling interval, in frames (ms), as
+ *		reported in its endpoint descriptor.
+ */
+ehci_queue_head_t * usb_host_set_up_periodic_endpoint_queue(
+		usb_peripheral_t *host, ehci_queue_head_t *qh, uint8_t device_address,
+		uint8_t endpoint_number, usb_speed_t endpoint_speed,
+		bool handle_data_toggle, uint16_t max_packet_size, uint16_t interval_frames)
+{
+	int level = 0;
+	ehci_queue_head_t *anchor;
+
+	// If we weren't passed a QH, allocate one.
+	if(!qh)
+		qh = usb_host_allocate_queue_head();
+
+	// If we still don't have a QH, fail out.
+	if(!qh)
+		return NULL;
+
+	// Round the requested interval down to the largest power-of-two number
+	// of frames we support, selecting the anchor we'll chain from.
+	while ((level < (USB_HOST_PERIODIC_INTERVAL_LEVELS - 1)) &&
+			((interval_frames >> (level + 1)) != 0)) {
+		++level;
+	}
+	anchor = &host->periodic_interval_anchors[level];
+
+	// Ensure we're not modifying the schedule while the hardware walks it.
+	usb_host_disable_periodic_schedule(host);
+
+	// Set up the Queue Head object for use...
+	usb_host_initialize_queue_head(qh, device_address, endpoint_number,
+			endpoint_speed, false, handle_data_toggle, max_packet_size);
+
+	// ... mark it for execution in the first microframe of each visited
+	// frame...
+	qh->uframe_smask = 0x01;
+
+	// ... and insert it just after its interval's anchor.
+	qh->horizontal.link = anchor->horizontal.link;
+	anchor->horizontal.ptr = &qh->horizontal;
+	anchor->horizontal.type = DESCRIPTOR_QH;
+
+	usb_host_enable_periodic_schedule(host);
+
+	return qh;
+}
+
+
+/**
+ * Completion handler for periodic polls: posts the completed read into the
+ * poll's ring, and schedules the next one. Runs from interrupt context.
+ */
+static void usb_host_periodic_poll_complete(void *user_data,
+	unsigned int transferred, bool stalled, bool error)
+{
+	usb_host_periodic_poll_t *poll = user_data;
+	uint32_t slot;
+	int rc;
+
+	// If the poll has been stopped, or the endpoint failed, don't
+	// reschedule; a stall halts the queue head until the caller intervenes.
+	if (!poll->active) {
+		return;
+	}
+	if (stalled || error) {
+		poll->errors++;
+		poll->active = false;
+		return;
+	}
+
+	// If the consumer has fallen an entire ring behind, drop this result --
+	// overwriting its slot with the next poll -- rather than corrupt
+	// unconsumed data.
+	if ((poll->write_index - poll->read_index) >= poll->entry_count) {
+		poll->overruns++;
+	} else {
+		poll->lengths[poll->write_index % poll->entry_count] = transferred;
+		poll->write_index++;
+	}
+
+	// Schedule the next poll into the next free slot.
+	slot = poll->write_index % poll->entry_count;
+	rc = usb_host_transfer_schedule(poll->host, poll->qh, USB_PID_TOKEN_IN, 0,
+			poll->buffer + (slot * poll->entry_size), poll->entry_size,
+			usb_host_periodic_poll_complete, poll);
+	if (rc) {
+		poll->errors++;
+		poll->active = false;
+	}
+}
+
+
+/**
+ * Begins continuously reading from a periodic endpoint, posting each
+ * completed read into a ring buffer. Each hardware-scheduled poll that
+ * returns data lands in the next ring slot; consume results with
+ * usb_host_periodic_read_dequeue().
+ *
+ * @param poll The poll state object; must remain valid until stopped.
+ * @param host The host the endpoint belongs to.
+ * @param qh The endpoint's queue head, as set up by
+ *		usb_host_set_up_periodic_endpoint_queue.
+ * @param buffer The ring's backing storage; entry_count * entry_size bytes.
+ * @param entry_size The size of each ring slot; typically the endpoint's
+ *		maximum packet size.
+ * @param entry_count The number of slots in the ring.
+ * @param lengths Caller-provided array of entry_count elements, which
+ *		receives the actual length of each completed read.
+ * @return 0 on success, or an error code on failure
+ */
+int usb_host_periodic_read_start(usb_host_periodic_poll_t *poll,
+	usb_peripheral_t *host, ehci_queue_head_t *qh, void *buffer,
+	uint16_t entry_size, uint16_t entry_count, uint16_t *lengths)
+{
+	if (!buffer || !lengths || !entry_size || !entry_count) {
+		return EINVAL;
+	}
+
+	poll->host = host;
+	poll->qh = qh;
+	poll->buffer = buffer;
+	poll->entry_size = entry_size;
+	poll->entry_count = entry_count;
+	poll->lengths = lengths;
+	poll->write_index = 0;
+	poll->read_index = 0;
+	poll->overruns = 0;
+	poll->errors = 0;
+	poll->active = true;
+
+	// Prime the pump: schedule the first read; each completion schedules
+	// the next from interrupt context.
+	return usb_host_transfer_schedule(host, qh, USB_PID_TOKEN_IN, 0,
+			poll->buffer, poll->entry_size, usb_host_periodic_poll_complete, poll);
+}
+
+
+/**
+ * Stops a periodic read loop; the in-flight poll (if any) completes without
+ * rescheduling. Does not tear down the endpoint's queue head.
+ */
+void usb_host_periodic_read_stop(usb_host_periodic_poll_t *poll)
+{
+	poll->active = false;
+}
+
+
+/**
+ * Consumes the oldest unread result from a periodic read ring.
+ *
+ * @param out If non-NULL, receives a pointer to the result's data, valid
+ *		until entry_count further polls complete.
+ * @param out_length If non-NULL, receives the result's length in bytes.
+ * @return true iff a result was dequeued
+ */
+bool usb_host_periodic_read_dequeue(usb_host_periodic_poll_t *poll,
+	void **out, uint16_t *out_length)
+{
+	uint32_t slot;
+
+	if (poll->read_index == poll->write_index) {
+		return false;
+	}
+
+	slot = poll->read_index % poll->entry_count;
+
+	if (out) {
+		*out = poll->buffer + (slot * poll->entry_size);
+	}
+	if (out_length) {
+		*out_length = poll->lengths[slot];
+	}
+
+	poll->read_index++;
+	return true;
+}
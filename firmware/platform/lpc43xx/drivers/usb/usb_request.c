@@ -9,12 +9,12 @@
 #include <drivers/usb/comms_backend.h>
 
 #include <stdbool.h>
+#include <errno.h>
 
 /**
  *  Default, weak implementations of our USB request handlers.
- *  These can be overridden by target firmware.
- *
- *  TODO: re-architecture this to allow handler _registration_?
+ *  These can be overridden by target firmware, and serve as the fallback
+ *  for requests with no registered handler, below.
  */
 const WEAK usb_request_handlers_t usb0_request_handlers = {
 	.standard = usb_standard_request,
@@ -26,6 +26,108 @@ const WEAK usb_request_handlers_t usb1_request_handlers = {
 };
 
 
+/**
+ * Registered handlers for one (controller, type) pair, split by recipient:
+ * single slots for device- and other-directed requests, and small direct-
+ * indexed tables for interface- and endpoint-directed ones. Lookup is a
+ * pair of array indexes -- no search, and no chain of fallback calls.
+ */
+typedef struct {
+	usb_request_handler_fn device;
+	usb_request_handler_fn other;
+	usb_request_handler_fn interface[USB_REQUEST_MAX_INTERFACES];
+	usb_request_handler_fn endpoint[USB_REQUEST_MAX_ENDPOINTS];
+} usb_request_recipient_table_t;
+
+/** Registration tables, indexed by controller and then request type. */
+static usb_request_recipient_table_t
+		usb_registered_handlers[NUM_USB_CONTROLLERS][4];
+
+
+/**
+ * Registers a control request handler; see <drivers/usb/usb_request.h>.
+ */
+int usb_request_register_handler(uint32_t controller, uint8_t type,
+		uint8_t recipient, uint8_t target, usb_request_handler_fn handler)
+{
+	usb_request_recipient_table_t *table;
+
+	if (controller >= NUM_USB_CONTROLLERS) {
+		return EINVAL;
+	}
+	table = &usb_registered_handlers[controller][(type & USB_SETUP_REQUEST_TYPE_mask)
+			>> USB_SETUP_REQUEST_TYPE_shift];
+
+	switch (recipient) {
+	case USB_SETUP_REQUEST_RECIPIENT_DEVICE:
+		table->device = handler;
+		return 0;
+
+	case USB_SETUP_REQUEST_RECIPIENT_INTERFACE:
+		if (target >= USB_REQUEST_MAX_INTERFACES) {
+			return EINVAL;
+		}
+		table->interface[target] = handler;
+		return 0;
+
+	case USB_SETUP_REQUEST_RECIPIENT_ENDPOINT:
+		if (target >= USB_REQUEST_MAX_ENDPOINTS) {
+			return EINVAL;
+		}
+		table->endpoint[target] = handler;
+		return 0;
+
+	case USB_SETUP_REQUEST_RECIPIENT_OTHER:
+		table->other = handler;
+		return 0;
+
+	default:
+		return EINVAL;
+	}
+}
+
+
+/**
+ * Looks up the registered handler for the setup packet on the given
+ * endpoint, or NULL if the packet's key has no registration.
+ */
+static usb_request_handler_fn usb_request_find_registered_handler(
+	usb_endpoint_t* const endpoint
+) {
+	const usb_request_recipient_table_t *table;
+	uint8_t type      = (endpoint->setup.request_type & USB_SETUP_REQUEST_TYPE_mask)
+			>> USB_SETUP_REQUEST_TYPE_shift;
+	uint8_t recipient = endpoint->setup.request_type & USB_SETUP_REQUEST_RECIPIENT_mask;
+
+	// Interface- and endpoint-directed requests carry their target in the
+	// low byte of wIndex.
+	uint8_t target = endpoint->setup.index_l;
+
+	table = &usb_registered_handlers[endpoint->device->controller][type];
+
+	switch (recipient) {
+	case USB_SETUP_REQUEST_RECIPIENT_DEVICE:
+		return table->device;
+
+	case USB_SETUP_REQUEST_RECIPIENT_INTERFACE:
+		return (target < USB_REQUEST_MAX_INTERFACES) ? table->interface[target] : 0;
+
+	case USB_SETUP_REQUEST_RECIPIENT_ENDPOINT:
+		// For endpoints, the target is the number with its direction bit
+		// stripped.
+		target &= 0x0f;
+		return (target < USB_REQUEST_MAX_ENDPOINTS) ? table->endpoint[target] : 0;
+
+	case USB_SETUP_REQUEST_RECIPIENT_OTHER:
+		return table->other;
+
+	// Recipient values above OTHER are reserved; nothing registers them.
+	default:
+		return 0;
+	}
+}
+
+
 static void usb_request(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage
@@ -39,24 +141,29 @@ static void usb_request(
 	}
 
 	usb_request_status_t status = USB_REQUEST_STATUS_STALL;
-	usb_request_handler_fn handler = 0;
 
-	switch( endpoint->setup.request_type & USB_SETUP_REQUEST_TYPE_mask ) {
-	case USB_SETUP_REQUEST_TYPE_STANDARD:
-		handler = usb_request_handlers->standard;
-		break;
+	// A handler registered for exactly this (type, recipient, target) wins;
+	// otherwise, the request falls back to the per-type table above.
+	usb_request_handler_fn handler = usb_request_find_registered_handler(endpoint);
+
+	if( !handler ) {
+		switch( endpoint->setup.request_type & USB_SETUP_REQUEST_TYPE_mask ) {
+		case USB_SETUP_REQUEST_TYPE_STANDARD:
+			handler = usb_request_handlers->standard;
+			break;
 
-	case USB_SETUP_REQUEST_TYPE_CLASS:
-		handler = usb_request_handlers->class;
-		break;
+		case USB_SETUP_REQUEST_TYPE_CLASS:
+			handler = usb_request_handlers->class;
+			break;
 
-	case USB_SETUP_REQUEST_TYPE_VENDOR:
-		handler = usb_request_handlers->vendor;
-		break;
+		case USB_SETUP_REQUEST_TYPE_VENDOR:
+			handler = usb_request_handlers->vendor;
+			break;
 
-	case USB_SETUP_REQUEST_TYPE_RESERVED:
-		handler = usb_request_handlers->reserved;
-		break;
+		case USB_SETUP_REQUEST_TYPE_RESERVED:
+			handler = usb_request_handlers->reserved;
+			break;
+		}
 	}
 
 	if( handler ) {
@@ -11,6 +11,118 @@
 #include <drivers/usb/usb_type.h>
 #include <drivers/usb/usb_queue.h>
 
+//
+// Descriptor lookup cache.
+//
+// Enumeration issues a burst of GET_DESCRIPTOR requests, and each one used
+// to re-walk the configuration and string tables (and re-parse lengths) from
+// inside the setup ISR. The tables are fixed once the device is brought up,
+// so usb_standard_request_prepare_descriptors() -- called from
+// usb_device_init() -- resolves every descriptor to a {pointer, length} pair
+// up front, making each GET_DESCRIPTOR a table lookup plus queue submission.
+//
+
+#define USB_DESCRIPTOR_CACHE_MAX_CONFIGURATIONS 4
+#define USB_DESCRIPTOR_CACHE_MAX_STRINGS 16
+
+/** A fully-resolved descriptor: where it lives, and how much of it to send. */
+struct usb_descriptor_cache_entry {
+	const uint8_t *data;
+	uint16_t length;
+};
+
+struct usb_descriptor_cache {
+
+	// The device and device-qualifier descriptors.
+	struct usb_descriptor_cache_entry device;
+	struct usb_descriptor_cache_entry qualifier;
+
+	// Configuration descriptors, by descriptor index, for each of the two
+	// speeds a configuration can be provided for.
+	struct usb_descriptor_cache_entry full_speed_configurations[USB_DESCRIPTOR_CACHE_MAX_CONFIGURATIONS];
+	struct usb_descriptor_cache_entry high_speed_configurations[USB_DESCRIPTOR_CACHE_MAX_CONFIGURATIONS];
+
+	// String descriptors, by descriptor index.
+	struct usb_descriptor_cache_entry strings[USB_DESCRIPTOR_CACHE_MAX_STRINGS];
+
+	// True iff this cache has been populated.
+	bool valid;
+};
+
+/** Descriptor caches, one per USB controller. */
+static struct usb_descriptor_cache descriptor_caches[NUM_USB_CONTROLLERS];
+
+
+/**
+ * @return the configuration cache array for the given speed, or NULL if
+ *		configurations are never offered at that speed
+ */
+static struct usb_descriptor_cache_entry *usb_descriptor_cache_configurations(
+	struct usb_descriptor_cache *cache, usb_speed_t speed)
+{
+	switch (speed) {
+	case USB_SPEED_FULL:
+		return cache->full_speed_configurations;
+	case USB_SPEED_HIGH:
+		return cache->high_speed_configurations;
+	default:
+		return NULL;
+	}
+}
+
+
+/**
+ * Pre-resolves each of the given device's descriptors into the relevant
+ * controller's cache, so GET_DESCRIPTOR handling never has to walk the
+ * descriptor tables. Called from usb_device_init(); call again if the
+ * descriptor tables are ever replaced wholesale.
+ */
+void usb_standard_request_prepare_descriptors(usb_peripheral_t *const device)
+{
+	struct usb_descriptor_cache *cache = &descriptor_caches[device->controller];
+
+	// Start from an empty cache, in case we're re-preparing.
+	*cache = (struct usb_descriptor_cache){0};
+
+	if (device->descriptor) {
+		cache->device.data = device->descriptor;
+		cache->device.length = device->descriptor[0];
+	}
+	if (device->qualifier_descriptor) {
+		cache->qualifier.data = device->qualifier_descriptor;
+		cache->qualifier.length = device->qualifier_descriptor[0];
+	}
+
+	// Resolve each configuration into its speed's by-index table, parsing
+	// its total length out of the descriptor header once and for all.
+	if (device->configurations) {
+		uint8_t indices[USB_SPEED_SUPER + 1] = {0};
+
+		for (usb_configuration_t **config = *(device->configurations); *config; config++) {
+			struct usb_descriptor_cache_entry *entries =
+				usb_descriptor_cache_configurations(cache, (*config)->speed);
+			uint8_t index = indices[(*config)->speed]++;
+
+			if (!entries || (index >= USB_DESCRIPTOR_CACHE_MAX_CONFIGURATIONS)) {
+				continue;
+			}
+
+			entries[index].data = (*config)->descriptor;
+			entries[index].length = ((*config)->descriptor[3] << 8) | (*config)->descriptor[2];
+		}
+	}
+
+	if (device->descriptor_strings) {
+		for (uint8_t i = 0; (i < USB_DESCRIPTOR_CACHE_MAX_STRINGS) &&
+				device->descriptor_strings[i]; i++) {
+			cache->strings[i].data = device->descriptor_strings[i];
+			cache->strings[i].length = device->descriptor_strings[i][0];
+		}
+	}
+
+	cache->valid = true;
+}
+
 const uint8_t* usb_endpoint_descriptor(
 	const usb_endpoint_t* const endpoint
 ) {
@@ -90,86 +202,94 @@ bool usb_set_configuration(
 	return true;
 }
 
-static usb_request_status_t usb_send_descriptor(
+/**
+ * @return the descriptor cache for the given device, preparing it first if
+ *		it somehow hasn't been populated yet
+ */
+static struct usb_descriptor_cache *usb_descriptor_cache_for(usb_peripheral_t *const device)
+{
+	struct usb_descriptor_cache *cache = &descriptor_caches[device->controller];
+
+	if (!cache->valid) {
+		usb_standard_request_prepare_descriptors(device);
+	}
+
+	return cache;
+}
+
+
+/**
+ * Queues transmission of a pre-resolved descriptor, truncated to the length
+ * the host asked for.
+ */
+static usb_request_status_t usb_send_cached_descriptor(
 	usb_endpoint_t* const endpoint,
-	const uint8_t* const descriptor_data
+	const struct usb_descriptor_cache_entry *const entry
 ) {
 	const uint32_t setup_length = endpoint->setup.length;
-	uint32_t descriptor_length = descriptor_data[0];
-	if( descriptor_data[1] == USB_DESCRIPTOR_TYPE_CONFIGURATION ) {
-		descriptor_length = (descriptor_data[3] << 8) | descriptor_data[2];
+
+	if (!entry || !entry->data) {
+		return USB_REQUEST_STATUS_STALL;
 	}
+
 	// We cast the const away but this shouldn't be a problem as this is a write transfer
 	usb_transfer_schedule_block(
 		endpoint->in,
-		(uint8_t* const) descriptor_data,
-	 	(setup_length > descriptor_length) ? descriptor_length : setup_length,
+		(uint8_t*) entry->data,
+		(setup_length > entry->length) ? entry->length : setup_length,
 		NULL, NULL
 	);
 	usb_transfer_schedule_ack(endpoint->out);
 	return USB_REQUEST_STATUS_OK;
 }
 
-static usb_request_status_t usb_send_descriptor_string(
-	usb_endpoint_t* const endpoint
-) {
-	uint_fast8_t index = endpoint->setup.value_l;
-	for( uint_fast8_t i=0; endpoint->device->descriptor_strings[i] != 0; i++ ) {
-		if( i == index ) {
-			return usb_send_descriptor(endpoint, endpoint->device->descriptor_strings[i]);
-		}
-	}
-
-	return USB_REQUEST_STATUS_STALL;
-}
-
 static usb_request_status_t usb_send_descriptor_config(
 	usb_endpoint_t* const endpoint,
+	struct usb_descriptor_cache *const cache,
 	usb_speed_t speed,
 	const uint8_t config_num
 ) {
-	usb_configuration_t** config = *(endpoint->device->configurations);
-	unsigned int i = 0;
-	for( ; *config != NULL; config++ ) {
-		if( (*config)->speed == speed) {
-			if (i == config_num) {
-				return usb_send_descriptor(endpoint, (*config)->descriptor);
-			} else {
-				i++;
-			}
-		}
+	struct usb_descriptor_cache_entry *entries =
+		usb_descriptor_cache_configurations(cache, speed);
+
+	if (!entries || (config_num >= USB_DESCRIPTOR_CACHE_MAX_CONFIGURATIONS)) {
+		return USB_REQUEST_STATUS_STALL;
 	}
-	return USB_REQUEST_STATUS_STALL;
+
+	return usb_send_cached_descriptor(endpoint, &entries[config_num]);
 }
 
 static usb_request_status_t usb_standard_request_get_descriptor_setup(
 	usb_endpoint_t* const endpoint
 ) {
+	struct usb_descriptor_cache *cache = usb_descriptor_cache_for(endpoint->device);
+
 	switch( endpoint->setup.value_h ) {
 	case USB_DESCRIPTOR_TYPE_DEVICE:
-		return usb_send_descriptor(endpoint, endpoint->device->descriptor);
+		return usb_send_cached_descriptor(endpoint, &cache->device);
 
 	case USB_DESCRIPTOR_TYPE_CONFIGURATION:
-		// TODO: Duplicated code. Refactor.
 		if( usb_speed(endpoint->device) == USB_SPEED_HIGH ) {
-			return usb_send_descriptor_config(endpoint, USB_SPEED_HIGH, endpoint->setup.value_l);
+			return usb_send_descriptor_config(endpoint, cache, USB_SPEED_HIGH, endpoint->setup.value_l);
 		} else {
-			return usb_send_descriptor_config(endpoint, USB_SPEED_FULL, endpoint->setup.value_l);
+			return usb_send_descriptor_config(endpoint, cache, USB_SPEED_FULL, endpoint->setup.value_l);
 		}
 
 	case USB_DESCRIPTOR_TYPE_DEVICE_QUALIFIER:
-		return usb_send_descriptor(endpoint, endpoint->device->qualifier_descriptor);
+		return usb_send_cached_descriptor(endpoint, &cache->qualifier);
 
 	case USB_DESCRIPTOR_TYPE_OTHER_SPEED_CONFIGURATION:
-		// TODO: Duplicated code. Refactor.
 		if( usb_speed(endpoint->device) == USB_SPEED_HIGH ) {
-			return usb_send_descriptor_config(endpoint, USB_SPEED_FULL, endpoint->setup.value_l);
+			return usb_send_descriptor_config(endpoint, cache, USB_SPEED_FULL, endpoint->setup.value_l);
 		} else {
-			return usb_send_descriptor_config(endpoint, USB_SPEED_HIGH, endpoint->setup.value_l);
+			return usb_send_descriptor_config(endpoint, cache, USB_SPEED_HIGH, endpoint->setup.value_l);
 		}
 
 	case USB_DESCRIPTOR_TYPE_STRING:
-		return usb_send_descriptor_string(endpoint);
+		if( endpoint->setup.value_l >= USB_DESCRIPTOR_CACHE_MAX_STRINGS ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		return usb_send_cached_descriptor(endpoint, &cache->strings[endpoint->setup.value_l]);
 
 	case USB_DESCRIPTOR_TYPE_INTERFACE:
 	case USB_DESCRIPTOR_TYPE_ENDPOINT:
@@ -0,0 +1,106 @@
+/*
+ * This file is part of libgreat
+ *
+ * Crash telemetry: fault snapshots to persistent RAM, read out after reboot.
+ */
+
+#ifndef __LIBGREAT_ARM_FAULT_TELEMETRY_H__
+#define __LIBGREAT_ARM_FAULT_TELEMETRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A hard fault in the field is worth nothing unless someone has a UART
+ * attached -- and a handler that blocking-prints a dump keeps the device
+ * down for as long as it runs. This driver does the opposite: the fault
+ * handler snapshots the stacked register frame, the fault status registers,
+ * and a compact backtrace into persistent RAM (microseconds of work, no
+ * I/O), then resets immediately with RESET_REASON_FAULT. After the reboot,
+ * the snapshot survives in .bss.persistent -- which startup never clears --
+ * and the host collects it through the core class's fault-snapshot verbs.
+ */
+
+// Marks a snapshot as valid; chosen, like the reset reasons, to be unlikely
+// as uninitialized-RAM noise.
+#define FAULT_TELEMETRY_MAGIC 0xAA55FA17
+
+// Maximum call-stack depth preserved in a snapshot.
+#define FAULT_TELEMETRY_MAX_BACKTRACE 16
+
+/**
+ * A single crash snapshot, as preserved across the post-fault reboot.
+ */
+typedef struct {
+
+	// FAULT_TELEMETRY_MAGIC while a snapshot is valid.
+	uint32_t magic;
+
+	// Counts every fault captured since the region last lost power --
+	// so repeated crash loops are visible even though only the latest
+	// snapshot is kept.
+	uint32_t fault_count;
+
+	// The active exception number (from IPSR): 3 = hard fault,
+	// 4 = memory management, 5 = bus fault, 6 = usage fault.
+	uint32_t exception_number;
+
+	// The register frame the hardware stacked at fault entry.
+	uint32_t r0, r1, r2, r3, r12, lr, pc, psr;
+
+	// The faulting context's stack pointer (after hardware stacking was
+	// undone), and the EXC_RETURN value describing that context.
+	uint32_t sp;
+	uint32_t exception_return;
+
+	// Fault status: the configurable fault status register, the hard
+	// fault status register, and the memory-management / bus fault
+	// address registers (meaningful only when CFSR flags them valid).
+	uint32_t cfsr, hfsr, mmfar, bfar;
+
+	// Supervision context: the address of the task the scheduler was
+	// running at capture (zero outside watchdog-expiry snapshots, or when
+	// no scheduler is linked), and the DWT cycle count at capture.
+	uint32_t supervised_task;
+	uint32_t capture_cycle_count;
+
+	// Compact backtrace: return addresses, innermost first.
+	uint32_t backtrace_depth;
+	uint32_t backtrace[FAULT_TELEMETRY_MAX_BACKTRACE];
+
+} fault_telemetry_record_t;
+
+
+/**
+ * Installs the snapshot-and-reset fault handler on all four fault vectors,
+ * and enables the separable fault exceptions (so bus, usage, and memory
+ * management faults report their own status rather than escalating).
+ * Typically called from board bring-up, after the vector table is in RAM.
+ */
+void fault_telemetry_initialize(void);
+
+
+/**
+ * Installs the snapshot-and-reset handler on the watchdog's warning
+ * interrupt, so a watchdog expiry -- a task wedged past its deadline --
+ * preserves the wedged context (stacked pc, running task, cycle count)
+ * before the hardware reset lands. Called from the watchdog bring-up path;
+ * a weak stub there makes this optional, so supervision still resets
+ * without this module, just without the record.
+ */
+void fault_telemetry_watch_watchdog(void);
+
+
+/**
+ * @return the preserved crash snapshot, or NULL if none is valid
+ */
+const fault_telemetry_record_t *fault_telemetry_get_record(void);
+
+
+/**
+ * Invalidates any preserved crash snapshot, once the host has collected it.
+ * The fault count is kept, so crash loops remain countable.
+ */
+void fault_telemetry_clear(void);
+
+#endif
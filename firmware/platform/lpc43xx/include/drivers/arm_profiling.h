@@ -0,0 +1,115 @@
+/*
+ * This file is part of libgreat
+ *
+ * Cycle-accurate profiling instrumentation, built on the Cortex-M4 DWT
+ * cycle counter.
+ *
+ * Regions of interest are bracketed with profile_region_enter()/_exit(),
+ * which cost a counter read and a handful of arithmetic operations each --
+ * cheap enough for streaming hot paths. An optional statistical sampler,
+ * driven from a periodic timer callback, attributes wall time to whichever
+ * region is live at each sample, so contention between subsystems (e.g.
+ * SGPIO vs. USB) can be observed on deployed hardware.
+ *
+ * Results are exposed to the host through the core class's profiling verbs.
+ */
+
+#ifndef __LIBGREAT_ARM_PROFILING_H__
+#define __LIBGREAT_ARM_PROFILING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <toolchain.h>
+
+/** Maximum number of profile regions that can be registered. */
+#define PROFILE_MAX_REGIONS 16
+
+
+/**
+ * Register block for the ARM Data Watchpoint and Trace (DWT) unit --
+ * the subset relevant to cycle counting.
+ */
+typedef volatile struct ATTR_PACKED {
+
+	// Control register.
+	struct {
+		uint32_t cycle_counter_enabled :  1;
+		uint32_t                       : 31;
+	};
+
+	// The free-running processor cycle counter itself.
+	uint32_t cycle_count;
+
+} arm_dwt_register_block_t;
+
+
+/**
+ * @return a reference to the ARM DWT's cycle-counting registers
+ */
+arm_dwt_register_block_t *arch_get_dwt_registers(void);
+
+
+/**
+ * A single profiled region. Define statically (usually via
+ * PROFILE_DEFINE_REGION); registered automatically on first entry.
+ */
+typedef struct profile_region {
+
+	// A short, printable name for the region.
+	const char *name;
+
+	// Cycle-counter value captured at region entry.
+	uint32_t entry_cycle_count;
+
+	// Total cycles spent inside the region, and times it was entered.
+	uint32_t total_cycles;
+	uint32_t entry_count;
+
+	// Number of statistical-sampler hits attributed to this region.
+	uint32_t sample_count;
+
+	// The region that was live when this one was entered, so nested
+	// regions restore their parent on exit.
+	struct profile_region *parent;
+
+	// True iff this region has been added to the global region table.
+	bool registered;
+
+} profile_region_t;
+
+
+/** Defines a profile region with the given identifier as its name. */
+#define PROFILE_DEFINE_REGION(identifier) \
+	static profile_region_t identifier = { .name = #identifier }
+
+
+/**
+ * Enables the DWT cycle counter. Called automatically on first region entry;
+ * safe to call repeatedly.
+ */
+void profiling_initialize(void);
+
+/**
+ * Brackets a profiled region. Safe from any context; regions may nest, but a
+ * given region structure must not be entered re-entrantly.
+ */
+void profile_region_enter(profile_region_t *region);
+void profile_region_exit(profile_region_t *region);
+
+/**
+ * Starts the statistical sampler: a periodic timer callback that attributes
+ * each sample to the currently-live region (or to an implicit "untracked"
+ * bucket). Costs a hardware timer while running.
+ *
+ * @param frequency The sampling frequency, in Hz.
+ * @return 0 on success, or an error code on failure.
+ */
+int profiling_start_sampling(uint32_t frequency);
+
+/** Stops the statistical sampler and releases its timer. */
+void profiling_stop_sampling(void);
+
+/** Clears all accumulated cycle counts, entry counts, and samples. */
+void profiling_reset(void);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * This file is part of libgreat
+ *
+ * Interrupt latency and jitter instrumentation for the vector dispatch path.
+ *
+ * Two complementary measurements, both built on the DWT cycle counter:
+ *
+ *  - Per-vector tracing: a traced IRQ's handler is wrapped in a thunk that
+ *    records invocation counts, execution cycles, and inter-arrival jitter.
+ *    A vector whose maximum execution time lines up with another's latency
+ *    spikes is the preemptor we're hunting.
+ *
+ *  - A SysTick latency reference: SysTick pends at a known, hardware-set
+ *    instant, and counts down at the processor clock -- so the count read at
+ *    handler entry gives the exact pend-to-entry latency, in cycles, with no
+ *    software in the loop. Its distribution is the system's real dispatch
+ *    latency under whatever load is running.
+ *
+ * Results are exposed to the host through the core class's latency verbs.
+ */
+
+#ifndef __LIBGREAT_ARM_VECTOR_TRACE_H__
+#define __LIBGREAT_ARM_VECTOR_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <drivers/platform_vectors.h>
+
+/** Maximum number of vectors that can be traced at once. */
+#define VECTOR_TRACE_MAX_VECTORS 8
+
+
+/**
+ * Statistics gathered for a single traced vector.
+ */
+typedef struct {
+
+	// The IRQ this record tracks, and whether the record is live.
+	platform_irq_t irq;
+	bool in_use;
+
+	// Invocation count, and execution cycles spent in the handler.
+	uint32_t invocations;
+	uint32_t total_cycles;
+	uint32_t max_cycles;
+
+	// Inter-arrival extremes, for jitter: cycles between consecutive
+	// handler entries. Zero until two entries have been observed.
+	uint32_t min_interarrival_cycles;
+	uint32_t max_interarrival_cycles;
+
+	//
+	// Internal fields:
+	//
+
+	// The handler we wrapped, and the cycle count at the last entry.
+	interrupt_service_routine_t wrapped_handler;
+	uint32_t last_entry_cycle_count;
+
+} vector_trace_record_t;
+
+
+/**
+ * Statistics gathered by the SysTick latency reference.
+ */
+typedef struct {
+
+	// Number of reference interrupts observed.
+	uint32_t samples;
+
+	// Pend-to-entry latency, in processor cycles.
+	uint32_t total_latency_cycles;
+	uint32_t max_latency_cycles;
+
+} vector_trace_reference_statistics_t;
+
+
+/**
+ * Begins tracing the given IRQ, wrapping its currently-installed handler.
+ * The IRQ's handler should not be swapped while tracing is active.
+ *
+ * @return 0 on success, EBUSY if all trace slots are in use, or
+ *     EEXIST if the IRQ is already being traced
+ */
+int vector_trace_attach(platform_irq_t irq);
+
+
+/**
+ * Stops tracing the given IRQ, restoring its original handler.
+ *
+ * @return 0 on success, or EINVAL if the IRQ isn't being traced
+ */
+int vector_trace_detach(platform_irq_t irq);
+
+
+/**
+ * Starts the SysTick latency reference, generating a reference interrupt
+ * every @p period_cycles processor cycles. Takes over SysTick while running.
+ *
+ * @param period_cycles The reference period, in processor cycles (24-bit).
+ * @return 0 on success, or an error code on failure.
+ */
+int vector_trace_start_reference(uint32_t period_cycles);
+
+
+/** Stops the SysTick latency reference, releasing SysTick. */
+void vector_trace_stop_reference(void);
+
+
+/**
+ * @return the trace record at the given index, or NULL if the index is
+ *     beyond the record table; records with .in_use false carry no data
+ */
+vector_trace_record_t *vector_trace_get_record(unsigned index);
+
+
+/** @return the latency reference's accumulated statistics */
+vector_trace_reference_statistics_t *vector_trace_get_reference_statistics(void);
+
+
+/** Clears all accumulated trace and reference statistics. */
+void vector_trace_reset(void);
+
+#endif
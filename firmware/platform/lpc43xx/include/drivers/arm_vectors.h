@@ -88,6 +88,40 @@ bool platform_interrupt_is_pending(platform_irq_t irq);
 void platform_set_interrupt_priority(platform_irq_t irq, platform_interrupt_priority_t priority);
 
 
+/**
+ * Moves the active vector table into SRAM, so handlers can be swapped with a
+ * single store. Called early in startup; safe to call repeatedly.
+ */
+void vectors_relocate_to_ram(void);
+
+
+/**
+ * Installs an interrupt handler routine for a given IRQ: a single O(1) store
+ * into the active (RAM-resident) vector table.
+ */
+void vector_set_handler(platform_irq_t irq, interrupt_service_routine_t isr);
+
+
+/**
+ * @return the interrupt handler currently installed for the given IRQ
+ */
+interrupt_service_routine_t vector_get_handler(platform_irq_t irq);
+
+
+/**
+ * Installs a handler for the SysTick exception, which lives outside the IRQ
+ * portion of the vector table. Same swap semantics as vector_set_handler.
+ */
+void vector_set_systick_handler(vector_table_entry_t handler);
+
+/**
+ * Points all four fault exceptions (hard fault, memory management, bus
+ * fault, usage fault) at the given handler, which can distinguish them by
+ * reading IPSR. Same swap semantics as vector_set_handler.
+ */
+void vector_set_fault_handlers(vector_table_entry_t handler);
+
+
 /**
  * Installs an interrupt handler routine for a given IRQ. Should only be called
  */
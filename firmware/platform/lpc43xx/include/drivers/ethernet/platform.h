@@ -15,12 +15,94 @@
 #include <drivers/platform_reset.h>
 #include <drivers/platform_config.h>
 #include <drivers/ethernet/platform.h>
+#include <drivers/memory/allocator.h>
 
 
 // Opaque references to ethernet controller objects.
 typedef struct ethernet_controller ethernet_controller_t;
 
 
+/**
+ * Geometry for the controller's DMA descriptor rings.
+ */
+#define ETHERNET_RX_RING_ENTRIES     8
+#define ETHERNET_TX_RING_ENTRIES     8
+
+// Large enough for a full-size (1518-byte) frame, rounded up to a multiple
+// of the 32-byte burst/cache-line size so adjacent buffers never share a line.
+#define ETHERNET_FRAME_BUFFER_SIZE   1536
+
+// Frame buffers backing the receive pool: one per RX descriptor, plus spares
+// that cover frames the consumer is still holding while the ring refills.
+#define ETHERNET_FRAME_BUFFER_COUNT  (ETHERNET_RX_RING_ENTRIES + 4)
+
+// Interrupt on every Nth received frame; the receive watchdog timer raises
+// the interrupt for any frames that trickle in below this rate.
+#define ETHERNET_RX_COALESCE_INTERVAL 4
+
+
+/**
+ * A single ethernet DMA descriptor, in the controller's chained format: the
+ * next-descriptor word links descriptors explicitly, so the rings need not
+ * be contiguous and transmit frames can span several buffers.
+ */
+typedef volatile struct ATTR_PACKED {
+	uint32_t status;
+	uint32_t control;
+	uint32_t buffer_address;
+	uint32_t next_descriptor;
+} ethernet_dma_descriptor_t;
+
+
+// Fields common to both descriptor directions.
+#define ETHERNET_DESC_STATUS_OWNED_BY_DMA          (1UL << 31)
+#define ETHERNET_DESC_STATUS_ERROR_SUMMARY         (1UL << 15)
+
+// Receive descriptor status word (RDES0).
+#define ETHERNET_RDES_STATUS_FRAME_LENGTH(status)  (((status) >> 16) & 0x3fff)
+#define ETHERNET_RDES_STATUS_FIRST_DESCRIPTOR      (1UL <<  9)
+#define ETHERNET_RDES_STATUS_LAST_DESCRIPTOR       (1UL <<  8)
+
+// Receive descriptor control word (RDES1).
+#define ETHERNET_RDES_CONTROL_DISABLE_INTERRUPT    (1UL << 31)
+#define ETHERNET_RDES_CONTROL_END_OF_RING          (1UL << 15)
+#define ETHERNET_RDES_CONTROL_CHAINED              (1UL << 14)
+#define ETHERNET_RDES_CONTROL_BUFFER_SIZE(size)    ((size) & 0x1fff)
+
+// Transmit descriptor status word (TDES0); this controller uses the
+// "alternate" layout, which keeps the transmit control bits here.
+#define ETHERNET_TDES_STATUS_INTERRUPT_ON_COMPLETE (1UL << 30)
+#define ETHERNET_TDES_STATUS_LAST_SEGMENT          (1UL << 29)
+#define ETHERNET_TDES_STATUS_FIRST_SEGMENT         (1UL << 28)
+#define ETHERNET_TDES_STATUS_END_OF_RING           (1UL << 21)
+#define ETHERNET_TDES_STATUS_CHAINED               (1UL << 20)
+
+// Transmit descriptor control word (TDES1).
+#define ETHERNET_TDES_CONTROL_BUFFER_SIZE(size)    ((size) & 0x1fff)
+
+
+// DMA bus-mode register fields.
+#define ETHERNET_BUS_MODE_SOFTWARE_RESET           (1UL <<  0)
+#define ETHERNET_BUS_MODE_BURST_LENGTH(length)     ((length) << 8)
+
+// DMA operation-mode register fields.
+#define ETHERNET_OP_MODE_START_RECEIVE             (1UL <<  1)
+#define ETHERNET_OP_MODE_START_TRANSMIT            (1UL << 13)
+#define ETHERNET_OP_MODE_STORE_AND_FORWARD         (1UL << 21)
+
+// DMA interrupt-enable/status register fields.
+#define ETHERNET_INTERRUPT_TRANSMIT_COMPLETE       (1UL <<  0)
+#define ETHERNET_INTERRUPT_RECEIVE_COMPLETE        (1UL <<  6)
+#define ETHERNET_INTERRUPT_ABNORMAL_SUMMARY        (1UL << 15)
+#define ETHERNET_INTERRUPT_NORMAL_SUMMARY          (1UL << 16)
+
+// MAC configuration register fields.
+#define ETHERNET_MAC_CONFIG_RECEIVER_ENABLE        (1UL <<  2)
+#define ETHERNET_MAC_CONFIG_TRANSMITTER_ENABLE     (1UL <<  3)
+#define ETHERNET_MAC_CONFIG_FULL_DUPLEX            (1UL << 11)
+#define ETHERNET_MAC_CONFIG_100MBPS                (1UL << 14)
+
+
 /**
  * Ethernet clock divider frequencies.
  */
@@ -76,10 +158,14 @@ typedef struct ATTR_PACKED {
 
 	uint32_t intr;
 	uint32_t intr_mask;
-	uint64_t addr0;
+
+	// Station address: HIGH holds the last two octets, LOW the first four.
+	uint32_t addr0_high;
+	uint32_t addr0_low;
 } ethernet_mac_register_block_t;
 
 ASSERT_OFFSET(ethernet_mac_register_block_t, intr, 0x38);
+ASSERT_OFFSET(ethernet_mac_register_block_t, addr0_high, 0x40);
 
 /**
  * Structure representing the LPC43xx DMA configuration registers.
@@ -153,6 +239,23 @@ typedef struct {
 	// Pointer to the clock that's used for the current controller.
 	platform_branch_clock_register_t *clock;
 
+	// The DMA descriptor rings, and the buffer pool backing receive. Both are
+	// cache-line-aligned, so descriptor and buffer fetches burst cleanly.
+	ethernet_dma_descriptor_t rx_ring[ETHERNET_RX_RING_ENTRIES] ATTR_ALIGNED(32);
+	ethernet_dma_descriptor_t tx_ring[ETHERNET_TX_RING_ENTRIES] ATTR_ALIGNED(32);
+	memory_pool_t frame_pool;
+	uint8_t frame_buffers[ETHERNET_FRAME_BUFFER_COUNT][ETHERNET_FRAME_BUFFER_SIZE] ATTR_ALIGNED(32);
+
+	// Ring cursors: the next RX descriptor to harvest, the next TX descriptor
+	// to populate, and the oldest TX descriptor not yet reclaimed.
+	unsigned rx_index;
+	unsigned tx_produce_index;
+	unsigned tx_reclaim_index;
+
+	// Frames dropped because the receive pool was exhausted, or because the
+	// hardware flagged an error; useful for tuning buffer counts.
+	uint32_t rx_dropped;
+
 } ethernet_platform_data_t;
 
 
@@ -223,4 +326,56 @@ void platform_ethernet_mii_start_read(ethernet_controller_t *device, uint8_t reg
 uint16_t platform_ethernet_mii_read(ethernet_controller_t *device, uint8_t register_index);
 
 
+/**
+ * Builds the controller's descriptor rings and starts the DMA engine, after
+ * which frames flow without further processor involvement.
+ *
+ * @return 0 on success, or an error code on failure
+ */
+int platform_ethernet_start(ethernet_controller_t *device);
+
+
+/**
+ * Harvests the oldest received frame, if one is pending, handing its buffer
+ * to the caller zero-copy; the descriptor is refilled from the frame pool.
+ *
+ * @param length Out argument; receives the frame's length, in bytes.
+ * @return the frame buffer, or NULL if no complete frame is pending
+ */
+uint8_t *platform_ethernet_read_frame(ethernet_controller_t *device, uint32_t *length);
+
+
+/**
+ * Returns a harvested frame buffer to the receive pool.
+ */
+void platform_ethernet_release_frame(ethernet_controller_t *device, void *buffer);
+
+
+/**
+ * Queues a frame for transmit, one chained descriptor per segment, so
+ * scattered headers and payloads are sent without a gather copy. Segment
+ * buffers remain owned by the DMA engine until the transmit completes.
+ *
+ * @param segments Array of pointers to the frame's segments.
+ * @param lengths Per-segment lengths, in bytes.
+ * @param segment_count The number of segments; at least one.
+ * @return 0 on success, or EBUSY if the ring lacks room for the frame
+ */
+int platform_ethernet_transmit_frame(ethernet_controller_t *device,
+		const void *const *segments, const uint32_t *lengths, unsigned segment_count);
+
+
+/**
+ * @return true iff all queued transmit frames have left the controller
+ */
+bool platform_ethernet_transmit_complete(ethernet_controller_t *device);
+
+
+/**
+ * Connects the controller's interrupt, which fires on coalesced receive
+ * events and invokes the controller's frame_received callback.
+ */
+void platform_ethernet_set_up_interrupt(ethernet_controller_t *device);
+
+
 #endif
@@ -0,0 +1,170 @@
+/**
+ * This file is part of libgreat
+ *
+ * LPC43xx M0 coprocessor offload framework -- image loading, shared-memory
+ * mailboxes, and task pinning for the Cortex-M0 companion core.
+ */
+
+#ifndef __LIBGREAT_M0_OFFLOAD_H__
+#define __LIBGREAT_M0_OFFLOAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <toolchain.h>
+
+/** Number of message slots in each mailbox direction. Must be a power of two. */
+#define M0_MAILBOX_DEPTH 8
+
+/**
+ * A single mailbox message: a small command/argument tuple. Tasks define
+ * their own command vocabularies.
+ */
+struct m0_mailbox_message {
+	uint32_t command;
+	uint32_t argument;
+};
+
+/**
+ * A single-producer/single-consumer mailbox in shared memory.
+ *
+ * Note that the Cortex-M0 has no exclusive-access instructions, so these
+ * deliberately avoid the sync.S primitives: with exactly one producer and
+ * one consumer, plain volatile head/tail indices -- each written by only
+ * one core -- are sufficient for correctness.
+ */
+struct m0_mailbox {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	struct m0_mailbox_message messages[M0_MAILBOX_DEPTH];
+};
+
+/** Number of in-flight comms requests the inter-core ring can hold.
+ * Must be a power of two. */
+#define M0_COMMS_RING_DEPTH 4
+
+/**
+ * Lifecycle states for a comms ring slot; each is written only by the core
+ * noted, so no exclusive accesses are needed.
+ */
+#define M0_COMMS_SLOT_FREE     0  // written by the M4, after harvesting a result
+#define M0_COMMS_SLOT_PENDING  1  // written by the M4, after populating the slot
+#define M0_COMMS_SLOT_COMPLETE 2  // written by the M0, after executing the verb
+
+/**
+ * A single comms request in flight to the M0: the command's class and verb
+ * numbers, and its buffers by address -- both cores see the same memory
+ * map, so the M0 parses arguments and builds its response in place. The
+ * M0 image dispatches the class/verb pair to its own handler
+ * implementations (built for the ARMv6-M subset, against the same class
+ * and verb numbering), fills in the results, marks the slot complete, and
+ * raises its inter-core event to wake the waiting M4.
+ */
+struct m0_comms_request {
+
+	/** The command to be executed. */
+	uint32_t class_number;
+	uint32_t verb;
+
+	/** The transaction's buffers. */
+	uint32_t data_in_address;
+	uint32_t data_in_length;
+	uint32_t data_out_address;
+	uint32_t data_out_max_length;
+
+	/** Results, filled in by the M0 on completion. */
+	volatile uint32_t data_out_length;
+	volatile int32_t return_code;
+
+	/** The slot's lifecycle state; see M0_COMMS_SLOT_*. */
+	volatile uint32_t state;
+};
+
+/**
+ * The shared-memory ring carrying comms requests to the M0. The M4 produces
+ * at the head; the M0 advances the tail as it claims each request, with the
+ * same single-writer index discipline as the mailboxes. Results travel back
+ * in the slot itself, via its state field, rather than through a second
+ * ring -- the submitting M4 context waits on the specific slot it filled.
+ */
+struct m0_comms_ring {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	struct m0_comms_request requests[M0_COMMS_RING_DEPTH];
+};
+
+/**
+ * The shared-memory control block used to coordinate the two cores. The M4
+ * places this at a fixed location in the M0's RAM region, directly after
+ * the loaded image; the M0 side links against the same layout.
+ */
+struct m0_control_block {
+
+	/** Magic value identifying a valid, initialized control block. */
+	uint32_t magic;
+
+	/** The task the M0 is currently being asked to run; see m0_offload_pin_task. */
+	volatile uint32_t requested_task;
+
+	/** The task the M0 is actually running; written only by the M0. */
+	volatile uint32_t active_task;
+
+	/** M4-to-M0 and M0-to-M4 mailboxes. */
+	struct m0_mailbox to_m0;
+	struct m0_mailbox to_m4;
+
+	/** Comms requests for M0-resident classes; see m0_comms.c. */
+	struct m0_comms_ring comms;
+};
+
+/** Magic value for m0_control_block.magic. */
+#define M0_CONTROL_BLOCK_MAGIC 0x306d6267  // 'gbm0'
+
+/** Task number meaning "no task"; the M0 idles. */
+#define M0_TASK_NONE 0
+
+
+/**
+ * Loads an M0 program image into the M0's RAM region, initializes the
+ * shared control block, and brings the M0 core out of reset.
+ *
+ * @param image The M0 program image (a binary built for the M0 memory map).
+ * @param size The size of the image, in bytes.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int m0_offload_load_image(const void *image, uint32_t size);
+
+/**
+ * Halts the M0 core and invalidates the shared control block.
+ */
+void m0_offload_halt(void);
+
+/**
+ * @return a reference to the shared control block, or NULL if no M0 image
+ *     has been loaded
+ */
+struct m0_control_block *m0_offload_control_block(void);
+
+/**
+ * Asks the M0 to run a given task -- e.g. SGPIO polling or buffer
+ * compaction. Task numbers are defined by the loaded image.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int m0_offload_pin_task(uint32_t task);
+
+/**
+ * Posts a message to a mailbox. Safe only from the producing core.
+ *
+ * @return 0 on success; EAGAIN if the mailbox is full.
+ */
+int m0_mailbox_post(struct m0_mailbox *mailbox, uint32_t command, uint32_t argument);
+
+/**
+ * Retrieves a message from a mailbox. Safe only from the consuming core.
+ *
+ * @return true iff a message was retrieved.
+ */
+bool m0_mailbox_retrieve(struct m0_mailbox *mailbox, struct m0_mailbox_message *message);
+
+#endif
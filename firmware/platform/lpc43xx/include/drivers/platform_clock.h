@@ -516,6 +516,29 @@ platform_clock_generation_register_block_t *get_platform_clock_generation_regist
 void platform_enable_branch_clock(platform_branch_clock_register_t *clock, bool divide_by_two);
 
 
+/**
+ * Acquires a branch clock, reference-counted: the clock turns on at the
+ * first outstanding acquisition and stays on while anyone holds it.
+ * Preferred over platform_enable_branch_clock() for drivers, so unused
+ * peripherals' clocks need never come up -- and so clocks can actually be
+ * gated off again when their last user releases them.
+ *
+ * @param clock The clock to acquire.
+ * @param divide_by_two True iff the clock should be divided by two, for clocks
+ *    that support division; ignored while other holders exist.
+ */
+void platform_acquire_branch_clock(platform_branch_clock_register_t *clock, bool divide_by_two);
+
+
+/**
+ * Releases a branch clock acquired with platform_acquire_branch_clock();
+ * the last release gates the clock off and drops its cached frequency.
+ *
+ * @param clock The clock to release.
+ */
+void platform_release_branch_clock(platform_branch_clock_register_t *clock);
+
+
 /**
  * Turns off the clock for a given peripheral (not branch clocks).
  * (Clocks for this function are found in the clock control register block.)
@@ -576,6 +599,16 @@ void platform_initialize_clocks(void);
 void platform_initialize_early_clocks(void);
 
 
+/**
+ * Kicks off the slow pieces of clock bring-up -- currently, starting the
+ * crystal oscillator's settle timer -- without waiting on any of them.
+ * Touches only hardware registers, so the crt0 can call this before .data
+ * and .bss exist; the oscillator then settles while memory initialization
+ * proceeds, and platform_initialize_clocks() waits only for the remainder.
+ */
+void platform_begin_clock_bringup(void);
+
+
 /**
  * Uses the LPC43xx's internal frequency monitor to detect the frequency of the given clock source.
  * If trying to determine the internal clock frequency, the external oscillator must be up, as it will
@@ -626,4 +659,75 @@ const char *platform_get_cpu_clock_source_name(void);
  */
 uint32_t platform_get_cpu_clock_source_frequency(void);
 
+
+/**
+ * Solves and caches main-PLL divider configurations for each frequency listed
+ * in the (weak, board-overridable) platform_main_pll_preset_frequencies
+ * table. Intended to be called once at startup, after the PLL is brought up.
+ */
+void platform_main_pll_precompute_presets(void);
+
+/**
+ * Retunes the main PLL to the given frequency using a precomputed (or cached)
+ * divider solution, so the switch costs only the hardware's lock time.
+ *
+ * @param frequency The desired output frequency, in Hz.
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_main_pll_fast_switch(uint32_t frequency);
+
+
+/**
+ * Callback type for frequency-change monitors. Called -- possibly from
+ * interrupt context -- after the monitored clock's frequency may have
+ * changed; the new frequency can be queried through the usual accessors.
+ */
+typedef void (*clock_frequency_callback_t)(void *context);
+
+/**
+ * Registers a frequency-change monitor: whenever the given branch clock's
+ * frequency may have changed (because a parent source, base clock, or
+ * divider was retuned), the provided callback is invoked. Registrations
+ * cannot currently be withdrawn.
+ *
+ * @param clock The branch clock to monitor.
+ * @param callback The function to call on each potential change.
+ * @param context An arbitrary value passed to the callback.
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_register_clock_frequency_callback(platform_branch_clock_t *clock,
+		clock_frequency_callback_t callback, void *context);
+
+
+/**
+ * Configures the clock governor: validates (and caches, if necessary) PLL
+ * solutions for a low-power idle frequency and a full-speed frequency, then
+ * drops to the idle frequency. Until the governor is configured, the boost
+ * calls below are no-ops, so drivers may call them unconditionally.
+ *
+ * @param idle_frequency The frequency to run at while nothing needs speed.
+ * @param full_frequency The frequency to ramp to while any boost is held.
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_clock_governor_configure(uint32_t idle_frequency, uint32_t full_frequency);
+
+/**
+ * Requests full-speed operation. Requests are counted: the first outstanding
+ * request ramps the main PLL to the configured full-speed frequency, and the
+ * clock stays there until every request has been released. Because the ramp
+ * uses a cached PLL solution, it completes in well under a millisecond, and
+ * may be called from interrupt context.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_clock_governor_request_boost(void);
+
+/**
+ * Releases a previous boost request; the last release ramps the main PLL
+ * back down to the configured idle frequency.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_clock_governor_release_boost(void);
+
 #endif
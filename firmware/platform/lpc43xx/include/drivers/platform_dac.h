@@ -9,10 +9,18 @@
 #define __LIBGREAT_PLATFORM_DAC_H__
 
 #include <toolchain.h>
+#include <drivers/platform_dma.h>
 
 
 typedef struct dac dac_t;
 
+/**
+ * The DAC's maximum update rates, in Hz; the lower rate applies when the
+ * conversion register's low-power bias bit is set.
+ */
+#define DAC_MAXIMUM_SAMPLE_RATE           (1000000UL)
+#define DAC_LOW_POWER_MAXIMUM_SAMPLE_RATE (400000UL)
+
 
 /**
  * Structure representing the in-memory layout of a DAC peripheral.
@@ -70,4 +78,47 @@ platform_dac_registers_t *platform_get_dac_registers();
 int platform_dac_init(dac_t *dac);
 void dac_set_value(dac_t *dac, uint32_t value);
 
+
+/**
+ * Converts a raw 10-bit sample into the word to be DMA'd into the DAC's
+ * conversion register, placing the value in the register's conversion field.
+ */
+static inline uint32_t platform_dac_sample_to_word(uint16_t sample)
+{
+	return ((uint32_t)sample & 0x3FF) << 6;
+}
+
+
+/**
+ * Starts sample-rate-paced DMA into the DAC's conversion register.
+ *
+ * The DAC's internal timeout counter is programmed to request one DMA
+ * transfer per sample period, and the given descriptor chain -- typically a
+ * ring, so playback circulates with no processor involvement -- is started
+ * on a claimed GPDMA channel. Each descriptor should move words produced by
+ * platform_dac_sample_to_word() into the DAC's conversion register.
+ *
+ * @param dac The DAC to be driven.
+ * @param first_lli The first descriptor of the chain to play from.
+ * @param sample_rate The playback rate, in samples per second; must be
+ *     between 1 and DAC_MAXIMUM_SAMPLE_RATE.
+ * @return 0 on success, EINVAL for an unachievable sample rate, or EBUSY if
+ *     playback is already active or no DMA channel is free.
+ */
+int platform_dac_start_paced_dma(dac_t *dac, gpdma_linked_list_item_t *first_lli, uint32_t sample_rate);
+
+
+/**
+ * Halts paced DMA playback started with platform_dac_start_paced_dma(),
+ * releasing its DMA channel. The DAC holds its last converted value.
+ */
+void platform_dac_stop_paced_dma(dac_t *dac);
+
+
+/**
+ * @return the source address the playback DMA channel is currently reading
+ *     from; lets the playback engine track consumption through its ring
+ */
+uint32_t platform_dac_get_playback_position(void);
+
 #endif
@@ -4,10 +4,108 @@
  * This file is part of libgreat.
  */
 
- #ifndef __LIBGREAT_PLATFORM_DRIVER_DMA__
- #define __LIBGREAT_PLATFORM_DRIVER_DMA__
+#ifndef __LIBGREAT_PLATFORM_DRIVER_DMA__
+#define __LIBGREAT_PLATFORM_DRIVER_DMA__
 
- #include <toolchain.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <toolchain.h>
+
+/** Total number of channels provided by the GPDMA controller. */
+#define GPDMA_CHANNEL_COUNT 8
+
+/**
+ * Transfer-control word for a GPDMA descriptor -- this is the value that
+ * lands in the channel's control register, and which each linked-list item
+ * re-loads as the controller chains through descriptors.
+ */
+typedef union {
+	struct {
+		uint32_t transfer_size              : 12;
+		uint32_t source_burst_size          :  3;
+		uint32_t destination_burst_size     :  3;
+		uint32_t source_transfer_width      :  3;
+		uint32_t destination_transfer_width :  3;
+		uint32_t source_on_ahb1             :  1;
+		uint32_t destination_on_ahb1        :  1;
+		uint32_t source_increment           :  1;
+		uint32_t destination_increment      :  1;
+		uint32_t privileged_mode            :  1;
+		uint32_t bufferable                 :  1;
+		uint32_t cacheable                  :  1;
+		uint32_t terminal_count_interrupt   :  1;
+	};
+	uint32_t all;
+} gpdma_channel_control_t;
+
+/** Transfer widths for the control word's width fields. */
+enum {
+	GPDMA_WIDTH_BYTE     = 0,
+	GPDMA_WIDTH_HALFWORD = 1,
+	GPDMA_WIDTH_WORD     = 2,
+};
+
+/** Burst sizes for the control word's burst fields. */
+enum {
+	GPDMA_BURST_1   = 0,
+	GPDMA_BURST_4   = 1,
+	GPDMA_BURST_8   = 2,
+	GPDMA_BURST_16  = 3,
+	GPDMA_BURST_32  = 4,
+	GPDMA_BURST_64  = 5,
+	GPDMA_BURST_128 = 6,
+	GPDMA_BURST_256 = 7,
+};
+
+/** Flow-control configurations for a GPDMA channel. */
+enum {
+	GPDMA_FLOW_MEMORY_TO_MEMORY         = 0,
+	GPDMA_FLOW_MEMORY_TO_PERIPHERAL     = 1,
+	GPDMA_FLOW_PERIPHERAL_TO_MEMORY     = 2,
+	GPDMA_FLOW_PERIPHERAL_TO_PERIPHERAL = 3,
+};
+
+/**
+ * A GPDMA linked-list item ("transfer descriptor"). The controller loads
+ * each of these in turn, so a ring of descriptors lets transfers continue
+ * with no processor involvement. Must be word-aligned.
+ */
+typedef struct ATTR_WORD_ALIGNED {
+	uint32_t source_address;
+	uint32_t destination_address;
+	uint32_t next_lli;
+	gpdma_channel_control_t control;
+} gpdma_linked_list_item_t;
+
+
+/**
+ * Register block for a single GPDMA channel.
+ */
+typedef volatile struct ATTR_PACKED {
+	uint32_t source_address;
+	uint32_t destination_address;
+	uint32_t linked_list_item;
+	uint32_t control;
+
+	// Channel configuration register.
+	union {
+		struct {
+			uint32_t enable                       :  1;
+			uint32_t source_peripheral            :  5;
+			uint32_t destination_peripheral       :  5;
+			uint32_t flow_control                 :  3;
+			uint32_t error_interrupt_enabled      :  1;
+			uint32_t terminal_count_interrupt_enabled : 1;
+			uint32_t locked                       :  1;
+			uint32_t active                       :  1;
+			uint32_t halt                         :  1;
+			uint32_t                              : 13;
+		};
+		uint32_t config_all;
+	};
+
+	uint32_t reserved[3];
+} gpdma_channel_registers_t;
 
 
 /**
@@ -20,8 +118,8 @@ typedef volatile struct ATTR_PACKED {
 	uint32_t terminal_count_interrupt_clear;
 	uint32_t error_interrupt_status;
 	uint32_t error_interrupt_clear;
-	uint32_t raw_terminal_count_status_register;
-	uint32_t raw_error_interrupt_status_register;
+	uint32_t raw_terminal_count_status;
+	uint32_t raw_error_interrupt_status;
 
 	uint32_t enabled_channel_bitmask;
 
@@ -36,14 +134,109 @@ typedef volatile struct ATTR_PACKED {
 		uint32_t dma_controller_enabled   :  1;
 		uint32_t ahb0_use_big_endian_mode :  1;
 		uint32_t ahb1_use_big_endian_mode :  1;
-		uint32_t ahb1_use_big_endian_mode : 29;
+		uint32_t                          : 29;
 	};
 
-
 	uint32_t request_synchronization_bitmask;
 
+	uint32_t reserved[50];
 
-};
+	// Per-channel registers, starting at offset 0x100.
+	gpdma_channel_registers_t channels[GPDMA_CHANNEL_COUNT];
+
+} platform_dma_registers_t;
+
+
+/**
+ * @return a reference to the GPDMA controller's registers
+ */
+platform_dma_registers_t *platform_get_dma_registers(void);
 
+/**
+ * Enables the GPDMA controller's clock and the controller itself.
+ * Safe to call repeatedly.
+ */
+void gpdma_controller_enable(void);
+
+/**
+ * Claims an unused GPDMA channel for the caller's exclusive use.
+ *
+ * @return the claimed channel number, or -1 if no channel was available
+ */
+int gpdma_claim_channel(void);
+
+/**
+ * Releases a channel claimed with gpdma_claim_channel(), halting it first
+ * if it's still active.
+ */
+void gpdma_release_channel(int channel);
+
+/**
+ * Selects the peripheral routed to a given GPDMA request line, via the
+ * CREG DMA mux.
+ *
+ * @param request_line The DMA request line to configure (0-15).
+ * @param selection The peripheral selection for the line (0-3); see the
+ *     LPC43xx user manual's DMAMUX table.
+ */
+void gpdma_select_request_peripheral(uint8_t request_line, uint8_t selection);
+
+/**
+ * Starts a transfer described by a chain (or ring) of linked-list items on
+ * the given channel.
+ *
+ * @param channel The channel on which to start the transfer.
+ * @param first_lli The first descriptor of the chain; for continuous
+ *     operation, the chain's final descriptor should point back to it.
+ * @param source_peripheral The DMA request line that paces reads, or 0 with
+ *     memory-to-memory flow control.
+ * @param destination_peripheral The DMA request line that paces writes, or 0
+ *     with memory-to-memory flow control.
+ * @param flow_control One of the GPDMA_FLOW_* constants.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int gpdma_start_transfer(int channel, gpdma_linked_list_item_t *first_lli,
+		uint8_t source_peripheral, uint8_t destination_peripheral, uint8_t flow_control);
+
+/**
+ * Halts any transfer active on the given channel.
+ */
+void gpdma_stop_transfer(int channel);
+
+/**
+ * Callback type for asynchronous GPDMA operations.
+ *
+ * @param user_data The opaque argument provided at submission.
+ * @param status 0 on success, or EIO if the controller reported an error.
+ */
+typedef void (*gpdma_completion_cb)(void *user_data, int status);
+
+/**
+ * Starts an asynchronous memory-to-memory copy, claiming a free channel for
+ * its duration; the callback fires (from interrupt context) once the copy
+ * completes, and the channel is released automatically. Intended for large
+ * copies -- staging comms responses, compacting capture rings -- so the
+ * processor can do real work while the copy proceeds.
+ *
+ * The source and destination must not overlap, and both buffers must remain
+ * valid until the callback fires.
+ *
+ * @param destination, source The buffers to copy between; word-aligned
+ *     buffers and lengths copy word-at-a-time.
+ * @param length The number of bytes to copy.
+ * @param completion_cb If non-NULL, called once the copy completes or fails.
+ * @param user_data Opaque argument passed through to the callback.
+ * @return 0 if the copy was started (or was trivially empty), EBUSY if no
+ *     channel was free, or EINVAL if the copy is too large to describe --
+ *     in the latter two cases the caller should fall back to memcpy()
+ */
+int gpdma_copy_async(void *destination, const void *source, uint32_t length,
+		gpdma_completion_cb completion_cb, void *user_data);
+
+/**
+ * @return true iff the given channel is currently transferring data
+ */
+bool gpdma_transfer_active(int channel);
 
- #endif
+#endif
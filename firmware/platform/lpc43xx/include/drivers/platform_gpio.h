@@ -23,6 +23,17 @@ typedef platform_scu_pin_register_t gpio_pin_configuration_t;
 #define GPIO_MAX_PORTS 6
 #define GPIO_MAX_PORT_BITS 20
 
+// Physical locations of the GPIO peripheral's register regions.
+#define GPIO_LPC_BASE			 (0x400f4000)
+#define GPIO_LPC_PIN_WORD_OFFSET (0x1000)
+#define GPIO_LPC_PORT_OFFSET	 (0x2000)
+#define GPIO_LPC_PIN_WORD_SIZE	 (32 * sizeof(uint32_t))
+
+// Offsets of the per-port masked-access registers (MASK and MPIN) within
+// the port-register region; each is an array of one word per port.
+#define GPIO_LPC_MASK_OFFSET	 (0x080)
+#define GPIO_LPC_MPIN_OFFSET	 (0x180)
+
 /**
  * Simple pair of identifiers for a GPIO pin.
  */
@@ -61,5 +72,49 @@ uint8_t gpio_get_pin_number(gpio_pin_t pin);
 uint32_t *platform_gpio_get_pin_register(gpio_pin_t pin);
 
 
+/**
+ * @return the given port's hardware mask (MASK) register, which filters all
+ *    masked-pin accesses: only pins whose mask bit is -zero- are affected
+ */
+static inline volatile uint32_t *platform_gpio_mask_register(uint8_t port)
+{
+	return (volatile uint32_t *)(GPIO_LPC_BASE + GPIO_LPC_PORT_OFFSET +
+			GPIO_LPC_MASK_OFFSET + (port * sizeof(uint32_t)));
+}
+
+
+/**
+ * @return the given port's masked-pin (MPIN) register; reads and writes
+ *    through it touch only the pins selected by the port's MASK register
+ */
+static inline volatile uint32_t *platform_gpio_masked_pin_register(uint8_t port)
+{
+	return (volatile uint32_t *)(GPIO_LPC_BASE + GPIO_LPC_PORT_OFFSET +
+			GPIO_LPC_MPIN_OFFSET + (port * sizeof(uint32_t)));
+}
+
+
+/**
+ * Writes a port's pins through its masked-pin register: a single store that
+ * updates exactly the pins selected by gpio_configure_port_mask(), leaving
+ * the rest untouched. No validation -- this is the hot path for bit-banged
+ * protocols, where the one store *is* the toggle rate.
+ */
+static inline void platform_gpio_write_masked_port(uint8_t port, uint32_t value)
+{
+	*platform_gpio_masked_pin_register(port) = value;
+}
+
+
+/**
+ * Reads a port's pins through its masked-pin register: pins outside the
+ * configured mask read as zero.
+ */
+static inline uint32_t platform_gpio_read_masked_port(uint8_t port)
+{
+	return *platform_gpio_masked_pin_register(port);
+}
+
+
 
 #endif // __LIBGREAT_GPIO_H__
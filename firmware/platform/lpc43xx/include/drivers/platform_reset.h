@@ -191,6 +191,25 @@ void platform_software_reset(bool include_always_on_domain);
  */
 bool platform_reset_was_watchdog_timeout(void);
 
+
+/**
+ * Feed the platform's watchdog timer, noting that the system is still alive.
+ */
+void platform_watchdog_feed(void);
+
+
+/**
+ * Arms the watchdog for liveness supervision: if platform_watchdog_feed()
+ * isn't called within the given timeout, the warning interrupt captures a
+ * crash-telemetry snapshot (when that module is present) and the hardware
+ * resets the system. Once armed, the watchdog cannot be disarmed.
+ *
+ * @param timeout The allowed interval between feeds, in microseconds;
+ *		at most ~5.5 seconds.
+ * @return 0 on success, or an error code on failure.
+ */
+int platform_watchdog_start(uint32_t timeout);
+
 /**
  * Clears any system state necessary to track the system's state across resets.
  */
@@ -0,0 +1,135 @@
+/*
+ * This file is part of libgreat
+ *
+ * LPC43xx SSP (synchronous serial port) driver -- a simple, synchronous
+ * SPI-master interface. Pin multiplexing is the board's responsibility;
+ * chip selects are driven as GPIOs by the SSP's users.
+ */
+
+#ifndef __LIBGREAT_PLATFORM_SSP__
+#define __LIBGREAT_PLATFORM_SSP__
+
+#include <toolchain.h>
+
+/**
+ * The SSP controllers available on the LPC43xx.
+ */
+typedef enum {
+	SSP0 = 0,
+	SSP1 = 1,
+} ssp_number_t;
+
+
+/**
+ * Structure representing the in-memory layout of an SSP peripheral.
+ */
+typedef volatile struct ATTR_PACKED {
+
+	// Control register 0: frame format, data size, clock polarity/phase, and
+	// the serial clock rate's divisor.
+	union {
+		struct {
+			uint32_t data_size_minus_one  :  4;
+			uint32_t frame_format         :  2;
+			uint32_t clock_polarity_high  :  1;
+			uint32_t clock_phase_second   :  1;
+			uint32_t serial_clock_rate    :  8;
+			uint32_t                      : 16;
+		};
+		uint32_t control0;
+	};
+
+	// Control register 1: loopback, enable, and master/slave selection.
+	union {
+		struct {
+			uint32_t loopback_mode        :  1;
+			uint32_t enabled              :  1;
+			uint32_t slave_mode           :  1;
+			uint32_t slave_output_disable :  1;
+			uint32_t                      : 28;
+		};
+		uint32_t control1;
+	};
+
+	// Data register: writes feed the transmit FIFO; reads drain the receive FIFO.
+	uint32_t data;
+
+	// Status register.
+	union {
+		struct {
+			uint32_t transmit_fifo_empty     : 1;
+			uint32_t transmit_fifo_not_full  : 1;
+			uint32_t receive_fifo_not_empty  : 1;
+			uint32_t receive_fifo_full       : 1;
+			uint32_t busy                    : 1;
+			uint32_t                         : 27;
+		};
+		uint32_t status;
+	};
+
+	// Clock prescale register: an even divisor from 2 to 254.
+	uint32_t clock_prescale_divisor;
+
+	// Interrupt registers; unused by this synchronous driver.
+	uint32_t interrupt_mask;
+	uint32_t raw_interrupt_status;
+	uint32_t masked_interrupt_status;
+	uint32_t interrupt_clear;
+
+	// DMA control register.
+	uint32_t dma_control;
+
+} platform_ssp_registers_t;
+
+ASSERT_OFFSET(platform_ssp_registers_t, data, 0x08);
+ASSERT_OFFSET(platform_ssp_registers_t, clock_prescale_divisor, 0x10);
+ASSERT_OFFSET(platform_ssp_registers_t, dma_control, 0x24);
+
+
+/**
+ * Object representing a configured SSP controller.
+ */
+typedef struct ssp {
+	ssp_number_t number;
+	platform_ssp_registers_t *reg;
+} ssp_t;
+
+
+/**
+ * Sets up an SSP controller as an SPI master.
+ *
+ * The serial clock idles low and data is captured on the rising edge
+ * (SPI mode 0). Pin multiplexing is not touched; the board should route the
+ * controller's SCK/MOSI/MISO through the SCU itself.
+ *
+ * @param ssp The SSP object to be initialized.
+ * @param number The controller to use; one of the ssp_number_t values.
+ * @param clock_frequency The maximum serial clock frequency, in Hz; the
+ *     closest achievable rate at or below this is used.
+ * @param data_bits The frame size, in bits; 4 to 16.
+ * @return 0 on success, or EINVAL for an invalid controller, frame size, or
+ *     unachievable clock frequency.
+ */
+int ssp_init(ssp_t *ssp, ssp_number_t number, uint32_t clock_frequency, uint8_t data_bits);
+
+
+/**
+ * Performs a single full-duplex frame exchange, blocking until complete.
+ *
+ * @param value The frame to transmit.
+ * @return the frame received during the exchange
+ */
+uint16_t ssp_transfer(ssp_t *ssp, uint16_t value);
+
+
+/**
+ * Transmits a sequence of frames back-to-back through the transmit FIFO,
+ * discarding anything received; blocks until the bus goes idle.
+ *
+ * @param data The frames to transmit, one per byte; for frame sizes above
+ *     eight bits, use ssp_transfer() instead.
+ * @param count The number of frames to transmit.
+ */
+void ssp_send_sync(ssp_t *ssp, const uint8_t *data, size_t count);
+
+#endif
@@ -76,21 +76,25 @@ typedef union {
  */
 typedef volatile struct ATTR_PACKED {
 
-	// Interrupt register.
-	struct {
-		// Match channels.
-		uint32_t match0   : 1;
-		uint32_t match1   : 1;
-		uint32_t match2   : 1;
-		uint32_t match3   : 1;
-
-		// Capture channels.
-		uint32_t capture0 : 1;
-		uint32_t capture1 : 1;
-		uint32_t capture2 : 1;
-		uint32_t capture3 : 1;
-
-		uint32_t          : 24;
+	// Interrupt register. Write-one-to-clear; acknowledge through .all with
+	// only the serviced bit set, so the write can't eat other pending flags.
+	union {
+		struct {
+			// Match channels.
+			uint32_t match0   : 1;
+			uint32_t match1   : 1;
+			uint32_t match2   : 1;
+			uint32_t match3   : 1;
+
+			// Capture channels.
+			uint32_t capture0 : 1;
+			uint32_t capture1 : 1;
+			uint32_t capture2 : 1;
+			uint32_t capture3 : 1;
+
+			uint32_t          : 24;
+		};
+		uint32_t all;
 	} interrupt_pending;
 
 	// Timer control.
@@ -159,4 +163,105 @@ typedef enum {
 } timer_counter_mode_t;
 
 
+//
+// Hardware input capture.
+//
+// Each timer has four capture channels that can latch the running counter on
+// an edge of their CTIN input -- so signal timing can be measured at the
+// timer's full resolution, without the CPU polling a GPIO. The engine below
+// timestamps edges from the capture interrupt into a small ring, and folds
+// them into summary statistics in batches, on demand.
+//
+
+
+/**
+ * Edge selection for a capture channel. The values match the per-channel
+ * layout of the capture control register, so they can be shifted into place.
+ */
+typedef enum {
+	TIMER_CAPTURE_EDGE_RISING  = 1,
+	TIMER_CAPTURE_EDGE_FALLING = 2,
+	TIMER_CAPTURE_EDGE_BOTH    = 3,
+} timer_capture_edge_t;
+
+
+/**
+ * Summary statistics for a capture engine, accumulated in batches by
+ * platform_timer_capture_update_statistics(). All intervals are in ticks of
+ * the capturing timer, measured between consecutive captured edges -- so in
+ * a single-edge capture, the mean interval is the signal's period, and in a
+ * both-edge capture it's half of one.
+ */
+typedef struct {
+
+	// The total number of edges timestamped by the capture hardware...
+	uint32_t total_edges;
+
+	// ... and the number lost because the timestamp ring was full when
+	// they arrived. Drops skew interval statistics; if this climbs, update
+	// more often, or capture a single edge instead of both.
+	uint32_t dropped_edges;
+
+	// Interval statistics, over every pair of consecutive edges.
+	uint32_t intervals_measured;
+	uint64_t total_interval_ticks;
+	uint32_t min_interval_ticks;
+	uint32_t max_interval_ticks;
+	uint32_t last_interval_ticks;
+
+	// Alternating-interval buckets, for duty measurement in a both-edge
+	// capture: one bucket accumulates the signal's high times and the other
+	// its low times. Which is which depends on the signal's phase when
+	// capture started, so callers resolve the ambiguity -- typically by
+	// knowing the line's idle level, or by taking min/max of the two ratios.
+	uint64_t even_interval_ticks;
+	uint64_t odd_interval_ticks;
+
+} timer_capture_statistics_t;
+
+
+/**
+ * Starts a capture engine on the given timer, timestamping edges on one of
+ * its capture channels. The timer should be acquired, initialized, and have
+ * had its tick frequency set; this enables it. Routing a pin to the channel's
+ * CTIN input (via the SCU) is the caller's responsibility, as with the other
+ * counter functions.
+ *
+ * @param timer The timer whose capture hardware will be used.
+ * @param channel The capture channel to be used, 0-3.
+ * @param edges The edge(s) that will latch a timestamp.
+ * @return 0 on success, or an error code on failure
+ */
+int platform_timer_capture_start(hw_timer_t *timer, uint32_t channel, timer_capture_edge_t edges);
+
+
+/**
+ * Stops the capture engine on the given timer. Accumulated statistics
+ * survive until the next platform_timer_capture_start().
+ */
+void platform_timer_capture_stop(hw_timer_t *timer);
+
+
+/**
+ * Folds any edges timestamped since the last call into the timer's capture
+ * statistics. Batched deliberately: call this at whatever cadence suits the
+ * measurement, rather than paying per-edge processing costs.
+ */
+void platform_timer_capture_update_statistics(hw_timer_t *timer);
+
+
+/**
+ * @returns the capture statistics for the given timer; valid after a call to
+ *		platform_timer_capture_update_statistics()
+ */
+timer_capture_statistics_t *platform_timer_capture_get_statistics(hw_timer_t *timer);
+
+
+/**
+ * Resets the given timer's capture statistics, without disturbing an
+ * in-progress capture. Interval measurement resumes from the next edge pair.
+ */
+void platform_timer_capture_reset_statistics(hw_timer_t *timer);
+
+
 #endif
@@ -9,6 +9,7 @@
 
 #include <toolchain.h>
 #include <drivers/platform_clock.h>
+#include <drivers/platform_dma.h>
 
 typedef struct uart uart_t;
 
@@ -167,6 +168,32 @@ typedef struct {
 	// The clock that controls the relevant UART.
 	platform_branch_clock_t *clock;
 
+	//
+	// Block-transfer (DMA) mode state; see platform_uart_dma.c.
+	//
+
+	// The GPDMA channels draining our receive FIFO and feeding our
+	// transmit FIFO.
+	int rx_dma_channel;
+	int tx_dma_channel;
+
+	// The GPDMA request lines carrying this UART's requests.
+	uint8_t rx_dma_request;
+	uint8_t tx_dma_request;
+
+	// Self-referencing descriptor that circulates received data into the
+	// receive buffer with no processor involvement.
+	gpdma_linked_list_item_t rx_dma_lli;
+
+	// One-shot descriptor used to drain contiguous chunks of the transmit ring.
+	gpdma_linked_list_item_t tx_dma_lli;
+
+	// Offset of the next unread byte in the receive buffer.
+	uint32_t rx_dma_read_offset;
+
+	// Number of transmit-ring bytes currently being drained by DMA.
+	uint32_t tx_dma_in_flight;
+
 } platform_uart_t;
 
 #endif
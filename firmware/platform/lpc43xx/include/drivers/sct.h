@@ -4,6 +4,9 @@
  * This file is part of libgreat.
  */
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include <toolchain.h>
 
 #ifndef __LIBGREAT_PLATFORM_SCT__
@@ -25,24 +28,26 @@ typedef struct ATTR_PACKED {
  */
 typedef volatile struct ATTR_PACKED {
 
-	uint32_t configuration;
-
-	struct {
-		uint32_t use_both_halves_as_one            : 1;
-		uint32_t clock_mode                        : 2;
-		uint32_t clock_input_number                : 3;
-		uint32_t clock_on_falling_edges            : 1;
-		uint32_t prevent_lower_half_from_reloading : 1;
-		uint32_t prevent_upper_half_from_reloading : 1;
-		uint32_t synchronize_input_0               : 1;
-		uint32_t synchronize_input_1               : 1;
-		uint32_t synchronize_input_2               : 1;
-		uint32_t synchronize_input_3               : 1;
-		uint32_t synchronize_input_4               : 1;
-		uint32_t synchronize_input_5               : 1;
-		uint32_t synchronize_input_6               : 1;
-		uint32_t synchronize_input_7               : 1;
-		uint32_t                                   : 15;
+	// Configuration register, as a raw word and as its fields.
+	union {
+		uint32_t configuration;
+		struct {
+			uint32_t use_both_halves_as_one            : 1;
+			uint32_t clock_mode                        : 2;
+			uint32_t clock_input_number                : 3;
+			uint32_t clock_on_falling_edges            : 1;
+			uint32_t prevent_lower_half_from_reloading : 1;
+			uint32_t prevent_upper_half_from_reloading : 1;
+			uint32_t synchronize_input_0               : 1;
+			uint32_t synchronize_input_1               : 1;
+			uint32_t synchronize_input_2               : 1;
+			uint32_t synchronize_input_3               : 1;
+			uint32_t synchronize_input_4               : 1;
+			uint32_t synchronize_input_5               : 1;
+			uint32_t synchronize_input_6               : 1;
+			uint32_t synchronize_input_7               : 1;
+			uint32_t                                   : 15;
+		};
 	};
 
 	uint32_t control;
@@ -118,4 +123,199 @@ ASSERT_OFFSET(platform_sct_register_block_t, event,                     0x300);
 ASSERT_OFFSET(platform_sct_register_block_t, output,                    0x500);
 
 
+// Sizes of the SCT's hardware tables. (The hardware has 32 states; this
+// driver uses one state per event, so sixteen are addressable.)
+#define SCT_NUM_EVENTS  (16)
+#define SCT_NUM_STATES  (16)
+#define SCT_NUM_OUTPUTS (16)
+#define SCT_NUM_MATCHES (16)
+
+// Fields of the control register, for the unified (32-bit) counter.
+#define SCT_CONTROL_COUNT_DOWN  (1UL << 0)
+#define SCT_CONTROL_STOP        (1UL << 1)
+#define SCT_CONTROL_HALT        (1UL << 2)
+#define SCT_CONTROL_CLEAR_COUNT (1UL << 3)
+#define SCT_CONTROL_PRESCALE(p) (((uint32_t)(p) & 0xff) << 5)
+
+
+/**
+ * Model of an event's control register: what makes the event fire, and
+ * which state the counter moves to when it does.
+ */
+typedef union {
+	struct {
+		uint32_t match_number    : 4;
+		uint32_t use_upper_half  : 1;
+		uint32_t output_select   : 1;
+		uint32_t io_number       : 4;
+		uint32_t io_condition    : 2;
+
+		// 1 = fire on the match alone; 2 = on the I/O condition alone;
+		// 0 = on either; 3 = only on both at once.
+		uint32_t combine_mode    : 2;
+
+		// When load_state is set, firing moves the counter to state_value;
+		// otherwise, state_value is added to the current state.
+		uint32_t load_state      : 1;
+		uint32_t state_value     : 5;
+
+		uint32_t match_or_larger : 1;
+		uint32_t direction       : 2;
+		uint32_t                 : 9;
+	};
+	uint32_t all;
+} sct_event_control_t;
+
+
+/*
+ * The engine below drives the SCT as a table-driven pattern and PWM
+ * generator: events, states, and match values are programmed once, and the
+ * hardware then sequences outputs with zero CPU involvement -- work that
+ * would otherwise cost software loops or SGPIO slices. Routing CTOUT pins
+ * through the SCU is the caller's responsibility, as elsewhere.
+ *
+ * The counter runs unified (one 32-bit counter); the driver owns the whole
+ * event/state/match space, so the PWM and pattern helpers below start by
+ * clearing it. Callers wanting hand-built tables use
+ * platform_sct_configure_event() directly on the same terms.
+ */
+
+
+/**
+ * Configuration for one entry of the event table, as taken by
+ * platform_sct_configure_event(): fire when the given match register equals
+ * the counter in any of the masked states, optionally move to a new state,
+ * and set/clear outputs.
+ */
+typedef struct {
+
+	// The match register this event compares against, and the value to
+	// program into it.
+	uint8_t match;
+	uint32_t match_value;
+
+	// The set of states in which this event may fire.
+	uint16_t state_mask;
+
+	// The state to move to when the event fires, or -1 to stay put.
+	int8_t next_state;
+
+	// Outputs set and cleared when the event fires, one bit per output.
+	uint16_t set_outputs;
+	uint16_t clear_outputs;
+
+	// True if this event should reset ("limit") the counter when it fires.
+	bool limits_counter;
+
+} sct_event_config_t;
+
+
+/**
+ * @returns a reference to the SCT's register block
+ */
+platform_sct_register_block_t *platform_get_sct_registers(void);
+
+
+/**
+ * Sets up the SCT: enables its clock, unifies its counter halves, and
+ * prescales its tick to the given frequency. The counter is left halted,
+ * with empty event/state tables, ready for configuration.
+ *
+ * @param tick_frequency The counter's tick frequency, in Hz; must be
+ *		reachable from the SCT's branch clock with an 8-bit prescaler.
+ * @return 0 on success, or an error code on failure
+ */
+int platform_sct_initialize(uint32_t tick_frequency);
+
+
+/**
+ * Halts the SCT and releases its clock.
+ */
+void platform_sct_shutdown(void);
+
+
+/**
+ * Clears the event, state, and output tables, halting the counter.
+ * Called for you by the PWM and pattern helpers.
+ */
+void platform_sct_clear_tables(void);
+
+
+/**
+ * Programs one entry of the event table. The counter must be halted (as it
+ * is after platform_sct_initialize()).
+ *
+ * @return 0 on success, or EINVAL for an out-of-range entry
+ */
+int platform_sct_configure_event(unsigned event, const sct_event_config_t *config);
+
+
+/**
+ * Starts the counter from zero, with whatever tables are programmed.
+ */
+void platform_sct_run(void);
+
+
+/**
+ * Halts the counter, freezing outputs in their current state.
+ */
+void platform_sct_halt(void);
+
+
+/**
+ * Configures the engine for multi-channel PWM at the given frequency: one
+ * period match drives every channel, so all channels share the period and
+ * rise together. Claims the whole event table; add channels with
+ * platform_sct_set_pwm_duty(), then platform_sct_run().
+ *
+ * @param pwm_frequency The PWM period frequency, in Hz.
+ * @return 0 on success, or an error code on failure
+ */
+int platform_sct_set_up_pwm(uint32_t pwm_frequency);
+
+
+/**
+ * Sets a PWM channel's on-time, claiming an event for the channel on first
+ * use. Safe while running: the new duty is loaded at the next period
+ * boundary, glitch-free.
+ *
+ * @param output The CTOUT output to drive, 0-15.
+ * @param on_ticks The on-time, in counter ticks; 0 holds the output low,
+ *		and anything at or past the period holds it high.
+ * @return 0 on success; EBUSY if the event table is exhausted
+ */
+int platform_sct_set_pwm_duty(unsigned output, uint32_t on_ticks);
+
+
+/**
+ * One step of an output pattern: hold the given output levels for the given
+ * number of counter ticks.
+ */
+typedef struct {
+
+	// How long this step lasts, in counter ticks.
+	uint32_t duration;
+
+	// Outputs driven high and low as the step begins; unmentioned outputs
+	// keep their previous level.
+	uint16_t set_outputs;
+	uint16_t clear_outputs;
+
+} sct_pattern_step_t;
+
+
+/**
+ * Configures the engine as a hardware pattern sequencer: each step drives
+ * its outputs and holds them for its duration, with the whole sequence
+ * either repeating or stopping after the final step. Claims the whole
+ * event table; start the pattern with platform_sct_run().
+ *
+ * @param steps The pattern steps, executed in order.
+ * @param count The number of steps; 1 to SCT_NUM_EVENTS.
+ * @param repeat True for a cyclic pattern; false to stop after the last step.
+ * @return 0 on success, or an error code on failure
+ */
+int platform_sct_set_up_pattern(const sct_pattern_step_t *steps, unsigned count, bool repeat);
+
+
 #endif
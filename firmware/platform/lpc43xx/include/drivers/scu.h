@@ -108,12 +108,77 @@ typedef volatile struct ATTR_PACKED {
 } scu_function_mapping_t;
 
 
+/**
+ * An entry in a pin-configuration table: a single pin, and the full SCU
+ * configuration to be applied to it. Boards and drivers can describe all of
+ * their pins in a const table of these -- which the linker places in flash --
+ * and apply the whole set in a single pass with platform_scu_apply_pin_table.
+ */
+typedef struct {
+	uint8_t group;
+	uint8_t pin;
+	platform_scu_pin_configuration_t configuration;
+} platform_scu_pin_table_entry_t;
+
+
+/**
+ * Initializer for a pin-table entry carrying an explicit SCU configuration.
+ * The trailing arguments are designated initializers for the configuration's
+ * fields, e.g. SCU_PIN_TABLE_ENTRY(2, 9, .function = 0, .input_buffer_enabled = 1).
+ */
+#define SCU_PIN_TABLE_ENTRY(entry_group, entry_pin, ...) \
+	{ .group = (entry_group), .pin = (entry_pin), .configuration = { __VA_ARGS__ } }
+
+/**
+ * Initializer for a pin-table entry with the options that make the most sense
+ * for a normal (<30MHz) GPIO; the table equivalent of platform_scu_configure_pin_gpio.
+ */
+#define SCU_PIN_TABLE_ENTRY_GPIO(entry_group, entry_pin, entry_function, entry_resistors) \
+	SCU_PIN_TABLE_ENTRY(entry_group, entry_pin, \
+		.function = (entry_function), \
+		.pull_resistors = (entry_resistors), \
+		.input_buffer_enabled = 1)
+
+/**
+ * Initializer for a pin-table entry with the options that make the most sense
+ * for a fast (>30MHz) IO; the table equivalent of platform_scu_configure_pin_fast_io.
+ */
+#define SCU_PIN_TABLE_ENTRY_FAST_IO(entry_group, entry_pin, entry_function, entry_resistors) \
+	SCU_PIN_TABLE_ENTRY(entry_group, entry_pin, \
+		.function = (entry_function), \
+		.pull_resistors = (entry_resistors), \
+		.input_buffer_enabled = 1, \
+		.use_fast_slew = 1, \
+		.disable_glitch_filter = 1)
+
+/**
+ * Initializer for a pin-table entry with the options that make the most sense
+ * for a common UART; the table equivalent of platform_scu_configure_pin_uart.
+ */
+#define SCU_PIN_TABLE_ENTRY_UART(entry_group, entry_pin, entry_function) \
+	SCU_PIN_TABLE_ENTRY_GPIO(entry_group, entry_pin, entry_function, SCU_NO_PULL)
+
+
 /**
  * @return a reference to the platform's SCU registers
  */
 platform_scu_registers_t *platform_get_scu_registers(void);
 
 
+/**
+ * Applies a table of pin configurations in a single pass.
+ *
+ * This is the preferred way to bring up a board's (or a bus's) pins: the SCU
+ * register bank is resolved once, each entry is a single register write, and
+ * the table itself can live in flash -- so re-muxing e.g. a whole SGPIO bus
+ * costs tens of register writes rather than tens of function calls.
+ *
+ * @param table An array of pin-table entries; see SCU_PIN_TABLE_ENTRY and friends.
+ * @param count The number of entries in the table.
+ */
+void platform_scu_apply_pin_table(const platform_scu_pin_table_entry_t *table, size_t count);
+
+
 /**
  * Lowest-level API to configure a given pin's configuration in the SCU.
  * Usually, you want one of the platform_scu_configure_pin_<...> functions instead.
@@ -466,6 +466,72 @@ typedef struct {
 } sgpio_pin_configuration_t;
 
 
+/**
+ * A single record in a function's timestamp stream: identifies a point in the
+ * data stream by total fill count, and when the hardware committed it.
+ */
+typedef struct {
+
+	// The function's total fill count (data_in_buffer), in bytes, just after
+	// the timestamped exchange -- i.e. the end of the chunk this stamps.
+	uint32_t fill_count;
+
+	// When the exchange was serviced, in the get_time() microsecond domain.
+	uint32_t time;
+
+} sgpio_timestamp_entry_t;
+
+
+// Upper bound on the bytes a single shadow-register exchange can commit to
+// a function's ring: every one of the sixteen 32-bit slices, concatenated.
+// Used to leave slack when validating capture-trigger window sizes.
+#define SGPIO_EXCHANGE_MAX_BYTES (16 * 4)
+
+
+/**
+ * Trigger conditions for the capture trigger engine; evaluated against each
+ * byte of the function's packed data stream as the copy ISR commits it. For
+ * an 8-bit bus, one byte is one sample; for narrower busses, a byte packs
+ * several consecutive samples, so edge conditions detect transitions at
+ * byte granularity.
+ */
+typedef enum {
+
+	// No trigger; capture runs freely.
+	SGPIO_TRIGGER_NONE = 0,
+
+	// Any masked bit transitions from 0 to 1 between consecutive bytes.
+	SGPIO_TRIGGER_RISING_EDGE = 1,
+
+	// Any masked bit transitions from 1 to 0 between consecutive bytes.
+	SGPIO_TRIGGER_FALLING_EDGE = 2,
+
+	// A byte matches the configured pattern: (byte & mask) == value.
+	SGPIO_TRIGGER_PATTERN = 3,
+
+} sgpio_trigger_mode_t;
+
+
+/**
+ * States for a function's capture trigger; see sgpio_arm_capture_trigger().
+ */
+typedef enum {
+
+	// No trigger armed; a previously-collected window has been abandoned.
+	SGPIO_TRIGGER_IDLE = 0,
+
+	// Capturing continuously while scanning for the trigger condition.
+	SGPIO_TRIGGER_ARMED = 1,
+
+	// Condition seen; still collecting the post-trigger fill.
+	SGPIO_TRIGGER_FIRED = 2,
+
+	// Window frozen in the ring; capture has been halted.
+	SGPIO_TRIGGER_COMPLETE = 3,
+
+} sgpio_trigger_state_t;
+
+
 /**
  * Structure that represents an individual piece of SGPIO functionality.
  */
@@ -540,6 +606,53 @@ typedef struct {
 	// These are nearly always unused.
 	uint32_t overrides;
 
+	// Optional buffer watermark, set via sgpio_set_buffer_watermark(): once
+	// the fill count (data_in_buffer) crosses watermark_level bytes, the
+	// callback is invoked from the data ISR. This lets consumers batch their
+	// downstream work (e.g. USB submissions) into fewer, larger wakeups,
+	// rather than reacting to every shadow-register exchange. A level of
+	// zero disables the watermark.
+	uint32_t watermark_level;
+	void (*watermark_callback)(void *user_data);
+	void *watermark_user_data;
+
+	// Internal watermark state: whether the last exchange left the fill
+	// count at or above the watermark, for edge (crossing) detection.
+	bool watermark_above;
+
+	// Optional timestamp stream, set via sgpio_enable_timestamping(): each
+	// serviced exchange appends an sgpio_timestamp_entry_t to this ring,
+	// pairing positions in the data stream with hardware-timer timestamps.
+	// The ring wraps just like the data buffer does; a NULL buffer disables
+	// timestamping. timestamp_write_index counts total entries ever written;
+	// the entry for index n lives at (n % timestamp_buffer_entries).
+	sgpio_timestamp_entry_t *timestamp_buffer;
+	uint32_t timestamp_buffer_entries;
+	volatile uint32_t timestamp_write_index;
+
+	// Optional capture trigger, set via sgpio_configure_capture_trigger():
+	// while armed, the data ISR lets capture wrap the ring freely while it
+	// scans each exchange's new bytes for the condition below; once the
+	// condition fires and trigger_post_bytes more have arrived, capture is
+	// halted, leaving the ring holding a frozen window around the trigger.
+	sgpio_trigger_mode_t trigger_mode;
+	uint8_t trigger_mask;
+	uint8_t trigger_value;
+	uint32_t trigger_pre_bytes;
+	uint32_t trigger_post_bytes;
+	void (*trigger_callback)(void *user_data);
+	void *trigger_user_data;
+
+	// Internal trigger state: where the scan has reached (ring offset and
+	// total bytes observed since arming), the total-stream index of the
+	// trigger byte, and the previous byte for edge detection.
+	volatile sgpio_trigger_state_t trigger_state;
+	uint32_t trigger_scan_position;
+	uint32_t trigger_bytes_seen;
+	uint32_t trigger_fire_total;
+	uint8_t trigger_previous_byte;
+	bool trigger_have_previous;
+
 	//
 	// Set automatically by the driver -- not for user use.
 	//
@@ -583,8 +696,26 @@ typedef struct {
 	// Reference to the SGPIO controller's registers.
 	platform_sgpio_registers_t *reg;
 
+	// True iff the current function set has passed a validation pass; see
+	// sgpio_validate_functions(). Cleared automatically when validation
+	// fails; users who modify the functions array must clear it themselves.
+	bool functions_validated;
+
 } sgpio_t;
 
+/**
+ * Dry-runs the validation checks for an SGPIO instance's function set,
+ * without touching the hardware: modes, bus widths, pin-to-slice mappings,
+ * and slice availability. On success, marks the function set as validated,
+ * which lets repeated calls to sgpio_set_up_functions() skip the checking
+ * pass entirely -- so production reconfiguration pays for validation once,
+ * at bring-up, rather than on every run.
+ *
+ * @return 0 if the function set is configurable, or an error code
+ *     identifying the first problem found
+ */
+int sgpio_validate_functions(sgpio_t *sgpio);
+
 /**
  * Sets up an SGPIO instance to run a provided set of functions.
  *
@@ -594,6 +725,13 @@ typedef struct {
  */
 int sgpio_set_up_functions(sgpio_t *sgpio);
 
+/**
+ * @return the SGPIO instance most recently configured via
+ *     sgpio_set_up_functions(), or NULL if none has been; used by the
+ *     host-triggered configuration-dump verb
+ */
+sgpio_t *sgpio_most_recently_configured(void);
+
 /**
  * Prints a verbose dump of SGPIO peripheral's state.
  */
@@ -618,12 +756,264 @@ void sgpio_halt(sgpio_t *sgpio);
 bool sgpio_running(sgpio_t *sgpio);
 
 
+/**
+ * Sets (or, with a level of zero, clears) a buffer watermark for one of the
+ * object's functions. The data ISR keeps shuttling each shadow-register
+ * exchange into the function's ring as usual, but the callback only fires
+ * when the fill count crosses the watermark from below -- so a consumer can
+ * sleep through individual exchanges and wake to a large, batchable chunk.
+ * Consumers re-arm the watermark by decrementing data_in_buffer as they
+ * drain the ring.
+ *
+ * May be called before or after sgpio_set_up_functions().
+ *
+ * @param function_index Index of the function, in the object's functions array.
+ * @param watermark_bytes The fill level, in bytes, at which to notify.
+ * @param callback Invoked, from interrupt context, on each upward crossing.
+ * @param user_data Opaque argument passed through to the callback.
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_set_buffer_watermark(sgpio_t *sgpio, unsigned function_index,
+		uint32_t watermark_bytes, void (*callback)(void *user_data), void *user_data);
+
+
+/**
+ * Enables timestamping for one of the object's functions: each serviced
+ * exchange appends a {fill count, time} record to the provided ring, letting
+ * a consumer reconstruct when each chunk of the data stream arrived --
+ * device-side, where the copy ISR's timing is authoritative, rather than
+ * from hopelessly jittery host-side arrival times.
+ *
+ * The ring wraps silently, like the data buffer; consumers that need every
+ * record should size it to cover at least as many exchanges as the data
+ * buffer holds, and drain by watching timestamp_write_index.
+ *
+ * @param function_index The index of the function, in the object's functions array.
+ * @param buffer The caller's ring of timestamp entries.
+ * @param buffer_entries The number of entries the ring holds.
+ * @return 0 on success, or EINVAL for a bad function index or empty buffer
+ */
+int sgpio_enable_timestamping(sgpio_t *sgpio, unsigned function_index,
+		sgpio_timestamp_entry_t *buffer, uint32_t buffer_entries);
+
+
+/**
+ * Disables timestamping for one of the object's functions.
+ *
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_disable_timestamping(sgpio_t *sgpio, unsigned function_index);
+
+
+//
+// Capture trigger engine.
+//
+// Streaming an entire capture to the host to find one event spends nearly
+// all of our USB bandwidth on samples nobody wants. A triggered capture
+// instead lets the ring wrap freely while the data ISR scans for an event
+// of interest, then freezes a window of trigger_pre_bytes before and
+// trigger_post_bytes after it -- so only the interesting window ever
+// crosses the bus, and the workload becomes event-bound rather than
+// bandwidth-bound.
+//
+// Usage: configure, arm, sgpio_run(); when the window completes, the driver
+// halts capture and invokes the completion callback (from interrupt
+// context). Fetch the window's location with sgpio_get_capture_window() and
+// ship those bytes; re-arm to go again.
+//
+
+/**
+ * Configures (or, with SGPIO_TRIGGER_NONE, clears) the capture trigger for
+ * one of the object's functions. Configuration alone has no effect on the
+ * data path; the scan begins when the trigger is armed.
+ *
+ * The condition is evaluated per byte of the packed data stream -- per
+ * sample for an 8-bit bus; at byte granularity for narrower busses.
+ *
+ * @param function_index Index of the function, in the object's functions array.
+ * @param mode The condition to scan for; see sgpio_trigger_mode_t.
+ * @param mask For edge modes, which bits may trigger; for pattern mode, which bits to compare.
+ * @param value For pattern mode, the value the masked bits must equal. Ignored for edge modes.
+ * @param pretrigger_bytes Bytes to preserve before the trigger byte (best effort --
+ *     fewer if the trigger fires before this much has been captured).
+ * @param posttrigger_bytes Bytes to collect after the trigger byte before halting.
+ * @param completion_callback Invoked, from interrupt context, once the window is frozen. Optional.
+ * @param user_data Opaque argument passed through to the callback.
+ * @return 0 on success; EINVAL for a bad function index or a window that
+ *     cannot fit in the function's ring; EBUSY if the trigger is armed
+ */
+int sgpio_configure_capture_trigger(sgpio_t *sgpio, unsigned function_index,
+		sgpio_trigger_mode_t mode, uint8_t mask, uint8_t value,
+		uint32_t pretrigger_bytes, uint32_t posttrigger_bytes,
+		void (*completion_callback)(void *user_data), void *user_data);
+
+
+/**
+ * Arms a configured capture trigger: resets the scan to the function's
+ * current buffer position and begins watching for the condition. Typically
+ * called just before sgpio_run().
+ *
+ * @return 0 on success; EINVAL for a bad function index or no configured
+ *     trigger; EBUSY if already armed
+ */
+int sgpio_arm_capture_trigger(sgpio_t *sgpio, unsigned function_index);
+
+
+/**
+ * Disarms a function's capture trigger, abandoning any partially- or
+ * fully-collected window. Does not halt a running capture.
+ *
+ * @return 0 on success, or EINVAL for a bad function index
+ */
+int sgpio_disarm_capture_trigger(sgpio_t *sgpio, unsigned function_index);
+
+
+/**
+ * Retrieves the frozen capture window after a trigger completes.
+ *
+ * The window spans up to trigger_pre_bytes before the trigger byte (fewer
+ * if the trigger fired early in the capture) through trigger_post_bytes
+ * after it, contiguous in the ring modulo wrap-around.
+ *
+ * @param window_start Out: the window's starting offset within the function's ring.
+ * @param window_length Out: the window's length, in bytes.
+ * @return 0 on success; EINVAL for a bad function index; EAGAIN if no
+ *     completed window is available
+ */
+int sgpio_get_capture_window(sgpio_t *sgpio, unsigned function_index,
+		uint32_t *window_start, uint32_t *window_length);
+
+
+//
+// Configuration snapshots.
+//
+// sgpio_set_up_functions() recomputes slice allocation, multiplexing, and
+// the generated data ISR from scratch -- tens of milliseconds. A snapshot
+// captures the fully-compiled result (register values, SCU pin settings,
+// derived object state, and the generated machine code) so alternating
+// between configurations, e.g. capture and generate, costs only a register
+// restore: microseconds instead.
+//
+
+/** Fixed capacities for configuration snapshots. */
+#define SGPIO_SNAPSHOT_MAX_FUNCTIONS  8
+#define SGPIO_SNAPSHOT_MAX_PINS       24
+#define SGPIO_SNAPSHOT_MAX_ISR_WORDS  32
+#define SGPIO_SNAPSHOT_MAX_ARG_WORDS  8
+
+/**
+ * A compiled SGPIO configuration, as captured by
+ * sgpio_snapshot_configuration(); treat as opaque.
+ */
+typedef struct {
+
+	// True iff this snapshot holds a captured configuration.
+	bool valid;
+
+	// Derived object state.
+	uint32_t slices_in_use;
+	uint32_t pins_in_use;
+	uint32_t swap_irqs_required;
+
+	// Driver-derived per-function state.
+	size_t function_count;
+	struct {
+		uint8_t io_slice;
+		uint8_t buffer_depth_order;
+		uint8_t direction_slice;
+		uint8_t direction_buffer_depth_order;
+	} function_state[SGPIO_SNAPSHOT_MAX_FUNCTIONS];
+
+	// The SGPIO configuration registers, as raw words.
+	uint32_t output_configuration[16];
+	uint32_t shift_configuration[16];
+	uint32_t feature_control[16];
+	uint32_t cycles_per_shift_clock[16];
+	uint32_t cycle_count[16];
+	uint32_t data_buffer_swap_control[16];
+	uint32_t pin_out;
+	uint32_t pin_direction;
+	uint32_t stop_on_next_buffer_swap;
+
+	// SCU configuration for every pin the functions reference.
+	struct {
+		uint8_t group;
+		uint8_t pin;
+		uint32_t value;
+	} scu_pins[SGPIO_SNAPSHOT_MAX_PINS];
+	unsigned scu_pin_count;
+
+	// Image of the generated data ISR: its machine code, its argument
+	// pool, and the handler installed in the vector table.
+	uint16_t isr_body[SGPIO_SNAPSHOT_MAX_ISR_WORDS];
+	unsigned isr_body_words;
+	uint32_t isr_arguments[SGPIO_SNAPSHOT_MAX_ARG_WORDS];
+	void (*isr_vector)(void);
+
+} sgpio_snapshot_t;
+
+
+/**
+ * Captures the object's current, fully-compiled configuration into a
+ * snapshot. Should be called after a successful sgpio_set_up_functions(),
+ * while the configuration to be captured is live.
+ *
+ * @return 0 on success, or EINVAL if the object isn't set up or exceeds
+ *		the snapshot's capacities
+ */
+int sgpio_snapshot_configuration(sgpio_t *sgpio, sgpio_snapshot_t *snapshot);
+
+
+/**
+ * Restores a previously-captured configuration -- registers, pin settings,
+ * and generated ISR -- without recomputation. The object's functions array
+ * must be the one that was live at capture time, as the generated code
+ * references its buffers directly. The restored configuration is left
+ * halted; follow with sgpio_run().
+ *
+ * @return 0 on success, or EINVAL for an invalid or mismatched snapshot
+ */
+int sgpio_restore_snapshot(sgpio_t *sgpio, const sgpio_snapshot_t *snapshot);
+
+
 /**
  * @returns a reference to the register bank for the device's SGPIO
  */
 platform_sgpio_registers_t *platform_get_sgpio_registers(void);
 
 
+//
+// DMA capture engine -- an alternative to the generated-ISR data path that
+// drains the I/O slice's shadow register via the GPDMA controller, leaving
+// the processor entirely free. See sgpio_dma.c.
+//
+
+/**
+ * @return true iff the given function can be serviced by the DMA engine
+ */
+bool sgpio_dma_capture_possible(sgpio_function_t *function);
+
+/**
+ * Sets up a continuous DMA capture for the given function. Should be called
+ * after sgpio_set_up_functions(), but before sgpio_run(); the function
+ * should carry the SGPIO_FUNCTION_OVERRIDE_NEVER_USE_ISR override.
+ *
+ * @return 0 on success; ENOSYS if the function can't be serviced by DMA.
+ */
+int sgpio_dma_prepare_capture(sgpio_t *sgpio, sgpio_function_t *function);
+
+/**
+ * @return the current capture position, as a byte offset into the
+ *     function's user buffer -- i.e. where the DMA engine will write next
+ */
+uint32_t sgpio_dma_capture_position(sgpio_function_t *function);
+
+/**
+ * Terminates an active DMA capture, halting the channel and releasing it.
+ */
+void sgpio_dma_terminate_capture(sgpio_function_t *function);
+
+
 /**
  * @returns The clock source constant for using the given pin as a clock source.
  */
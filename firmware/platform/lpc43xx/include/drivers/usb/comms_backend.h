@@ -13,6 +13,33 @@
 usb_request_status_t libgreat_comms_vendor_request_handler(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 
+/**
+ * Sets up the bulk comms transport on a pair of (already-initialized) bulk
+ * endpoints, and begins accepting commands on the OUT endpoint.
+ *
+ * @param out_endpoint The bulk OUT endpoint on which commands will be received.
+ * @param in_endpoint The bulk IN endpoint on which responses will be sent.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int libgreat_comms_bulk_initialize(usb_endpoint_t *out_endpoint, usb_endpoint_t *in_endpoint);
+
+/**
+ * Binds a registered comms pipe to a pair of (already-initialized) bulk
+ * endpoints, making it usable for transmission, and arming reception if
+ * an OUT endpoint is provided. Either endpoint may be NULL for a
+ * unidirectional pipe.
+ *
+ * @param pipe The pipe to be bound.
+ * @param in_endpoint The bulk IN endpoint for device-to-host pipe data.
+ * @param out_endpoint The bulk OUT endpoint for host-to-device pipe data.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+struct comms_pipe;
+int libgreat_comms_bind_pipe_to_endpoints(struct comms_pipe *pipe,
+		usb_endpoint_t *in_endpoint, usb_endpoint_t *out_endpoint);
+
 #endif
 
 
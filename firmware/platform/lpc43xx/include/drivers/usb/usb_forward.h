@@ -0,0 +1,151 @@
+/*
+ * This file is part of GreatFET
+ */
+
+#ifndef __USB_FORWARD_H__
+#define __USB_FORWARD_H__
+
+#include "usb_type.h"
+#include "usb_queue.h"
+#include "usb_queue_host.h"
+
+/*
+ * On-device USB forwarding: proxying traffic between the device-mode
+ * controller and a device attached to the host-mode controller without a
+ * round trip through the host PC. Each channel pairs one device-mode
+ * endpoint with one host-mode endpoint queue, in one direction; completed
+ * transfers on the receiving side re-queue the same buffer on the sending
+ * side, so a proxied packet crosses the firmware with zero copies and
+ * microseconds -- not milliseconds -- of added latency.
+ *
+ * An optional filter hook sees every packet between the two sides, and can
+ * rewrite it in place, change its length, or drop it. Everything runs from
+ * the two controllers' completion interrupts; no task ever touches the
+ * data path.
+ */
+
+// The most buffers a single channel can circulate.
+#define USB_FORWARD_MAX_BUFFERS 4
+
+
+/**
+ * The direction a channel carries data.
+ */
+typedef enum {
+
+	// From the device-mode side to the host-mode side: packets received on
+	// a device OUT endpoint are sent onward with host OUT transfers.
+	USB_FORWARD_TO_HOST_SIDE = 0,
+
+	// From the host-mode side to the device-mode side: packets gathered by
+	// host IN transfers are offered upstream on a device IN endpoint.
+	USB_FORWARD_TO_DEVICE_SIDE = 1,
+
+} usb_forward_direction_t;
+
+
+/**
+ * Verdicts a filter hook can return for a packet.
+ */
+typedef enum {
+	USB_FORWARD_ACTION_FORWARD = 0,
+	USB_FORWARD_ACTION_DROP    = 1,
+} usb_forward_action_t;
+
+
+typedef struct usb_forward_channel usb_forward_channel_t;
+
+/**
+ * Filter hook type. Called (from interrupt context!) with each received
+ * packet before it's forwarded; may modify the data in place, and may
+ * shrink or grow the packet by adjusting *length up to the channel's
+ * buffer size. Returning USB_FORWARD_ACTION_DROP re-arms the receive side
+ * without sending anything.
+ */
+typedef usb_forward_action_t (*usb_forward_filter_t)(
+		usb_forward_channel_t *channel, void *data, uint32_t *length);
+
+
+/**
+ * Bookkeeping for one buffer circulating through a channel.
+ */
+typedef struct {
+	usb_forward_channel_t *channel;
+	void *data;
+} usb_forward_buffer_t;
+
+
+/**
+ * A unidirectional forwarding channel. Allocate one (statically, typically)
+ * per proxied endpoint direction; all fields are managed by the functions
+ * below, and the statistics may be read at any time.
+ */
+struct usb_forward_channel {
+
+	// The device-mode endpoint carrying the upstream-facing side.
+	usb_endpoint_t *device_endpoint;
+
+	// The host-mode side: the peripheral acting as host, and the endpoint
+	// queue for the downstream device. The queue head should be set up to
+	// handle data toggling itself.
+	usb_peripheral_t *host;
+	ehci_queue_head_t *host_qh;
+
+	// The direction this channel carries data, and its filter hook, if any.
+	usb_forward_direction_t direction;
+	usb_forward_filter_t filter;
+
+	// The buffers circulating through the channel.
+	usb_forward_buffer_t buffers[USB_FORWARD_MAX_BUFFERS];
+	uint32_t buffer_size;
+	uint8_t buffer_count;
+
+	// True while the channel should keep re-arming itself.
+	volatile bool active;
+
+	// Statistics: packets and bytes carried across, packets the filter
+	// dropped, and transfers that failed on either side.
+	volatile uint32_t packets_forwarded;
+	volatile uint32_t bytes_forwarded;
+	volatile uint32_t packets_dropped;
+	volatile uint32_t errors;
+
+};
+
+
+/**
+ * Starts a forwarding channel: every buffer is armed on the channel's
+ * receiving side, and forwarding continues until usb_forward_stop().
+ *
+ * Both controllers must be up, with the device endpoint initialized and the
+ * host queue head configured (with automatic data toggle handling) for the
+ * proxied endpoint. Buffers must each hold buffer_size bytes, and should be
+ * sized to the larger of the two endpoints' maximum packet sizes.
+ *
+ * @param channel The channel state; must remain valid until stopped.
+ * @param direction The direction this channel carries data.
+ * @param device_endpoint The device-mode endpoint for the upstream side.
+ * @param host The peripheral acting as USB host.
+ * @param host_qh The endpoint queue for the downstream device.
+ * @param buffers The buffers to circulate; 1 to USB_FORWARD_MAX_BUFFERS of
+ *		them. Two or more keep a receive armed while another forwards.
+ * @param buffer_count The number of buffers provided.
+ * @param buffer_size The size of each buffer, in bytes.
+ * @param filter An optional filter hook, or NULL to forward everything.
+ * @return 0 on success, or an error code on failure
+ */
+int usb_forward_start(usb_forward_channel_t *channel,
+		usb_forward_direction_t direction, usb_endpoint_t *device_endpoint,
+		usb_peripheral_t *host, ehci_queue_head_t *host_qh,
+		void *const *buffers, unsigned buffer_count, uint32_t buffer_size,
+		usb_forward_filter_t filter);
+
+
+/**
+ * Stops a forwarding channel: in-flight transfers complete, but no buffer
+ * is re-armed afterwards. Statistics are preserved for reading.
+ */
+void usb_forward_stop(usb_forward_channel_t *channel);
+
+
+#endif//__USB_FORWARD_H__
@@ -66,6 +66,18 @@ void usb_host_disable_asynchronous_schedule(usb_peripheral_t *host);
 void usb_host_enable_asynchronous_schedule(usb_peripheral_t *host);
 
 
+/**
+ * Disables the periodic schedule, blocking until it's fully down.
+ */
+void usb_host_disable_periodic_schedule(usb_peripheral_t *host);
+
+
+/**
+ * Enables the periodic schedule, blocking until it fully comes up.
+ */
+void usb_host_enable_periodic_schedule(usb_peripheral_t *host);
+
+
 #endif
 
 
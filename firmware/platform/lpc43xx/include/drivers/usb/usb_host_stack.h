@@ -110,4 +110,213 @@ int usb_host_switch_configuration(usb_peripheral_t *host,
 int usb_host_set_address(usb_peripheral_t *host,
 	ehci_queue_head_t *qh, uint16_t address);
 
+
+//
+// Enumeration caching.
+//
+
+/** Maximum interface (alternate) settings a configuration cache can index. */
+#define USB_HOST_MAX_CACHED_INTERFACES 8
+
+/** Maximum endpoints a configuration cache can index. */
+#define USB_HOST_MAX_CACHED_ENDPOINTS 16
+
+/**
+ * Indexed summary of a single interface (alternate) setting, parsed out of
+ * a cached configuration descriptor.
+ */
+typedef struct {
+
+	// The interface's number and alternate-setting number.
+	uint8_t interface_number;
+	uint8_t alternate_setting;
+
+	// The interface's class triplet.
+	uint8_t interface_class;
+	uint8_t interface_subclass;
+	uint8_t interface_protocol;
+
+	// The interface's endpoints: a count, and the index of its first
+	// endpoint in the cache's endpoint table (its endpoints are contiguous).
+	uint8_t endpoint_count;
+	uint8_t first_endpoint_index;
+
+} usb_host_cached_interface_t;
+
+
+/**
+ * Indexed summary of a single endpoint, parsed out of a cached
+ * configuration descriptor.
+ */
+typedef struct {
+
+	// The endpoint's address, including its direction bit.
+	uint8_t address;
+
+	// The endpoint's attributes; the low two bits carry its transfer type.
+	uint8_t attributes;
+
+	// The endpoint's maximum packet size and polling interval.
+	uint16_t max_packet_size;
+	uint8_t interval;
+
+	// Index of the owning interface in the cache's interface table.
+	uint8_t interface_index;
+
+} usb_host_cached_endpoint_t;
+
+
+/**
+ * A device's enumeration cache: the raw configuration blob -- fetched over
+ * the bus exactly once -- plus indexed interface and endpoint tables parsed
+ * from it, so repeated lookups never touch the bus.
+ */
+typedef struct {
+
+	// The full configuration descriptor and its subordinates, in an
+	// allocator-backed buffer; NULL when the cache is unpopulated.
+	uint8_t *raw;
+	uint16_t raw_length;
+
+	// The configuration's bConfigurationValue, for SET_CONFIGURATION.
+	uint8_t configuration_value;
+
+	// The parsed indexes.
+	uint8_t interface_count;
+	uint8_t endpoint_count;
+	usb_host_cached_interface_t interfaces[USB_HOST_MAX_CACHED_INTERFACES];
+	usb_host_cached_endpoint_t endpoints[USB_HOST_MAX_CACHED_ENDPOINTS];
+
+} usb_host_configuration_cache_t;
+
+
+/**
+ * Populates an enumeration cache for the attached device: fetches the full
+ * configuration blob in a single control transfer (after one short read for
+ * its total length), and parses its interfaces and endpoints into the
+ * cache's indexes.
+ *
+ * @param host The USB peripheral to work with.
+ * @param qh The endpoint object for the device's control endpoint.
+ * @param cache The cache to populate; any previous contents are freed.
+ * @return 0 on success, -ENOMEM if the blob couldn't be allocated, or
+ *		another negative error code if the bus reads failed
+ */
+int usb_host_cache_configuration(usb_peripheral_t *host,
+	ehci_queue_head_t *qh, usb_host_configuration_cache_t *cache);
+
+
+/**
+ * Releases an enumeration cache's backing allocation, returning it to the
+ * unpopulated state.
+ */
+void usb_host_free_configuration_cache(usb_host_configuration_cache_t *cache);
+
+
+/**
+ * Finds an interface in an enumeration cache without touching the bus.
+ *
+ * @return the cached interface, or NULL if the cache holds no such interface
+ */
+usb_host_cached_interface_t *usb_host_find_cached_interface(
+	usb_host_configuration_cache_t *cache, uint8_t interface_number,
+	uint8_t alternate_setting);
+
+
+/**
+ * Finds an endpoint in an enumeration cache by address (including its
+ * direction bit) without touching the bus.
+ *
+ * @return the cached endpoint, or NULL if the cache holds no such endpoint
+ */
+usb_host_cached_endpoint_t *usb_host_find_cached_endpoint(
+	usb_host_configuration_cache_t *cache, uint8_t address);
+
+
+/**
+ * Finds the first endpoint of the given transfer type and direction --
+ * optionally restricted to a single cached interface -- without touching
+ * the bus.
+ *
+ * @param transfer_type The USB transfer type (0 control, 1 iso, 2 bulk,
+ *		3 interrupt), as in the endpoint attributes field.
+ * @param is_in True for device-to-host endpoints.
+ * @param interface If non-NULL, only this interface's endpoints are searched.
+ * @return the cached endpoint, or NULL if no endpoint matches
+ */
+usb_host_cached_endpoint_t *usb_host_find_cached_endpoint_by_type(
+	usb_host_configuration_cache_t *cache, uint8_t transfer_type, bool is_in,
+	const usb_host_cached_interface_t *interface);
+
+
+/**
+ * Callback type for asynchronous host-stack operations.
+ *
+ * @param user_data The opaque argument provided at submission.
+ * @param status 0 on success, EPIPE if the device stalled, EIO on a USB
+ * 	error, or another error code if a stage could not be scheduled.
+ * @param length_transferred The total data-stage bytes transferred.
+ */
+typedef void (*usb_host_async_completion_cb)(void *user_data, int status,
+	uint32_t length_transferred);
+
+
+/**
+ * Issues a control request to the device without blocking: each stage of the
+ * control transfer is chained from the previous stage's completion interrupt,
+ * and the provided callback fires once the request has fully completed (or
+ * failed). The setup packet is composed internally, so no caller storage
+ * needs to outlive the call except the data-stage buffer.
+ *
+ * Takes the same request arguments as usb_host_control_request.
+ *
+ * @param defer_completion If true, the callback runs from the scheduler's
+ * 	next round rather than from interrupt context.
+ * @param callback The completion callback; see usb_host_async_completion_cb.
+ * @param user_data Opaque argument passed through to the callback.
+ *
+ * @return 0 if the request was submitted, or an error code on failure
+ */
+int usb_host_control_request_async(usb_peripheral_t *host,
+	ehci_queue_head_t *qh, usb_setup_request_type_t request_type, uint8_t request,
+	uint16_t value, uint16_t index, uint16_t length, void *buffer,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data);
+
+
+/**
+ * Schedules a transfer on the given endpoint without blocking; the callback
+ * fires once the transfer completes. Multiple asynchronous transfers may be
+ * outstanding on the same endpoint; they chain onto the endpoint's queue
+ * head and execute (and complete) in submission order.
+ *
+ * @param pid_code The PID code to use for the given transfer. Sets direction.
+ * @param data_toggle The Data Toggle bit for USB; ignored if the endpoint
+ * 	handles data toggling itself.
+ * @param defer_completion If true, the callback runs from the scheduler's
+ * 	next round rather than from interrupt context.
+ *
+ * @return 0 if the transfer was submitted, or an error code on failure
+ */
+int usb_host_transfer_async(usb_peripheral_t *host, ehci_queue_head_t *endpoint,
+	usb_token_t pid_code, int data_toggle, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data);
+
+
+/**
+ * Convenience function that receives data on a given endpoint without
+ * blocking; see usb_host_transfer_async.
+ */
+int usb_host_read_from_endpoint_async(usb_peripheral_t *host,
+	ehci_queue_head_t *endpoint, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data);
+
+
+/**
+ * Convenience function that sends data on a given endpoint without
+ * blocking; see usb_host_transfer_async.
+ */
+int usb_host_send_on_endpoint_async(usb_peripheral_t *host,
+	ehci_queue_head_t *endpoint, void *data, uint32_t length,
+	bool defer_completion, usb_host_async_completion_cb callback, void *user_data);
+
 #endif
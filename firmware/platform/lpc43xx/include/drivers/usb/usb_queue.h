@@ -23,12 +23,24 @@ struct _usb_transfer_t {
         void* user_data;
 };
 
+// Bookkeeping for one half of a double-buffered ("ping-pong") endpoint.
+struct _usb_pingpong_slot_t {
+        struct _usb_queue_t* queue;
+        void* buffer;
+};
+
 // This is an opaque datatype. Thou shall not touch these members.
 struct _usb_queue_t {
         struct usb_endpoint_t* endpoint;
         const unsigned int pool_size;
         usb_transfer_t* volatile free_transfers;
         usb_transfer_t* volatile active;
+
+        // Double-buffered mode state; see usb_queue_start_pingpong.
+        volatile bool pingpong_active;
+        struct _usb_pingpong_slot_t pingpong_slots[2];
+        uint32_t pingpong_buffer_size;
+        transfer_completion_cb pingpong_completion_cb;
 };
 
 #define USB_DECLARE_QUEUE(endpoint_name)                                \
@@ -43,6 +55,54 @@ struct _usb_queue_t {
 
 void usb_queue_flush_endpoint(const usb_endpoint_t* const endpoint);
 
+/*
+ * Lightweight per-endpoint performance counters, maintained by the queue and
+ * schedule paths. Cheap enough to stay enabled in production; read (and
+ * cleared) from the host via the core class's introspection verbs, so
+ * streaming bottlenecks can be diagnosed without a bus analyzer.
+ */
+typedef struct {
+        // Transfers retired through the completion path, and the bytes
+        // they actually moved.
+        uint32_t transfers_completed;
+        uint32_t bytes_transferred;
+
+        // Transfers aborted due to a halted/error'd transfer descriptor.
+        uint32_t transfer_errors;
+
+        // Times the completion path drained the queue entirely -- i.e. the
+        // endpoint went idle because software had nothing further queued.
+        uint32_t queue_empty_events;
+
+        // Worst-case number of polls spent waiting for the controller to
+        // accept a prime; a proxy for how long re-priming stalls us.
+        uint32_t max_prime_wait_spins;
+
+        // Schedule attempts that failed because the endpoint's transfer
+        // descriptor pool was empty. A climbing count means the pool is
+        // undersized for the workload (or completions aren't being drained).
+        uint32_t pool_exhaustions;
+} usb_endpoint_stats_t;
+
+/*
+ * Returns the counters for the given endpoint, or NULL if the address is out
+ * of range. The returned structure is live; zero it to reset the counters.
+ */
+usb_endpoint_stats_t* usb_endpoint_stats_for_address(
+        uint8_t controller, uint8_t endpoint_address);
+
+/* Internal: records a prime-wait duration observed by the schedule path. */
+void usb_stats_note_prime_wait(
+        const usb_endpoint_t* const endpoint, uint32_t spins);
+
+/*
+ * Schedules a transfer. Non-blocking: descriptors come from a lock-free
+ * pool, so this is safe against concurrent ISR completion without masking
+ * interrupts, and returns ENOSPC immediately -- charging the endpoint's
+ * pool_exhaustions counter -- if the pool is empty. Callers that can retry
+ * later (e.g. from a completion callback) should prefer this over the
+ * _block/_wait variants, which poll until a descriptor frees up.
+ */
 int usb_transfer_schedule(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
@@ -51,6 +111,57 @@ int usb_transfer_schedule(
         void* const user_data
 );
 
+// A single segment of a scatter-gather transfer.
+typedef struct {
+        void* data;
+        uint32_t length;
+} usb_transfer_segment_t;
+
+// Maximum number of segments accepted by usb_transfer_schedule_vector.
+#define USB_TRANSFER_MAX_SEGMENTS 8
+
+/*
+ * Schedules a scatter-gather transfer: each segment gets its own transfer
+ * descriptor, chained so the controller moves all of them as one submission
+ * with no inter-segment software involvement and no compaction copies.
+ * Useful for ring-buffer wrap-around regions or header+payload pairs.
+ *
+ * The completion callback fires once, after the final segment completes.
+ *
+ * Returns 0 on success, or an error code on failure; on failure, nothing
+ * has been queued.
+ */
+int usb_transfer_schedule_vector(
+	const usb_endpoint_t* const endpoint,
+	const usb_transfer_segment_t* const segments,
+	const unsigned int segment_count,
+        const transfer_completion_cb completion_cb,
+        void* const user_data
+);
+
+/*
+ * Schedules a transfer on an isochronous endpoint.
+ *
+ * Isochronous descriptors carry the number of transactions the controller
+ * should issue within each microframe (1-3); high-bandwidth endpoints
+ * advertise values above one via bits 12:11 of their wMaxPacketSize, and
+ * should pass the same count here. The endpoint must have been initialized
+ * as USB_TRANSFER_TYPE_ISOCHRONOUS, so its queue head's MULT field matches.
+ *
+ * No handshake or retry occurs on isochronous endpoints; the completion
+ * callback reports however many bytes actually moved.
+ *
+ * Returns 0 on success, or an error code on failure.
+ */
+int usb_transfer_schedule_isochronous(
+	const usb_endpoint_t* const endpoint,
+	void* const data,
+	const uint32_t maximum_length,
+	const uint_fast8_t transactions_per_microframe,
+        const transfer_completion_cb completion_cb,
+        void* const user_data
+);
+
 int usb_transfer_schedule_block(
 	const usb_endpoint_t* const endpoint,
 	void* const data,
@@ -84,4 +195,33 @@ void usb_queue_transfer_complete(
 void usb_queue_invalidate_transfers(
         usb_endpoint_t* const endpoint
 );
+
+/*
+ * Places an endpoint into double-buffered ("ping-pong") mode: both provided
+ * buffers are primed immediately, and each is re-armed from within the
+ * transfer-complete ISR as soon as it finishes -- so the endpoint always has
+ * a descriptor ready and never NAKs while software catches up.
+ *
+ * The completion callback is invoked (from interrupt context) once per
+ * completed transfer, with the just-completed buffer as its first argument;
+ * the buffer is re-queued immediately after the callback returns, so the
+ * callback must finish with the buffer's contents before returning.
+ *
+ * Returns 0 on success, or an error code on failure.
+ */
+int usb_queue_start_pingpong(
+        usb_endpoint_t* const endpoint,
+        void* const buffer_a,
+        void* const buffer_b,
+        const uint32_t buffer_size,
+        const transfer_completion_cb completion_cb
+);
+
+/*
+ * Takes an endpoint out of double-buffered mode; completed buffers are no
+ * longer re-armed. Any already-queued transfers complete normally.
+ */
+void usb_queue_stop_pingpong(
+        usb_endpoint_t* const endpoint
+);
 #endif//__USB_QUEUE_H__
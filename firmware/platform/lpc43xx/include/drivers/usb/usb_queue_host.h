@@ -201,4 +201,94 @@ void usb_host_clean_up_completed_transfers(ehci_queue_head_t *qh);
 void usb_host_handle_asynchronous_transfer_complete(usb_peripheral_t *host);
 
 
+/**
+ * State for a continuous periodic (interrupt-endpoint) read: a ring of
+ * hardware-filled result slots, plus the bookkeeping needed to keep one
+ * poll outstanding at all times. See usb_host_periodic_read_start.
+ */
+typedef struct {
+
+	// The host and endpoint queue head being polled.
+	usb_peripheral_t *host;
+	ehci_queue_head_t *qh;
+
+	// The ring's backing storage: entry_count slots of entry_size bytes,
+	// plus a caller-provided array receiving each result's actual length.
+	uint8_t *buffer;
+	uint16_t entry_size;
+	uint16_t entry_count;
+	uint16_t *lengths;
+
+	// Total results ever produced / consumed; a slot's index is the count
+	// modulo entry_count.
+	volatile uint32_t write_index;
+	volatile uint32_t read_index;
+
+	// Results dropped because the consumer fell a full ring behind, and
+	// polls that failed outright.
+	volatile uint32_t overruns;
+	volatile uint32_t errors;
+
+	// True while the poll loop should keep rescheduling itself.
+	volatile bool active;
+
+} usb_host_periodic_poll_t;
+
+
+/**
+ * Sets up an endpoint for hardware-scheduled polling on the periodic
+ * schedule (e.g. an interrupt endpoint). The polling interval is rounded
+ * down to a power of two of frames; the periodic schedule is enabled as
+ * a side effect.
+ *
+ * @param qh If provided, the endpoint QH object to set up. If NULL, one
+ *		will be automatically allocated and returned.
+ * @param interval_frames The endpoint's polling interval, in frames (ms),
+ *		as reported in its endpoint descriptor.
+ * @return the endpoint's queue head, or NULL on failure
+ */
+ehci_queue_head_t * usb_host_set_up_periodic_endpoint_queue(
+		usb_peripheral_t *host, ehci_queue_head_t *qh, uint8_t device_address,
+		uint8_t endpoint_number, usb_speed_t endpoint_speed,
+		bool handle_data_toggle, uint16_t max_packet_size, uint16_t interval_frames);
+
+
+/**
+ * Begins continuously reading from a periodic endpoint, posting each
+ * completed read into a ring buffer; each hardware-scheduled poll lands in
+ * the next ring slot, without any control-path round trips.
+ *
+ * @param poll The poll state object; must remain valid until stopped.
+ * @param buffer The ring's backing storage; entry_count * entry_size bytes.
+ * @param entry_size The size of each ring slot; typically the endpoint's
+ *		maximum packet size.
+ * @param entry_count The number of slots in the ring.
+ * @param lengths Caller-provided array of entry_count elements, which
+ *		receives the actual length of each completed read.
+ * @return 0 on success, or an error code on failure
+ */
+int usb_host_periodic_read_start(usb_host_periodic_poll_t *poll,
+	usb_peripheral_t *host, ehci_queue_head_t *qh, void *buffer,
+	uint16_t entry_size, uint16_t entry_count, uint16_t *lengths);
+
+
+/**
+ * Stops a periodic read loop; the in-flight poll (if any) completes without
+ * rescheduling. Does not tear down the endpoint's queue head.
+ */
+void usb_host_periodic_read_stop(usb_host_periodic_poll_t *poll);
+
+
+/**
+ * Consumes the oldest unread result from a periodic read ring.
+ *
+ * @param out If non-NULL, receives a pointer to the result's data, valid
+ *		until entry_count further polls complete.
+ * @param out_length If non-NULL, receives the result's length in bytes.
+ * @return true iff a result was dequeued
+ */
+bool usb_host_periodic_read_dequeue(usb_host_periodic_poll_t *poll,
+	void **out, uint16_t *out_length);
+
+
 #endif//__USB_QUEUE_HOST_H__
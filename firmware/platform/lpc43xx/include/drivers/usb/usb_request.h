@@ -40,6 +40,33 @@ typedef struct {
 extern const usb_request_handlers_t usb0_request_handlers;
 extern const usb_request_handlers_t usb1_request_handlers;
 
+// Bounds for the registered-handler tables, below: the highest interface
+// and endpoint numbers a handler can be keyed to.
+#define USB_REQUEST_MAX_INTERFACES 8
+#define USB_REQUEST_MAX_ENDPOINTS  8
+
+/**
+ * Registers a control request handler keyed by (type, recipient, target),
+ * so composite-device functions each receive exactly the requests addressed
+ * to them: lookup is a pair of array indexes, and no request is ever walked
+ * through another function's handler. Registered handlers take precedence
+ * over the per-type usb{0,1}_request_handlers tables, which remain the
+ * fallback for keys with no registration.
+ *
+ * @param controller The controller to register for (0 or 1).
+ * @param type The request type the handler accepts: one of the
+ *		USB_SETUP_REQUEST_TYPE_{STANDARD,CLASS,VENDOR,RESERVED} constants.
+ * @param recipient The recipient the handler accepts: one of the
+ *		USB_SETUP_REQUEST_RECIPIENT_* constants.
+ * @param target The interface or endpoint number the handler is bound to
+ *		(for the endpoint recipient, the number without its direction bit);
+ *		ignored for the device and other recipients.
+ * @param handler The handler to register, or NULL to remove a registration.
+ * @return 0 on success, or an error code on failure.
+ */
+int usb_request_register_handler(uint32_t controller, uint8_t type,
+		uint8_t recipient, uint8_t target, usb_request_handler_fn handler);
+
 void usb_setup_complete(
 	usb_endpoint_t* const endpoint
 );
@@ -12,6 +12,14 @@ void usb_set_configuration_changed_cb(
         void (*callback)(usb_peripheral_t* const)
 );
 
+/**
+ * Pre-resolves each of the given device's descriptors into a lookup cache,
+ * so GET_DESCRIPTOR handling is a table lookup rather than a descriptor-table
+ * walk. Called automatically from usb_device_init(); call again if the
+ * descriptor tables are ever replaced wholesale.
+ */
+void usb_standard_request_prepare_descriptors(usb_peripheral_t* const device);
+
 usb_request_status_t usb_standard_request(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage
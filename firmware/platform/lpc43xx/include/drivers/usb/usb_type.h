@@ -17,6 +17,10 @@
 #define USB_PERIODIC_LIST_SIZE         8
 #define USB_TOTAL_TRANSFER_DESCRIPTORS 8
 
+// Number of power-of-two polling intervals the periodic schedule supports;
+// with an 8-entry frame list, that's intervals of 1, 2, 4, and 8 frames.
+#define USB_HOST_PERIODIC_INTERVAL_LEVELS 4
+
 
 typedef struct ATTR_PACKED {
 	uint8_t request_type;
@@ -254,6 +258,12 @@ typedef struct {
 			ehci_queue_head_t async_queue_head;
 			ehci_queue_head_t periodic_queue_head;  // TODO: rename me, I'm not really a head?
 
+			// Interval anchors for the periodic schedule: one inactive queue
+			// head per power-of-two polling interval, chained from largest
+			// interval to smallest. Endpoint queue heads are inserted just
+			// after their interval's anchor; see usb_queue_host.c.
+			ehci_queue_head_t periodic_interval_anchors[USB_HOST_PERIODIC_INTERVAL_LEVELS];
+
 			// TODO: abstract these counts?
 			ehci_link_t periodic_list[8];
 
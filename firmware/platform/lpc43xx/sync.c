@@ -5,7 +5,13 @@
  */
 
 /* TODO: move me to a more general location? */
+#include <stdbool.h>
+
 #include <sync.h>
+#include <drivers/timer.h>
+
+// Exclusive-access primitives, per the usb_queue free-list idiom.
+#include <libopencm3/cm3/sync.h>
 
 // Calls to our raw assembly mutex code, from sync.S
 void _lock_mutex(uint32_t *mutex);
@@ -35,5 +41,375 @@ void libgreat_mutex_lock(mutex_t *mutex)
  */
 void libgreat_mutex_unlock(mutex_t *mutex)
 {
-	_unlock_mutex(mutex);	
+	_unlock_mutex(mutex);
+}
+
+
+//
+// Reader-writer locks.
+//
+// The lock's state word encodes everything: a writer-held flag, a
+// writer-waiting flag, and -- in the remaining bits -- the count of readers
+// currently inside. All transitions happen through a single LDREX/STREX
+// pair, so any mix of readers and writers (including interrupt context)
+// can race safely on one core.
+//
+
+#define RWLOCK_WRITER_HELD    (1UL << 31)
+#define RWLOCK_WRITER_WAITING (1UL << 30)
+#define RWLOCK_READER_MASK    (RWLOCK_WRITER_WAITING - 1)
+
+// Bounds for the contention backoff, in iterations of a trivial delay loop.
+#define SYNC_BACKOFF_INITIAL (8)
+#define SYNC_BACKOFF_MAXIMUM (1024)
+
+
+/** Delays for the current backoff interval, then doubles it (to a cap) --
+ * so contenders spread out instead of hammering the exclusive monitor. */
+static void sync_backoff(uint32_t *delay)
+{
+	for (uint32_t i = *delay; i; --i) {
+		__asm__ volatile ("nop");
+	}
+
+	if (*delay < SYNC_BACKOFF_MAXIMUM) {
+		*delay <<= 1;
+	}
+}
+
+
+/** Barrier pairing with lock acquisition/release, per the sync.S mutexes. */
+static inline void sync_access_barrier(void)
+{
+	__asm__ volatile ("dmb" ::: "memory");
+}
+
+
+/**
+ * Initializes a new reader-writer lock.
+ */
+void libgreat_rwlock_init(rwlock_t *lock)
+{
+	lock->state = 0;
+}
+
+
+/**
+ * Acquires the given lock for reading; see <sync.h>.
+ */
+void libgreat_rwlock_read_lock(rwlock_t *lock)
+{
+	uint32_t delay = SYNC_BACKOFF_INITIAL;
+	uint32_t state;
+
+	while (1) {
+		state = __ldrex((uint32_t *)&lock->state);
+
+		// Wait while a writer holds the lock -- or is waiting for it, so a
+		// read-heavy workload can't starve its rare reconfigurations.
+		if (state & (RWLOCK_WRITER_HELD | RWLOCK_WRITER_WAITING)) {
+			sync_backoff(&delay);
+			continue;
+		}
+
+		if (!__strex(state + 1, (uint32_t *)&lock->state)) {
+			break;
+		}
+	}
+
+	sync_access_barrier();
+}
+
+
+/**
+ * Releases a read hold on the given lock; see <sync.h>.
+ */
+void libgreat_rwlock_read_unlock(rwlock_t *lock)
+{
+	uint32_t state;
+
+	sync_access_barrier();
+
+	do {
+		state = __ldrex((uint32_t *)&lock->state);
+	} while (__strex(state - 1, (uint32_t *)&lock->state));
+}
+
+
+/**
+ * Acquires the given lock exclusively; see <sync.h>.
+ */
+void libgreat_rwlock_write_lock(rwlock_t *lock)
+{
+	uint32_t delay = SYNC_BACKOFF_INITIAL;
+	uint32_t state;
+
+	while (1) {
+		state = __ldrex((uint32_t *)&lock->state);
+
+		// While the lock is held, make sure the writer-waiting flag is up --
+		// it's what holds new readers at the door -- and back off.
+		if (state & (RWLOCK_WRITER_HELD | RWLOCK_READER_MASK)) {
+			if (!(state & RWLOCK_WRITER_WAITING)) {
+				__strex(state | RWLOCK_WRITER_WAITING, (uint32_t *)&lock->state);
+			}
+
+			sync_backoff(&delay);
+			continue;
+		}
+
+		// The lock is free (modulo our own waiting flag); take it. Another
+		// waiting writer will simply raise the flag again on its next spin.
+		if (!__strex(RWLOCK_WRITER_HELD, (uint32_t *)&lock->state)) {
+			break;
+		}
+	}
+
+	sync_access_barrier();
+}
+
+
+/**
+ * Releases exclusive ownership of the given lock; see <sync.h>.
+ */
+void libgreat_rwlock_write_unlock(rwlock_t *lock)
+{
+	sync_access_barrier();
+	lock->state = 0;
+}
+
+
+//
+// Inter-core synchronization.
+//
+// Peterson's algorithm for the M4/M0 pair: plain stores, loads, and DMBs
+// only, since the M0 has no exclusive-access instructions (see <sync.h>).
+// Both cores execute in order and share uncached SRAM, so the barriers
+// below are all the ordering the algorithm needs.
+//
+
+
+/**
+ * Initializes a new inter-core mutex.
+ */
+void libgreat_intercore_mutex_init(intercore_mutex_t *mutex)
+{
+	mutex->interested[0] = 0;
+	mutex->interested[1] = 0;
+	mutex->turn = 0;
+}
+
+
+/**
+ * Ensures ownership of the provided mutex against the other core; see <sync.h>.
+ */
+void libgreat_intercore_mutex_lock(intercore_mutex_t *mutex, uint32_t core)
+{
+	uint32_t other = core ^ 1;
+
+	// Declare our interest, and yield the tie-break to the other core; the
+	// barrier orders both stores before we sample the other side's state.
+	mutex->interested[core] = 1;
+	mutex->turn = other;
+	sync_access_barrier();
+
+	// Wait until either the other core isn't competing, or it's our turn.
+	while (mutex->interested[other] && (mutex->turn == other)) {
+		// spin
+	}
+
+	sync_access_barrier();
+}
+
+
+/**
+ * Releases ownership of the provided mutex; see <sync.h>.
+ */
+void libgreat_intercore_mutex_unlock(intercore_mutex_t *mutex, uint32_t core)
+{
+	sync_access_barrier();
+	mutex->interested[core] = 0;
+}
+
+
+/**
+ * Initializes a new inter-core reader-writer lock.
+ */
+void libgreat_intercore_rwlock_init(intercore_rwlock_t *lock)
+{
+	libgreat_intercore_mutex_init(&lock->mutex);
+	lock->readers = 0;
+}
+
+
+/**
+ * Acquires the given lock for reading; see <sync.h>.
+ */
+void libgreat_intercore_read_lock(intercore_rwlock_t *lock, uint32_t core)
+{
+	// The M0 can't atomically bump a shared counter, so reader entry takes
+	// the embedded mutex just long enough to count itself in.
+	libgreat_intercore_mutex_lock(&lock->mutex, core);
+	lock->readers++;
+	libgreat_intercore_mutex_unlock(&lock->mutex, core);
+}
+
+
+/**
+ * Releases a read hold on the given lock; see <sync.h>.
+ */
+void libgreat_intercore_read_unlock(intercore_rwlock_t *lock, uint32_t core)
+{
+	libgreat_intercore_mutex_lock(&lock->mutex, core);
+	lock->readers--;
+	libgreat_intercore_mutex_unlock(&lock->mutex, core);
+}
+
+
+/**
+ * Acquires the given lock exclusively; see <sync.h>.
+ */
+void libgreat_intercore_write_lock(intercore_rwlock_t *lock, uint32_t core)
+{
+	// Holding the mutex bars new readers on either core...
+	libgreat_intercore_mutex_lock(&lock->mutex, core);
+
+	// ... so we only need to wait for the ones already inside to drain.
+	while (lock->readers) {
+		// spin
+	}
+
+	sync_access_barrier();
+}
+
+
+/**
+ * Releases exclusive ownership of the given lock; see <sync.h>.
+ */
+void libgreat_intercore_write_unlock(intercore_rwlock_t *lock, uint32_t core)
+{
+	libgreat_intercore_mutex_unlock(&lock->mutex, core);
+}
+
+
+//
+// Waitable events.
+//
+// Waiters park the core with WFE; WFE wakes on any interrupt (and on SEV),
+// so a flag signaled from an ISR wakes its waiter without any further
+// plumbing. The flags themselves make the wake-up race-free: a signal that
+// lands between the waiter's check and its WFE stays latched, and is
+// consumed on the next trip around the loop.
+//
+
+/** Masks interrupts around flag updates; returns the state to restore. */
+static inline uint32_t event_enter_critical(void)
+{
+	uint32_t primask;
+	__asm__ volatile ("mrs %0, PRIMASK\n\tcpsid i" : "=r"(primask) :: "memory");
+	return primask;
+}
+
+static inline void event_exit_critical(uint32_t primask)
+{
+	__asm__ volatile ("msr PRIMASK, %0" :: "r"(primask) : "memory");
+}
+
+
+/**
+ * Initializes a new event, with no flags signaled.
+ */
+void libgreat_event_init(event_t *event)
+{
+	event->flags = 0;
+}
+
+
+/**
+ * Signals the given flags on an event, waking any waiter.
+ * Safe to call from interrupt context.
+ */
+void libgreat_event_signal(event_t *event, uint32_t flags)
+{
+	uint32_t primask = event_enter_critical();
+	event->flags |= flags;
+	event_exit_critical(primask);
+
+	// Set the local event flag, so a thread-mode signaler wakes waiters even
+	// though no interrupt return is coming. (ISR signalers wake them anyway.)
+	__asm__ volatile ("dsb\n\tsev" ::: "memory");
+}
+
+
+/**
+ * Atomically consumes any of the given flags that are currently signaled.
+ * @return the flags consumed, or 0 if none were signaled
+ */
+static uint32_t event_consume(event_t *event, uint32_t flags)
+{
+	uint32_t primask = event_enter_critical();
+	uint32_t matched = event->flags & flags;
+	event->flags &= ~matched;
+	event_exit_critical(primask);
+
+	return matched;
+}
+
+
+/**
+ * Waits until any of the given flags are signaled, sleeping the core
+ * between wake-ups. Consumes and returns the flags that were signaled.
+ */
+uint32_t libgreat_event_wait(event_t *event, uint32_t flags)
+{
+	uint32_t matched;
+
+	while (!(matched = event_consume(event, flags))) {
+		__asm__ volatile ("wfe" ::: "memory");
+	}
+
+	return matched;
+}
+
+
+/** Timeout callback: its only job is waking the waiting WFE. */
+static void event_timeout_wakeup(void *argument)
+{
+	(void)argument;
+	__asm__ volatile ("sev" ::: "memory");
+}
+
+
+/**
+ * As libgreat_event_wait, but gives up after timeout_us microseconds.
+ * @return the flags consumed, or 0 on timeout
+ */
+uint32_t libgreat_event_wait_timeout(event_t *event, uint32_t flags, uint32_t timeout_us)
+{
+	software_timer_t wakeup_timer = {0};
+	uint64_t time_base = get_time_64();
+	uint32_t matched;
+
+	// Arm a one-shot wake-up for the deadline. This also guarantees the
+	// timer wheel's tick interrupt is running, so we re-check the deadline
+	// at tick rate even if nothing else is generating interrupts. If no
+	// hardware timer is available, fall back to polling without sleeping.
+	bool can_sleep = (software_timer_start(&wakeup_timer, timeout_us, false,
+			event_timeout_wakeup, NULL) == 0);
+
+	while (!(matched = event_consume(event, flags))) {
+		if (get_time_since_64(time_base) >= timeout_us) {
+			break;
+		}
+
+		if (can_sleep) {
+			__asm__ volatile ("wfe" ::: "memory");
+		}
+	}
+
+	if (can_sleep) {
+		software_timer_cancel(&wakeup_timer);
+	}
+
+	return matched;
 }
@@ -0,0 +1,297 @@
+#
+# This file is part of libgreat
+#
+
+"""
+Host-side benchmark harness for libgreat devices.
+
+Measures the performance of a connected board's transport as seen from the
+host -- command round-trip latency, bulk-transfer throughput, and enumeration
+time -- and reports the results as plain dictionaries suitable for JSON trend
+tracking. Pairs with the firmware's `benchmark` class where present, but the
+latency measurement falls back to a core-class verb, so it works against any
+libgreat device.
+
+Typical use, from a script or CI job::
+
+    from pygreat.comms import CommsBackend
+    from pygreat import benchmark
+
+    backend = CommsBackend.from_device_uri()
+    print(benchmark.to_json(benchmark.run(backend)))
+
+or directly from the command line::
+
+    python -m pygreat.benchmark
+"""
+
+from __future__ import absolute_import
+
+import sys
+import json
+import time
+import argparse
+
+
+# Class and verb numbers for the commands we time directly.
+CLASS_NUMBER_CORE = 0x0
+CORE_VERB_READ_BOARD_ID = 0x0
+
+CLASS_NUMBER_BENCHMARK = 0x3
+BENCHMARK_VERB_NOP = 0x5
+BENCHMARK_VERB_LOOPBACK = 0x6
+
+# Transfer sizes used by the throughput measurements, in bytes.
+DEFAULT_TRANSFER_SIZES = (64, 256, 1024, 4096)
+
+
+def _summarize_latencies(samples):
+    """ Reduces a list of per-operation times (in seconds) to a distribution
+        summary, with times reported in microseconds.
+    """
+
+    ordered = sorted(samples)
+
+    def percentile(fraction):
+        index = int(round(fraction * (len(ordered) - 1)))
+        return ordered[index]
+
+    to_us = lambda seconds: round(seconds * 1e6, 2)
+
+    return {
+        'count':     len(ordered),
+        'min_us':    to_us(ordered[0]),
+        'mean_us':   to_us(sum(ordered) / len(ordered)),
+        'median_us': to_us(percentile(0.5)),
+        'p90_us':    to_us(percentile(0.9)),
+        'p99_us':    to_us(percentile(0.99)),
+        'max_us':    to_us(ordered[-1]),
+    }
+
+
+def _device_has_benchmark_class(backend):
+    """ Returns true iff the connected device's firmware provides the
+        benchmark class, by attempting its no-op verb.
+    """
+
+    try:
+        backend.execute_raw_command(CLASS_NUMBER_BENCHMARK, BENCHMARK_VERB_NOP,
+            pretty_name="benchmark.nop", rephrase_errors=False)
+        return True
+    except Exception:
+        return False
+
+
+def measure_command_latency(backend, iterations=1000, warmup=16):
+    """ Measures the round-trip latency of a minimal command.
+
+    Uses the firmware benchmark class's no-op verb where available -- which
+    measures pure dispatch and transport cost -- and falls back to the core
+    class's read_board_id verb otherwise.
+
+    Args:
+        backend -- The CommsBackend connected to the device under test.
+        iterations -- The number of round trips to sample.
+        warmup -- Unrecorded round trips issued first, so one-time costs
+            (interface claiming, caching) don't skew the distribution.
+
+    Returns a dictionary with the verb used and the latency distribution.
+    """
+
+    if _device_has_benchmark_class(backend):
+        class_number, verb, pretty_name = \
+            CLASS_NUMBER_BENCHMARK, BENCHMARK_VERB_NOP, "benchmark.nop"
+    else:
+        class_number, verb, pretty_name = \
+            CLASS_NUMBER_CORE, CORE_VERB_READ_BOARD_ID, "core.read_board_id"
+
+    def round_trip():
+        backend.execute_raw_command(class_number, verb, pretty_name=pretty_name)
+
+    for _ in range(warmup):
+        round_trip()
+
+    samples = []
+    for _ in range(iterations):
+        start = time.perf_counter()
+        round_trip()
+        samples.append(time.perf_counter() - start)
+
+    result = {'verb': pretty_name}
+    result.update(_summarize_latencies(samples))
+    return result
+
+
+def measure_loopback_throughput(backend, transfer_sizes=DEFAULT_TRANSFER_SIZES,
+        duration_per_size=1.0):
+    """ Measures command-transport throughput using the firmware benchmark
+        class's loopback verb, which echoes its payload.
+
+    Each transfer moves its payload in both directions, so the reported rates
+    count each direction once.
+
+    Args:
+        backend -- The CommsBackend connected to the device under test.
+        transfer_sizes -- The payload sizes to measure, in bytes.
+        duration_per_size -- The (approximate) measurement time per size,
+            in seconds.
+
+    Returns a list of per-size dictionaries; or None, if the connected
+    firmware doesn't provide the benchmark class.
+    """
+
+    if not _device_has_benchmark_class(backend):
+        return None
+
+    results = []
+    for size in transfer_sizes:
+        payload = bytes(bytearray(i & 0xff for i in range(size)))
+        transfers = 0
+
+        start = time.perf_counter()
+        while True:
+            response = backend.execute_raw_command(CLASS_NUMBER_BENCHMARK,
+                BENCHMARK_VERB_LOOPBACK, data=payload,
+                pretty_name="benchmark.loopback")
+            if len(response) != size:
+                raise IOError("loopback returned {} bytes; expected {}!".format(
+                    len(response), size))
+
+            transfers += 1
+            elapsed = time.perf_counter() - start
+            if elapsed >= duration_per_size:
+                break
+
+        results.append({
+            'transfer_size':        size,
+            'transfers':            transfers,
+            'elapsed_s':            round(elapsed, 4),
+            'transfers_per_second': round(transfers / elapsed, 1),
+            'bytes_per_second':     round(transfers * size / elapsed, 1),
+        })
+
+    return results
+
+
+def measure_pipe_throughput(pipe, transfer_sizes=DEFAULT_TRANSFER_SIZES,
+        transfers_per_size=256, timeout=1000):
+    """ Measures the sustained throughput of an already-streaming bulk pipe.
+
+    The caller is responsible for opening the pipe and for configuring the
+    device side of the stream (e.g. starting a capture) before calling, as
+    pipe setup is class-specific; see CommsBackend.open_pipe.
+
+    Args:
+        pipe -- An open, flowing CommsPipe to read from.
+        transfer_sizes -- The per-transfer buffer sizes to measure, in bytes.
+        transfers_per_size -- The number of transfers to time per size.
+        timeout -- The maximum wait per transfer, in ms.
+
+    Returns a list of per-size dictionaries.
+    """
+
+    results = []
+    for size in transfer_sizes:
+        buffers = [bytearray(size) for _ in range(transfers_per_size)]
+
+        start = time.perf_counter()
+        lengths = pipe.read_into([memoryview(b) for b in buffers], timeout=timeout)
+        elapsed = time.perf_counter() - start
+
+        total_bytes = sum(lengths)
+        results.append({
+            'transfer_size':    size,
+            'transfers':        len(lengths),
+            'elapsed_s':        round(elapsed, 4),
+            'bytes_per_second': round(total_bytes / elapsed, 1),
+        })
+
+    return results
+
+
+def measure_enumeration_time(iterations=5, **device_uri):
+    """ Measures the time to locate, connect to, and introspect a device --
+        the setup cost every pygreat session pays once.
+
+    Note that this opens its own connections to the device; don't call it
+    while another backend object holds the device.
+
+    Args:
+        iterations -- The number of connect/close cycles to sample.
+        device_uri -- Any device-identifying arguments, as accepted by
+            CommsBackend.from_device_uri.
+
+    Returns a dictionary with the enumeration-time distribution.
+    """
+
+    from .comms import CommsBackend
+
+    samples = []
+    for _ in range(iterations):
+        start = time.perf_counter()
+        backend = CommsBackend.from_device_uri(**device_uri)
+        samples.append(time.perf_counter() - start)
+
+        if hasattr(backend, 'close'):
+            backend.close()
+
+    return _summarize_latencies(samples)
+
+
+def run(backend, latency_iterations=1000, transfer_sizes=DEFAULT_TRANSFER_SIZES):
+    """ Runs the standard benchmark suite against a connected device.
+
+    Args:
+        backend -- The CommsBackend connected to the device under test.
+        latency_iterations -- The number of round trips for the latency
+            measurement.
+        transfer_sizes -- The payload sizes for the throughput measurements.
+
+    Returns a dictionary of results, suitable for JSON serialization; see
+    the individual measure_* functions for the shape of each section.
+    """
+
+    return {
+        'timestamp':           time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'command_latency':     measure_command_latency(backend, latency_iterations),
+        'loopback_throughput': measure_loopback_throughput(backend, transfer_sizes),
+    }
+
+
+def to_json(results):
+    """ Renders a result dictionary as stable, readable JSON. """
+    return json.dumps(results, indent=2, sort_keys=True)
+
+
+def main():
+    """ Command-line entry point: runs the suite and prints JSON results. """
+
+    parser = argparse.ArgumentParser(
+        description="Benchmarks a connected libgreat device's transport.")
+    parser.add_argument('--iterations', type=int, default=1000,
+        help="round trips to sample for the latency measurement")
+    parser.add_argument('--serial', type=str, default=None,
+        help="serial number of the device to benchmark, if several are connected")
+    parser.add_argument('--enumeration', action='store_true',
+        help="also measure enumeration time (reconnects to the device)")
+    arguments = parser.parse_args()
+
+    from .comms import CommsBackend
+
+    identifiers = {}
+    if arguments.serial:
+        identifiers['serial_number'] = arguments.serial
+
+    backend = CommsBackend.from_device_uri(**identifiers)
+    results = run(backend, latency_iterations=arguments.iterations)
+
+    if arguments.enumeration:
+        if hasattr(backend, 'close'):
+            backend.close()
+        results['enumeration'] = measure_enumeration_time(**identifiers)
+
+    print(to_json(results))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,126 @@
+#
+# This file is part of libgreat
+#
+
+""" Bit-plane layout conversions for multi-channel captures.
+
+Multi-slice SGPIO captures land one channel per slice word: each 32-bit
+word holds 32 consecutive samples of a single channel, with the oldest
+sample in bit 0 ("bit-plane" layout). Analyzers and most host software
+instead want "sample-major" layout -- one little-endian word per sample,
+with bit c carrying channel c.
+
+These functions convert whole captures between the two layouts. When numpy
+is available, the conversion is fully vectorized -- large captures convert
+in seconds rather than the minutes a per-sample Python loop takes; a pure
+Python fallback keeps the functions usable without it.
+"""
+
+import struct
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+def sample_width_bytes(channel_count):
+    """ Returns the number of bytes each sample-major sample occupies for the given channel count. """
+    return (channel_count + 7) // 8
+
+
+def bitplanes_to_samples(data, channel_count):
+    """ Converts a capture from bit-plane to sample-major layout.
+
+    Parameters:
+        data          -- The raw capture: a bytes-like object composed of 32-sample
+                         blocks, each of which is channel_count little-endian 32-bit
+                         words; word c holds 32 samples of channel c, oldest in bit 0.
+        channel_count -- The number of channels captured; 1 to 32.
+
+    Returns a bytes object with one little-endian sample per
+    sample_width_bytes(channel_count) bytes; bit c of each sample carries
+    channel c.
+    """
+
+    _validate_arguments(data, channel_count)
+
+    if numpy is not None:
+        # Split each plane word into its 32 bits, oldest sample first...
+        planes = numpy.frombuffer(data, dtype='<u4').reshape(-1, channel_count)
+        bits = numpy.unpackbits(planes.view(numpy.uint8).reshape(-1, channel_count, 4),
+                axis=-1, bitorder='little')
+
+        # ... and re-pack them with the sample index major, so each sample's
+        # channel bits land in adjacent bits of its output word.
+        samples = numpy.packbits(bits.transpose(0, 2, 1), axis=-1, bitorder='little')
+        return samples.tobytes()
+
+    # Fallback: per-block Python loop.
+    words = struct.unpack("<{}I".format(len(data) // 4), data)
+    width = sample_width_bytes(channel_count)
+
+    samples = bytearray()
+    for block_start in range(0, len(words), channel_count):
+        block = words[block_start:block_start + channel_count]
+        for sample in range(32):
+            value = 0
+            for channel, plane in enumerate(block):
+                value |= ((plane >> sample) & 1) << channel
+            samples += value.to_bytes(width, byteorder='little')
+
+    return bytes(samples)
+
+
+def samples_to_bitplanes(data, channel_count):
+    """ Converts a capture from sample-major back to bit-plane layout; the
+    inverse of bitplanes_to_samples.
+
+    Parameters:
+        data          -- The sample-major capture: a bytes-like object with one
+                         little-endian sample per sample_width_bytes(channel_count)
+                         bytes; the sample count must be a multiple of 32.
+        channel_count -- The number of channels captured; 1 to 32.
+
+    Returns a bytes object of 32-sample blocks of channel_count little-endian
+    32-bit plane words.
+    """
+
+    width = sample_width_bytes(channel_count)
+
+    if channel_count < 1 or channel_count > 32:
+        raise ValueError("channel_count must be between 1 and 32")
+    if len(data) % (32 * width):
+        raise ValueError("data must be a whole number of 32-sample blocks")
+
+    if numpy is not None:
+        # Split each sample into its channel bits...
+        samples = numpy.frombuffer(data, dtype=numpy.uint8).reshape(-1, 32, width)
+        bits = numpy.unpackbits(samples, axis=-1, bitorder='little')[:, :, :channel_count]
+
+        # ... and re-pack them with the channel index major, rebuilding each
+        # channel's 32-sample plane word.
+        planes = numpy.packbits(bits.transpose(0, 2, 1), axis=-1, bitorder='little')
+        return planes.tobytes()
+
+    # Fallback: per-block Python loop.
+    planes = bytearray()
+    for block_start in range(0, len(data), 32 * width):
+        block = data[block_start:block_start + 32 * width]
+        for channel in range(channel_count):
+            plane = 0
+            for sample in range(32):
+                value = int.from_bytes(block[sample * width:(sample + 1) * width], byteorder='little')
+                plane |= ((value >> channel) & 1) << sample
+            planes += struct.pack("<I", plane)
+
+    return bytes(planes)
+
+
+def _validate_arguments(data, channel_count):
+    """ Validates a bit-plane buffer and channel count, raising ValueError on mismatch. """
+
+    if channel_count < 1 or channel_count > 32:
+        raise ValueError("channel_count must be between 1 and 32")
+    if len(data) % (channel_count * 4):
+        raise ValueError("data must be a whole number of 32-sample blocks")
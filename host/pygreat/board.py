@@ -10,6 +10,9 @@ Module containing the core definitions for a libgreat-driven board.
 import usb
 import future
 import time
+import zlib
+
+from concurrent.futures import ThreadPoolExecutor
 
 # Use the GreatFET comms API, and the standard (core) API.
 from pygreat.comms import CommsBackend
@@ -110,9 +113,14 @@ class GreatBoard(object):
             # things are USB connected.
             devices.extend(subclass_devices)
 
-        # Ensure each device has its comms objects fully populated.
-        for device in devices:
-            device.initialize_apis()
+        # Ensure each device has its comms objects fully populated. Each
+        # initialization talks to its own, independent device, so they run
+        # concurrently: a rack of boards comes up in roughly the time of its
+        # slowest member rather than the sum of them all.
+        if devices:
+            with ThreadPoolExecutor(max_workers=len(devices)) as pool:
+                # The list() forces completion, so any failure propagates here.
+                list(pool.map(lambda device: device.initialize_apis(), devices))
 
         # Return the list of all subclasses.
         return devices
@@ -135,22 +143,36 @@ class GreatBoard(object):
         identifiers = cls.populate_default_identifiers(device_identifiers, find_all=True)
         raw_devices = usb.core.find(**identifiers)
 
-        # Iterate over all of the connected devices, and filter out the devices
-        # that this class doesn't connect.
+        # Build one identifier set per connected device. We need to be
+        # specific about which device in particular we're grabbing when we
+        # query things-- or we'll get the first acceptable device every time.
+        # The trick here is to populate enough information into the
+        # identifier to uniquely identify the device. The address should do,
+        # as pyusb is only touching enumerated devices.
+        candidates = []
         for raw_device in raw_devices:
-
-            # We need to be specific about which device in particular we're
-            # grabbing when we query things-- or we'll get the first acceptable
-            # device every time. The trick here is to populate enough information
-            # into the identifier to uniquely identify the device. The address
-            # should do, as pyusb is only touching enmerated devices.
-            identifiers['address'] = raw_device.address
-            identifiers['find_all'] = False
-
-            # If we support the relevant device _instance_, and it to our list.
-            if cls.accepts_connected_device(**identifiers):
-                devices.append(cls(**identifiers))
-
+            candidate = dict(identifiers)
+            candidate['address'] = raw_device.address
+            candidate['find_all'] = False
+            candidates.append(candidate)
+
+        if not candidates:
+            return devices
+
+        # If we support the relevant device _instance_, connect to it.
+        def _connect_if_accepted(candidate):
+            if cls.accepts_connected_device(**candidate):
+                return cls(**candidate)
+            return None
+
+        # Each candidate probe-and-connect talks to its own device over its
+        # own libusb handle, so they can run concurrently: checking a rack of
+        # boards costs roughly one introspection crawl, not one per board.
+        with ThreadPoolExecutor(max_workers=len(candidates)) as pool:
+            results = pool.map(_connect_if_accepted, candidates)
+
+        # Keep the accepted boards, in enumeration order.
+        devices = [device for device in results if device is not None]
         return devices
 
 
@@ -307,6 +329,98 @@ class GreatBoard(object):
         return result
 
 
+    def verify_firmware(self, expected_data, address=0):
+        """ Verifies a firmware region against the provided image, device-side.
+
+        Computes a CRC32 of the given flash range on the device itself --
+        rather than reading every page back over USB -- and compares it
+        against the CRC32 of the expected data.
+
+        Arguments:
+            expected_data -- The data the flash range should contain.
+            address -- The flash address the data was written to.
+
+        Returns true iff the device's flash range matches the provided data.
+        """
+        device_crc = self.apis.firmware.checksum(address, len(expected_data))
+        return device_crc == (zlib.crc32(bytes(expected_data)) & 0xFFFFFFFF)
+
+
+    # Pages of per-page CRCs fetched per firmware.page_crcs request; sized
+    # comfortably under the device's 4KiB response buffer.
+    _FIRMWARE_MANIFEST_WINDOW = 512
+
+    def firmware_page_crcs(self, address, length, page_size):
+        """ Fetches per-page CRC32s of a firmware flash range, device-side.
+
+        Arguments:
+            address -- The start of the flash range.
+            length -- The length of the flash range, in bytes.
+            page_size -- The granularity to compute CRCs at, in bytes.
+
+        Returns a list with one CRC32 per page, in order. The final page's
+        CRC covers only the bytes inside the range.
+        """
+        crcs = []
+
+        # Fetch the manifest in windows, as the full thing may not fit in
+        # a single response.
+        while length:
+            window = min(length, self._FIRMWARE_MANIFEST_WINDOW * page_size)
+
+            # The manifest may come back as a tuple, a numpy array (on the
+            # vectorized decode path), or a lone collapsed scalar.
+            result = self.apis.firmware.page_crcs(address, window, page_size)
+            crcs.extend(result if hasattr(result, '__len__') else [result])
+
+            address += window
+            length -= window
+
+        return crcs
+
+
+    def update_firmware_delta(self, data, address=0, progress_callback=None):
+        """ Updates a firmware region, rewriting only the pages that changed.
+
+        Fetches a manifest of per-page CRC32s from the device, diffs it
+        against the provided image, and erases and writes only the pages
+        that differ -- so a rebuild that touched a handful of pages flashes
+        in a fraction of the time of a full update.
+
+        Arguments:
+            data -- The firmware image to program.
+            address -- The flash address to program the image to; must be
+                page-aligned.
+            progress_callback -- Optional; called with (pages_written,
+                pages_to_write) as each changed page completes.
+
+        Returns the number of pages that were rewritten.
+        """
+        data = bytes(data)
+        page_size, _ = self.apis.firmware.initialize()
+
+        # Figure out which pages differ from what's already on the device...
+        device_crcs = self.firmware_page_crcs(address, len(data), page_size)
+        changed_pages = []
+        for page_number, device_crc in enumerate(device_crcs):
+            page = data[page_number * page_size:(page_number + 1) * page_size]
+            if device_crc != (zlib.crc32(page) & 0xFFFFFFFF):
+                changed_pages.append(page_number)
+
+        # ... and rewrite only those.
+        for count, page_number in enumerate(changed_pages):
+            page_address = address + (page_number * page_size)
+            page = data[page_number * page_size:(page_number + 1) * page_size]
+
+            self.apis.firmware.page_erase(page_address)
+            self.apis.firmware.write_page(page_address, page)
+
+            if progress_callback:
+                progress_callback(count + 1, len(changed_pages))
+
+        return len(changed_pages)
+
+
     def try_reconnect(self):
         """ Attempts to re-create a connection to a disconnected GreatFET."""
         self.__init__(**self.identifiers)
@@ -64,6 +64,17 @@ class CoreAPI(CommsClass):
     get_class_docs = command_rpc(verb_number=0x9, in_format="<I", out_format="<S",
             name= "get_class_docs", out_parameter_names=["docstring"], doc="Fetches for documentation the given class.")
 
+    # Bulk variant of the verb-descriptor requests above: returns packed
+    # descriptors for a whole class's verbs -- per verb, a uint32 verb number
+    # followed by six NUL-terminated strings (name, in/out signatures, docs,
+    # in/out parameter names) -- starting from the given verb index. An empty
+    # response means the table has been read completely. Not present on older
+    # firmware; callers should fall back to the per-verb requests.
+    get_verb_descriptors = command_rpc(verb_number=0x19, in_format="<II", out_format="<*X",
+            name="get_verb_descriptors", in_parameter_names=["class_number", "start_verb_index"],
+            out_parameter_names=["descriptors"],
+            doc="Fetches packed descriptors for all of a class's verbs in one transaction.")
+
     def get_verb_in_signature(self, class_number, verb_number):
         """ Fetches the given verb's in-signature. """
         return self.get_verb_descriptor(class_number, verb_number, self.VERB_DESCRIPTOR_IN_SIGNATURE)
@@ -10,13 +10,23 @@ libgreat devices.
 from __future__ import unicode_literals
 from future import utils as future_utils
 
+import os
 import re
 import sys
+import json
 import struct
 import inspect
 import collections
 
 from . import errors
+from .documentation import lookup_class_documentation, lookup_verb_documentation
+
+# Optional: numpy powers the vectorized decode path for bulk array responses;
+# everything still works (more slowly) without it.
+try:
+    import numpy
+except ImportError:
+    numpy = None
 
 try:
     from functools import lru_cache as memoize_with_lru_cache
@@ -129,42 +139,261 @@ class CommsBackend(object):
         return CommsApiCollection(self.apis)
 
 
+    """ Version stamp for the on-disk introspection cache; bump when the
+        cached description format changes. """
+    API_CACHE_FORMAT_VERSION = 1
+
     def run_autoenumeration(self, overwrite=False):
         """ Uses the Core Introspection API to determine the accessible APIs
             and automatically genereate RPC stubs in the .api accessor.
+
+            Enumerating a device takes dozens of round trips, but its result
+            only changes when its firmware does -- so the descriptions are
+            cached on disk, keyed by serial number and firmware version, and
+            reconnecting to a known device skips the round trips entirely.
         """
 
-        # Fetch all of the available class numbers.
-        class_numbers = self.apis['core'].get_available_classes()
+        descriptions = None
+        cache_key = self._api_cache_key()
 
-        # And process each one.
-        for class_number in class_numbers:
-            self._generate_object_for_class(class_number)
+        # If we've seen this device/firmware combination before, build our
+        # APIs straight from the cached descriptions.
+        if not overwrite:
+            descriptions = self._load_cached_api_descriptions(cache_key)
 
+        # Otherwise, fetch a description of every class the device reports...
+        if descriptions is None:
+            descriptions = [self._fetch_class_description(class_number)
+                    for class_number in self.apis['core'].get_available_classes()]
 
+            # ... and remember it for next time.
+            self._store_cached_api_descriptions(cache_key, descriptions)
 
-    def _generate_object_for_class(self, class_number, overwrite=False):
-        """ Uses the Core Introspection API to generate a python class containing
-            RPCs for the provided libgreat class.
+        for description in descriptions:
+            self._build_object_for_class(description, overwrite=overwrite)
+
+
+    def _api_cache_key(self):
+        """ Returns the identity the device's cached API descriptions are
+            stored under -- serial number plus firmware version, so a
+            firmware change invalidates the cache -- or None if the device
+            can't provide one.
+        """
+
+        try:
+            serial = self.apis['core'].read_serial_number()
+            version = self.apis['core'].read_version_string(encoding='utf-8')
+        except Exception:
+            return None
+
+        serial_string = ''.join('{:08x}'.format(word) for word in serial)
+        return '{}:{}'.format(serial_string, version)
+
+
+    @staticmethod
+    def _api_cache_path():
+        """ Returns the path of the on-disk introspection cache. """
+
+        cache_root = os.environ.get('XDG_CACHE_HOME') or \
+                os.path.join(os.path.expanduser('~'), '.cache')
+        return os.path.join(cache_root, 'pygreat', 'api_cache.json')
+
+
+    def _load_cached_api_descriptions(self, cache_key):
+        """ Returns the cached class descriptions stored under the given key,
+            or None if they're not cached (or the cache is unusable).
+        """
+
+        if cache_key is None:
+            return None
+
+        try:
+            with open(self._api_cache_path(), 'r') as cache_file:
+                cache = json.load(cache_file)
+
+            if cache.get('format_version') != self.API_CACHE_FORMAT_VERSION:
+                return None
+
+            return cache.get('entries', {}).get(cache_key)
+        except (IOError, OSError, ValueError):
+            # A missing or corrupt cache just means we enumerate live.
+            return None
+
+
+    def _store_cached_api_descriptions(self, cache_key, descriptions):
+        """ Stores class descriptions in the on-disk cache, under the given
+            key. Failures are ignored; the cache is purely an accelerator.
+        """
+
+        if cache_key is None:
+            return
+
+        cache_path = self._api_cache_path()
+
+        try:
+            try:
+                with open(cache_path, 'r') as cache_file:
+                    cache = json.load(cache_file)
+                if cache.get('format_version') != self.API_CACHE_FORMAT_VERSION:
+                    cache = {}
+            except (IOError, OSError, ValueError):
+                cache = {}
+
+            cache['format_version'] = self.API_CACHE_FORMAT_VERSION
+            cache.setdefault('entries', {})[cache_key] = descriptions
+
+            # Write the whole cache out to the side, then move it into place,
+            # so a crash mid-write can't leave a torn cache behind.
+            if not os.path.isdir(os.path.dirname(cache_path)):
+                os.makedirs(os.path.dirname(cache_path))
+
+            temporary_path = '{}.{}.tmp'.format(cache_path, os.getpid())
+            with open(temporary_path, 'w') as cache_file:
+                json.dump(cache, cache_file)
+            os.rename(temporary_path, cache_path)
+        except (IOError, OSError, ValueError):
+            pass
+
+
+    def _fetch_class_description(self, class_number):
+        """ Uses the Core Introspection API to fetch everything needed to
+            build RPCs for the provided libgreat class, as a plain
+            (JSON-serializable) dictionary.
+        """
+
+        core_api = self.apis['core']
+
+        return {
+            'class_number': class_number,
+            'class_name': core_api.get_class_name(class_number),
+            'class_docs': core_api.get_class_docs(class_number),
+            'verbs': self._fetch_verb_descriptions_for_class(class_number),
+        }
+
+
+    def _fetch_verb_descriptions_for_class(self, class_number):
+        """ Uses the Core Introspection API to fetch the description of each
+            of a class's verbs, as a list of plain dictionaries.
+
+            Prefers the bulk get_verb_descriptors verb, which returns a whole
+            class's descriptors in one or two transactions; falls back to
+            crawling verb by verb when talking to firmware without it.
+        """
+
+        verbs = self._fetch_verb_descriptions_bulk(class_number)
+        if verbs is not None:
+            return verbs
+
+        core_api = self.apis['core']
+        verbs = []
+
+        for verb_number in core_api.get_available_verbs(class_number):
+            verbs.append({
+                'verb_number': verb_number,
+                'name': core_api.get_verb_name(class_number, verb_number),
+                'in_signature': core_api.get_verb_in_signature(class_number, verb_number),
+                'out_signature': core_api.get_verb_out_signature(class_number, verb_number),
+                'documentation': core_api.get_verb_documentation(class_number, verb_number),
+                'in_param_names': core_api.get_verb_in_param_names(class_number, verb_number),
+                'out_param_names': core_api.get_verb_out_param_names(class_number, verb_number),
+            })
+
+        return verbs
+
+
+    def _fetch_verb_descriptions_bulk(self, class_number):
+        """ Fetches a class's verb descriptions via the bulk
+            get_verb_descriptors verb, or returns None if the device doesn't
+            support it (and the caller should crawl verb by verb).
+        """
+
+        core_api = self.apis['core']
+
+        if not hasattr(core_api, 'get_verb_descriptors'):
+            return None
+
+        verbs = []
+        start_index = 0
+
+        # Each response carries as many whole records as fit; keep asking
+        # from the first verb we haven't seen until a response comes back
+        # empty.
+        while True:
+            try:
+                blob = core_api.get_verb_descriptors(class_number, start_index)
+            except CommsError:
+                # Older firmware without the bulk verb responds with an error;
+                # fall back to the one-request-per-descriptor crawl.
+                return None
+
+            if not blob:
+                return verbs
+
+            records = self._parse_packed_verb_descriptors(blob)
+            if not records:
+                return None
+
+            verbs.extend(records)
+            start_index += len(records)
+
+
+    @staticmethod
+    def _parse_packed_verb_descriptors(blob):
+        """ Parses a get_verb_descriptors response: per verb, a uint32 verb
+            number followed by six NUL-terminated strings (name, in/out
+            signatures, docs, in/out parameter names).
+
+        Returns:
+            a list of verb-description dictionaries, as used by
+            _build_rpc_verbs(); empty if the blob is malformed
+        """
+
+        field_names = ('name', 'in_signature', 'out_signature',
+                'documentation', 'in_param_names', 'out_param_names')
+        records = []
+        offset = 0
+
+        while offset < len(blob):
+
+            # A record that doesn't have a complete header -- or a string
+            # that never terminates -- means we're out of sync; discard
+            # everything, so the caller falls back to the per-verb crawl.
+            if (offset + 4) > len(blob):
+                return []
+
+            record = {'verb_number': struct.unpack_from('<I', blob, offset)[0]}
+            offset += 4
+
+            for field_name in field_names:
+                terminator = blob.find(b'\0', offset)
+                if terminator < 0:
+                    return []
+
+                record[field_name] = blob[offset:terminator].decode('utf-8')
+                offset = terminator + 1
+
+            records.append(record)
+
+        return records
+
+
+    def _build_object_for_class(self, description, overwrite=False):
+        """ Generates a python class containing RPCs from a class description,
+            as returned by _fetch_class_description() -- without any device
+            round trips.
 
         Args:
-            class_number -- The class number to generate RPCs for.
+            description -- The class description to build RPCs from.
             overwrite -- If true, existing class definitions will be overwritten.
                 Otherwise, any class that already has an object associated with it
                 will be maintained.
-
-        Returns:
-            a dynamically-generated class object for the provieded class number,
-            filled with RPC methods
         """
 
-        # Get the name / docstring for the given class.
-        class_name = self.apis['core'].get_class_name(class_number)
-        class_docs = self.apis['core'].get_class_docs(class_number)
+        class_number = description['class_number']
 
         # Ensure that the class name is a string type that can be a class name.
         # This ensures python2 compatibility.
-        class_name = future_utils.native_str(class_name)
+        class_name = future_utils.native_str(description['class_name'])
 
         # If we already have an object for the given class,
         # and we're not in overwrite mode, skip enumerating it.
@@ -174,16 +403,22 @@ class CommsBackend(object):
 
         # Get a set of RPC verbs for the given class, which will become our
         # class's methods.
-        attrs = self._generate_rpc_verbs_for_class(class_number, class_name)
+        attrs = self._build_rpc_verbs(class_name, description['verbs'])
 
         # Each comms class needs a CLASS_NUMBER attribute, and should have a
         # CLASS_NAME attribute. We'll add ours.
         attrs['CLASS_NUMBER'] = class_number
         attrs['CLASS_NAME'] = class_name
 
-        # Generat a documentation string for the given class.
+        # Generat a documentation string for the given class, falling back
+        # to the host-side bundle when the device's was stripped.
+        class_docs = description['class_docs']
+        if not class_docs:
+            class_docs = lookup_class_documentation(class_name) or ''
+
         attrs['__doc__'] = \
-                'Autogenerated class for the {} API class:\n{}'.format(class_name, class_docs)
+                'Autogenerated class for the {} API class:\n{}'.format(
+                        class_name, class_docs)
 
         # Generate a class around the relevant verbs.
         cls = type(class_name, (GeneratedCommsClass,), attrs)
@@ -191,6 +426,21 @@ class CommsBackend(object):
         # Finally, instantiate and store the relevant class.
         self.apis[class_name] = cls(self)
 
+
+    def _generate_object_for_class(self, class_number, overwrite=False):
+        """ Uses the Core Introspection API to generate a python class containing
+            RPCs for the provided libgreat class.
+
+        Args:
+            class_number -- The class number to generate RPCs for.
+            overwrite -- If true, existing class definitions will be overwritten.
+                Otherwise, any class that already has an object associated with it
+                will be maintained.
+        """
+
+        description = self._fetch_class_description(class_number)
+        self._build_object_for_class(description, overwrite=overwrite)
+
     @staticmethod
     def _parse_rpc_param_names_string(name_string):
         """ Parses a comma-separated command string into a list of names. """
@@ -206,32 +456,26 @@ class CommsBackend(object):
 
 
 
-    def _generate_rpc_verbs_for_class(self, class_number, class_name = "class"):
-        """ Uses the Core Introspection API to generate RPCs for each of the verbs
-            supported by a given class.
-        Args:
-            class_number -- The class number to generate RPCs for.
+    def _build_rpc_verbs(self, class_name, verbs):
+        """ Generates RPCs from a list of verb descriptions, as returned by
+            _fetch_verb_descriptions_for_class() -- without any device round
+            trips.
 
         Returns:
             a dictionary mapping verb names to yet-unbound method objects
         """
 
         rpcs = {}
-        core_api = self.apis['core']
-
-        # Get the name for the given class.
-        verb_numbers = core_api.get_available_verbs(class_number)
 
         # Iterate over each of the verbs and build an RPC for them.
-        for verb_number in verb_numbers:
+        for verb in verbs:
 
-            # Fetch the information necessary to build the verb RPC.
-            name            = core_api.get_verb_name(class_number, verb_number)
-            in_signature    = core_api.get_verb_in_signature(class_number, verb_number)
-            out_signature   = core_api.get_verb_out_signature(class_number, verb_number)
-            documentation   = core_api.get_verb_documentation(class_number, verb_number)
-            in_param_names  = core_api.get_verb_in_param_names(class_number, verb_number)
-            out_param_names = core_api.get_verb_out_param_names(class_number, verb_number)
+            name             = verb['name']
+            in_signature     = verb['in_signature']
+            out_signature    = verb['out_signature']
+            documentation    = verb['documentation']
+            in_names_string  = verb['in_param_names']
+            out_names_string = verb['out_param_names']
 
             # FIXME: automatically generate docs
 
@@ -241,21 +485,189 @@ class CommsBackend(object):
             if (in_signature == '*') or (out_signature == '*'):
                 continue
 
+            # Firmware built with stripped documentation keeps its numeric
+            # signatures, but hands us empty docstrings and parameter names;
+            # fill those (and genuinely undocumented verbs) from the
+            # host-side documentation bundle, when it knows the verb.
+            if (documentation in ('', '*')) or (in_names_string in ('', '*')) or (out_names_string in ('', '*')):
+                bundled = lookup_verb_documentation(class_name, name) or {}
+
+                if documentation in ('', '*'):
+                    documentation = bundled.get('documentation', documentation)
+                if in_names_string in ('', '*'):
+                    in_names_string = bundled.get('in_param_names', '*')
+                if out_names_string in ('', '*'):
+                    out_names_string = bundled.get('out_param_names', '*')
+
             # Provide a nice disclaimer if the method is undocumented on the firmware side.
-            if documentation == '*':
+            if documentation in ('', '*'):
                 documentation = "{undocumented on firmware side}"
 
             # Parse any parameter names the device knows about.
-            in_param_names = self._parse_rpc_param_names_string(in_param_names)
-            out_param_names = self._parse_rpc_param_names_string(out_param_names)
+            in_param_names = self._parse_rpc_param_names_string(in_names_string)
+            out_param_names = self._parse_rpc_param_names_string(out_names_string)
 
             # Build the relevant RPCs.
-            rpcs[name] = command_rpc(verb_number, in_signature, out_signature, name=name, class_name=class_name,
-                    doc=documentation, in_parameter_names=in_param_names, out_parameter_names=out_param_names)
+            rpcs[name] = command_rpc(verb['verb_number'], in_signature, out_signature, name=name,
+                    class_name=class_name, doc=documentation,
+                    in_parameter_names=in_param_names, out_parameter_names=out_param_names)
 
         return rpcs
 
 
+    def _generate_rpc_verbs_for_class(self, class_number, class_name = "class"):
+        """ Uses the Core Introspection API to generate RPCs for each of the verbs
+            supported by a given class.
+        Args:
+            class_number -- The class number to generate RPCs for.
+
+        Returns:
+            a dictionary mapping verb names to yet-unbound method objects
+        """
+
+        verbs = self._fetch_verb_descriptions_for_class(class_number)
+        return self._build_rpc_verbs(class_name, verbs)
+
+
+    """ Cache mapping format strings to their precompiled representations. """
+    _compiled_format_cache = {}
+
+    """ A precompiled format string: its split segments, plus a fast-path
+        struct.Struct for formats that contain no special fields at all. """
+    _CompiledFormat = collections.namedtuple('_CompiledFormat',
+            ['segments', 'single_struct'])
+
+    """ A single precompiled segment of a format string: its text, which kind
+        of handler services it, its struct.Struct (for plain segments), the
+        number of arguments it consumes (None = all remaining), and the number
+        of bytes it consumes (None = data-dependent). """
+    _CompiledFormatSegment = collections.namedtuple('_CompiledFormatSegment',
+            ['text', 'kind', 'compiled_struct', 'argument_count', 'fixed_size'])
+
+
+    @classmethod
+    def _compile_format(cls, format_string):
+        """ Parses a pack/unpack format string -- once -- into a precompiled
+            representation, so the per-call pack/unpack path is a cache hit
+            plus precompiled handlers rather than a pile of regex walks.
+
+            Formats are compiled lazily on first use, and eagerly for each
+            verb signature discovered during autoenumeration.
+        """
+
+        try:
+            return cls._compiled_format_cache[format_string]
+        except KeyError:
+            pass
+
+        segments = []
+
+        for subformat in cls._split_struct_string(format_string):
+
+            # Special fields keep their text, for the handlers that still
+            # need to inspect it; we precompute how they split arguments
+            # and bytes, which is the expensive part.
+            if cls._is_special_format(subformat):
+
+                if subformat.endswith(')'):
+                    kind = 'group'
+                elif subformat.endswith('S'):
+                    kind = 'string'
+                elif subformat.endswith('X'):
+                    kind = 'bytes'
+                else:
+                    kind = 'array'
+
+                # '*'-prefixed segments consume all remaining arguments.
+                if subformat.startswith('*'):
+                    argument_count = None
+                else:
+                    argument_count = cls._format_string_argument_count(subformat)
+
+                # Non-'*' as-is segments are the only specials whose length
+                # doesn't depend on the data being parsed.
+                if (kind == 'bytes') and not subformat.startswith('*'):
+                    fixed_size = cls._get_bytes_consumed_by_format(subformat, b'')
+                else:
+                    fixed_size = None
+
+                segments.append(cls._CompiledFormatSegment(
+                        subformat, kind, None, argument_count, fixed_size))
+
+            # Plain segments compile directly into a struct.Struct; we always
+            # pack/unpack using standard-sized little endian.
+            else:
+                if not subformat.startswith('<'):
+                    subformat = '<' + subformat
+
+                compiled_struct = struct.Struct(future_utils.native_str(subformat))
+
+                # Unpacking a zero-buffer tells us exactly how many values the
+                # struct produces/consumes, repeat counts and all.
+                argument_count = len(compiled_struct.unpack(b'\x00' * compiled_struct.size))
+
+                segments.append(cls._CompiledFormatSegment(subformat, 'plain',
+                        compiled_struct, argument_count, compiled_struct.size))
+
+        # If the whole format is one plain segment, note its struct, so
+        # pack/unpack can skip segment handling entirely.
+        single_struct = None
+        if (len(segments) == 1) and (segments[0].kind == 'plain'):
+            single_struct = segments[0].compiled_struct
+
+        compiled = cls._CompiledFormat(segments, single_struct)
+        cls._compiled_format_cache[format_string] = compiled
+        return compiled
+
+
+    """ Explicit struct-letter to numpy dtype map for the vectorized decode
+        path. Deliberately not numpy's own letter codes, whose widths ('L',
+        notably) follow the platform's C types rather than struct's
+        standard sizes. """
+    _NUMPY_DTYPE_FOR_SPECIFIER = {
+        'b': '<i1', 'B': '<u1',
+        'h': '<i2', 'H': '<u2',
+        'i': '<i4', 'I': '<u4',
+        'l': '<i4', 'L': '<u4',
+        'q': '<i8', 'Q': '<u8',
+        'f': '<f4', 'd': '<f8',
+    }
+
+
+    @classmethod
+    def _numpy_dtype_for_vector_format(cls, compiled):
+        """ Returns the numpy dtype for a compiled format the vectorized
+            decode path can service -- one whose only value-producing segment
+            is a homogeneous repeat ('*'-prefixed array). A bare byte-order
+            prefix like '<' compiles into an empty plain segment, and doesn't
+            disqualify a format. Returns None for anything else. """
+
+        dtype = None
+
+        for segment in compiled.segments:
+
+            if segment.kind == 'array':
+                text = segment.text
+
+                if (dtype is not None) or (len(text) != 2) or (text[0] != '*'):
+                    return None
+
+                specifier = cls._NUMPY_DTYPE_FOR_SPECIFIER.get(text[1])
+                if specifier is None:
+                    return None
+
+                dtype = numpy.dtype(specifier)
+
+            # Empty plain segments (byte-order prefixes) produce no values.
+            elif (segment.kind == 'plain') and (segment.fixed_size == 0):
+                continue
+
+            else:
+                return None
+
+        return dtype
+
+
     @classmethod
     def _split_struct_string(cls, format_string):
         """ Splits a libgreat pack/unpack format string into groups
@@ -550,45 +962,63 @@ class CommsBackend(object):
         Grouped arguments are especially useful with repeat count 'prefixes'.
         """
 
-        # Break the format string into chunks we can handle.
-        # These chunks can either be passed into struct.pack or into one
-        # of our local packing functions.
-        subformats = cls._split_struct_string(format_string)
+        # Fetch the precompiled representation of this format string; usually
+        # a cache hit, as verb signatures are compiled during autoenumeration.
+        compiled = cls._compile_format(format_string)
 
-        # Build a byte-string from each sub-format.
-        result = b""
-        for subformat in subformats:
-            args_consumed, args = cls._split_off_arguments_for_format(subformat, args)
-
-            # If this is one of our special formats, handle it.
-            if cls._is_special_format(subformat):
+        # Fast path: a format with no special fields is a single struct.pack.
+        if compiled.single_struct is not None:
+            return compiled.single_struct.pack(*args)
 
-                # If this is a group, recurse and handle the subformat.
-                if subformat.endswith(')'):
-                    result += cls._pack_group(subformat, args_consumed)
-                # If this is a string subformat, handle it.
-                elif subformat.endswith('S'):
-                    result += c_string_arguments('UTF-8', *args_consumed)
-                elif subformat.endswith('X'):
-                    result += bytes(args_consumed[0])
-                else:
-                    result += int_array_arguments(subformat[-1], *args_consumed)
+        # Build a byte-string from each precompiled segment.
+        result = b""
+        for segment in compiled.segments:
 
+            # Split off the arguments this segment consumes; a None count
+            # (a '*'-prefixed segment) consumes all that remain.
+            if segment.argument_count is None:
+                args_consumed, args = args, ()
+            else:
+                args_consumed = args[0:segment.argument_count]
+                args = args[segment.argument_count:]
+
+            # If this is a group, recurse and handle the subformat.
+            if segment.kind == 'group':
+                result += cls._pack_group(segment.text, args_consumed)
+            # If this is a string subformat, handle it.
+            elif segment.kind == 'string':
+                result += c_string_arguments('UTF-8', *args_consumed)
+            elif segment.kind == 'bytes':
+                result += bytes(args_consumed[0])
+            elif segment.kind == 'array':
+                result += int_array_arguments(segment.text[-1], *args_consumed)
 
             # Otherwise, it's a standard pack format; pack it.
             else:
-                # We always pack/unpack things using standard-sized little endian.
-                if not subformat.startswith('<'):
-                    subformat = '<' + subformat
-
-                result += struct.pack(subformat, *args_consumed)
+                result += segment.compiled_struct.pack(*args_consumed)
 
         # Return the composed byte-string.
         return result
 
     @classmethod
-    @memoize_with_lru_cache(maxsize=128)
     def unpack(cls, format_string, raw_bytes):
+        # Responses from a backend's reused buffer pool arrive as memoryviews
+        # over transient storage: unhashable, and wrong to remember. Those
+        # skip the memoized path below and decode directly. String and group
+        # segments scan for terminators, which needs real bytes; everything
+        # else decodes straight from the view.
+        if not isinstance(raw_bytes, bytes):
+            compiled = cls._compile_format(format_string)
+            if any(segment.kind in ('string', 'group') for segment in compiled.segments):
+                raw_bytes = bytes(raw_bytes)
+            return cls._unpack(cls, format_string, raw_bytes)
+
+        return cls._unpack_memoized(format_string, raw_bytes)
+
+
+    @classmethod
+    @memoize_with_lru_cache(maxsize=128)
+    def _unpack_memoized(cls, format_string, raw_bytes):
         try:
             return cls._unpack(cls, format_string, raw_bytes)
         except Exception as e:
@@ -621,47 +1051,67 @@ class CommsBackend(object):
         Grouped arguments are especially useful with repeat count 'prefixes'.
         """
 
-        # We always pack/unpack things using standard-sized little endian.
-        # If this wasn't specified, assume it.
-        if not format_string.startswith('<'):
-            format_string = '<' + format_string
-
-        # Break the format string into chunks we can handle.
-        # These chunks can either be passed into struct.pack or into one
-        # of our local packing functions.
-        subformats = cls._split_struct_string(format_string)
-
-        # Build a byte-string from each sub-format.
+        # Fetch the precompiled representation of this format string; usually
+        # a cache hit, as verb signatures are compiled during autoenumeration.
+        # (Plain segments always compile as standard-sized little endian.)
+        compiled = cls._compile_format(format_string)
+
+        # Vector fast path: a format that is a single homogeneous repeat
+        # ("*I" and friends) decodes as one zero-copy numpy view over the
+        # received buffer, rather than a Python loop building a million-entry
+        # tuple. Heterogeneous formats keep the tuple path below.
+        if numpy is not None:
+            dtype = cls._numpy_dtype_for_vector_format(compiled)
+            if (dtype is not None) and (len(raw_bytes) % dtype.itemsize == 0):
+                decoded = numpy.frombuffer(raw_bytes, dtype=dtype)
+
+                # Anything that isn't a bytes object may be a view over a
+                # backend's reused buffer pool, which a later command will
+                # silently overwrite; hand the caller an owned copy instead.
+                # One memcpy -- the tuple path this replaces is still skipped.
+                if not isinstance(raw_bytes, bytes):
+                    decoded = decoded.copy()
+
+                return decoded
+
+        # Fast path: a format with no special fields, parsing an exactly-sized
+        # response, is a single struct.unpack.
+        if (compiled.single_struct is not None) and \
+                (len(raw_bytes) == compiled.single_struct.size):
+            return compiled.single_struct.unpack(raw_bytes)
+
+        # Build our result tuple from each precompiled segment.
         results = []
-        for subformat in subformats:
-            bytes_consumed, raw_bytes = cls._split_off_bytes_for_format(subformat, raw_bytes)
+        for segment in compiled.segments:
 
-            # If this is one of our special formats, handle it.
-            if cls._is_special_format(subformat):
+            # Split off the bytes this segment consumes; segments without a
+            # precomputed size ('*', strings, groups) depend on the data.
+            if segment.fixed_size is not None:
+                size = segment.fixed_size
+            else:
+                size = cls._get_bytes_consumed_by_format(segment.text, raw_bytes)
+            bytes_consumed = raw_bytes[0:size]
+            raw_bytes = raw_bytes[size:]
 
-                # If this is a group, recurse and handle the subformat.
-                if subformat.endswith(')'):
-                    results.extend(cls._unpack_group(subformat, bytes_consumed))
+            # If this is a group, recurse and handle the subformat.
+            if segment.kind == 'group':
+                results.extend(cls._unpack_group(segment.text, bytes_consumed))
 
-                # If this is a string subformat, handle it.
-                elif subformat.endswith('S'):
-                    results.extend(c_string_return(bytes_consumed, 'UTF-8'))
+            # If this is a string subformat, handle it.
+            elif segment.kind == 'string':
+                results.extend(c_string_return(bytes_consumed, 'UTF-8'))
 
-                # If this is an as-is subformat, handle it.
-                elif subformat.endswith('X'):
-                    results.append(bytes_consumed)
+            # If this is an as-is subformat, handle it.
+            elif segment.kind == 'bytes':
+                results.append(bytes_consumed)
 
-                # Otherwise, it's an integer format.
-                else:
-                    results.extend(int_array_return(bytes_consumed, subformat[-1]))
+            # If this is an integer-array format, handle it.
+            elif segment.kind == 'array':
+                results.extend(int_array_return(bytes_consumed, segment.text[-1]))
 
             # Otherwise, it's a standard pack format; unpack it.
             else:
-                # We always pack/unpack things using standard-sized little endian.
-                if not subformat.startswith('<'):
-                    subformat = '<' + subformat
-
-                results.extend(struct.unpack(subformat, bytes_consumed))
+                results.extend(segment.compiled_struct.unpack(bytes_consumed))
 
         # Return the generated tuple.
         return tuple(results)
@@ -972,6 +1422,74 @@ class CommsBackend(object):
         pass
 
 
+    def open_pipe(self, name, direction='in', transfers_in_flight=4):
+        """ Opens a bulk pipe to the device -- the host-side counterpart to
+            the firmware's comms pipes. See CommsPipe for the pipe interface.
+
+        Args:
+            name -- The name of the pipe, matching the name the relevant
+                firmware class registered; used for diagnostics. The class's
+                own verbs are responsible for configuring the device side of
+                the stream before data flows.
+            direction -- 'in' for device-to-host pipes, or 'out' for
+                host-to-device ones.
+            transfers_in_flight -- The number of transfers the backend should
+                keep in flight at once, where the backend supports pipelining.
+
+        Returns a CommsPipe subclass appropriate for the backend.
+        """
+        raise NotImplementedError("this backend does not support bulk pipes")
+
+
+class CommsPipe(object):
+    """ Abstract class representing a high-throughput stream to or from a
+        libgreat device -- the host-side counterpart to the firmware's comms
+        pipes. Backends provide concrete implementations; see e.g. the usb1
+        backend's bulk-endpoint pipes.
+
+        Pipes transfer data directly into (or out of) caller-provided
+        buffers, so large streams can land in e.g. numpy arrays without
+        intermediate copies.
+    """
+
+    def __init__(self, name, direction):
+        self.name = name
+        self.direction = direction
+
+
+    def read_into(self, buffers, timeout=1000):
+        """ Reads from the pipe directly into the given writable buffers
+            (e.g. memoryviews of a numpy array), keeping multiple transfers
+            in flight.
+
+        Args:
+            buffers -- A sequence of writable buffer objects, each of which
+                receives one transfer's worth of data.
+            timeout -- The maximum wait for each transfer, in ms.
+
+        Returns a list with the number of bytes actually placed into each buffer.
+        """
+        raise NotImplementedError()
+
+
+    def write(self, data, timeout=1000):
+        """ Writes the given buffer out over the pipe. """
+        raise NotImplementedError()
+
+
+    def close(self):
+        """ Tears the pipe down, releasing any backend resources it holds. """
+        pass
+
+
+    def __enter__(self):
+        return self
+
+
+    def __exit__(self, exception_type, exception_value, traceback):
+        self.close()
+
+
 class CommsApiCollection(object):
     """ Dynamically-allocated container object that is automatically
         populated with API objects. Provides a view of our dictionary
@@ -1117,6 +1635,11 @@ def command_rpc(verb_number, in_format="", out_format="", name="function", class
     """
 
 
+    # Precompile both of the verb's signatures now -- at generation time --
+    # so every later call's pack/unpack is a cache hit rather than a parse.
+    CommsBackend._compile_format(in_format)
+    CommsBackend._compile_format(out_format)
+
     # Create a partially bound method that's closed over the variables we want to store.
     def method(self, *arguments, **kwargs):
         encoding = kwargs.pop('encoding', None)
@@ -1206,26 +1729,16 @@ def int_array_return(raw_bytes, specifier='I'):
                      provided to struct.pack()
     """
 
-    # from the python itertools recipes section
-    def break_into_chunks(size, string):
-        """ Iterates over a byte-string, chunking it into groups of length size"""
-
-        chunks = []
-
-        while string:
-            chunks.append(string[0:size])
-            string = string[size:]
-
-        return chunks
-
+    # Unpack the whole array in one call, rather than chunking the string
+    # element by element.
+    size = struct.calcsize(specifier)
+    count = len(raw_bytes) // size
 
-    def parse_bytes(b):
-        """ Parses each our collection of integers. """
-        return struct.unpack('<' + specifier, b)[0]
+    if len(raw_bytes) % size:
+        raise struct.error("array of {} has a ragged tail of {} bytes".format(
+                specifier, len(raw_bytes) % size))
 
-    # Break the array into integers.
-    size = struct.calcsize(specifier)
-    return [parse_bytes(b) for b in break_into_chunks(size, raw_bytes)]
+    return list(struct.unpack('<{}{}'.format(count, specifier), raw_bytes))
 
 
 
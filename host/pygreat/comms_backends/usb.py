@@ -12,6 +12,7 @@ from future import utils as future_utils
 
 import usb
 import time
+import array
 import errno
 import struct
 import platform
@@ -109,6 +110,11 @@ class USBCommsBackend(CommsBackend):
         self._last_command_arguments = None
         self._have_exclusive_access = False
 
+        # Buffer-reuse mode (see enable_buffer_reuse): a pool of
+        # preallocated response buffers, or None while disabled.
+        self._response_buffer_pool = None
+        self._response_buffer_index = 0
+
         # Run the parent initialization.
         super(USBCommsBackend, self).__init__(**device_identifiers)
 
@@ -258,6 +264,33 @@ class USBCommsBackend(CommsBackend):
             index=index, length_or_data=data, timeout=timeout)
 
 
+    def enable_buffer_reuse(self, pool_size=2):
+        """ Switches command responses onto preallocated, reused buffers.
+
+        High-rate RPC loops spend measurable wall time allocating a fresh
+        response buffer per command and collecting it again. With reuse
+        enabled, responses are read into a small round-robin pool of
+        preallocated buffers instead, and execute_raw_command() returns a
+        memoryview over pooled storage rather than a new bytes object.
+
+        The view is only valid until its pool entry's turn comes around
+        again -- with the default pool of two, until the second following
+        command. Unpack it promptly (struct and numpy.frombuffer both accept
+        memoryviews directly), or copy it with bytes() to keep it. Results
+        decoded through CommsBackend.unpack() -- including its numpy path --
+        are owned copies, and remain valid indefinitely.
+
+        Args:
+            pool_size -- The number of preallocated buffers to rotate through.
+        """
+
+        self._response_buffer_pool = [
+            array.array('B', bytes(self.LIBGREAT_MAX_COMMAND_SIZE))
+            for _ in range(pool_size)
+        ]
+        self._response_buffer_index = 0
+
+
     @staticmethod
     def _build_command_prelude(class_number, verb):
         """Builds a libgreat command prelude, which identifies the command
@@ -368,6 +401,27 @@ class USBCommsBackend(CommsBackend):
                     max_response_length = self.LIBGREAT_MAX_COMMAND_SIZE
 
                 # ... and read any response the device has prepared for us.
+                # With buffer reuse enabled, the read lands in a pooled,
+                # preallocated buffer, and we return a memoryview over it --
+                # no per-command allocation. (pyusb reads into the whole
+                # buffer, so wLength is the buffer's 4096; the caller's
+                # maximum still truncates what we hand back.)
+                if self._response_buffer_pool is not None:
+                    pooled = self._response_buffer_pool[self._response_buffer_index]
+                    self._response_buffer_index = \
+                        (self._response_buffer_index + 1) % len(self._response_buffer_pool)
+
+                    read_count = self.device.ctrl_transfer(
+                        usb.ENDPOINT_IN | usb.TYPE_VENDOR | usb.RECIP_ENDPOINT,
+                        self.LIBGREAT_REQUEST_NUMBER, self.LIBGREAT_VALUE_EXECUTE, flags, pooled, comms_timeout)
+
+                    response = memoryview(pooled)[:min(read_count, max_response_length)]
+
+                    if encoding and read_count:
+                        return response.tobytes().decode(encoding, errors='ignore')
+
+                    return response
+
                 response = self.device.ctrl_transfer(
                     usb.ENDPOINT_IN | usb.TYPE_VENDOR | usb.RECIP_ENDPOINT,
                     self.LIBGREAT_REQUEST_NUMBER, self.LIBGREAT_VALUE_EXECUTE, flags, max_response_length, comms_timeout)
@@ -20,10 +20,292 @@ import atexit
 import struct
 import platform
 import logging
+import threading
 
-from ..comms import CommsBackend
+from ..comms import CommsBackend, CommsPipe
 from ..errors import DeviceNotFoundError
 
+
+class USB1BulkPipe(CommsPipe):
+    """
+    A comms pipe carried over the libgreat bulk endpoints, using libusb1's
+    asynchronous transfers.
+
+    Reads land directly in caller-provided writable buffers (memoryviews of
+    numpy arrays work nicely), with several transfers kept in flight, so
+    sustained streams avoid both per-transfer round trips and intermediate
+    bytes objects.
+    """
+
+    def __init__(self, backend, name, direction, transfers_in_flight=4):
+        super(USB1BulkPipe, self).__init__(name, direction)
+
+        self._backend = backend
+        self._transfers_in_flight = transfers_in_flight
+
+        if direction == 'in':
+            self._endpoint = backend.LIBGREAT_BULK_IN_ENDPOINT_ADDRESS
+        else:
+            self._endpoint = backend.LIBGREAT_BULK_OUT_ENDPOINT_ADDRESS
+
+        # Hold the libgreat interface for the lifetime of the pipe.
+        backend._hold_libgreat_interface()
+        self._open = True
+
+
+    def read_into(self, buffers, timeout=1000):
+        """
+        Reads from the pipe directly into the given writable buffers, keeping
+        up to transfers_in_flight transfers submitted at once; see CommsPipe.
+
+        Returns a list with the number of bytes actually placed into each buffer.
+        """
+
+        if self.direction != 'in':
+            raise IOError("cannot read from a host-to-device pipe!")
+        if not self._open:
+            raise IOError("cannot read from a closed pipe!")
+
+        results = [0] * len(buffers)
+        failures = []
+
+        # Counters shared with the transfer callback: transfers submitted so
+        # far, and transfers completed so far.
+        progress = {'submitted': 0, 'completed': 0}
+
+        def _submit_next(transfers):
+            transfers[progress['submitted']].submit()
+            progress['submitted'] += 1
+
+        def _transfer_completed(transfer):
+            progress['completed'] += 1
+
+            index = transfer.getUserData()
+            if transfer.getStatus() == usb1.TRANSFER_COMPLETED:
+                results[index] = transfer.getActualLength()
+            else:
+                failures.append((index, transfer.getStatus()))
+
+            # Keep the pipeline full: as each transfer retires, submit the
+            # next buffer's -- unless something has already gone wrong.
+            if not failures and (progress['submitted'] < len(transfers)):
+                _submit_next(transfers)
+
+        # Build a transfer around each of the caller's buffers; libusb1 reads
+        # into the provided buffer directly, so this is our zero-copy handoff.
+        transfers = []
+        for index, buffer in enumerate(buffers):
+            transfer = self._backend.device_handle.getTransfer()
+            transfer.setBulk(self._endpoint, buffer, callback=_transfer_completed,
+                    user_data=index, timeout=timeout)
+            transfers.append(transfer)
+
+        # Prime the pipeline, then drive libusb until everything submitted
+        # has retired.
+        while (progress['submitted'] < self._transfers_in_flight) and \
+                (progress['submitted'] < len(transfers)):
+            _submit_next(transfers)
+
+        while progress['completed'] < progress['submitted']:
+            self._backend._get_libusb_context().handleEvents()
+
+        if failures:
+            index, status = failures[0]
+            raise IOError("bulk pipe transfer for buffer {} failed (libusb status {})!".format(index, status))
+
+        return results
+
+
+    def write(self, data, timeout=1000):
+        """ Writes the given buffer out over the pipe. """
+
+        if self.direction != 'out':
+            raise IOError("cannot write to a device-to-host pipe!")
+        if not self._open:
+            raise IOError("cannot write to a closed pipe!")
+
+        return self._backend.device_handle.bulkWrite(
+                self._backend.LIBGREAT_BULK_OUT_ENDPOINT_NUMBER, data, timeout)
+
+
+    def close(self):
+        """ Tears the pipe down, releasing our hold on the libgreat interface. """
+
+        if self._open:
+            self._open = False
+            self._backend._release_libgreat_interface()
+
+
+class USBCommandFuture(object):
+    """
+    The eventual result of a command submitted through an asynchronous batch.
+
+    Futures resolve when their batch is flushed -- either explicitly, via the
+    batch's flush()/context exit, or lazily, the first time a result is
+    requested.
+    """
+
+    def __init__(self, batch, pretty_name):
+        self._batch = batch
+        self._pretty_name = pretty_name
+        self._complete = False
+        self._result = None
+        self._exception = None
+
+
+    def _resolve(self, result):
+        """ Marks the future complete, with the given response data. """
+        self._complete = True
+        self._result = result
+
+
+    def _fail(self, exception):
+        """ Marks the future complete, with the given failure. """
+        self._complete = True
+        self._exception = exception
+
+
+    def done(self):
+        """ Returns true iff the command has completed (successfully or not). """
+        return self._complete
+
+
+    def result(self):
+        """
+        Returns the command's response data, flushing the owning batch first
+        if it hasn't completed yet. Raises the command's failure, if it failed.
+        """
+
+        if not self._complete:
+            self._batch.flush()
+
+        if self._exception is not None:
+            raise self._exception
+
+        return self._result
+
+
+class USBAsyncBatch(object):
+    """
+    Context manager that pipelines libgreat commands.
+
+    Submitted commands are packed into batch containers -- each a single
+    vendor request carrying several {prelude, length, arguments} records --
+    and the containers' USB transfers are all queued with libusb up front,
+    so N independent commands cost roughly one round trip plus N device
+    executions, rather than N full round trips.
+
+    Commands in a batch execute strictly in submission order, and individual
+    failures are reported on each command's future rather than aborting the
+    remainder of the batch.
+    """
+
+    """ struct describing a single command's header within a batch container. """
+    COMMAND_HEADER = struct.Struct("<III")
+
+    """ struct describing a single response's header within a batch response. """
+    RESPONSE_HEADER = struct.Struct("<II")
+
+    def __init__(self, backend, timeout=1000):
+        self._backend = backend
+        self._timeout = timeout
+
+        # Commands not yet flushed to the device: (encoded_command,
+        # response_budget, future) tuples.
+        self._pending = []
+
+
+    def __enter__(self):
+        return self
+
+
+    def __exit__(self, exception_type, exception_value, traceback):
+
+        # Flush any outstanding commands on clean exit; if we're unwinding an
+        # exception, drop them rather than talking to the device mid-failure.
+        if exception_type is None:
+            self.flush()
+        else:
+            self._pending = []
+
+
+    def submit(self, class_number, verb, data=None, max_response_length=0, pretty_name="unknown"):
+        """
+        Queues a libgreat command for pipelined execution.
+
+        Args:
+            class_number -- The class number for the given command.
+            verb -- The verb number for the given command.
+            data -- Data to be transmitted with the command.
+            max_response_length -- The response size to budget for this
+                command; commands that return data must declare enough
+                room here for their response.
+            pretty_name -- String describing the RPC; used for error handling.
+
+        Returns a USBCommandFuture that will carry the command's response data.
+        """
+
+        data = bytes(data) if data else b''
+
+        # Encode the command as it'll appear in the batch container: its
+        # header, its arguments, and padding out to a word boundary.
+        encoded = self.COMMAND_HEADER.pack(class_number, verb, len(data)) + data
+        encoded += b'\x00' * (-len(encoded) % 4)
+
+        # Budget the container space this command's response may occupy.
+        response_budget = self.RESPONSE_HEADER.size + max_response_length
+        response_budget += -response_budget % 4
+
+        max_size = self._backend.LIBGREAT_MAX_COMMAND_SIZE
+        if (len(encoded) > max_size) or (response_budget > max_size):
+            raise ValueError("Command payload or response budget is too long to batch!")
+
+        future = USBCommandFuture(self, pretty_name)
+        self._pending.append((encoded, response_budget, future))
+        return future
+
+
+    def flush(self):
+        """ Executes all outstanding commands, resolving their futures. """
+
+        if not self._pending:
+            return
+
+        pending, self._pending = self._pending, []
+        self._backend._execute_batch_containers(self._build_containers(pending), self._timeout)
+
+
+    def _build_containers(self, pending):
+        """
+        Packs pending commands into batch containers, splitting wherever a
+        container's commands or its budgeted responses would overflow the
+        device's command buffer.
+
+        Returns a list of (container_bytes, futures) pairs.
+        """
+
+        max_size = self._backend.LIBGREAT_MAX_COMMAND_SIZE
+
+        containers = []
+        contents, futures = b'', []
+        response_total = 0
+
+        for encoded, response_budget, future in pending:
+
+            if contents and ((len(contents) + len(encoded) > max_size) or
+                    (response_total + response_budget > max_size)):
+                containers.append((contents, futures))
+                contents, futures = b'', []
+                response_total = 0
+
+            contents += encoded
+            response_total += response_budget
+            futures.append(future)
+
+        containers.append((contents, futures))
+        return containers
+
+
 class USB1CommsBackend(CommsBackend):
     """
     Class representing an abstract communications channel used to
@@ -90,6 +372,13 @@ class USB1CommsBackend(CommsBackend):
     """
     LIBGREAT_FLAG_REPEAT_LAST = (1 << 1)
 
+    """
+    A flag passed to command execution that indicates the payload is a batch container:
+    several commands to be executed in order, with their responses gathered into a
+    single batch response.
+    """
+    LIBGREAT_FLAG_BATCH = (1 << 2)
+
 
     @classmethod
     def _get_libusb_context(cls):
@@ -447,6 +736,118 @@ class USB1CommsBackend(CommsBackend):
             self._release_libgreat_interface()
 
 
+    def open_pipe(self, name, direction='in', transfers_in_flight=4):
+        """
+        Opens a bulk pipe to the device, carried over the libgreat bulk
+        endpoints; see CommsBackend.open_pipe and USB1BulkPipe.
+        """
+        return USB1BulkPipe(self, name, direction, transfers_in_flight)
+
+
+    def batch(self, timeout=1000):
+        """
+        Returns a context manager that pipelines libgreat commands.
+
+        Commands submitted through the batch are packed into batch containers
+        and executed with pipelined asynchronous transfers when the context
+        exits (or on an explicit flush()); each submission returns a future
+        carrying that command's eventual response. Intended for long runs of
+        independent commands -- pin setup, register pokes -- where round-trip
+        latency otherwise dominates.
+
+        Parameters:
+            timeout -- the maximum execution time for each container, in ms
+        """
+        return USBAsyncBatch(self, timeout)
+
+
+    def _execute_batch_containers(self, containers, timeout):
+        """
+        Executes a series of batch containers, resolving their futures.
+
+        All of the containers' transfers are submitted to libusb up front:
+        control transfers share endpoint zero, so they execute strictly in
+        submission order, keeping each container's write ahead of its read
+        and letting the device start on the next container without waiting
+        on host-side turnaround.
+        """
+
+        # Batched commands invalidate our knowledge of the last-sent command.
+        self._last_command_arguments = None
+
+        self._hold_libgreat_interface()
+        try:
+            transfers = []
+            outstanding = [0]
+
+            def _transfer_completed(transfer):
+                outstanding[0] -= 1
+
+            # Queue a write/read transfer pair for each container.
+            for contents, futures in containers:
+                write = self.device_handle.getTransfer()
+                write.setControl(usb1.TYPE_VENDOR | usb1.RECIPIENT_DEVICE,
+                    self.LIBGREAT_REQUEST_NUMBER, self.LIBGREAT_VALUE_EXECUTE,
+                    self.LIBGREAT_FLAG_BATCH, contents, callback=_transfer_completed,
+                    timeout=timeout)
+
+                read = self.device_handle.getTransfer()
+                read.setControl(usb1.ENDPOINT_IN | usb1.TYPE_VENDOR | usb1.RECIPIENT_DEVICE,
+                    self.LIBGREAT_REQUEST_NUMBER, self.LIBGREAT_VALUE_EXECUTE,
+                    0, self.LIBGREAT_MAX_COMMAND_SIZE, callback=_transfer_completed,
+                    timeout=timeout)
+
+                transfers.append((write, read, futures))
+
+            for write, read, _ in transfers:
+                write.submit()
+                read.submit()
+                outstanding[0] += 2
+
+            # Drive libusb until every transfer has completed.
+            while outstanding[0]:
+                self._get_libusb_context().handleEvents()
+
+            # Resolve each container's futures from its batch response.
+            for write, read, futures in transfers:
+                self._complete_batch_container(write, read, futures)
+        finally:
+            self._release_libgreat_interface()
+
+
+    def _complete_batch_container(self, write, read, futures):
+        """ Resolves a single container's futures from its completed transfers. """
+
+        # If either of the container's transfers failed on the wire, the whole
+        # container failed; abort the active command and fail its futures.
+        if (write.getStatus() != usb1.TRANSFER_COMPLETED) or \
+                (read.getStatus() != usb1.TRANSFER_COMPLETED):
+            error_number = self.abort_command()
+            for future in futures:
+                future._fail(self._exception_for_command_failure(error_number, future._pretty_name))
+            return
+
+        response = bytes(read.getBuffer()[:read.getActualLength()])
+        header = USBAsyncBatch.RESPONSE_HEADER
+        position = 0
+
+        # Walk the batch response, pairing each response record with its future.
+        for future in futures:
+            if position + header.size > len(response):
+                future._fail(IOError("batch response from the device was truncated!"))
+                continue
+
+            status, data_length = header.unpack_from(response, position)
+            position += header.size
+            data = response[position:position + data_length]
+            position += data_length + (-data_length % 4)
+
+            if status:
+                future._fail(self._exception_for_command_failure(status, future._pretty_name))
+            else:
+                future._resolve(data)
+
+
     def abort_command(self, timeout=1000, retry_delay=1):
         """ Aborts execution of a current libgreat command. Used for error handling.
 
@@ -520,3 +921,140 @@ class USB1CommsBackend(CommsBackend):
             USB1CommsBackend.device_handles.remove(self.device_handle)
             self.device_handle.close()
             self.device_handle = None
+
+
+class USB1HotplugMonitor(object):
+    """
+    Event-driven device monitoring, via libusb1's hotplug callback API.
+
+    Polling autodetect() to notice a board reset re-enumerates the whole bus
+    -- hundreds of milliseconds of descriptor fetching per poll. A monitor
+    instead keeps a live table of matching devices on its own libusb context
+    and background event thread: arrivals and departures update the table
+    and fire the given callbacks as the OS reports them, so reconnect
+    detection costs nothing between events.
+
+    Callbacks receive the usb1 device object, and run on the monitor thread
+    -- they should hand off to the orchestration's own machinery rather than
+    talking to the device directly. Device identifiers are the same keyword
+    constraints autodetect() takes (idVendor, idProduct, serial_number, ...).
+
+    Raises IOError at construction if the libusb on this platform reports no
+    hotplug support (notably Windows).
+    """
+
+    def __init__(self, connect_callback=None, disconnect_callback=None, **device_identifiers):
+
+        self._connect_callback = connect_callback
+        self._disconnect_callback = disconnect_callback
+        self._identifiers = device_identifiers
+
+        # Use a context of our own, so the event thread never contends with
+        # command traffic on the backend's shared context.
+        self._context = usb1.USBContext().__enter__()
+
+        if not self._context.hasCapability(usb1.CAP_HAS_HOTPLUG):
+            self._context.close()
+            raise IOError("this platform's libusb has no hotplug support")
+
+        # The live device table, keyed by (bus, address); and the events the
+        # hotplug callback has deferred to the monitor thread.
+        self._devices = {}
+        self._pending_events = []
+        self._lock = threading.Lock()
+        self._running = True
+
+        # Register for both event directions; HOTPLUG_ENUMERATE replays an
+        # arrival for every device already present, seeding our table.
+        self._callback_handle = self._context.hotplugRegisterCallback(
+            self._handle_hotplug_event,
+            events=usb1.HOTPLUG_EVENT_DEVICE_ARRIVED | usb1.HOTPLUG_EVENT_DEVICE_LEFT,
+            flags=usb1.HOTPLUG_ENUMERATE)
+
+        self._thread = threading.Thread(target=self._monitor_loop,
+                name="pygreat hotplug monitor")
+        self._thread.daemon = True
+        self._thread.start()
+
+        atexit.register(self.stop)
+
+
+    @property
+    def devices(self):
+        """ The current list of matching, connected usb1 device objects. """
+        with self._lock:
+            return list(self._devices.values())
+
+
+    def _handle_hotplug_event(self, context, device, event):
+        """
+        The raw libusb hotplug callback. Runs inside event handling, where
+        blocking on the device is disallowed -- so just queue the event; the
+        monitor loop does the matching and notification.
+        """
+        self._pending_events.append((event, device))
+
+        # Stay registered.
+        return False
+
+
+    def _matches(self, device):
+        """ Applies our identifier constraints to an arriving device. """
+        try:
+            return USB1CommsBackend._device_matches_identifiers(device, self._identifiers)
+        except usb1.USBError:
+            # The device vanished (or can't be opened) mid-check; treat a
+            # device we can't identify as not ours.
+            return False
+
+
+    def _dispatch(self, callback, device):
+        """ Runs a user callback, keeping its failures out of our loop. """
+        if callback is None:
+            return
+        try:
+            callback(device)
+        except Exception:
+            logging.exception("unhandled exception in hotplug callback")
+
+
+    def _monitor_loop(self):
+        """ The background event thread: pump libusb, then settle events. """
+
+        while self._running:
+            try:
+                self._context.handleEventsTimeout(tv=0.5)
+            except usb1.USBError:
+                # A transient event-handling failure shouldn't kill the
+                # monitor; back off briefly and resume.
+                time.sleep(0.1)
+
+            # Process events outside the hotplug callback, where opening the
+            # device (e.g. for serial-number matching) is allowed.
+            while self._pending_events:
+                event, device = self._pending_events.pop(0)
+                key = (device.getBusNumber(), device.getDeviceAddress())
+
+                if event == usb1.HOTPLUG_EVENT_DEVICE_ARRIVED:
+                    if not self._matches(device):
+                        continue
+                    with self._lock:
+                        self._devices[key] = device
+                    self._dispatch(self._connect_callback, device)
+                else:
+                    with self._lock:
+                        known = self._devices.pop(key, None)
+                    if known is not None:
+                        self._dispatch(self._disconnect_callback, known)
+
+
+    def stop(self):
+        """ Stops the monitor and releases its libusb resources. """
+
+        if not self._running:
+            return
+        self._running = False
+
+        self._thread.join()
+        self._context.hotplugDeregisterCallback(self._callback_handle)
+        self._context.close()
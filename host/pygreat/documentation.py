@@ -0,0 +1,113 @@
+#
+# This file is part of libgreat
+#
+
+"""
+Host-side documentation bundles for libgreat verbs.
+
+Firmware built with LIBGREAT_STRIP_VERB_DOCUMENTATION omits verb docstrings
+and parameter names from its comms tables, reclaiming flash and shrinking
+the introspection traffic on first connect. This module fills the gap on
+the host: it resolves documentation for a (class, verb) pair from JSON
+bundles, so stripped devices still present fully-documented RPCs.
+
+A bundle is a JSON object mapping class names to::
+
+    {
+        "class_docs": "short blurb about the class",
+        "verbs": {
+            "verb_name": {
+                "documentation": "...",
+                "in_param_names": "a, b",
+                "out_param_names": "c"
+            }
+        }
+    }
+
+pygreat ships a bundle covering the classes libgreat itself defines;
+projects layering their own classes on top can register additional
+bundles with register_documentation_bundle().
+"""
+
+import json
+import os
+
+# The bundle shipped alongside this module, covering libgreat's own classes.
+_BUNDLED_DOCUMENTATION_PATH = \
+        os.path.join(os.path.dirname(__file__), 'verb_documentation.json')
+
+# Paths of every registered bundle, in registration order; later bundles
+# take precedence, so projects can override the shipped documentation.
+_bundle_paths = [_BUNDLED_DOCUMENTATION_PATH]
+
+# The merged contents of every registered bundle, or None if a bundle has
+# been registered since we last loaded.
+_merged_bundles = None
+
+
+def register_documentation_bundle(path):
+    """ Registers an additional documentation bundle.
+
+    Args:
+        path -- Path to a JSON bundle, in the format described in the
+            module docstring. The file is read lazily, on the first
+            documentation lookup after registration; a missing or
+            malformed bundle is skipped rather than raising.
+    """
+    global _merged_bundles
+
+    _bundle_paths.append(path)
+    _merged_bundles = None
+
+
+def _get_merged_bundles():
+    """ Loads and merges every registered bundle, caching the result. """
+    global _merged_bundles
+
+    if _merged_bundles is not None:
+        return _merged_bundles
+
+    merged = {}
+    for path in _bundle_paths:
+
+        # A bundle that's missing or unreadable shouldn't break device
+        # enumeration -- documentation is best-effort.
+        try:
+            with open(path, 'r') as bundle_file:
+                bundle = json.load(bundle_file)
+        except (IOError, OSError, ValueError):
+            continue
+
+        # Merge per class, so a later bundle can document one verb of a
+        # class without clobbering the rest of its entries.
+        for class_name, class_entry in bundle.items():
+            target = merged.setdefault(class_name, {'verbs': {}})
+            if 'class_docs' in class_entry:
+                target['class_docs'] = class_entry['class_docs']
+            target['verbs'].update(class_entry.get('verbs', {}))
+
+    _merged_bundles = merged
+    return merged
+
+
+def lookup_class_documentation(class_name):
+    """ Returns the bundled docstring for a class, or None if none is known. """
+    class_entry = _get_merged_bundles().get(class_name)
+    if not class_entry:
+        return None
+
+    return class_entry.get('class_docs')
+
+
+def lookup_verb_documentation(class_name, verb_name):
+    """ Returns the bundled description of a verb, or None if none is known.
+
+    Returns:
+        a dictionary with any of the keys 'documentation',
+        'in_param_names', and 'out_param_names', as found in the bundle
+    """
+    class_entry = _get_merged_bundles().get(class_name)
+    if not class_entry:
+        return None
+
+    return class_entry['verbs'].get(verb_name)
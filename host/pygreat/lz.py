@@ -0,0 +1,155 @@
+#
+# This file is part of libgreat
+#
+
+""" LZ compression for device image uploads.
+
+RAM-loadable programs are re-uploaded constantly during development, and the
+transfer dominates that loop; code and initialized data typically compress
+3-4x. This module is the host half of the codec: compress() produces a stream
+the firmware's streaming decoder (firmware/drivers/lz.c) expands into RAM as
+chunks arrive, so decompression overlaps the transfer itself.
+
+The format is a byte stream of sequences -- a run of literal bytes followed
+by a back-reference into the output already produced. Each sequence is a
+token byte carrying the literal count (high nibble) and match field (low
+nibble), with counts of 15 extended by additional bytes; matches are at
+least four bytes long, reach back at most 65535 bytes through a two-byte
+little-endian offset, and may overlap their own output. A match field of
+zero marks a literals-only sequence, used to end the stream. The full
+specification lives with the decoder, in firmware/include/drivers/lz.h.
+"""
+
+import struct
+
+# The shortest back-reference the format can express, and the furthest back
+# one can reach. These mirror the decoder's LZ_MINIMUM_MATCH / LZ_MAXIMUM_OFFSET.
+_MINIMUM_MATCH = 4
+_MAXIMUM_OFFSET = 65535
+
+
+def _emit_count(extended):
+    """ Encodes the extension bytes for a nibble count of 15: bytes of 255
+    while the remainder demands them, ended by a byte below 255. """
+
+    encoded = bytearray()
+    while extended >= 255:
+        encoded.append(255)
+        extended -= 255
+    encoded.append(extended)
+    return encoded
+
+
+def _emit_sequence(output, literals, offset, match_length):
+    """ Appends one encoded sequence: literals, then (optionally) a match. """
+
+    literal_length = len(literals)
+    match_field = 0 if not match_length else (match_length - _MINIMUM_MATCH + 1)
+
+    token = (min(literal_length, 15) << 4) | min(match_field, 15)
+    output.append(token)
+
+    if literal_length >= 15:
+        output.extend(_emit_count(literal_length - 15))
+    output.extend(literals)
+
+    if match_length:
+        output.extend(struct.pack("<H", offset))
+        if match_field >= 15:
+            output.extend(_emit_count(match_field - 15))
+
+
+def compress(data):
+    """ Compresses a bytes-like object for the firmware's streaming decoder.
+
+    Greedy single-probe matching: fast, and more than close enough to
+    optimal for the code-and-data images this exists for. Returns the
+    compressed stream as bytes; incompressible input grows by one token
+    byte per 270 bytes of literals, worst case.
+    """
+
+    data = bytes(data)
+    output = bytearray()
+
+    # The most recent position at which each four-byte prefix hash was seen.
+    table = {}
+
+    position = 0
+    literal_start = 0
+
+    while position + _MINIMUM_MATCH <= len(data):
+        prefix = data[position:position + _MINIMUM_MATCH]
+        candidate = table.get(prefix)
+        table[prefix] = position
+
+        # No usable earlier occurrence: this byte stays a literal.
+        if (candidate is None) or ((position - candidate) > _MAXIMUM_OFFSET):
+            position += 1
+            continue
+
+        # Extend the match as far as it runs.
+        length = _MINIMUM_MATCH
+        limit = len(data) - position
+        while (length < limit) and (data[candidate + length] == data[position + length]):
+            length += 1
+
+        _emit_sequence(output, data[literal_start:position], position - candidate, length)
+        position += length
+        literal_start = position
+
+    # End the stream with a literals-only sequence carrying the tail -- the
+    # decoder treats a matchless sequence as a valid stopping point.
+    _emit_sequence(output, data[literal_start:], 0, 0)
+
+    return bytes(output)
+
+
+def decompress(data):
+    """ Reference decoder, mirroring the firmware's; useful for verifying a
+    stream on the host before committing to an upload. Returns the
+    decompressed bytes; raises ValueError on a malformed stream. """
+
+    data = bytes(data)
+    output = bytearray()
+
+    position = 0
+    while position < len(data):
+        token = data[position]
+        position += 1
+
+        literal_length = token >> 4
+        if literal_length == 15:
+            while True:
+                extension = data[position]
+                position += 1
+                literal_length += extension
+                if extension != 255:
+                    break
+
+        output.extend(data[position:position + literal_length])
+        position += literal_length
+
+        match_field = token & 0xf
+        if not match_field:
+            continue
+
+        offset, = struct.unpack_from("<H", data, position)
+        position += 2
+
+        match_length = match_field + _MINIMUM_MATCH - 1
+        if match_field == 15:
+            while True:
+                extension = data[position]
+                position += 1
+                match_length += extension
+                if extension != 255:
+                    break
+
+        if not offset or offset > len(output):
+            raise ValueError("malformed stream: bad match offset")
+
+        # Copy bytewise; overlapping matches repeat their own output.
+        for _ in range(match_length):
+            output.append(output[-offset])
+
+    return bytes(output)
@@ -0,0 +1,228 @@
+#
+# This file is part of libgreat
+#
+
+"""
+Host-side consumer for the firmware's reference pattern source.
+
+The `pattern_source` firmware class streams chunks of a deterministic
+pseudorandom pattern over a bulk pipe at a commanded rate; this module
+drains that stream, validates every chunk against the regenerated pattern,
+and reports sustained throughput, drop counts (both host-observed sequence
+gaps and the device's own accounting), corruption, and latency percentiles.
+Together they form the regression gate for changes to the streaming stack:
+run it before and after, and compare the JSON.
+
+Typical use, from a script or CI job::
+
+    from pygreat.comms import CommsBackend
+    from pygreat import pattern_stream
+
+    backend = CommsBackend.from_device_uri()
+    print(pattern_stream.to_json(pattern_stream.run(backend)))
+
+or directly from the command line::
+
+    python -m pygreat.pattern_stream --rate 8000000 --duration 5
+"""
+
+from __future__ import absolute_import
+
+import sys
+import json
+import time
+import struct
+import argparse
+
+from .benchmark import _summarize_latencies
+
+# Class and verb numbers for the pattern-source class.
+CLASS_NUMBER_PATTERN_SOURCE = 0x4
+PATTERN_SOURCE_VERB_START = 0x0
+PATTERN_SOURCE_VERB_STOP = 0x1
+PATTERN_SOURCE_VERB_GET_STATISTICS = 0x2
+
+# The stream's framing, mirroring the firmware's definitions: each chunk is
+# a 16-byte header -- magic, sequence number, device timestamp (us), and a
+# cumulative drop count -- followed by a payload of xorshift32 words.
+PATTERN_SOURCE_MAGIC = 0x31535250
+CHUNK_SIZE = 2048
+CHUNK_HEADER = struct.Struct('<IIII')
+
+# Payloads repeat with this period (in chunks), keyed by sequence number;
+# we precompute one period's worth and validate with plain comparisons.
+SEED_PERIOD = 8
+SEED_BASE = 0x50524253
+
+
+def _generate_payload(seed, length):
+    """ Regenerates one chunk payload: xorshift32 words from the given seed,
+        matching the firmware's generator.
+    """
+
+    words = []
+    state = seed
+    for _ in range(length // 4):
+        state ^= (state << 13) & 0xFFFFFFFF
+        state ^= state >> 17
+        state ^= (state << 5) & 0xFFFFFFFF
+        words.append(state)
+
+    return struct.pack('<{}I'.format(len(words)), *words)
+
+
+def _expected_payloads():
+    """ Precomputes the expected payload for each seed in the pattern's
+        period, so per-chunk validation is a single comparison.
+    """
+
+    payload_length = CHUNK_SIZE - CHUNK_HEADER.size
+    return [_generate_payload(SEED_BASE + index, payload_length)
+            for index in range(SEED_PERIOD)]
+
+
+def run(backend, pipe=None, rate=0, duration=5.0, read_batch=64, timeout=2000):
+    """ Runs the reference streaming pipeline and validates its output.
+
+    Args:
+        backend -- The CommsBackend connected to the device under test; its
+            firmware must provide the pattern_source class.
+        pipe -- An open CommsPipe for the stream, or None to open one via
+            backend.open_pipe (and close it afterwards).
+        rate -- The commanded rate, in bytes per second; 0 streams as fast
+            as the transport drains.
+        duration -- The (approximate) measurement time, in seconds.
+        read_batch -- The number of chunk-sized transfers to keep per read.
+        timeout -- The maximum wait per transfer, in ms.
+
+    Returns a dictionary of results, suitable for JSON serialization.
+    """
+
+    expected = _expected_payloads()
+    close_pipe = pipe is None
+
+    if pipe is None:
+        pipe = backend.open_pipe('pattern_source')
+
+    chunks_received = 0
+    bytes_received = 0
+    short_transfers = 0
+    bad_magic = 0
+    corrupt_payloads = 0
+    sequence_gap_chunks = 0
+    latency_samples = []
+
+    next_sequence = None
+    latency_base = None
+
+    backend.execute_raw_command(CLASS_NUMBER_PATTERN_SOURCE,
+        PATTERN_SOURCE_VERB_START, data=struct.pack('<I', rate),
+        pretty_name="pattern_source.start")
+
+    try:
+        start = time.perf_counter()
+        buffers = [bytearray(CHUNK_SIZE) for _ in range(read_batch)]
+
+        while (time.perf_counter() - start) < duration:
+            lengths = pipe.read_into(
+                [memoryview(b) for b in buffers], timeout=timeout)
+
+            arrival = time.perf_counter()
+
+            for buffer, length in zip(buffers, lengths):
+                if length != CHUNK_SIZE:
+                    short_transfers += 1
+                    continue
+
+                magic, sequence, timestamp, _dropped = \
+                    CHUNK_HEADER.unpack_from(buffer)
+
+                if magic != PATTERN_SOURCE_MAGIC:
+                    bad_magic += 1
+                    continue
+
+                chunks_received += 1
+                bytes_received += length
+
+                # Sequence gaps are chunks the device generated (or
+                # accounted as dropped) that never reached us.
+                if (next_sequence is not None) and (sequence != next_sequence):
+                    sequence_gap_chunks += (sequence - next_sequence) & 0xFFFFFFFF
+                next_sequence = (sequence + 1) & 0xFFFFFFFF
+
+                if buffer[CHUNK_HEADER.size:] != expected[sequence % SEED_PERIOD]:
+                    corrupt_payloads += 1
+
+                # Latency, from the device's generation timestamp to our
+                # arrival time. The clocks share no epoch, so the first
+                # chunk defines the zero point: the summary's spread and
+                # percentiles are meaningful, its absolute offset is not.
+                if latency_base is None:
+                    latency_base = (arrival, timestamp)
+                device_elapsed = ((timestamp - latency_base[1]) & 0xFFFFFFFF) / 1e6
+                latency_samples.append((arrival - latency_base[0]) - device_elapsed)
+
+        elapsed = time.perf_counter() - start
+
+    finally:
+        backend.execute_raw_command(CLASS_NUMBER_PATTERN_SOURCE,
+            PATTERN_SOURCE_VERB_STOP, pretty_name="pattern_source.stop")
+
+        if close_pipe:
+            pipe.close()
+
+    chunks_sent, chunks_dropped, _ = struct.unpack('<III',
+        backend.execute_raw_command(CLASS_NUMBER_PATTERN_SOURCE,
+            PATTERN_SOURCE_VERB_GET_STATISTICS,
+            pretty_name="pattern_source.get_statistics"))
+
+    results = {
+        'commanded_rate':        rate,
+        'elapsed_s':             round(elapsed, 4),
+        'chunks_received':       chunks_received,
+        'bytes_received':        bytes_received,
+        'bytes_per_second':      round(bytes_received / elapsed, 1) if elapsed else 0,
+        'corrupt_payloads':      corrupt_payloads,
+        'bad_magic':             bad_magic,
+        'short_transfers':       short_transfers,
+        'sequence_gap_chunks':   sequence_gap_chunks,
+        'device_chunks_sent':    chunks_sent,
+        'device_chunks_dropped': chunks_dropped,
+    }
+
+    if latency_samples:
+        results['latency'] = _summarize_latencies(latency_samples)
+
+    return results
+
+
+def to_json(results):
+    """ Renders a result dictionary as stable, readable JSON. """
+    return json.dumps(results, indent=2, sort_keys=True)
+
+
+def main():
+    """ Command-line entry point: runs the pipeline and prints JSON results. """
+
+    parser = argparse.ArgumentParser(
+        description="Validates a libgreat device's reference streaming pipeline.")
+    parser.add_argument('--rate', type=int, default=0,
+        help="commanded rate in bytes per second (default: unpaced)")
+    parser.add_argument('--duration', type=float, default=5.0,
+        help="measurement time, in seconds")
+    parser.add_argument('--serial', type=str, default=None,
+        help="serial number of the device to test, if several are connected")
+    arguments = parser.parse_args()
+
+    from .comms import CommsBackend
+
+    identifiers = {}
+    if arguments.serial:
+        identifiers['serial_number'] = arguments.serial
+
+    backend = CommsBackend.from_device_uri(**identifiers)
+    print(to_json(run(backend, rate=arguments.rate, duration=arguments.duration)))
+
+
+if __name__ == '__main__':
+    sys.exit(main())